@@ -9,4 +9,85 @@ UPICOContentResourceFinder::UPICOContentResourceFinder(const FObjectInitializer&
 {
 	static ConstructorHelpers::FObjectFinder<UMaterial> StaticUnderlayMaterial(TEXT("Material'/PICOXR/Materials/UnderlayMaterial.UnderlayMaterial'"));
 	StereoLayerDepthMat = StaticUnderlayMaterial.Object;
-}
\ No newline at end of file
+}
+
+#if !UE_BUILD_SHIPPING
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "PXR_Log.h"
+
+namespace PICOXRUtilsBenchmark
+{
+	// Same layout as PxrPosef, so the benchmark runs on every platform.
+	struct FXRQuat { float x, y, z, w; };
+	struct FXRVector { float x, y, z; };
+	struct FXRPose { FXRQuat orientation; FXRVector position; };
+
+	// Two hands worth of joints, the largest batch converted every frame.
+	static const int32 PoseCount = 52;
+
+	static void FillPoses(TArray<FXRPose>& Poses)
+	{
+		FRandomStream Stream(0x5049434F);
+		Poses.SetNumUninitialized(PoseCount);
+		for (FXRPose& Pose : Poses)
+		{
+			const FQuat Quat = FQuat(Stream.VRand(), Stream.FRandRange(-PI, PI));
+			Pose.orientation = { Quat.X, Quat.Y, Quat.Z, Quat.W };
+			Pose.position = { Stream.FRandRange(-2.0f, 2.0f), Stream.FRandRange(-2.0f, 2.0f), Stream.FRandRange(-2.0f, 2.0f) };
+		}
+		// Signed zeros, denormals and large values must round the same way as the scalar path.
+		Poses[0].orientation = { 0.0f, -0.0f, 0.0f, -1.0f };
+		Poses[0].position = { -0.0f, 0.0f, -0.0f };
+		Poses[1].position = { FLT_MIN * 0.5f, -FLT_MIN * 0.25f, 1.0e30f };
+	}
+
+	static void ConvertScalar(const TArray<FXRPose>& Poses, float Scale, FQuat* OutOrientations, FVector* OutPositions)
+	{
+		for (int32 Index = 0; Index < Poses.Num(); Index++)
+		{
+			const FXRPose& Pose = Poses[Index];
+			OutOrientations[Index] = FPICOXRUtils::ConvertXRQuatToUnrealQuat(FQuat(Pose.orientation.x, Pose.orientation.y, Pose.orientation.z, Pose.orientation.w));
+			OutPositions[Index] = FPICOXRUtils::ConvertXRVectorToUnrealVector(FVector(Pose.position.x, Pose.position.y, Pose.position.z), Scale);
+		}
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+		const float Scale = 100.0f;
+
+		TArray<FXRPose> Poses;
+		FillPoses(Poses);
+
+		TArray<FQuat> Orientations;
+		TArray<FVector> Positions;
+		Orientations.SetNumZeroed(PoseCount);
+		Positions.SetNumZeroed(PoseCount);
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			ConvertScalar(Poses, Scale, Orientations.GetData(), Positions.GetData());
+		}
+		const double ScalarTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			FPICOXRUtils::ConvertXRPosesToUnrealPoses(Poses.GetData(), Orientations.GetData(), Positions.GetData(), PoseCount, Scale);
+		}
+		const double BatchTime = FPlatformTime::Seconds() - StartTime;
+
+		const double ScalarNs = ScalarTime * 1.0e9 / ((double)Iterations * PoseCount);
+		const double BatchNs = BatchTime * 1.0e9 / ((double)Iterations * PoseCount);
+		PXR_LOGI(PxrUnreal, "ConvertXRPoses benchmark: %d poses x %d iterations, Scalar:%.2fns/pose, Batch:%.2fns/pose, Speedup:%.2fx",
+			PoseCount, Iterations, ScalarNs, BatchNs, BatchNs > 0.0 ? ScalarNs / BatchNs : 0.0);
+	}
+
+	static FAutoConsoleCommand BenchmarkCommand(
+		TEXT("pxr.Utils.BenchmarkPoseConversion"),
+		TEXT("Times the batch pose conversion against the scalar one. PICOXR.HMD.Utils checks they are bit-exact. Optional argument: iteration count."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
+#endif
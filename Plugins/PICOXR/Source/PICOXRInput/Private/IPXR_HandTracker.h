@@ -2,6 +2,7 @@
 
 #pragma once
 #include "CoreMinimal.h"
+#include "PXR_HandJointBuffer.h"
 
 #if PLATFORM_ANDROID
 #include "PxrInput.h"
@@ -13,7 +14,6 @@ enum class EPICOXRHandJoint : uint8;
 enum class EPICOXRHandStage : uint8;
 enum class EPICOXRActiveInputDevice : uint8;
 enum class EPICOXRHandType : uint8;
-#define XR_HAND_JOINT_COUNT_MAX 26
 
 /**
  * 
@@ -53,11 +53,7 @@ public:
 	struct FPICOXRHandState : public FNoncopyable
 	{
 		FPICOXRHandState()
-		:Radii{}
-		, SpaceLocationFlags{}
-		, ReceivedJointPoses(false)
-		, HandScale(0)
-		, Status(0)
+		:Status(0)
 		, PinchStrengthIndex(0)
 		, PinchStrengthMiddle(0)
 		, PinchStrengthRing(0)
@@ -71,12 +67,8 @@ public:
 		PxrHandAimState AimState;
 #endif
 		
-		// Transforms are cached in Unreal Tracking Space
-		FTransform KeypointTransforms[XR_HAND_JOINT_COUNT_MAX];
-		float Radii[XR_HAND_JOINT_COUNT_MAX];
-		uint64 SpaceLocationFlags[XR_HAND_JOINT_COUNT_MAX];
-		bool ReceivedJointPoses;
-		float HandScale;
+		// Joints are cached in Unreal Tracking Space
+		FPICOXRHandJointBuffer Joints;
 		
 		uint64 Status;
 		FTransform AimPose; //Pose of the interactive ray
@@ -86,17 +78,22 @@ public:
 		float PinchStrengthLittle; //Pinch finger strength
 		float TouchStrengthRay;
 		
+		const FPICOXRHandJointFrame& GetJointFrame() const
+		{
+			return Joints.GetFrame();
+		}
 		bool GetTransform(EPICOXRHandJoint KeyPoint, FTransform& OutTransform) const
 		{
 			check(static_cast<int32>(KeyPoint) < XR_HAND_JOINT_COUNT_MAX);
-			OutTransform = KeypointTransforms[static_cast<uint32>(KeyPoint)];
+			const FPICOXRHandJointFrame& Frame = GetJointFrame();
+			OutTransform = Frame.GetTransform(static_cast<int32>(KeyPoint));
 
-			return ReceivedJointPoses;
+			return Frame.bActive;
 		};
-		const FTransform& GetTransform(EPICOXRHandJoint KeyPoint) const
+		FTransform GetTransform(EPICOXRHandJoint KeyPoint) const
 		{
 			check(static_cast<int32>(KeyPoint) < XR_HAND_JOINT_COUNT_MAX);
-			return KeypointTransforms[static_cast<uint32>(KeyPoint)];
+			return GetJointFrame().GetTransform(static_cast<int32>(KeyPoint));
 		}
 	};
 	
@@ -121,6 +118,8 @@ public:
 	virtual bool GetFingerIsPinching(const EPICOXRHandType DeviceHand,EPICOXRHandFinger Finger) =0;
 	virtual float GetFingerPinchStrength(const EPICOXRHandType DeviceHand, EPICOXRHandFinger Finger) =0;
 	virtual EPICOXRActiveInputDevice GetActiveInputDevice()=0;
+	/** Zero-copy access to the latest joint frame of a hand, nullptr when hand tracking is unavailable. */
+	virtual const FPICOXRHandJointFrame* GetHandJointFrame(const EPICOXRHandType DeviceHand) const =0;
 
 	virtual void UpdateHandState() =0;
 	static FName GetModularFeatureName()
@@ -180,3 +179,5 @@ protected:
 	
 };
 
+/** The registered PICO hand tracker, nullptr when hand tracking is not available. */
+IPXR_HandTracker* GetHandTracker();
@@ -13,6 +13,7 @@
 #include "Camera/PlayerCameraManager.h"
 #include "PXR_Input.h"
 #include "PXR_Log.h"
+#include "Features/IModularFeatures.h"
 #if PLATFORM_ANDROID
 #include "PxrInput.h"
 #endif
@@ -45,6 +46,51 @@ void UPICOXRHandComponent::BeginPlay()
 	//Hide Component if HandTracking is Disabled
 	const bool bStartHidden = UPICOXRInputFunctionLibrary::IsHandTrackingEnabled() ? false : true;
 	SetHiddenInGame(bStartHidden, true);
+
+	HandTracker = GetHandTracker();
+	IModularFeatures::Get().OnModularFeatureRegistered().AddUObject(this, &UPICOXRHandComponent::OnModularFeatureRegistered);
+	IModularFeatures::Get().OnModularFeatureUnregistered().AddUObject(this, &UPICOXRHandComponent::OnModularFeatureUnregistered);
+}
+
+void UPICOXRHandComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	IModularFeatures::Get().OnModularFeatureRegistered().RemoveAll(this);
+	IModularFeatures::Get().OnModularFeatureUnregistered().RemoveAll(this);
+	HandTracker = nullptr;
+	Super::EndPlay(EndPlayReason);
+}
+
+void UPICOXRHandComponent::RefreshBoneMappings()
+{
+	BoneMap.Reset();
+}
+
+#if WITH_EDITOR
+void UPICOXRHandComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	const FName PropertyName = PropertyChangedEvent.GetPropertyName();
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UPICOXRHandComponent, BoneNameMappings) || PropertyName == GET_MEMBER_NAME_CHECKED(UPICOXRHandComponent, BoneRotationCorrections))
+	{
+		BoneMap.Reset();
+	}
+}
+#endif
+
+void UPICOXRHandComponent::OnModularFeatureRegistered(const FName& Type, IModularFeature* ModularFeature)
+{
+	if (Type == IPXR_HandTracker::GetModularFeatureName() && !HandTracker)
+	{
+		HandTracker = GetHandTracker();
+	}
+}
+
+void UPICOXRHandComponent::OnModularFeatureUnregistered(const FName& Type, IModularFeature* ModularFeature)
+{
+	if (Type == IPXR_HandTracker::GetModularFeatureName() && ModularFeature == HandTracker)
+	{
+		HandTracker = nullptr;
+	}
 }
 
 void UPICOXRHandComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
@@ -87,32 +133,29 @@ void UPICOXRHandComponent::UpdateBonePose()
 {
 	if (bCustomHandMesh)
 	{
-		for (auto& BoneElem : BoneNameMappings)
+		if (!BoneMap.IsBuiltFor(SkeletalMesh))
 		{
-			if (BoneElem.Key == EPICOXRHandJoint::Wrist)
-			{
-				FTransform BoneTransform = UPICOXRInputFunctionLibrary::GetHandRootPose(SkeletonType);
-				if (!BoneTransform.Rotator().ContainsNaN() && !BoneTransform.Rotator().IsZero())
-				{
-					SetBoneRotationByName(BoneElem.Value, BoneTransform.Rotator(), EBoneSpaces::WorldSpace);
-				}
-			}
-			else
-			{
 #if ENGINE_MINOR_VERSION >26
- 				const int32 BoneIndex = SkeletalMesh->GetRefSkeleton().FindBoneIndex(BoneElem.Value);
+			BoneMap.Build(SkeletalMesh->GetRefSkeleton(), BoneNameMappings, BoneRotationCorrections, SkeletalMesh);
 #else
-				const int32 BoneIndex = SkeletalMesh->RefSkeleton.FindBoneIndex(BoneElem.Value);
+			BoneMap.Build(SkeletalMesh->RefSkeleton, BoneNameMappings, BoneRotationCorrections, SkeletalMesh);
 #endif
-				if (BoneIndex >= 0)
+			PXR_LOGD(PxrUnreal, "HandComponent rebuilt bone map, %d bones bound", BoneMap.GetBindings().Num());
+		}
+
+		const FPICOXRHandJointFrame* JointFrame = HandTracker ? HandTracker->GetHandJointFrame(SkeletonType) : nullptr;
+		if (JointFrame && JointFrame->bActive)
+		{
+			if (BoneMap.GetWristBoneIndex() != INDEX_NONE)
+			{
+				const FTransform BoneTransform = HandTracker->GetHandRootPose(SkeletonType);
+				const FQuat BoneRotation = BoneTransform.GetRotation() * BoneMap.GetWristRestCorrection();
+				if (!BoneRotation.ContainsNaN() && !BoneTransform.Rotator().IsZero())
 				{
-					FQuat BoneRotation = UPICOXRInputFunctionLibrary::GetBoneRotation(SkeletonType, BoneElem.Key);
-					if (!BoneRotation.IsIdentity())
-					{
-						BoneSpaceTransforms[BoneIndex].SetRotation(BoneRotation);
-					}
+					BoneMap.ApplyWristRotation(GetComponentTransform().GetRotation().Inverse() * BoneRotation, BoneSpaceTransforms);
 				}
 			}
+			BoneMap.ApplyJointRotations(*JointFrame, BoneSpaceTransforms);
 		}
 	}
 
@@ -3,9 +3,12 @@
 #include "CoreMinimal.h"
 #include "Components/PoseableMeshComponent.h"
 #include "PXR_InputFunctionLibrary.h"
+#include "PXR_HandBoneMap.h"
 #include "PXR_HandComponent.generated.h"
 
 class APlayerCameraManager;
+class IPXR_HandTracker;
+class IModularFeature;
 
 UCLASS(Blueprintable, ClassGroup = (PICOXRComponent), meta = (BlueprintSpawnableComponent))
 class PICOXRINPUT_API UPICOXRHandComponent : public UPoseableMeshComponent
@@ -17,6 +20,8 @@ public:
 	
  	virtual void BeginPlay() override;
 
+ 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
  	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
  	/** Behavior for when hand tracking loses high confidence tracking */
@@ -31,9 +36,30 @@ public:
  	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "CustomSkeletalMesh")
  	TMap<EPICOXRHandJoint, FName> BoneNameMappings;
 
+ 	/** Rotation applied after the runtime joint rotation, for custom meshes whose rest pose differs from the runtime hand */
+ 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "CustomSkeletalMesh")
+ 	TMap<EPICOXRHandJoint, FRotator> BoneRotationCorrections;
+
+ 	/** Applies BoneNameMappings and BoneRotationCorrections after they were changed at runtime */
+ 	UFUNCTION(BlueprintCallable, Category = "CustomSkeletalMesh")
+ 	void RefreshBoneMappings();
+
+#if WITH_EDITOR
+ 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
  private:
  	/** Whether or not a custom hand mesh is being used */
  	bool bCustomHandMesh = false;
+
+ 	/** Joint to bone indices, rebuilt when the mesh changes or the mappings are refreshed */
+ 	FPICOXRHandBoneMap BoneMap;
+
+ 	/** Looked up at BeginPlay and when a hand tracker feature is registered, dropped when it is unregistered */
+ 	IPXR_HandTracker* HandTracker = nullptr;
+
+ 	void OnModularFeatureRegistered(const FName& Type, IModularFeature* ModularFeature);
+ 	void OnModularFeatureUnregistered(const FName& Type, IModularFeature* ModularFeature);
 	
  	void UpdateBonePose();
  	void UpdateHandTransform();
@@ -3,17 +3,104 @@
 
 #include "PXR_DP.h"
 #include "D3D11RHIPrivate.h"
+#include "PXR_DPAudio.h"
+#include "PXR_DPVideo.h"
+#include "PXR_HMDFunctionLibrary.h"
 #include "PXR_Log.h"
+#include "RenderingThread.h"
+#include "XRThreadUtils.h"
+#include "Misc/ScopeLock.h"
+
+static TAutoConsoleVariable<int32> CVarTextureRingDepth(
+	TEXT("vr.PICODPTextureRingDepth"),
+	3,
+	TEXT("Number of shared eye textures the PICODP frames are handed to the streamer through. 1 is a single surface the renderer and the streamer take turns on."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarTextureRingKeyedMutex(
+	TEXT("vr.PICODPKeyedMutex"),
+	0,
+	TEXT("Set to 1 to synchronise the PICODP shared eye textures with the streamer through a DXGI keyed mutex, for streamers that acquire it. 0 relies on the depth of the ring alone."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarTextureRingAcquireTimeout(
+	TEXT("vr.PICODPAcquireTimeoutMs"),
+	2,
+	TEXT("Milliseconds a PICODP frame waits for the streamer when it holds every shared eye texture, before the frame is dropped."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarHeartbeatInterval(
+	TEXT("vr.PICODPHeartbeatIntervalMs"),
+	500,
+	TEXT("Milliseconds between the heartbeats PICODP checks the runtime with. Three missed in a row drop the link and it is connected again."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarMaxReconnectDelay(
+	TEXT("vr.PICODPMaxReconnectDelayMs"),
+	8000,
+	TEXT("Most milliseconds PICODP waits between attempts to reconnect the runtime, the wait doubles from 500 with every attempt that fails."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarForwardLayers(
+	TEXT("vr.PICODPForwardLayers"),
+	0,
+	TEXT("Set to 1 to hand PICODP stereo layers to the runtime to place on the headset at its resolution, for runtimes that take them. 0 composites them into the eyes."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarLayerTargetIdleFrames(
+	TEXT("vr.PICODPLayerTargetIdleFrames"),
+	90,
+	TEXT("Frames a PICODP stereo layer target is kept unused before it is destroyed, for layers that are hidden and shown again."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVideoPort(
+	TEXT("vr.PICODPVideoPort"),
+	0,
+	TEXT("UDP port of the headset PICODP sends the left eye to, encoded to H.264 over RTP. 0 leaves encoding to the runtime."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVideoBitrate(
+	TEXT("vr.PICODPVideoBitrateKbps"),
+	20000,
+	TEXT("Kilobits per second PICODP encodes the eye it sends to the headset at, with vr.PICODPVideoPort."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVideoFrameRate(
+	TEXT("vr.PICODPVideoFrameRate"),
+	72,
+	TEXT("Frames per second PICODP encodes and paces the eye it sends to the headset at, with vr.PICODPVideoPort."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVideoPacing(
+	TEXT("vr.PICODPVideoPacing"),
+	150,
+	TEXT("Percent of vr.PICODPVideoBitrateKbps PICODP paces the packets of the eye it sends to, so a key frame does not burst onto the link. 0 sends every frame at once."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVideoPacketPool(
+	TEXT("vr.PICODPVideoPacketPool"),
+	512,
+	TEXT("Packets PICODP queues at most for the eye it sends, across frames. A frame that does not fit is dropped and the next one is a key frame."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVideoFoveation(
+	TEXT("vr.PICODPVideoFoveation"),
+	1,
+	TEXT("How much PICODP coarsens the periphery of the eye it sends, 0 to 3 for the foveation levels Low to TopHigh. The streamer's encoder takes the preset closest to the falloff. -1 encodes the whole eye alike."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAudioPort(
+	TEXT("vr.PICODPAudioPort"),
+	0,
+	TEXT("UDP port of the headset PICODP sends the captured audio to over RTP, stamped with the frames it plays with. 0 leaves the audio to the runtime."),
+	ECVF_RenderThreadSafe);
 
 DP::DP()
 {
 	PXR_LOGD(PxrUnreal,"PXR_DP Construct!");
+	Connection.OnStateChanged().AddRaw(this, &DP::OnConnectionStateChanged);
 	PXR_LOGD(PxrUnreal,"PXR_DP ConnectServer!");
 	ConnectServer();
-	PXR_LOGD(PxrUnreal,"PXR_DP RegisterDemo!");
-	RegisterDemo();
-	PXR_LOGD(PxrUnreal,"PXR_DP CreateSharedTexture2D!");
-	CreateSharedTexture2D();
 }
 
 DP::~DP()
@@ -25,149 +112,190 @@ DP::~DP()
 
 bool DP::ConnectServer()
 {
-	FString StreamerDLLDir = FPaths::ProjectPluginsDir() / FString::Printf(TEXT("PICOXR/Libs/Win64/"));
-	FPlatformProcess::PushDllDirectory(*StreamerDLLDir);
-	FPlatformProcess::GetDllHandle(*(StreamerDLLDir + "pxr_turtledove.dll"));
-	FPlatformProcess::PopDllDirectory(*StreamerDLLDir);
-	PXR_LOGD(PxrUnreal,"PXR_DP Destruct DisConnectServer!");
-	PXR_LOGD(PxrUnreal,"PXR_DP DLL Path:%s", *StreamerDLLDir)
+	//The link opens on the connection's thread, the state changes as DP ticks
+	Connection.Startup();
+	Connection.Tick();
+	return Connection.GetState() != EPICOXRDPConnectionState::Disconnected;
+}
+
+void DP::DisConnectServer()
+{
+	Connection.Shutdown();
+}
+
+void DP::GetRemoteID()
+{
+	//The ids are queried by the connection, a headset that is not there yet is picked up once it is
+	Connection.Tick();
+	bQueryIDFinished = true;
+}
 
-		terminal_ = RegisterAsTerminal();
-	bool ConnectToPICORuntimeOk = false;
-	while (count < 2)
+void DP::Tick()
+{
+	check(IsInGameThread());
+	FPICOXRDPConnectionSettings Settings;
+	Settings.HeartbeatInterval = FMath::Max(CVarHeartbeatInterval.GetValueOnGameThread(), 1) / 1000.0;
+	Settings.MaxBackoff = FMath::Max(CVarMaxReconnectDelay.GetValueOnGameThread(), 500) / 1000.0;
+	Connection.SetSettings(Settings);
+	Connection.Tick();
+}
+
+void DP::OnConnectionStateChanged(EPICOXRDPConnectionState OldState, EPICOXRDPConnectionState NewState)
+{
+	if (OldState == EPICOXRDPConnectionState::Connected)
 	{
-		count++;
-		pxr::IDPInterface::IResult result = terminal_->ConnectToHost("127.0.0.1", "50051");
-		if (result != pxr::IDPInterface::IResult::kOK)
+		TSharedPtr<FPICOXRDPVideoStreamer, ESPMode::ThreadSafe> OldVideoStreamer;
+		TSharedPtr<FPICOXRDPAudioStreamer, ESPMode::ThreadSafe> OldAudioStreamer;
 		{
-			continue;
+			FScopeLock ScopeLock(&TerminalLock);
+			Terminal.Reset();
+			OldVideoStreamer = MoveTemp(VideoStreamer);
+			OldAudioStreamer = MoveTemp(AudioStreamer);
 		}
-		else
+		Accessories.SetTerminal(nullptr, 0);
+		terminal_ = nullptr;
+		//The render and the RHI thread may be submitting through the terminal, they have to be done before the link closes
+		FlushRenderingCommands();
+		//No frame is submitted to the encoder or stamped on the audio any more, the RHI thread let go of the encoder with the flush,
+		//both stop with the last reference
+		OldVideoStreamer.Reset();
+		OldAudioStreamer.Reset();
+		PXR_LOGW(PxrUnreal,"PXR_DP lost the runtime, %s", LexToString(NewState));
+	}
+
+	if (NewState == EPICOXRDPConnectionState::Connected)
+	{
+#if PLATFORM_WINDOWS
+		terminal_ = Connection.GetLink().GetTerminal();
+#endif
+		local_runtime_id_ = Connection.GetRuntimeId();
+		PXR_LOGD(PxrUnreal,"PXR_DP local_runtime_id_:%d", local_runtime_id_);
+		remote_hmd_id_ = Connection.GetHmdId();
+		PXR_LOGD(PxrUnreal,"PXR_DP remote_hmd_id_:%d", remote_hmd_id_);
+		if (terminal_)
 		{
-			PXR_LOGD(PxrUnreal,"PXR_DP Connect to PICO Runtime OK 127.0.0.1:50051");
-			ConnectToPICORuntimeOk = true;
-			count = 0;
-			break;
+			Accessories.SetTerminal(terminal_, remote_hmd_id_);
+			FScopeLock ScopeLock(&TerminalLock);
+			Terminal = IPICOXRDPTerminal::CreateConnector(terminal_, local_runtime_id_, Accessories);
 		}
+		//The remote's clock starts over with the terminal, and a new streamer opens the shared textures afresh
+		PoseTimeline.Reset();
+		ConnectionEpoch.Increment();
+		StartVideoStreamer();
+		StartAudioStreamer();
 	}
-	return ConnectToPICORuntimeOk;
 }
 
-void DP::DisConnectServer()
+void DP::StartVideoStreamer()
 {
-	if (terminal_)
+	const int32 Port = CVarVideoPort.GetValueOnGameThread();
+	if (Port <= 0 || Port > MAX_uint16)
+	{
+		return;
+	}
+
+	FPICOXRDPVideoSettings Settings;
+	if (!Connection.GetHmdAddress(Settings.Tunnel.Config.Ip))
 	{
-		terminal_->Bye();
-		terminal_->DisconnectFromHost();
-		UnregisterTerminal(&terminal_);
+		PXR_LOGW(PxrUnreal,"PXR_DP has no address for headset %u, the eyes are not encoded", Connection.GetHmdId());
+		return;
 	}
+	const int32 FrameRate = FMath::Clamp(CVarVideoFrameRate.GetValueOnGameThread(), 1, 240);
+	const int32 Bitrate = FMath::Clamp(CVarVideoBitrate.GetValueOnGameThread(), 1000, 200000) * 1000;
+	//The bitrate starts at the one set and backs off from it as the sends drop or queue up, so the pacing keeps ahead of it
+	Settings.Encoder.Config.Bitrate = Bitrate;
+	Settings.Encoder.Config.Fps = FrameRate;
+	Settings.Encoder.MaxBitrate = Bitrate;
+	Settings.Encoder.MinBitrate = FMath::Min(Settings.Encoder.MinBitrate, Bitrate / 4);
+	Settings.Tunnel.Config.Type = EPICOXRDPTunnelType::RtpH264;
+	Settings.Tunnel.Config.Port = (uint32)Port;
+	Settings.Tunnel.Config.Rate = (uint32)FrameRate;
+	Settings.Tunnel.PoolSize = FMath::Clamp(CVarVideoPacketPool.GetValueOnGameThread(), 16, 8192);
+	Settings.Tunnel.PacingRate = Bitrate / 8.0 * FMath::Max(CVarVideoPacing.GetValueOnGameThread(), 0) / 100.0;
+	const int32 Foveation = CVarVideoFoveation.GetValueOnGameThread();
+	if (Foveation >= 0)
+	{
+		Settings.bQualityMap = true;
+		Settings.QualityMap = FPICOXRDPQualityMapSettings::ForFoveation((EPICOXRFoveationLevel)FMath::Min(Foveation, (int32)EPICOXRFoveationLevel::TopHigh));
+		const float HalfFov = FMath::DegreesToRadians(DirectPreviewFov) / 2.f;
+		Settings.Fov.Left = -HalfFov;
+		Settings.Fov.Right = HalfFov;
+		Settings.Fov.Up = HalfFov;
+		Settings.Fov.Down = -HalfFov;
+	}
+
+	//The encoder starts with the first eye submitted on the RHI thread, at its size
+	TSharedRef<FPICOXRDPVideoStreamer, ESPMode::ThreadSafe> NewVideoStreamer = MakeShared<FPICOXRDPVideoStreamer, ESPMode::ThreadSafe>();
+	NewVideoStreamer->Startup(Settings);
+	FScopeLock ScopeLock(&TerminalLock);
+	VideoStreamer = NewVideoStreamer;
 }
 
-void DP::RegisterDemo()
+TSharedPtr<FPICOXRDPVideoStreamer, ESPMode::ThreadSafe> DP::GetVideoStreamer() const
 {
-	TerminalInfo  myInfo;
-	myInfo.SetTerminalType_(TerminalInfo::Type::kDriver);
-	myInfo.SetIp_("127.0.0.1");
-	//Todo prevent connect failed, for now just try twice.
-	while (count < 2)
+	FScopeLock ScopeLock(&TerminalLock);
+	return VideoStreamer;
+}
+
+void DP::StartAudioStreamer()
+{
+	const int32 Port = CVarAudioPort.GetValueOnGameThread();
+	if (Port <= 0 || Port > MAX_uint16)
 	{
-		count++;
-		auto result = terminal_->Hello(myInfo);
-		if (result != pxr::IDPInterface::IResult::kOK)
-		{
-			continue;
-		}
-		else
-		{
-			count = 0;
-			PXR_LOGD(PxrUnreal,"PXR_DP Hello OK!");
-			break;
-		}
+		return;
+	}
+
+	FPICOXRDPAudioSettings Settings;
+	if (!Connection.GetHmdAddress(Settings.Tunnel.Config.Ip))
+	{
+		PXR_LOGW(PxrUnreal,"PXR_DP has no address for headset %u, the audio is not sent", Connection.GetHmdId());
+		return;
 	}
+	Settings.Tunnel.Config.Port = (uint32)Port;
+
+	//The source captures what the streamer's CaptureInterface hears from the moment it starts
+	TSharedRef<FPICOXRDPAudioStreamer, ESPMode::ThreadSafe> NewAudioStreamer = MakeShared<FPICOXRDPAudioStreamer, ESPMode::ThreadSafe>();
+	if (!NewAudioStreamer->Startup(Settings))
+	{
+		PXR_LOGE(PxrUnreal,"PXR_DP could not start sending the audio to port %d", Port);
+		return;
+	}
+	FScopeLock ScopeLock(&TerminalLock);
+	AudioStreamer = NewAudioStreamer;
 }
 
-void DP::GetRemoteID()
+TSharedPtr<FPICOXRDPAudioStreamer, ESPMode::ThreadSafe> DP::GetAudioStreamer() const
 {
-	if (terminal_)
+	FScopeLock ScopeLock(&TerminalLock);
+	return AudioStreamer;
+}
+
+bool DP::GetVideoStats(FPICOXRDPVideoStats& OutStats) const
+{
+	const TSharedPtr<FPICOXRDPVideoStreamer, ESPMode::ThreadSafe> CurrentVideoStreamer = GetVideoStreamer();
+	if (!CurrentVideoStreamer.IsValid())
 	{
-		terminal_->QueryRemoteTerminalId(TerminalInfo::Type::kRuntime, local_runtime_id_);
-		PXR_LOGD(PxrUnreal,"PXR_DP local_runtime_id_:%d", local_runtime_id_);
-		terminal_->QueryRemoteTerminalId(TerminalInfo::Type::kHmdWireless, remote_hmd_id_);
-		PXR_LOGD(PxrUnreal,"PXR_DP remote_hmd_id_:%d", remote_hmd_id_);
+		return false;
 	}
-	bQueryIDFinished = true;
+	OutStats = CurrentVideoStreamer->GetStats();
+	return true;
+}
+
+TSharedPtr<IPICOXRDPTerminal, ESPMode::ThreadSafe> DP::GetTerminal() const
+{
+	FScopeLock ScopeLock(&TerminalLock);
+	return Terminal;
 }
 
 void DP::SendMessage()
 {
-	if (!bQueryIDFinished || !bDstTextureOK)
+	const TSharedPtr<IPICOXRDPTerminal, ESPMode::ThreadSafe> CurrentTerminal = GetTerminal();
+	if (!bQueryIDFinished || !CurrentTerminal.IsValid())
 	{
 		return;
 	}
-	uint32 LeftHandle = HandleToULong(LeftDstTextureHandle);
-	uint32 RightHandle = HandleToULong(RightDstTextureHandle);
-	pxr::p_uint64 left_eye_handle = LeftHandle;
-	pxr::p_uint64 right_eye_handle = RightHandle;
-
-	TerminalMessage submit_message;
-	submit_message.SetType_(TerminalMessage::Type::kSubmitEyeLayer);
-	submit_message.SetDestinationTerminalId(local_runtime_id_);
-
-	std::vector<TerminalMessage::Parameter> parameters;
-	TerminalMessage::Parameter parameter;
-
-	FVector position = FVector::ZeroVector;
-	FQuat rotation = FQuat::Identity;
-	GetPositionAndRotation(position, rotation);
-
-	parameter.describe = "rotation_x";
-	parameter.parameter = std::to_string(rotation.X);
-	parameter.type = TerminalMessage::Parameter::Type::kFloat;
-	parameters.push_back(parameter);
-
-	parameter.describe = "rotation_y";
-	parameter.parameter = std::to_string(rotation.Y);
-	parameter.type = TerminalMessage::Parameter::Type::kFloat;
-	parameters.push_back(parameter);
-
-	parameter.describe = "rotation_z";
-	parameter.parameter = std::to_string(rotation.Z);
-	parameter.type = TerminalMessage::Parameter::Type::kFloat;
-	parameters.push_back(parameter);
-
-	parameter.describe = "rotation_w";
-	parameter.parameter = std::to_string(-rotation.W);
-	parameter.type = TerminalMessage::Parameter::Type::kFloat;
-	parameters.push_back(parameter);
-
-	parameter.describe = "position_x";
-	parameter.parameter = std::to_string(position.X);
-	parameter.type = TerminalMessage::Parameter::Type::kFloat;
-	parameters.push_back(parameter);
-
-	parameter.describe = "position_y";
-	parameter.parameter = std::to_string(position.Y);
-	parameter.type = TerminalMessage::Parameter::Type::kFloat;
-	parameters.push_back(parameter);
-
-	parameter.describe = "position_z";
-	parameter.parameter = std::to_string(position.Z);
-	parameter.type = TerminalMessage::Parameter::Type::kFloat;
-	parameters.push_back(parameter);
-
-	parameter.describe = "left_eye";
-	parameter.parameter = std::to_string(left_eye_handle);
-	parameter.type = TerminalMessage::Parameter::Type::kUInt64;
-	parameters.push_back(parameter);
-
-	parameter.describe = "right_eye";
-	parameter.parameter = std::to_string(right_eye_handle);
-	parameter.type = TerminalMessage::Parameter::Type::kUInt64;
-	parameters.push_back(parameter);
-
-	submit_message.SetParameters(parameters);
-
-	pxr::IDPInterface::IResult res = terminal_->PushMessage(submit_message);
+	//The render thread owns the ring, Present only sees the frames whose copies have run
+	CurrentTerminal->SubmitLatest(PublishedFrame->Get(), PoseTimeline);
 }
 
 uint32 DP::GetHandle(ID3D11Texture2D& D3D11Texture2D)
@@ -176,105 +304,126 @@ uint32 DP::GetHandle(ID3D11Texture2D& D3D11Texture2D)
 	return uint32();
 }
 
-int ColorRGBA(int alpha, int red, int green, int blue)
+int32 DP::BeginEyeTextures_RenderThread(FIntPoint RenderTargetSize)
 {
-	return (alpha << 24 | red << 16 | green << 8 | blue);
-}
+	check(IsInRenderingThread());
+	const int32 Epoch = ConnectionEpoch.GetValue();
+	if (Epoch != RenderConnectionEpoch)
+	{
+		//A reconnected streamer opens the eye textures afresh, and the one that dropped may have kept a slot's keyed mutex
+		RenderConnectionEpoch = Epoch;
+		TextureRing.Reset();
+		LayerCompositor.Reset();
+	}
 
-void DP::CreateSharedTexture2D()
-{
-	auto device = static_cast<ID3D11Device*>(GDynamicRHI->RHIGetNativeDevice());
-	if (device == nullptr)
+	const bool bKeyedMutex = CVarTextureRingKeyedMutex.GetValueOnRenderThread() != 0;
+	if (bKeyedMutex != bTextureRingKeyedMutex)
 	{
-		return;
+		bTextureRingKeyedMutex = bKeyedMutex;
+		TextureRing.SetProvider(IPICOXRDPSharedTextureProvider::CreateDefault(bKeyedMutex));
+	}
+
+	FPICOXRDPTextureRingSettings Settings;
+	Settings.Depth = FMath::Clamp(CVarTextureRingDepth.GetValueOnRenderThread(), 1, 8);
+	Settings.AcquireTimeoutMs = FMath::Max(CVarTextureRingAcquireTimeout.GetValueOnRenderThread(), 0);
+	//The stereo render target holds the left eye in its left half and the right eye in its right half
+	const bool bConfigured = TextureRing.Configure(Settings, FIntPoint(RenderTargetSize.X / 2, RenderTargetSize.Y));
+	if (TextureRing.GetGeneration() != PublishedGeneration)
+	{
+		//The slots SendMessage may hold are gone, as are those of the frames still queued to be published
+		PublishedGeneration = TextureRing.GetGeneration();
+		PublishedFrame->Withdraw(PublishedGeneration);
 	}
-	if (LeftDstTexture && RightDstTexture)
+	if (!bConfigured)
 	{
-		return;
+		return INDEX_NONE;
 	}
-	D3D11_TEXTURE2D_DESC tdesc;
-
-	tdesc.Width = 1920;
-	tdesc.Height = 1920;
-	tdesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	tdesc.MipLevels = 1;
-	tdesc.ArraySize = 1;
-	tdesc.SampleDesc.Count = 1;
-	tdesc.SampleDesc.Quality = 0;
-	tdesc.CPUAccessFlags = 0;
-	tdesc.Usage = D3D11_USAGE_DEFAULT;
-	tdesc.BindFlags = D3D11_BIND_RENDER_TARGET;
-	tdesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
-
-	uint32_t m_color = ColorRGBA(255, 108, 108, 255);
-
-	std::vector<uint32_t> textureMap(1920 * 1920, m_color);
-	uint32_t* pData = textureMap.data();
-
-	D3D11_SUBRESOURCE_DATA sd;
-	ZeroMemory(&sd, sizeof(sd));
-	sd.pSysMem = pData;
-	sd.SysMemPitch = 1920 * sizeof(uint32_t);
-	sd.SysMemSlicePitch = 1920 * 1920 * sizeof(uint32_t);
-
-	if (device->CreateTexture2D(&tdesc, &sd, LeftDstTexture.GetInitReference()) != S_OK
-		|| device->CreateTexture2D(&tdesc, &sd, RightDstTexture.GetInitReference()) != S_OK)
+	return TextureRing.BeginWrite();
+}
+
+void DP::EndEyeTextures_RenderThread(FRHICommandListImmediate& RHICmdList, int32 Slot)
+{
+	check(IsInRenderingThread());
+	if (bTextureRingKeyedMutex)
 	{
-		PXR_LOGD(PxrUnreal,"PXR_DP Shared Texture Created faild!");
-		return;
+		//The copies have to reach the device before the keyed mutex hands the slot over
+		RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThread);
 	}
-	if (LeftDstTexture&& RightDstTexture)
+	TextureRing.EndWrite(Slot, GFrameNumberRenderThread);
+	PoseTimeline.MarkRendered(GFrameNumberRenderThread);
+	//Queued behind the copies, so Present does not hand the slot to the runtime before they ran
+	const FPICOXRDPTextureRingFrame Latest = TextureRing.GetLatestFrame();
+	TSharedRef<FPICOXRDPPublishedFrame, ESPMode::ThreadSafe> Published = PublishedFrame;
+	ExecuteOnRHIThread_DoNotWait([Published, Latest]()
 	{
-		PXR_LOGD(PxrUnreal,"PXR_DP Shared Texture Created!");
-		TRefCountPtr<IDXGIResource> LeftDXGIResource;
-		TRefCountPtr<IDXGIResource> RightDXGIResource;
-		LeftDstTexture->QueryInterface(LeftDXGIResource.GetInitReference());
-		RightDstTexture->QueryInterface(RightDXGIResource.GetInitReference());
-
-		const HRESULT LeftSharedHandleResult = LeftDXGIResource->GetSharedHandle(&LeftDstTextureHandle);
-		const HRESULT RightSharedHandleResult = RightDXGIResource->GetSharedHandle(&RightDstTextureHandle);
-		if (FAILED(LeftSharedHandleResult)|| FAILED(RightSharedHandleResult))
-		{
-			PXR_LOGD(PxrUnreal,"PXR_DP GetSharedHandle faild!");
-		}
-		else
+		Published->Publish(Latest);
+	});
+
+	const TSharedPtr<FPICOXRDPVideoStreamer, ESPMode::ThreadSafe> CurrentVideoStreamer = GetVideoStreamer();
+	if (CurrentVideoStreamer.IsValid())
+	{
+		//The encoder reads the slot once the copies ran, and starts again for a new size there rather than on the render thread
+		const uint64 Texture = Latest.EyeHandles[0];
+		const FIntPoint EyeSize = TextureRing.GetEyeSize();
+		const uint64 Frame = Latest.Frame;
+		ExecuteOnRHIThread_DoNotWait([CurrentVideoStreamer, Texture, EyeSize, Frame]()
 		{
-			PXR_LOGD(PxrUnreal,"PXR_DP Left Shared Handle ID:%lu", HandleToULong(LeftDstTextureHandle));
-			PXR_LOGD(PxrUnreal,"PXR_DP Right Shared Handle ID:%lu", HandleToULong(RightDstTextureHandle));
-			
-			CreateRHITexture(LeftDstTexture, PF_R8G8B8A8, LeftTempTexture);
-			CreateRHITexture(RightDstTexture, PF_R8G8B8A8, RightTempTexture);
-			if (LeftTempTexture->IsValid()|| RightTempTexture->IsValid())
-			{
-				PXR_LOGD(PxrUnreal,"PXR_DP TempTexture OK");
-			}
-			bDstTextureOK = true;
-		}
+			CurrentVideoStreamer->SubmitFrame(Texture, EyeSize, Frame);
+		});
 	}
-	else
+	//The audio captured from now on plays after this frame, stamped on the clock the encoder stamps it with
+	const TSharedPtr<FPICOXRDPAudioStreamer, ESPMode::ThreadSafe> CurrentAudioStreamer = GetAudioStreamer();
+	if (CurrentAudioStreamer.IsValid())
 	{
-		PXR_LOGD(PxrUnreal,"PXR_DP Shared Texture Created faild!");
+		CurrentAudioStreamer->SetVideoFrame(GFrameNumberRenderThread, FPlatformTime::Seconds());
 	}
 }
 
-bool DP::CreateRHITexture(ID3D11Texture2D* OpenedSharedResource, EPixelFormat Format, FTexture2DRHIRef& OutTexture)
+void DP::CompositeLayers_RenderThread(IPICOXRDPLayerRenderer& Renderer, int32 Slot, const FPICOXRDPLayerView& View, const TArray<FPICOXRDPLayerInput>& Layers)
+{
+	check(IsInRenderingThread());
+	FPICOXRDPLayerCompositorSettings Settings;
+	Settings.bForwardLayers = CVarForwardLayers.GetValueOnRenderThread() != 0;
+	Settings.IdleFrames = FMath::Max(CVarLayerTargetIdleFrames.GetValueOnRenderThread(), 0);
+	LayerCompositor.SetSettings(Settings);
+
+	FPICOXRDPLayerView EyeView = View;
+	EyeView.EyeSize = TextureRing.GetEyeSize();
+	FRHITexture2D* const EyeTextures[2] = { TextureRing.GetTexture(Slot, 0), TextureRing.GetTexture(Slot, 1) };
+	const TSharedPtr<IPICOXRDPTerminal, ESPMode::ThreadSafe> CurrentTerminal = GetTerminal();
+	LayerCompositor.Composite(Renderer, EyeView, Layers, EyeTextures, CurrentTerminal.Get());
+}
+
+uint64 DP::GetAccessoryFrame() const
 {
-	FD3D11DynamicRHI* DynamicRHI = static_cast<FD3D11DynamicRHI*>(GDynamicRHI);
-	OutTexture = DynamicRHI->RHICreateTexture2DFromResource(
-		Format, TexCreate_RenderTargetable | TexCreate_ShaderResource, FClearValueBinding::None, OpenedSharedResource).GetReference();
-	return OutTexture.IsValid();
+	return FPICOXRDPAccessorySnapshot::GetCurrentReader() == EPICOXRDPAccessoryReader::Render ? GFrameNumberRenderThread : GFrameNumber;
 }
 
 void DP::GetPositionAndRotation(FVector& OutPostion, FQuat& OutQuat)
 {
-	if (terminal_)
+	const TSharedPtr<IPICOXRDPTerminal, ESPMode::ThreadSafe> CurrentTerminal = GetTerminal();
+	if (CurrentTerminal.IsValid())
+	{
+		const uint64 Frame = GetAccessoryFrame();
+		FPICOXRDPPoseSample Pose;
+		CurrentTerminal->QueryHmdPose(Frame, Pose);
+		//The pose the game thread sets the views of the frame up with, kept for SendMessage to submit the frame with.
+		//The render thread reads it again for its stereo layers, that read is not what the frame was rendered at
+		if (FPICOXRDPAccessorySnapshot::GetCurrentReader() == EPICOXRDPAccessoryReader::Game)
+		{
+			PoseTimeline.AddRenderPose(Frame, Pose);
+		}
+		OutPostion = Pose.Position;
+		OutQuat = Pose.Rotation;
+	}
+	else if (terminal_)
 	{
-		TerminalAccessory ta;
-		terminal_->QueryRemoteTerminalAccessory(remote_hmd_id_, ta);
+		HmdAccessory hmd;
+		Accessories.GetHmd(FPICOXRDPAccessorySnapshot::GetCurrentReader(), GetAccessoryFrame(), hmd);
 		pxr::p_vector3_f position;
-		ta.GetHmdAccessoryPtr()->GetPosition_(position);
+		hmd.GetPosition_(position);
 		pxr::p_vector4_f rotation;
-		ta.GetHmdAccessoryPtr()->GetRotation_(rotation);
+		hmd.GetRotation_(rotation);
 		OutPostion.X = position.x;
 		OutPostion.Y = position.y;
 		OutPostion.Z = position.z;
@@ -294,10 +443,8 @@ void DP::GetControllerPositionAndRotation(int hand, float WorldScale, FVector& O
 {
 	if (terminal_)
 	{
-		pxr::connector::ControllerAccessory::Type handtype = (hand == 0 ? pxr::connector::ControllerAccessory::Type::kLeft : pxr::connector::ControllerAccessory::Type::kRight);
-		TerminalAccessory ta;
-		PXR_OUT_VALUE ControllerAccessory out;
-		terminal_->QueryRemoteControllerAccessory(remote_hmd_id_, handtype, out);
+		ControllerAccessory out;
+		Accessories.GetController(FPICOXRDPAccessorySnapshot::GetCurrentReader(), GetAccessoryFrame(), hand, out);
 		
 		pxr::p_vector3_f position;
 		out.GetPosition_(position);
@@ -320,9 +467,8 @@ bool DP::GetControllerConnectstatus(int hand)
 {
 	if (terminal_)
 	{
-		pxr::connector::ControllerAccessory::Type handtype = (hand == 0 ? pxr::connector::ControllerAccessory::Type::kLeft : pxr::connector::ControllerAccessory::Type::kRight);
 		ControllerAccessory controller;
-		terminal_->QueryRemoteControllerAccessory(remote_hmd_id_, handtype, controller);
+		Accessories.GetController(FPICOXRDPAccessorySnapshot::GetCurrentReader(), GetAccessoryFrame(), hand, controller);
 		return controller.GetIsActive_();
 	}
 	return false;
@@ -332,9 +478,8 @@ uint16 DP::GetControllerButtonStatus(int hand)
 {
 	if (terminal_)
 	{
-		pxr::connector::ControllerAccessory::Type handtype = (hand == 0 ? pxr::connector::ControllerAccessory::Type::kLeft : pxr::connector::ControllerAccessory::Type::kRight);
 		ControllerAccessory controller;
-		terminal_->QueryRemoteControllerAccessory(remote_hmd_id_, handtype, controller);
+		Accessories.GetController(FPICOXRDPAccessorySnapshot::GetCurrentReader(), GetAccessoryFrame(), hand, controller);
 		return controller.GetButtonStatus_();
 	}
 	return uint16();
@@ -344,9 +489,8 @@ void DP::GetControllerAxisValue(int hand, float& JoyStickX, float& JoyStickY, fl
 {
 	if (terminal_)
 	{
-		pxr::connector::ControllerAccessory::Type handtype = (hand == 0 ? pxr::connector::ControllerAccessory::Type::kLeft : pxr::connector::ControllerAccessory::Type::kRight);
 		ControllerAccessory controller;
-		terminal_->QueryRemoteControllerAccessory(remote_hmd_id_, handtype, controller);
+		Accessories.GetController(FPICOXRDPAccessorySnapshot::GetCurrentReader(), GetAccessoryFrame(), hand, controller);
 		if (controller.GetIsActive_())
 		{
 			//Todo: X Y exchanged!
@@ -0,0 +1,99 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPAccessories.h"
+#include "PXR_Log.h"
+
+using namespace pxr;
+using namespace pxr::connector;
+
+void FPICOXRDPAccessorySnapshot::SetTerminal(TerminalInterface* InTerminal, uint32 InTerminalId)
+{
+	FScopeLock ScopeLock(&Lock);
+	Terminal = InTerminal;
+	TerminalId = InTerminalId;
+	TerminalRevision++;
+	for (FReaderSnapshot& Snapshot : Snapshots)
+	{
+		Snapshot = FReaderSnapshot();
+	}
+}
+
+void FPICOXRDPAccessorySnapshot::GetHmd(EPICOXRDPAccessoryReader Reader, uint64 Frame, HmdAccessory& OutHmd)
+{
+	Refresh(Reader, Frame);
+	FScopeLock ScopeLock(&Lock);
+	FReaderSnapshot& Snapshot = Snapshots[(int32)Reader];
+	Snapshot.Accessory.GetHmdAccessory_(OutHmd);
+	Snapshot.FrameReads++;
+	Stats.Reads++;
+}
+
+void FPICOXRDPAccessorySnapshot::GetController(EPICOXRDPAccessoryReader Reader, uint64 Frame, int32 Hand, ControllerAccessory& OutController)
+{
+	Refresh(Reader, Frame);
+	FScopeLock ScopeLock(&Lock);
+	FReaderSnapshot& Snapshot = Snapshots[(int32)Reader];
+	Snapshot.Accessory.GetControllerAccessory_(Hand == 0 ? ControllerAccessory::Type::kLeft : ControllerAccessory::Type::kRight, OutController);
+	Snapshot.FrameReads++;
+	Stats.Reads++;
+}
+
+FPICOXRDPAccessoryStats FPICOXRDPAccessorySnapshot::GetStats() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Stats;
+}
+
+EPICOXRDPAccessoryReader FPICOXRDPAccessorySnapshot::GetCurrentReader()
+{
+	return IsInRenderingThread() && !IsInGameThread() ? EPICOXRDPAccessoryReader::Render : EPICOXRDPAccessoryReader::Game;
+}
+
+void FPICOXRDPAccessorySnapshot::Refresh(EPICOXRDPAccessoryReader Reader, uint64 Frame)
+{
+	TerminalInterface* QueryTerminal = nullptr;
+	uint32 QueryTerminalId = 0;
+	uint32 QueryRevision = 0;
+	{
+		FScopeLock ScopeLock(&Lock);
+		FReaderSnapshot& Snapshot = Snapshots[(int32)Reader];
+		if (Terminal == nullptr || (Snapshot.bHasSnapshot && Frame <= Snapshot.Frame))
+		{
+			return;
+		}
+
+		if (Snapshot.bHasSnapshot)
+		{
+			Stats.LastFrameReads = Snapshot.FrameReads;
+			Stats.PeakFrameReads = FMath::Max(Stats.PeakFrameReads, Snapshot.FrameReads);
+		}
+		Snapshot.FrameReads = 0;
+		Snapshot.Frame = Frame;
+		Snapshot.bHasSnapshot = true;
+		Stats.Frames++;
+		Stats.Queries++;
+		QueryTerminal = Terminal;
+		QueryTerminalId = TerminalId;
+		QueryRevision = TerminalRevision;
+	}
+
+	// The terminal accessory carries the HMD and both controllers, so one round trip covers every read of the frame.
+	TerminalAccessory Fresh;
+	const bool bQueried = QueryTerminal->QueryRemoteTerminalAccessory(QueryTerminalId, Fresh) == IDPInterface::IResult::kOK;
+
+	FScopeLock ScopeLock(&Lock);
+	if (QueryRevision != TerminalRevision)
+	{
+		return;
+	}
+	FReaderSnapshot& Snapshot = Snapshots[(int32)Reader];
+	if (bQueried)
+	{
+		Snapshot.Accessory = Fresh;
+	}
+	else
+	{
+		Stats.FailedQueries++;
+		Snapshot.Accessory = TerminalAccessory();
+	}
+}
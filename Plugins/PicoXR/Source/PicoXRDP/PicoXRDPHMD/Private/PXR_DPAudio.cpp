@@ -0,0 +1,506 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPAudio.h"
+#include "PXR_Log.h"
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+#if PLATFORM_WINDOWS
+#include "streamer_api.h"
+#endif
+
+namespace
+{
+	void WriteLE(uint8*& Out, uint64 Value, int32 Bytes)
+	{
+		for (int32 Index = 0; Index < Bytes; Index++)
+		{
+			*Out++ = (uint8)(Value >> (8 * Index));
+		}
+	}
+
+	uint64 ReadLE(const uint8*& In, int32 Bytes)
+	{
+		uint64 Value = 0;
+		for (int32 Index = 0; Index < Bytes; Index++)
+		{
+			Value |= (uint64)*In++ << (8 * Index);
+		}
+		return Value;
+	}
+
+	/** Source of platforms without the streamer, it never starts. */
+	class FNullAudioSource : public IPICOXRDPAudioSource
+	{
+	public:
+		virtual bool Startup(const FPICOXRDPAudioFormat& Format) override { return false; }
+		virtual void Shutdown() override {}
+		virtual FPICOXRDPAudioFormat GetFormat() const override { return FPICOXRDPAudioFormat(); }
+		virtual bool Capture(TArray<int16>& OutSamples) override { return false; }
+		virtual uint32 GetPeriodMs() const override { return 10; }
+	};
+
+#if PLATFORM_WINDOWS
+	/** The streamer's CaptureInterface, capturing what the PC plays as 16 bit PCM. */
+	class FStreamerAudioSource : public IPICOXRDPAudioSource
+	{
+	public:
+		virtual ~FStreamerAudioSource()
+		{
+			Shutdown();
+		}
+
+		virtual bool Startup(const FPICOXRDPAudioFormat& InFormat) override
+		{
+			Shutdown();
+			AudioCapture = pxr::capture::BuildCapture();
+			if (AudioCapture == nullptr)
+			{
+				PXR_LOGE(PxrUnreal, "Could not build the direct preview audio capture");
+				return false;
+			}
+
+			pxr::capture::CaptureParam Param;
+			Param.format = pxr::IDPInterface::IAudioFormat::kPCM;
+			Param.num_of_channels = InFormat.Channels;
+			Param.bits_per_sample = 16;
+			Param.samples_per_sec = InFormat.SampleRate;
+			if (AudioCapture->Startup(Param) != pxr::IDPInterface::IResult::kOK || !AudioCapture->IsValid())
+			{
+				PXR_LOGE(PxrUnreal, "Could not start the direct preview audio capture: %s", pxr::error::GetLastErrorMessage());
+				pxr::capture::DestroyCapture(&AudioCapture);
+				AudioCapture = nullptr;
+				return false;
+			}
+			Format = InFormat;
+			return true;
+		}
+
+		virtual void Shutdown() override
+		{
+			if (AudioCapture)
+			{
+				AudioCapture->Shutdown();
+				pxr::capture::DestroyCapture(&AudioCapture);
+				AudioCapture = nullptr;
+			}
+		}
+
+		virtual FPICOXRDPAudioFormat GetFormat() const override { return Format; }
+
+		virtual bool Capture(TArray<int16>& OutSamples) override
+		{
+			// Bytes is reused from capture to capture, it only grows with the largest capture.
+			Bytes.clear();
+			if (AudioCapture == nullptr || AudioCapture->Capture(Bytes) != pxr::IDPInterface::IResult::kOK || Bytes.size() < sizeof(int16))
+			{
+				return false;
+			}
+			const int32 Samples = (int32)(Bytes.size() / sizeof(int16));
+			const int32 Start = OutSamples.AddUninitialized(Samples);
+			FMemory::Memcpy(OutSamples.GetData() + Start, Bytes.data(), Samples * sizeof(int16));
+			return true;
+		}
+
+		virtual uint32 GetPeriodMs() const override
+		{
+			return AudioCapture ? AudioCapture->GetPeriod() : 10;
+		}
+
+	private:
+		pxr::capture::CaptureInterface* AudioCapture = nullptr;
+		FPICOXRDPAudioFormat Format;
+		std::vector<uint8> Bytes;
+	};
+#endif
+}
+
+TSharedRef<IPICOXRDPAudioSource, ESPMode::ThreadSafe> IPICOXRDPAudioSource::CreateDefault()
+{
+#if PLATFORM_WINDOWS
+	return MakeShared<FStreamerAudioSource, ESPMode::ThreadSafe>();
+#else
+	return MakeShared<FNullAudioSource, ESPMode::ThreadSafe>();
+#endif
+}
+
+void FPICOXRDPClockDriftEstimator::Reset(double InNominalRate)
+{
+	NominalRate = InNominalRate;
+	Buckets.SetNum(MaxBuckets);
+	FirstBucket = 0;
+	BucketCount = 0;
+	BucketStartTime = 0.0;
+	bHasLast = false;
+	Jitter = 0.0;
+	bHasFit = false;
+}
+
+void FPICOXRDPClockDriftEstimator::AddObservation(double HostTime, uint64 TotalSamples)
+{
+	const FObservation Observation = { HostTime, (double)TotalSamples };
+	if (bHasLast)
+	{
+		const double Transit = (HostTime - Last.HostTime) - (Observation.Sample - Last.Sample) / NominalRate;
+		Jitter += (FMath::Abs(Transit) - Jitter) / 16.0;
+	}
+	Last = Observation;
+	bHasLast = true;
+
+	// The least delayed capture of each bucket is the closest to when its samples were really captured.
+	if (BucketCount == 0 || HostTime - BucketStartTime >= BucketSeconds)
+	{
+		if (BucketCount == MaxBuckets)
+		{
+			FirstBucket = (FirstBucket + 1) % MaxBuckets;
+			BucketCount--;
+		}
+		Buckets[(FirstBucket + BucketCount) % MaxBuckets] = Observation;
+		BucketCount++;
+		BucketStartTime = HostTime;
+	}
+	else
+	{
+		FObservation& Best = Buckets[(FirstBucket + BucketCount - 1) % MaxBuckets];
+		if (Observation.HostTime - Observation.Sample / NominalRate < Best.HostTime - Best.Sample / NominalRate)
+		{
+			Best = Observation;
+		}
+	}
+
+	if (BucketCount >= MinBuckets)
+	{
+		Fit();
+	}
+}
+
+void FPICOXRDPClockDriftEstimator::Fit()
+{
+	// Least squares relative to the oldest bucket, the absolute values would cost the doubles their precision.
+	const FObservation& First = Buckets[FirstBucket];
+	double SumX = 0.0, SumY = 0.0, SumXX = 0.0, SumXY = 0.0;
+	for (int32 Index = 0; Index < BucketCount; Index++)
+	{
+		const FObservation& Observation = Buckets[(FirstBucket + Index) % MaxBuckets];
+		const double X = Observation.Sample - First.Sample;
+		const double Y = Observation.HostTime - First.HostTime;
+		SumX += X;
+		SumY += Y;
+		SumXX += X * X;
+		SumXY += X * Y;
+	}
+	const double Denominator = BucketCount * SumXX - SumX * SumX;
+	if (Denominator <= 0.0)
+	{
+		return;
+	}
+	const double NewSlope = (BucketCount * SumXY - SumX * SumY) / Denominator;
+	if (NewSlope <= 0.0)
+	{
+		return;
+	}
+	Slope = NewSlope;
+	Origin = First.Sample;
+	Intercept = First.HostTime + (SumY - Slope * SumX) / BucketCount;
+	bHasFit = true;
+}
+
+double FPICOXRDPClockDriftEstimator::GetRate() const
+{
+	return bHasFit ? 1.0 / Slope : NominalRate;
+}
+
+double FPICOXRDPClockDriftEstimator::SampleToHostTime(double Sample) const
+{
+	if (bHasFit)
+	{
+		return Intercept + Slope * (Sample - Origin);
+	}
+	if (BucketCount > 0)
+	{
+		const FObservation& Best = Buckets[(FirstBucket + BucketCount - 1) % MaxBuckets];
+		return Best.HostTime - (Best.Sample - Sample) / NominalRate;
+	}
+	return 0.0;
+}
+
+void FPICOXRDPAudioResampler::Initialize(double InInputRate, int32 InOutputRate, int32 InInputChannels, int32 InOutputChannels)
+{
+	OutputRate = InOutputRate;
+	InputChannels = FMath::Max(InInputChannels, 1);
+	OutputChannels = FMath::Clamp(InOutputChannels, 1, 2);
+	SetInputRate(InInputRate);
+	Position = 1.0;
+	Consumed = 0.0;
+	Previous[0] = Previous[1] = 0;
+}
+
+void FPICOXRDPAudioResampler::Process(const int16* In, int32 InFrames, TArray<int16>& Out)
+{
+	if (InFrames <= 0)
+	{
+		return;
+	}
+
+	// Frame 0 is the last frame of the previous input, frame K the input frame K - 1.
+	while ((int32)Position < InFrames)
+	{
+		const int32 Index = (int32)Position;
+		const double Fraction = Position - Index;
+		for (int32 Channel = 0; Channel < OutputChannels; Channel++)
+		{
+			const int32 Source = FMath::Min(Channel, InputChannels - 1);
+			const double A = Index == 0 ? Previous[Channel] : In[(Index - 1) * InputChannels + Source];
+			const double B = In[Index * InputChannels + Source];
+			Out.Add((int16)FMath::RoundToInt(A + (B - A) * Fraction));
+		}
+		Position += Step;
+	}
+
+	Position -= InFrames;
+	Consumed += InFrames;
+	for (int32 Channel = 0; Channel < OutputChannels; Channel++)
+	{
+		Previous[Channel] = In[(InFrames - 1) * InputChannels + FMath::Min(Channel, InputChannels - 1)];
+	}
+}
+
+void FPICOXRDPAudioChunkHeader::Write(uint8* Out) const
+{
+	WriteLE(Out, Version, 1);
+	WriteLE(Out, Channels, 1);
+	WriteLE(Out, Frames, 2);
+	WriteLE(Out, SampleRate, 4);
+	WriteLE(Out, FirstFrame, 8);
+	WriteLE(Out, VideoFrame, 4);
+	WriteLE(Out, (uint32)VideoFrameOffsetUs, 4);
+	WriteLE(Out, (uint32)DriftPpm, 4);
+	WriteLE(Out, JitterUs, 4);
+}
+
+bool FPICOXRDPAudioChunkHeader::Read(const uint8* In, uint32 Length)
+{
+	if (In == nullptr || Length < Size || In[0] != Version)
+	{
+		return false;
+	}
+	In++;
+	Channels = (uint8)ReadLE(In, 1);
+	Frames = (uint16)ReadLE(In, 2);
+	SampleRate = (uint32)ReadLE(In, 4);
+	FirstFrame = ReadLE(In, 8);
+	VideoFrame = (uint32)ReadLE(In, 4);
+	VideoFrameOffsetUs = (int32)(uint32)ReadLE(In, 4);
+	DriftPpm = (int32)(uint32)ReadLE(In, 4);
+	JitterUs = (uint32)ReadLE(In, 4);
+	return true;
+}
+
+FPICOXRDPAudioStreamer::FPICOXRDPAudioStreamer(TSharedPtr<IPICOXRDPAudioSource, ESPMode::ThreadSafe> InSource,
+	TSharedPtr<IPICOXRDPTunnel, ESPMode::ThreadSafe> InTunnel, TFunction<double()> InClock)
+	: Source(InSource.IsValid() ? InSource.ToSharedRef() : IPICOXRDPAudioSource::CreateDefault())
+	, Clock(InClock)
+	, Sender(InTunnel, InClock)
+	, bStopping(false)
+{
+}
+
+FPICOXRDPAudioStreamer::~FPICOXRDPAudioStreamer()
+{
+	Shutdown();
+}
+
+bool FPICOXRDPAudioStreamer::Startup(const FPICOXRDPAudioSettings& InSettings, bool bThreaded)
+{
+	Shutdown();
+
+	Settings = InSettings;
+	Settings.Format.Channels = FMath::Clamp(Settings.Format.Channels, 1, 2);
+	Settings.ChunkPoolSize = FMath::Max(Settings.ChunkPoolSize, 1);
+	FramesPerChunk = Settings.Format.SampleRate * Settings.ChunkMs / 1000;
+	if (FramesPerChunk <= 0 || FramesPerChunk > 0xFFFF)
+	{
+		PXR_LOGE(PxrUnreal, "Direct preview audio chunks of %d ms at %d Hz are not supported", Settings.ChunkMs, Settings.Format.SampleRate);
+		return false;
+	}
+	if (!Source->Startup(Settings.Format))
+	{
+		return false;
+	}
+	SourceFormat = Source->GetFormat();
+	// The tunnel takes the samples per packet as its rate.
+	Settings.Tunnel.Config.Rate = FramesPerChunk;
+	if (SourceFormat.SampleRate <= 0 || SourceFormat.Channels <= 0 || !Sender.Startup(Settings.Tunnel))
+	{
+		Source->Shutdown();
+		return false;
+	}
+
+	Drift.Reset(SourceFormat.SampleRate);
+	Resampler.Initialize(SourceFormat.SampleRate, Settings.Format.SampleRate, SourceFormat.Channels, Settings.Format.Channels);
+	// A second of capture and a few chunks of output, captures and chunks only allocate beyond that.
+	Captured.Reset(SourceFormat.SampleRate * SourceFormat.Channels);
+	Pending.Reset(FramesPerChunk * Settings.Format.Channels * 8);
+	PendingInputPosition = 0.0;
+	CapturedFrames = 0;
+	ChunkedFrames = 0;
+	ChunkSequence = 0;
+	Chunks.Reset();
+	Chunks.SetNum(Settings.ChunkPoolSize);
+	for (FChunkBuffer& Chunk : Chunks)
+	{
+		Chunk.Data.SetNumUninitialized(FPICOXRDPAudioChunkHeader::Size + FramesPerChunk * Settings.Format.Channels * sizeof(int16));
+	}
+	{
+		FScopeLock ScopeLock(&Lock);
+		Stats = FPICOXRDPAudioStats();
+	}
+	bRunning = true;
+
+	if (bThreaded)
+	{
+		bStopping = false;
+		StopEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Thread = FRunnableThread::Create(this, TEXT("PICOXRDPAudio"), 0, TPri_AboveNormal);
+	}
+	return true;
+}
+
+void FPICOXRDPAudioStreamer::Shutdown()
+{
+	if (!bRunning)
+	{
+		return;
+	}
+	Stop();
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	if (StopEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(StopEvent);
+		StopEvent = nullptr;
+	}
+	Sender.Shutdown();
+	Source->Shutdown();
+	bRunning = false;
+}
+
+bool FPICOXRDPAudioStreamer::CaptureOnce()
+{
+	Captured.Reset();
+	if (!bRunning || !Source->Capture(Captured) || Captured.Num() < SourceFormat.Channels)
+	{
+		Sender.Pump();
+		return false;
+	}
+
+	const double Time = Now();
+	const int32 Frames = Captured.Num() / SourceFormat.Channels;
+	CapturedFrames += Frames;
+	Drift.AddObservation(Time, CapturedFrames);
+	if (Settings.bCompensateDrift && Drift.HasEstimate())
+	{
+		Resampler.SetInputRate(Drift.GetRate());
+	}
+
+	if (Pending.Num() == 0)
+	{
+		PendingInputPosition = Resampler.GetNextInputPosition();
+	}
+	Resampler.Process(Captured.GetData(), Frames, Pending);
+	SendChunks();
+	Sender.Pump();
+
+	FScopeLock ScopeLock(&Lock);
+	Stats.Captures++;
+	Stats.CapturedFrames = CapturedFrames;
+	Stats.DriftPpm = Drift.GetDriftPpm();
+	Stats.Jitter = Drift.GetJitter();
+	return true;
+}
+
+void FPICOXRDPAudioStreamer::SendChunks()
+{
+	const int32 ChunkSamples = FramesPerChunk * Settings.Format.Channels;
+	int32 Offset = 0;
+	while (Pending.Num() - Offset >= ChunkSamples)
+	{
+		const double CaptureTime = Drift.SampleToHostTime(PendingInputPosition);
+		const int32 Index = Chunks.IndexOfByPredicate([](const FChunkBuffer& Chunk) { return Chunk.bFree; });
+		bool bQueued = false;
+		if (Index != INDEX_NONE)
+		{
+			FPICOXRDPAudioChunkHeader Header;
+			Header.Channels = (uint8)Settings.Format.Channels;
+			Header.Frames = (uint16)FramesPerChunk;
+			Header.SampleRate = Settings.Format.SampleRate;
+			Header.FirstFrame = ChunkedFrames;
+			Header.DriftPpm = (int32)Drift.GetDriftPpm();
+			Header.JitterUs = (uint32)(Drift.GetJitter() * 1000000.0);
+			{
+				FScopeLock ScopeLock(&Lock);
+				Header.VideoFrame = VideoFrame;
+				Header.VideoFrameOffsetUs = (int32)FMath::RoundToDouble((CaptureTime - VideoFrameTime) * 1000000.0);
+			}
+
+			// The PCM goes out as it is in memory, every platform the plugin runs on is little endian.
+			FChunkBuffer& Chunk = Chunks[Index];
+			Header.Write(Chunk.Data.GetData());
+			FMemory::Memcpy(Chunk.Data.GetData() + FPICOXRDPAudioChunkHeader::Size, Pending.GetData() + Offset, ChunkSamples * sizeof(int16));
+			Chunk.bFree = false;
+			bQueued = Sender.QueueFrame(Chunk.Data.GetData(), Chunk.Data.Num(), ChunkSequence, CaptureTime, false, [this, Index]() { Chunks[Index].bFree = true; });
+		}
+
+		{
+			FScopeLock ScopeLock(&Lock);
+			Stats.Chunks += bQueued ? 1 : 0;
+			Stats.DroppedChunks += bQueued ? 0 : 1;
+		}
+		// A dropped chunk still takes its sequence number and frames, the remote sees the gap.
+		ChunkSequence++;
+		ChunkedFrames += FramesPerChunk;
+		PendingInputPosition += FramesPerChunk * Resampler.GetStep();
+		Offset += ChunkSamples;
+	}
+	if (Offset > 0)
+	{
+		Pending.RemoveAt(0, Offset, false);
+	}
+}
+
+void FPICOXRDPAudioStreamer::SetVideoFrame(uint32 FrameNumber, double Time)
+{
+	FScopeLock ScopeLock(&Lock);
+	VideoFrame = FrameNumber;
+	VideoFrameTime = Time;
+}
+
+FPICOXRDPAudioStats FPICOXRDPAudioStreamer::GetStats() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Stats;
+}
+
+uint32 FPICOXRDPAudioStreamer::Run()
+{
+	while (!bStopping)
+	{
+		if (!CaptureOnce())
+		{
+			StopEvent->Wait(FMath::Max(Source->GetPeriodMs(), 1u));
+		}
+	}
+	return 0;
+}
+
+void FPICOXRDPAudioStreamer::Stop()
+{
+	bStopping = true;
+	if (StopEvent)
+	{
+		StopEvent->Trigger();
+	}
+}
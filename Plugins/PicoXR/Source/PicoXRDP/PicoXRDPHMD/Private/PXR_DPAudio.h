@@ -0,0 +1,243 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "PXR_DPTunnel.h"
+
+class FRunnableThread;
+class FEvent;
+
+/** Interleaved 16 bit PCM. */
+struct FPICOXRDPAudioFormat
+{
+	int32 SampleRate = 48000;
+	int32 Channels = 2;
+};
+
+/**
+ * Audio the streamer sends. The default one wraps the streamer's CaptureInterface, which captures what the PC plays.
+ * A synthetic source can be set instead.
+ */
+class IPICOXRDPAudioSource
+{
+public:
+	virtual ~IPICOXRDPAudioSource() {}
+
+	/** Format is what is asked for, GetFormat what the source delivers. */
+	virtual bool Startup(const FPICOXRDPAudioFormat& Format) = 0;
+	virtual void Shutdown() = 0;
+	virtual FPICOXRDPAudioFormat GetFormat() const = 0;
+
+	/** Appends the samples captured since the last call. @return false if none are ready yet. */
+	virtual bool Capture(TArray<int16>& OutSamples) = 0;
+
+	/** Milliseconds between captures. */
+	virtual uint32 GetPeriodMs() const = 0;
+
+	static TSharedRef<IPICOXRDPAudioSource, ESPMode::ThreadSafe> CreateDefault();
+};
+
+/**
+ * Measures the rate the capture device really runs at on the host clock, and when each of its samples was captured.
+ * Captures arrive late by a varying amount, so each quarter second keeps only its least delayed capture, and a line
+ * fitted through those over the last seconds gives the rate and the time of any sample.
+ */
+class FPICOXRDPClockDriftEstimator
+{
+public:
+	void Reset(double InNominalRate);
+
+	/** TotalSamples had been captured when the capture returned at HostTime. */
+	void AddObservation(double HostTime, uint64 TotalSamples);
+
+	/** Measured samples per second of the host clock, the nominal rate until enough was observed. */
+	double GetRate() const;
+	double GetDriftPpm() const { return (GetRate() / NominalRate - 1.0) * 1000000.0; }
+
+	/** Interarrival jitter of the captures in seconds, as RTP computes it. */
+	double GetJitter() const { return Jitter; }
+
+	/** Host time Sample was captured at. */
+	double SampleToHostTime(double Sample) const;
+
+	bool HasEstimate() const { return bHasFit; }
+
+private:
+	struct FObservation
+	{
+		double HostTime;
+		double Sample;
+	};
+
+	void Fit();
+
+	// Seconds per bucket, and buckets the fit spans.
+	static constexpr double BucketSeconds = 0.25;
+	static const int32 MaxBuckets = 64;
+	static const int32 MinBuckets = 8;
+
+	double NominalRate = 48000.0;
+	TArray<FObservation> Buckets;
+	int32 FirstBucket = 0;
+	int32 BucketCount = 0;
+	double BucketStartTime = 0.0;
+	FObservation Last = { 0.0, 0.0 };
+	bool bHasLast = false;
+	double Jitter = 0.0;
+	// HostTime = Intercept + Slope * (Sample - Origin) once fitted.
+	double Origin = 0.0;
+	double Intercept = 0.0;
+	double Slope = 0.0;
+	bool bHasFit = false;
+};
+
+/**
+ * Linear interpolating resampler with its position carried from call to call. Mono is spread to both channels,
+ * channels beyond the output ones are dropped.
+ */
+class FPICOXRDPAudioResampler
+{
+public:
+	void Initialize(double InInputRate, int32 InOutputRate, int32 InInputChannels, int32 InOutputChannels);
+
+	/** Follows the rate the input really runs at, so the output keeps the output rate of the host clock. */
+	void SetInputRate(double InInputRate) { Step = InInputRate / OutputRate; }
+	double GetStep() const { return Step; }
+
+	/** Input sample the next output frame is read at, counted from the first input sample. */
+	double GetNextInputPosition() const { return Consumed + Position - 1.0; }
+
+	/** Appends the output of InFrames input frames to Out. */
+	void Process(const int16* In, int32 InFrames, TArray<int16>& Out);
+
+private:
+	int32 OutputRate = 48000;
+	int32 InputChannels = 2;
+	int32 OutputChannels = 2;
+	double Step = 1.0;
+	// Read position, 0 being the last frame of the previous input and 1 the first frame of the next.
+	double Position = 1.0;
+	double Consumed = 0.0;
+	int16 Previous[2] = { 0, 0 };
+};
+
+/** Metadata in front of the PCM of every chunk, for the remote's jitter buffer. Written little endian. */
+struct FPICOXRDPAudioChunkHeader
+{
+	static const uint8 Version = 1;
+	static const uint32 Size = 32;
+
+	uint8 Channels = 0;
+	uint16 Frames = 0;
+	uint32 SampleRate = 0;
+	// First output frame of the chunk, counted since startup. A gap is a lost chunk.
+	uint64 FirstFrame = 0;
+	// Video frame reported last before the chunk, and the chunk's capture time relative to it.
+	uint32 VideoFrame = 0;
+	int32 VideoFrameOffsetUs = 0;
+	// Measured capture clock drift and capture jitter, to size the jitter buffer by.
+	int32 DriftPpm = 0;
+	uint32 JitterUs = 0;
+
+	void Write(uint8* Out) const;
+	bool Read(const uint8* In, uint32 Length);
+};
+
+struct FPICOXRDPAudioSettings
+{
+	// Format sent, whatever the source captures.
+	FPICOXRDPAudioFormat Format;
+	int32 ChunkMs = 10;
+	// Chunks queued in the tunnel at most, beyond them chunks are dropped.
+	int32 ChunkPoolSize = 16;
+	// Resample by the measured capture rate rather than the nominal one.
+	bool bCompensateDrift = true;
+	FPICOXRDPTunnelSenderSettings Tunnel;
+
+	FPICOXRDPAudioSettings()
+	{
+		Tunnel.Config.Type = EPICOXRDPTunnelType::RtpAudio;
+		Tunnel.Stream = 1;
+		Tunnel.PoolSize = 64;
+	}
+};
+
+struct FPICOXRDPAudioStats
+{
+	uint64 Captures = 0;
+	uint64 CapturedFrames = 0;
+	uint64 Chunks = 0;
+	// Chunks dropped with every pooled chunk still queued in the tunnel.
+	uint64 DroppedChunks = 0;
+	double DriftPpm = 0.0;
+	double Jitter = 0.0;
+};
+
+/**
+ * Captures audio on a worker thread, resamples it to the output format, cuts it into chunks of a fixed period and
+ * sends them through a tunnel sender of its own. Each chunk carries the host time of its first sample, the clock video
+ * frames are stamped with, and the video frame it falls after, so the remote can play it in sync with the picture.
+ * Chunks come from a fixed pool and go back to it once sent.
+ */
+class FPICOXRDPAudioStreamer : public FRunnable
+{
+public:
+	/** nullptr uses the default source and tunnel. Clock returns seconds, FPlatformTime::Seconds if unset. */
+	explicit FPICOXRDPAudioStreamer(TSharedPtr<IPICOXRDPAudioSource, ESPMode::ThreadSafe> InSource = nullptr,
+		TSharedPtr<IPICOXRDPTunnel, ESPMode::ThreadSafe> InTunnel = nullptr, TFunction<double()> InClock = nullptr);
+	virtual ~FPICOXRDPAudioStreamer();
+
+	/** Starts the source and the tunnel, and the worker thread if bThreaded. Without it CaptureOnce has to be called. */
+	bool Startup(const FPICOXRDPAudioSettings& InSettings, bool bThreaded = true);
+	void Shutdown();
+
+	/** Captures, chunks and sends what the source has. @return false if it had nothing. */
+	bool CaptureOnce();
+
+	/** Reports the video frame captured at Time, in seconds of the clock. Any thread. */
+	void SetVideoFrame(uint32 FrameNumber, double Time);
+
+	FPICOXRDPAudioStats GetStats() const;
+
+	// FRunnable, the worker thread
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FChunkBuffer
+	{
+		TArray<uint8> Data;
+		bool bFree = true;
+	};
+
+	double Now() const { return Clock ? Clock() : FPlatformTime::Seconds(); }
+	void SendChunks();
+
+	TSharedRef<IPICOXRDPAudioSource, ESPMode::ThreadSafe> Source;
+	TFunction<double()> Clock;
+	FPICOXRDPTunnelSender Sender;
+	FPICOXRDPAudioSettings Settings;
+	FPICOXRDPAudioFormat SourceFormat;
+	int32 FramesPerChunk = 0;
+
+	FPICOXRDPClockDriftEstimator Drift;
+	FPICOXRDPAudioResampler Resampler;
+	TArray<int16> Captured;
+	// Resampled frames not yet in a chunk, and the input position of the first of them.
+	TArray<int16> Pending;
+	double PendingInputPosition = 0.0;
+	uint64 CapturedFrames = 0;
+	uint64 ChunkedFrames = 0;
+	uint32 ChunkSequence = 0;
+	TArray<FChunkBuffer> Chunks;
+
+	mutable FCriticalSection Lock;
+	FPICOXRDPAudioStats Stats;
+	uint32 VideoFrame = 0;
+	double VideoFrameTime = 0.0;
+
+	FRunnableThread* Thread = nullptr;
+	FEvent* StopEvent = nullptr;
+	TAtomic<bool> bStopping;
+	bool bRunning = false;
+};
@@ -0,0 +1,453 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPConnection.h"
+#include "PXR_Log.h"
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+#if PLATFORM_WINDOWS
+#include "streamer_api.h"
+#endif
+
+const TCHAR* LexToString(EPICOXRDPConnectionState State)
+{
+	switch (State)
+	{
+	case EPICOXRDPConnectionState::Disconnected:
+		return TEXT("Disconnected");
+	case EPICOXRDPConnectionState::Connecting:
+		return TEXT("Connecting");
+	case EPICOXRDPConnectionState::Registering:
+		return TEXT("Registering");
+	case EPICOXRDPConnectionState::Connected:
+		return TEXT("Connected");
+	case EPICOXRDPConnectionState::Backoff:
+		return TEXT("Backoff");
+	}
+	return TEXT("Unknown");
+}
+
+namespace
+{
+#if PLATFORM_WINDOWS
+	using namespace pxr;
+	using namespace pxr::connector;
+
+	/**
+	 * The streamer's terminal on the local runtime. It is registered anew every time the link is opened, a restarted
+	 * streamer does not know the terminal of the one before.
+	 * The heartbeat is the query of the runtime's id, which only answers while the runtime does.
+	 */
+	class FConnectorLink : public IPICOXRDPConnectionLink
+	{
+	public:
+		virtual ~FConnectorLink()
+		{
+			Close();
+		}
+
+		virtual bool Open() override
+		{
+			if (!bLoaded)
+			{
+				const FString StreamerDLLDir = FPaths::ProjectPluginsDir() / FString::Printf(TEXT("PICOXR/Libs/Win64/"));
+				FPlatformProcess::PushDllDirectory(*StreamerDLLDir);
+				FPlatformProcess::GetDllHandle(*(StreamerDLLDir + "pxr_turtledove.dll"));
+				FPlatformProcess::PopDllDirectory(*StreamerDLLDir);
+				PXR_LOGD(PxrUnreal, "PXR_DP DLL Path:%s", *StreamerDLLDir);
+				bLoaded = true;
+			}
+			if (!Terminal)
+			{
+				Terminal = RegisterAsTerminal();
+				if (!Terminal)
+				{
+					return false;
+				}
+			}
+
+			const IDPInterface::IResult ConnectResult = Terminal->ConnectToHost("127.0.0.1", "50051");
+			if (ConnectResult != IDPInterface::IResult::kOK && ConnectResult != IDPInterface::IResult::kAlreadyConnected)
+			{
+				return false;
+			}
+			PXR_LOGD(PxrUnreal, "PXR_DP Connect to PICO Runtime OK 127.0.0.1:50051");
+
+			TerminalInfo MyInfo;
+			MyInfo.SetTerminalType_(TerminalInfo::Type::kDriver);
+			MyInfo.SetIp_("127.0.0.1");
+			const IDPInterface::IResult HelloResult = Terminal->Hello(MyInfo);
+			if (HelloResult != IDPInterface::IResult::kOK && HelloResult != IDPInterface::IResult::kAlreadyHelloed)
+			{
+				return false;
+			}
+			PXR_LOGD(PxrUnreal, "PXR_DP Hello OK!");
+			bHelloed = true;
+			return true;
+		}
+
+		virtual bool QueryIds(uint32& OutRuntimeId, uint32& OutHmdId) override
+		{
+			if (!Terminal || Terminal->QueryRemoteTerminalId(TerminalInfo::Type::kRuntime, OutRuntimeId) != IDPInterface::IResult::kOK)
+			{
+				return false;
+			}
+			if (Terminal->QueryRemoteTerminalId(TerminalInfo::Type::kHmdWireless, OutHmdId) != IDPInterface::IResult::kOK)
+			{
+				OutHmdId = 0;
+			}
+			return true;
+		}
+
+		virtual bool QueryHmdAddress(uint32 HmdId, uint8 OutIp[4]) override
+		{
+			TerminalInfo Info;
+			if (!Terminal || Terminal->QueryRemoteTerminal(HmdId, Info) != IDPInterface::IResult::kOK)
+			{
+				return false;
+			}
+			uint32 Parts[4];
+			if (sscanf_s(Info.GetIp_().c_str(), "%u.%u.%u.%u", &Parts[0], &Parts[1], &Parts[2], &Parts[3]) != 4)
+			{
+				return false;
+			}
+			for (int32 Part = 0; Part < 4; Part++)
+			{
+				OutIp[Part] = (uint8)Parts[Part];
+			}
+			return true;
+		}
+
+		virtual void Close() override
+		{
+			if (Terminal)
+			{
+				if (bHelloed)
+				{
+					Terminal->Bye();
+				}
+				Terminal->DisconnectFromHost();
+				UnregisterTerminal(&Terminal);
+				Terminal = nullptr;
+			}
+			bHelloed = false;
+		}
+
+		virtual TerminalInterface* GetTerminal() const override
+		{
+			return Terminal;
+		}
+
+	private:
+		TerminalInterface* Terminal = nullptr;
+		bool bLoaded = false;
+		bool bHelloed = false;
+	};
+#else
+	/** There is no streamer to link to. */
+	class FNullLink : public IPICOXRDPConnectionLink
+	{
+	public:
+		virtual bool Open() override { return false; }
+		virtual bool QueryIds(uint32& OutRuntimeId, uint32& OutHmdId) override { return false; }
+		virtual void Close() override {}
+	};
+#endif
+}
+
+TSharedRef<IPICOXRDPConnectionLink, ESPMode::ThreadSafe> IPICOXRDPConnectionLink::CreateDefault()
+{
+#if PLATFORM_WINDOWS
+	return MakeShared<FConnectorLink, ESPMode::ThreadSafe>();
+#else
+	return MakeShared<FNullLink, ESPMode::ThreadSafe>();
+#endif
+}
+
+FPICOXRDPConnection::FPICOXRDPConnection(TSharedPtr<IPICOXRDPConnectionLink, ESPMode::ThreadSafe> InLink, TFunction<double()> InClock)
+	: Link(InLink.IsValid() ? InLink.ToSharedRef() : IPICOXRDPConnectionLink::CreateDefault())
+	, Clock(InClock)
+	, bStopping(false)
+{
+}
+
+FPICOXRDPConnection::~FPICOXRDPConnection()
+{
+	// Whoever listened may already be gone
+	StateChanged.Clear();
+	Shutdown();
+}
+
+void FPICOXRDPConnection::SetSettings(const FPICOXRDPConnectionSettings& InSettings)
+{
+	Settings = InSettings;
+	Settings.HeartbeatInterval = FMath::Max(Settings.HeartbeatInterval, 0.0);
+	Settings.MaxMissedHeartbeats = FMath::Max(Settings.MaxMissedHeartbeats, 1);
+	Settings.InitialBackoff = FMath::Max(Settings.InitialBackoff, 0.0);
+	Settings.MaxBackoff = FMath::Max(Settings.MaxBackoff, Settings.InitialBackoff);
+}
+
+void FPICOXRDPConnection::Startup(bool bThreaded)
+{
+	if (State != EPICOXRDPConnectionState::Disconnected)
+	{
+		return;
+	}
+
+	Attempt = 0;
+	Backoff = 0.0;
+	bCloseDue = false;
+	Job = FJob();
+	if (bThreaded)
+	{
+		bStopping = false;
+		WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Thread = FRunnableThread::Create(this, TEXT("PICOXRDPConnection"), 0, TPri_BelowNormal);
+	}
+	SetState(EPICOXRDPConnectionState::Connecting);
+}
+
+void FPICOXRDPConnection::Shutdown()
+{
+	if (State == EPICOXRDPConnectionState::Disconnected)
+	{
+		return;
+	}
+
+	// The listeners let go of the terminal first, then the link thread finishes the call it is in
+	SetState(EPICOXRDPConnectionState::Disconnected);
+	Stop();
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	if (WorkEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		WorkEvent = nullptr;
+	}
+	Job = FJob();
+	bCloseDue = false;
+	Link->Close();
+	RuntimeId = 0;
+	HmdId = 0;
+	bHasHmdAddress = false;
+}
+
+bool FPICOXRDPConnection::GetHmdAddress(uint8 OutIp[4]) const
+{
+	if (!IsConnected() || !bHasHmdAddress)
+	{
+		return false;
+	}
+	FMemory::Memcpy(OutIp, HmdAddress, sizeof(HmdAddress));
+	return true;
+}
+
+void FPICOXRDPConnection::Tick()
+{
+	// Without the link thread the jobs run one after the other, but one attempt to open is enough for a tick
+	const double Time = Now();
+	bool bOpened = false;
+	while (CompleteJob(Time))
+	{
+		const EJob Next = DueJob(Time);
+		if (Next == EJob::None || (Next == EJob::Open && bOpened))
+		{
+			break;
+		}
+		bOpened |= Next == EJob::Open;
+		PostJob(Next);
+	}
+}
+
+uint32 FPICOXRDPConnection::Run()
+{
+	while (!bStopping)
+	{
+		WorkEvent->Wait();
+		FJob Current;
+		{
+			FScopeLock ScopeLock(&JobLock);
+			Current = Job;
+		}
+		if (bStopping || Current.Type == EJob::None || Current.bDone)
+		{
+			continue;
+		}
+
+		RunJob(*Link, Current);
+		FScopeLock ScopeLock(&JobLock);
+		Job = Current;
+	}
+	return 0;
+}
+
+void FPICOXRDPConnection::Stop()
+{
+	bStopping = true;
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
+
+void FPICOXRDPConnection::SetState(EPICOXRDPConnectionState NewState)
+{
+	if (NewState == State)
+	{
+		return;
+	}
+	const EPICOXRDPConnectionState OldState = State;
+	State = NewState;
+	PXR_LOGD(PxrUnreal, "PXR_DP connection %s -> %s", LexToString(OldState), LexToString(NewState));
+	StateChanged.Broadcast(OldState, NewState);
+}
+
+void FPICOXRDPConnection::Retry(double Time)
+{
+	Attempt++;
+	Backoff = FMath::Min(Settings.InitialBackoff * FMath::Pow(2.0f, (float)FMath::Min(Attempt - 1, 16)), Settings.MaxBackoff);
+	RetryTime = Time + Backoff;
+	// The listeners let go of the terminal before the link closes under them
+	SetState(EPICOXRDPConnectionState::Backoff);
+	bCloseDue = true;
+	RuntimeId = 0;
+	HmdId = 0;
+	bHasHmdAddress = false;
+}
+
+void FPICOXRDPConnection::PostJob(EJob Type)
+{
+	FJob NewJob;
+	NewJob.Type = Type;
+	NewJob.KnownHmdId = HmdId;
+	if (!Thread)
+	{
+		RunJob(*Link, NewJob);
+	}
+	{
+		FScopeLock ScopeLock(&JobLock);
+		Job = NewJob;
+	}
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
+
+void FPICOXRDPConnection::RunJob(IPICOXRDPConnectionLink& InLink, FJob& InJob)
+{
+	switch (InJob.Type)
+	{
+	case EJob::Open:
+		InJob.bResult = InLink.Open();
+		break;
+	case EJob::QueryIds:
+		InJob.bResult = InLink.QueryIds(InJob.RuntimeId, InJob.HmdId);
+		if (InJob.bResult && InJob.HmdId != 0 && InJob.HmdId != InJob.KnownHmdId)
+		{
+			InJob.bHasHmdAddress = InLink.QueryHmdAddress(InJob.HmdId, InJob.HmdAddress);
+		}
+		break;
+	case EJob::Close:
+		InLink.Close();
+		InJob.bResult = true;
+		break;
+	default:
+		break;
+	}
+	InJob.bDone = true;
+}
+
+bool FPICOXRDPConnection::CompleteJob(double Time)
+{
+	FJob Done;
+	{
+		FScopeLock ScopeLock(&JobLock);
+		if (Job.Type != EJob::None && !Job.bDone)
+		{
+			return false;
+		}
+		Done = Job;
+		Job = FJob();
+	}
+
+	if (Done.Type == EJob::Open)
+	{
+		if (!Done.bResult)
+		{
+			Stats.FailedAttempts++;
+			Retry(Time);
+			return true;
+		}
+		MissedHeartbeats = 0;
+		NextHeartbeat = Time;
+		SetState(EPICOXRDPConnectionState::Registering);
+	}
+	else if (Done.Type == EJob::QueryIds)
+	{
+		if (!Done.bResult)
+		{
+			Stats.MissedHeartbeats++;
+			if (++MissedHeartbeats >= Settings.MaxMissedHeartbeats)
+			{
+				PXR_LOGW(PxrUnreal, "PXR_DP the runtime missed %d heartbeats, reconnecting", MissedHeartbeats);
+				Stats.Drops++;
+				Retry(Time);
+			}
+			return true;
+		}
+		MissedHeartbeats = 0;
+
+		const bool bHasHmd = Done.HmdId != 0;
+		if (State == EPICOXRDPConnectionState::Connected && (!bHasHmd || Done.RuntimeId != RuntimeId || Done.HmdId != HmdId))
+		{
+			// The headset went away or came back as another terminal, whoever used the old ids lets go of them first
+			PXR_LOGI(PxrUnreal, "PXR_DP the headset changed, registering again");
+			SetState(EPICOXRDPConnectionState::Registering);
+			RuntimeId = 0;
+			HmdId = 0;
+			bHasHmdAddress = false;
+		}
+		if (State == EPICOXRDPConnectionState::Registering && bHasHmd)
+		{
+			RuntimeId = Done.RuntimeId;
+			HmdId = Done.HmdId;
+			bHasHmdAddress = Done.bHasHmdAddress;
+			FMemory::Memcpy(HmdAddress, Done.HmdAddress, sizeof(HmdAddress));
+			Attempt = 0;
+			Backoff = 0.0;
+			Stats.Connects++;
+			PXR_LOGI(PxrUnreal, "PXR_DP connected, runtime:%d headset:%d", RuntimeId, HmdId);
+			SetState(EPICOXRDPConnectionState::Connected);
+		}
+	}
+	return true;
+}
+
+FPICOXRDPConnection::EJob FPICOXRDPConnection::DueJob(double Time)
+{
+	if (bCloseDue)
+	{
+		bCloseDue = false;
+		return EJob::Close;
+	}
+	if (State == EPICOXRDPConnectionState::Backoff && Time >= RetryTime)
+	{
+		SetState(EPICOXRDPConnectionState::Connecting);
+	}
+	if (State == EPICOXRDPConnectionState::Connecting)
+	{
+		return EJob::Open;
+	}
+	if ((State == EPICOXRDPConnectionState::Registering || State == EPICOXRDPConnectionState::Connected) && Time >= NextHeartbeat)
+	{
+		NextHeartbeat = Time + Settings.HeartbeatInterval;
+		Stats.Heartbeats++;
+		return EJob::QueryIds;
+	}
+	return EJob::None;
+}
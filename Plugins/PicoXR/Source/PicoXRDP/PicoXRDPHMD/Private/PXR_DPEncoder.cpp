@@ -0,0 +1,443 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPEncoder.h"
+#include "PXR_DPQualityMap.h"
+#include "PXR_Log.h"
+#include "PXR_Trace.h"
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+#if PLATFORM_WINDOWS
+#include "streamer_api.h"
+#endif
+
+namespace
+{
+	/** Encoder of platforms without the streamer, it never starts. */
+	class FNullEncoder : public IPICOXRDPEncoder
+	{
+	public:
+		virtual bool Startup(const FPICOXRDPEncoderConfig& Config) override { return false; }
+		virtual void Shutdown() override {}
+		virtual bool Submit(uint64 Texture, uint64 Tag, bool bKeyFrame) override { return false; }
+		virtual bool Acquire(std::vector<uint8>& OutData, uint64& OutTag) override { return false; }
+		virtual void Flush() override {}
+	};
+
+#if PLATFORM_WINDOWS
+	/** The streamer's EncoderInterface, encoding the shared RGBA textures of the render device. */
+	class FStreamerEncoder : public IPICOXRDPEncoder
+	{
+	public:
+		virtual ~FStreamerEncoder()
+		{
+			Shutdown();
+		}
+
+		virtual bool Startup(const FPICOXRDPEncoderConfig& Config) override
+		{
+			Shutdown();
+			Encoder = pxr::codec::BuildEncoder();
+			if (Encoder == nullptr)
+			{
+				PXR_LOGE(PxrUnreal, "Could not build the direct preview encoder");
+				return false;
+			}
+
+			pxr::codec::EncoderParam Param;
+			Param.device = GDynamicRHI->RHIGetNativeDevice();
+			Param.width = Config.Width;
+			Param.height = Config.Height;
+			Param.bitrate = Config.Bitrate;
+			Param.fps = Config.Fps;
+			// Key frames are forced per frame, the GOP never ends on its own.
+			Param.gop = 0xFFFFFFFF;
+			Param.format = pxr::IDPInterface::IFrameFormat::kRGBA;
+			Param.quality = Config.Quality == EPICOXRDPEncodeQuality::Performance ? pxr::IDPInterface::IFrameQuality::kPerformance
+				: Config.Quality == EPICOXRDPEncodeQuality::High ? pxr::IDPInterface::IFrameQuality::kHigh
+				: pxr::IDPInterface::IFrameQuality::kStandard;
+			Param.codecs = Config.bH265 ? pxr::IDPInterface::ICodecType::kH265 : pxr::IDPInterface::ICodecType::kH264;
+			Width = Config.Width;
+			Height = Config.Height;
+			if (Encoder->Startup(Param, nullptr) != pxr::IDPInterface::IResult::kOK)
+			{
+				PXR_LOGE(PxrUnreal, "Could not start the direct preview encoder: %s", pxr::error::GetLastErrorMessage());
+				pxr::codec::DestroyEncoder(&Encoder);
+				Encoder = nullptr;
+				return false;
+			}
+			return true;
+		}
+
+		virtual void Shutdown() override
+		{
+			if (Encoder)
+			{
+				Encoder->Shutdown();
+				pxr::codec::DestroyEncoder(&Encoder);
+				Encoder = nullptr;
+			}
+		}
+
+		virtual bool Submit(uint64 Texture, uint64 Tag, bool bKeyFrame) override
+		{
+			pxr::codec::FrameParam Param;
+			Param.width = Width;
+			Param.height = Height;
+			Param.format = pxr::IDPInterface::IFrameFormat::kRGBA;
+			Param.force_type = bKeyFrame ? pxr::IDPInterface::IFrameType::kIDR : pxr::IDPInterface::IFrameType::kNone;
+			pxr::p_resource_handle Handle = Texture;
+			return Encoder && Encoder->Submit(&Handle, &Param, (void*)(UPTRINT)Tag) == pxr::IDPInterface::IResult::kOK;
+		}
+
+		virtual bool Acquire(std::vector<uint8>& OutData, uint64& OutTag) override
+		{
+			void* Tag = nullptr;
+			if (Encoder == nullptr || Encoder->Acquire(OutData, &Tag) != pxr::IDPInterface::IResult::kOK)
+			{
+				return false;
+			}
+			OutTag = (uint64)(UPTRINT)Tag;
+			return true;
+		}
+
+		virtual void Flush() override
+		{
+			if (Encoder)
+			{
+				Encoder->Flush();
+			}
+		}
+
+	private:
+		pxr::codec::EncoderInterface* Encoder = nullptr;
+		int32 Width = 0;
+		int32 Height = 0;
+	};
+#endif
+}
+
+TSharedRef<IPICOXRDPEncoder, ESPMode::ThreadSafe> IPICOXRDPEncoder::CreateDefault()
+{
+#if PLATFORM_WINDOWS
+	return MakeShared<FStreamerEncoder, ESPMode::ThreadSafe>();
+#else
+	return MakeShared<FNullEncoder, ESPMode::ThreadSafe>();
+#endif
+}
+
+FPICOXRDPEncoderDriver::FPICOXRDPEncoderDriver(TSharedPtr<IPICOXRDPEncoder, ESPMode::ThreadSafe> InEncoder, TFunction<double()> InClock)
+	: Encoder(InEncoder.IsValid() ? InEncoder.ToSharedRef() : IPICOXRDPEncoder::CreateDefault())
+	, Clock(MoveTemp(InClock))
+	, bStopping(false)
+{
+}
+
+FPICOXRDPEncoderDriver::~FPICOXRDPEncoderDriver()
+{
+	Shutdown();
+}
+
+bool FPICOXRDPEncoderDriver::Startup(const FPICOXRDPEncoderSettings& InSettings, bool bThreaded)
+{
+	Shutdown();
+
+	Settings = InSettings;
+	Settings.MaxFramesInFlight = FMath::Max(Settings.MaxFramesInFlight, 1);
+	Settings.BufferCount = FMath::Max(Settings.BufferCount, 1);
+	Settings.MaxBitrate = FMath::Max(Settings.MaxBitrate, Settings.MinBitrate);
+	Settings.Config.Bitrate = FMath::Clamp(Settings.Config.Bitrate, Settings.MinBitrate, Settings.MaxBitrate);
+	if (!Encoder->Startup(Settings.Config))
+	{
+		return false;
+	}
+
+	InFlight.Reset();
+	Output.Reset();
+	Buffers.Reset();
+	Buffers.SetNum(Settings.BufferCount);
+	Stats = FPICOXRDPEncoderStats();
+	Stats.Bitrate = Settings.Config.Bitrate;
+	Stats.TargetBitrate = Settings.Config.Bitrate;
+	Stats.Quality = Settings.Config.Quality;
+	Stats.TargetQuality = Settings.Config.Quality;
+	Stats.KeyFrameInterval = Settings.MaxKeyFrameInterval;
+	FramesSinceKeyFrame = 0;
+	bKeyFrameRequested = true;
+	LastReconfigureTime = Now();
+	bRunning = true;
+
+	if (bThreaded)
+	{
+		bStopping = false;
+		WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Thread = FRunnableThread::Create(this, TEXT("PICOXRDPEncoderDrain"), 0, TPri_AboveNormal);
+	}
+	return true;
+}
+
+void FPICOXRDPEncoderDriver::Shutdown()
+{
+	// A failed restart stops the driver but leaves the drain thread to join.
+	if (!bRunning && Thread == nullptr)
+	{
+		return;
+	}
+
+	// Flushing completes what is in flight, so a drain thread blocked in Acquire gets its frame and sees the stop.
+	Stop();
+	Encoder->Flush();
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	if (WorkEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		WorkEvent = nullptr;
+	}
+	Encoder->Shutdown();
+
+	FScopeLock ScopeLock(&Lock);
+	InFlight.Reset();
+	Output.Reset();
+	Buffers.Reset();
+	bRunning = false;
+}
+
+bool FPICOXRDPEncoderDriver::SubmitFrame(uint64 Texture, uint64 FrameNumber)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (!bRunning)
+	{
+		return false;
+	}
+
+	Stats.Submitted++;
+	if (InFlight.Num() >= Settings.MaxFramesInFlight)
+	{
+		Stats.DroppedInFlight++;
+		PXR_TRACE(EncodeDropped, (uint32)FrameNumber, 0);
+		return false;
+	}
+
+	// A new bitrate or quality needs a restart, which is only safe with nothing in flight for the drain thread to acquire.
+	const double Time = Now();
+	if (InFlight.Num() == 0
+		&& (FMath::Abs(Stats.TargetBitrate - Stats.Bitrate) > Stats.Bitrate / 10 || Stats.TargetQuality != Stats.Quality)
+		&& Time - LastReconfigureTime >= Settings.ReconfigureInterval)
+	{
+		LastReconfigureTime = Time;
+		if (!Restart())
+		{
+			return false;
+		}
+	}
+
+	const bool bKeyFrame = bKeyFrameRequested || (Stats.KeyFrameInterval > 0 && FramesSinceKeyFrame >= Stats.KeyFrameInterval);
+	if (!Encoder->Submit(Texture, FrameNumber, bKeyFrame))
+	{
+		Stats.DroppedByEncoder++;
+		PXR_TRACE(EncodeDropped, (uint32)FrameNumber, 1);
+		return false;
+	}
+
+	if (bKeyFrame)
+	{
+		Stats.KeyFrames++;
+		bKeyFrameRequested = false;
+		FramesSinceKeyFrame = 0;
+	}
+	FramesSinceKeyFrame++;
+	InFlight.Add({ FrameNumber, Time, bKeyFrame });
+	PXR_TRACE(EncodeSubmit, (uint32)FrameNumber, bKeyFrame ? 1 : 0);
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+	return true;
+}
+
+bool FPICOXRDPEncoderDriver::Restart()
+{
+	Encoder->Shutdown();
+	FPICOXRDPEncoderConfig Config = Settings.Config;
+	Config.Bitrate = Stats.TargetBitrate;
+	Config.Quality = Stats.TargetQuality;
+	if (!Encoder->Startup(Config))
+	{
+		PXR_LOGE(PxrUnreal, "Could not restart the direct preview encoder at %d bps, quality %d", Config.Bitrate, (int32)Config.Quality);
+		bRunning = false;
+		return false;
+	}
+	Stats.Bitrate = Config.Bitrate;
+	Stats.Quality = Config.Quality;
+	Stats.Restarts++;
+	// A restarted encoder has no reference frame to predict from.
+	bKeyFrameRequested = true;
+	return true;
+}
+
+bool FPICOXRDPEncoderDriver::DrainOnce()
+{
+	int32 BufferIndex = INDEX_NONE;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (InFlight.Num() == 0)
+		{
+			return false;
+		}
+		BufferIndex = Buffers.IndexOfByPredicate([](const FBuffer& Buffer) { return Buffer.bFree; });
+		if (BufferIndex == INDEX_NONE)
+		{
+			return false;
+		}
+		// Reserved while unlocked, the array itself only changes on startup and shutdown.
+		Buffers[BufferIndex].bFree = false;
+	}
+
+	// Acquire writes into a buffer drained before, it only allocates when this frame is larger than any it held.
+	std::vector<uint8>& Data = Buffers[BufferIndex].Data;
+	const size_t Capacity = Data.capacity();
+	uint64 Tag = 0;
+	const bool bAcquired = Encoder->Acquire(Data, Tag);
+
+	FScopeLock ScopeLock(&Lock);
+	const int32 Index = bAcquired ? InFlight.IndexOfByPredicate([Tag](const FInFlightFrame& Frame) { return Frame.FrameNumber == Tag; }) : INDEX_NONE;
+	if (Index == INDEX_NONE)
+	{
+		Buffers[BufferIndex].bFree = true;
+		return false;
+	}
+
+	if (Data.capacity() > Capacity)
+	{
+		Stats.BufferAllocations++;
+		Stats.BufferBytesAllocated += Data.capacity() - Capacity;
+		PXR_TRACE(EncodeBufferGrow, (uint32)Tag, Data.capacity() - Capacity);
+	}
+
+	// Outputs come in submit order, frames submitted before this one were lost by the encoder.
+	for (int32 Lost = 0; Lost < Index; Lost++)
+	{
+		Stats.DroppedByEncoder++;
+		PXR_TRACE(EncodeDropped, (uint32)InFlight[Lost].FrameNumber, 1);
+	}
+
+	const FInFlightFrame Frame = InFlight[Index];
+	InFlight.RemoveAt(0, Index + 1);
+
+	FPICOXRDPEncodedFrame Encoded;
+	Encoded.FrameNumber = Frame.FrameNumber;
+	Encoded.bKeyFrame = Frame.bKeyFrame;
+	Encoded.SubmitTime = Frame.SubmitTime;
+	Encoded.EncodeSeconds = Now() - Frame.SubmitTime;
+	Encoded.Buffer = BufferIndex;
+	Encoded.Data = &Data;
+	Output.Add(Encoded);
+
+	Stats.Encoded++;
+	Stats.LastLatency = Encoded.EncodeSeconds;
+	Stats.TotalLatency += Encoded.EncodeSeconds;
+	Stats.PeakLatency = FMath::Max(Stats.PeakLatency, Encoded.EncodeSeconds);
+	PXR_TRACE(EncodeOutput, (uint32)Frame.FrameNumber, (uint64)(Encoded.EncodeSeconds * 1000000.0));
+	return true;
+}
+
+bool FPICOXRDPEncoderDriver::PopFrame(FPICOXRDPEncodedFrame& OutFrame)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Output.Num() == 0)
+	{
+		return false;
+	}
+	OutFrame = Output[0];
+	Output.RemoveAt(0);
+	return true;
+}
+
+void FPICOXRDPEncoderDriver::ReleaseFrame(const FPICOXRDPEncodedFrame& Frame)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Buffers.IsValidIndex(Frame.Buffer))
+	{
+		Buffers[Frame.Buffer].bFree = true;
+	}
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
+
+void FPICOXRDPEncoderDriver::ReportSendStats(const FPICOXRDPTunnelSendStats& SendStats)
+{
+	FScopeLock ScopeLock(&Lock);
+	const uint32 Packets = SendStats.PacketsSent + SendStats.PacketsDropped;
+	const bool bLoss = Packets > 0 && SendStats.PacketsDropped > Packets / 50;
+	// A send queue holding more than two frames means the link takes less than is encoded.
+	const bool bCongested = Settings.Config.Fps > 0 && SendStats.QueueDelaySeconds > 2.0 / Settings.Config.Fps;
+
+	if (bLoss || bCongested)
+	{
+		Stats.TargetBitrate = FMath::Max(Settings.MinBitrate, (int32)(Stats.TargetBitrate * 0.8));
+		Stats.KeyFrameInterval = Settings.MinKeyFrameInterval;
+		// The remote cannot decode past a lost packet until the next key frame.
+		bKeyFrameRequested |= bLoss;
+	}
+	else if (Packets > 0)
+	{
+		Stats.TargetBitrate = FMath::Min(Settings.MaxBitrate, Stats.TargetBitrate + (Settings.MaxBitrate - Settings.MinBitrate) / 20);
+		Stats.KeyFrameInterval = Settings.MaxKeyFrameInterval > 0 ? FMath::Min(Stats.KeyFrameInterval * 2, Settings.MaxKeyFrameInterval) : 0;
+	}
+}
+
+void FPICOXRDPEncoderDriver::RequestKeyFrame()
+{
+	FScopeLock ScopeLock(&Lock);
+	bKeyFrameRequested = true;
+}
+
+void FPICOXRDPEncoderDriver::SetQualityMap(const FPICOXRDPQualityMap& Map)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (!bRunning)
+	{
+		return;
+	}
+
+	if (Encoder->SetQualityMap(Map))
+	{
+		Stats.QualityMaps++;
+		return;
+	}
+	Stats.TargetQuality = Map.GetEncodeQuality();
+}
+
+FPICOXRDPEncoderStats FPICOXRDPEncoderDriver::GetStats() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Stats;
+}
+
+uint32 FPICOXRDPEncoderDriver::Run()
+{
+	while (!bStopping)
+	{
+		if (!DrainOnce())
+		{
+			// Woken by a submit or a release, the timeout covers encoders that fail Acquire until a frame is ready.
+			WorkEvent->Wait(1);
+		}
+	}
+	return 0;
+}
+
+void FPICOXRDPEncoderDriver::Stop()
+{
+	bStopping = true;
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
@@ -0,0 +1,216 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/Runnable.h"
+#include "Templates/Atomic.h"
+#include <vector>
+
+class FRunnableThread;
+class FEvent;
+struct FPICOXRDPQualityMap;
+
+/** Which of the encoder's quality presets it runs with. */
+enum class EPICOXRDPEncodeQuality : uint8
+{
+	Performance,
+	Standard,
+	High,
+};
+
+struct FPICOXRDPEncoderConfig
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	// Bits per second.
+	int32 Bitrate = 0;
+	int32 Fps = 0;
+	bool bH265 = false;
+	EPICOXRDPEncodeQuality Quality = EPICOXRDPEncodeQuality::Standard;
+};
+
+/**
+ * Video encoder the driver feeds. The default one wraps the streamer's EncoderInterface, a fake can be set instead.
+ * Submit is called on the RHI thread and Acquire on the drain thread, the driver never calls both for the same frame at once.
+ */
+class IPICOXRDPEncoder
+{
+public:
+	virtual ~IPICOXRDPEncoder() {}
+
+	virtual bool Startup(const FPICOXRDPEncoderConfig& Config) = 0;
+	virtual void Shutdown() = 0;
+
+	/** Queues the shared texture Texture, Tag comes back with its output. bKeyFrame forces an IDR frame. */
+	virtual bool Submit(uint64 Texture, uint64 Tag, bool bKeyFrame) = 0;
+
+	/**
+	 * Writes the next encoded frame into OutData, reusing its capacity, and its tag into OutTag.
+	 * May block until a frame is ready. @return false if there was none.
+	 */
+	virtual bool Acquire(std::vector<uint8>& OutData, uint64& OutTag) = 0;
+
+	/** Completes every submitted frame. */
+	virtual void Flush() = 0;
+
+	/** Applies per block QP offsets to the frames submitted from now on. @return false if the encoder takes none. */
+	virtual bool SetQualityMap(const FPICOXRDPQualityMap& Map) { return false; }
+
+	static TSharedRef<IPICOXRDPEncoder, ESPMode::ThreadSafe> CreateDefault();
+};
+
+/** What the tunnel sent since its last report. */
+struct FPICOXRDPTunnelSendStats
+{
+	double Seconds = 0.0;
+	uint64 BytesSent = 0;
+	uint32 PacketsSent = 0;
+	uint32 PacketsDropped = 0;
+	// Time the oldest unsent packet has been queued for.
+	double QueueDelaySeconds = 0.0;
+};
+
+struct FPICOXRDPEncoderSettings
+{
+	FPICOXRDPEncoderConfig Config;
+	// Bitrate range the send statistics move the bitrate within, Config.Bitrate is where it starts.
+	int32 MinBitrate = 5000000;
+	int32 MaxBitrate = 60000000;
+	// Frames between key frames while sends are clean, and right after a loss. 0 sends key frames only when needed.
+	int32 MaxKeyFrameInterval = 0;
+	int32 MinKeyFrameInterval = 30;
+	// Frames submitted and not yet drained. Frames beyond are dropped rather than blocking the RHI thread.
+	int32 MaxFramesInFlight = 2;
+	// Output buffers, held by the driver until drained and by the consumer until released.
+	int32 BufferCount = 4;
+	// Restarting the encoder for a new bitrate or quality resets it to a key frame, so it is done at most this often.
+	double ReconfigureInterval = 1.0;
+};
+
+struct FPICOXRDPEncoderStats
+{
+	uint64 Submitted = 0;
+	uint64 Encoded = 0;
+	// Frames dropped with too many in flight, rejected by the encoder, or never returned by it.
+	uint64 DroppedInFlight = 0;
+	uint64 DroppedByEncoder = 0;
+	uint64 KeyFrames = 0;
+	uint32 Restarts = 0;
+	// Output buffers that had to grow, and the bytes they grew by. Zero once the pool has warmed up.
+	uint64 BufferAllocations = 0;
+	uint64 BufferBytesAllocated = 0;
+	// Submit to drained, in seconds.
+	double LastLatency = 0.0;
+	double TotalLatency = 0.0;
+	double PeakLatency = 0.0;
+	int32 Bitrate = 0;
+	int32 TargetBitrate = 0;
+	int32 KeyFrameInterval = 0;
+	EPICOXRDPEncodeQuality Quality = EPICOXRDPEncodeQuality::Standard;
+	EPICOXRDPEncodeQuality TargetQuality = EPICOXRDPEncodeQuality::Standard;
+	// Quality maps the encoder took per block.
+	uint64 QualityMaps = 0;
+};
+
+/** Encoded frame handed to the consumer, valid until ReleaseFrame. */
+struct FPICOXRDPEncodedFrame
+{
+	uint64 FrameNumber = 0;
+	bool bKeyFrame = false;
+	double SubmitTime = 0.0;
+	double EncodeSeconds = 0.0;
+	int32 Buffer = INDEX_NONE;
+	const std::vector<uint8>* Data = nullptr;
+};
+
+/**
+ * Feeds the encoder from the RHI thread and drains its output on a thread of its own into pooled buffers,
+ * so neither waits for the other. The bitrate and the key frame interval follow the send statistics of the tunnel:
+ * losses or a growing send queue cut the bitrate and ask for a key frame, clean sends raise it back step by step.
+ * Key frames are forced by the driver, the encoder runs with an endless GOP.
+ * Encode latency and buffer growth are traced per frame.
+ */
+class FPICOXRDPEncoderDriver : public FRunnable
+{
+public:
+	/** nullptr uses the default encoder. Clock returns seconds, FPlatformTime::Seconds if unset. */
+	explicit FPICOXRDPEncoderDriver(TSharedPtr<IPICOXRDPEncoder, ESPMode::ThreadSafe> InEncoder = nullptr, TFunction<double()> InClock = nullptr);
+	virtual ~FPICOXRDPEncoderDriver();
+
+	/** Starts the encoder, and the drain thread if bThreaded. Without it DrainOnce has to be called. */
+	bool Startup(const FPICOXRDPEncoderSettings& InSettings, bool bThreaded = true);
+
+	/** Flushes and stops the encoder and the drain thread. Frames not released by then are dropped with the buffers. */
+	void Shutdown();
+
+	bool IsRunning() const { return bRunning; }
+
+	/**
+	 * Submits the shared texture of FrameNumber, restarting the encoder first if its settings are due. RHI thread,
+	 * once the commands writing the texture ran. @return false if the frame was dropped.
+	 */
+	bool SubmitFrame(uint64 Texture, uint64 FrameNumber);
+
+	/** Acquires one output of the encoder into a free buffer. @return false if there was nothing to acquire. */
+	bool DrainOnce();
+
+	/** Oldest encoded frame not yet handed out. @return false if there is none. */
+	bool PopFrame(FPICOXRDPEncodedFrame& OutFrame);
+
+	/** Returns the buffer of Frame to the pool. */
+	void ReleaseFrame(const FPICOXRDPEncodedFrame& Frame);
+
+	/** Adapts the bitrate and the key frame interval. Any thread. */
+	void ReportSendStats(const FPICOXRDPTunnelSendStats& SendStats);
+
+	/** Forces the next frame to be a key frame, as when the remote lost one. Any thread. */
+	void RequestKeyFrame();
+
+	/**
+	 * Applies Map to the frames submitted from now on. An encoder without per block QP takes the quality preset closest
+	 * to the map instead, on its next restart. RHI thread.
+	 */
+	void SetQualityMap(const FPICOXRDPQualityMap& Map);
+
+	FPICOXRDPEncoderStats GetStats() const;
+
+	// FRunnable, the drain thread
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FInFlightFrame
+	{
+		uint64 FrameNumber;
+		double SubmitTime;
+		bool bKeyFrame;
+	};
+
+	struct FBuffer
+	{
+		std::vector<uint8> Data;
+		bool bFree = true;
+	};
+
+	double Now() const { return Clock ? Clock() : FPlatformTime::Seconds(); }
+	bool Restart();
+
+	TSharedRef<IPICOXRDPEncoder, ESPMode::ThreadSafe> Encoder;
+	TFunction<double()> Clock;
+	FPICOXRDPEncoderSettings Settings;
+
+	mutable FCriticalSection Lock;
+	TArray<FInFlightFrame> InFlight;
+	TArray<FBuffer> Buffers;
+	TArray<FPICOXRDPEncodedFrame> Output;
+	FPICOXRDPEncoderStats Stats;
+	int32 FramesSinceKeyFrame = 0;
+	bool bKeyFrameRequested = true;
+	double LastReconfigureTime = 0.0;
+
+	FRunnableThread* Thread = nullptr;
+	FEvent* WorkEvent = nullptr;
+	TAtomic<bool> bStopping;
+	bool bRunning = false;
+};
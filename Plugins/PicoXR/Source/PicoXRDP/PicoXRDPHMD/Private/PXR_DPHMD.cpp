@@ -2,7 +2,9 @@
 
 #include "PXR_DPHMD.h"
 #include "PXR_DPPrivate.h"
+#include "PXR_DPVideo.h"
 #include "PXR_Log.h"
+#include "PXR_EventManager.h"
 
 #include "Misc/App.h"
 #include "Misc/CoreDelegates.h"
@@ -33,8 +35,6 @@
 #define ARRAYSIZE( a ) ( sizeof( ( a ) ) / sizeof( ( a )[ 0 ] ) )
 #endif
 
-static constexpr float DirectPreviewFov = 101.f;
-
 DEFINE_LOG_CATEGORY(LogPICODP);
 /** Helper function for acquiring the appropriate FSceneViewport */
 FSceneViewport* FindSceneViewport()
@@ -365,9 +365,19 @@ bool FPICODirectPreviewHMD::OnStartGameFrame(FWorldContext& WorldContext)
 	{
 		bStereoEnabled = EnableStereo(bStereoDesired);
 	}
+	if (CurrentDirectPreview)
+	{
+		CurrentDirectPreview->Tick();
+	}
 	return true;
 }
 
+void FPICODirectPreviewHMD::OnDirectPreviewConnectionChanged(EPICOXRDPConnectionState OldState, EPICOXRDPConnectionState NewState)
+{
+	PXR_LOGI(PxrUnreal,"PXR_DP connection %s", LexToString(NewState));
+	UPICOXREventManager::GetInstance()->DirectPreviewConnectionChangedDelegate.Broadcast(static_cast<int32>(NewState));
+}
+
 void FPICODirectPreviewHMD::ResetOrientationAndPosition(float yaw)
 {
 	ResetOrientation(yaw);
@@ -575,6 +585,26 @@ void FPICODirectPreviewHMD::OnBeginRendering_GameThread()
 {
 	check(IsInGameThread());
 	SpectatorScreenController->BeginRenderViewFamily();
+
+	// The layers go to the render thread every frame, the compositor skips drawing the ones that did not change
+	TArray<FPICODPLayer> Layers;
+	CopyLayers(Layers);
+	TArray<FPICOXRDPLayerInput> LayerInputs;
+	LayerInputs.Reserve(Layers.Num());
+	for (const FPICODPLayer& Layer : Layers)
+	{
+		FPICOXRDPLayerInput LayerInput;
+		if (GetLayerInput(Layer, LayerInput))
+		{
+			LayerInputs.Add(LayerInput);
+		}
+	}
+	ENQUEUE_RENDER_COMMAND(PICODPCopyLayers)(
+		[this, Layers = MoveTemp(Layers), LayerInputs = MoveTemp(LayerInputs)](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			LayersRenderThread = MoveTemp(Layers);
+			LayerInputsRenderThread = MoveTemp(LayerInputs);
+		});
 }
 
 void FPICODirectPreviewHMD::OnBeginRendering_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& ViewFamily)
@@ -708,6 +738,13 @@ FPICODirectPreviewHMD::FPICODirectPreviewHMD(const FAutoRegister& AutoRegister,
 	RendererModule(nullptr),
 	PICODPPlugin(InPICODPPlugin)
 {
+	for (int32 Eye = 0; Eye < 2; Eye++)
+	{
+		for (int32 Space = 0; Space < (int32)EPICOXRDPLayerSpace::Count; Space++)
+		{
+			LayerMatricesRenderThread[Eye][Space] = FMatrix::Identity;
+		}
+	}
 	Startup();
 }
 
@@ -758,6 +795,7 @@ bool FPICODirectPreviewHMD::Startup()
 	}
 	CreateSpectatorScreenController();
 	CurrentDirectPreview = MakeShareable(new DP());
+	CurrentDirectPreview->GetConnection().OnStateChanged().AddRaw(this, &FPICODirectPreviewHMD::OnDirectPreviewConnectionChanged);
 #if WITH_EDITOR
 	ULevelEditorPlaySettings* PlaySettingsConfig = GetMutableDefault<ULevelEditorPlaySettings>();
 	PlaySettingsConfig->NewWindowHeight = 1920;
@@ -770,7 +808,10 @@ bool FPICODirectPreviewHMD::Startup()
 
 void FPICODirectPreviewHMD::Shutdown()
 {
-
+	if (CurrentDirectPreview)
+	{
+		CurrentDirectPreview->GetConnection().OnStateChanged().RemoveAll(this);
+	}
 }
 
 const FPICODirectPreviewHMD::FTrackingFrame& FPICODirectPreviewHMD::GetTrackingFrame() const
@@ -785,5 +826,93 @@ const FPICODirectPreviewHMD::FTrackingFrame& FPICODirectPreviewHMD::GetTrackingF
 	}
 }
 
+#if !UE_BUILD_SHIPPING
+namespace PICODirectPreviewStats
+{
+	static void LogAccessoryStats(const TArray<FString>& Args)
+	{
+		if (!GEngine || !GEngine->XRSystem.IsValid() || GEngine->XRSystem->GetSystemName() != FPICODirectPreviewHMD::SystemName)
+		{
+			PXR_LOGI(PxrUnreal, "PXR_DP direct preview is not running");
+			return;
+		}
+		FPICODirectPreviewHMD* HMD = static_cast<FPICODirectPreviewHMD*>(GEngine->XRSystem.Get());
+		if (!HMD->CurrentDirectPreview.IsValid())
+		{
+			return;
+		}
+		const FPICOXRDPAccessoryStats Stats = HMD->CurrentDirectPreview->GetAccessoryStats();
+		PXR_LOGI(PxrUnreal, "PXR_DP accessories: frames:%llu queries:%llu (%.2f per frame) failed:%llu reads:%llu (%.2f per frame) last frame reads:%u peak:%u",
+			Stats.Frames, Stats.Queries, Stats.GetQueriesPerFrame(), Stats.FailedQueries, Stats.Reads, Stats.GetReadsPerFrame(), Stats.LastFrameReads, Stats.PeakFrameReads);
+	}
+
+	static void LogTextureRingStats(const TArray<FString>& Args)
+	{
+		if (!GEngine || !GEngine->XRSystem.IsValid() || GEngine->XRSystem->GetSystemName() != FPICODirectPreviewHMD::SystemName)
+		{
+			PXR_LOGI(PxrUnreal, "PXR_DP direct preview is not running");
+			return;
+		}
+		FDP DirectPreview = static_cast<FPICODirectPreviewHMD*>(GEngine->XRSystem.Get())->CurrentDirectPreview;
+		if (!DirectPreview.IsValid())
+		{
+			return;
+		}
+		ENQUEUE_RENDER_COMMAND(PICODPLogTextureRingStats)(
+			[DirectPreview](FRHICommandListImmediate& RHICmdList)
+			{
+				const FPICOXRDPTextureRingStats& Stats = DirectPreview->GetTextureRingStats_RenderThread();
+				if (!DirectPreview->IsTextureRingSynchronized_RenderThread())
+				{
+					// Nothing tells the ring the streamer is done with a slot, it never waits and never drops a frame.
+					PXR_LOGI(PxrUnreal, "PXR_DP texture ring, not synchronized with the streamer (vr.PICODPKeyedMutex 0): frames:%llu recreations:%u failures:%u",
+						Stats.Frames, Stats.Recreations, Stats.CreateFailures);
+					return;
+				}
+				PXR_LOGI(PxrUnreal, "PXR_DP texture ring: frames:%llu waits:%llu (%.3f ms, peak %.3f ms) dropped:%llu recreations:%u failures:%u",
+					Stats.Frames, Stats.AcquireWaits, Stats.AcquireWaitSeconds * 1000.0, Stats.PeakAcquireWaitSeconds * 1000.0,
+					Stats.DroppedFrames, Stats.Recreations, Stats.CreateFailures);
+			});
+	}
+
+	static void LogVideoStats(const TArray<FString>& Args)
+	{
+		if (!GEngine || !GEngine->XRSystem.IsValid() || GEngine->XRSystem->GetSystemName() != FPICODirectPreviewHMD::SystemName)
+		{
+			PXR_LOGI(PxrUnreal, "PXR_DP direct preview is not running");
+			return;
+		}
+		FPICODirectPreviewHMD* HMD = static_cast<FPICODirectPreviewHMD*>(GEngine->XRSystem.Get());
+		FPICOXRDPVideoStats Stats;
+		if (!HMD->CurrentDirectPreview.IsValid() || !HMD->CurrentDirectPreview->GetVideoStats(Stats))
+		{
+			PXR_LOGI(PxrUnreal, "PXR_DP sends no video, vr.PICODPVideoPort is 0 or the headset is not connected");
+			return;
+		}
+		PXR_LOGI(PxrUnreal, "PXR_DP video encoder: submitted:%llu encoded:%llu key:%llu dropped:%llu in flight, %llu by the encoder, %llu at a bad size, bitrate:%d target:%d",
+			Stats.Encoder.Submitted, Stats.Encoder.Encoded, Stats.Encoder.KeyFrames, Stats.Encoder.DroppedInFlight, Stats.Encoder.DroppedByEncoder,
+			Stats.DroppedFrames, Stats.Encoder.Bitrate, Stats.Encoder.TargetBitrate);
+		PXR_LOGI(PxrUnreal, "PXR_DP video sender: frames:%llu dropped:%llu packets:%llu failed:%llu bytes:%llu peak queued:%d pool:%d free:%d peak:%d",
+			Stats.Sender.Frames, Stats.Sender.DroppedFrames, Stats.Sender.PacketsSent, Stats.Sender.PacketsFailed, Stats.Sender.BytesSent,
+			Stats.Sender.PeakQueuedPackets, Stats.PoolSlots, Stats.PoolFree, Stats.PoolPeakInUse);
+	}
+
+	static FAutoConsoleCommand LogAccessoryStatsCommand(
+		TEXT("pxr.DP.AccessoryStats"),
+		TEXT("Logs how many terminal round trips the direct preview makes per frame for the HMD and controller accessories."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&LogAccessoryStats));
+
+	static FAutoConsoleCommand LogTextureRingStatsCommand(
+		TEXT("pxr.DP.TextureRingStats"),
+		TEXT("Logs the frames the direct preview handed to the streamer, the waits for shared eye textures and the frames dropped."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&LogTextureRingStats));
+
+	static FAutoConsoleCommand LogVideoStatsCommand(
+		TEXT("pxr.DP.VideoStats"),
+		TEXT("Logs the frames the direct preview encoded and sent to the headset with vr.PICODPVideoPort, the bitrate they adapted to and the packet pool they were sent from."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&LogVideoStats));
+}
+#endif
+
 #endif //STEAMVR_SUPPORTED_PLATFORMS
 
@@ -70,11 +70,14 @@ struct FPICODPLayer
 	FLayerDesc	          LayerDesc;
 	vr::VROverlayHandle_t OverlayHandle;
 	bool				  bUpdateTexture;
+	// Bumped whenever the texture is set or marked for update, for the compositor to tell a changed texture by
+	uint32				  TextureRevision;
 
 	FPICODPLayer(const FLayerDesc& InLayerDesc)
 		: LayerDesc(InLayerDesc)
 		, OverlayHandle(vr::k_ulOverlayHandleInvalid)
 		, bUpdateTexture(false)
+		, TextureRevision(0)
 	{}
 
 	// Required by TStereoLayerManager:
@@ -85,6 +88,9 @@ struct FPICODPLayer
 	friend void MarkLayerTextureForUpdate(FPICODPLayer& Layer);
 };
 
+/** Layer as the DirectPreview compositor takes it. @return false if it is hidden or has no texture. */
+bool GetLayerInput(const FPICODPLayer& Layer, FPICOXRDPLayerInput& OutInput);
+
 /**
  * PICODP Head Mounted Display public FPICODPAssetManager,
  */
@@ -224,6 +230,8 @@ public:
 	//PICO Direct Preview++++++++++++++++++++++++
 private:
 	void CreateSpectatorScreenController();
+	//Tells Blueprint when DirectPreview loses or regains the runtime
+	void OnDirectPreviewConnectionChanged(EPICOXRDPConnectionState OldState, EPICOXRDPConnectionState NewState);
 public:
 	virtual FIntRect GetFullFlatEyeRect_RenderThread(FTexture2DRHIRef EyeTexture) const override;
 	virtual void CopyTexture_RenderThread(FRHICommandListImmediate& RHICmdList, FRHITexture2D* SrcTexture, FIntRect SrcRect, FRHITexture2D* DstTexture, FIntRect DstRect, bool bClearBlack, bool bNoAlpha) const override;
@@ -500,6 +508,13 @@ private:
 	FQuat PlayerOrientation;
 	FVector PlayerLocation;
 
+	// Stereo layers of the frame being rendered, the copies keep their textures alive until it is composited
+	TArray<FPICODPLayer> LayersRenderThread;
+	TArray<FPICOXRDPLayerInput> LayerInputsRenderThread;
+	// What each eye projects the layers of each EPICOXRDPLayerSpace with, set as the eye views are rendered
+	FMatrix LayerMatricesRenderThread[2][(int32)EPICOXRDPLayerSpace::Count];
+	FPICOXRDPLayerView LayerViewRenderThread;
+
 	TRefCountPtr<BridgeBaseImpl> pBridge;
 };
 
@@ -0,0 +1,424 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPLatency.h"
+#include "PXR_DPEncoder.h"
+#include "PXR_DPTerminal.h"
+#include "PXR_DPTextureRing.h"
+#include "PXR_DPTunnel.h"
+#include "PXR_Log.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	/** Slots that always exist and are never held by a streamer. */
+	class FHarnessTextureProvider : public IPICOXRDPSharedTextureProvider
+	{
+	public:
+		virtual bool CreateSlot(int32 Slot, FIntPoint EyeSize) override { return true; }
+		virtual void DestroySlot(int32 Slot) override {}
+		virtual bool AcquireSlot(int32 Slot, uint32 TimeoutMs) override { return true; }
+		virtual void ReleaseSlot(int32 Slot, bool bToStreamer) override {}
+		virtual uint64 GetSharedHandle(int32 Slot, int32 Eye) const override { return 0x1000 + Slot * 2 + Eye; }
+		virtual FRHITexture2D* GetTexture(int32 Slot, int32 Eye) const override { return nullptr; }
+	};
+
+	/** Terminal standing in for the runtime, it hands every eye layer submitted to OnSubmit. Poses are stamped in ns of Time. */
+	class FHarnessTerminal : public IPICOXRDPTerminal
+	{
+	public:
+		double* Time = nullptr;
+		TFunction<bool(const FPICOXRDPEyeLayer&)> OnSubmit;
+		uint32 PoseQueries = 0;
+
+		virtual bool QueryHmdPose(uint64 Frame, FPICOXRDPPoseSample& OutPose) override
+		{
+			PoseQueries++;
+			OutPose = FPICOXRDPPoseSample();
+			OutPose.RemoteTimestamp = (int64)(*Time * 1000000000.0) + 1;
+			OutPose.RemoteIndex = PoseQueries;
+			OutPose.HostTime = *Time;
+			return true;
+		}
+
+		virtual bool SubmitEyeLayer(const FPICOXRDPEyeLayer& Layer) override
+		{
+			return OnSubmit && OnSubmit(Layer);
+		}
+	};
+
+	/**
+	 * Encoder busy for Cost of every frame, one frame after the other. Acquire moves the clock to when the frame is done,
+	 * as a blocking Acquire would, and writes the tag in front of FrameBytes bytes.
+	 */
+	class FHarnessEncoder : public IPICOXRDPEncoder
+	{
+	public:
+		double* Time = nullptr;
+		TFunction<double()> Cost;
+		int32 FrameBytes = 0;
+
+		virtual bool Startup(const FPICOXRDPEncoderConfig& Config) override { return true; }
+		virtual void Shutdown() override { Pending.Reset(); }
+
+		virtual bool Submit(uint64 Texture, uint64 Tag, bool bKeyFrame) override
+		{
+			BusyUntil = FMath::Max(*Time, BusyUntil) + (Cost ? Cost() : 0.0);
+			Pending.Add({ Tag, BusyUntil });
+			return true;
+		}
+
+		virtual bool Acquire(std::vector<uint8>& OutData, uint64& OutTag) override
+		{
+			if (Pending.Num() == 0)
+			{
+				return false;
+			}
+			const FPending Frame = Pending[0];
+			Pending.RemoveAt(0);
+			*Time = FMath::Max(*Time, Frame.ReadyTime);
+			OutData.resize(FMath::Max(FrameBytes, (int32)sizeof(uint64)));
+			FMemory::Memcpy(OutData.data(), &Frame.Tag, sizeof(uint64));
+			OutTag = Frame.Tag;
+			return true;
+		}
+
+		virtual void Flush() override {}
+
+	private:
+		struct FPending
+		{
+			uint64 Tag;
+			double ReadyTime;
+		};
+
+		TArray<FPending> Pending;
+		double BusyUntil = 0.0;
+	};
+
+	/** Tunnel delivering every packet to the remote's reassembler, each arriving Delay after it was sent. */
+	class FHarnessTunnel : public IPICOXRDPTunnel
+	{
+	public:
+		double* Time = nullptr;
+		TFunction<double()> Delay;
+		FPICOXRDPFrameReassembler* Remote = nullptr;
+		double LastSendTime = 0.0;
+		double LastArrivalTime = 0.0;
+
+		virtual bool Startup(const FPICOXRDPTunnelConfig& Config) override { return true; }
+		virtual void Shutdown() override {}
+
+		virtual bool Send(const FPICOXRDPTunnelPacket& Packet) override
+		{
+			LastSendTime = *Time;
+			LastArrivalTime = FMath::Max(LastArrivalTime, *Time + (Delay ? Delay() : 0.0));
+			return Remote && Remote->AddPacket(Packet.Payload, Packet.PayloadLength, Packet.Extension, Packet.ExtensionLength, false);
+		}
+	};
+}
+
+const TCHAR* FPICOXRDPLatencyReport::GetStageName(EPICOXRDPLatencyStage Stage)
+{
+	switch (Stage)
+	{
+	case EPICOXRDPLatencyStage::Render: return TEXT("Render");
+	case EPICOXRDPLatencyStage::Submit: return TEXT("Submit");
+	case EPICOXRDPLatencyStage::Encode: return TEXT("Encode");
+	case EPICOXRDPLatencyStage::Send: return TEXT("Send");
+	case EPICOXRDPLatencyStage::Present: return TEXT("Present");
+	case EPICOXRDPLatencyStage::Total: return TEXT("Total");
+	default: return TEXT("Unknown");
+	}
+}
+
+FString FPICOXRDPLatencyReport::ToString() const
+{
+	FString Text = FString::Printf(TEXT("Frames %u %u\n"), Frames, DroppedFrames);
+	for (int32 Stage = 0; Stage < (int32)EPICOXRDPLatencyStage::Count; Stage++)
+	{
+		const FPICOXRDPLatencyPercentiles& Percentiles = Stages[Stage];
+		Text += FString::Printf(TEXT("%s %.4f %.4f %.4f %.4f\n"), GetStageName((EPICOXRDPLatencyStage)Stage),
+			Percentiles.P50 * 1000.0, Percentiles.P95 * 1000.0, Percentiles.P99 * 1000.0, Percentiles.Max * 1000.0);
+	}
+	return Text;
+}
+
+bool FPICOXRDPLatencyReport::FromString(const FString& Text)
+{
+	*this = FPICOXRDPLatencyReport();
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines);
+	int32 StagesRead = 0;
+	for (const FString& Line : Lines)
+	{
+		TArray<FString> Fields;
+		Line.ParseIntoArrayWS(Fields);
+		if (Fields.Num() == 3 && Fields[0] == TEXT("Frames"))
+		{
+			Frames = (uint32)FCString::Atoi(*Fields[1]);
+			DroppedFrames = (uint32)FCString::Atoi(*Fields[2]);
+			continue;
+		}
+		for (int32 Stage = 0; Stage < (int32)EPICOXRDPLatencyStage::Count && Fields.Num() == 5; Stage++)
+		{
+			if (Fields[0] == GetStageName((EPICOXRDPLatencyStage)Stage))
+			{
+				Stages[Stage].P50 = FCString::Atod(*Fields[1]) / 1000.0;
+				Stages[Stage].P95 = FCString::Atod(*Fields[2]) / 1000.0;
+				Stages[Stage].P99 = FCString::Atod(*Fields[3]) / 1000.0;
+				Stages[Stage].Max = FCString::Atod(*Fields[4]) / 1000.0;
+				StagesRead++;
+			}
+		}
+	}
+	return StagesRead == (int32)EPICOXRDPLatencyStage::Count;
+}
+
+TArray<EPICOXRDPLatencyStage> FPICOXRDPLatencyReport::FindRegressions(const FPICOXRDPLatencyReport& Baseline, double Tolerance, double MinSeconds) const
+{
+	TArray<EPICOXRDPLatencyStage> Regressions;
+	for (int32 Stage = 0; Stage < (int32)EPICOXRDPLatencyStage::Count; Stage++)
+	{
+		const FPICOXRDPLatencyPercentiles& Now = Stages[Stage];
+		const FPICOXRDPLatencyPercentiles& Before = Baseline.Stages[Stage];
+		if (Now.P50 > Before.P50 * (1.0 + Tolerance) + MinSeconds || Now.P95 > Before.P95 * (1.0 + Tolerance) + MinSeconds)
+		{
+			Regressions.Add((EPICOXRDPLatencyStage)Stage);
+		}
+	}
+	return Regressions;
+}
+
+FPICOXRDPLatencyPercentiles FPICOXRDPLatencyHarness::ComputePercentiles(TArray<double> Values)
+{
+	FPICOXRDPLatencyPercentiles Percentiles;
+	if (Values.Num() == 0)
+	{
+		return Percentiles;
+	}
+
+	// Nearest rank, so every percentile is a latency some frame really had.
+	Values.Sort();
+	const auto Rank = [&Values](double Fraction)
+	{
+		return Values[FMath::Clamp(FMath::CeilToInt(Fraction * Values.Num()) - 1, 0, Values.Num() - 1)];
+	};
+	Percentiles.P50 = Rank(0.50);
+	Percentiles.P95 = Rank(0.95);
+	Percentiles.P99 = Rank(0.99);
+	Percentiles.Max = Values.Last();
+	return Percentiles;
+}
+
+FPICOXRDPLatencyReport FPICOXRDPLatencyHarness::Run(const FPICOXRDPLatencyHarnessSettings& Settings)
+{
+	FPICOXRDPLatencyReport Report;
+	for (TArray<double>& Stage : Samples)
+	{
+		Stage.Reset();
+	}
+
+	FRandomStream Random(Settings.Seed);
+	const auto Vary = [&Random](double Seconds, double Jitter)
+	{
+		return FMath::Max(0.0, Seconds + (Random.FRand() * 2.0 - 1.0) * Jitter);
+	};
+	double Time = 0.0;
+	const TFunction<double()> Clock = [&Time]() { return Time; };
+
+	FPICOXRDPFrameReassembler Remote;
+	TSharedRef<FHarnessTerminal, ESPMode::ThreadSafe> Terminal = MakeShared<FHarnessTerminal, ESPMode::ThreadSafe>();
+	Terminal->Time = &Time;
+	FPICOXRDPPoseTimeline Timeline(Clock);
+	TSharedRef<FHarnessEncoder, ESPMode::ThreadSafe> Encoder = MakeShared<FHarnessEncoder, ESPMode::ThreadSafe>();
+	Encoder->Time = &Time;
+	Encoder->FrameBytes = Settings.FrameBytes;
+	Encoder->Cost = [&Vary, &Settings]() { return Vary(Settings.EncodeSeconds, Settings.EncodeJitter); };
+	TSharedRef<FHarnessTunnel, ESPMode::ThreadSafe> Tunnel = MakeShared<FHarnessTunnel, ESPMode::ThreadSafe>();
+	Tunnel->Time = &Time;
+	Tunnel->Remote = &Remote;
+	Tunnel->Delay = [&Vary, &Settings]() { return Vary(Settings.NetworkSeconds, Settings.NetworkJitter); };
+
+	FPICOXRDPTextureRing Ring(MakeShared<FHarnessTextureProvider>());
+	Ring.Configure(FPICOXRDPTextureRingSettings(), FIntPoint(1024, 1024));
+	FPICOXRDPPublishedFrame Published;
+
+	const int32 Fps = FMath::Max(Settings.Fps, 1);
+	FPICOXRDPEncoderDriver Driver(Encoder, Clock);
+	FPICOXRDPEncoderSettings EncoderSettings;
+	EncoderSettings.Config.Width = 2048;
+	EncoderSettings.Config.Height = 1024;
+	EncoderSettings.Config.Fps = Fps;
+	EncoderSettings.Config.Bitrate = Settings.FrameBytes * 8 * Fps;
+	if (!Driver.Startup(EncoderSettings, false))
+	{
+		return Report;
+	}
+
+	FPICOXRDPTunnelSender Sender(Tunnel, Clock);
+	FPICOXRDPTunnelSenderSettings SenderSettings;
+	SenderSettings.Config.Mtu = Settings.Mtu;
+	SenderSettings.Config.Rate = Fps;
+	SenderSettings.PacingRate = Settings.PacingRate;
+	if (!Sender.Startup(SenderSettings))
+	{
+		Driver.Shutdown();
+		return Report;
+	}
+
+	// The runtime encodes the left eye texture of every layer it is handed, as the streamer does.
+	Terminal->OnSubmit = [&Driver](const FPICOXRDPEyeLayer& Layer)
+	{
+		return Driver.SubmitFrame(Layer.EyeHandles[0], Layer.Frame);
+	};
+
+	double RenderFree = 0.0;
+	double LinkFree = 0.0;
+	for (int32 Frame = 0; Frame < Settings.Frames; Frame++)
+	{
+		Report.Frames++;
+		Time = FMath::Max((double)Frame / Fps, RenderFree);
+		const double PoseTime = Time;
+		FPICOXRDPPoseSample Pose;
+		Terminal->QueryHmdPose(Frame, Pose);
+		Timeline.AddRenderPose(Frame, Pose);
+
+		Time += Vary(Settings.RenderSeconds, Settings.RenderJitter);
+		const int32 Slot = Ring.BeginWrite();
+		if (Slot == INDEX_NONE)
+		{
+			Report.DroppedFrames++;
+			continue;
+		}
+		Ring.EndWrite(Slot, Frame);
+		Published.Publish(Ring.GetLatestFrame());
+		Timeline.MarkRendered(Frame);
+		const double RenderedTime = Time;
+		RenderFree = Time;
+
+		Time += Settings.SubmitSeconds;
+		const double SubmittedTime = Time;
+		if (!Terminal->SubmitLatest(Published.Get(), Timeline) || !Driver.DrainOnce())
+		{
+			Report.DroppedFrames++;
+			continue;
+		}
+		FPICOXRDPEncodedFrame Encoded;
+		if (!Driver.PopFrame(Encoded))
+		{
+			Report.DroppedFrames++;
+			continue;
+		}
+		const double EncodedTime = Time;
+
+		Time = FMath::Max(Time, LinkFree);
+		Tunnel->LastArrivalTime = 0.0;
+		if (!Sender.QueueFrame(Encoded.Data->data(), (uint32)Encoded.Data->size(), (uint32)Frame, PoseTime, Encoded.bKeyFrame,
+			[&Driver, Encoded]() { Driver.ReleaseFrame(Encoded); }))
+		{
+			Report.DroppedFrames++;
+			continue;
+		}
+		while (Sender.GetNumQueued() > 0)
+		{
+			if (Sender.Pump() == 0)
+			{
+				Time += FMath::Max(Sender.GetPacingDelay(), 1.0e-6);
+			}
+		}
+		const double SentTime = Tunnel->LastSendTime;
+		LinkFree = Time;
+
+		FPICOXRDPFrameReassembler::FFrame Received;
+		uint64 ReceivedTag = 0;
+		if (Remote.PopFrame(Received) && Received.Data.Num() >= (int32)sizeof(uint64))
+		{
+			FMemory::Memcpy(&ReceivedTag, Received.Data.GetData(), sizeof(uint64));
+		}
+		if (Received.Header.FrameNumber != (uint32)Frame || ReceivedTag != (uint64)Frame || Received.Data.Num() != (int32)Encoded.Data->size())
+		{
+			Report.DroppedFrames++;
+			continue;
+		}
+		double PresentTime = Tunnel->LastArrivalTime + Settings.DecodeSeconds;
+		if (Settings.RemoteFps > 0)
+		{
+			PresentTime = FMath::CeilToDouble(PresentTime * Settings.RemoteFps - 1.0e-9) / Settings.RemoteFps;
+		}
+
+		Samples[(int32)EPICOXRDPLatencyStage::Render].Add(RenderedTime - PoseTime);
+		Samples[(int32)EPICOXRDPLatencyStage::Submit].Add(SubmittedTime - RenderedTime);
+		Samples[(int32)EPICOXRDPLatencyStage::Encode].Add(EncodedTime - SubmittedTime);
+		Samples[(int32)EPICOXRDPLatencyStage::Send].Add(SentTime - EncodedTime);
+		Samples[(int32)EPICOXRDPLatencyStage::Present].Add(PresentTime - SentTime);
+		Samples[(int32)EPICOXRDPLatencyStage::Total].Add(PresentTime - PoseTime);
+	}
+	Sender.Shutdown();
+	Driver.Shutdown();
+
+	for (int32 Stage = 0; Stage < (int32)EPICOXRDPLatencyStage::Count; Stage++)
+	{
+		Report.Stages[Stage] = ComputePercentiles(Samples[Stage]);
+	}
+	return Report;
+}
+
+#if !UE_BUILD_SHIPPING
+namespace PICOXRDPLatencyHarnessCommand
+{
+	static FString GetBaselinePath()
+	{
+		return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("DPLatencyBaseline.txt"));
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		FPICOXRDPLatencyHarnessSettings Settings;
+		if (Args.Num() > 0)
+		{
+			Settings.Frames = FMath::Max(FCString::Atoi(*Args[0]), 1);
+		}
+		FPICOXRDPLatencyHarness Harness;
+		const FPICOXRDPLatencyReport Report = Harness.Run(Settings);
+		PXR_LOGI(PxrUnreal, "DP latency over %u frames, %u dropped, P50 P95 P99 max in ms:", Report.Frames, Report.DroppedFrames);
+		for (int32 Stage = 0; Stage < (int32)EPICOXRDPLatencyStage::Count; Stage++)
+		{
+			const FPICOXRDPLatencyPercentiles& Percentiles = Report.Stages[Stage];
+			PXR_LOGI(PxrUnreal, "  %s %.2f %.2f %.2f %.2f", FPICOXRDPLatencyReport::GetStageName((EPICOXRDPLatencyStage)Stage),
+				Percentiles.P50 * 1000.0, Percentiles.P95 * 1000.0, Percentiles.P99 * 1000.0, Percentiles.Max * 1000.0);
+		}
+
+		const FString Mode = Args.Num() > 1 ? Args[1] : FString();
+		if (Mode == TEXT("save"))
+		{
+			const bool bSaved = FFileHelper::SaveStringToFile(Report.ToString(), *GetBaselinePath());
+			PXR_LOGI(PxrUnreal, "DP latency baseline %s %s", bSaved ? TEXT("saved to") : TEXT("could not be saved to"), *GetBaselinePath());
+		}
+		else if (Mode == TEXT("compare"))
+		{
+			FString Text;
+			FPICOXRDPLatencyReport Baseline;
+			if (!FFileHelper::LoadFileToString(Text, *GetBaselinePath()) || !Baseline.FromString(Text))
+			{
+				PXR_LOGW(PxrUnreal, "No DP latency baseline at %s", *GetBaselinePath());
+				return;
+			}
+			const TArray<EPICOXRDPLatencyStage> Regressions = Report.FindRegressions(Baseline);
+			for (EPICOXRDPLatencyStage Stage : Regressions)
+			{
+				const int32 Index = (int32)Stage;
+				PXR_LOGW(PxrUnreal, "DP latency regression in %s: P50 %.2f ms was %.2f ms, P95 %.2f ms was %.2f ms", FPICOXRDPLatencyReport::GetStageName(Stage),
+					Report.Stages[Index].P50 * 1000.0, Baseline.Stages[Index].P50 * 1000.0, Report.Stages[Index].P95 * 1000.0, Baseline.Stages[Index].P95 * 1000.0);
+			}
+			PXR_LOGI(PxrUnreal, "DP latency compared to the baseline: %d regressions", Regressions.Num());
+		}
+	}
+
+	static FAutoConsoleCommand HarnessCommand(
+		TEXT("pxr.DP.LatencyHarness"),
+		TEXT("Runs the direct preview frame path against a fake terminal, encoder and tunnel and logs the latency of every stage. [Frames] [save|compare] keeps or checks a baseline."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
+#endif
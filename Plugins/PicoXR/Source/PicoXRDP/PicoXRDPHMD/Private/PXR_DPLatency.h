@@ -0,0 +1,92 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+
+/** Stages of a frame from the pose it is rendered at to the remote showing it, each timed from the end of the one before. */
+enum class EPICOXRDPLatencyStage : uint8
+{
+	// Pose query to the eye textures written.
+	Render,
+	// To the eye layer submitted to the runtime, DP::SendMessage.
+	Submit,
+	// To the encoded frame drained from the encoder.
+	Encode,
+	// To the last fragment sent through the tunnel.
+	Send,
+	// To the remote presenting the frame, over the network and the remote's decode.
+	Present,
+	// Pose query to present, motion to photon as far as the host can tell.
+	Total,
+	Count,
+};
+
+struct FPICOXRDPLatencyPercentiles
+{
+	// Seconds.
+	double P50 = 0.0;
+	double P95 = 0.0;
+	double P99 = 0.0;
+	double Max = 0.0;
+};
+
+struct FPICOXRDPLatencyReport
+{
+	uint32 Frames = 0;
+	// Frames lost on the way, by the encoder, the tunnel or the remote.
+	uint32 DroppedFrames = 0;
+	FPICOXRDPLatencyPercentiles Stages[(int32)EPICOXRDPLatencyStage::Count];
+
+	static const TCHAR* GetStageName(EPICOXRDPLatencyStage Stage);
+
+	/** One line per stage, milliseconds, read back by FromString. */
+	FString ToString() const;
+	bool FromString(const FString& Text);
+
+	/** Stages whose P50 or P95 exceed those of Baseline by more than Tolerance of them plus MinSeconds. */
+	TArray<EPICOXRDPLatencyStage> FindRegressions(const FPICOXRDPLatencyReport& Baseline, double Tolerance = 0.1, double MinSeconds = 0.0005) const;
+};
+
+/** Cost of every simulated stage, seconds, each varied by up to its jitter either way. */
+struct FPICOXRDPLatencyHarnessSettings
+{
+	int32 Frames = 600;
+	int32 Fps = 72;
+	double RenderSeconds = 0.008;
+	double RenderJitter = 0.002;
+	double SubmitSeconds = 0.0005;
+	double EncodeSeconds = 0.004;
+	double EncodeJitter = 0.001;
+	int32 FrameBytes = 40000;
+	// Bytes per second the tunnel paces to, 0 sends frames at once.
+	double PacingRate = 25000000.0;
+	uint32 Mtu = 1200;
+	double NetworkSeconds = 0.002;
+	double NetworkJitter = 0.0005;
+	double DecodeSeconds = 0.003;
+	// Refresh rate the remote presents at, 0 presents as soon as a frame is decoded.
+	int32 RemoteFps = 72;
+	int32 Seed = 1;
+};
+
+/**
+ * Runs the frame path of DirectPreview on a simulated clock, with a fake terminal, encoder and tunnel behind the seams the
+ * live path uses: the texture ring, the frame it publishes and IPICOXRDPTerminal::SubmitLatest as DP::SendMessage drives them, the encoder driver
+ * and the tunnel sender. The fake terminal stands in for the runtime and hands every submitted layer to the encoder, the
+ * fake tunnel delivers the fragments to a reassembler standing in for the remote.
+ * Render, encode and the network are each busy for one frame at a time, so a slow stage queues the frames behind it.
+ * Needs no RHI, streamer or network, but builds with PICOXRDPHMD, which is Win64 only.
+ */
+class FPICOXRDPLatencyHarness
+{
+public:
+	FPICOXRDPLatencyReport Run(const FPICOXRDPLatencyHarnessSettings& Settings);
+
+	/** Seconds of each stage of every presented frame of the last run. */
+	const TArray<double>& GetSamples(EPICOXRDPLatencyStage Stage) const { return Samples[(int32)Stage]; }
+
+	static FPICOXRDPLatencyPercentiles ComputePercentiles(TArray<double> Values);
+
+private:
+	TArray<double> Samples[(int32)EPICOXRDPLatencyStage::Count];
+};
@@ -0,0 +1,416 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPLayerCompositor.h"
+#include "PXR_Log.h"
+#if PLATFORM_WINDOWS
+#include "D3D11RHIPrivate.h"
+#endif
+
+namespace
+{
+	/** Provider of platforms without D3D11, every target fails to be created. */
+	class FNullLayerTargetProvider : public IPICOXRDPLayerTargetProvider
+	{
+	public:
+		virtual bool CreateTarget(int32 Target, FIntPoint Size, bool bShared) override { return false; }
+		virtual void DestroyTarget(int32 Target) override {}
+		virtual FRHITexture2D* GetTexture(int32 Target) const override { return nullptr; }
+		virtual uint64 GetSharedHandle(int32 Target) const override { return 0; }
+	};
+
+#if PLATFORM_WINDOWS
+	/** D3D11 targets, shared ones opened by the runtime through their legacy DXGI handles like the eye textures. */
+	class FD3D11LayerTargetProvider : public IPICOXRDPLayerTargetProvider
+	{
+	public:
+		virtual bool CreateTarget(int32 Target, FIntPoint Size, bool bShared) override
+		{
+			ID3D11Device* Device = static_cast<ID3D11Device*>(GDynamicRHI->RHIGetNativeDevice());
+			if (Device == nullptr)
+			{
+				return false;
+			}
+			if (Targets.Num() <= Target)
+			{
+				Targets.SetNum(Target + 1);
+			}
+
+			D3D11_TEXTURE2D_DESC Desc = {};
+			Desc.Width = Size.X;
+			Desc.Height = Size.Y;
+			Desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			Desc.MipLevels = 1;
+			Desc.ArraySize = 1;
+			Desc.SampleDesc.Count = 1;
+			Desc.Usage = D3D11_USAGE_DEFAULT;
+			Desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+			Desc.MiscFlags = bShared ? D3D11_RESOURCE_MISC_SHARED : 0;
+
+			FD3D11Target& Created = Targets[Target];
+			if (FAILED(Device->CreateTexture2D(&Desc, nullptr, Created.Texture.GetInitReference())))
+			{
+				DestroyTarget(Target);
+				return false;
+			}
+			if (bShared)
+			{
+				TRefCountPtr<IDXGIResource> Resource;
+				if (FAILED(Created.Texture->QueryInterface(Resource.GetInitReference())) || FAILED(Resource->GetSharedHandle(&Created.Handle)))
+				{
+					DestroyTarget(Target);
+					return false;
+				}
+			}
+			FD3D11DynamicRHI* DynamicRHI = static_cast<FD3D11DynamicRHI*>(GDynamicRHI);
+			Created.RHITexture = DynamicRHI->RHICreateTexture2DFromResource(
+				PF_R8G8B8A8, TexCreate_RenderTargetable | TexCreate_ShaderResource, FClearValueBinding::Transparent, Created.Texture).GetReference();
+			if (!Created.RHITexture.IsValid())
+			{
+				DestroyTarget(Target);
+				return false;
+			}
+			return true;
+		}
+
+		virtual void DestroyTarget(int32 Target) override
+		{
+			if (Targets.IsValidIndex(Target))
+			{
+				Targets[Target] = FD3D11Target();
+			}
+		}
+
+		virtual FRHITexture2D* GetTexture(int32 Target) const override
+		{
+			return Targets[Target].RHITexture;
+		}
+
+		virtual uint64 GetSharedHandle(int32 Target) const override
+		{
+			return HandleToULong(Targets[Target].Handle);
+		}
+
+	private:
+		struct FD3D11Target
+		{
+			TRefCountPtr<ID3D11Texture2D> Texture;
+			FTexture2DRHIRef RHITexture;
+			HANDLE Handle = nullptr;
+		};
+
+		TArray<FD3D11Target> Targets;
+	};
+#endif
+}
+
+TSharedRef<IPICOXRDPLayerTargetProvider> IPICOXRDPLayerTargetProvider::CreateDefault()
+{
+#if PLATFORM_WINDOWS
+	return MakeShared<FD3D11LayerTargetProvider>();
+#else
+	return MakeShared<FNullLayerTargetProvider>();
+#endif
+}
+
+FPICOXRDPLayerTargetPool::FPICOXRDPLayerTargetPool(TSharedPtr<IPICOXRDPLayerTargetProvider> InProvider)
+	: Provider(InProvider.IsValid() ? InProvider.ToSharedRef() : IPICOXRDPLayerTargetProvider::CreateDefault())
+{
+}
+
+FPICOXRDPLayerTargetPool::~FPICOXRDPLayerTargetPool()
+{
+	Reset();
+}
+
+void FPICOXRDPLayerTargetPool::SetProvider(TSharedPtr<IPICOXRDPLayerTargetProvider> InProvider)
+{
+	Reset();
+	FailedSize = FIntPoint::ZeroValue;
+	Provider = InProvider.IsValid() ? InProvider.ToSharedRef() : IPICOXRDPLayerTargetProvider::CreateDefault();
+}
+
+int32 FPICOXRDPLayerTargetPool::Acquire(FIntPoint Size, bool bShared)
+{
+	if (Size.X <= 0 || Size.Y <= 0)
+	{
+		return INDEX_NONE;
+	}
+	for (int32 Target = 0; Target < Targets.Num(); Target++)
+	{
+		FTarget& Pooled = Targets[Target];
+		if (Pooled.bValid && !Pooled.bInUse && Pooled.Size == Size && Pooled.bShared == bShared)
+		{
+			Pooled.bInUse = true;
+			Pooled.IdleFrames = 0;
+			Stats.Reuses++;
+			Stats.InUse++;
+			Stats.Idle--;
+			return Target;
+		}
+	}
+	if (FailedSize == Size && bFailedShared == bShared)
+	{
+		return INDEX_NONE;
+	}
+
+	int32 Target = Targets.IndexOfByPredicate([](const FTarget& Pooled) { return !Pooled.bValid; });
+	if (Target == INDEX_NONE)
+	{
+		Target = Targets.AddDefaulted();
+	}
+	if (!Provider->CreateTarget(Target, Size, bShared))
+	{
+		Stats.CreateFailures++;
+		FailedSize = Size;
+		bFailedShared = bShared;
+		PXR_LOGE(PxrUnreal, "PXR_DP failed to create a %slayer target of %dx%d", bShared ? TEXT("shared ") : TEXT(""), Size.X, Size.Y);
+		return INDEX_NONE;
+	}
+	FTarget& Created = Targets[Target];
+	Created.Size = Size;
+	Created.bShared = bShared;
+	Created.bValid = true;
+	Created.bInUse = true;
+	Created.IdleFrames = 0;
+	Stats.Creates++;
+	Stats.InUse++;
+	return Target;
+}
+
+void FPICOXRDPLayerTargetPool::Release(int32 Target)
+{
+	if (!Targets.IsValidIndex(Target) || !Targets[Target].bValid || !Targets[Target].bInUse)
+	{
+		return;
+	}
+	Targets[Target].bInUse = false;
+	Targets[Target].IdleFrames = 0;
+	Stats.InUse--;
+	Stats.Idle++;
+}
+
+void FPICOXRDPLayerTargetPool::EndFrame(uint32 IdleFrames)
+{
+	for (int32 Target = 0; Target < Targets.Num(); Target++)
+	{
+		FTarget& Pooled = Targets[Target];
+		if (Pooled.bValid && !Pooled.bInUse && ++Pooled.IdleFrames > IdleFrames)
+		{
+			Destroy(Target);
+		}
+	}
+}
+
+void FPICOXRDPLayerTargetPool::Reset()
+{
+	for (int32 Target = 0; Target < Targets.Num(); Target++)
+	{
+		if (Targets[Target].bValid)
+		{
+			Release(Target);
+			Destroy(Target);
+		}
+	}
+	Targets.Reset();
+}
+
+void FPICOXRDPLayerTargetPool::Destroy(int32 Target)
+{
+	Provider->DestroyTarget(Target);
+	Targets[Target] = FTarget();
+	Stats.Destroys++;
+	Stats.Idle--;
+}
+
+FPICOXRDPLayerCompositor::FPICOXRDPLayerCompositor(TSharedPtr<IPICOXRDPLayerTargetProvider> InProvider)
+	: Pool(InProvider)
+{
+}
+
+void FPICOXRDPLayerCompositor::SetProvider(TSharedPtr<IPICOXRDPLayerTargetProvider> InProvider)
+{
+	Reset();
+	Pool.SetProvider(InProvider);
+}
+
+void FPICOXRDPLayerCompositor::SetSettings(const FPICOXRDPLayerCompositorSettings& InSettings)
+{
+	if (InSettings.bForwardLayers != Settings.bForwardLayers)
+	{
+		// Turned on again, the terminal gets another chance.
+		bForwardRefused = false;
+	}
+	Settings = InSettings;
+}
+
+void FPICOXRDPLayerCompositor::Reset()
+{
+	for (FLayerState& State : States)
+	{
+		ReleaseTargets(State);
+	}
+	States.Reset();
+	Pool.Reset();
+	EyeSize = FIntPoint::ZeroValue;
+	bForwardRefused = false;
+}
+
+bool FPICOXRDPLayerCompositor::SamePlacement(const FPICOXRDPOverlayLayer& A, const FPICOXRDPOverlayLayer& B)
+{
+	return A.Priority == B.Priority && A.Space == B.Space && A.Shape == B.Shape
+		&& A.Position == B.Position && A.Rotation == B.Rotation && A.Scale == B.Scale && A.QuadSize == B.QuadSize
+		&& A.CylinderRadius == B.CylinderRadius && A.CylinderArc == B.CylinderArc && A.CylinderHeight == B.CylinderHeight
+		&& A.UVMin == B.UVMin && A.UVMax == B.UVMax && A.bNoAlpha == B.bNoAlpha && A.TextureSize == B.TextureSize;
+}
+
+void FPICOXRDPLayerCompositor::ReleaseTargets(FLayerState& State)
+{
+	for (int32& Target : State.Targets)
+	{
+		Pool.Release(Target);
+		Target = INDEX_NONE;
+	}
+	State.bForwarded = false;
+}
+
+void FPICOXRDPLayerCompositor::Composite(IPICOXRDPLayerRenderer& Renderer, const FPICOXRDPLayerView& View, const TArray<FPICOXRDPLayerInput>& Layers, FRHITexture2D* const EyeTextures[2], IPICOXRDPTerminal* Terminal)
+{
+	Stats.Frames++;
+	if (View.EyeSize != EyeSize)
+	{
+		// The eye targets are the wrong size now, forwarded layers do not depend on it.
+		for (FLayerState& State : States)
+		{
+			if (!State.bForwarded)
+			{
+				ReleaseTargets(State);
+			}
+		}
+		EyeSize = View.EyeSize;
+	}
+	for (FLayerState& State : States)
+	{
+		State.bSeen = false;
+	}
+
+	// Lowest priority first so the higher ones end up on top, by id among equals so the order holds from frame to frame.
+	TArray<int32> Order;
+	for (int32 Index = 0; Index < Layers.Num(); Index++)
+	{
+		Order.Add(Index);
+	}
+	Order.Sort([&Layers](int32 A, int32 B)
+	{
+		const FPICOXRDPOverlayLayer& LayerA = Layers[A].Layer;
+		const FPICOXRDPOverlayLayer& LayerB = Layers[B].Layer;
+		return LayerA.Priority != LayerB.Priority ? LayerA.Priority < LayerB.Priority : LayerA.Id < LayerB.Id;
+	});
+
+	for (int32 Index : Order)
+	{
+		const FPICOXRDPLayerInput& Input = Layers[Index];
+		FLayerState* State = States.FindByPredicate([&Input](const FLayerState& Existing) { return Existing.Input.Layer.Id == Input.Layer.Id; });
+		const bool bNew = State == nullptr;
+		if (bNew)
+		{
+			State = &States.AddDefaulted_GetRef();
+		}
+		State->bSeen = true;
+
+		if (Settings.bForwardLayers && Terminal && !bForwardRefused && Forward(Renderer, *State, Input, bNew, *Terminal))
+		{
+			continue;
+		}
+		const bool bChanged = bNew || State->bForwarded || Input.bContinuousUpdate
+			|| Input.Texture != State->Input.Texture || Input.TextureRevision != State->Input.TextureRevision
+			|| !SamePlacement(Input.Layer, State->Input.Layer) || State->SpaceHash != View.SpaceHashes[(int32)Input.Layer.Space];
+		CompositeLayer(Renderer, *State, Input, bChanged, View, EyeTextures);
+	}
+
+	for (int32 Index = States.Num() - 1; Index >= 0; Index--)
+	{
+		if (!States[Index].bSeen)
+		{
+			ReleaseTargets(States[Index]);
+			States.RemoveAt(Index);
+		}
+	}
+	Pool.EndFrame(Settings.IdleFrames);
+}
+
+bool FPICOXRDPLayerCompositor::Forward(IPICOXRDPLayerRenderer& Renderer, FLayerState& State, const FPICOXRDPLayerInput& Input, bool bNew, IPICOXRDPTerminal& Terminal)
+{
+	bool bUpdated = bNew || !State.bForwarded || Input.bContinuousUpdate
+		|| Input.Texture != State.Input.Texture || Input.TextureRevision != State.Input.TextureRevision;
+	const FIntPoint Size = Input.Layer.TextureSize;
+	if (!State.bForwarded || State.Targets[0] == INDEX_NONE || Pool.GetSize(State.Targets[0]) != Size)
+	{
+		ReleaseTargets(State);
+		State.Targets[0] = Pool.Acquire(Size, true);
+		if (State.Targets[0] == INDEX_NONE)
+		{
+			return false;
+		}
+		State.bForwarded = true;
+		bUpdated = true;
+	}
+
+	if (bUpdated)
+	{
+		Renderer.CopyLayer(Input, Pool.GetTexture(State.Targets[0]));
+		Stats.ForwardCopies++;
+	}
+	FPICOXRDPOverlayLayer Overlay = Input.Layer;
+	Overlay.Handle = Pool.GetSharedHandle(State.Targets[0]);
+	Overlay.bTextureUpdated = bUpdated;
+	if (!Terminal.SubmitOverlayLayer(Overlay))
+	{
+		// The runtime does not place layers itself, they are composited from now on.
+		PXR_LOGW(PxrUnreal, "PXR_DP the runtime takes no overlay layers, compositing them into the eyes");
+		bForwardRefused = true;
+		ReleaseTargets(State);
+		return false;
+	}
+	State.Input = Input;
+	Stats.ForwardedLayers++;
+	return true;
+}
+
+void FPICOXRDPLayerCompositor::CompositeLayer(IPICOXRDPLayerRenderer& Renderer, FLayerState& State, const FPICOXRDPLayerInput& Input, bool bChanged, const FPICOXRDPLayerView& View, FRHITexture2D* const EyeTextures[2])
+{
+	if (State.bForwarded || Input.Layer.bNoAlpha)
+	{
+		ReleaseTargets(State);
+	}
+	for (int32 Eye = 0; Eye < 2; Eye++)
+	{
+		bool bDraw = bChanged;
+		if (!Input.Layer.bNoAlpha && State.Targets[Eye] == INDEX_NONE)
+		{
+			State.Targets[Eye] = Pool.Acquire(EyeSize, false);
+			bDraw = true;
+		}
+		if (State.Targets[Eye] == INDEX_NONE)
+		{
+			// Opaque, or without a target to keep it in.
+			Renderer.RenderLayer(Input, Eye, EyeTextures[Eye], false);
+			Stats.DirectLayers++;
+			continue;
+		}
+
+		FRHITexture2D* Target = Pool.GetTexture(State.Targets[Eye]);
+		if (bDraw)
+		{
+			Renderer.RenderLayer(Input, Eye, Target, true);
+			Stats.RenderedLayers++;
+		}
+		else
+		{
+			Stats.SkippedLayers++;
+		}
+		Renderer.BlendLayer(Target, EyeTextures[Eye]);
+		Stats.Blends++;
+	}
+	State.Input = Input;
+	State.SpaceHash = View.SpaceHashes[(int32)Input.Layer.Space];
+}
@@ -0,0 +1,178 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "CoreMinimal.h"
+#include "PXR_DPPrivate.h"
+
+#if STEAMVR_SUPPORTED_PLATFORMS
+
+#include "PXR_DPLayerRenderer.h"
+
+#include "RendererInterface.h"
+#include "RHIStaticStates.h"
+#include "PipelineStateCache.h"
+#include "CommonRenderResources.h"
+#include "ScreenRendering.h"
+#include "StereoLayerRendering.h"
+
+FPICODPLayerRenderer::FPICODPLayerRenderer(FRHICommandListImmediate& InRHICmdList, IRendererModule& InRendererModule, const FEyeMatrices& InMatrices)
+	: RHICmdList(InRHICmdList)
+	, RendererModule(InRendererModule)
+	, Matrices(InMatrices)
+{
+}
+
+void FPICODPLayerRenderer::RenderLayer(const FPICOXRDPLayerInput& Input, int32 Eye, FRHITexture2D* Target, bool bClear)
+{
+	check(IsInRenderingThread());
+	const FPICOXRDPOverlayLayer& Layer = Input.Layer;
+	FRHITexture* SourceRHI = Input.Texture;
+#if ENGINE_MINOR_VERSION > 25
+	RHICmdList.Transition(FRHITransitionInfo(SourceRHI, ERHIAccess::Unknown, ERHIAccess::SRVGraphics));
+#else
+	RHICmdList.TransitionResources(EResourceTransitionAccess::EReadable, &SourceRHI, 1);
+#endif
+
+	// Into a cleared target the layer keeps its alpha for BlendLayer to blend by. Straight into an eye it is blended over
+	// what is there, or replaces it without alpha, leaving the eye's alpha alone either way.
+	FRHIBlendState* BlendState = TStaticBlendState<>::GetRHI();
+	if (!bClear)
+	{
+		BlendState = Layer.bNoAlpha ? TStaticBlendState<CW_RGB>::GetRHI() : TStaticBlendState<CW_RGB, BO_Add, BF_SourceAlpha, BF_InverseSourceAlpha>::GetRHI();
+	}
+
+	const FIntPoint TargetSize(Target->GetSizeX(), Target->GetSizeY());
+	FRHIRenderPassInfo RPInfo(Target, bClear ? ERenderTargetActions::Clear_Store : ERenderTargetActions::Load_Store);
+	RHICmdList.BeginRenderPass(RPInfo, TEXT("PICODPLayer"));
+	{
+		RHICmdList.SetViewport(0, 0, 0.0f, TargetSize.X, TargetSize.Y, 1.0f);
+
+		FGraphicsPipelineStateInitializer GraphicsPSOInit;
+		RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+		GraphicsPSOInit.BlendState = BlendState;
+		GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
+		GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+		GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+
+		auto ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<FStereoLayerVS> VertexShader(ShaderMap);
+		TShaderMapRef<FStereoLayerPS> PixelShader(ShaderMap);
+		GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GFilterVertexDeclaration.VertexDeclarationRHI;
+#if ENGINE_MINOR_VERSION > 24
+		GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+		GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+#else
+		GraphicsPSOInit.BoundShaderState.VertexShaderRHI = GETSAFERHISHADER_VERTEX(*VertexShader);
+		GraphicsPSOInit.BoundShaderState.PixelShaderRHI = GETSAFERHISHADER_PIXEL(*PixelShader);
+#endif
+		SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
+
+		const FVector2D QuadSize = Layer.Shape == EPICOXRDPLayerShape::Cylinder ? FVector2D(Layer.CylinderArc, Layer.CylinderHeight) : Layer.QuadSize;
+		const FMatrix LayerMatrix = FTransform(Layer.Rotation, Layer.Position, Layer.Scale).ToMatrixWithScale();
+		VertexShader->SetParameters(RHICmdList, QuadSize * 0.5f, FBox2D(Layer.UVMin, Layer.UVMax), Matrices[Eye][(int32)Layer.Space], LayerMatrix);
+		PixelShader->SetParameters(RHICmdList, TStaticSamplerState<SF_Trilinear>::GetRHI(), SourceRHI);
+
+		RendererModule.DrawRectangle(
+			RHICmdList,
+			0, 0,
+			1, 1,
+			0, 0,
+			1, 1,
+			FIntPoint(1, 1),
+			FIntPoint(1, 1),
+#if ENGINE_MINOR_VERSION > 24
+			VertexShader,
+#else
+			* VertexShader,
+#endif
+			EDRF_Default);
+	}
+	RHICmdList.EndRenderPass();
+}
+
+void FPICODPLayerRenderer::BlendLayer(FRHITexture2D* Source, FRHITexture2D* Target)
+{
+	check(IsInRenderingThread());
+	DrawTexture(Source, Target, TStaticBlendState<CW_RGB, BO_Add, BF_SourceAlpha, BF_InverseSourceAlpha>::GetRHI());
+}
+
+void FPICODPLayerRenderer::CopyLayer(const FPICOXRDPLayerInput& Input, FRHITexture2D* Target)
+{
+	check(IsInRenderingThread());
+	DrawTexture(Input.Texture, Target, TStaticBlendState<>::GetRHI());
+}
+
+void FPICODPLayerRenderer::DrawTexture(FRHITexture2D* Source, FRHITexture2D* Target, FRHIBlendState* BlendState)
+{
+	FRHITexture* SourceRHI = Source;
+#if ENGINE_MINOR_VERSION > 25
+	RHICmdList.Transition(FRHITransitionInfo(SourceRHI, ERHIAccess::Unknown, ERHIAccess::SRVGraphics));
+#else
+	RHICmdList.TransitionResources(EResourceTransitionAccess::EReadable, &SourceRHI, 1);
+#endif
+
+	const FIntPoint SourceSize(Source->GetSizeX(), Source->GetSizeY());
+	const FIntPoint TargetSize(Target->GetSizeX(), Target->GetSizeY());
+	FRHIRenderPassInfo RPInfo(Target, ERenderTargetActions::Load_Store);
+	RHICmdList.BeginRenderPass(RPInfo, TEXT("PICODPLayerCopy"));
+	{
+		RHICmdList.SetViewport(0, 0, 0.0f, TargetSize.X, TargetSize.Y, 1.0f);
+
+		FGraphicsPipelineStateInitializer GraphicsPSOInit;
+		RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+		GraphicsPSOInit.BlendState = BlendState;
+		GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
+		GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+		GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+
+		auto ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<FScreenVS> VertexShader(ShaderMap);
+		GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GFilterVertexDeclaration.VertexDeclarationRHI;
+#if ENGINE_MINOR_VERSION > 24
+		GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+#else
+		GraphicsPSOInit.BoundShaderState.VertexShaderRHI = GETSAFERHISHADER_VERTEX(*VertexShader);
+#endif
+		FRHISamplerState* PixelSampler = SourceSize == TargetSize ? TStaticSamplerState<SF_Point>::GetRHI() : TStaticSamplerState<SF_Bilinear>::GetRHI();
+
+		if ((Source->GetFlags() & TexCreate_SRGB) != 0)
+		{
+			TShaderMapRef<FScreenPSsRGBSource> PixelShader(ShaderMap);
+#if ENGINE_MINOR_VERSION > 24
+			GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+#else
+			GraphicsPSOInit.BoundShaderState.PixelShaderRHI = GETSAFERHISHADER_PIXEL(*PixelShader);
+#endif
+			SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
+			PixelShader->SetParameters(RHICmdList, PixelSampler, SourceRHI);
+		}
+		else
+		{
+			TShaderMapRef<FScreenPS> PixelShader(ShaderMap);
+#if ENGINE_MINOR_VERSION > 24
+			GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+#else
+			GraphicsPSOInit.BoundShaderState.PixelShaderRHI = GETSAFERHISHADER_PIXEL(*PixelShader);
+#endif
+			SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
+			PixelShader->SetParameters(RHICmdList, PixelSampler, SourceRHI);
+		}
+
+		RendererModule.DrawRectangle(
+			RHICmdList,
+			0, 0,
+			TargetSize.X, TargetSize.Y,
+			0, 0,
+			1, 1,
+			TargetSize,
+			FIntPoint(1, 1),
+#if ENGINE_MINOR_VERSION > 24
+			VertexShader,
+#else
+			* VertexShader,
+#endif
+			EDRF_Default);
+	}
+	RHICmdList.EndRenderPass();
+}
+
+#endif //STEAMVR_SUPPORTED_PLATFORMS
@@ -0,0 +1,33 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "PXR_DPLayerCompositor.h"
+
+class FRHICommandListImmediate;
+class FRHIBlendState;
+class IRendererModule;
+
+/**
+ * Draws the DirectPreview stereo layers on the RHI with the engine's stereo layer shaders, placed as FDefaultStereoLayers
+ * places them. Cylinders are drawn flat, as wide as their arc.
+ */
+class FPICODPLayerRenderer : public IPICOXRDPLayerRenderer
+{
+public:
+	typedef FMatrix FEyeMatrices[2][(int32)EPICOXRDPLayerSpace::Count];
+
+	/** Matrices project each space into each eye, they have to outlive the renderer. */
+	FPICODPLayerRenderer(FRHICommandListImmediate& InRHICmdList, IRendererModule& InRendererModule, const FEyeMatrices& InMatrices);
+
+	virtual void RenderLayer(const FPICOXRDPLayerInput& Input, int32 Eye, FRHITexture2D* Target, bool bClear) override;
+	virtual void BlendLayer(FRHITexture2D* Source, FRHITexture2D* Target) override;
+	virtual void CopyLayer(const FPICOXRDPLayerInput& Input, FRHITexture2D* Target) override;
+
+private:
+	void DrawTexture(FRHITexture2D* Source, FRHITexture2D* Target, FRHIBlendState* BlendState);
+
+	FRHICommandListImmediate& RHICmdList;
+	IRendererModule& RendererModule;
+	const FEyeMatrices& Matrices;
+};
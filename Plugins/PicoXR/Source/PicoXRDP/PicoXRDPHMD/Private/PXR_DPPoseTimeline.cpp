@@ -0,0 +1,190 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPPoseTimeline.h"
+#include "PXR_DPTerminal.h"
+#include "PXR_DPTextureRing.h"
+#include "PXR_Log.h"
+
+FPICOXRDPPoseTimeline::FPICOXRDPPoseTimeline(TFunction<double()> InClock)
+	: Clock(InClock)
+{
+	Configure(Settings);
+}
+
+void FPICOXRDPPoseTimeline::Configure(const FPICOXRDPPoseTimelineSettings& InSettings)
+{
+	FScopeLock ScopeLock(&Lock);
+	Settings = InSettings;
+	Settings.HistoryFrames = FMath::Max(Settings.HistoryFrames, 1);
+	Settings.OffsetWindow = FMath::Max(Settings.OffsetWindow, 1);
+	Settings.RemoteTicksPerSecond = FMath::Max(Settings.RemoteTicksPerSecond, 1.0);
+	Entries.Reset();
+	Entries.SetNum(Settings.HistoryFrames);
+	Offsets.Reset();
+	NextOffset = 0;
+	Offset = 0.0;
+	LastRemoteTimestamp = 0;
+}
+
+void FPICOXRDPPoseTimeline::Reset()
+{
+	Configure(FPICOXRDPPoseTimelineSettings(Settings));
+}
+
+void FPICOXRDPPoseTimeline::AddRenderPose(uint64 Frame, const FPICOXRDPPoseSample& Pose)
+{
+	const double Time = Now();
+	FScopeLock ScopeLock(&Lock);
+	FEntry& Entry = GetEntry(Frame);
+	// A frame may read the pose more than once, the first read is the one its views were set up with.
+	if (Entry.bValid && Entry.Frame == Frame)
+	{
+		return;
+	}
+	const double HostTime = Pose.HostTime > 0.0 ? Pose.HostTime : Time;
+	Entry.Frame = Frame;
+	Entry.bValid = true;
+	Entry.Pose = Pose;
+	Entry.Pose.HostTime = HostTime;
+	Entry.RenderTime = 0.0;
+
+	if (Pose.RemoteTimestamp == 0 || Pose.RemoteTimestamp == LastRemoteTimestamp)
+	{
+		return;
+	}
+	LastRemoteTimestamp = Pose.RemoteTimestamp;
+	const double Sample = HostTime - Pose.RemoteTimestamp / Settings.RemoteTicksPerSecond;
+	if (Offsets.Num() < Settings.OffsetWindow)
+	{
+		Offsets.Add(Sample);
+	}
+	else
+	{
+		Offsets[NextOffset] = Sample;
+	}
+	NextOffset = (NextOffset + 1) % Settings.OffsetWindow;
+	Offset = Offsets[0];
+	for (double Value : Offsets)
+	{
+		Offset = FMath::Min(Offset, Value);
+	}
+}
+
+void FPICOXRDPPoseTimeline::MarkRendered(uint64 Frame)
+{
+	const double Time = Now();
+	FScopeLock ScopeLock(&Lock);
+	FEntry& Entry = GetEntry(Frame);
+	if (!Entry.bValid || Entry.Frame != Frame)
+	{
+		// Rendered without a pose read, the time is still worth stamping it with.
+		Entry = FEntry();
+		Entry.Frame = Frame;
+	}
+	Entry.RenderTime = Time;
+}
+
+const FPICOXRDPPoseTimeline::FEntry* FPICOXRDPPoseTimeline::FindEntry(uint64 Frame) const
+{
+	const FEntry& Entry = Entries[Frame % Entries.Num()];
+	return Entry.Frame == Frame && (Entry.bValid || Entry.RenderTime > 0.0) ? &Entry : nullptr;
+}
+
+bool FPICOXRDPPoseTimeline::FindByFrame(uint64 Frame, FPICOXRDPPoseSample& OutPose) const
+{
+	FScopeLock ScopeLock(&Lock);
+	const FEntry* Entry = FindEntry(Frame);
+	if (!Entry || !Entry->bValid)
+	{
+		return false;
+	}
+	OutPose = Entry->Pose;
+	return true;
+}
+
+bool FPICOXRDPPoseTimeline::FindByRemoteTime(int64 RemoteTimestamp, FPICOXRDPPoseSample& OutPose) const
+{
+	FScopeLock ScopeLock(&Lock);
+	const FEntry* Before = nullptr;
+	const FEntry* After = nullptr;
+	for (const FEntry& Entry : Entries)
+	{
+		if (!Entry.bValid || Entry.Pose.RemoteTimestamp == 0)
+		{
+			continue;
+		}
+		if (Entry.Pose.RemoteTimestamp <= RemoteTimestamp && (!Before || Entry.Pose.RemoteTimestamp > Before->Pose.RemoteTimestamp))
+		{
+			Before = &Entry;
+		}
+		if (Entry.Pose.RemoteTimestamp >= RemoteTimestamp && (!After || Entry.Pose.RemoteTimestamp < After->Pose.RemoteTimestamp))
+		{
+			After = &Entry;
+		}
+	}
+	if (!Before || !After)
+	{
+		return false;
+	}
+	if (Before->Pose.RemoteTimestamp == After->Pose.RemoteTimestamp)
+	{
+		OutPose = Before->Pose;
+		return true;
+	}
+
+	const double Alpha = (double)(RemoteTimestamp - Before->Pose.RemoteTimestamp) / (double)(After->Pose.RemoteTimestamp - Before->Pose.RemoteTimestamp);
+	OutPose = Before->Pose;
+	OutPose.Position = FMath::Lerp(Before->Pose.Position, After->Pose.Position, (float)Alpha);
+	OutPose.Rotation = FQuat::Slerp(Before->Pose.Rotation, After->Pose.Rotation, (float)Alpha);
+	OutPose.RemoteTimestamp = RemoteTimestamp;
+	OutPose.HostTime = FMath::Lerp(Before->Pose.HostTime, After->Pose.HostTime, Alpha);
+	return true;
+}
+
+bool FPICOXRDPPoseTimeline::HasClockOffset() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Offsets.Num() > 0;
+}
+
+int64 FPICOXRDPPoseTimeline::HostToRemote(double HostTime) const
+{
+	FScopeLock ScopeLock(&Lock);
+	return (int64)FMath::RoundToDouble((HostTime - Offset) * Settings.RemoteTicksPerSecond);
+}
+
+double FPICOXRDPPoseTimeline::RemoteToHost(int64 RemoteTimestamp) const
+{
+	FScopeLock ScopeLock(&Lock);
+	return RemoteTimestamp / Settings.RemoteTicksPerSecond + Offset;
+}
+
+void FPICOXRDPPoseTimeline::SetPredictedLatency(double Seconds)
+{
+	FScopeLock ScopeLock(&Lock);
+	Settings.PredictedLatency = FMath::Max(Seconds, 0.0);
+}
+
+void FPICOXRDPPoseTimeline::StampLayer(FPICOXRDPEyeLayer& Layer, const FPICOXRDPPoseSample& Pose) const
+{
+	const double Time = Now();
+	FScopeLock ScopeLock(&Lock);
+	Layer.Position = Pose.Position;
+	Layer.Rotation = Pose.Rotation;
+	Layer.PoseTimestamp = Pose.RemoteTimestamp;
+	Layer.PoseIndex = Pose.RemoteIndex;
+
+	const FEntry* Entry = FindEntry(Layer.Frame);
+	Layer.RenderTime = Entry && Entry->RenderTime > 0.0 ? Entry->RenderTime : Time;
+	Layer.DisplayTime = Layer.RenderTime + Settings.PredictedLatency;
+	if (Offsets.Num() > 0)
+	{
+		Layer.RenderTimestamp = (int64)FMath::RoundToDouble((Layer.RenderTime - Offset) * Settings.RemoteTicksPerSecond);
+		Layer.DisplayTimestamp = (int64)FMath::RoundToDouble((Layer.DisplayTime - Offset) * Settings.RemoteTicksPerSecond);
+	}
+	else
+	{
+		Layer.RenderTimestamp = 0;
+		Layer.DisplayTimestamp = 0;
+	}
+}
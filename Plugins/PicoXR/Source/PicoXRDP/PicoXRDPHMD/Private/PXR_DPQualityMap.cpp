@@ -0,0 +1,222 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPQualityMap.h"
+#include "PXR_HMDFunctionLibrary.h"
+#include "PXR_Log.h"
+
+namespace
+{
+	bool SameFov(const FPICOXRDPEyeFov& A, const FPICOXRDPEyeFov& B)
+	{
+		return A.Left == B.Left && A.Right == B.Right && A.Up == B.Up && A.Down == B.Down;
+	}
+
+	/** Optical axis of the eye while Focus or the gaze do not say otherwise. */
+	FVector GetFocusDirection(EPICOXRDPQualityFocus Focus, const FPICOXRDPQualityMapInput& Input, int32 Eye)
+	{
+		if (Focus == EPICOXRDPQualityFocus::Gaze && Input.bGazeValid && Input.Gaze[Eye].X > KINDA_SMALL_NUMBER)
+		{
+			return Input.Gaze[Eye].GetSafeNormal();
+		}
+		return FVector(1.0f, 0.0f, 0.0f);
+	}
+}
+
+FPICOXRDPQualityMapSettings FPICOXRDPQualityMapSettings::ForFoveation(EPICOXRFoveationLevel Level)
+{
+	FPICOXRDPQualityMapSettings Settings;
+	Settings.Focus = EPICOXRDPQualityFocus::LensCenter;
+	switch (Level)
+	{
+	case EPICOXRFoveationLevel::Low:
+		Settings.InnerDegrees = 25.0f;
+		Settings.OuterDegrees = 55.0f;
+		Settings.OuterQpOffset = 4;
+		break;
+	case EPICOXRFoveationLevel::Medium:
+		Settings.InnerDegrees = 20.0f;
+		Settings.OuterDegrees = 45.0f;
+		Settings.OuterQpOffset = 6;
+		break;
+	case EPICOXRFoveationLevel::High:
+		Settings.InnerDegrees = 15.0f;
+		Settings.OuterDegrees = 40.0f;
+		Settings.OuterQpOffset = 8;
+		break;
+	case EPICOXRFoveationLevel::TopHigh:
+		Settings.InnerDegrees = 10.0f;
+		Settings.OuterDegrees = 30.0f;
+		Settings.OuterQpOffset = 12;
+		break;
+	}
+	return Settings;
+}
+
+EPICOXRDPEncodeQuality FPICOXRDPQualityMap::GetEncodeQuality() const
+{
+	// Coarse periphery on average leaves the bits to spare for a faster preset, a map sharpening on average asks for the best one.
+	if (AverageQpOffset > 4.0f)
+	{
+		return EPICOXRDPEncodeQuality::Performance;
+	}
+	if (AverageQpOffset < 0.0f)
+	{
+		return EPICOXRDPEncodeQuality::High;
+	}
+	return EPICOXRDPEncodeQuality::Standard;
+}
+
+void FPICOXRDPQualityMapBuilder::SetSettings(const FPICOXRDPQualityMapSettings& InSettings)
+{
+	Settings = InSettings;
+	Settings.BlockSize = FMath::Max(Settings.BlockSize, 1);
+	Settings.OuterDegrees = FMath::Max(Settings.OuterDegrees, Settings.InnerDegrees);
+	bDirty = true;
+}
+
+FVector2D FPICOXRDPQualityMapBuilder::ProjectToEye(const FVector& Direction, const FPICOXRDPEyeFov& Fov)
+{
+	if (Direction.X <= KINDA_SMALL_NUMBER)
+	{
+		return FVector2D(0.5f, 0.5f);
+	}
+	const float TanLeft = FMath::Tan(Fov.Left);
+	const float TanRight = FMath::Tan(Fov.Right);
+	const float TanUp = FMath::Tan(Fov.Up);
+	const float TanDown = FMath::Tan(Fov.Down);
+	const float U = (Direction.Y / Direction.X - TanLeft) / (TanRight - TanLeft);
+	const float V = (TanUp - Direction.Z / Direction.X) / (TanUp - TanDown);
+	return FVector2D(FMath::Clamp(U, 0.0f, 1.0f), FMath::Clamp(V, 0.0f, 1.0f));
+}
+
+bool FPICOXRDPQualityMapBuilder::Build(const FPICOXRDPQualityMapInput& Input)
+{
+	const int32 BlockSize = Settings.BlockSize;
+	const int32 EyeCount = FMath::Clamp(Input.EyeCount, 1, 2);
+	const int32 EyeWidth = Input.FrameSize.X / EyeCount;
+	if (EyeWidth <= 0 || Input.FrameSize.Y <= 0)
+	{
+		return false;
+	}
+
+	FVector Directions[2];
+	FVector2D Focus[2];
+	for (int32 Eye = 0; Eye < EyeCount; Eye++)
+	{
+		Directions[Eye] = GetFocusDirection(Settings.Focus, Input, Eye);
+		const FVector2D UV = ProjectToEye(Directions[Eye], Input.Fov[Eye]);
+		Focus[Eye] = FVector2D((Eye * EyeWidth + UV.X * EyeWidth) / BlockSize, UV.Y * Input.FrameSize.Y / BlockSize);
+	}
+	if (EyeCount == 1)
+	{
+		Directions[1] = Directions[0];
+		Focus[1] = Focus[0];
+	}
+
+	// Gaze jitters by a fraction of a degree every frame, a map that moves by less than a block would only cost a rebuild.
+	if (!bDirty && Input.FrameSize == LastInput.FrameSize && Input.EyeCount == LastInput.EyeCount
+		&& SameFov(Input.Fov[0], LastInput.Fov[0]) && SameFov(Input.Fov[1], LastInput.Fov[1])
+		&& FVector2D::Distance(Focus[0], Map.Focus[0]) < Settings.RebuildBlocks && FVector2D::Distance(Focus[1], Map.Focus[1]) < Settings.RebuildBlocks)
+	{
+		return false;
+	}
+	bDirty = false;
+	LastInput = Input;
+	Builds++;
+
+	Map.BlockSize = BlockSize;
+	Map.BlocksX = (Input.FrameSize.X + BlockSize - 1) / BlockSize;
+	Map.BlocksY = (Input.FrameSize.Y + BlockSize - 1) / BlockSize;
+	Map.Focus[0] = Focus[0];
+	Map.Focus[1] = Focus[1];
+	Map.QpOffsets.SetNumUninitialized(Map.BlocksX * Map.BlocksY, false);
+
+	if (Settings.Focus == EPICOXRDPQualityFocus::Uniform)
+	{
+		FMemory::Memzero(Map.QpOffsets.GetData(), Map.QpOffsets.Num());
+		Map.AverageQpOffset = 0.0f;
+		return true;
+	}
+
+	const float InnerCos = FMath::Cos(FMath::DegreesToRadians(Settings.InnerDegrees));
+	const float OuterCos = FMath::Cos(FMath::DegreesToRadians(Settings.OuterDegrees));
+	const float InnerRadians = FMath::DegreesToRadians(Settings.InnerDegrees);
+	const float RangeRadians = FMath::DegreesToRadians(Settings.OuterDegrees) - InnerRadians;
+	int64 Sum = 0;
+	for (int32 Y = 0; Y < Map.BlocksY; Y++)
+	{
+		const float PixelY = FMath::Min((Y + 0.5f) * BlockSize, (float)Input.FrameSize.Y);
+		for (int32 X = 0; X < Map.BlocksX; X++)
+		{
+			const float PixelX = FMath::Min((X + 0.5f) * BlockSize, (float)Input.FrameSize.X);
+			const int32 Eye = PixelX < EyeWidth || EyeCount == 1 ? 0 : 1;
+			const FPICOXRDPEyeFov& Fov = Input.Fov[Eye];
+			const float U = (PixelX - Eye * EyeWidth) / EyeWidth;
+			const float V = PixelY / Input.FrameSize.Y;
+			const float TanX = FMath::Lerp(FMath::Tan(Fov.Left), FMath::Tan(Fov.Right), U);
+			const float TanY = FMath::Lerp(FMath::Tan(Fov.Up), FMath::Tan(Fov.Down), V);
+			const float Cos = FVector::DotProduct(FVector(1.0f, TanX, TanY).GetSafeNormal(), Directions[Eye]);
+
+			int32 Offset;
+			if (Cos >= InnerCos)
+			{
+				Offset = Settings.InnerQpOffset;
+			}
+			else if (Cos <= OuterCos || RangeRadians <= 0.0f)
+			{
+				Offset = Settings.OuterQpOffset;
+			}
+			else
+			{
+				const float Alpha = (FMath::Acos(Cos) - InnerRadians) / RangeRadians;
+				Offset = FMath::RoundToInt(FMath::Lerp((float)Settings.InnerQpOffset, (float)Settings.OuterQpOffset, Alpha));
+			}
+			Offset = FMath::Clamp(Offset, -51, 51);
+			Map.QpOffsets[Y * Map.BlocksX + X] = (int8)Offset;
+			Sum += Offset;
+		}
+	}
+	Map.AverageQpOffset = Map.QpOffsets.Num() > 0 ? (float)Sum / Map.QpOffsets.Num() : 0.0f;
+	return true;
+}
+
+FPICOXRDPPeripheryLayout FPICOXRDPQualityMapBuilder::GetPeripheryLayout(float PeripheryScale) const
+{
+	FPICOXRDPPeripheryLayout Layout;
+	Layout.PeripheryScale = FMath::Clamp(PeripheryScale, 0.0f, 1.0f);
+	const int32 FrameWidth = LastInput.FrameSize.X;
+	const int32 EyeCount = FMath::Clamp(LastInput.EyeCount, 1, 2);
+	const int32 EyeWidth = FrameWidth / EyeCount;
+	for (int32 Eye = 0; Eye < EyeCount; Eye++)
+	{
+		FIntPoint Min(Map.BlocksX, Map.BlocksY);
+		FIntPoint Max(-1, -1);
+		for (int32 Y = 0; Y < Map.BlocksY; Y++)
+		{
+			for (int32 X = 0; X < Map.BlocksX; X++)
+			{
+				const int32 PixelX = FMath::Min(X * Map.BlockSize + Map.BlockSize / 2, FrameWidth);
+				if ((PixelX < EyeWidth || EyeCount == 1 ? 0 : 1) == Eye && Map.GetQpOffset(X, Y) < Settings.OuterQpOffset)
+				{
+					Min = FIntPoint(FMath::Min(Min.X, X), FMath::Min(Min.Y, Y));
+					Max = FIntPoint(FMath::Max(Max.X, X), FMath::Max(Max.Y, Y));
+				}
+			}
+		}
+
+		// Nothing within OuterDegrees, the focus block alone keeps its resolution.
+		if (Max.X < 0)
+		{
+			Min = FIntPoint(FMath::FloorToInt(Map.Focus[Eye].X), FMath::FloorToInt(Map.Focus[Eye].Y));
+			Max = Min;
+		}
+		Layout.FocusMin[Eye] = FIntPoint(Min.X * Map.BlockSize, Min.Y * Map.BlockSize);
+		Layout.FocusMax[Eye] = FIntPoint(FMath::Min((Max.X + 1) * Map.BlockSize, FrameWidth), FMath::Min((Max.Y + 1) * Map.BlockSize, LastInput.FrameSize.Y));
+	}
+	if (EyeCount == 1)
+	{
+		Layout.FocusMin[1] = Layout.FocusMin[0];
+		Layout.FocusMax[1] = Layout.FocusMax[0];
+	}
+	return Layout;
+}
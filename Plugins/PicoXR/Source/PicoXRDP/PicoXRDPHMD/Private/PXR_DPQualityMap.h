@@ -0,0 +1,115 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "PXR_DPEncoder.h"
+
+enum class EPICOXRFoveationLevel : uint8;
+
+enum class EPICOXRDPQualityFocus : uint8
+{
+	// Every block at the same quality.
+	Uniform,
+	// Quality falls off from where the optical axis crosses each eye.
+	LensCenter,
+	// Quality falls off from where the gaze crosses each eye, from the lens center while the gaze is not tracked.
+	Gaze,
+};
+
+/** Half angles of an eye in radians, as FPICOXRFrustumDP keeps them. */
+struct FPICOXRDPEyeFov
+{
+	float Left = -0.829031f;
+	float Right = 0.829031f;
+	float Up = 0.829031f;
+	float Down = -0.829031f;
+};
+
+struct FPICOXRDPQualityMapSettings
+{
+	EPICOXRDPQualityFocus Focus = EPICOXRDPQualityFocus::LensCenter;
+	// Pixels per side of a block, the encoder's macroblock.
+	int32 BlockSize = 16;
+	// Blocks within InnerDegrees of the focus get InnerQpOffset, blocks beyond OuterDegrees OuterQpOffset, blocks between a blend.
+	float InnerDegrees = 15.0f;
+	float OuterDegrees = 40.0f;
+	int32 InnerQpOffset = -2;
+	int32 OuterQpOffset = 8;
+	// The focus has to move by this many blocks before the map is built again.
+	float RebuildBlocks = 0.5f;
+
+	/** Falloff matching a foveation level of the headset, centered on the lens. */
+	static FPICOXRDPQualityMapSettings ForFoveation(EPICOXRFoveationLevel Level);
+};
+
+/** What a frame's map is built from. The frame holds both eyes side by side, or the left eye alone. */
+struct FPICOXRDPQualityMapInput
+{
+	FIntPoint FrameSize = FIntPoint::ZeroValue;
+	// 1 for a frame of the left eye alone, the right eye then takes the focus of the left one.
+	int32 EyeCount = 2;
+	FPICOXRDPEyeFov Fov[2];
+	// Gaze of each eye in eye space, X forward, Y right and Z up. Only read with the Gaze focus.
+	FVector Gaze[2];
+	bool bGazeValid = false;
+};
+
+/** QP offset of every block, rows top down, added to what the encoder's rate control picks. */
+struct FPICOXRDPQualityMap
+{
+	int32 BlockSize = 16;
+	int32 BlocksX = 0;
+	int32 BlocksY = 0;
+	TArray<int8> QpOffsets;
+	// Focus of each eye in blocks.
+	FVector2D Focus[2];
+	float AverageQpOffset = 0.0f;
+
+	int8 GetQpOffset(int32 X, int32 Y) const { return QpOffsets[Y * BlocksX + X]; }
+
+	/** Quality setting closest to the map, for encoders that take no per block hints. */
+	EPICOXRDPEncodeQuality GetEncodeQuality() const;
+};
+
+/** Region of an eye that keeps its resolution when the periphery is scaled down, in pixels of the frame. */
+struct FPICOXRDPPeripheryLayout
+{
+	FIntPoint FocusMin[2];
+	FIntPoint FocusMax[2];
+	// Scale of everything outside the focus region.
+	float PeripheryScale = 1.0f;
+};
+
+/**
+ * Builds the per block QP offsets of each frame from the lens centers, the gaze or a foveation level.
+ * The map is built again only when the frame size, the settings or the focus change, into the same array.
+ */
+class FPICOXRDPQualityMapBuilder
+{
+public:
+	void SetSettings(const FPICOXRDPQualityMapSettings& InSettings);
+	const FPICOXRDPQualityMapSettings& GetSettings() const { return Settings; }
+
+	/** @return true if the map was built again, false if the last one still holds. */
+	bool Build(const FPICOXRDPQualityMapInput& Input);
+
+	const FPICOXRDPQualityMap& GetMap() const { return Map; }
+
+	/**
+	 * Blocks of each eye up to OuterDegrees from the focus, the region to keep at full resolution when the periphery
+	 * is scaled by PeripheryScale.
+	 */
+	FPICOXRDPPeripheryLayout GetPeripheryLayout(float PeripheryScale) const;
+
+	/** Where Direction crosses an eye with Fov, 0 to 1 from the left and from the top. */
+	static FVector2D ProjectToEye(const FVector& Direction, const FPICOXRDPEyeFov& Fov);
+
+	uint64 GetBuilds() const { return Builds; }
+
+private:
+	FPICOXRDPQualityMapSettings Settings;
+	FPICOXRDPQualityMap Map;
+	FPICOXRDPQualityMapInput LastInput;
+	bool bDirty = true;
+	uint64 Builds = 0;
+};
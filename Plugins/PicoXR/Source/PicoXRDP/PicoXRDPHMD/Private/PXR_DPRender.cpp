@@ -57,6 +57,43 @@ void FPICODirectPreviewHMD::RenderTexture_RenderThread(FRHICommandListImmediate&
 
 void FPICODirectPreviewHMD::PostRenderView_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneView& InView)
 {
+	check(IsInRenderingThread());
+	if (InView.StereoPass != eSSP_LEFT_EYE && InView.StereoPass != eSSP_RIGHT_EYE)
+	{
+		return;
+	}
+
+	// The matrices the stereo layers of this eye are projected with, built as FDefaultStereoLayers builds them
+	const int32 Eye = InView.StereoPass == eSSP_RIGHT_EYE ? 1 : 0;
+	FViewMatrices ViewMatrices = InView.ViewMatrices;
+	ViewMatrices.HackRemoveTemporalAAProjectionJitter();
+	const FMatrix& ProjectionMatrix = ViewMatrices.GetProjectionMatrix();
+
+	FQuat EyeOrientation = FQuat::Identity;
+	FVector EyeOffset = FVector::ZeroVector;
+	GetRelativeEyePose(IXRTrackingSystem::HMDDeviceId, InView.StereoPass, EyeOrientation, EyeOffset);
+	const FMatrix EyeMatrix = FTranslationMatrix(-EyeOffset) * FInverseRotationMatrix(EyeOrientation.Rotator()) * FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+
+	FQuat HmdOrientation = FQuat::Identity;
+	FVector HmdPosition = FVector::ZeroVector;
+	GetCurrentPose(IXRTrackingSystem::HMDDeviceId, HmdOrientation, HmdPosition);
+	const FMatrix TrackerMatrix = FTranslationMatrix(-HmdPosition) * FInverseRotationMatrix(HmdOrientation.Rotator()) * EyeMatrix;
+
+	FMatrix* Matrices = LayerMatricesRenderThread[Eye];
+	Matrices[(int32)EPICOXRDPLayerSpace::World] = ViewMatrices.GetViewProjectionMatrix();
+	Matrices[(int32)EPICOXRDPLayerSpace::Tracker] = TrackerMatrix * ProjectionMatrix;
+	Matrices[(int32)EPICOXRDPLayerSpace::Face] = EyeMatrix * ProjectionMatrix;
+
+	// A space whose matrices did not change in either eye leaves its cached layers as they are
+	for (int32 Space = 0; Space < (int32)EPICOXRDPLayerSpace::Count; Space++)
+	{
+		LayerViewRenderThread.SpaceHashes[Space] = FCrc::MemCrc32(&LayerMatricesRenderThread[1][Space], sizeof(FMatrix),
+			FCrc::MemCrc32(&LayerMatricesRenderThread[0][Space], sizeof(FMatrix)));
+	}
 }
 #if ENGINE_MINOR_VERSION >26
 bool FPICODirectPreviewHMD::IsActiveThisFrame_Internal(const FSceneViewExtensionContext& Context) const
@@ -13,6 +13,7 @@
 #include "PipelineStateCache.h"
 #include "ClearQuad.h"
 #include "DefaultSpectatorScreenController.h"
+#include "PXR_DPLayerRenderer.h"
 
 #if PLATFORM_LINUX
 #include "VulkanRHIPrivate.h"
@@ -146,10 +147,14 @@ void FPICODirectPreviewHMD::CopyTexture_RenderThread(FRHICommandListImmediate& R
 	RHICmdList.EndRenderPass();
 	if (CurrentDirectPreview)
 	{
-		if (CurrentDirectPreview->LeftTempTexture&&CurrentDirectPreview->RightTempTexture)
+		const int32 Slot = CurrentDirectPreview->BeginEyeTextures_RenderThread(FIntPoint(SrcTexture->GetSizeX(), SrcTexture->GetSizeY()));
+		if (Slot != INDEX_NONE)
 		{
-			TransferImage_RenderThread(RHICmdList, SrcTexture, FIntRect(), CurrentDirectPreview->LeftTempTexture, FIntRect(), true, true);
-			TransferImage_RenderThread(RHICmdList, SrcTexture, FIntRect(), CurrentDirectPreview->RightTempTexture, FIntRect(), false, true);
+			TransferImage_RenderThread(RHICmdList, SrcTexture, FIntRect(), CurrentDirectPreview->GetEyeTexture(Slot, 0), FIntRect(), true, true);
+			TransferImage_RenderThread(RHICmdList, SrcTexture, FIntRect(), CurrentDirectPreview->GetEyeTexture(Slot, 1), FIntRect(), false, true);
+			FPICODPLayerRenderer LayerRenderer(RHICmdList, *RendererModule, LayerMatricesRenderThread);
+			CurrentDirectPreview->CompositeLayers_RenderThread(LayerRenderer, Slot, LayerViewRenderThread, LayerInputsRenderThread);
+			CurrentDirectPreview->EndEyeTextures_RenderThread(RHICmdList, Slot);
 		}
 	}
 }
@@ -19,6 +19,7 @@ void SetLayerDescMember(FPICODPLayer& Layer, const IStereoLayers::FLayerDesc& In
 	if (InLayerDesc.Texture != Layer.LayerDesc.Texture)
 	{
 		Layer.bUpdateTexture = true;
+		Layer.TextureRevision++;
 	}
 	Layer.LayerDesc = InLayerDesc;
 }
@@ -36,6 +37,81 @@ void MarkLayerTextureForUpdate(FPICODPLayer& Layer)
 {
 	PXR_LOGD(PxrUnreal,"PXR_DP MarkLayerTextureForUpdate Layer ID:%d", Layer.GetLayerId());
 	Layer.bUpdateTexture = true;
+	Layer.TextureRevision++;
+}
+
+//=============================================================================
+bool GetLayerInput(const FPICODPLayer& Layer, FPICOXRDPLayerInput& OutInput)
+{
+	const IStereoLayers::FLayerDesc& LayerDesc = Layer.LayerDesc;
+	FRHITexture2D* Texture = LayerDesc.Texture.IsValid() ? LayerDesc.Texture->GetTexture2D() : nullptr;
+	if (!Texture)
+	{
+		return false;
+	}
+#if ENGINE_MINOR_VERSION >24
+	if (LayerDesc.Flags & IStereoLayers::LAYER_FLAG_HIDDEN)
+	{
+		return false;
+	}
+#endif
+
+	FPICOXRDPOverlayLayer& Overlay = OutInput.Layer;
+	Overlay.Id = LayerDesc.GetLayerId();
+	Overlay.Priority = LayerDesc.Priority;
+	switch (LayerDesc.PositionType)
+	{
+	case IStereoLayers::WorldLocked:
+		Overlay.Space = EPICOXRDPLayerSpace::World;
+		break;
+	case IStereoLayers::TrackerLocked:
+		Overlay.Space = EPICOXRDPLayerSpace::Tracker;
+		break;
+	default:
+		Overlay.Space = EPICOXRDPLayerSpace::Face;
+		break;
+	}
+	Overlay.Position = LayerDesc.Transform.GetLocation();
+	Overlay.Rotation = LayerDesc.Transform.GetRotation();
+	Overlay.Scale = LayerDesc.Transform.GetScale3D();
+
+	Overlay.QuadSize = LayerDesc.QuadSize;
+	if (LayerDesc.Flags & IStereoLayers::LAYER_FLAG_QUAD_PRESERVE_TEX_RATIO)
+	{
+		const float AspectRatio = Texture->GetSizeY() > 0 ? (float)Texture->GetSizeX() / (float)Texture->GetSizeY() : 1.0f;
+		Overlay.QuadSize.Y = Overlay.QuadSize.X / AspectRatio;
+	}
+#if ENGINE_MINOR_VERSION >24
+	if (LayerDesc.HasShape<FCylinderLayer>())
+	{
+		const FCylinderLayer& Cylinder = LayerDesc.GetShape<FCylinderLayer>();
+		Overlay.Shape = EPICOXRDPLayerShape::Cylinder;
+		Overlay.CylinderRadius = Cylinder.Radius;
+		Overlay.CylinderArc = Cylinder.OverlayArc;
+		Overlay.CylinderHeight = Cylinder.Height;
+	}
+#else
+	if (LayerDesc.ShapeType == IStereoLayers::CylinderLayer)
+	{
+		Overlay.Shape = EPICOXRDPLayerShape::Cylinder;
+		Overlay.CylinderRadius = LayerDesc.CylinderRadius;
+		Overlay.CylinderArc = LayerDesc.CylinderOverlayArc;
+		Overlay.CylinderHeight = LayerDesc.CylinderHeight;
+	}
+#endif
+	else
+	{
+		Overlay.Shape = EPICOXRDPLayerShape::Quad;
+	}
+	Overlay.UVMin = LayerDesc.UVRect.Min;
+	Overlay.UVMax = LayerDesc.UVRect.Max;
+	Overlay.bNoAlpha = (LayerDesc.Flags & IStereoLayers::LAYER_FLAG_TEX_NO_ALPHA_CHANNEL) != 0;
+	Overlay.TextureSize = Texture->GetSizeXY();
+
+	OutInput.Texture = Texture;
+	OutInput.TextureRevision = Layer.TextureRevision;
+	OutInput.bContinuousUpdate = (LayerDesc.Flags & IStereoLayers::LAYER_FLAG_TEX_CONTINUOUS_UPDATE) != 0;
+	return true;
 }
 
 
@@ -0,0 +1,115 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPTerminal.h"
+#include "PXR_DPTextureRing.h"
+#include "PXR_Log.h"
+#if PLATFORM_WINDOWS
+#include "PXR_DPAccessories.h"
+#include <string>
+#endif
+
+#if PLATFORM_WINDOWS
+namespace
+{
+	using namespace pxr;
+	using namespace pxr::connector;
+
+	/**
+	 * The streamer's terminal, eye layers go to the runtime as kSubmitEyeLayer messages.
+	 * TerminalMessage has no type for overlay layers, so they are left to the compositor.
+	 */
+	class FConnectorTerminal : public IPICOXRDPTerminal
+	{
+	public:
+		FConnectorTerminal(TerminalInterface* InTerminal, uint32 InRuntimeId, FPICOXRDPAccessorySnapshot& InAccessories)
+			: Terminal(InTerminal)
+			, RuntimeId(InRuntimeId)
+			, Accessories(InAccessories)
+		{}
+
+		virtual bool QueryHmdPose(uint64 Frame, FPICOXRDPPoseSample& OutPose) override
+		{
+			HmdAccessory Hmd;
+			Accessories.GetHmd(FPICOXRDPAccessorySnapshot::GetCurrentReader(), Frame, Hmd);
+			p_vector3_f Position;
+			Hmd.GetPosition_(Position);
+			p_vector4_f Rotation;
+			Hmd.GetRotation_(Rotation);
+			OutPose.Position = FVector(Position.x, Position.y, Position.z);
+			OutPose.Rotation = FQuat(Rotation.x, Rotation.y, Rotation.z, Rotation.w);
+			OutPose.RemoteTimestamp = Hmd.GetTimestamp_();
+			OutPose.RemoteIndex = Hmd.GetIndex_();
+			OutPose.HostTime = FPlatformTime::Seconds();
+			return true;
+		}
+
+		virtual bool SubmitEyeLayer(const FPICOXRDPEyeLayer& Layer) override
+		{
+			TerminalMessage Message;
+			Message.SetType_(TerminalMessage::Type::kSubmitEyeLayer);
+			Message.SetDestinationTerminalId(RuntimeId);
+
+			std::vector<TerminalMessage::Parameter> Parameters;
+			Parameters.reserve(14);
+			AddParameter(Parameters, "rotation_x", std::to_string(Layer.Rotation.X), TerminalMessage::Parameter::Type::kFloat);
+			AddParameter(Parameters, "rotation_y", std::to_string(Layer.Rotation.Y), TerminalMessage::Parameter::Type::kFloat);
+			AddParameter(Parameters, "rotation_z", std::to_string(Layer.Rotation.Z), TerminalMessage::Parameter::Type::kFloat);
+			AddParameter(Parameters, "rotation_w", std::to_string(-Layer.Rotation.W), TerminalMessage::Parameter::Type::kFloat);
+			AddParameter(Parameters, "position_x", std::to_string(Layer.Position.X), TerminalMessage::Parameter::Type::kFloat);
+			AddParameter(Parameters, "position_y", std::to_string(Layer.Position.Y), TerminalMessage::Parameter::Type::kFloat);
+			AddParameter(Parameters, "position_z", std::to_string(Layer.Position.Z), TerminalMessage::Parameter::Type::kFloat);
+			AddParameter(Parameters, "left_eye", std::to_string(Layer.EyeHandles[0]), TerminalMessage::Parameter::Type::kUInt64);
+			AddParameter(Parameters, "right_eye", std::to_string(Layer.EyeHandles[1]), TerminalMessage::Parameter::Type::kUInt64);
+			AddParameter(Parameters, "frame", std::to_string(Layer.Frame), TerminalMessage::Parameter::Type::kUInt64);
+			AddParameter(Parameters, "pose_timestamp", std::to_string(Layer.PoseTimestamp), TerminalMessage::Parameter::Type::kInt64);
+			AddParameter(Parameters, "pose_index", std::to_string(Layer.PoseIndex), TerminalMessage::Parameter::Type::kUInt64);
+			AddParameter(Parameters, "render_timestamp", std::to_string(Layer.RenderTimestamp), TerminalMessage::Parameter::Type::kInt64);
+			AddParameter(Parameters, "display_timestamp", std::to_string(Layer.DisplayTimestamp), TerminalMessage::Parameter::Type::kInt64);
+			Message.SetParameters(Parameters);
+
+			return Terminal && Terminal->PushMessage(Message) == IDPInterface::IResult::kOK;
+		}
+
+	private:
+		static void AddParameter(std::vector<TerminalMessage::Parameter>& Parameters, const char* Describe, std::string&& Value, TerminalMessage::Parameter::Type Type)
+		{
+			TerminalMessage::Parameter Parameter;
+			Parameter.describe = Describe;
+			Parameter.parameter = MoveTemp(Value);
+			Parameter.type = Type;
+			Parameters.push_back(MoveTemp(Parameter));
+		}
+
+		TerminalInterface* Terminal;
+		uint32 RuntimeId;
+		FPICOXRDPAccessorySnapshot& Accessories;
+	};
+}
+
+TSharedRef<IPICOXRDPTerminal, ESPMode::ThreadSafe> IPICOXRDPTerminal::CreateConnector(pxr::connector::TerminalInterface* Terminal, uint32 RuntimeId, FPICOXRDPAccessorySnapshot& Accessories)
+{
+	return MakeShared<FConnectorTerminal, ESPMode::ThreadSafe>(Terminal, RuntimeId, Accessories);
+}
+#endif
+
+bool IPICOXRDPTerminal::SubmitLatest(const FPICOXRDPTextureRingFrame& Latest, const FPICOXRDPPoseTimeline& Timeline)
+{
+	if (Latest.Slot == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FPICOXRDPEyeLayer Layer;
+	Layer.Frame = Latest.Frame;
+	Layer.EyeHandles[0] = Latest.EyeHandles[0];
+	Layer.EyeHandles[1] = Latest.EyeHandles[1];
+
+	// The pose of the frame's own render, the remote reprojects by it. The current one is the best guess without it.
+	FPICOXRDPPoseSample Pose;
+	if (!Timeline.FindByFrame(Layer.Frame, Pose))
+	{
+		QueryHmdPose(Layer.Frame, Pose);
+	}
+	Timeline.StampLayer(Layer, Pose);
+	return SubmitEyeLayer(Layer);
+}
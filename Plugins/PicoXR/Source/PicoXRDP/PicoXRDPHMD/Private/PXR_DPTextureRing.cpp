@@ -0,0 +1,387 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPTextureRing.h"
+#include "PXR_Log.h"
+#include "Misc/ScopeLock.h"
+#if PLATFORM_WINDOWS
+#include "D3D11RHIPrivate.h"
+#endif
+
+namespace
+{
+	/** Provider of platforms without shared D3D11 textures, every slot fails to be created. */
+	class FNullSharedTextureProvider : public IPICOXRDPSharedTextureProvider
+	{
+	public:
+		virtual bool CreateSlot(int32 Slot, FIntPoint EyeSize) override { return false; }
+		virtual void DestroySlot(int32 Slot) override {}
+		virtual bool AcquireSlot(int32 Slot, uint32 TimeoutMs) override { return false; }
+		virtual void ReleaseSlot(int32 Slot, bool bToStreamer) override {}
+		virtual uint64 GetSharedHandle(int32 Slot, int32 Eye) const override { return 0; }
+		virtual FRHITexture2D* GetTexture(int32 Slot, int32 Eye) const override { return nullptr; }
+	};
+
+#if PLATFORM_WINDOWS
+	/**
+	 * Shared D3D11 textures, opened by the streamer through their legacy DXGI handles.
+	 * With a keyed mutex the renderer writes a slot under key 0 and releases it to the streamer with key 1,
+	 * the streamer reads under key 1 and releases it back with key 0. A slot the streamer skipped still holds key 1
+	 * and is taken back unread.
+	 */
+	class FD3D11SharedTextureProvider : public IPICOXRDPSharedTextureProvider
+	{
+	public:
+		static const uint64 RendererKey = 0;
+		static const uint64 StreamerKey = 1;
+
+		explicit FD3D11SharedTextureProvider(bool bInKeyedMutex)
+			: bKeyedMutex(bInKeyedMutex)
+		{}
+
+		virtual bool CreateSlot(int32 Slot, FIntPoint EyeSize) override
+		{
+			ID3D11Device* Device = static_cast<ID3D11Device*>(GDynamicRHI->RHIGetNativeDevice());
+			if (Device == nullptr)
+			{
+				return false;
+			}
+			if (Eyes.Num() < (Slot + 1) * 2)
+			{
+				Eyes.SetNum((Slot + 1) * 2);
+			}
+
+			D3D11_TEXTURE2D_DESC Desc = {};
+			Desc.Width = EyeSize.X;
+			Desc.Height = EyeSize.Y;
+			Desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			Desc.MipLevels = 1;
+			Desc.ArraySize = 1;
+			Desc.SampleDesc.Count = 1;
+			Desc.Usage = D3D11_USAGE_DEFAULT;
+			Desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+			Desc.MiscFlags = bKeyedMutex ? D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX : D3D11_RESOURCE_MISC_SHARED;
+
+			FD3D11DynamicRHI* DynamicRHI = static_cast<FD3D11DynamicRHI*>(GDynamicRHI);
+			for (int32 Eye = 0; Eye < 2; Eye++)
+			{
+				FEye& Target = Eyes[Slot * 2 + Eye];
+				TRefCountPtr<IDXGIResource> Resource;
+				if (FAILED(Device->CreateTexture2D(&Desc, nullptr, Target.Texture.GetInitReference()))
+					|| FAILED(Target.Texture->QueryInterface(Resource.GetInitReference()))
+					|| FAILED(Resource->GetSharedHandle(&Target.Handle))
+					|| (bKeyedMutex && FAILED(Target.Texture->QueryInterface(Target.Mutex.GetInitReference()))))
+				{
+					DestroySlot(Slot);
+					return false;
+				}
+				Target.RHITexture = DynamicRHI->RHICreateTexture2DFromResource(
+					PF_R8G8B8A8, TexCreate_RenderTargetable | TexCreate_ShaderResource, FClearValueBinding::None, Target.Texture).GetReference();
+				if (!Target.RHITexture.IsValid())
+				{
+					DestroySlot(Slot);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		virtual void DestroySlot(int32 Slot) override
+		{
+			for (int32 Eye = 0; Eye < 2 && Slot * 2 + Eye < Eyes.Num(); Eye++)
+			{
+				Eyes[Slot * 2 + Eye] = FEye();
+			}
+		}
+
+		virtual bool AcquireSlot(int32 Slot, uint32 TimeoutMs) override
+		{
+			if (!bKeyedMutex)
+			{
+				return true;
+			}
+			if (!AcquireEye(Eyes[Slot * 2], TimeoutMs))
+			{
+				return false;
+			}
+			if (!AcquireEye(Eyes[Slot * 2 + 1], TimeoutMs))
+			{
+				Eyes[Slot * 2].Mutex->ReleaseSync(Eyes[Slot * 2].AcquiredKey);
+				return false;
+			}
+			return true;
+		}
+
+		virtual void ReleaseSlot(int32 Slot, bool bToStreamer) override
+		{
+			if (!bKeyedMutex)
+			{
+				return;
+			}
+			for (int32 Eye = 0; Eye < 2; Eye++)
+			{
+				FEye& Target = Eyes[Slot * 2 + Eye];
+				Target.Mutex->ReleaseSync(bToStreamer ? StreamerKey : Target.AcquiredKey);
+			}
+		}
+
+		virtual bool IsSynchronized() const override
+		{
+			// The streamer releasing the keyed mutex is the only word of it being done, the connector has no acknowledgement.
+			return bKeyedMutex;
+		}
+
+		virtual uint64 GetSharedHandle(int32 Slot, int32 Eye) const override
+		{
+			return HandleToULong(Eyes[Slot * 2 + Eye].Handle);
+		}
+
+		virtual FRHITexture2D* GetTexture(int32 Slot, int32 Eye) const override
+		{
+			return Eyes[Slot * 2 + Eye].RHITexture;
+		}
+
+	private:
+		struct FEye
+		{
+			TRefCountPtr<ID3D11Texture2D> Texture;
+			TRefCountPtr<IDXGIKeyedMutex> Mutex;
+			FTexture2DRHIRef RHITexture;
+			HANDLE Handle = nullptr;
+			uint64 AcquiredKey = RendererKey;
+		};
+
+		static bool AcquireEye(FEye& Target, uint32 TimeoutMs)
+		{
+			if (Target.Mutex->AcquireSync(RendererKey, 0) == S_OK)
+			{
+				Target.AcquiredKey = RendererKey;
+				return true;
+			}
+			if (Target.Mutex->AcquireSync(StreamerKey, 0) == S_OK)
+			{
+				Target.AcquiredKey = StreamerKey;
+				return true;
+			}
+			if (TimeoutMs > 0 && Target.Mutex->AcquireSync(RendererKey, TimeoutMs) == S_OK)
+			{
+				Target.AcquiredKey = RendererKey;
+				return true;
+			}
+			return false;
+		}
+
+		bool bKeyedMutex;
+		TArray<FEye> Eyes;
+	};
+#endif
+}
+
+TSharedRef<IPICOXRDPSharedTextureProvider> IPICOXRDPSharedTextureProvider::CreateDefault(bool bKeyedMutex)
+{
+#if PLATFORM_WINDOWS
+	return MakeShared<FD3D11SharedTextureProvider>(bKeyedMutex);
+#else
+	return MakeShared<FNullSharedTextureProvider>();
+#endif
+}
+
+FPICOXRDPTextureRing::FPICOXRDPTextureRing(TSharedPtr<IPICOXRDPSharedTextureProvider> InProvider, const FPICOXRDPTextureRingSettings& InSettings)
+	: Provider(InProvider.IsValid() ? InProvider.ToSharedRef() : IPICOXRDPSharedTextureProvider::CreateDefault(false))
+	, Settings(InSettings)
+{
+}
+
+FPICOXRDPTextureRing::~FPICOXRDPTextureRing()
+{
+	Reset();
+}
+
+void FPICOXRDPTextureRing::SetProvider(TSharedPtr<IPICOXRDPSharedTextureProvider> InProvider)
+{
+	Reset();
+	FailedDepth = 0;
+	Provider = InProvider.IsValid() ? InProvider.ToSharedRef() : IPICOXRDPSharedTextureProvider::CreateDefault(false);
+}
+
+bool FPICOXRDPTextureRing::Configure(const FPICOXRDPTextureRingSettings& InSettings, FIntPoint InEyeSize)
+{
+	const int32 Depth = FMath::Max(InSettings.Depth, 1);
+	Settings = InSettings;
+	if (Slots.Num() == Depth && EyeSize == InEyeSize)
+	{
+		return true;
+	}
+	if (Slots.Num() == 0 && FailedDepth == Depth && FailedEyeSize == InEyeSize)
+	{
+		return false;
+	}
+	for (const FSlot& Slot : Slots)
+	{
+		if (Slot.State == EPICOXRDPTextureSlotState::Writing)
+		{
+			return false;
+		}
+	}
+
+	if (Slots.Num() > 0)
+	{
+		Stats.Recreations++;
+	}
+	Reset();
+	if (InEyeSize.X <= 0 || InEyeSize.Y <= 0)
+	{
+		return false;
+	}
+
+	for (int32 Slot = 0; Slot < Depth; Slot++)
+	{
+		if (!Provider->CreateSlot(Slot, InEyeSize))
+		{
+			for (int32 Created = 0; Created < Slot; Created++)
+			{
+				Provider->DestroySlot(Created);
+			}
+			Stats.CreateFailures++;
+			FailedDepth = Depth;
+			FailedEyeSize = InEyeSize;
+			PXR_LOGE(PxrUnreal, "PXR_DP failed to create %d shared eye textures of %dx%d", Depth, InEyeSize.X, InEyeSize.Y);
+			return false;
+		}
+	}
+	Slots.SetNum(Depth);
+	EyeSize = InEyeSize;
+	PXR_LOGD(PxrUnreal, "PXR_DP created %d shared eye textures of %dx%d", Depth, EyeSize.X, EyeSize.Y);
+	return true;
+}
+
+void FPICOXRDPTextureRing::Reset()
+{
+	for (int32 Slot = 0; Slot < Slots.Num(); Slot++)
+	{
+		if (Slots[Slot].State == EPICOXRDPTextureSlotState::Writing)
+		{
+			Provider->ReleaseSlot(Slot, false);
+		}
+		Provider->DestroySlot(Slot);
+	}
+	Slots.Reset();
+	EyeSize = FIntPoint::ZeroValue;
+	LatestSlot = INDEX_NONE;
+	Generation++;
+}
+
+int32 FPICOXRDPTextureRing::BeginWrite()
+{
+	const int32 Depth = Slots.Num();
+	if (Depth == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	// Oldest first, so the slot submitted last, the one the streamer most likely reads, is tried last.
+	const int32 Newest = LatestSlot == INDEX_NONE ? Depth - 1 : LatestSlot;
+	int32 Oldest = INDEX_NONE;
+	for (int32 Step = 1; Step <= Depth; Step++)
+	{
+		const int32 Slot = (Newest + Step) % Depth;
+		if (Slots[Slot].State == EPICOXRDPTextureSlotState::Writing)
+		{
+			continue;
+		}
+		if (Oldest == INDEX_NONE)
+		{
+			Oldest = Slot;
+		}
+		if (Provider->AcquireSlot(Slot, 0))
+		{
+			return TakeSlot(Slot);
+		}
+	}
+
+	// The streamer holds every slot, wait for the one it got first.
+	if (Oldest != INDEX_NONE && Settings.AcquireTimeoutMs > 0 && Provider->IsSynchronized())
+	{
+		const double WaitStart = FPlatformTime::Seconds();
+		const bool bAcquired = Provider->AcquireSlot(Oldest, Settings.AcquireTimeoutMs);
+		const double Waited = FPlatformTime::Seconds() - WaitStart;
+		Stats.AcquireWaits++;
+		Stats.AcquireWaitSeconds += Waited;
+		Stats.PeakAcquireWaitSeconds = FMath::Max(Stats.PeakAcquireWaitSeconds, Waited);
+		if (bAcquired)
+		{
+			return TakeSlot(Oldest);
+		}
+	}
+	Stats.DroppedFrames++;
+	return INDEX_NONE;
+}
+
+int32 FPICOXRDPTextureRing::TakeSlot(int32 Slot)
+{
+	Slots[Slot].PreviousState = Slots[Slot].State;
+	Slots[Slot].State = EPICOXRDPTextureSlotState::Writing;
+	return Slot;
+}
+
+bool FPICOXRDPTextureRing::EndWrite(int32 Slot, uint64 Frame)
+{
+	if (!Slots.IsValidIndex(Slot) || Slots[Slot].State != EPICOXRDPTextureSlotState::Writing)
+	{
+		return false;
+	}
+	Provider->ReleaseSlot(Slot, true);
+	Slots[Slot].State = EPICOXRDPTextureSlotState::Submitted;
+	Slots[Slot].Frame = Frame;
+	LatestSlot = Slot;
+	Stats.Frames++;
+	return true;
+}
+
+bool FPICOXRDPTextureRing::CancelWrite(int32 Slot)
+{
+	if (!Slots.IsValidIndex(Slot) || Slots[Slot].State != EPICOXRDPTextureSlotState::Writing)
+	{
+		return false;
+	}
+	Provider->ReleaseSlot(Slot, false);
+	Slots[Slot].State = Slots[Slot].PreviousState;
+	return true;
+}
+
+FPICOXRDPTextureRingFrame FPICOXRDPTextureRing::GetLatestFrame() const
+{
+	FPICOXRDPTextureRingFrame Latest;
+	Latest.Generation = Generation;
+	if (LatestSlot != INDEX_NONE)
+	{
+		Latest.Slot = LatestSlot;
+		Latest.Frame = Slots[LatestSlot].Frame;
+		Latest.EyeHandles[0] = Provider->GetSharedHandle(LatestSlot, 0);
+		Latest.EyeHandles[1] = Provider->GetSharedHandle(LatestSlot, 1);
+	}
+	return Latest;
+}
+
+void FPICOXRDPPublishedFrame::Publish(const FPICOXRDPTextureRingFrame& Frame)
+{
+	FScopeLock ScopeLock(&Lock);
+	// Generations only grow, so a frame queued before its slots were dropped is older than the withdrawn one.
+	if ((int32)(Frame.Generation - Generation) >= 0)
+	{
+		Latest = Frame;
+		Generation = Frame.Generation;
+	}
+}
+
+void FPICOXRDPPublishedFrame::Withdraw(uint32 InGeneration)
+{
+	FScopeLock ScopeLock(&Lock);
+	Latest = FPICOXRDPTextureRingFrame();
+	Generation = InGeneration;
+}
+
+FPICOXRDPTextureRingFrame FPICOXRDPPublishedFrame::Get() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Latest;
+}
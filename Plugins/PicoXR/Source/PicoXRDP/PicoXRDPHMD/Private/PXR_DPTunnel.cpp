@@ -0,0 +1,523 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPTunnel.h"
+#include "PXR_Log.h"
+#if PLATFORM_WINDOWS
+#include "streamer_api.h"
+#endif
+
+namespace
+{
+	// RTP header, and the header of its extension in front of the extension data.
+	const uint32 RtpHeaderSize = 12;
+	const uint32 RtpExtensionHeaderSize = 4;
+	const uint32 SendTimeOffset = 32;
+
+	void WriteLE(uint8*& Out, uint64 Value, int32 Bytes)
+	{
+		for (int32 Index = 0; Index < Bytes; Index++)
+		{
+			*Out++ = (uint8)(Value >> (8 * Index));
+		}
+	}
+
+	uint64 ReadLE(const uint8*& In, int32 Bytes)
+	{
+		uint64 Value = 0;
+		for (int32 Index = 0; Index < Bytes; Index++)
+		{
+			Value |= (uint64)*In++ << (8 * Index);
+		}
+		return Value;
+	}
+
+	/** Tunnel of platforms without the streamer, it never starts. */
+	class FNullTunnel : public IPICOXRDPTunnel
+	{
+	public:
+		virtual bool Startup(const FPICOXRDPTunnelConfig& Config) override { return false; }
+		virtual void Shutdown() override {}
+		virtual bool Send(const FPICOXRDPTunnelPacket& Packet) override { return false; }
+	};
+
+#if PLATFORM_WINDOWS
+	/** The streamer's DataTunnelInterface. Its packets point at the sender's memory, nothing is copied on the way in. */
+	class FStreamerTunnel : public IPICOXRDPTunnel
+	{
+	public:
+		virtual ~FStreamerTunnel()
+		{
+			Shutdown();
+		}
+
+		virtual bool Startup(const FPICOXRDPTunnelConfig& Config) override
+		{
+			Shutdown();
+			Tunnel = pxr::tunnel::BuildDataTunnel();
+			if (Tunnel == nullptr)
+			{
+				PXR_LOGE(PxrUnreal, "Could not build the direct preview data tunnel");
+				return false;
+			}
+
+			pxr::tunnel::DataTunnelParam Param;
+			switch (Config.Type)
+			{
+			case EPICOXRDPTunnelType::RtpH264: Param.type = pxr::IDPInterface::IDataTunnelType::kRtpH264; break;
+			case EPICOXRDPTunnelType::RtpH265: Param.type = pxr::IDPInterface::IDataTunnelType::kRtpH265; break;
+			case EPICOXRDPTunnelType::RtpAudio: Param.type = pxr::IDPInterface::IDataTunnelType::kRtpAudio; break;
+			default: Param.type = pxr::IDPInterface::IDataTunnelType::kRaw; break;
+			}
+			Param.mode = Config.IsRtp() ? pxr::IDPInterface::IDataTunnelMode::kRtpOut : pxr::IDPInterface::IDataTunnelMode::kRawOut;
+			FMemory::Memcpy(Param.dst_addr.ip, Config.Ip, sizeof(Config.Ip));
+			Param.dst_addr.port = Config.Port;
+			Param.local_port = Config.LocalPort;
+			Param.mtu = Config.Mtu;
+			Param.rate = Config.Rate;
+			if (Tunnel->Startup(Param) != pxr::IDPInterface::IResult::kOK)
+			{
+				PXR_LOGE(PxrUnreal, "Could not start the direct preview data tunnel: %s", pxr::error::GetLastErrorMessage());
+				pxr::tunnel::DestroyDataTunnel(&Tunnel);
+				Tunnel = nullptr;
+				return false;
+			}
+			return true;
+		}
+
+		virtual void Shutdown() override
+		{
+			if (Tunnel)
+			{
+				Tunnel->Shutdown();
+				pxr::tunnel::DestroyDataTunnel(&Tunnel);
+				Tunnel = nullptr;
+			}
+		}
+
+		virtual bool Send(const FPICOXRDPTunnelPacket& Packet) override
+		{
+			if (Tunnel == nullptr)
+			{
+				return false;
+			}
+			pxr::tunnel::DataTunnelPacket DataPacket;
+			DataPacket.SetPayload(const_cast<uint8*>(Packet.Payload));
+			DataPacket.SetPayloadLength(Packet.PayloadLength);
+			if (Packet.Extension)
+			{
+				DataPacket.SetExtensionID(Packet.ExtensionId);
+				DataPacket.SetExtension(const_cast<uint8*>(Packet.Extension));
+				DataPacket.SetExtensionLength(Packet.ExtensionLength);
+			}
+			return Tunnel->SendData(DataPacket) == pxr::IDPInterface::IResult::kOK;
+		}
+
+	private:
+		pxr::tunnel::DataTunnelInterface* Tunnel = nullptr;
+	};
+#endif
+}
+
+TSharedRef<IPICOXRDPTunnel, ESPMode::ThreadSafe> IPICOXRDPTunnel::CreateDefault()
+{
+#if PLATFORM_WINDOWS
+	return MakeShared<FStreamerTunnel, ESPMode::ThreadSafe>();
+#else
+	return MakeShared<FNullTunnel, ESPMode::ThreadSafe>();
+#endif
+}
+
+void FPICOXRDPFragmentHeader::Write(uint8* Out) const
+{
+	WriteLE(Out, Version, 1);
+	WriteLE(Out, Flags, 1);
+	WriteLE(Out, Stream, 1);
+	WriteLE(Out, 0, 1);
+	WriteLE(Out, Sequence, 4);
+	WriteLE(Out, FrameNumber, 4);
+	WriteLE(Out, FragmentIndex, 2);
+	WriteLE(Out, FragmentCount, 2);
+	WriteLE(Out, FrameLength, 4);
+	WriteLE(Out, Offset, 4);
+	WriteLE(Out, CaptureTimeUs, 8);
+	WriteLE(Out, SendTimeUs, 8);
+}
+
+bool FPICOXRDPFragmentHeader::Read(const uint8* In, uint32 Length)
+{
+	if (In == nullptr || Length < Size || In[0] != Version)
+	{
+		return false;
+	}
+	In++;
+	Flags = (uint8)ReadLE(In, 1);
+	Stream = (uint8)ReadLE(In, 1);
+	In++;
+	Sequence = (uint32)ReadLE(In, 4);
+	FrameNumber = (uint32)ReadLE(In, 4);
+	FragmentIndex = (uint16)ReadLE(In, 2);
+	FragmentCount = (uint16)ReadLE(In, 2);
+	FrameLength = (uint32)ReadLE(In, 4);
+	Offset = (uint32)ReadLE(In, 4);
+	CaptureTimeUs = ReadLE(In, 8);
+	SendTimeUs = ReadLE(In, 8);
+	return true;
+}
+
+void FPICOXRDPFragmentHeader::WriteSendTime(uint8* Out, uint64 SendTimeUs)
+{
+	Out += SendTimeOffset;
+	WriteLE(Out, SendTimeUs, 8);
+}
+
+void FPICOXRDPPacketPool::Initialize(int32 SlotCount, uint32 InSlotSize)
+{
+	SlotSize = InSlotSize;
+	Slab.SetNumUninitialized(SlotCount * SlotSize);
+	InUse.Init(false, SlotCount);
+	FreeSlots.Reset(SlotCount);
+	// Handed out from the back, so the first slots are used first.
+	for (int32 Slot = SlotCount - 1; Slot >= 0; Slot--)
+	{
+		FreeSlots.Add(Slot);
+	}
+	PeakInUse = 0;
+}
+
+int32 FPICOXRDPPacketPool::Acquire()
+{
+	if (FreeSlots.Num() == 0)
+	{
+		return INDEX_NONE;
+	}
+	const int32 Slot = FreeSlots.Pop(false);
+	InUse[Slot] = true;
+	PeakInUse = FMath::Max(PeakInUse, InUse.Num() - FreeSlots.Num());
+	return Slot;
+}
+
+void FPICOXRDPPacketPool::Release(int32 Slot)
+{
+	if (InUse.IsValidIndex(Slot) && InUse[Slot])
+	{
+		InUse[Slot] = false;
+		FreeSlots.Add(Slot);
+	}
+}
+
+FPICOXRDPTunnelSender::FPICOXRDPTunnelSender(TSharedPtr<IPICOXRDPTunnel, ESPMode::ThreadSafe> InTunnel, TFunction<double()> InClock)
+	: Tunnel(InTunnel.IsValid() ? InTunnel.ToSharedRef() : IPICOXRDPTunnel::CreateDefault())
+	, Clock(MoveTemp(InClock))
+{
+}
+
+FPICOXRDPTunnelSender::~FPICOXRDPTunnelSender()
+{
+	Shutdown();
+}
+
+bool FPICOXRDPTunnelSender::Startup(const FPICOXRDPTunnelSenderSettings& InSettings)
+{
+	Shutdown();
+
+	Settings = InSettings;
+	Settings.PoolSize = FMath::Max(Settings.PoolSize, 1);
+	if (GetFragmentPayloadSize() == 0)
+	{
+		PXR_LOGE(PxrUnreal, "Direct preview tunnel MTU %u leaves no room for a payload", Settings.Config.Mtu);
+		return false;
+	}
+	if (!Tunnel->Startup(Settings.Config))
+	{
+		return false;
+	}
+
+	// A raw slot holds a whole packet, an RTP slot only the header the extension points at.
+	Pool.Initialize(Settings.PoolSize, Settings.Config.IsRtp() ? FPICOXRDPFragmentHeader::Size : Settings.Config.Mtu);
+	Queue.Reset(Settings.PoolSize);
+	QueueHead = 0;
+	Stats = FPICOXRDPTunnelSenderStats();
+	SendStats = FPICOXRDPTunnelSendStats();
+	Tokens = Settings.BurstBytes;
+	LastRefillTime = Now();
+	SendStatsTime = LastRefillTime;
+	bRunning = true;
+	return true;
+}
+
+void FPICOXRDPTunnelSender::Shutdown()
+{
+	if (!bRunning)
+	{
+		return;
+	}
+	for (int32 Index = QueueHead; Index < Queue.Num(); Index++)
+	{
+		ReleasePacket(Queue[Index]);
+	}
+	Queue.Reset();
+	QueueHead = 0;
+	Tunnel->Shutdown();
+	bRunning = false;
+}
+
+uint32 FPICOXRDPTunnelSender::GetFragmentPayloadSize() const
+{
+	const uint32 Overhead = Settings.Config.IsRtp()
+		? RtpHeaderSize + RtpExtensionHeaderSize + FPICOXRDPFragmentHeader::Size
+		: FPICOXRDPFragmentHeader::Size;
+	return Settings.Config.Mtu > Overhead ? Settings.Config.Mtu - Overhead : 0;
+}
+
+bool FPICOXRDPTunnelSender::QueueFrame(const uint8* Data, uint32 Length, uint32 FrameNumber, double CaptureTime, bool bKeyFrame, TFunction<void()> OnReleased)
+{
+	const uint32 FragmentSize = GetFragmentPayloadSize();
+	const uint32 FragmentCount = FMath::Max(1u, (Length + FragmentSize - 1) / FragmentSize);
+	if (!bRunning || FragmentCount > 0xFFFF || (int32)FragmentCount > Pool.GetNumFree())
+	{
+		// All or nothing, a frame missing fragments is of no use to the remote.
+		Stats.DroppedFrames++;
+		SendStats.PacketsDropped += FragmentCount;
+		if (OnReleased)
+		{
+			OnReleased();
+		}
+		return false;
+	}
+
+	const double Time = Now();
+	FPICOXRDPFragmentHeader Header;
+	Header.FrameNumber = FrameNumber;
+	Header.FragmentCount = (uint16)FragmentCount;
+	Header.FrameLength = Length;
+	Header.CaptureTimeUs = (uint64)(CaptureTime * 1000000.0);
+	Header.Flags = bKeyFrame ? FPICOXRDPFragmentHeader::KeyFrame : 0;
+	Header.Stream = Settings.Stream;
+
+	const bool bRtp = Settings.Config.IsRtp();
+	for (uint32 Index = 0; Index < FragmentCount; Index++)
+	{
+		Header.Sequence = Sequence++;
+		Header.FragmentIndex = (uint16)Index;
+		Header.Offset = Index * FragmentSize;
+		const uint32 FragmentLength = FMath::Min(FragmentSize, Length - Header.Offset);
+
+		const int32 Slot = Pool.Acquire();
+		uint8* SlotData = Pool.GetSlot(Slot);
+		Header.Write(SlotData);
+
+		FQueuedPacket& Packet = Queue.AddDefaulted_GetRef();
+		Packet.Slot = Slot;
+		Packet.QueueTime = Time;
+		if (bRtp)
+		{
+			Packet.Payload = Data + Header.Offset;
+			Packet.PayloadLength = FragmentLength;
+		}
+		else
+		{
+			if (FragmentLength > 0)
+			{
+				FMemory::Memcpy(SlotData + FPICOXRDPFragmentHeader::Size, Data + Header.Offset, FragmentLength);
+			}
+			Packet.Payload = SlotData;
+			Packet.PayloadLength = FPICOXRDPFragmentHeader::Size + FragmentLength;
+			Stats.BytesCopied += FragmentLength;
+		}
+	}
+	Queue.Last().OnReleased = MoveTemp(OnReleased);
+
+	Stats.Frames++;
+	Stats.PeakQueuedPackets = FMath::Max(Stats.PeakQueuedPackets, GetNumQueued());
+	return true;
+}
+
+uint32 FPICOXRDPTunnelSender::GetPacketSize(const FQueuedPacket& Packet) const
+{
+	return Settings.Config.IsRtp()
+		? RtpHeaderSize + RtpExtensionHeaderSize + FPICOXRDPFragmentHeader::Size + Packet.PayloadLength
+		: Packet.PayloadLength;
+}
+
+void FPICOXRDPTunnelSender::RefillTokens(double Time)
+{
+	Tokens = FMath::Min((double)Settings.BurstBytes, Tokens + (Time - LastRefillTime) * Settings.PacingRate);
+	LastRefillTime = Time;
+}
+
+void FPICOXRDPTunnelSender::ReleasePacket(FQueuedPacket& Packet)
+{
+	Pool.Release(Packet.Slot);
+	Packet.Slot = INDEX_NONE;
+	if (Packet.OnReleased)
+	{
+		Packet.OnReleased();
+		Packet.OnReleased = nullptr;
+	}
+}
+
+int32 FPICOXRDPTunnelSender::Pump()
+{
+	if (!bRunning)
+	{
+		return 0;
+	}
+
+	const double Time = Now();
+	RefillTokens(Time);
+	const bool bRtp = Settings.Config.IsRtp();
+	int32 Sent = 0;
+	while (QueueHead < Queue.Num())
+	{
+		FQueuedPacket& Packet = Queue[QueueHead];
+		const uint32 PacketSize = GetPacketSize(Packet);
+		// A packet larger than the burst still goes once the bucket is full, or it would never go.
+		if (Settings.PacingRate > 0.0 && Tokens < FMath::Min((double)PacketSize, (double)Settings.BurstBytes))
+		{
+			break;
+		}
+		Tokens -= Settings.PacingRate > 0.0 ? PacketSize : 0;
+
+		uint8* SlotData = Pool.GetSlot(Packet.Slot);
+		FPICOXRDPFragmentHeader::WriteSendTime(SlotData, (uint64)(Time * 1000000.0));
+		FPICOXRDPTunnelPacket TunnelPacket;
+		TunnelPacket.Payload = Packet.Payload;
+		TunnelPacket.PayloadLength = Packet.PayloadLength;
+		if (bRtp)
+		{
+			TunnelPacket.Extension = SlotData;
+			TunnelPacket.ExtensionLength = FPICOXRDPFragmentHeader::Size;
+			TunnelPacket.ExtensionId = FPICOXRDPFragmentHeader::ExtensionId;
+		}
+
+		if (Tunnel->Send(TunnelPacket))
+		{
+			Stats.PacketsSent++;
+			Stats.BytesSent += PacketSize;
+			SendStats.PacketsSent++;
+			SendStats.BytesSent += PacketSize;
+			Sent++;
+		}
+		else
+		{
+			Stats.PacketsFailed++;
+			SendStats.PacketsDropped++;
+		}
+		ReleasePacket(Packet);
+		QueueHead++;
+	}
+
+	if (QueueHead == Queue.Num())
+	{
+		Queue.Reset();
+		QueueHead = 0;
+	}
+	else if (QueueHead >= 64 && QueueHead * 2 >= Queue.Num())
+	{
+		Queue.RemoveAt(0, QueueHead, false);
+		QueueHead = 0;
+	}
+	return Sent;
+}
+
+double FPICOXRDPTunnelSender::GetPacingDelay() const
+{
+	if (QueueHead >= Queue.Num() || Settings.PacingRate <= 0.0)
+	{
+		return 0.0;
+	}
+	const double Needed = FMath::Min((double)GetPacketSize(Queue[QueueHead]), (double)Settings.BurstBytes);
+	const double Available = FMath::Min((double)Settings.BurstBytes, Tokens + (Now() - LastRefillTime) * Settings.PacingRate);
+	return Available >= Needed ? 0.0 : (Needed - Available) / Settings.PacingRate;
+}
+
+FPICOXRDPTunnelSendStats FPICOXRDPTunnelSender::TakeSendStats()
+{
+	const double Time = Now();
+	FPICOXRDPTunnelSendStats Result = SendStats;
+	Result.Seconds = Time - SendStatsTime;
+	Result.QueueDelaySeconds = QueueHead < Queue.Num() ? Time - Queue[QueueHead].QueueTime : 0.0;
+	SendStats = FPICOXRDPTunnelSendStats();
+	SendStatsTime = Time;
+	return Result;
+}
+
+bool FPICOXRDPFrameReassembler::AddPacket(const uint8* Payload, uint32 PayloadLength, const uint8* Extension, uint32 ExtensionLength, bool bRaw)
+{
+	FPICOXRDPFragmentHeader Header;
+	const bool bHeader = bRaw ? Header.Read(Payload, PayloadLength) : Header.Read(Extension, ExtensionLength);
+	if (bRaw && bHeader)
+	{
+		Payload += FPICOXRDPFragmentHeader::Size;
+		PayloadLength -= FPICOXRDPFragmentHeader::Size;
+	}
+	if (!bHeader || Header.FragmentIndex >= Header.FragmentCount
+		|| (uint64)Header.Offset + PayloadLength > Header.FrameLength)
+	{
+		InvalidPackets++;
+		return false;
+	}
+	if (bHasCompleted && Header.FrameNumber <= LastCompletedFrame)
+	{
+		// A late copy of a frame that is done, or one given up.
+		Duplicates++;
+		return false;
+	}
+
+	int32 Index = Pending.IndexOfByPredicate([&Header](const FFrame& Frame) { return Frame.Header.FrameNumber == Header.FrameNumber; });
+	if (Index == INDEX_NONE)
+	{
+		Index = Pending.AddDefaulted();
+		FFrame& Frame = Pending[Index];
+		Frame.Header = Header;
+		Frame.Data.SetNumUninitialized(Header.FrameLength);
+		Frame.Fragments.Init(false, Header.FragmentCount);
+	}
+
+	FFrame& Frame = Pending[Index];
+	if (Frame.Header.FragmentCount != Header.FragmentCount || Frame.Header.FrameLength != Header.FrameLength)
+	{
+		InvalidPackets++;
+		return false;
+	}
+	if (Frame.Fragments[Header.FragmentIndex])
+	{
+		Duplicates++;
+		return false;
+	}
+	Frame.Fragments[Header.FragmentIndex] = true;
+	Frame.Received++;
+	if (PayloadLength > 0)
+	{
+		FMemory::Memcpy(Frame.Data.GetData() + Header.Offset, Payload, PayloadLength);
+	}
+
+	if (Frame.Received == Frame.Header.FragmentCount)
+	{
+		const uint32 FrameNumber = Frame.Header.FrameNumber;
+		Completed.Add(MoveTemp(Frame));
+		Pending.RemoveAt(Index);
+		for (int32 Older = Pending.Num() - 1; Older >= 0; Older--)
+		{
+			if (Pending[Older].Header.FrameNumber < FrameNumber)
+			{
+				IncompleteFrames++;
+				Pending.RemoveAt(Older);
+			}
+		}
+		LastCompletedFrame = FrameNumber;
+		bHasCompleted = true;
+	}
+	return true;
+}
+
+bool FPICOXRDPFrameReassembler::PopFrame(FFrame& OutFrame)
+{
+	if (Completed.Num() == 0)
+	{
+		return false;
+	}
+	OutFrame = MoveTemp(Completed[0]);
+	Completed.RemoveAt(0);
+	return true;
+}
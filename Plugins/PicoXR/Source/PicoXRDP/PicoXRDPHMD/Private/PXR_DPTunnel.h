@@ -0,0 +1,252 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "PXR_DPEncoder.h"
+
+enum class EPICOXRDPTunnelType : uint8
+{
+	RtpH264,
+	RtpH265,
+	RtpAudio,
+	// Packets as they are, the fragment header travels in front of the payload.
+	Raw,
+};
+
+struct FPICOXRDPTunnelConfig
+{
+	EPICOXRDPTunnelType Type = EPICOXRDPTunnelType::RtpH264;
+	uint8 Ip[4] = { 0, 0, 0, 0 };
+	uint32 Port = 0;
+	uint16 LocalPort = 0;
+	// Largest packet the tunnel sends, RTP header included.
+	uint32 Mtu = 1200;
+	// Frames per second for video, samples per packet for audio.
+	uint32 Rate = 0;
+
+	bool IsRtp() const { return Type != EPICOXRDPTunnelType::Raw; }
+};
+
+/** One packet as handed to the tunnel. Pointers are only valid during Send. */
+struct FPICOXRDPTunnelPacket
+{
+	const uint8* Payload = nullptr;
+	uint32 PayloadLength = 0;
+	// RTP header extension, not sent by raw tunnels.
+	const uint8* Extension = nullptr;
+	uint32 ExtensionLength = 0;
+	uint16 ExtensionId = 0;
+};
+
+/**
+ * Tunnel the sender writes packets to. The default one wraps the streamer's DataTunnelInterface, a loopback fake can be set instead.
+ * Send copies the packet out before it returns.
+ */
+class IPICOXRDPTunnel
+{
+public:
+	virtual ~IPICOXRDPTunnel() {}
+
+	virtual bool Startup(const FPICOXRDPTunnelConfig& Config) = 0;
+	virtual void Shutdown() = 0;
+	virtual bool Send(const FPICOXRDPTunnelPacket& Packet) = 0;
+
+	static TSharedRef<IPICOXRDPTunnel, ESPMode::ThreadSafe> CreateDefault();
+};
+
+/**
+ * Metadata every fragment carries, in the RTP extension or in front of a raw payload.
+ * Written little endian field by field, so both ends agree whatever their layout.
+ */
+struct FPICOXRDPFragmentHeader
+{
+	static const uint8 Version = 1;
+	static const uint32 Size = 40;
+	// RTP extension id of the header.
+	static const uint16 ExtensionId = 0x5058;
+
+	// Sequence number over every fragment sent, gaps are losses whatever the transport numbers.
+	uint32 Sequence = 0;
+	uint32 FrameNumber = 0;
+	uint16 FragmentIndex = 0;
+	uint16 FragmentCount = 0;
+	uint32 FrameLength = 0;
+	// Where the fragment starts in the frame.
+	uint32 Offset = 0;
+	// Capture time of the frame and send time of the fragment, in microseconds of the sender's clock.
+	uint64 CaptureTimeUs = 0;
+	uint64 SendTimeUs = 0;
+	uint8 Flags = 0;
+	uint8 Stream = 0;
+
+	enum EFlags : uint8
+	{
+		KeyFrame = 1 << 0,
+	};
+
+	void Write(uint8* Out) const;
+	/** @return false if In is not a fragment header of this version. */
+	bool Read(const uint8* In, uint32 Length);
+
+	/** Stamps the send time into a header written before. */
+	static void WriteSendTime(uint8* Out, uint64 SendTimeUs);
+};
+
+/**
+ * Fixed slab of equally sized slots, allocated once. Acquiring and releasing a slot never allocates.
+ */
+class FPICOXRDPPacketPool
+{
+public:
+	void Initialize(int32 SlotCount, uint32 SlotSize);
+
+	/** @return a free slot, or INDEX_NONE when every slot is taken. */
+	int32 Acquire();
+	void Release(int32 Slot);
+
+	uint8* GetSlot(int32 Slot) { return Slab.GetData() + (SIZE_T)Slot * SlotSize; }
+	uint32 GetSlotSize() const { return SlotSize; }
+	int32 GetNumSlots() const { return InUse.Num(); }
+	int32 GetNumFree() const { return FreeSlots.Num(); }
+	int32 GetPeakInUse() const { return PeakInUse; }
+
+private:
+	TArray<uint8> Slab;
+	TArray<int32> FreeSlots;
+	TArray<bool> InUse;
+	uint32 SlotSize = 0;
+	int32 PeakInUse = 0;
+};
+
+struct FPICOXRDPTunnelSenderSettings
+{
+	FPICOXRDPTunnelConfig Config;
+	// Fragments queued at most, across frames.
+	int32 PoolSize = 512;
+	// Bytes per second the sends are paced to, 0 sends everything at once.
+	double PacingRate = 0.0;
+	// Bytes sent back to back after an idle period.
+	uint32 BurstBytes = 16 * 1024;
+	uint8 Stream = 0;
+};
+
+struct FPICOXRDPTunnelSenderStats
+{
+	uint64 Frames = 0;
+	// Frames dropped because the pool could not hold all of their fragments.
+	uint64 DroppedFrames = 0;
+	uint64 PacketsSent = 0;
+	uint64 PacketsFailed = 0;
+	uint64 BytesSent = 0;
+	// Bytes copied into raw packets. RTP fragments point into the frame and copy nothing.
+	uint64 BytesCopied = 0;
+	int32 PeakQueuedPackets = 0;
+};
+
+/**
+ * Cuts frames into MTU sized fragments and sends them through the tunnel, paced by a token bucket.
+ * RTP fragments point straight into the frame, only their header lives in a pool slot. Raw fragments have the header
+ * in front of the payload, so their payload is copied once into the slot behind it.
+ * The frame has to stay valid until its OnReleased is called, after its last fragment was sent or dropped.
+ * Frames are queued and pumped from one thread.
+ */
+class FPICOXRDPTunnelSender
+{
+public:
+	/** nullptr uses the default tunnel. Clock returns seconds, FPlatformTime::Seconds if unset. */
+	explicit FPICOXRDPTunnelSender(TSharedPtr<IPICOXRDPTunnel, ESPMode::ThreadSafe> InTunnel = nullptr, TFunction<double()> InClock = nullptr);
+	~FPICOXRDPTunnelSender();
+
+	bool Startup(const FPICOXRDPTunnelSenderSettings& InSettings);
+	/** Drops whatever is queued, releasing the frames. */
+	void Shutdown();
+
+	/** Payload bytes of a fragment at the configured MTU. */
+	uint32 GetFragmentPayloadSize() const;
+
+	/**
+	 * Queues every fragment of Data. CaptureTime is in seconds of the clock.
+	 * @return false if the frame was dropped, OnReleased has been called then.
+	 */
+	bool QueueFrame(const uint8* Data, uint32 Length, uint32 FrameNumber, double CaptureTime, bool bKeyFrame, TFunction<void()> OnReleased = nullptr);
+
+	/** Sends what the pacing allows now. @return packets sent. */
+	int32 Pump();
+
+	/** Seconds until the pacing lets the next packet go, 0 if it can go now or nothing is queued. */
+	double GetPacingDelay() const;
+
+	int32 GetNumQueued() const { return Queue.Num() - QueueHead; }
+
+	/** What was sent since the last call, for FPICOXRDPEncoderDriver::ReportSendStats. */
+	FPICOXRDPTunnelSendStats TakeSendStats();
+
+	const FPICOXRDPTunnelSenderStats& GetStats() const { return Stats; }
+	const FPICOXRDPPacketPool& GetPool() const { return Pool; }
+
+private:
+	struct FQueuedPacket
+	{
+		int32 Slot;
+		const uint8* Payload;
+		uint32 PayloadLength;
+		double QueueTime;
+		// Set on the last fragment of a frame.
+		TFunction<void()> OnReleased;
+	};
+
+	double Now() const { return Clock ? Clock() : FPlatformTime::Seconds(); }
+	uint32 GetPacketSize(const FQueuedPacket& Packet) const;
+	void RefillTokens(double Time);
+	void ReleasePacket(FQueuedPacket& Packet);
+
+	TSharedRef<IPICOXRDPTunnel, ESPMode::ThreadSafe> Tunnel;
+	TFunction<double()> Clock;
+	FPICOXRDPTunnelSenderSettings Settings;
+	FPICOXRDPPacketPool Pool;
+	// Sent packets are skipped over by QueueHead and trimmed in batches, so sending a packet never shifts the array.
+	TArray<FQueuedPacket> Queue;
+	int32 QueueHead = 0;
+	uint32 Sequence = 0;
+	double Tokens = 0.0;
+	double LastRefillTime = 0.0;
+	bool bRunning = false;
+	FPICOXRDPTunnelSenderStats Stats;
+	FPICOXRDPTunnelSendStats SendStats;
+	double SendStatsTime = 0.0;
+};
+
+/**
+ * Receiving end of the fragmentation, puts frames back together from fragments in any order.
+ * A frame still missing fragments is given up when a later frame completes.
+ */
+class FPICOXRDPFrameReassembler
+{
+public:
+	struct FFrame
+	{
+		FPICOXRDPFragmentHeader Header;
+		TArray<uint8> Data;
+		int32 Received = 0;
+		TArray<bool> Fragments;
+	};
+
+	/** Adds one received packet, the header read from its extension or, with bRaw, from the front of its payload. */
+	bool AddPacket(const uint8* Payload, uint32 PayloadLength, const uint8* Extension, uint32 ExtensionLength, bool bRaw);
+
+	/** Oldest completed frame. @return false if there is none. */
+	bool PopFrame(FFrame& OutFrame);
+
+	uint64 GetIncompleteFrames() const { return IncompleteFrames; }
+	uint64 GetDuplicates() const { return Duplicates; }
+	uint64 GetInvalidPackets() const { return InvalidPackets; }
+
+private:
+	TArray<FFrame> Pending;
+	TArray<FFrame> Completed;
+	uint32 LastCompletedFrame = 0;
+	bool bHasCompleted = false;
+	uint64 IncompleteFrames = 0;
+	uint64 Duplicates = 0;
+	uint64 InvalidPackets = 0;
+};
@@ -0,0 +1,207 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPVideo.h"
+#include "PXR_Log.h"
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+
+FPICOXRDPVideoStreamer::FPICOXRDPVideoStreamer(TSharedPtr<IPICOXRDPEncoder, ESPMode::ThreadSafe> InEncoder,
+	TSharedPtr<IPICOXRDPTunnel, ESPMode::ThreadSafe> InTunnel, TFunction<double()> InClock)
+	: Clock(InClock)
+	, Driver(InEncoder, InClock)
+	, Sender(InTunnel, InClock)
+	, bStopping(false)
+{
+}
+
+FPICOXRDPVideoStreamer::~FPICOXRDPVideoStreamer()
+{
+	Shutdown();
+}
+
+void FPICOXRDPVideoStreamer::Startup(const FPICOXRDPVideoSettings& InSettings, bool bInThreaded)
+{
+	Shutdown();
+
+	Settings = InSettings;
+	bThreaded = bInThreaded;
+	if (bThreaded)
+	{
+		bStopping = false;
+		WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Thread = FRunnableThread::Create(this, TEXT("PICOXRDPVideoSend"), 0, TPri_AboveNormal);
+	}
+}
+
+void FPICOXRDPVideoStreamer::Shutdown()
+{
+	Stop();
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	if (WorkEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		WorkEvent = nullptr;
+	}
+
+	FScopeLock ScopeLock(&SendLock);
+	StopEncoding();
+	EncodeSize = FIntPoint::ZeroValue;
+}
+
+bool FPICOXRDPVideoStreamer::SubmitFrame(uint64 Texture, FIntPoint Size, uint64 FrameNumber)
+{
+	if (Size != EncodeSize)
+	{
+		FScopeLock ScopeLock(&SendLock);
+		Restart(Size);
+	}
+	if (!bEncoding)
+	{
+		DroppedFrames++;
+		return false;
+	}
+	if (Settings.bQualityMap && BuildQualityMap(Size))
+	{
+		Driver.SetQualityMap(QualityMapBuilder.GetMap());
+	}
+	return Driver.SubmitFrame(Texture, FrameNumber);
+}
+
+bool FPICOXRDPVideoStreamer::BuildQualityMap(FIntPoint Size)
+{
+	FPICOXRDPQualityMapInput Input;
+	Input.FrameSize = Size;
+	Input.EyeCount = 1;
+	Input.Fov[0] = Settings.Fov;
+	Input.Fov[1] = Settings.Fov;
+	return QualityMapBuilder.Build(Input);
+}
+
+bool FPICOXRDPVideoStreamer::Restart(FIntPoint Size)
+{
+	StopEncoding();
+	// A size that failed is not tried again until another one comes.
+	EncodeSize = Size;
+	if (Size.X <= 0 || Size.Y <= 0)
+	{
+		return false;
+	}
+
+	FPICOXRDPEncoderSettings EncoderSettings = Settings.Encoder;
+	EncoderSettings.Config.Width = Size.X;
+	EncoderSettings.Config.Height = Size.Y;
+	if (Settings.bQualityMap)
+	{
+		// Starting at the preset of the map saves the encoder a restart for it with the frames that follow.
+		QualityMapBuilder.SetSettings(Settings.QualityMap);
+		BuildQualityMap(Size);
+		EncoderSettings.Config.Quality = QualityMapBuilder.GetMap().GetEncodeQuality();
+	}
+	if (!Driver.Startup(EncoderSettings, bThreaded))
+	{
+		PXR_LOGE(PxrUnreal, "PXR_DP could not start encoding %dx%d", Size.X, Size.Y);
+		return false;
+	}
+	if (Settings.bQualityMap)
+	{
+		Driver.SetQualityMap(QualityMapBuilder.GetMap());
+	}
+	if (!Sender.Startup(Settings.Tunnel))
+	{
+		PXR_LOGE(PxrUnreal, "PXR_DP could not open the video tunnel to %u.%u.%u.%u:%u", Settings.Tunnel.Config.Ip[0], Settings.Tunnel.Config.Ip[1],
+			Settings.Tunnel.Config.Ip[2], Settings.Tunnel.Config.Ip[3], Settings.Tunnel.Config.Port);
+		Driver.Shutdown();
+		return false;
+	}
+	PXR_LOGI(PxrUnreal, "PXR_DP encoding %dx%d at %d bps, quality %d", Size.X, Size.Y, EncoderSettings.Config.Bitrate, (int32)EncoderSettings.Config.Quality);
+	LastReportTime = Now();
+	bEncoding = true;
+	return true;
+}
+
+void FPICOXRDPVideoStreamer::StopEncoding()
+{
+	// The sender hands the buffers of what it still queues back to the driver before the driver lets go of them.
+	Sender.Shutdown();
+	Driver.Shutdown();
+	bEncoding = false;
+}
+
+bool FPICOXRDPVideoStreamer::SendOnce()
+{
+	FScopeLock ScopeLock(&SendLock);
+	if (!bEncoding)
+	{
+		return false;
+	}
+
+	if (!bThreaded)
+	{
+		while (Driver.DrainOnce())
+		{
+		}
+	}
+
+	bool bSent = false;
+	FPICOXRDPEncodedFrame Frame;
+	while (Driver.PopFrame(Frame))
+	{
+		bSent = true;
+		if (!Sender.QueueFrame(Frame.Data->data(), (uint32)Frame.Data->size(), (uint32)Frame.FrameNumber, Frame.SubmitTime, Frame.bKeyFrame,
+			[this, Frame]() { Driver.ReleaseFrame(Frame); }))
+		{
+			// The frames after a dropped one refer to it, the remote cannot decode them until the next key frame.
+			Driver.RequestKeyFrame();
+		}
+	}
+	bSent |= Sender.Pump() > 0;
+
+	const double Time = Now();
+	if (Time - LastReportTime >= Settings.ReportInterval)
+	{
+		LastReportTime = Time;
+		Driver.ReportSendStats(Sender.TakeSendStats());
+	}
+	return bSent;
+}
+
+FPICOXRDPVideoStats FPICOXRDPVideoStreamer::GetStats() const
+{
+	FPICOXRDPVideoStats Stats;
+	Stats.Encoder = Driver.GetStats();
+	FScopeLock ScopeLock(&SendLock);
+	Stats.Sender = Sender.GetStats();
+	Stats.DroppedFrames = DroppedFrames;
+	Stats.PoolSlots = Sender.GetPool().GetNumSlots();
+	Stats.PoolFree = Sender.GetPool().GetNumFree();
+	Stats.PoolPeakInUse = Sender.GetPool().GetPeakInUse();
+	return Stats;
+}
+
+uint32 FPICOXRDPVideoStreamer::Run()
+{
+	while (!bStopping)
+	{
+		if (!SendOnce())
+		{
+			// Nothing tells the send thread a frame was drained, a frame waits a millisecond at most.
+			WorkEvent->Wait(1);
+		}
+	}
+	return 0;
+}
+
+void FPICOXRDPVideoStreamer::Stop()
+{
+	bStopping = true;
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
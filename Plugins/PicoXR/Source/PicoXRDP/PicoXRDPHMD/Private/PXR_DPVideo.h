@@ -0,0 +1,105 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "PXR_DPEncoder.h"
+#include "PXR_DPQualityMap.h"
+#include "PXR_DPTunnel.h"
+
+class FRunnableThread;
+class FEvent;
+
+struct FPICOXRDPVideoSettings
+{
+	// The width and the height of the encoder are those of the frames submitted.
+	FPICOXRDPEncoderSettings Encoder;
+	FPICOXRDPTunnelSenderSettings Tunnel;
+	// Seconds between the send statistics the encoder adapts its bitrate to.
+	double ReportInterval = 0.25;
+	// Falloff of the quality away from the lens center of the eye sent, off to encode every block alike.
+	bool bQualityMap = false;
+	FPICOXRDPQualityMapSettings QualityMap;
+	FPICOXRDPEyeFov Fov;
+};
+
+struct FPICOXRDPVideoStats
+{
+	FPICOXRDPEncoderStats Encoder;
+	FPICOXRDPTunnelSenderStats Sender;
+	// Frames submitted at a size the encoder could not be started at.
+	uint64 DroppedFrames = 0;
+	// Packet pool of the sender, a peak at the slot count means frames were dropped for want of slots.
+	int32 PoolSlots = 0;
+	int32 PoolFree = 0;
+	int32 PoolPeakInUse = 0;
+};
+
+/**
+ * Encodes the eye textures DP hands to the streamer, and sends them to the headset itself.
+ * The encoder driver drains the encoder on a thread of its own. A send thread takes what it drained into a tunnel
+ * sender and paces it out, each buffer going back to the driver once its last fragment is sent. What the sender sent
+ * adapts the bitrate of the encoder, and a frame it had to drop makes the next one a key frame.
+ * With a quality map every frame is encoded with the map of its size, the encoder starts at the preset closest to it.
+ * The encoder and the tunnel start with the first frame submitted, at its size, and start again if the size changes.
+ */
+class FPICOXRDPVideoStreamer : public FRunnable
+{
+public:
+	/** nullptr uses the default encoder and tunnel. Clock returns seconds, FPlatformTime::Seconds if unset. */
+	explicit FPICOXRDPVideoStreamer(TSharedPtr<IPICOXRDPEncoder, ESPMode::ThreadSafe> InEncoder = nullptr,
+		TSharedPtr<IPICOXRDPTunnel, ESPMode::ThreadSafe> InTunnel = nullptr, TFunction<double()> InClock = nullptr);
+	virtual ~FPICOXRDPVideoStreamer();
+
+	/**
+	 * Starts the send thread, and the drain thread of the encoder, if bThreaded. Without them SendOnce has to be called,
+	 * which drains the encoder too. The encoder waits for the first frame.
+	 */
+	void Startup(const FPICOXRDPVideoSettings& InSettings, bool bThreaded = true);
+
+	/** Stops the encoder, the tunnel and the send thread. Frames not sent by then are dropped. */
+	void Shutdown();
+
+	/**
+	 * Encodes the shared texture of FrameNumber, Size pixels, starting the encoder again first if the size changed.
+	 * RHI thread, once the commands writing the texture ran, so neither the restart nor the encoder hold up the render thread.
+	 * @return false if the frame was dropped.
+	 */
+	bool SubmitFrame(uint64 Texture, FIntPoint Size, uint64 FrameNumber);
+
+	/** Queues what the encoder drained and sends what the pacing allows. @return false if there was nothing to do. */
+	bool SendOnce();
+
+	FPICOXRDPVideoStats GetStats() const;
+
+	// FRunnable, the send thread
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	double Now() const { return Clock ? Clock() : FPlatformTime::Seconds(); }
+	/** Starts the encoder and the tunnel at Size, with SendLock held. */
+	bool Restart(FIntPoint Size);
+	/** Drops what is queued and stops the encoder and the tunnel, with SendLock held. */
+	void StopEncoding();
+	/** Builds the quality map of a frame of Size. @return true if it changed. RHI thread. */
+	bool BuildQualityMap(FIntPoint Size);
+
+	TFunction<double()> Clock;
+	FPICOXRDPEncoderDriver Driver;
+	FPICOXRDPTunnelSender Sender;
+	FPICOXRDPVideoSettings Settings;
+	bool bThreaded = false;
+	// RHI thread only.
+	FPICOXRDPQualityMapBuilder QualityMapBuilder;
+
+	// Held by the send thread while it sends, and by the RHI thread while it starts the encoder again.
+	mutable FCriticalSection SendLock;
+	FIntPoint EncodeSize = FIntPoint::ZeroValue;
+	bool bEncoding = false;
+	uint64 DroppedFrames = 0;
+	double LastReportTime = 0.0;
+
+	FRunnableThread* Thread = nullptr;
+	FEvent* WorkEvent = nullptr;
+	TAtomic<bool> bStopping;
+};
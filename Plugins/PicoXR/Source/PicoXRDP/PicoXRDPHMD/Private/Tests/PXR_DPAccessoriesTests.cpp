@@ -0,0 +1,169 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPAccessories.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPAccessoryTests
+{
+	/** Terminal that answers accessory queries from a canned accessory and counts every query. */
+	class FCountingTerminal : public TerminalInterface
+	{
+	public:
+		TerminalAccessory Remote;
+		IResult Result = IResult::kOK;
+		int32 AccessoryQueries = 0;
+		int32 OtherQueries = 0;
+		// Run in the middle of the next accessory query, as another thread would.
+		TFunction<void()> DuringQuery;
+
+		virtual IResult ConnectToHost(const p_string& host, const p_string& port) override { return IResult::kOK; }
+		virtual void DisconnectFromHost() override {}
+		virtual IResult Hello(const TerminalInfo& my_info) override { return IResult::kOK; }
+		virtual IResult Bye() override { return IResult::kOK; }
+		virtual p_uint32 GetId() override { return 1; }
+		virtual IResult Active(p_bool active) override { return IResult::kOK; }
+		virtual IResult QueryRemoteConfig(IBoolConfigType type, p_bool& out) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult QueryRemoteConfig(IIntConfigType type, p_int32& out) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult QueryRemoteConfig(IFloatConfigType type, p_float& out) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult QueryRemoteConfig(IStringConfigType type, p_string& out) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult QueryRemoteTerminal(p_uint32 terminal_id, TerminalInfo& out) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult QueryRemoteTerminals(std::vector<TerminalInfo>& out) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult QueryRemoteTerminalId(const TerminalInfo::Type& type, uint32_t& id) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult SubmitTerminalAccessory(const TerminalAccessory& in) override { return IResult::kOK; }
+		virtual IResult QueryRemoteTerminalAccessory(p_uint32 terminal_id, TerminalAccessory& out) override
+		{
+			AccessoryQueries++;
+			if (DuringQuery)
+			{
+				TFunction<void()> Callback = MoveTemp(DuringQuery);
+				DuringQuery = nullptr;
+				Callback();
+			}
+			if (Result == IResult::kOK && terminal_id == 7)
+			{
+				out = Remote;
+				return IResult::kOK;
+			}
+			return IResult::kFailed;
+		}
+		virtual IResult SubmitHmdAccessory(const HmdAccessory& in) override { return IResult::kOK; }
+		virtual IResult QueryRemoteHmdAccessory(p_uint32 terminal_id, HmdAccessory& out) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult SubmitControllerAccessory(const ControllerAccessory& in) override { return IResult::kOK; }
+		virtual IResult QueryRemoteControllerAccessory(p_uint32 terminal_id, ControllerAccessory::Type type, ControllerAccessory& out) override { OtherQueries++; return IResult::kOK; }
+		virtual IResult PushMessage(const TerminalMessage& msg) override { return IResult::kOK; }
+		virtual IResult PullMessage(std::vector<TerminalMessage>& out) override { return IResult::kOK; }
+	};
+
+	/** Reads what one frame of the preview reads: the HMD twice, then each controller four times. */
+	static void ReadFrame(FAutomationTestBase& Test, const TCHAR* What, FPICOXRDPAccessorySnapshot& Snapshot, EPICOXRDPAccessoryReader Reader, uint64 Frame, float ExpectedHmdX, bool bExpectControllers)
+	{
+		int32 Mismatches = 0;
+		for (int32 Index = 0; Index < 2; Index++)
+		{
+			HmdAccessory Hmd;
+			Snapshot.GetHmd(Reader, Frame, Hmd);
+			p_vector3_f Position;
+			Hmd.GetPosition_(Position);
+			Mismatches += Position.x == ExpectedHmdX ? 0 : 1;
+		}
+		for (int32 Hand = 0; Hand < 2; Hand++)
+		{
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				ControllerAccessory Controller;
+				Snapshot.GetController(Reader, Frame, Hand, Controller);
+				Mismatches += Controller.GetIsActive_() == bExpectControllers && Controller.GetButtonStatus_() == (bExpectControllers ? Hand + 1 : 0) ? 0 : 1;
+			}
+		}
+		Test.TestEqual(What, Mismatches, 0);
+	}
+
+	static void TestSnapshot(FAutomationTestBase& Test)
+	{
+		FCountingTerminal Terminal;
+		HmdAccessory Hmd;
+		Hmd.SetPosition_({ 1.5f, 0.0f, 0.0f });
+		Terminal.Remote.SetHmdAccessory_(Hmd);
+		for (int32 Hand = 0; Hand < 2; Hand++)
+		{
+			ControllerAccessory Controller;
+			Controller.SetIsActive_(true);
+			Controller.SetButtonStatus_(Hand + 1);
+			Terminal.Remote.SetControllerAccessory_(Hand == 0 ? ControllerAccessory::Type::kLeft : ControllerAccessory::Type::kRight, Controller);
+		}
+
+		FPICOXRDPAccessorySnapshot Snapshot;
+		const EPICOXRDPAccessoryReader Game = EPICOXRDPAccessoryReader::Game;
+		const EPICOXRDPAccessoryReader Render = EPICOXRDPAccessoryReader::Render;
+
+		// Without a terminal nothing is queried and every accessory reads as inactive.
+		ReadFrame(Test, TEXT("Reads without a terminal that are not inactive"), Snapshot, Game, 1, 0.0f, false);
+		Test.TestEqual(TEXT("No query without a terminal"), Terminal.AccessoryQueries, 0);
+
+		// One query per frame, however many reads the frame makes.
+		Snapshot.SetTerminal(&Terminal, 7);
+		ReadFrame(Test, TEXT("Reads of frame 1 that differ from the remote"), Snapshot, Game, 1, 1.5f, true);
+		Test.TestEqual(TEXT("One query for the reads of a frame"), Terminal.AccessoryQueries, 1);
+
+		// A read for an earlier frame is served from the snapshot.
+		ReadFrame(Test, TEXT("Reads of an earlier frame that differ from the snapshot"), Snapshot, Game, 0, 1.5f, true);
+		Test.TestEqual(TEXT("No query for an earlier frame"), Terminal.AccessoryQueries, 1);
+
+		// The render thread queries for its own frame and reads the pose as it is by then, not the game thread's.
+		HmdAccessory Later;
+		Later.SetPosition_({ 2.5f, 0.0f, 0.0f });
+		Terminal.Remote.SetHmdAccessory_(Later);
+		ReadFrame(Test, TEXT("Render reads that differ from the later pose"), Snapshot, Render, 1, 2.5f, true);
+		Test.TestEqual(TEXT("The render thread queries for its own frame"), Terminal.AccessoryQueries, 2);
+		ReadFrame(Test, TEXT("Game reads that differ from the game thread's snapshot"), Snapshot, Game, 1, 1.5f, true);
+		ReadFrame(Test, TEXT("Render reads that differ from the render thread's snapshot"), Snapshot, Render, 1, 2.5f, true);
+		Test.TestEqual(TEXT("No query for frames each reader has"), Terminal.AccessoryQueries, 2);
+		Terminal.Remote.SetHmdAccessory_(Hmd);
+
+		ReadFrame(Test, TEXT("Reads of frame 2 that differ from the remote"), Snapshot, Game, 2, 1.5f, true);
+		Test.TestEqual(TEXT("One query for the next frame"), Terminal.AccessoryQueries, 3);
+
+		// A failed query reads as inactive for the rest of the frame and is not retried within it.
+		Terminal.Result = IDPInterface::IResult::kFailed;
+		ReadFrame(Test, TEXT("Reads after a failed query that are not inactive"), Snapshot, Game, 3, 0.0f, false);
+		Test.TestEqual(TEXT("A failed query is not retried within the frame"), Terminal.AccessoryQueries, 4);
+		Terminal.Result = IDPInterface::IResult::kOK;
+		ReadFrame(Test, TEXT("Reads after a failed frame that differ from the remote"), Snapshot, Game, 4, 1.5f, true);
+		Test.TestEqual(TEXT("The frame after a failed query queries again"), Terminal.AccessoryQueries, 5);
+
+		// The query runs without the lock, a terminal dropped meanwhile drops what it returns.
+		Terminal.DuringQuery = [&Snapshot, &Test]()
+		{
+			Test.TestEqual(TEXT("The query is counted before it runs"), Snapshot.GetStats().Queries, (uint64)6);
+			Snapshot.SetTerminal(nullptr, 0);
+		};
+		ReadFrame(Test, TEXT("Reads after the terminal was dropped during the query that are not inactive"), Snapshot, Game, 5, 0.0f, false);
+		Test.TestEqual(TEXT("Queries with the terminal dropped during one"), Terminal.AccessoryQueries, 6);
+
+		// Dropping the terminal drops the snapshot with it.
+		Snapshot.SetTerminal(&Terminal, 7);
+		Snapshot.SetTerminal(nullptr, 0);
+		ReadFrame(Test, TEXT("Reads after the terminal was dropped that are not inactive"), Snapshot, Game, 6, 0.0f, false);
+		Test.TestEqual(TEXT("No query after the terminal was dropped"), Terminal.AccessoryQueries, 6);
+		Test.TestEqual(TEXT("Nothing but accessories is queried"), Terminal.OtherQueries, 0);
+
+		const FPICOXRDPAccessoryStats Stats = Snapshot.GetStats();
+		Test.TestEqual(TEXT("Frames"), Stats.Frames, (uint64)6);
+		Test.TestEqual(TEXT("Queries"), Stats.Queries, (uint64)6);
+		Test.TestEqual(TEXT("Failed queries"), Stats.FailedQueries, (uint64)1);
+		Test.TestTrue(TEXT("Reads of the last frame"), Stats.LastFrameReads == 10);
+		Test.TestTrue(TEXT("Reads of the busiest frame"), Stats.PeakFrameReads == 30);
+		Test.TestEqual(TEXT("Reads"), Stats.Reads, (uint64)110);
+	}
+}
+
+/** Checks that the direct preview accessory snapshot queries a counting fake terminal once per frame of each reader. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPAccessorySnapshotTest, "PICOXR.DP.AccessorySnapshot", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPAccessorySnapshotTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPAccessoryTests::TestSnapshot(*this);
+	return true;
+}
+#endif
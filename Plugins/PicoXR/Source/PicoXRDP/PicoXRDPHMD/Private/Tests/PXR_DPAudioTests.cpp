@@ -0,0 +1,280 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPAudio.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPAudioTests
+{
+	/**
+	 * Source whose frame K has the value K modulo 32768 in every channel, so the output of the resampler tells the input position
+	 * it was read at. Its clock runs DriftPpm off the host clock, and each capture returns late by a scripted jitter.
+	 */
+	class FRampSource : public IPICOXRDPAudioSource
+	{
+	public:
+		FPICOXRDPAudioFormat Format;
+		double StartTime = 0.0;
+		double DriftPpm = 0.0;
+		// Host time the device has captured up to.
+		double CapturedUpTo = 0.0;
+		uint64 Produced = 0;
+
+		double GetTrueRate() const { return Format.SampleRate * (1.0 + DriftPpm / 1000000.0); }
+
+		virtual bool Startup(const FPICOXRDPAudioFormat& InFormat) override { return true; }
+		virtual void Shutdown() override {}
+		virtual FPICOXRDPAudioFormat GetFormat() const override { return Format; }
+		virtual uint32 GetPeriodMs() const override { return 10; }
+
+		virtual bool Capture(TArray<int16>& OutSamples) override
+		{
+			const uint64 Available = (uint64)((CapturedUpTo - StartTime) * GetTrueRate());
+			if (Available <= Produced)
+			{
+				return false;
+			}
+			for (; Produced < Available; Produced++)
+			{
+				for (int32 Channel = 0; Channel < Format.Channels; Channel++)
+				{
+					OutSamples.Add((int16)(Produced % 32768));
+				}
+			}
+			return true;
+		}
+	};
+
+	/** Tunnel that reassembles what it is sent into audio chunks. */
+	class FChunkTunnel : public IPICOXRDPTunnel
+	{
+	public:
+		struct FChunk
+		{
+			FPICOXRDPAudioChunkHeader Header;
+			uint32 Sequence;
+			double CaptureTime;
+			int16 First;
+			int16 Second;
+		};
+
+		FPICOXRDPFrameReassembler Reassembler;
+		TArray<FChunk> Chunks;
+		int32 BadChunks = 0;
+
+		virtual bool Startup(const FPICOXRDPTunnelConfig& Config) override { return true; }
+		virtual void Shutdown() override {}
+		virtual bool Send(const FPICOXRDPTunnelPacket& Packet) override
+		{
+			Reassembler.AddPacket(Packet.Payload, Packet.PayloadLength, Packet.Extension, Packet.ExtensionLength, false);
+			FPICOXRDPFrameReassembler::FFrame Frame;
+			while (Reassembler.PopFrame(Frame))
+			{
+				FChunk Chunk;
+				if (!Chunk.Header.Read(Frame.Data.GetData(), Frame.Data.Num())
+					|| Frame.Data.Num() != FPICOXRDPAudioChunkHeader::Size + Chunk.Header.Frames * Chunk.Header.Channels * sizeof(int16))
+				{
+					BadChunks++;
+					continue;
+				}
+				const int16* Samples = (const int16*)(Frame.Data.GetData() + FPICOXRDPAudioChunkHeader::Size);
+				Chunk.Sequence = Frame.Header.FrameNumber;
+				Chunk.CaptureTime = Frame.Header.CaptureTimeUs / 1000000.0;
+				Chunk.First = Samples[0];
+				Chunk.Second = Samples[Chunk.Header.Channels];
+				Chunks.Add(Chunk);
+			}
+			return true;
+		}
+	};
+
+	struct FRunResult
+	{
+		double OutputRate = 0.0;
+		double MaxTimeError = 0.0;
+		FPICOXRDPAudioStats Stats;
+	};
+
+	/** Streams Seconds of the ramp, capturing every 10 ms with up to 3 ms of jitter. */
+	static FRunResult RunRamp(FAutomationTestBase& Test, double DriftPpm, bool bCompensateDrift, double Seconds)
+	{
+		FRunResult Result;
+		double Time = 1000.0;
+		TSharedRef<FRampSource, ESPMode::ThreadSafe> Ramp = MakeShared<FRampSource, ESPMode::ThreadSafe>();
+		Ramp->Format.SampleRate = 44100;
+		Ramp->Format.Channels = 1;
+		Ramp->StartTime = Time;
+		Ramp->DriftPpm = DriftPpm;
+		TSharedRef<FChunkTunnel, ESPMode::ThreadSafe> Tunnel = MakeShared<FChunkTunnel, ESPMode::ThreadSafe>();
+		FPICOXRDPAudioStreamer Streamer(Ramp, Tunnel, [&Time]() { return Time; });
+		FPICOXRDPAudioSettings Settings;
+		Settings.bCompensateDrift = bCompensateDrift;
+		Test.TestTrue(TEXT("Startup"), Streamer.Startup(Settings, false));
+
+		uint32 Random = 12345;
+		const int32 Periods = (int32)(Seconds * 100.0);
+		for (int32 Period = 1; Period <= Periods; Period++)
+		{
+			Ramp->CapturedUpTo = Ramp->StartTime + Period * 0.01;
+			Random = Random * 1664525u + 1013904223u;
+			Time = Ramp->CapturedUpTo + (Random >> 8) / 16777216.0 * 0.003;
+			if (Period == Periods / 2)
+			{
+				Streamer.SetVideoFrame(500, Time - 0.004);
+			}
+			Streamer.CaptureOnce();
+		}
+		Result.Stats = Streamer.GetStats();
+
+		// Chunks are whole, in sequence, and a chunk's frames apart.
+		const TArray<FChunkTunnel::FChunk>& Chunks = Tunnel->Chunks;
+		Test.TestEqual(TEXT("Chunks that did not come through whole"), Tunnel->BadChunks, 0);
+		Test.TestTrue(TEXT("Chunks sent"), Chunks.Num() > 0);
+		int32 OutOfSequence = 0;
+		int32 BadFormat = 0;
+		for (int32 Index = 0; Index < Chunks.Num(); Index++)
+		{
+			const FChunkTunnel::FChunk& Chunk = Chunks[Index];
+			OutOfSequence += Chunk.Sequence == (uint32)Index && Chunk.Header.FirstFrame == (uint64)Index * 480 ? 0 : 1;
+			BadFormat += Chunk.Header.Frames == 480 && Chunk.Header.Channels == 2 && Chunk.Header.SampleRate == 48000 ? 0 : 1;
+		}
+		Test.TestEqual(TEXT("Chunks out of sequence"), OutOfSequence, 0);
+		Test.TestEqual(TEXT("Chunks not of 480 stereo frames at 48 kHz"), BadFormat, 0);
+
+		// Once the drift is measured, the ramp value a chunk starts with gives the input sample it was read at,
+		// and so its true capture time to check the stamped one against.
+		const double Step = 44100.0 / 48000.0;
+		for (const FChunkTunnel::FChunk& Chunk : Chunks)
+		{
+			if (Chunk.CaptureTime < Ramp->StartTime + 3.0 || FMath::Abs(Chunk.Second - Chunk.First - Step) > 1.0)
+			{
+				continue;
+			}
+			const double Estimated = (Chunk.CaptureTime - Ramp->StartTime) * Ramp->GetTrueRate();
+			const double Wraps = FMath::RoundToDouble((Estimated - Chunk.First) / 32768.0);
+			const double TrueTime = Ramp->StartTime + (Wraps * 32768.0 + Chunk.First) / Ramp->GetTrueRate();
+			Result.MaxTimeError = FMath::Max(Result.MaxTimeError, FMath::Abs(Chunk.CaptureTime - TrueTime));
+		}
+
+		// Output frames per second of the host clock, over the second half.
+		const int32 Half = Chunks.Num() / 2;
+		if (Chunks.Num() > 2)
+		{
+			const FChunkTunnel::FChunk& From = Chunks[Half];
+			const FChunkTunnel::FChunk& To = Chunks.Last();
+			Result.OutputRate = (To.Header.FirstFrame - From.Header.FirstFrame) / (To.CaptureTime - From.CaptureTime);
+			// The chunk after the video frame was reported is stamped relative to it.
+			const FChunkTunnel::FChunk* AfterVideo = Chunks.FindByPredicate([](const FChunkTunnel::FChunk& Chunk) { return Chunk.Header.VideoFrame == 500; });
+			if (Test.TestNotNull(TEXT("A chunk is stamped with the video frame"), AfterVideo))
+			{
+				Test.TestTrue(TEXT("The chunk is stamped relative to the video frame"), FMath::Abs(AfterVideo->Header.VideoFrameOffsetUs) < 20000);
+			}
+		}
+		Streamer.Shutdown();
+		return Result;
+	}
+
+	static void TestResampler(FAutomationTestBase& Test)
+	{
+		TArray<int16> Ramp;
+		for (int32 Index = 0; Index < 4410; Index++)
+		{
+			Ramp.Add((int16)Index);
+		}
+
+		// In one go or in uneven pieces the output is the same but for rounding, each frame read at its input position.
+		FPICOXRDPAudioResampler Whole;
+		Whole.Initialize(44100, 48000, 1, 2);
+		TArray<int16> WholeOut;
+		Whole.Process(Ramp.GetData(), Ramp.Num(), WholeOut);
+		FPICOXRDPAudioResampler Pieces;
+		Pieces.Initialize(44100, 48000, 1, 2);
+		TArray<int16> PiecesOut;
+		for (int32 Start = 0, Size = 1; Start < Ramp.Num(); Start += Size, Size = Size * 3 % 97 + 1)
+		{
+			Pieces.Process(Ramp.GetData() + Start, FMath::Min(Size, Ramp.Num() - Start), PiecesOut);
+		}
+		Test.TestEqual(TEXT("Samples out in one go and in pieces"), PiecesOut.Num(), WholeOut.Num());
+		int32 PieceMismatches = 0;
+		for (int32 Index = 0; Index < FMath::Min(WholeOut.Num(), PiecesOut.Num()); Index++)
+		{
+			PieceMismatches += FMath::Abs(WholeOut[Index] - PiecesOut[Index]) <= 1 ? 0 : 1;
+		}
+		Test.TestEqual(TEXT("Samples that differ between one go and pieces by more than rounding"), PieceMismatches, 0);
+		Test.TestTrue(TEXT("Frames out of 0.1 s at 48 kHz"), FMath::Abs(WholeOut.Num() / 2 - 4800) <= 1);
+		int32 Misplaced = 0;
+		for (int32 Frame = 0; Frame < WholeOut.Num() / 2; Frame++)
+		{
+			const double Expected = Frame * 44100.0 / 48000.0;
+			Misplaced += FMath::Abs(WholeOut[Frame * 2] - Expected) <= 0.5 && WholeOut[Frame * 2 + 1] == WholeOut[Frame * 2] ? 0 : 1;
+		}
+		Test.TestEqual(TEXT("Frames not read at their input position into both channels"), Misplaced, 0);
+		Test.TestEqual(TEXT("Next input position"), Whole.GetNextInputPosition(), WholeOut.Num() / 2 * 44100.0 / 48000.0, 1e-6);
+	}
+
+	static void TestPoolExhaustion(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		TSharedRef<FRampSource, ESPMode::ThreadSafe> Ramp = MakeShared<FRampSource, ESPMode::ThreadSafe>();
+		Ramp->Format.SampleRate = 48000;
+		Ramp->Format.Channels = 2;
+		TSharedRef<FChunkTunnel, ESPMode::ThreadSafe> Tunnel = MakeShared<FChunkTunnel, ESPMode::ThreadSafe>();
+		FPICOXRDPAudioStreamer Streamer(Ramp, Tunnel, [&Time]() { return Time; });
+		FPICOXRDPAudioSettings Settings;
+		Settings.ChunkPoolSize = 4;
+		// Far below the audio rate, chunks pile up in the tunnel.
+		Settings.Tunnel.PacingRate = 20000.0;
+		Settings.Tunnel.BurstBytes = 2400;
+		Test.TestTrue(TEXT("Startup"), Streamer.Startup(Settings, false));
+		for (int32 Period = 1; Period <= 100; Period++)
+		{
+			Time = Ramp->CapturedUpTo = Period * 0.01;
+			Streamer.CaptureOnce();
+		}
+		const FPICOXRDPAudioStats Stats = Streamer.GetStats();
+		Test.TestTrue(TEXT("Chunks dropped with the pool exhausted"), Stats.DroppedChunks > 0);
+		Test.TestTrue(TEXT("Every chunk is sent or dropped"), Stats.Chunks + Stats.DroppedChunks >= 99);
+		// The chunks that made it keep their place in the sequence.
+		int32 OutOfSequence = 0;
+		for (int32 Index = 1; Index < Tunnel->Chunks.Num(); Index++)
+		{
+			const FChunkTunnel::FChunk& Chunk = Tunnel->Chunks[Index];
+			OutOfSequence += Chunk.Header.FirstFrame == (uint64)Chunk.Sequence * 480 && Chunk.Sequence > Tunnel->Chunks[Index - 1].Sequence ? 0 : 1;
+		}
+		Test.TestEqual(TEXT("Chunks sent out of their place in the sequence"), OutOfSequence, 0);
+	}
+
+	/** A device 200 ppm fast is measured, resampled back to 48 kHz of the host clock, and stamped within a millisecond. */
+	static void TestDriftCompensation(FAutomationTestBase& Test)
+	{
+		const FRunResult Compensated = RunRamp(Test, 200.0, true, 20.0);
+		Test.TestEqual(TEXT("Drift measured"), Compensated.Stats.DriftPpm, 200.0, 10.0);
+		Test.TestEqual(TEXT("Output rate with the drift compensated"), Compensated.OutputRate / 48000.0, 1.0, 30e-6);
+		Test.TestTrue(TEXT("Stamps within a millisecond"), Compensated.MaxTimeError < 0.001);
+		Test.TestTrue(TEXT("Capture jitter measured"), Compensated.Stats.Jitter > 0.0005 && Compensated.Stats.Jitter < 0.0015);
+	}
+
+	/** Without the compensation the device's drift goes straight into the output rate. */
+	static void TestUncompensatedDrift(FAutomationTestBase& Test)
+	{
+		const FRunResult Uncompensated = RunRamp(Test, 200.0, false, 20.0);
+		Test.TestTrue(TEXT("The drift goes into the output rate"), FMath::Abs(Uncompensated.OutputRate / 48000.0 - 1.0) > 150e-6);
+		Test.TestTrue(TEXT("Stamps within a millisecond without compensation"), Uncompensated.MaxTimeError < 0.001);
+	}
+}
+
+/**
+ * Streams a synthetic drifting capture through the direct preview audio path into a reassembling fake tunnel.
+ * Needs no capture device, but only runs where PICOXRDPHMD builds, which is Win64.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPAudioStreamerTest, "PICOXR.DP.AudioStreamer", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPAudioStreamerTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPAudioTests::TestResampler(*this);
+	PICOXRDPAudioTests::TestPoolExhaustion(*this);
+	PICOXRDPAudioTests::TestDriftCompensation(*this);
+	PICOXRDPAudioTests::TestUncompensatedDrift(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,282 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPConnection.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPConnectionTests
+{
+	/**
+	 * Link whose every step fails when it is told to, and that records whether it was open when the state changed.
+	 * Opening takes OpenSeconds, as a runtime that is slow to answer.
+	 */
+	class FFakeLink : public IPICOXRDPConnectionLink
+	{
+	public:
+		bool bOpenSucceeds = true;
+		bool bHeartbeatSucceeds = true;
+		bool bHasIds = true;
+		uint32 RuntimeId = 1;
+		uint32 HmdId = 2;
+		float OpenSeconds = 0.0f;
+
+		TAtomic<bool> bOpen;
+		TAtomic<int32> Opens;
+		int32 Closes = 0;
+		int32 AddressQueries = 0;
+
+		FFakeLink()
+			: bOpen(false)
+			, Opens(0)
+		{
+		}
+
+		virtual bool Open() override
+		{
+			if (OpenSeconds > 0.0f)
+			{
+				FPlatformProcess::Sleep(OpenSeconds);
+			}
+			Opens++;
+			bOpen = bOpenSucceeds;
+			return bOpenSucceeds;
+		}
+
+		virtual bool QueryIds(uint32& OutRuntimeId, uint32& OutHmdId) override
+		{
+			OutRuntimeId = RuntimeId;
+			OutHmdId = bHasIds ? HmdId : 0;
+			return bOpen && bHeartbeatSucceeds;
+		}
+
+		/** 10.0.0.HmdId. */
+		virtual bool QueryHmdAddress(uint32 InHmdId, uint8 OutIp[4]) override
+		{
+			AddressQueries++;
+			OutIp[0] = 10;
+			OutIp[1] = 0;
+			OutIp[2] = 0;
+			OutIp[3] = (uint8)InHmdId;
+			return true;
+		}
+
+		virtual void Close() override
+		{
+			Closes += bOpen ? 1 : 0;
+			bOpen = false;
+		}
+	};
+
+	static void TestReconnect(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		TSharedRef<FFakeLink, ESPMode::ThreadSafe> Link = MakeShared<FFakeLink, ESPMode::ThreadSafe>();
+		FPICOXRDPConnection Connection(Link, [&Time]() { return Time; });
+
+		TArray<EPICOXRDPConnectionState> States;
+		bool bOpenWhenLeft = false;
+		Connection.OnStateChanged().AddLambda([&](EPICOXRDPConnectionState OldState, EPICOXRDPConnectionState NewState)
+		{
+			States.Add(NewState);
+			if (OldState == EPICOXRDPConnectionState::Connected)
+			{
+				bOpenWhenLeft = Link->bOpen;
+			}
+		});
+
+		// Nothing happens until it is started, the first tick then goes all the way through.
+		Connection.Tick();
+		Test.TestEqual(TEXT("No open before the connection is started"), (int32)Link->Opens, 0);
+		Test.TestEqual(TEXT("No state change before the connection is started"), States.Num(), 0);
+		Connection.Startup(false);
+		Connection.Tick();
+		Test.TestTrue(TEXT("Connected on the first tick"), Connection.IsConnected());
+		Test.TestTrue(TEXT("Runtime id"), Connection.GetRuntimeId() == 1);
+		Test.TestTrue(TEXT("Headset id"), Connection.GetHmdId() == 2);
+		if (Test.TestEqual(TEXT("States on the way to connected"), States.Num(), 3))
+		{
+			Test.TestTrue(TEXT("Registering on the way to connected"), States[1] == EPICOXRDPConnectionState::Registering);
+		}
+		Test.TestTrue(TEXT("Heartbeat on connecting"), Connection.GetStats().Heartbeats == 1);
+
+		// Heartbeats are paced.
+		Time = 0.2;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Heartbeats are paced"), Connection.GetStats().Heartbeats == 1);
+
+		// The link drops on the third heartbeat missed in a row, the listeners see it before it closes.
+		Link->bHeartbeatSucceeds = false;
+		Time = 0.5;
+		Connection.Tick();
+		Time = 1.0;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Connected after two missed heartbeats"), Connection.IsConnected());
+		Time = 1.5;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Backing off after three missed heartbeats"), Connection.GetState() == EPICOXRDPConnectionState::Backoff);
+		Test.TestTrue(TEXT("Listeners see the drop before the link closes"), bOpenWhenLeft);
+		Test.TestFalse(TEXT("The link is closed on a drop"), Link->bOpen);
+		Test.TestEqual(TEXT("Closes on a drop"), Link->Closes, 1);
+		Test.TestTrue(TEXT("Drops counted"), Connection.GetStats().Drops == 1);
+		Test.TestEqual(TEXT("First backoff"), Connection.GetBackoff(), 0.5, 0.0);
+		Test.TestTrue(TEXT("No runtime id after a drop"), Connection.GetRuntimeId() == 0);
+		Test.TestTrue(TEXT("No headset id after a drop"), Connection.GetHmdId() == 0);
+
+		// Failed attempts back off twice as long each time, up to the most.
+		Link->bOpenSucceeds = false;
+		Time = 1.9;
+		Connection.Tick();
+		Test.TestEqual(TEXT("No open within the backoff"), (int32)Link->Opens, 1);
+		const double Backoffs[] = { 1.0, 2.0, 4.0, 8.0, 8.0 };
+		for (double Backoff : Backoffs)
+		{
+			Time += Connection.GetBackoff();
+			Connection.Tick();
+			Test.TestTrue(TEXT("Backing off after a failed attempt"), Connection.GetState() == EPICOXRDPConnectionState::Backoff);
+			Test.TestEqual(TEXT("Backoff after a failed attempt"), Connection.GetBackoff(), Backoff, 0.0);
+		}
+		Test.TestEqual(TEXT("Opens tried"), (int32)Link->Opens, 6);
+		Test.TestEqual(TEXT("Attempt"), Connection.GetAttempt(), 6);
+		Test.TestTrue(TEXT("Failed attempts counted"), Connection.GetStats().FailedAttempts == 5);
+
+		// The runtime is back.
+		Link->bOpenSucceeds = true;
+		Link->bHeartbeatSucceeds = true;
+		Time += Connection.GetBackoff();
+		Connection.Tick();
+		Test.TestTrue(TEXT("Connected once the runtime is back"), Connection.IsConnected());
+		Test.TestEqual(TEXT("Attempts start over once connected"), Connection.GetAttempt(), 0);
+		Test.TestTrue(TEXT("Connects counted"), Connection.GetStats().Connects == 2);
+
+		// A missed heartbeat that is followed by one answered does not drop it.
+		Link->bHeartbeatSucceeds = false;
+		Time += 0.5;
+		Connection.Tick();
+		Link->bHeartbeatSucceeds = true;
+		Time += 0.5;
+		Connection.Tick();
+		Link->bHeartbeatSucceeds = false;
+		Time += 0.5;
+		Connection.Tick();
+		Time += 0.5;
+		Connection.Tick();
+		Link->bHeartbeatSucceeds = true;
+		Test.TestTrue(TEXT("Missed heartbeats not in a row do not drop the link"), Connection.IsConnected());
+		Test.TestTrue(TEXT("No further drop"), Connection.GetStats().Drops == 1);
+	}
+
+	static void TestRegister(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		TSharedRef<FFakeLink, ESPMode::ThreadSafe> Link = MakeShared<FFakeLink, ESPMode::ThreadSafe>();
+		FPICOXRDPConnection Connection(Link, [&Time]() { return Time; });
+		int32 Connects = 0;
+		Connection.OnStateChanged().AddLambda([&](EPICOXRDPConnectionState OldState, EPICOXRDPConnectionState NewState)
+		{
+			Connects += NewState == EPICOXRDPConnectionState::Connected ? 1 : 0;
+		});
+
+		// Without a headset the link stays open, registering.
+		Link->bHasIds = false;
+		Connection.Startup(false);
+		for (int32 Tick = 0; Tick < 4; Tick++)
+		{
+			Connection.Tick();
+			Time += 0.5;
+		}
+		Test.TestTrue(TEXT("Registering without a headset"), Connection.GetState() == EPICOXRDPConnectionState::Registering);
+		Test.TestEqual(TEXT("The link is opened once without a headset"), (int32)Link->Opens, 1);
+		Test.TestEqual(TEXT("The link stays open without a headset"), Link->Closes, 0);
+		Link->bHasIds = true;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Connected once the headset is there"), Connection.IsConnected());
+		Test.TestEqual(TEXT("Connects once the headset is there"), Connects, 1);
+
+		// The address of the headset is asked for once, not with every heartbeat.
+		uint8 Ip[4] = { 0, 0, 0, 0 };
+		Time += 0.5;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Headset address"), Connection.GetHmdAddress(Ip) && Ip[0] == 10 && Ip[3] == 2);
+		Test.TestEqual(TEXT("The address is asked for once"), Link->AddressQueries, 1);
+
+		// The headset coming back as another terminal registers again over the same link.
+		Link->HmdId = 9;
+		Time += 0.5;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Connected to the other terminal"), Connection.IsConnected());
+		Test.TestTrue(TEXT("Id of the other terminal"), Connection.GetHmdId() == 9);
+		Test.TestEqual(TEXT("Connects with the other terminal"), Connects, 2);
+		Test.TestEqual(TEXT("The other terminal registers over the same link"), (int32)Link->Opens, 1);
+		Test.TestTrue(TEXT("Address of the other terminal"), Connection.GetHmdAddress(Ip) && Ip[3] == 9);
+		Test.TestEqual(TEXT("The address of the other terminal is asked for"), Link->AddressQueries, 2);
+
+		// The headset going away does too, and it is connected again once it is back.
+		Link->bHasIds = false;
+		Time += 0.5;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Registering once the headset goes away"), Connection.GetState() == EPICOXRDPConnectionState::Registering);
+		Test.TestTrue(TEXT("No headset id once it goes away"), Connection.GetHmdId() == 0);
+		Link->bHasIds = true;
+		Time += 0.5;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Connected once the headset is back"), Connection.IsConnected());
+		Test.TestEqual(TEXT("Connects once the headset is back"), Connects, 3);
+		Test.TestEqual(TEXT("The link stays open while the headset is away"), Link->Closes, 0);
+
+		// Stopped, it closes the link and is not opened again.
+		Connection.Shutdown();
+		Time += 10.0;
+		Connection.Tick();
+		Test.TestTrue(TEXT("Disconnected once stopped"), Connection.GetState() == EPICOXRDPConnectionState::Disconnected);
+		Test.TestEqual(TEXT("The link is closed once stopped"), Link->Closes, 1);
+		Test.TestEqual(TEXT("The link is not opened again once stopped"), (int32)Link->Opens, 1);
+	}
+
+	static void TestThreaded(FAutomationTestBase& Test)
+	{
+		TSharedRef<FFakeLink, ESPMode::ThreadSafe> Link = MakeShared<FFakeLink, ESPMode::ThreadSafe>();
+		Link->OpenSeconds = 0.1f;
+		FPICOXRDPConnection Connection(Link);
+		int32 Connects = 0;
+		Connection.OnStateChanged().AddLambda([&](EPICOXRDPConnectionState OldState, EPICOXRDPConnectionState NewState)
+		{
+			Connects += NewState == EPICOXRDPConnectionState::Connected ? 1 : 0;
+		});
+
+		// A tick does not wait for the link to open, the state changes on a later one.
+		Connection.Startup();
+		const double StartTime = FPlatformTime::Seconds();
+		Connection.Tick();
+		Test.TestTrue(TEXT("A tick does not wait for the link to open"), FPlatformTime::Seconds() - StartTime < Link->OpenSeconds);
+		Test.TestTrue(TEXT("Connecting while the link opens"), Connection.GetState() == EPICOXRDPConnectionState::Connecting);
+		while (!Connection.IsConnected() && FPlatformTime::Seconds() - StartTime < 2.0)
+		{
+			FPlatformProcess::Sleep(0.001f);
+			Connection.Tick();
+		}
+		Test.TestTrue(TEXT("Connected on a later tick"), Connection.IsConnected());
+		Test.TestEqual(TEXT("Connects on the connection thread"), Connects, 1);
+		Test.TestEqual(TEXT("Opens on the connection thread"), (int32)Link->Opens, 1);
+
+		// Stopped while opening, an open that started is waited for and the link closed.
+		Connection.Shutdown();
+		Connection.Startup();
+		Connection.Tick();
+		Connection.Shutdown();
+		Test.TestTrue(TEXT("Disconnected once stopped while opening"), Connection.GetState() == EPICOXRDPConnectionState::Disconnected);
+		Test.TestFalse(TEXT("The link is closed once stopped while opening"), Link->bOpen);
+		Test.TestEqual(TEXT("Every open link is closed"), Link->Closes, (int32)Link->Opens);
+	}
+}
+
+/** Checks the direct preview connection heartbeat, backoff and reconnect against a link that drops on demand. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPConnectionTest, "PICOXR.DP.Connection", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPConnectionTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPConnectionTests::TestReconnect(*this);
+	PICOXRDPConnectionTests::TestRegister(*this);
+	PICOXRDPConnectionTests::TestThreaded(*this);
+	return true;
+}
+#endif
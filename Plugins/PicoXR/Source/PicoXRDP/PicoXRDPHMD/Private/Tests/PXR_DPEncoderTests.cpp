@@ -0,0 +1,300 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPEncoder.h"
+#include "PXR_DPQualityMap.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPEncoderTests
+{
+	/**
+	 * Encoder that emits synthetic packets. Each frame takes the next scripted latency, Acquire moves the fake clock
+	 * to when the frame is done, as a blocking Acquire would, and writes the next scripted size of bytes.
+	 */
+	class FFakeEncoder : public IPICOXRDPEncoder
+	{
+	public:
+		struct FPending
+		{
+			uint64 Tag;
+			double ReadyTime;
+		};
+
+		FCriticalSection Lock;
+		double* Time = nullptr;
+		TArray<double> Latencies;
+		TArray<int32> Sizes;
+		TArray<uint64> LoseTags;
+		TArray<FPending> Pending;
+		TArray<bool> KeyFrames;
+		TArray<int32> Bitrates;
+		int32 Submits = 0;
+		int32 Acquires = 0;
+
+		virtual bool Startup(const FPICOXRDPEncoderConfig& Config) override
+		{
+			FScopeLock ScopeLock(&Lock);
+			Bitrates.Add(Config.Bitrate);
+			return true;
+		}
+
+		virtual void Shutdown() override
+		{
+			FScopeLock ScopeLock(&Lock);
+			Pending.Reset();
+		}
+
+		virtual bool Submit(uint64 Texture, uint64 Tag, bool bKeyFrame) override
+		{
+			FScopeLock ScopeLock(&Lock);
+			const double Latency = Latencies.Num() > 0 ? Latencies[Submits % Latencies.Num()] : 0.0;
+			Submits++;
+			KeyFrames.Add(bKeyFrame);
+			if (!LoseTags.Contains(Tag))
+			{
+				Pending.Add({ Tag, (Time ? *Time : 0.0) + Latency });
+			}
+			return true;
+		}
+
+		virtual bool Acquire(std::vector<uint8>& OutData, uint64& OutTag) override
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (Pending.Num() == 0)
+			{
+				return false;
+			}
+			const FPending Frame = Pending[0];
+			Pending.RemoveAt(0);
+			if (Time)
+			{
+				*Time = FMath::Max(*Time, Frame.ReadyTime);
+			}
+			const int32 Size = Sizes.Num() > 0 ? Sizes[Acquires % Sizes.Num()] : 64;
+			Acquires++;
+			OutData.assign(Size, (uint8)Frame.Tag);
+			OutTag = Frame.Tag;
+			return true;
+		}
+
+		virtual void Flush() override {}
+	};
+
+	/** Drains and releases every frame the driver has, checking each carries its own bytes. @return the frames drained. */
+	static int32 DrainAll(FAutomationTestBase& Test, FPICOXRDPEncoderDriver& Driver)
+	{
+		int32 Frames = 0;
+		while (Driver.DrainOnce())
+		{
+			FPICOXRDPEncodedFrame Frame;
+			while (Driver.PopFrame(Frame))
+			{
+				Test.TestTrue(TEXT("A drained frame carries its own bytes"), Frame.Data && Frame.Data->size() > 0 && (*Frame.Data)[0] == (uint8)Frame.FrameNumber);
+				Driver.ReleaseFrame(Frame);
+				Frames++;
+			}
+		}
+		return Frames;
+	}
+
+	static void TestScripted(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		TSharedRef<FFakeEncoder, ESPMode::ThreadSafe> Fake = MakeShared<FFakeEncoder, ESPMode::ThreadSafe>();
+		Fake->Time = &Time;
+		Fake->Latencies = { 0.004, 0.006 };
+		Fake->Sizes = { 1000, 800 };
+		FPICOXRDPEncoderDriver Driver(Fake, [&Time]() { return Time; });
+
+		FPICOXRDPEncoderSettings Settings;
+		Settings.Config.Width = 2048;
+		Settings.Config.Height = 1024;
+		Settings.Config.Bitrate = 20000000;
+		Settings.Config.Fps = 72;
+		Settings.BufferCount = 2;
+		Test.TestTrue(TEXT("Startup without a drain thread"), Driver.Startup(Settings, false));
+
+		// The first frame is a key frame, its latency is the scripted one.
+		Test.TestTrue(TEXT("Submit the first frame"), Driver.SubmitFrame(0, 1));
+		Test.TestTrue(TEXT("Drain the first frame"), Driver.DrainOnce());
+		FPICOXRDPEncodedFrame Frame;
+		Test.TestTrue(TEXT("Pop the first frame"), Driver.PopFrame(Frame));
+		Test.TestTrue(TEXT("First frame number"), Frame.FrameNumber == 1);
+		Test.TestTrue(TEXT("The first frame is a key frame"), Frame.bKeyFrame);
+		Test.TestEqual(TEXT("First frame latency"), Frame.EncodeSeconds, 0.004, 1e-9);
+		Test.TestTrue(TEXT("First frame size"), Frame.Data && Frame.Data->size() == 1000);
+		Driver.ReleaseFrame(Frame);
+
+		// The third frame in flight is dropped rather than waited for.
+		Test.TestTrue(TEXT("Submit the second frame"), Driver.SubmitFrame(0, 2));
+		Test.TestTrue(TEXT("Submit the third frame"), Driver.SubmitFrame(0, 3));
+		Test.TestFalse(TEXT("A frame past the buffers in flight is dropped"), Driver.SubmitFrame(0, 4));
+		FPICOXRDPEncodedFrame Second;
+		Test.TestTrue(TEXT("Drain the second frame"), Driver.DrainOnce());
+		Test.TestTrue(TEXT("Drain the third frame"), Driver.DrainOnce());
+		Test.TestFalse(TEXT("Nothing left to drain"), Driver.DrainOnce());
+		Test.TestTrue(TEXT("Pop the second frame"), Driver.PopFrame(Frame) && Frame.FrameNumber == 2);
+		Test.TestTrue(TEXT("Pop the third frame"), Driver.PopFrame(Second) && Second.FrameNumber == 3);
+		Test.TestTrue(TEXT("Frames in flight use their own buffers"), Frame.Buffer != Second.Buffer);
+		Test.TestEqual(TEXT("Third frame latency"), Second.EncodeSeconds, 0.006, 1e-9);
+		Driver.ReleaseFrame(Frame);
+		Driver.ReleaseFrame(Second);
+
+		// Both buffers have grown once, steady frames no smaller than the first reuse them without allocating.
+		FPICOXRDPEncoderStats Stats = Driver.GetStats();
+		Test.TestEqual(TEXT("Buffers allocated"), Stats.BufferAllocations, (uint64)2);
+		Test.TestEqual(TEXT("Frames dropped in flight"), Stats.DroppedInFlight, (uint64)1);
+		int32 SteadyFrames = 0;
+		for (uint64 FrameNumber = 5; FrameNumber < 25; FrameNumber++)
+		{
+			SteadyFrames += Driver.SubmitFrame(0, FrameNumber) ? DrainAll(Test, Driver) : 0;
+			Time += 1.0 / 72.0;
+		}
+		Test.TestEqual(TEXT("Steady frames encoded"), SteadyFrames, 20);
+		Stats = Driver.GetStats();
+		Test.TestEqual(TEXT("Steady frames reuse the buffers"), Stats.BufferAllocations, (uint64)2);
+		Test.TestEqual(TEXT("Frames encoded"), Stats.Encoded, (uint64)23);
+		Test.TestEqual(TEXT("Key frames"), Stats.KeyFrames, (uint64)1);
+		Test.TestEqual(TEXT("Peak latency"), Stats.PeakLatency, 0.006, 1e-9);
+
+		// With every buffer held by the consumer nothing is drained until one is released.
+		FPICOXRDPEncodedFrame Held[2];
+		for (int32 Index = 0; Index < 2; Index++)
+		{
+			Test.TestTrue(TEXT("Encode a frame to hold"), Driver.SubmitFrame(0, 30 + Index) && Driver.DrainOnce() && Driver.PopFrame(Held[Index]));
+		}
+		Test.TestTrue(TEXT("Submit with every buffer held"), Driver.SubmitFrame(0, 32));
+		Test.TestFalse(TEXT("Nothing is drained with every buffer held"), Driver.DrainOnce());
+		Driver.ReleaseFrame(Held[0]);
+		Test.TestTrue(TEXT("A released buffer is drained into"), Driver.DrainOnce() && Driver.PopFrame(Frame));
+		Test.TestTrue(TEXT("Frame drained into the released buffer"), Frame.FrameNumber == 32);
+		Test.TestTrue(TEXT("The released buffer is reused"), Frame.Buffer == Held[0].Buffer);
+		Driver.ReleaseFrame(Frame);
+		Driver.ReleaseFrame(Held[1]);
+
+		// A frame the encoder never returns is counted once the next one comes out.
+		Fake->LoseTags.Add(40);
+		Test.TestTrue(TEXT("Submit the frame the encoder loses"), Driver.SubmitFrame(0, 40));
+		Test.TestTrue(TEXT("Submit the frame after it"), Driver.SubmitFrame(0, 41));
+		Test.TestEqual(TEXT("Only the frame after the lost one comes out"), DrainAll(Test, Driver), 1);
+		Test.TestEqual(TEXT("Frames dropped by the encoder"), Driver.GetStats().DroppedByEncoder, (uint64)1);
+
+		// A requested key frame is the next frame.
+		Driver.RequestKeyFrame();
+		Test.TestTrue(TEXT("Submit after a key frame request"), Driver.SubmitFrame(0, 50));
+		Test.TestTrue(TEXT("A requested key frame is the next frame"), Fake->KeyFrames.Last());
+		DrainAll(Test, Driver);
+
+		// A loss cuts the bitrate and asks for a key frame, the encoder restarts only once nothing is in flight.
+		Time += Settings.ReconfigureInterval;
+		Test.TestTrue(TEXT("Submit before the loss"), Driver.SubmitFrame(0, 60));
+		FPICOXRDPTunnelSendStats Lossy;
+		Lossy.Seconds = 1.0;
+		Lossy.PacketsSent = 90;
+		Lossy.PacketsDropped = 10;
+		Driver.ReportSendStats(Lossy);
+		Stats = Driver.GetStats();
+		Test.TestEqual(TEXT("A loss cuts the target bitrate"), Stats.TargetBitrate, 16000000);
+		Test.TestEqual(TEXT("The bitrate waits for a restart"), Stats.Bitrate, 20000000);
+		Test.TestEqual(TEXT("A loss starts periodic key frames"), Stats.KeyFrameInterval, Settings.MinKeyFrameInterval);
+		Test.TestTrue(TEXT("Submit after the loss"), Driver.SubmitFrame(0, 61));
+		Test.TestTrue(TEXT("A loss asks for a key frame"), Fake->KeyFrames.Last());
+		Test.TestEqual(TEXT("No restart with a frame in flight"), Fake->Bitrates.Num(), 1);
+		DrainAll(Test, Driver);
+		Test.TestTrue(TEXT("Submit with nothing in flight"), Driver.SubmitFrame(0, 62));
+		Test.TestTrue(TEXT("A restarted encoder starts on a key frame"), Fake->KeyFrames.Last());
+		Test.TestEqual(TEXT("The encoder restarts once nothing is in flight"), Fake->Bitrates.Num(), 2);
+		Test.TestEqual(TEXT("The encoder restarts at the target bitrate"), Fake->Bitrates.Last(), 16000000);
+		Test.TestTrue(TEXT("Restarts counted"), Driver.GetStats().Restarts == 1);
+		DrainAll(Test, Driver);
+
+		// After a loss key frames come every MinKeyFrameInterval frames.
+		int32 KeyFrames = 0;
+		for (uint64 FrameNumber = 63; FrameNumber < 63 + Settings.MinKeyFrameInterval; FrameNumber++)
+		{
+			Test.TestTrue(TEXT("Submit a frame after the loss"), Driver.SubmitFrame(0, FrameNumber));
+			KeyFrames += Fake->KeyFrames.Last() ? 1 : 0;
+			DrainAll(Test, Driver);
+		}
+		Test.TestEqual(TEXT("One key frame every MinKeyFrameInterval frames"), KeyFrames, 1);
+
+		// A congested send queue cuts the bitrate without a key frame, clean sends raise it back and end the periodic key frames.
+		FPICOXRDPTunnelSendStats Congested;
+		Congested.PacketsSent = 100;
+		Congested.QueueDelaySeconds = 0.1;
+		Driver.ReportSendStats(Congested);
+		Test.TestEqual(TEXT("Congestion cuts the target bitrate"), Driver.GetStats().TargetBitrate, 12800000);
+		FPICOXRDPTunnelSendStats Clean;
+		Clean.PacketsSent = 100;
+		for (int32 Index = 0; Index < 40; Index++)
+		{
+			Driver.ReportSendStats(Clean);
+		}
+		Stats = Driver.GetStats();
+		Test.TestEqual(TEXT("Clean sends raise the target bitrate back"), Stats.TargetBitrate, Settings.MaxBitrate);
+		Test.TestEqual(TEXT("Clean sends end the periodic key frames"), Stats.KeyFrameInterval, 0);
+
+		// Within the reconfigure interval of the last restart the bitrate stays.
+		Test.TestTrue(TEXT("Submit within the reconfigure interval"), Driver.SubmitFrame(0, 100));
+		Test.TestTrue(TEXT("No restart within the reconfigure interval"), Driver.GetStats().Restarts == 1);
+		DrainAll(Test, Driver);
+		Time += Settings.ReconfigureInterval;
+		Test.TestTrue(TEXT("Submit after the reconfigure interval"), Driver.SubmitFrame(0, 101));
+		Test.TestEqual(TEXT("The encoder restarts at the raised bitrate"), Driver.GetStats().Bitrate, Settings.MaxBitrate);
+		DrainAll(Test, Driver);
+
+		Test.TestEqual(TEXT("Restarts keep the buffers"), Driver.GetStats().BufferAllocations, (uint64)2);
+		Driver.Shutdown();
+		Test.TestFalse(TEXT("Not running after shutdown"), Driver.IsRunning());
+		Test.TestFalse(TEXT("No submit after shutdown"), Driver.SubmitFrame(0, 102));
+	}
+
+	/** The drain thread gets every frame out while the caller only submits and consumes. */
+	static void TestThreaded(FAutomationTestBase& Test)
+	{
+		TSharedRef<FFakeEncoder, ESPMode::ThreadSafe> Fake = MakeShared<FFakeEncoder, ESPMode::ThreadSafe>();
+		FPICOXRDPEncoderDriver Driver(Fake);
+		FPICOXRDPEncoderSettings Settings;
+		Settings.Config.Bitrate = 20000000;
+		Settings.Config.Fps = 72;
+		Test.TestTrue(TEXT("Startup with a drain thread"), Driver.Startup(Settings));
+
+		const uint64 FrameCount = 50;
+		uint64 Received = 0;
+		int32 OutOfOrder = 0;
+		for (uint64 FrameNumber = 0; FrameNumber < FrameCount; FrameNumber++)
+		{
+			Test.TestTrue(TEXT("Submit to the drain thread"), Driver.SubmitFrame(0, FrameNumber));
+			const double Deadline = FPlatformTime::Seconds() + 1.0;
+			while (Received <= FrameNumber && FPlatformTime::Seconds() < Deadline)
+			{
+				FPICOXRDPEncodedFrame Frame;
+				if (Driver.PopFrame(Frame))
+				{
+					OutOfOrder += Frame.FrameNumber == Received ? 0 : 1;
+					Driver.ReleaseFrame(Frame);
+					Received++;
+				}
+				else
+				{
+					FPlatformProcess::Sleep(0.0005f);
+				}
+			}
+		}
+		Driver.Shutdown();
+		Test.TestEqual(TEXT("Frames received from the drain thread"), Received, FrameCount);
+		Test.TestEqual(TEXT("Frames received out of order"), OutOfOrder, 0);
+	}
+}
+
+/** Drives the direct preview encoder driver with a fake encoder at scripted latencies and sizes. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPEncoderDriverTest, "PICOXR.DP.EncoderDriver", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPEncoderDriverTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPEncoderTests::TestScripted(*this);
+	PICOXRDPEncoderTests::TestThreaded(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,95 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPLatency.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPLatencyTests
+{
+	/** Checks a stage every frame of which took Seconds. */
+	static void ExpectStage(FAutomationTestBase& Test, const TCHAR* What, const FPICOXRDPLatencyReport& Report, EPICOXRDPLatencyStage Stage, double Seconds)
+	{
+		Test.TestEqual(*FString::Printf(TEXT("%s median"), What), Report.Stages[(int32)Stage].P50, Seconds, 1.0e-9);
+		Test.TestEqual(*FString::Printf(TEXT("%s maximum"), What), Report.Stages[(int32)Stage].Max, Seconds, 1.0e-9);
+	}
+
+	static void TestHarness(FAutomationTestBase& Test)
+	{
+		FPICOXRDPLatencyHarness Harness;
+
+		// Without jitter, pacing or vsync every frame takes exactly the scripted costs.
+		FPICOXRDPLatencyHarnessSettings Fixed;
+		Fixed.Frames = 120;
+		Fixed.RenderJitter = 0.0;
+		Fixed.EncodeJitter = 0.0;
+		Fixed.NetworkJitter = 0.0;
+		Fixed.PacingRate = 0.0;
+		Fixed.RemoteFps = 0;
+		FPICOXRDPLatencyReport Report = Harness.Run(Fixed);
+		Test.TestTrue(TEXT("Frames run"), Report.Frames == 120);
+		Test.TestTrue(TEXT("No frame dropped"), Report.DroppedFrames == 0);
+		Test.TestEqual(TEXT("One total sample per frame"), Harness.GetSamples(EPICOXRDPLatencyStage::Total).Num(), 120);
+		ExpectStage(Test, TEXT("Render"), Report, EPICOXRDPLatencyStage::Render, Fixed.RenderSeconds);
+		ExpectStage(Test, TEXT("Submit"), Report, EPICOXRDPLatencyStage::Submit, Fixed.SubmitSeconds);
+		ExpectStage(Test, TEXT("Encode"), Report, EPICOXRDPLatencyStage::Encode, Fixed.EncodeSeconds);
+		ExpectStage(Test, TEXT("Unpaced send"), Report, EPICOXRDPLatencyStage::Send, 0.0);
+		ExpectStage(Test, TEXT("Present"), Report, EPICOXRDPLatencyStage::Present, Fixed.NetworkSeconds + Fixed.DecodeSeconds);
+		ExpectStage(Test, TEXT("Total"), Report, EPICOXRDPLatencyStage::Total,
+			Fixed.RenderSeconds + Fixed.SubmitSeconds + Fixed.EncodeSeconds + Fixed.NetworkSeconds + Fixed.DecodeSeconds);
+
+		// Paced, a frame takes what its bytes beyond the burst need at the pacing rate to leave.
+		FPICOXRDPLatencyHarnessSettings Paced = Fixed;
+		Paced.PacingRate = 20000000.0;
+		Report = Harness.Run(Paced);
+		const double PacedSeconds = (Paced.FrameBytes - 16 * 1024) / Paced.PacingRate;
+		const double PacedSend = Report.Stages[(int32)EPICOXRDPLatencyStage::Send].P50;
+		Test.TestTrue(TEXT("A paced frame takes its bytes beyond the burst to leave"), PacedSend > PacedSeconds && PacedSend < PacedSeconds * 1.5);
+
+		// An encoder slower than the frame rate queues every frame behind the one before.
+		FPICOXRDPLatencyHarnessSettings Slow = Fixed;
+		Slow.Frames = 60;
+		Slow.EncodeSeconds = 0.02;
+		Report = Harness.Run(Slow);
+		const TArray<double>& Encodes = Harness.GetSamples(EPICOXRDPLatencyStage::Encode);
+		if (Test.TestEqual(TEXT("One encode sample per frame"), Encodes.Num(), 60))
+		{
+			Test.TestEqual(TEXT("The first frame takes the encode cost"), Encodes[0], Slow.EncodeSeconds, 1.0e-9);
+			Test.TestTrue(TEXT("A slow encoder queues every frame behind the one before"), Encodes.Last() > Encodes[0] + 50 * (Slow.EncodeSeconds - 1.0 / Slow.Fps));
+		}
+
+		// The same seed gives the same run, and a slower encoder shows as a regression of encode and total alone.
+		// Presenting on a remote vsync in phase with the frames would hide a few milliseconds of it in the total.
+		FPICOXRDPLatencyHarnessSettings Jittered;
+		Jittered.Frames = 300;
+		Jittered.RemoteFps = 0;
+		const FPICOXRDPLatencyReport Baseline = Harness.Run(Jittered);
+		Report = Harness.Run(Jittered);
+		Test.TestEqual(TEXT("The same seed gives the same run"), Report.ToString(), Baseline.ToString());
+		Test.TestEqual(TEXT("No regression against the same run"), Report.FindRegressions(Baseline).Num(), 0);
+		Test.TestTrue(TEXT("Jitter spreads the render stage"), Baseline.Stages[(int32)EPICOXRDPLatencyStage::Render].P50 < Baseline.Stages[(int32)EPICOXRDPLatencyStage::Render].P99);
+		Jittered.EncodeSeconds += 0.005;
+		Report = Harness.Run(Jittered);
+		const TArray<EPICOXRDPLatencyStage> Regressions = Report.FindRegressions(Baseline);
+		Test.TestTrue(TEXT("A slower encoder regresses encode"), Regressions.Contains(EPICOXRDPLatencyStage::Encode));
+		Test.TestTrue(TEXT("A slower encoder regresses total"), Regressions.Contains(EPICOXRDPLatencyStage::Total));
+		Test.TestFalse(TEXT("A slower encoder does not regress render"), Regressions.Contains(EPICOXRDPLatencyStage::Render));
+		Test.TestFalse(TEXT("A slower encoder does not regress submit"), Regressions.Contains(EPICOXRDPLatencyStage::Submit));
+
+		// A report reads back as it was written.
+		FPICOXRDPLatencyReport ReadBack;
+		Test.TestTrue(TEXT("A written report reads back"), ReadBack.FromString(Baseline.ToString()));
+		Test.TestTrue(TEXT("Frames read back"), ReadBack.Frames == Baseline.Frames);
+		Test.TestEqual(TEXT("Total 95th percentile read back"), ReadBack.Stages[(int32)EPICOXRDPLatencyStage::Total].P95, Baseline.Stages[(int32)EPICOXRDPLatencyStage::Total].P95, 1.0e-6);
+		Test.TestFalse(TEXT("A truncated report does not read"), ReadBack.FromString(TEXT("Frames 1 0\nRender 1 2 3 4\n")));
+	}
+}
+
+/** Checks the direct preview latency harness against scripted stage costs and a slowed encoder. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPLatencyHarnessTest, "PICOXR.DP.LatencyHarness", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPLatencyHarnessTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPLatencyTests::TestHarness(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,275 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPLayerCompositor.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPLayerCompositorTests
+{
+	/** Provider whose textures are addresses into Textures, so a target can be told from the one it draws into. */
+	class FFakeProvider : public IPICOXRDPLayerTargetProvider
+	{
+	public:
+		uint8 Textures[64] = {};
+		TArray<FIntPoint> Sizes;
+		int32 Creates = 0;
+		int32 Destroys = 0;
+		bool bFail = false;
+
+		virtual bool CreateTarget(int32 Target, FIntPoint Size, bool bShared) override
+		{
+			if (bFail || Target >= 64)
+			{
+				return false;
+			}
+			Creates++;
+			Sizes.Add(Size);
+			return true;
+		}
+		virtual void DestroyTarget(int32 Target) override { Destroys++; }
+		virtual FRHITexture2D* GetTexture(int32 Target) const override { return (FRHITexture2D*)&Textures[Target]; }
+		virtual uint64 GetSharedHandle(int32 Target) const override { return 0x200 + Target; }
+	};
+
+	/** Renderer that only records what it was asked to draw. */
+	class FFakeRenderer : public IPICOXRDPLayerRenderer
+	{
+	public:
+		struct FDraw
+		{
+			TCHAR Kind;
+			uint32 Id;
+			FRHITexture2D* Target;
+		};
+		TArray<FDraw> Draws;
+
+		int32 Count(TCHAR Kind) const
+		{
+			int32 Found = 0;
+			for (const FDraw& Draw : Draws)
+			{
+				Found += Draw.Kind == Kind ? 1 : 0;
+			}
+			return Found;
+		}
+
+		virtual void RenderLayer(const FPICOXRDPLayerInput& Input, int32 Eye, FRHITexture2D* Target, bool bClear) override
+		{
+			Draws.Add({ bClear ? TEXT('R') : TEXT('D'), Input.Layer.Id, Target });
+		}
+		virtual void BlendLayer(FRHITexture2D* Source, FRHITexture2D* Target) override
+		{
+			Draws.Add({ TEXT('B'), 0, Target });
+		}
+		virtual void CopyLayer(const FPICOXRDPLayerInput& Input, FRHITexture2D* Target) override
+		{
+			Draws.Add({ TEXT('C'), Input.Layer.Id, Target });
+		}
+	};
+
+	/** Terminal that takes overlay layers while bAccepts. */
+	class FFakeTerminal : public IPICOXRDPTerminal
+	{
+	public:
+		TArray<FPICOXRDPOverlayLayer> Overlays;
+		bool bAccepts = true;
+
+		virtual bool QueryHmdPose(uint64 Frame, FPICOXRDPPoseSample& OutPose) override { return false; }
+		virtual bool SubmitEyeLayer(const FPICOXRDPEyeLayer& Layer) override { return true; }
+		virtual bool SubmitOverlayLayer(const FPICOXRDPOverlayLayer& Layer) override
+		{
+			if (bAccepts)
+			{
+				Overlays.Add(Layer);
+			}
+			return bAccepts;
+		}
+	};
+
+	static FPICOXRDPLayerInput MakeLayer(uint32 Id, int32 Priority, EPICOXRDPLayerSpace Space)
+	{
+		static uint8 LayerTextures[16];
+		FPICOXRDPLayerInput Input;
+		Input.Layer.Id = Id;
+		Input.Layer.Priority = Priority;
+		Input.Layer.Space = Space;
+		Input.Layer.TextureSize = FIntPoint(512, 256);
+		Input.Texture = (FRHITexture2D*)&LayerTextures[Id];
+		return Input;
+	}
+
+	static void TestComposite(FAutomationTestBase& Test)
+	{
+		TSharedRef<FFakeProvider> Provider = MakeShared<FFakeProvider>();
+		FPICOXRDPLayerCompositor Compositor(Provider);
+		FPICOXRDPLayerCompositorSettings Settings;
+		Settings.IdleFrames = 2;
+		Compositor.SetSettings(Settings);
+		FFakeRenderer Renderer;
+		uint8 Eyes[2];
+		FRHITexture2D* const EyeTextures[2] = { (FRHITexture2D*)&Eyes[0], (FRHITexture2D*)&Eyes[1] };
+		FPICOXRDPLayerView View;
+		View.EyeSize = FIntPoint(960, 1920);
+
+		TArray<FPICOXRDPLayerInput> Layers;
+		Layers.Add(MakeLayer(1, 2, EPICOXRDPLayerSpace::World));
+		Layers.Add(MakeLayer(2, 1, EPICOXRDPLayerSpace::Face));
+
+		// The first frame draws both layers for both eyes into targets of their own, the lower priority first.
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("Both layers drawn for both eyes"), Renderer.Count(TEXT('R')), 4);
+		Test.TestEqual(TEXT("Both targets blended into both eyes"), Renderer.Count(TEXT('B')), 4);
+		Test.TestEqual(TEXT("A target per layer and eye"), Provider->Creates, 4);
+		if (Test.TestTrue(TEXT("Draws recorded"), Renderer.Draws.Num() >= 2))
+		{
+			Test.TestTrue(TEXT("The lower priority layer is drawn first"), Renderer.Draws[0].Id == 2);
+			Test.TestTrue(TEXT("Its target is blended into the left eye next"), Renderer.Draws[1].Kind == TEXT('B') && Renderer.Draws[1].Target == EyeTextures[0]);
+		}
+		if (Test.TestEqual(TEXT("Target sizes"), Provider->Sizes.Num(), 4))
+		{
+			Test.TestEqual(TEXT("Targets are the size of the eyes"), Provider->Sizes[0], View.EyeSize);
+		}
+
+		// Nothing changed, the targets are only blended.
+		Renderer.Draws.Reset();
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("Nothing changed, nothing drawn"), Renderer.Count(TEXT('R')), 0);
+		Test.TestEqual(TEXT("Nothing changed, the targets are blended"), Renderer.Count(TEXT('B')), 4);
+		Test.TestEqual(TEXT("Skipped layers"), Compositor.GetStats().SkippedLayers, (uint64)4);
+
+		// A texture marked for update, or a head that moved, draws only the layers it concerns.
+		Renderer.Draws.Reset();
+		Layers[1].TextureRevision++;
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("A texture marked for update draws its layer"), Renderer.Count(TEXT('R')), 2);
+		Test.TestTrue(TEXT("The updated layer is the one drawn"), Renderer.Draws.Num() > 0 && Renderer.Draws[0].Id == 2);
+		Renderer.Draws.Reset();
+		View.SpaceHashes[(int32)EPICOXRDPLayerSpace::World] = 7;
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("A moved world space draws its layer"), Renderer.Count(TEXT('R')), 2);
+		Test.TestTrue(TEXT("The world layer is the one drawn"), Renderer.Draws.Num() > 2 && Renderer.Draws[2].Id == 1);
+		Renderer.Draws.Reset();
+		Layers[1].Layer.Position = FVector(0.0f, 0.0f, 10.0f);
+		Layers[0].bContinuousUpdate = true;
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("A moved layer and a continuously updated one are both drawn"), Renderer.Count(TEXT('R')), 4);
+		Layers[0].bContinuousUpdate = false;
+
+		// A layer gone gives its targets back, and a new one of the same size takes them without creating any.
+		Layers.RemoveAt(1);
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("Layers left"), Compositor.GetNumLayers(), 1);
+		Test.TestEqual(TEXT("A layer gone gives its targets back"), Compositor.GetPoolStats().Idle, 2);
+		Layers.Add(MakeLayer(3, 0, EPICOXRDPLayerSpace::Tracker));
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("A new layer creates no target"), Provider->Creates, 4);
+		Test.TestTrue(TEXT("A new layer reuses the targets given back"), Compositor.GetPoolStats().Reuses == 2);
+		Test.TestEqual(TEXT("No target idle once reused"), Compositor.GetPoolStats().Idle, 0);
+
+		// Idle targets are destroyed once they stay unused for longer than the settings allow.
+		Layers.RemoveAt(1);
+		for (int32 Frame = 0; Frame < 3; Frame++)
+		{
+			Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		}
+		Test.TestEqual(TEXT("Idle targets destroyed"), Provider->Destroys, 2);
+		Test.TestEqual(TEXT("No target idle once destroyed"), Compositor.GetPoolStats().Idle, 0);
+		Test.TestEqual(TEXT("Targets in use"), Compositor.GetPoolStats().InUse, 2);
+
+		// A new eye size draws everything again into targets of that size.
+		Renderer.Draws.Reset();
+		View.EyeSize = FIntPoint(1024, 1024);
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("A new eye size draws everything again"), Renderer.Count(TEXT('R')), 2);
+		Test.TestEqual(TEXT("Targets of the new eye size"), Provider->Sizes.Last(), FIntPoint(1024, 1024));
+
+		// Opaque layers go straight into the eyes every frame, without a target.
+		Renderer.Draws.Reset();
+		FPICOXRDPLayerInput Opaque = MakeLayer(4, 5, EPICOXRDPLayerSpace::Face);
+		Opaque.Layer.bNoAlpha = true;
+		Layers.Add(Opaque);
+		const int32 InUse = Compositor.GetPoolStats().InUse;
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("Opaque layers are drawn into the eyes every frame"), Renderer.Count(TEXT('D')), 4);
+		Test.TestTrue(TEXT("The opaque layer is drawn last into the right eye"), Renderer.Draws.Num() > 0 && Renderer.Draws.Last().Target == EyeTextures[1]);
+		Test.TestEqual(TEXT("Opaque layers take no target"), Compositor.GetPoolStats().InUse, InUse);
+
+		// Without targets to keep them in, the layers are still drawn into the eyes.
+		Provider->bFail = true;
+		Compositor.Reset();
+		Renderer.Draws.Reset();
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, nullptr);
+		Test.TestEqual(TEXT("Without targets the layers are drawn into the eyes"), Renderer.Count(TEXT('D')), 4);
+		Test.TestEqual(TEXT("Without targets nothing is drawn into one"), Renderer.Count(TEXT('R')), 0);
+		Test.TestTrue(TEXT("Target creation failures"), Compositor.GetPoolStats().CreateFailures == 1);
+	}
+
+	static void TestForward(FAutomationTestBase& Test)
+	{
+		TSharedRef<FFakeProvider> Provider = MakeShared<FFakeProvider>();
+		FPICOXRDPLayerCompositor Compositor(Provider);
+		FPICOXRDPLayerCompositorSettings Settings;
+		Settings.bForwardLayers = true;
+		Compositor.SetSettings(Settings);
+		FFakeRenderer Renderer;
+		FFakeTerminal Terminal;
+		uint8 Eyes[2];
+		FRHITexture2D* const EyeTextures[2] = { (FRHITexture2D*)&Eyes[0], (FRHITexture2D*)&Eyes[1] };
+		FPICOXRDPLayerView View;
+		View.EyeSize = FIntPoint(960, 1920);
+		TArray<FPICOXRDPLayerInput> Layers;
+		Layers.Add(MakeLayer(1, 0, EPICOXRDPLayerSpace::World));
+		Layers.Add(MakeLayer(2, 1, EPICOXRDPLayerSpace::Face));
+
+		// Forwarded layers are copied at their own size and not drawn into the eyes.
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, &Terminal);
+		Test.TestEqual(TEXT("Forwarded layers are copied"), Renderer.Count(TEXT('C')), 2);
+		Test.TestEqual(TEXT("Forwarded layers are not blended into the eyes"), Renderer.Count(TEXT('B')), 0);
+		if (Test.TestEqual(TEXT("Target sizes"), Provider->Sizes.Num(), 2))
+		{
+			Test.TestEqual(TEXT("Forwarded targets are the size of the layer"), Provider->Sizes[0], FIntPoint(512, 256));
+		}
+		if (Test.TestEqual(TEXT("Overlays submitted"), Terminal.Overlays.Num(), 2))
+		{
+			Test.TestTrue(TEXT("Overlay id"), Terminal.Overlays[0].Id == 1);
+			Test.TestTrue(TEXT("A new overlay has its texture updated"), Terminal.Overlays[0].bTextureUpdated);
+			Test.TestEqual(TEXT("Overlay handle"), Terminal.Overlays[0].Handle, (uint64)0x200);
+		}
+
+		// Unchanged textures are not copied again, the layers are still submitted.
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, &Terminal);
+		Test.TestEqual(TEXT("Unchanged textures are not copied again"), Renderer.Count(TEXT('C')), 2);
+		Test.TestEqual(TEXT("Unchanged layers are still submitted"), Terminal.Overlays.Num(), 4);
+		Test.TestFalse(TEXT("An unchanged overlay has no texture update"), Terminal.Overlays.Last().bTextureUpdated);
+		Layers[1].TextureRevision++;
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, &Terminal);
+		Test.TestEqual(TEXT("A texture marked for update is copied"), Renderer.Count(TEXT('C')), 3);
+		Test.TestTrue(TEXT("Its overlay has the texture updated"), Terminal.Overlays.Last().bTextureUpdated);
+
+		// A terminal that refuses them has the layers composited, from the one refused on.
+		Terminal.bAccepts = false;
+		Renderer.Draws.Reset();
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, &Terminal);
+		Test.TestTrue(TEXT("Forwarding refused"), Compositor.IsForwardingRefused());
+		Test.TestEqual(TEXT("Refused layers are drawn"), Renderer.Count(TEXT('R')), 4);
+		Test.TestEqual(TEXT("Refused layers are blended into the eyes"), Renderer.Count(TEXT('B')), 4);
+		Renderer.Draws.Reset();
+		Compositor.Composite(Renderer, View, Layers, EyeTextures, &Terminal);
+		Test.TestEqual(TEXT("No copy once refused"), Renderer.Count(TEXT('C')), 0);
+		Test.TestEqual(TEXT("Unchanged layers are not drawn again once refused"), Renderer.Count(TEXT('R')), 0);
+		Test.TestEqual(TEXT("Layers are blended once refused"), Renderer.Count(TEXT('B')), 4);
+		Test.TestEqual(TEXT("Forwarded layers"), Compositor.GetStats().ForwardedLayers, (uint64)6);
+	}
+}
+
+/** Composites and forwards direct preview stereo layers through a fake renderer, target provider and terminal. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPLayerCompositorTest, "PICOXR.DP.LayerCompositor", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPLayerCompositorTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPLayerCompositorTests::TestComposite(*this);
+	PICOXRDPLayerCompositorTests::TestForward(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,198 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPPoseTimeline.h"
+#include "PXR_DPTerminal.h"
+#include "PXR_DPTextureRing.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPPoseTimelineTests
+{
+	/** Slots that always exist and are never held by a streamer. */
+	class FFakeProvider : public IPICOXRDPSharedTextureProvider
+	{
+	public:
+		virtual bool CreateSlot(int32 Slot, FIntPoint EyeSize) override { return true; }
+		virtual void DestroySlot(int32 Slot) override {}
+		virtual bool AcquireSlot(int32 Slot, uint32 TimeoutMs) override { return true; }
+		virtual void ReleaseSlot(int32 Slot, bool bToStreamer) override {}
+		virtual uint64 GetSharedHandle(int32 Slot, int32 Eye) const override { return 0x100 + Slot * 2 + Eye; }
+		virtual FRHITexture2D* GetTexture(int32 Slot, int32 Eye) const override { return nullptr; }
+	};
+
+	/** Terminal whose headset moves along X by a centimetre every pose query, and that keeps the layers submitted. */
+	class FFakeTerminal : public IPICOXRDPTerminal
+	{
+	public:
+		TArray<FPICOXRDPEyeLayer> Layers;
+		int32 Queries = 0;
+
+		virtual bool QueryHmdPose(uint64 Frame, FPICOXRDPPoseSample& OutPose) override
+		{
+			Queries++;
+			OutPose = FPICOXRDPPoseSample();
+			OutPose.Position = FVector(Queries, 0.0f, 0.0f);
+			OutPose.RemoteTimestamp = Queries * 1000;
+			OutPose.RemoteIndex = Queries;
+			return true;
+		}
+
+		virtual bool SubmitEyeLayer(const FPICOXRDPEyeLayer& Layer) override
+		{
+			Layers.Add(Layer);
+			return true;
+		}
+	};
+
+	static FPICOXRDPPoseSample MakePose(float X, int64 RemoteTimestamp, double HostTime)
+	{
+		FPICOXRDPPoseSample Pose;
+		Pose.Position = FVector(X, 0.0f, 0.0f);
+		Pose.RemoteTimestamp = RemoteTimestamp;
+		Pose.RemoteIndex = (uint64)RemoteTimestamp;
+		Pose.HostTime = HostTime;
+		return Pose;
+	}
+
+	/** The remote clock runs 100 s ahead of the host, in ns, and its poses reach the host 1 to 4 ms after they were sampled. */
+	static void TestClock(FAutomationTestBase& Test)
+	{
+		double Time = 1.0;
+		FPICOXRDPPoseTimeline Timeline([&Time]() { return Time; });
+		Test.TestFalse(TEXT("No clock offset before the first pose"), Timeline.HasClockOffset());
+
+		const double Delays[] = { 0.004, 0.002, 0.001, 0.003, 0.002 };
+		for (int32 Frame = 0; Frame < 5; Frame++)
+		{
+			const double Sampled = 1.0 + Frame / 72.0;
+			Time = Sampled + Delays[Frame];
+			Timeline.AddRenderPose(Frame, MakePose(Frame, (int64)((Sampled + 100.0) * 1000000000.0), 0.0));
+		}
+		// The least delayed pose sets the offset, off the true one by its 1 ms.
+		Test.TestTrue(TEXT("Clock offset from the poses"), Timeline.HasClockOffset());
+		Test.TestEqual(TEXT("Remote time to host time"), Timeline.RemoteToHost((int64)(101.5 * 1000000000.0)), 1.501, 0.000001);
+		Test.TestTrue(TEXT("Host time to remote time"), FMath::Abs(Timeline.HostToRemote(1.501) - (int64)(101.5 * 1000000000.0)) < 1000);
+
+		// A newer pose read later in the frame leaves the first one and its time, and does not move the offset.
+		FPICOXRDPPoseSample Pose;
+		Time = 2.0;
+		Timeline.AddRenderPose(4, MakePose(40.0f, (int64)(101.9 * 1000000000.0), 0.0));
+		if (Test.TestTrue(TEXT("Pose of frame 4"), Timeline.FindByFrame(4, Pose)))
+		{
+			Test.TestEqual(TEXT("A newer pose leaves the first one"), Pose.Position.X, 4.0f, 0.0f);
+			Test.TestEqual(TEXT("A newer pose leaves the time of the first one"), Pose.HostTime, 1.0 + 4 / 72.0 + 0.002, 0.000001);
+		}
+		Test.TestEqual(TEXT("A newer pose does not move the offset"), Timeline.RemoteToHost((int64)(101.5 * 1000000000.0)), 1.501, 0.000001);
+	}
+
+	static void TestHistory(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		FPICOXRDPPoseTimeline Timeline([&Time]() { return Time; });
+		FPICOXRDPPoseTimelineSettings Settings;
+		Settings.HistoryFrames = 8;
+		Timeline.Configure(Settings);
+
+		for (int32 Frame = 1; Frame <= 8; Frame++)
+		{
+			Timeline.AddRenderPose(Frame, MakePose(Frame * 10.0f, Frame * 1000, Frame * 0.01));
+		}
+		FPICOXRDPPoseSample Pose;
+		if (Test.TestTrue(TEXT("Pose of frame 3"), Timeline.FindByFrame(3, Pose)))
+		{
+			Test.TestEqual(TEXT("Position of frame 3"), Pose.Position.X, 30.0f, 0.0f);
+			Test.TestEqual(TEXT("Remote index of frame 3"), Pose.RemoteIndex, (uint64)3000);
+		}
+		Test.TestFalse(TEXT("No pose of a frame not rendered"), Timeline.FindByFrame(9, Pose));
+
+		// Between two poses of the remote the pose is interpolated, outside of them there is none.
+		if (Test.TestTrue(TEXT("Pose between two remote poses"), Timeline.FindByRemoteTime(3250, Pose)))
+		{
+			Test.TestEqual(TEXT("Interpolated position"), Pose.Position.X, 32.5f, 0.001f);
+			Test.TestEqual(TEXT("Interpolated remote time"), Pose.RemoteTimestamp, (int64)3250);
+		}
+		if (Test.TestTrue(TEXT("Pose at the last remote time"), Timeline.FindByRemoteTime(8000, Pose)))
+		{
+			Test.TestEqual(TEXT("Position at the last remote time"), Pose.Position.X, 80.0f, 0.0f);
+		}
+		Test.TestFalse(TEXT("No pose before the history"), Timeline.FindByRemoteTime(500, Pose));
+		Test.TestFalse(TEXT("No pose after the history"), Timeline.FindByRemoteTime(8001, Pose));
+
+		// The frames after the history push the first out.
+		Timeline.AddRenderPose(9, MakePose(90.0f, 9000, 0.09));
+		Test.TestFalse(TEXT("The first frame is pushed out"), Timeline.FindByFrame(1, Pose));
+		Test.TestTrue(TEXT("The second frame stays"), Timeline.FindByFrame(2, Pose));
+		Test.TestTrue(TEXT("The new frame is kept"), Timeline.FindByFrame(9, Pose));
+
+		Timeline.Reset();
+		Test.TestFalse(TEXT("No pose after a reset"), Timeline.FindByFrame(9, Pose));
+		Test.TestFalse(TEXT("No clock offset after a reset"), Timeline.HasClockOffset());
+	}
+
+	/** Layers carry the pose of their own render and the times of it, even once the headset moved on. */
+	static void TestStamps(FAutomationTestBase& Test)
+	{
+		double Time = 10.0;
+		FPICOXRDPPoseTimeline Timeline([&Time]() { return Time; });
+		Timeline.SetPredictedLatency(0.025);
+		TSharedRef<FFakeTerminal, ESPMode::ThreadSafe> Terminal = MakeShared<FFakeTerminal, ESPMode::ThreadSafe>();
+		FPICOXRDPTextureRing Ring(MakeShared<FFakeProvider>());
+		Ring.Configure(FPICOXRDPTextureRingSettings(), FIntPoint(64, 64));
+
+		// Nothing is submitted before a frame is written.
+		Test.TestFalse(TEXT("Nothing to submit before a frame is written"), Terminal->SubmitLatest(Ring.GetLatestFrame(), Timeline));
+		Test.TestEqual(TEXT("No layer before a frame is written"), Terminal->Layers.Num(), 0);
+
+		// Frame 5 renders at the first pose, by then the terminal has two newer ones.
+		FPICOXRDPPoseSample Pose;
+		Terminal->QueryHmdPose(5, Pose);
+		Timeline.AddRenderPose(5, Pose);
+		Time = 10.008;
+		const int32 Slot = Ring.BeginWrite();
+		Ring.EndWrite(Slot, 5);
+		Timeline.MarkRendered(5);
+		Terminal->QueryHmdPose(6, Pose);
+		Terminal->QueryHmdPose(7, Pose);
+		Time = 10.012;
+		Test.TestTrue(TEXT("Submit the frame written"), Terminal->SubmitLatest(Ring.GetLatestFrame(), Timeline));
+		if (Test.TestEqual(TEXT("Layers submitted"), Terminal->Layers.Num(), 1))
+		{
+			const FPICOXRDPEyeLayer& Layer = Terminal->Layers.Last();
+			Test.TestEqual(TEXT("Layer frame"), Layer.Frame, (uint64)5);
+			Test.TestEqual(TEXT("The layer carries the pose of its render"), Layer.Position.X, 1.0f, 0.0f);
+			Test.TestEqual(TEXT("Layer pose time"), Layer.PoseTimestamp, (int64)1000);
+			Test.TestEqual(TEXT("Layer pose index"), Layer.PoseIndex, (uint64)1);
+			Test.TestEqual(TEXT("Left eye handle of the slot"), Layer.EyeHandles[0], (uint64)(0x100 + Slot * 2));
+			Test.TestEqual(TEXT("Right eye handle of the slot"), Layer.EyeHandles[1], (uint64)(0x101 + Slot * 2));
+			Test.TestEqual(TEXT("Layer render time"), Layer.RenderTime, 10.008, 0.000001);
+			Test.TestEqual(TEXT("Layer display time"), Layer.DisplayTime, 10.033, 0.000001);
+			Test.TestEqual(TEXT("Layer render time on the remote clock"), Layer.RenderTimestamp, Timeline.HostToRemote(10.008));
+			Test.TestEqual(TEXT("Layer display time on the remote clock"), Layer.DisplayTimestamp, Timeline.HostToRemote(10.033));
+		}
+
+		// Without the pose of the frame it goes with the current one, and is stamped as rendered now.
+		Timeline.Reset();
+		Test.TestTrue(TEXT("Submit without the pose of the frame"), Terminal->SubmitLatest(Ring.GetLatestFrame(), Timeline));
+		if (Test.TestEqual(TEXT("Layers submitted without the pose of the frame"), Terminal->Layers.Num(), 2))
+		{
+			const FPICOXRDPEyeLayer& Fallback = Terminal->Layers.Last();
+			Test.TestEqual(TEXT("Fallback layer frame"), Fallback.Frame, (uint64)5);
+			Test.TestEqual(TEXT("Without its pose the layer goes with the current one"), Fallback.Position.X, 4.0f, 0.0f);
+			Test.TestEqual(TEXT("Without its pose the layer is stamped as rendered now"), Fallback.RenderTime, 10.012, 0.000001);
+			Test.TestEqual(TEXT("No remote render time without a clock offset"), Fallback.RenderTimestamp, (int64)0);
+			Test.TestEqual(TEXT("No remote display time without a clock offset"), Fallback.DisplayTimestamp, (int64)0);
+		}
+	}
+}
+
+/** Checks the direct preview pose history, clock matching and eye layer stamps on a fake clock. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPPoseTimelineTest, "PICOXR.DP.PoseTimeline", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPPoseTimelineTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPPoseTimelineTests::TestClock(*this);
+	PICOXRDPPoseTimelineTests::TestHistory(*this);
+	PICOXRDPPoseTimelineTests::TestStamps(*this);
+	return true;
+}
+#endif
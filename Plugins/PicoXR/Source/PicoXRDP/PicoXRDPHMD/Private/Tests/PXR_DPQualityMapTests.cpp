@@ -0,0 +1,237 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPQualityMap.h"
+#include "PXR_HMDFunctionLibrary.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPQualityMapTests
+{
+	/** Encoder that only records its configs, and takes quality maps if bTakesMaps. */
+	class FFakeEncoder : public IPICOXRDPEncoder
+	{
+	public:
+		TArray<FPICOXRDPEncoderConfig> Configs;
+		bool bTakesMaps = false;
+		int32 Maps = 0;
+
+		virtual bool Startup(const FPICOXRDPEncoderConfig& Config) override { Configs.Add(Config); return true; }
+		virtual void Shutdown() override {}
+		virtual bool Submit(uint64 Texture, uint64 Tag, bool bKeyFrame) override { return true; }
+		virtual bool Acquire(std::vector<uint8>& OutData, uint64& OutTag) override { return false; }
+		virtual void Flush() override {}
+
+		virtual bool SetQualityMap(const FPICOXRDPQualityMap& Map) override
+		{
+			Maps += bTakesMaps ? 1 : 0;
+			return bTakesMaps;
+		}
+	};
+
+	static FVector GazeAt(float YawDegrees, float PitchDegrees)
+	{
+		const float Yaw = FMath::DegreesToRadians(YawDegrees);
+		const float Pitch = FMath::DegreesToRadians(PitchDegrees);
+		return FVector(FMath::Cos(Pitch) * FMath::Cos(Yaw), FMath::Cos(Pitch) * FMath::Sin(Yaw), FMath::Sin(Pitch));
+	}
+
+	static bool SameOffsets(const FPICOXRDPQualityMap& A, const TArray<int8>& B)
+	{
+		return A.QpOffsets.Num() == B.Num() && FMemory::Memcmp(A.QpOffsets.GetData(), B.GetData(), B.Num()) == 0;
+	}
+
+	/** Maps of a 1024x512 frame, 512x512 per eye in 16 pixel blocks, at the default FOV. */
+	static void TestMaps(FAutomationTestBase& Test)
+	{
+		FPICOXRDPQualityMapInput Input;
+		Input.FrameSize = FIntPoint(1024, 512);
+		FPICOXRDPQualityMapSettings Settings;
+
+		// Centered on each lens, symmetric left to right and top to bottom, the inner offset in the middle and the outer one in the corners.
+		FPICOXRDPQualityMapBuilder Builder;
+		Builder.SetSettings(Settings);
+		Test.TestTrue(TEXT("Build the lens center map"), Builder.Build(Input));
+		const FPICOXRDPQualityMap& Map = Builder.GetMap();
+		Test.TestEqual(TEXT("Blocks across"), Map.BlocksX, 64);
+		Test.TestEqual(TEXT("Blocks down"), Map.BlocksY, 32);
+		Test.TestEqual(TEXT("One offset per block"), Map.QpOffsets.Num(), 64 * 32);
+		Test.TestTrue(TEXT("Left eye focus on the lens center"), FVector2D::Distance(Map.Focus[0], FVector2D(16.0f, 16.0f)) < 0.01f);
+		Test.TestTrue(TEXT("Right eye focus on the lens center"), FVector2D::Distance(Map.Focus[1], FVector2D(48.0f, 16.0f)) < 0.01f);
+		Test.TestEqual(TEXT("Inner offset in the middle of the left eye"), Map.GetQpOffset(15, 15), Settings.InnerQpOffset);
+		Test.TestEqual(TEXT("Inner offset in the middle of the right eye"), Map.GetQpOffset(48, 16), Settings.InnerQpOffset);
+		Test.TestEqual(TEXT("Outer offset in the top left corner"), Map.GetQpOffset(0, 0), Settings.OuterQpOffset);
+		Test.TestEqual(TEXT("Outer offset in the bottom right corner"), Map.GetQpOffset(63, 31), Settings.OuterQpOffset);
+		int32 Asymmetric = 0;
+		for (int32 Y = 0; Y < Map.BlocksY; Y++)
+		{
+			for (int32 X = 0; X < 32; X++)
+			{
+				Asymmetric += Map.GetQpOffset(X, Y) == Map.GetQpOffset(31 - X, Y) && Map.GetQpOffset(X, Y) == Map.GetQpOffset(X, 31 - Y)
+					&& Map.GetQpOffset(X, Y) == Map.GetQpOffset(X + 32, Y) ? 0 : 1;
+			}
+		}
+		Test.TestEqual(TEXT("Blocks that break the symmetry of the lens center map"), Asymmetric, 0);
+		const TArray<int8> LensCenter = Map.QpOffsets;
+		const float LensCenterAverage = Map.AverageQpOffset;
+		Test.TestTrue(TEXT("Lens center average between no offset and the outer one"), LensCenterAverage > 0.0f && LensCenterAverage < Settings.OuterQpOffset);
+
+		// A frame of the left eye alone is the left half of the map of both.
+		FPICOXRDPQualityMapBuilder LeftBuilder;
+		LeftBuilder.SetSettings(Settings);
+		FPICOXRDPQualityMapInput LeftInput = Input;
+		LeftInput.FrameSize = FIntPoint(512, 512);
+		LeftInput.EyeCount = 1;
+		Test.TestTrue(TEXT("Build the left eye map"), LeftBuilder.Build(LeftInput));
+		const FPICOXRDPQualityMap& LeftMap = LeftBuilder.GetMap();
+		Test.TestEqual(TEXT("Left eye blocks across"), LeftMap.BlocksX, 32);
+		Test.TestEqual(TEXT("Left eye blocks down"), LeftMap.BlocksY, 32);
+		int32 LeftMismatches = 0;
+		for (int32 Y = 0; Y < LeftMap.BlocksY && LeftMap.BlocksX == 32; Y++)
+		{
+			for (int32 X = 0; X < LeftMap.BlocksX; X++)
+			{
+				LeftMismatches += LeftMap.GetQpOffset(X, Y) == Map.GetQpOffset(X, Y) ? 0 : 1;
+			}
+		}
+		Test.TestEqual(TEXT("Left eye blocks that differ from the left half of both"), LeftMismatches, 0);
+		Test.TestEqual(TEXT("Left eye average"), LeftMap.AverageQpOffset, LensCenterAverage, 0.0f);
+		const FPICOXRDPPeripheryLayout LeftLayout = LeftBuilder.GetPeripheryLayout(0.5f);
+		Test.TestTrue(TEXT("Left eye focus region inside the frame"), LeftLayout.FocusMax[0].X <= 512);
+		Test.TestTrue(TEXT("A single eye repeats its focus region"), LeftLayout.FocusMin[1] == LeftLayout.FocusMin[0] && LeftLayout.FocusMax[1] == LeftLayout.FocusMax[0]);
+
+		// Looking straight ahead is the lens center map, and so is a gaze that is not tracked.
+		FPICOXRDPQualityMapBuilder GazeBuilder;
+		Settings.Focus = EPICOXRDPQualityFocus::Gaze;
+		GazeBuilder.SetSettings(Settings);
+		Input.bGazeValid = true;
+		Input.Gaze[0] = Input.Gaze[1] = GazeAt(0.0f, 0.0f);
+		Test.TestTrue(TEXT("Build the straight ahead map"), GazeBuilder.Build(Input));
+		Test.TestTrue(TEXT("Looking straight ahead is the lens center map"), SameOffsets(GazeBuilder.GetMap(), LensCenter));
+
+		// 20 degrees to the right the focus sits where the tangent of 20 degrees falls between the FOV's.
+		Input.Gaze[0] = Input.Gaze[1] = GazeAt(20.0f, 0.0f);
+		Test.TestTrue(TEXT("Build the map 20 degrees to the right"), GazeBuilder.Build(Input));
+		const FPICOXRDPQualityMap& GazeMap = GazeBuilder.GetMap();
+		const float TanLeft = FMath::Tan(Input.Fov[0].Left);
+		const float ExpectedU = (FMath::Tan(FMath::DegreesToRadians(20.0f)) - TanLeft) / (FMath::Tan(Input.Fov[0].Right) - TanLeft);
+		Test.TestEqual(TEXT("Left eye focus across"), GazeMap.Focus[0].X, ExpectedU * 32.0f, 0.01f);
+		Test.TestEqual(TEXT("Left eye focus down"), GazeMap.Focus[0].Y, 16.0f, 0.01f);
+		Test.TestEqual(TEXT("Right eye focus across"), GazeMap.Focus[1].X, 32.0f + ExpectedU * 32.0f, 0.01f);
+		const int32 FocusX = FMath::FloorToInt(GazeMap.Focus[0].X);
+		Test.TestEqual(TEXT("Inner offset at the focus"), GazeMap.GetQpOffset(FocusX, 16), Settings.InnerQpOffset);
+		Test.TestTrue(TEXT("Coarser opposite the focus"), GazeMap.GetQpOffset(31 - FocusX, 16) > Settings.InnerQpOffset);
+		Test.TestTrue(TEXT("Finer towards the gaze than the lens center map"), GazeMap.GetQpOffset(31, 16) < LensCenter[16 * 64 + 31]);
+		Test.TestTrue(TEXT("Coarser away from the gaze than the lens center map"), GazeMap.GetQpOffset(8, 16) > LensCenter[16 * 64 + 8]);
+
+		// A fraction of a degree does not move the focus by half a block, a few degrees do, into the same array.
+		const int8* Offsets = GazeMap.QpOffsets.GetData();
+		const uint64 Builds = GazeBuilder.GetBuilds();
+		Input.Gaze[0] = Input.Gaze[1] = GazeAt(20.2f, 0.1f);
+		Test.TestFalse(TEXT("A fraction of a degree does not build again"), GazeBuilder.Build(Input));
+		Test.TestEqual(TEXT("Builds after a fraction of a degree"), GazeBuilder.GetBuilds(), Builds);
+		Input.Gaze[0] = Input.Gaze[1] = GazeAt(5.0f, -10.0f);
+		Test.TestTrue(TEXT("A few degrees build again"), GazeBuilder.Build(Input));
+		Test.TestEqual(TEXT("Builds after a few degrees"), GazeBuilder.GetBuilds(), Builds + 1);
+		Test.TestTrue(TEXT("A new build reuses the offsets array"), GazeMap.QpOffsets.GetData() == Offsets);
+		Test.TestTrue(TEXT("Looking down moves the focus down"), GazeMap.Focus[0].Y > 16.5f);
+
+		Input.bGazeValid = false;
+		Test.TestTrue(TEXT("Build without a tracked gaze"), GazeBuilder.Build(Input));
+		Test.TestTrue(TEXT("A gaze that is not tracked is the lens center map"), SameOffsets(GazeMap, LensCenter));
+
+		// The focus region of each eye stays inside it, block aligned, around the focus.
+		const FPICOXRDPPeripheryLayout Layout = Builder.GetPeripheryLayout(0.5f);
+		Test.TestEqual(TEXT("Periphery scale"), Layout.PeripheryScale, 0.5f, 0.0f);
+		for (int32 Eye = 0; Eye < 2; Eye++)
+		{
+			const FIntPoint Focus(FMath::RoundToInt(Map.Focus[Eye].X * 16.0f), FMath::RoundToInt(Map.Focus[Eye].Y * 16.0f));
+			Test.TestTrue(TEXT("Focus region inside its eye"), Layout.FocusMin[Eye].X >= Eye * 512 && Layout.FocusMax[Eye].X <= (Eye + 1) * 512);
+			Test.TestTrue(TEXT("Focus region block aligned"), Layout.FocusMin[Eye].X % 16 == 0 && Layout.FocusMax[Eye].Y % 16 == 0);
+			Test.TestTrue(TEXT("Focus region around the focus"), Layout.FocusMin[Eye].X < Focus.X && Focus.X < Layout.FocusMax[Eye].X
+				&& Layout.FocusMin[Eye].Y < Focus.Y && Focus.Y < Layout.FocusMax[Eye].Y);
+			Test.TestTrue(TEXT("Focus region leaves a periphery"), Layout.FocusMin[Eye].X > Eye * 512 || Layout.FocusMax[Eye].X < (Eye + 1) * 512);
+		}
+
+		// Foveation levels coarsen the periphery level by level, and a uniform map leaves every block alone.
+		const EPICOXRFoveationLevel Levels[4] = { EPICOXRFoveationLevel::Low, EPICOXRFoveationLevel::Medium, EPICOXRFoveationLevel::High, EPICOXRFoveationLevel::TopHigh };
+		float PreviousAverage = 0.0f;
+		for (int32 Level = 0; Level < 4; Level++)
+		{
+			FPICOXRDPQualityMapBuilder LevelBuilder;
+			LevelBuilder.SetSettings(FPICOXRDPQualityMapSettings::ForFoveation(Levels[Level]));
+			LevelBuilder.Build(Input);
+			const float Average = LevelBuilder.GetMap().AverageQpOffset;
+			Test.TestTrue(TEXT("Each foveation level is coarser than the one below"), Level == 0 || Average > PreviousAverage);
+			PreviousAverage = Average;
+		}
+
+		Settings.Focus = EPICOXRDPQualityFocus::Uniform;
+		Builder.SetSettings(Settings);
+		Test.TestTrue(TEXT("Build the uniform map"), Builder.Build(Input));
+		Test.TestEqual(TEXT("A uniform map leaves every block alone"), Map.AverageQpOffset, 0.0f, 0.0f);
+		Test.TestTrue(TEXT("A uniform map is standard quality"), Map.GetEncodeQuality() == EPICOXRDPEncodeQuality::Standard);
+	}
+
+	/** The driver hands maps to an encoder that takes them, and moves any other one to the closest preset on its next restart. */
+	static void TestDriver(FAutomationTestBase& Test)
+	{
+		FPICOXRDPQualityMapInput Input;
+		Input.FrameSize = FIntPoint(1024, 512);
+		FPICOXRDPQualityMapBuilder Builder;
+		Builder.SetSettings(FPICOXRDPQualityMapSettings::ForFoveation(EPICOXRFoveationLevel::TopHigh));
+		Builder.Build(Input);
+		Test.TestTrue(TEXT("The top foveation level is the performance preset"), Builder.GetMap().GetEncodeQuality() == EPICOXRDPEncodeQuality::Performance);
+
+		double Time = 0.0;
+		FPICOXRDPEncoderSettings Settings;
+		Settings.Config.Bitrate = 20000000;
+
+		TSharedRef<FFakeEncoder, ESPMode::ThreadSafe> Fake = MakeShared<FFakeEncoder, ESPMode::ThreadSafe>();
+		FPICOXRDPEncoderDriver Driver(Fake, [&Time]() { return Time; });
+		Test.TestTrue(TEXT("Startup"), Driver.Startup(Settings, false));
+		Driver.SetQualityMap(Builder.GetMap());
+		Test.TestTrue(TEXT("A map the encoder does not take sets the target preset"), Driver.GetStats().TargetQuality == EPICOXRDPEncodeQuality::Performance);
+		Test.TestTrue(TEXT("The preset waits for a restart"), Driver.GetStats().Quality == EPICOXRDPEncodeQuality::Standard);
+		Test.TestTrue(TEXT("Submit within the reconfigure interval"), Driver.SubmitFrame(0, 0));
+		Test.TestTrue(TEXT("No restart within the reconfigure interval"), Driver.GetStats().Restarts == 0);
+		Driver.Shutdown();
+
+		Fake->Configs.Reset();
+		Test.TestTrue(TEXT("Startup again"), Driver.Startup(Settings, false));
+		Driver.SetQualityMap(Builder.GetMap());
+		Time += Settings.ReconfigureInterval;
+		Test.TestTrue(TEXT("Submit after the reconfigure interval"), Driver.SubmitFrame(0, 1));
+		FPICOXRDPEncoderStats Stats = Driver.GetStats();
+		Test.TestTrue(TEXT("The encoder restarts for the preset"), Stats.Restarts == 1);
+		Test.TestTrue(TEXT("The encoder runs at the preset"), Stats.Quality == EPICOXRDPEncodeQuality::Performance);
+		Test.TestEqual(TEXT("No map given to an encoder that does not take them"), Stats.QualityMaps, (uint64)0);
+		Test.TestEqual(TEXT("Encoder configs"), Fake->Configs.Num(), 2);
+		Test.TestTrue(TEXT("The restart config has the preset"), Fake->Configs.Last().Quality == EPICOXRDPEncodeQuality::Performance);
+		Test.TestEqual(TEXT("The restart config keeps the bitrate"), Fake->Configs.Last().Bitrate, Settings.Config.Bitrate);
+		Driver.Shutdown();
+
+		Fake->bTakesMaps = true;
+		Fake->Configs.Reset();
+		Test.TestTrue(TEXT("Startup with an encoder that takes maps"), Driver.Startup(Settings, false));
+		Driver.SetQualityMap(Builder.GetMap());
+		Time += Settings.ReconfigureInterval;
+		Test.TestTrue(TEXT("Submit with a map"), Driver.SubmitFrame(0, 2));
+		Stats = Driver.GetStats();
+		Test.TestTrue(TEXT("No restart for an encoder that takes maps"), Stats.Restarts == 0);
+		Test.TestEqual(TEXT("Maps given to the driver"), Stats.QualityMaps, (uint64)1);
+		Test.TestTrue(TEXT("No preset for an encoder that takes maps"), Stats.TargetQuality == EPICOXRDPEncodeQuality::Standard);
+		Test.TestEqual(TEXT("Maps the encoder took"), Fake->Maps, 1);
+		Driver.Shutdown();
+	}
+}
+
+/** Builds direct preview quality maps at fixed gazes and checks the encoder driver applies them. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPQualityMapTest, "PICOXR.DP.QualityMap", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPQualityMapTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPQualityMapTests::TestMaps(*this);
+	PICOXRDPQualityMapTests::TestDriver(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,252 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPTextureRing.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPTextureRingTests
+{
+	/** Provider that hands out fake handles, plays the streamer's side of the slots and flags misuse. */
+	class FFakeProvider : public IPICOXRDPSharedTextureProvider
+	{
+	public:
+		enum class EOwner : uint8
+		{
+			None,
+			Renderer,
+			Streamer,
+		};
+
+		struct FFakeSlot
+		{
+			bool bCreated = false;
+			FIntPoint EyeSize = FIntPoint::ZeroValue;
+			EOwner Owner = EOwner::None;
+			// The streamer is reading the slot, the renderer only gets it by waiting.
+			bool bStreamerReading = false;
+		};
+
+		TArray<FFakeSlot> Fakes;
+		int32 Creates = 0;
+		int32 Destroys = 0;
+		int32 Misuses = 0;
+		int32 FailCreateAt = INDEX_NONE;
+		// Waits that the streamer finishes within.
+		bool bStreamerFinishesInTime = false;
+		bool bSynchronized = true;
+
+		virtual bool CreateSlot(int32 Slot, FIntPoint EyeSize) override
+		{
+			if (Slot == FailCreateAt)
+			{
+				return false;
+			}
+			if (Fakes.Num() <= Slot)
+			{
+				Fakes.SetNum(Slot + 1);
+			}
+			Misuses += Fakes[Slot].bCreated ? 1 : 0;
+			Fakes[Slot] = FFakeSlot();
+			Fakes[Slot].bCreated = true;
+			Fakes[Slot].EyeSize = EyeSize;
+			Creates++;
+			return true;
+		}
+
+		virtual void DestroySlot(int32 Slot) override
+		{
+			Misuses += Fakes.IsValidIndex(Slot) && Fakes[Slot].bCreated && Fakes[Slot].Owner != EOwner::Renderer ? 0 : 1;
+			if (Fakes.IsValidIndex(Slot))
+			{
+				Fakes[Slot].bCreated = false;
+			}
+			Destroys++;
+		}
+
+		virtual bool AcquireSlot(int32 Slot, uint32 TimeoutMs) override
+		{
+			FFakeSlot& Fake = Fakes[Slot];
+			Misuses += Fake.bCreated && Fake.Owner != EOwner::Renderer ? 0 : 1;
+			if (Fake.bStreamerReading)
+			{
+				if (TimeoutMs == 0 || !bStreamerFinishesInTime)
+				{
+					return false;
+				}
+				Fake.bStreamerReading = false;
+			}
+			Fake.Owner = EOwner::Renderer;
+			return true;
+		}
+
+		virtual void ReleaseSlot(int32 Slot, bool bToStreamer) override
+		{
+			FFakeSlot& Fake = Fakes[Slot];
+			Misuses += Fake.Owner == EOwner::Renderer ? 0 : 1;
+			Fake.Owner = bToStreamer ? EOwner::Streamer : EOwner::None;
+		}
+
+		virtual bool IsSynchronized() const override { return bSynchronized; }
+
+		virtual uint64 GetSharedHandle(int32 Slot, int32 Eye) const override
+		{
+			return Fakes[Slot].bCreated ? 0x100 + Slot * 2 + Eye : 0;
+		}
+
+		virtual FRHITexture2D* GetTexture(int32 Slot, int32 Eye) const override { return nullptr; }
+	};
+
+	/** Writes one frame, numbered by the frames written before it. @return the slot written, INDEX_NONE if the frame was dropped. */
+	static int32 WriteFrame(FPICOXRDPTextureRing& Ring)
+	{
+		const int32 Slot = Ring.BeginWrite();
+		if (Slot != INDEX_NONE)
+		{
+			Ring.EndWrite(Slot, Ring.GetStats().Frames + 1);
+		}
+		return Slot;
+	}
+
+	/** The frame Present submits is the one published last, and none of the slots a reset dropped, even if still queued. */
+	static void TestPublishedFrame(FAutomationTestBase& Test)
+	{
+		TSharedRef<FFakeProvider> Provider = MakeShared<FFakeProvider>();
+		FPICOXRDPTextureRingSettings Settings;
+		Settings.AcquireTimeoutMs = 0;
+		FPICOXRDPTextureRing Ring(Provider, Settings);
+		FPICOXRDPPublishedFrame Published;
+		Test.TestEqual(TEXT("No frame published at first"), Published.Get().Slot, INDEX_NONE);
+
+		Ring.Configure(Settings, FIntPoint(64, 64));
+		Test.TestEqual(TEXT("No latest frame before one is written"), Ring.GetLatestFrame().Slot, INDEX_NONE);
+		WriteFrame(Ring);
+		const int32 Slot = WriteFrame(Ring);
+		Published.Publish(Ring.GetLatestFrame());
+		const FPICOXRDPTextureRingFrame Latest = Published.Get();
+		Test.TestEqual(TEXT("Slot of the frame published"), Latest.Slot, Slot);
+		Test.TestTrue(TEXT("Frame published"), Latest.Frame == 2);
+		Test.TestTrue(TEXT("Eye handles of the frame published"), Latest.EyeHandles[0] == 0x100 + Slot * 2 && Latest.EyeHandles[1] == 0x101 + Slot * 2);
+
+		// A frame queued before the ring dropped its slots runs after the withdrawal.
+		WriteFrame(Ring);
+		const FPICOXRDPTextureRingFrame Queued = Ring.GetLatestFrame();
+		Ring.Reset();
+		Published.Withdraw(Ring.GetGeneration());
+		Test.TestEqual(TEXT("No frame once the slots are dropped"), Published.Get().Slot, INDEX_NONE);
+		Published.Publish(Queued);
+		Test.TestEqual(TEXT("A frame of dropped slots is not published"), Published.Get().Slot, INDEX_NONE);
+
+		Ring.Configure(Settings, FIntPoint(128, 128));
+		Test.TestEqual(TEXT("A frame of the new slots is written"), WriteFrame(Ring), 0);
+		Published.Publish(Ring.GetLatestFrame());
+		Test.TestEqual(TEXT("A frame of the new slots is published"), Published.Get().Slot, 0);
+	}
+}
+
+/** Checks the slot ownership of the direct preview texture ring with a fake shared texture provider. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPTextureRingTest, "PICOXR.DP.TextureRing", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPTextureRingTest::RunTest(const FString& Parameters)
+{
+	using namespace PICOXRDPTextureRingTests;
+	TSharedRef<FFakeProvider> Provider = MakeShared<FFakeProvider>();
+	FPICOXRDPTextureRingSettings Settings;
+	Settings.Depth = 3;
+	Settings.AcquireTimeoutMs = 0;
+	{
+		FPICOXRDPTextureRing Ring(Provider, Settings);
+
+		TestEqual(TEXT("No slot to write before the ring is configured"), Ring.BeginWrite(), INDEX_NONE);
+		TestEqual(TEXT("No latest slot before the ring is configured"), Ring.GetLatestSlot(), INDEX_NONE);
+		TestTrue(TEXT("Configure creates the slots"), Ring.Configure(Settings, FIntPoint(960, 1920)));
+		TestEqual(TEXT("Slots created"), Provider->Creates, 3);
+		TestEqual(TEXT("Ring depth"), Ring.GetDepth(), 3);
+		TestEqual(TEXT("Slot eye size"), Provider->Fakes[2].EyeSize, FIntPoint(960, 1920));
+		TestTrue(TEXT("Shared handle of slot 1, right eye"), Ring.GetSharedHandle(1, 1) == 0x103);
+
+		TestTrue(TEXT("Configure with the same size and depth"), Ring.Configure(Settings, FIntPoint(960, 1920)));
+		TestEqual(TEXT("The same size and depth keep the slots"), Provider->Creates, 3);
+
+		TestEqual(TEXT("First frame goes to slot 0"), WriteFrame(Ring), 0);
+		TestEqual(TEXT("Second frame goes to slot 1"), WriteFrame(Ring), 1);
+		TestEqual(TEXT("Third frame goes to slot 2"), WriteFrame(Ring), 2);
+		TestEqual(TEXT("Fourth frame goes round to slot 0"), WriteFrame(Ring), 0);
+		TestEqual(TEXT("The last slot written is the latest"), Ring.GetLatestSlot(), 0);
+		TestTrue(TEXT("An older written slot stays submitted"), Ring.GetSlotState(1) == EPICOXRDPTextureSlotState::Submitted);
+		TestTrue(TEXT("Frame number of slot 0"), Ring.GetSlotFrame(0) == 4);
+		TestTrue(TEXT("Frame number of slot 1"), Ring.GetSlotFrame(1) == 2);
+
+		Provider->Fakes[1].bStreamerReading = true;
+		TestEqual(TEXT("A slot the streamer reads is passed over"), WriteFrame(Ring), 2);
+		TestEqual(TEXT("The ring goes on round past the read slot"), WriteFrame(Ring), 0);
+		TestTrue(TEXT("Passing over a read slot does not wait"), Ring.GetStats().AcquireWaits == 0);
+
+		const int32 Writing = Ring.BeginWrite();
+		TestEqual(TEXT("Slot being written"), Writing, 2);
+		TestFalse(TEXT("A slot being written is not resized"), Ring.Configure(Settings, FIntPoint(1024, 1024)));
+		TestEqual(TEXT("Eye size kept while a slot is written"), Ring.GetEyeSize(), FIntPoint(960, 1920));
+		Provider->Fakes[0].bStreamerReading = true;
+		TestEqual(TEXT("A slot being written is not handed out again"), Ring.BeginWrite(), INDEX_NONE);
+		TestTrue(TEXT("The frame with no slot is dropped"), Ring.GetStats().DroppedFrames == 1);
+
+		TestTrue(TEXT("Cancel the slot being written"), Ring.CancelWrite(Writing));
+		TestFalse(TEXT("A cancelled slot cannot be cancelled again"), Ring.CancelWrite(Writing));
+		TestFalse(TEXT("A cancelled slot cannot be ended"), Ring.EndWrite(Writing));
+		TestTrue(TEXT("Cancelling gives the slot back as it was"), Ring.GetSlotState(Writing) == EPICOXRDPTextureSlotState::Submitted);
+		TestEqual(TEXT("Cancelling does not move the latest slot"), Ring.GetLatestSlot(), 0);
+
+		Provider->Fakes[2].bStreamerReading = true;
+		TestEqual(TEXT("No slot when the streamer holds them all"), WriteFrame(Ring), INDEX_NONE);
+		TestTrue(TEXT("The frame is dropped without waiting"), Ring.GetStats().DroppedFrames == 2);
+		Settings.AcquireTimeoutMs = 5;
+		TestTrue(TEXT("Configure a timeout"), Ring.Configure(Settings, FIntPoint(960, 1920)));
+		TestEqual(TEXT("A new timeout keeps the slots"), Provider->Creates, 3);
+		TestEqual(TEXT("No slot when the streamer does not finish in time"), WriteFrame(Ring), INDEX_NONE);
+		TestTrue(TEXT("The frame waited for the oldest slot and was dropped"), Ring.GetStats().DroppedFrames == 3 && Ring.GetStats().AcquireWaits == 1);
+		Provider->bSynchronized = false;
+		TestEqual(TEXT("No slot without word from the streamer"), WriteFrame(Ring), INDEX_NONE);
+		TestTrue(TEXT("Nothing to wait for without word from the streamer"), Ring.GetStats().AcquireWaits == 1);
+		TestFalse(TEXT("The ring follows the provider's synchronization"), Ring.IsSynchronized());
+		Provider->bSynchronized = true;
+		Provider->bStreamerFinishesInTime = true;
+		TestEqual(TEXT("The oldest slot is written once the streamer finishes"), WriteFrame(Ring), 1);
+		TestTrue(TEXT("The frame waited for the streamer"), Ring.GetStats().AcquireWaits == 2);
+		TestFalse(TEXT("The streamer finished reading the slot"), Provider->Fakes[1].bStreamerReading);
+		Provider->Fakes[0].bStreamerReading = false;
+		Provider->Fakes[2].bStreamerReading = false;
+
+		TestTrue(TEXT("Configure a new eye size"), Ring.Configure(Settings, FIntPoint(1024, 1024)));
+		TestEqual(TEXT("A new eye size destroys every slot"), Provider->Destroys, 3);
+		TestEqual(TEXT("A new eye size creates every slot again"), Provider->Creates, 6);
+		TestEqual(TEXT("A new eye size forgets the latest slot"), Ring.GetLatestSlot(), INDEX_NONE);
+		TestTrue(TEXT("Recreations counted"), Ring.GetStats().Recreations == 1);
+		TestEqual(TEXT("Writing starts again at slot 0"), WriteFrame(Ring), 0);
+
+		Settings.Depth = 1;
+		TestTrue(TEXT("Configure a single slot"), Ring.Configure(Settings, FIntPoint(1024, 1024)));
+		TestEqual(TEXT("Single slot depth"), Ring.GetDepth(), 1);
+		TestEqual(TEXT("A single slot is written"), WriteFrame(Ring), 0);
+		TestEqual(TEXT("A single slot is written again"), WriteFrame(Ring), 0);
+
+		Settings.Depth = 4;
+		Provider->FailCreateAt = 2;
+		TestFalse(TEXT("Configure fails when a slot cannot be created"), Ring.Configure(Settings, FIntPoint(1024, 1024)));
+		TestEqual(TEXT("A failed creation leaves no slot behind"), Ring.GetDepth(), 0);
+		TestTrue(TEXT("Creation failures counted"), Ring.GetStats().CreateFailures == 1);
+		TestEqual(TEXT("Nothing to write after a failed creation"), Ring.BeginWrite(), INDEX_NONE);
+		Provider->FailCreateAt = INDEX_NONE;
+		const int32 CreatesBefore = Provider->Creates;
+		TestFalse(TEXT("A failed provider is not tried again"), Ring.Configure(Settings, FIntPoint(1024, 1024)));
+		TestEqual(TEXT("No slot created for a failed provider"), Provider->Creates, CreatesBefore);
+		Ring.SetProvider(Provider);
+		TestTrue(TEXT("Configure with the provider set again"), Ring.Configure(Settings, FIntPoint(1024, 1024)));
+		TestEqual(TEXT("Depth with the provider set again"), Ring.GetDepth(), 4);
+		TestEqual(TEXT("Slot written with the provider set again"), Ring.BeginWrite(), 0);
+	}
+	TestEqual(TEXT("The ring destroys every slot it created, including the one left being written"), Provider->Destroys, Provider->Creates);
+	TestEqual(TEXT("Slot misuses"), Provider->Misuses, 0);
+
+	TestPublishedFrame(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,229 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPTunnel.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPTunnelTests
+{
+	// RTP header, and the header of its extension in front of the extension data, as the sender writes them.
+	const uint32 RtpHeaderSize = 12;
+	const uint32 RtpExtensionHeaderSize = 4;
+
+	/** Tunnel that keeps a copy of every packet sent, to be fed to a reassembler in any order. */
+	class FLoopbackTunnel : public IPICOXRDPTunnel
+	{
+	public:
+		struct FPacket
+		{
+			TArray<uint8> Payload;
+			TArray<uint8> Extension;
+			const uint8* SentPayload = nullptr;
+		};
+
+		TArray<FPacket> Packets;
+		bool bFail = false;
+
+		virtual bool Startup(const FPICOXRDPTunnelConfig& Config) override { return true; }
+		virtual void Shutdown() override {}
+		virtual bool Send(const FPICOXRDPTunnelPacket& Packet) override
+		{
+			if (bFail)
+			{
+				return false;
+			}
+			FPacket& Copy = Packets.AddDefaulted_GetRef();
+			Copy.Payload.Append(Packet.Payload, Packet.PayloadLength);
+			Copy.Extension.Append(Packet.Extension, Packet.ExtensionLength);
+			Copy.SentPayload = Packet.Payload;
+			return true;
+		}
+
+		void Deliver(FPICOXRDPFrameReassembler& Reassembler, int32 Index, bool bRaw) const
+		{
+			const FPacket& Packet = Packets[Index];
+			Reassembler.AddPacket(Packet.Payload.GetData(), Packet.Payload.Num(), Packet.Extension.GetData(), Packet.Extension.Num(), bRaw);
+		}
+	};
+
+	static TArray<uint8> MakeFrame(uint32 Length, uint8 Seed)
+	{
+		TArray<uint8> Frame;
+		Frame.SetNumUninitialized(Length);
+		for (uint32 Index = 0; Index < Length; Index++)
+		{
+			Frame[Index] = (uint8)(Index * 31 + Seed);
+		}
+		return Frame;
+	}
+
+	static void ExpectFrame(FAutomationTestBase& Test, FPICOXRDPFrameReassembler& Reassembler, const TArray<uint8>& Expected, uint32 FrameNumber)
+	{
+		FPICOXRDPFrameReassembler::FFrame Frame;
+		if (Test.TestTrue(TEXT("A frame is reassembled"), Reassembler.PopFrame(Frame)))
+		{
+			Test.TestTrue(TEXT("Reassembled frame number"), Frame.Header.FrameNumber == FrameNumber);
+			Test.TestTrue(TEXT("Reassembled frame bytes"), Frame.Data == Expected);
+		}
+	}
+
+	static void TestFragmentation(FAutomationTestBase& Test, bool bRaw)
+	{
+		double Time = 1.0;
+		TSharedRef<FLoopbackTunnel, ESPMode::ThreadSafe> Loopback = MakeShared<FLoopbackTunnel, ESPMode::ThreadSafe>();
+		FPICOXRDPTunnelSender Sender(Loopback, [&Time]() { return Time; });
+		FPICOXRDPTunnelSenderSettings Settings;
+		Settings.Config.Type = bRaw ? EPICOXRDPTunnelType::Raw : EPICOXRDPTunnelType::RtpH264;
+		Settings.Config.Mtu = 1200;
+		Settings.PoolSize = 12;
+		Test.TestTrue(TEXT("Startup"), Sender.Startup(Settings));
+
+		// 10000 bytes cut into full fragments and a short last one, each carrying its place in the frame.
+		const uint32 FragmentSize = Sender.GetFragmentPayloadSize();
+		Test.TestTrue(TEXT("Fragment payload size"), FragmentSize == (bRaw ? 1160u : 1144u));
+		const TArray<uint8> Frame = MakeFrame(10000, 7);
+		const uint32 Count = (10000 + FragmentSize - 1) / FragmentSize;
+		int32 Released = 0;
+		Test.TestTrue(TEXT("Queue the frame"), Sender.QueueFrame(Frame.GetData(), Frame.Num(), 100, 0.5, true, [&Released]() { Released++; }));
+		Test.TestEqual(TEXT("Fragments queued"), Sender.GetNumQueued(), (int32)Count);
+		Test.TestEqual(TEXT("The frame is held while queued"), Released, 0);
+		Test.TestEqual(TEXT("Fragments sent"), Sender.Pump(), (int32)Count);
+		Test.TestEqual(TEXT("The frame is released once sent"), Released, 1);
+		Test.TestEqual(TEXT("Fragments left queued"), Sender.GetNumQueued(), 0);
+		Test.TestEqual(TEXT("Packets sent through the tunnel"), Loopback->Packets.Num(), (int32)Count);
+
+		int32 BadHeaders = 0;
+		int32 BadPayloads = 0;
+		int32 OverMtu = 0;
+		int32 Copied = 0;
+		for (uint32 Index = 0; Index < Count && Index < (uint32)Loopback->Packets.Num(); Index++)
+		{
+			const FLoopbackTunnel::FPacket& Packet = Loopback->Packets[Index];
+			FPICOXRDPFragmentHeader Header;
+			const bool bRead = bRaw ? Header.Read(Packet.Payload.GetData(), Packet.Payload.Num()) : Header.Read(Packet.Extension.GetData(), Packet.Extension.Num());
+			BadHeaders += bRead && Header.FrameNumber == 100 && Header.FragmentIndex == Index && Header.FragmentCount == Count
+				&& Header.Sequence == Index && Header.Offset == Index * FragmentSize && Header.FrameLength == 10000
+				&& Header.CaptureTimeUs == 500000 && Header.SendTimeUs == 1000000 && (Header.Flags & FPICOXRDPFragmentHeader::KeyFrame) ? 0 : 1;
+			const uint32 PayloadLength = Packet.Payload.Num() - (bRaw ? FPICOXRDPFragmentHeader::Size : 0);
+			BadPayloads += PayloadLength == (Index + 1 < Count ? FragmentSize : 10000 - Index * FragmentSize) ? 0 : 1;
+			OverMtu += PayloadLength + (bRaw ? FPICOXRDPFragmentHeader::Size : RtpHeaderSize + RtpExtensionHeaderSize + Packet.Extension.Num()) <= Settings.Config.Mtu ? 0 : 1;
+			Copied += bRaw || Packet.SentPayload == Frame.GetData() + Index * FragmentSize ? 0 : 1;
+		}
+		Test.TestEqual(TEXT("Fragments with a wrong header"), BadHeaders, 0);
+		Test.TestEqual(TEXT("Fragments with a wrong payload length"), BadPayloads, 0);
+		Test.TestEqual(TEXT("Packets over the MTU"), OverMtu, 0);
+		Test.TestEqual(TEXT("RTP fragments not sent straight from the frame"), Copied, 0);
+		Test.TestEqual(TEXT("Bytes copied"), Sender.GetStats().BytesCopied, (uint64)(bRaw ? 10000 : 0));
+
+		// In order, in reverse, and with a duplicate in between, the frame comes back as it was.
+		FPICOXRDPFrameReassembler InOrder;
+		for (int32 Index = 0; Index < Loopback->Packets.Num(); Index++)
+		{
+			Loopback->Deliver(InOrder, Index, bRaw);
+		}
+		ExpectFrame(Test, InOrder, Frame, 100);
+		FPICOXRDPFrameReassembler Reversed;
+		for (int32 Index = Loopback->Packets.Num() - 1; Index >= 0; Index--)
+		{
+			Loopback->Deliver(Reversed, Index, bRaw);
+			Loopback->Deliver(Reversed, Index, bRaw);
+		}
+		ExpectFrame(Test, Reversed, Frame, 100);
+		Test.TestEqual(TEXT("Duplicates counted"), Reversed.GetDuplicates(), (uint64)Count);
+		Test.TestEqual(TEXT("No incomplete frame from duplicates"), Reversed.GetIncompleteFrames(), (uint64)0);
+
+		// A frame missing a fragment is given up once the next one completes, its late fragment is not taken.
+		const TArray<uint8> Next = MakeFrame(3000, 9);
+		Loopback->Packets.Reset();
+		Test.TestTrue(TEXT("Queue the frame that loses a fragment"), Sender.QueueFrame(Frame.GetData(), Frame.Num(), 101, 0.6, false));
+		Test.TestTrue(TEXT("Queue the frame after it"), Sender.QueueFrame(Next.GetData(), Next.Num(), 102, 0.7, false));
+		Sender.Pump();
+		FPICOXRDPFrameReassembler Lossy;
+		for (int32 Index = 0; Index < Loopback->Packets.Num(); Index++)
+		{
+			if (Index != 3)
+			{
+				Loopback->Deliver(Lossy, Index, bRaw);
+			}
+		}
+		ExpectFrame(Test, Lossy, Next, 102);
+		FPICOXRDPFrameReassembler::FFrame Leftover;
+		Test.TestFalse(TEXT("The frame missing a fragment is given up"), Lossy.PopFrame(Leftover));
+		Loopback->Deliver(Lossy, 3, bRaw);
+		Test.TestEqual(TEXT("Incomplete frames"), Lossy.GetIncompleteFrames(), (uint64)1);
+		Test.TestEqual(TEXT("A late fragment counts as a duplicate"), Lossy.GetDuplicates(), (uint64)1);
+
+		// A frame that does not fit in the pool is dropped whole and released at once.
+		const TArray<uint8> Large = MakeFrame(FragmentSize * 13, 3);
+		Released = 0;
+		Test.TestFalse(TEXT("A frame larger than the pool is not queued"), Sender.QueueFrame(Large.GetData(), Large.Num(), 103, 0.8, false, [&Released]() { Released++; }));
+		Test.TestEqual(TEXT("A dropped frame is released at once"), Released, 1);
+		Test.TestEqual(TEXT("Nothing of a dropped frame is queued"), Sender.GetNumQueued(), 0);
+		Test.TestEqual(TEXT("Dropped frames"), Sender.GetStats().DroppedFrames, (uint64)1);
+
+		// An empty frame still makes one fragment.
+		FPICOXRDPFrameReassembler Empty;
+		Loopback->Packets.Reset();
+		Test.TestTrue(TEXT("Queue an empty frame"), Sender.QueueFrame(nullptr, 0, 104, 0.9, false));
+		Test.TestEqual(TEXT("An empty frame makes one fragment"), Sender.Pump(), 1);
+		Loopback->Deliver(Empty, 0, bRaw);
+		ExpectFrame(Test, Empty, TArray<uint8>(), 104);
+	}
+
+	static void TestPacing(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		TSharedRef<FLoopbackTunnel, ESPMode::ThreadSafe> Loopback = MakeShared<FLoopbackTunnel, ESPMode::ThreadSafe>();
+		FPICOXRDPTunnelSender Sender(Loopback, [&Time]() { return Time; });
+		FPICOXRDPTunnelSenderSettings Settings;
+		Settings.Config.Mtu = 1200;
+		Settings.PoolSize = 64;
+		// One full packet per millisecond, two back to back.
+		Settings.PacingRate = 1200000.0;
+		Settings.BurstBytes = 2400;
+		Test.TestTrue(TEXT("Startup"), Sender.Startup(Settings));
+
+		const uint32 FragmentSize = Sender.GetFragmentPayloadSize();
+		const TArray<uint8> Frame = MakeFrame(FragmentSize * 10, 1);
+		Test.TestTrue(TEXT("Queue a frame of ten fragments"), Sender.QueueFrame(Frame.GetData(), Frame.Num(), 1, 0.0, true));
+		Test.TestEqual(TEXT("The burst goes out at once"), Sender.Pump(), 2);
+		Test.TestEqual(TEXT("Delay until the next packet"), Sender.GetPacingDelay(), 0.001, 1e-9);
+		Time += 0.0005;
+		Test.TestEqual(TEXT("Nothing sent before the next packet is due"), Sender.Pump(), 0);
+		Time += 0.0005;
+		Test.TestEqual(TEXT("One packet a millisecond later"), Sender.Pump(), 1);
+		Time += 0.004;
+		Test.TestEqual(TEXT("No more than the burst after an idle period"), Sender.Pump(), 2);
+
+		// The send queue reports the age of its oldest packet, the encoder driver reads it as congestion.
+		FPICOXRDPTunnelSendStats SendStats = Sender.TakeSendStats();
+		Test.TestTrue(TEXT("Packets sent"), SendStats.PacketsSent == 5);
+		Test.TestEqual(TEXT("Bytes sent"), SendStats.BytesSent, (uint64)6000);
+		Test.TestEqual(TEXT("Queue delay"), SendStats.QueueDelaySeconds, 0.005, 1e-9);
+
+		// Sends that fail count as drops.
+		Loopback->bFail = true;
+		Time += 0.002;
+		Test.TestEqual(TEXT("Failed sends are not counted as sent"), Sender.Pump(), 0);
+		SendStats = Sender.TakeSendStats();
+		Test.TestTrue(TEXT("No packet sent while the tunnel fails"), SendStats.PacketsSent == 0);
+		Test.TestTrue(TEXT("Failed sends count as drops"), SendStats.PacketsDropped == 2);
+		Loopback->bFail = false;
+		Time += 1.0;
+		Test.TestEqual(TEXT("The burst goes out after a long idle period"), Sender.Pump(), 2);
+		Test.TestEqual(TEXT("Packets left queued"), Sender.GetNumQueued(), 1);
+		Test.TestEqual(TEXT("Peak queued packets"), Sender.GetStats().PeakQueuedPackets, 10);
+	}
+}
+
+/** Fragments, paces and reassembles frames through a loopback fake tunnel. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPTunnelSenderTest, "PICOXR.DP.TunnelSender", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPTunnelSenderTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPTunnelTests::TestFragmentation(*this, false);
+	PICOXRDPTunnelTests::TestFragmentation(*this, true);
+	PICOXRDPTunnelTests::TestPacing(*this);
+	return true;
+}
+#endif
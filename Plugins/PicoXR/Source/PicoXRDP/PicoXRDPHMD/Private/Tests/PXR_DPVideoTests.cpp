@@ -0,0 +1,223 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_DPVideo.h"
+#include "PXR_HMDFunctionLibrary.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRDPVideoTests
+{
+	/** Encoder whose every frame is its tag repeated Size times, out as soon as it is in. */
+	class FFakeEncoder : public IPICOXRDPEncoder
+	{
+	public:
+		int32 Size = 3000;
+		int32 Startups = 0;
+		FIntPoint LastSize = FIntPoint::ZeroValue;
+		EPICOXRDPEncodeQuality LastQuality = EPICOXRDPEncodeQuality::Standard;
+		TArray<uint64> Pending;
+		TArray<bool> KeyFrames;
+
+		virtual bool Startup(const FPICOXRDPEncoderConfig& Config) override
+		{
+			Startups++;
+			LastSize = FIntPoint(Config.Width, Config.Height);
+			LastQuality = Config.Quality;
+			return true;
+		}
+
+		virtual void Shutdown() override { Pending.Reset(); }
+
+		virtual bool Submit(uint64 Texture, uint64 Tag, bool bKeyFrame) override
+		{
+			Pending.Add(Tag);
+			KeyFrames.Add(bKeyFrame);
+			return true;
+		}
+
+		virtual bool Acquire(std::vector<uint8>& OutData, uint64& OutTag) override
+		{
+			if (Pending.Num() == 0)
+			{
+				return false;
+			}
+			OutTag = Pending[0];
+			Pending.RemoveAt(0);
+			OutData.assign(Size, (uint8)OutTag);
+			return true;
+		}
+
+		virtual void Flush() override {}
+	};
+
+	/** Tunnel handing every packet to the remote's reassembler. */
+	class FLoopbackTunnel : public IPICOXRDPTunnel
+	{
+	public:
+		FPICOXRDPFrameReassembler Remote;
+		int32 Startups = 0;
+
+		virtual bool Startup(const FPICOXRDPTunnelConfig& Config) override
+		{
+			Startups++;
+			return true;
+		}
+
+		virtual void Shutdown() override {}
+
+		virtual bool Send(const FPICOXRDPTunnelPacket& Packet) override
+		{
+			return Remote.AddPacket(Packet.Payload, Packet.PayloadLength, Packet.Extension, Packet.ExtensionLength, false);
+		}
+	};
+
+	static void TestStream(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		TSharedRef<FFakeEncoder, ESPMode::ThreadSafe> Encoder = MakeShared<FFakeEncoder, ESPMode::ThreadSafe>();
+		TSharedRef<FLoopbackTunnel, ESPMode::ThreadSafe> Tunnel = MakeShared<FLoopbackTunnel, ESPMode::ThreadSafe>();
+		FPICOXRDPVideoStreamer Streamer(Encoder, Tunnel, [&Time]() { return Time; });
+
+		// Nothing starts before the first frame, which starts the encoder at its size.
+		FPICOXRDPVideoSettings Settings;
+		Settings.Encoder.Config.Bitrate = 20000000;
+		Settings.Encoder.Config.Fps = 72;
+		Streamer.Startup(Settings, false);
+		Test.TestFalse(TEXT("Nothing to send before the first frame"), Streamer.SendOnce());
+		Test.TestEqual(TEXT("The encoder waits for the first frame"), Encoder->Startups, 0);
+		Test.TestEqual(TEXT("The tunnel waits for the first frame"), Tunnel->Startups, 0);
+
+		// Every frame reaches the remote whole and in order, and its buffer goes back to the driver.
+		const FIntPoint EyeSize(1024, 1024);
+		int32 BadFrames = 0;
+		for (uint64 Frame = 1; Frame <= 6; Frame++)
+		{
+			Time += 1.0 / 72.0;
+			Test.TestTrue(TEXT("Submit a frame"), Streamer.SubmitFrame(0x1000, EyeSize, Frame));
+			Test.TestTrue(TEXT("Send the frame"), Streamer.SendOnce());
+			FPICOXRDPFrameReassembler::FFrame Received;
+			BadFrames += Tunnel->Remote.PopFrame(Received) && Received.Header.FrameNumber == (uint32)Frame
+				&& Received.Data.Num() == Encoder->Size && Received.Data[0] == (uint8)Frame ? 0 : 1;
+		}
+		Test.TestEqual(TEXT("Frames that did not reach the remote whole and in order"), BadFrames, 0);
+		Test.TestEqual(TEXT("The encoder starts once"), Encoder->Startups, 1);
+		Test.TestEqual(TEXT("The encoder starts at the frame size"), Encoder->LastSize, EyeSize);
+		Test.TestEqual(TEXT("The tunnel starts once"), Tunnel->Startups, 1);
+
+		// Another size starts both again.
+		Test.TestTrue(TEXT("Submit a frame of another size"), Streamer.SubmitFrame(0x1000, FIntPoint(512, 512), 7));
+		Test.TestEqual(TEXT("Another size starts the encoder again"), Encoder->Startups, 2);
+		Test.TestEqual(TEXT("The encoder starts again at the new size"), Encoder->LastSize, FIntPoint(512, 512));
+		Test.TestEqual(TEXT("Another size starts the tunnel again"), Tunnel->Startups, 2);
+
+		// A size the encoder cannot take drops the frame, and is not tried again with every frame.
+		Test.TestFalse(TEXT("A size the encoder cannot take drops the frame"), Streamer.SubmitFrame(0x1000, FIntPoint(0, 0), 8));
+		Test.TestFalse(TEXT("The next frame at that size is dropped too"), Streamer.SubmitFrame(0x1000, FIntPoint(0, 0), 9));
+		Test.TestEqual(TEXT("Dropped frames"), Streamer.GetStats().DroppedFrames, (uint64)2);
+		Test.TestEqual(TEXT("A size the encoder cannot take is not tried again"), Encoder->Startups, 2);
+
+		Streamer.Shutdown();
+	}
+
+	static void TestFeedback(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		TSharedRef<FFakeEncoder, ESPMode::ThreadSafe> Encoder = MakeShared<FFakeEncoder, ESPMode::ThreadSafe>();
+		TSharedRef<FLoopbackTunnel, ESPMode::ThreadSafe> Tunnel = MakeShared<FLoopbackTunnel, ESPMode::ThreadSafe>();
+		FPICOXRDPVideoStreamer Streamer(Encoder, Tunnel, [&Time]() { return Time; });
+
+		// A pool of four slots holds the three fragments of one frame, not those of two.
+		FPICOXRDPVideoSettings Settings;
+		Settings.Encoder.Config.Bitrate = 20000000;
+		Settings.Encoder.Config.Fps = 72;
+		Settings.Tunnel.PoolSize = 4;
+		Settings.ReportInterval = 0.1;
+		Streamer.Startup(Settings, false);
+
+		const FIntPoint EyeSize(1024, 1024);
+		Streamer.SubmitFrame(0x1000, EyeSize, 1);
+		Streamer.SubmitFrame(0x1000, EyeSize, 2);
+		Streamer.SendOnce();
+		FPICOXRDPVideoStats Stats = Streamer.GetStats();
+		Test.TestEqual(TEXT("Frames sent"), Stats.Sender.Frames, (uint64)1);
+		Test.TestEqual(TEXT("Frames the sender dropped"), Stats.Sender.DroppedFrames, (uint64)1);
+		Test.TestEqual(TEXT("Pool slots"), Stats.PoolSlots, 4);
+		Test.TestEqual(TEXT("Pool slots in use at the peak"), Stats.PoolPeakInUse, 3);
+		Test.TestEqual(TEXT("Pool slots free once sent"), Stats.PoolFree, 4);
+
+		// The frame after the dropped one is a key frame, the second one of the stream.
+		Time += 0.05;
+		Streamer.SubmitFrame(0x1000, EyeSize, 3);
+		if (Test.TestEqual(TEXT("Frames submitted to the encoder"), Encoder->KeyFrames.Num(), 3))
+		{
+			Test.TestTrue(TEXT("The first frame is a key frame"), Encoder->KeyFrames[0]);
+			Test.TestFalse(TEXT("The dropped frame is not a key frame"), Encoder->KeyFrames[1]);
+			Test.TestTrue(TEXT("The frame after the dropped one is a key frame"), Encoder->KeyFrames[2]);
+		}
+		Streamer.SendOnce();
+
+		// The drops reach the encoder with the next report and lower its bitrate.
+		Test.TestEqual(TEXT("The bitrate waits for the next report"), Streamer.GetStats().Encoder.TargetBitrate, 20000000);
+		Time += 0.1;
+		Streamer.SendOnce();
+		Test.TestTrue(TEXT("The report of the drops lowers the bitrate"), Streamer.GetStats().Encoder.TargetBitrate < 20000000);
+
+		Streamer.Shutdown();
+	}
+
+	/** The fake encoder takes no map, it starts at the preset of the map and stays there. */
+	static void TestQualityMap(FAutomationTestBase& Test)
+	{
+		double Time = 0.0;
+		TSharedRef<FFakeEncoder, ESPMode::ThreadSafe> Encoder = MakeShared<FFakeEncoder, ESPMode::ThreadSafe>();
+		TSharedRef<FLoopbackTunnel, ESPMode::ThreadSafe> Tunnel = MakeShared<FLoopbackTunnel, ESPMode::ThreadSafe>();
+		FPICOXRDPVideoStreamer Streamer(Encoder, Tunnel, [&Time]() { return Time; });
+
+		FPICOXRDPVideoSettings Settings;
+		Settings.Encoder.Config.Bitrate = 20000000;
+		Settings.Encoder.Config.Fps = 72;
+		Settings.bQualityMap = true;
+		Settings.QualityMap = FPICOXRDPQualityMapSettings::ForFoveation(EPICOXRFoveationLevel::TopHigh);
+		// No send statistics, which would restart the encoder at another bitrate.
+		Settings.ReportInterval = 100.0;
+		Streamer.Startup(Settings, false);
+
+		for (uint64 Frame = 1; Frame <= 4; Frame++)
+		{
+			Time += 1.0;
+			Test.TestTrue(TEXT("Submit a frame with a quality map"), Streamer.SubmitFrame(0x1000, FIntPoint(1024, 1024), Frame));
+			Streamer.SendOnce();
+		}
+		FPICOXRDPVideoStats Stats = Streamer.GetStats();
+		Test.TestEqual(TEXT("The encoder starts once"), Encoder->Startups, 1);
+		Test.TestTrue(TEXT("The encoder starts at the preset of the map"), Encoder->LastQuality == EPICOXRDPEncodeQuality::Performance);
+		Test.TestTrue(TEXT("No restart for the map"), Stats.Encoder.Restarts == 0);
+		Test.TestTrue(TEXT("The encoder runs at the preset of the map"), Stats.Encoder.Quality == EPICOXRDPEncodeQuality::Performance);
+		Test.TestTrue(TEXT("The target is the preset of the map"), Stats.Encoder.TargetQuality == EPICOXRDPEncodeQuality::Performance);
+
+		// Another size starts at the preset of its own map.
+		Test.TestTrue(TEXT("Submit a frame of another size"), Streamer.SubmitFrame(0x1000, FIntPoint(512, 512), 5));
+		Test.TestEqual(TEXT("Another size starts the encoder again"), Encoder->Startups, 2);
+		Test.TestTrue(TEXT("Another size starts at the preset of its map"), Encoder->LastQuality == EPICOXRDPEncodeQuality::Performance);
+
+		// Without a map the quality is the one set.
+		Settings.bQualityMap = false;
+		Streamer.Startup(Settings, false);
+		Test.TestTrue(TEXT("Submit a frame without a quality map"), Streamer.SubmitFrame(0x1000, FIntPoint(1024, 1024), 6));
+		Test.TestTrue(TEXT("Without a map the quality is the one set"), Encoder->LastQuality == EPICOXRDPEncodeQuality::Standard);
+
+		Streamer.Shutdown();
+	}
+}
+
+/** Checks the direct preview video streamer against a fake encoder and a loopback tunnel, across a change of the frame size, frames the sender drops and a quality map. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRDPVideoStreamerTest, "PICOXR.DP.VideoStreamer", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRDPVideoStreamerTest::RunTest(const FString& Parameters)
+{
+	PICOXRDPVideoTests::TestStream(*this);
+	PICOXRDPVideoTests::TestFeedback(*this);
+	PICOXRDPVideoTests::TestQualityMap(*this);
+	return true;
+}
+#endif
@@ -2,39 +2,73 @@
 
 #pragma once
 #include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
 #if PLATFORM_WINDOWS
 #include "D3D11RHIPrivate.h"
 #include "streamer_api.h"
 #include "iinterface.h"
 #include "connector/terminal_interface.h"
 #endif
+#include "PXR_DPAccessories.h"
+#include "PXR_DPConnection.h"
+#include "PXR_DPLayerCompositor.h"
+#include "PXR_DPPoseTimeline.h"
+#include "PXR_DPTerminal.h"
+#include "PXR_DPTextureRing.h"
 
 using namespace pxr::connector;
 using namespace pxr;
 
+class FPICOXRDPAudioStreamer;
+class FPICOXRDPVideoStreamer;
+struct FPICOXRDPVideoStats;
+
+//Horizontal and vertical FOV in degrees the eyes are rendered at, the same for both
+static constexpr float DirectPreviewFov = 101.f;
+
 class PICOXRDPHMD_API DP :public TSharedFromThis<DP,ESPMode::ThreadSafe>
 {
 public:
 	DP();
 	~DP();
-	//Connect runtime, 1 time in construction
+	//Starts the connection to the runtime in construction, it reconnects by itself from then on.
+	//@return whether the runtime could be linked to right away
 	bool ConnectServer();
 	//Disconnect the runtime, 1 time in the destructor
 	void DisConnectServer();
-	//Register Demo, 1 time during construction
-	void RegisterDemo();
 	//Get ID, refresh every time in Beginplay of HMD
 	void GetRemoteID();
+	//Heartbeats and reconnects the runtime as it is due, every game frame
+	void Tick();
+	FPICOXRDPConnection& GetConnection() { return Connection; }
+	//Submits the frame the render thread published last, from Present on the RHI thread. It does not read the texture ring
 	void SendMessage();
 	uint32 GetHandle(ID3D11Texture2D& D3D11Texture2D);
-	void CreateSharedTexture2D();
-	bool CreateRHITexture(ID3D11Texture2D* OpenedSharedResource, EPixelFormat Format, FTexture2DRHIRef& OutTexture);
+	//Takes a slot of the shared texture ring for the eye copies of this frame, sized to the eyes of the stereo render target.
+	//INDEX_NONE skips the copies, the streamer keeps the last frame
+	int32 BeginEyeTextures_RenderThread(FIntPoint RenderTargetSize);
+	//Texture of Eye, 0 for left and 1 for right, in Slot
+	FRHITexture2D* GetEyeTexture(int32 Slot, int32 Eye) const { return TextureRing.GetTexture(Slot, Eye); }
+	//Hands Slot to the streamer once the copies are recorded, and publishes it to SendMessage once they ran. With vr.PICODPVideoPort the left eye
+	//is encoded and sent to the headset by DP as well, and with vr.PICODPAudioPort the audio is stamped with the frame
+	void EndEyeTextures_RenderThread(FRHICommandListImmediate& RHICmdList, int32 Slot);
+	//Composites the stereo layers over the eye textures of Slot before it is handed over, or forwards them to the runtime with
+	//vr.PICODPForwardLayers. The eye size of View is that of the slot
+	void CompositeLayers_RenderThread(IPICOXRDPLayerRenderer& Renderer, int32 Slot, const FPICOXRDPLayerView& View, const TArray<FPICOXRDPLayerInput>& Layers);
+	const FPICOXRDPLayerCompositorStats& GetLayerCompositorStats_RenderThread() const { return LayerCompositor.GetStats(); }
+	const FPICOXRDPTextureRingStats& GetTextureRingStats_RenderThread() const { return TextureRing.GetStats(); }
+	//Whether the streamer hands the slots back through the keyed mutex, the waits of the stats are 0 otherwise
+	bool IsTextureRingSynchronized_RenderThread() const { return TextureRing.IsSynchronized(); }
 	void GetPositionAndRotation(FVector &OutPostion,FQuat &OutQuat);
 	void GetControllerPositionAndRotation(int hand,float WorldScale, FVector& OutPostion, FRotator& OutQuat);
 	bool GetControllerConnectstatus(int hand);
 	
 	uint16 GetControllerButtonStatus(int hand);
 	void GetControllerAxisValue(int hand,float &JoyStickX,float& JoyStickY,float &TriggerValue,float &GripValue);
+	//Accessory queries made by the getters above, which share one terminal round trip per frame
+	FPICOXRDPAccessoryStats GetAccessoryStats() const { return Accessories.GetStats(); }
+	//Encoder, sender and packet pool of the eye sent with vr.PICODPVideoPort. @return false while nothing is sent
+	bool GetVideoStats(FPICOXRDPVideoStats& OutStats) const;
 	
 
 	pxr::connector::TerminalInterface* terminal_ = nullptr;
@@ -42,17 +76,42 @@ public:
 	uint32 local_runtime_id_;
 	uint32 remote_hmd_id_;
 
-	TRefCountPtr<ID3D11Texture2D> LeftDstTexture;
-	TRefCountPtr<ID3D11Texture2D> RightDstTexture;
-	FTexture2DRHIRef LeftTempTexture=NULL;
-	FTexture2DRHIRef RightTempTexture = NULL;
-	void* LeftDstTextureHandle = nullptr;
-	void* RightDstTextureHandle = nullptr;
 	bool bQueryIDFinished = false;
-	bool bDstTextureOK = false;
 
 private:
-	uint32 count = 0;
+	//Frame the getters read the accessories as of, the render thread keeps a snapshot of its own for late update
+	uint64 GetAccessoryFrame() const;
+	//Attaches the terminal of a new connection, and detaches it before the link closes
+	void OnConnectionStateChanged(EPICOXRDPConnectionState OldState, EPICOXRDPConnectionState NewState);
+	TSharedPtr<IPICOXRDPTerminal, ESPMode::ThreadSafe> GetTerminal() const;
+	//Starts encoding for the headset of a new connection, if vr.PICODPVideoPort says where to
+	void StartVideoStreamer();
+	TSharedPtr<FPICOXRDPVideoStreamer, ESPMode::ThreadSafe> GetVideoStreamer() const;
+	//Starts capturing the audio for the headset of a new connection, if vr.PICODPAudioPort says where to send it
+	void StartAudioStreamer();
+	TSharedPtr<FPICOXRDPAudioStreamer, ESPMode::ThreadSafe> GetAudioStreamer() const;
+
+	FPICOXRDPConnection Connection;
+	//Bumped by every connection, the render thread creates the shared textures again when it changes
+	FThreadSafeCounter ConnectionEpoch;
+	int32 RenderConnectionEpoch = 0;
+	mutable FCriticalSection TerminalLock;
+	FPICOXRDPAccessorySnapshot Accessories;
+	//Frame path of the terminal while connected, read through GetTerminal as the game and the render thread share it
+	TSharedPtr<IPICOXRDPTerminal, ESPMode::ThreadSafe> Terminal;
+	//Encoder and tunnel of the eye textures while connected, read through GetVideoStreamer by the render thread, which submits to it on the RHI thread
+	TSharedPtr<FPICOXRDPVideoStreamer, ESPMode::ThreadSafe> VideoStreamer;
+	//Audio capture and tunnel while connected, the render thread tells it the frames it sends
+	TSharedPtr<FPICOXRDPAudioStreamer, ESPMode::ThreadSafe> AudioStreamer;
+	FPICOXRDPTextureRing TextureRing;
+	bool bTextureRingKeyedMutex = false;
+	//Frame of the ring SendMessage submits, published on the RHI thread behind the copies of each frame
+	TSharedRef<FPICOXRDPPublishedFrame, ESPMode::ThreadSafe> PublishedFrame = MakeShared<FPICOXRDPPublishedFrame, ESPMode::ThreadSafe>();
+	//Generation of the ring PublishedFrame was last withdrawn at, render thread only
+	uint32 PublishedGeneration = 0;
+	FPICOXRDPLayerCompositor LayerCompositor;
+	//Poses the frames were rendered at, SendMessage submits each frame with its own
+	FPICOXRDPPoseTimeline PoseTimeline;
 
 
 };
@@ -0,0 +1,81 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#if PLATFORM_WINDOWS
+#include "connector/terminal_interface.h"
+#endif
+
+/** Thread reading the accessories. Each keeps a snapshot of its own, as the render thread reads a newer pose for late update. */
+enum class EPICOXRDPAccessoryReader : uint8
+{
+	Game,
+	Render,
+	Count,
+};
+
+struct FPICOXRDPAccessoryStats
+{
+	// Snapshots taken, one per frame of each reader.
+	uint64 Frames = 0;
+	// Round trips to the terminal, and those that did not return an accessory.
+	uint64 Queries = 0;
+	uint64 FailedQueries = 0;
+	// HMD and controller reads served from the snapshots.
+	uint64 Reads = 0;
+	// Reads of the last full frame of a reader, and the most of any frame.
+	uint32 LastFrameReads = 0;
+	uint32 PeakFrameReads = 0;
+
+	double GetQueriesPerFrame() const { return Frames > 0 ? Queries / (double)Frames : 0.0; }
+	double GetReadsPerFrame() const { return Frames > 0 ? Reads / (double)Frames : 0.0; }
+};
+
+/**
+ * HMD and controller accessories of the remote headset, fetched in one QueryRemoteTerminalAccessory per frame of each reader.
+ * The first read of a frame queries the terminal, every other read of that frame, or of an earlier one, is served from the
+ * reader's copy. A failed query reads as inactive accessories until the reader's next frame.
+ * The query is made outside the lock, a reader waiting on the terminal does not hold up the other.
+ * Thread safe, a reader is one thread at a time.
+ */
+class PICOXRDPHMD_API FPICOXRDPAccessorySnapshot
+{
+public:
+	/**
+	 * Terminal to query and the id of the headset on it, nullptr to stop querying. Drops the snapshots, and what a query
+	 * in flight returns. The terminal has to stay open until the readers are past any query they started on it.
+	 */
+	void SetTerminal(pxr::connector::TerminalInterface* InTerminal, uint32 InTerminalId);
+
+	/** HMD accessory as of Frame of Reader, a frame counter that does not go backwards. */
+	void GetHmd(EPICOXRDPAccessoryReader Reader, uint64 Frame, pxr::connector::HmdAccessory& OutHmd);
+
+	/** Controller accessory of Hand, 0 for left and 1 for right, as of Frame of Reader. */
+	void GetController(EPICOXRDPAccessoryReader Reader, uint64 Frame, int32 Hand, pxr::connector::ControllerAccessory& OutController);
+
+	FPICOXRDPAccessoryStats GetStats() const;
+
+	/** The render thread's reader on the rendering thread, the game thread's anywhere else. */
+	static EPICOXRDPAccessoryReader GetCurrentReader();
+
+private:
+	struct FReaderSnapshot
+	{
+		pxr::connector::TerminalAccessory Accessory;
+		uint64 Frame = 0;
+		bool bHasSnapshot = false;
+		uint32 FrameReads = 0;
+	};
+
+	/** Queries the terminal if Frame is past the snapshot of Reader. Lock must not be held. */
+	void Refresh(EPICOXRDPAccessoryReader Reader, uint64 Frame);
+
+	mutable FCriticalSection Lock;
+	pxr::connector::TerminalInterface* Terminal = nullptr;
+	uint32 TerminalId = 0;
+	// Bumped by SetTerminal, a query that started on another terminal is dropped.
+	uint32 TerminalRevision = 0;
+	FReaderSnapshot Snapshots[(int32)EPICOXRDPAccessoryReader::Count];
+	FPICOXRDPAccessoryStats Stats;
+};
@@ -0,0 +1,195 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/Runnable.h"
+#include "Templates/Atomic.h"
+#if PLATFORM_WINDOWS
+#include "connector/terminal_interface.h"
+#endif
+
+class FRunnableThread;
+class FEvent;
+
+enum class EPICOXRDPConnectionState : uint8
+{
+	// Not started, or stopped.
+	Disconnected,
+	// Opening the link to the runtime.
+	Connecting,
+	// Linked, until the runtime and the headset are known.
+	Registering,
+	Connected,
+	// The link dropped or could not be opened, waiting to try again.
+	Backoff,
+};
+
+PICOXRDPHMD_API const TCHAR* LexToString(EPICOXRDPConnectionState State);
+
+/**
+ * The link to the runtime a connection drives. The default one opens the streamer's terminal, a fake can stand in for it
+ * to drop the link at will. Its calls may block, the connection makes them on a thread of its own, one at a time.
+ */
+class IPICOXRDPConnectionLink
+{
+public:
+	virtual ~IPICOXRDPConnectionLink() {}
+
+	/** Opens the link and says hello to the runtime. @return false if it could not. */
+	virtual bool Open() = 0;
+
+	/**
+	 * Ids of the runtime and of the headset, asking for them is the heartbeat.
+	 * @return false if the runtime did not answer. OutHmdId is 0 while no headset is known.
+	 */
+	virtual bool QueryIds(uint32& OutRuntimeId, uint32& OutHmdId) = 0;
+
+	/** IPv4 address of headset HmdId, for the streams sent to it. @return false if it is not known. */
+	virtual bool QueryHmdAddress(uint32 HmdId, uint8 OutIp[4]) { return false; }
+
+	/** Closes the link, it can be opened again. */
+	virtual void Close() = 0;
+
+#if PLATFORM_WINDOWS
+	/** The streamer's terminal while the link is open, nullptr for a fake. */
+	virtual pxr::connector::TerminalInterface* GetTerminal() const { return nullptr; }
+#endif
+
+	static TSharedRef<IPICOXRDPConnectionLink, ESPMode::ThreadSafe> CreateDefault();
+};
+
+struct FPICOXRDPConnectionSettings
+{
+	// Seconds between heartbeats, and the heartbeats missed in a row that drop the link.
+	double HeartbeatInterval = 0.5;
+	int32 MaxMissedHeartbeats = 3;
+	// Seconds before the first retry, doubled by every retry that fails up to MaxBackoff.
+	double InitialBackoff = 0.5;
+	double MaxBackoff = 8.0;
+};
+
+struct FPICOXRDPConnectionStats
+{
+	uint32 Connects = 0;
+	// Links that dropped after being opened, and attempts to open one that failed.
+	uint32 Drops = 0;
+	uint32 FailedAttempts = 0;
+	uint32 Heartbeats = 0;
+	uint32 MissedHeartbeats = 0;
+};
+
+/** Old and new state. Listeners leaving Connected detach from the terminal, the link closes after they return. */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FPICOXRDPConnectionStateChanged, EPICOXRDPConnectionState, EPICOXRDPConnectionState);
+
+/**
+ * Connection of DirectPreview to the runtime, kept up for as long as it is started.
+ * An open link is checked by a heartbeat, which queries the ids of the runtime and the headset: the headset coming back
+ * as another terminal registers again over the same link. A link that misses heartbeats is closed and opened again
+ * after a backoff that doubles with every failed attempt, so a restarted streamer or headset is picked up without
+ * restarting the session.
+ * The link is opened, queried and closed on a thread of its own, Tick picks up what it did and changes the state, so
+ * the listeners are called on the game thread. Game thread only.
+ */
+class PICOXRDPHMD_API FPICOXRDPConnection : public FRunnable
+{
+public:
+	/** nullptr uses the default link. Clock returns seconds, FPlatformTime::Seconds if unset. */
+	explicit FPICOXRDPConnection(TSharedPtr<IPICOXRDPConnectionLink, ESPMode::ThreadSafe> InLink = nullptr, TFunction<double()> InClock = nullptr);
+	virtual ~FPICOXRDPConnection();
+
+	void SetSettings(const FPICOXRDPConnectionSettings& InSettings);
+
+	/**
+	 * Starts connecting, the next Tick makes the first attempt. Without bThreaded the link is called from Tick, which
+	 * then goes as far as the link lets it.
+	 */
+	void Startup(bool bThreaded = true);
+
+	/** Closes the link and stops reconnecting. Waits for the call the link is in, if any. */
+	void Shutdown();
+
+	/** Takes what the link did, and opens, registers, heartbeats or retries, as the state is due. */
+	void Tick();
+
+	EPICOXRDPConnectionState GetState() const { return State; }
+	bool IsConnected() const { return State == EPICOXRDPConnectionState::Connected; }
+
+	/** Ids of the runtime and the headset while connected. */
+	uint32 GetRuntimeId() const { return RuntimeId; }
+	uint32 GetHmdId() const { return HmdId; }
+	/** Address of the headset while connected. @return false if the link did not tell it. */
+	bool GetHmdAddress(uint8 OutIp[4]) const;
+
+	/** Attempts failed since the link was last connected, and the seconds waited before the next one. */
+	int32 GetAttempt() const { return Attempt; }
+	double GetBackoff() const { return Backoff; }
+
+	IPICOXRDPConnectionLink& GetLink() const { return *Link; }
+	const FPICOXRDPConnectionStats& GetStats() const { return Stats; }
+	FPICOXRDPConnectionStateChanged& OnStateChanged() { return StateChanged; }
+
+	// FRunnable, the link thread
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	enum class EJob : uint8
+	{
+		None,
+		Open,
+		QueryIds,
+		Close,
+	};
+
+	/** A call to the link, and what it returned once bDone. */
+	struct FJob
+	{
+		EJob Type = EJob::None;
+		bool bDone = false;
+		bool bResult = false;
+		uint32 RuntimeId = 0;
+		uint32 HmdId = 0;
+		// The headset the ids were queried against, its address is only asked for again when another one answers.
+		uint32 KnownHmdId = 0;
+		bool bHasHmdAddress = false;
+		uint8 HmdAddress[4] = { 0, 0, 0, 0 };
+	};
+
+	double Now() const { return Clock ? Clock() : FPlatformTime::Seconds(); }
+	void SetState(EPICOXRDPConnectionState NewState);
+	/** Closes the link and waits to try again. */
+	void Retry(double Time);
+	/** Hands Type to the link thread, or calls the link right away without one. */
+	void PostJob(EJob Type);
+	static void RunJob(IPICOXRDPConnectionLink& InLink, FJob& InJob);
+	/** Changes the state as the finished job says. @return false while the job is running. */
+	bool CompleteJob(double Time);
+	/** Moves on to the state that is due, and the job it needs, None if there is none. */
+	EJob DueJob(double Time);
+
+	TSharedRef<IPICOXRDPConnectionLink, ESPMode::ThreadSafe> Link;
+	TFunction<double()> Clock;
+	FPICOXRDPConnectionSettings Settings;
+	FPICOXRDPConnectionStateChanged StateChanged;
+
+	EPICOXRDPConnectionState State = EPICOXRDPConnectionState::Disconnected;
+	uint32 RuntimeId = 0;
+	uint32 HmdId = 0;
+	bool bHasHmdAddress = false;
+	uint8 HmdAddress[4] = { 0, 0, 0, 0 };
+	int32 Attempt = 0;
+	double Backoff = 0.0;
+	double RetryTime = 0.0;
+	double NextHeartbeat = 0.0;
+	int32 MissedHeartbeats = 0;
+	// The link is closed by the next job once the listeners have let go of it.
+	bool bCloseDue = false;
+	FPICOXRDPConnectionStats Stats;
+
+	FCriticalSection JobLock;
+	FJob Job;
+	FRunnableThread* Thread = nullptr;
+	FEvent* WorkEvent = nullptr;
+	TAtomic<bool> bStopping;
+};
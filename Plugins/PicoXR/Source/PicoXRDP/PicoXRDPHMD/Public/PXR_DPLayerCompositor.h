@@ -0,0 +1,210 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "PXR_DPTerminal.h"
+
+class FRHITexture2D;
+
+/**
+ * Render targets the layer compositor draws into, RGBA8 and created by size.
+ * The default one creates D3D11 textures, shared ones with a handle the runtime can open. A fake can be set instead.
+ */
+class IPICOXRDPLayerTargetProvider
+{
+public:
+	virtual ~IPICOXRDPLayerTargetProvider() {}
+
+	/** @return false if the target could not be created. */
+	virtual bool CreateTarget(int32 Target, FIntPoint Size, bool bShared) = 0;
+	virtual void DestroyTarget(int32 Target) = 0;
+
+	virtual FRHITexture2D* GetTexture(int32 Target) const = 0;
+	/** Handle of a target created shared, 0 otherwise. */
+	virtual uint64 GetSharedHandle(int32 Target) const = 0;
+
+	static TSharedRef<IPICOXRDPLayerTargetProvider> CreateDefault();
+};
+
+struct FPICOXRDPLayerTargetPoolStats
+{
+	uint32 Creates = 0;
+	uint32 CreateFailures = 0;
+	// Targets handed out again instead of created.
+	uint32 Reuses = 0;
+	uint32 Destroys = 0;
+	int32 InUse = 0;
+	int32 Idle = 0;
+};
+
+/**
+ * Targets kept across frames by size, so layers that come and go or change size do not create a texture each time.
+ * A released target is handed out again for the same size, and destroyed once it stayed idle for long enough.
+ * Render thread only.
+ */
+class PICOXRDPHMD_API FPICOXRDPLayerTargetPool
+{
+public:
+	/** nullptr uses the default provider. */
+	explicit FPICOXRDPLayerTargetPool(TSharedPtr<IPICOXRDPLayerTargetProvider> InProvider = nullptr);
+	~FPICOXRDPLayerTargetPool();
+
+	/** Replaces the provider and drops the targets of the previous one, none may be in use. nullptr restores the default. */
+	void SetProvider(TSharedPtr<IPICOXRDPLayerTargetProvider> InProvider);
+
+	/**
+	 * Takes an idle target of Size, or creates one. A size that failed to be created is not tried again until the
+	 * provider is set. @return the target, INDEX_NONE if it could not be created.
+	 */
+	int32 Acquire(FIntPoint Size, bool bShared);
+	void Release(int32 Target);
+
+	/** Ends a frame, destroying the targets idle for more than IdleFrames. */
+	void EndFrame(uint32 IdleFrames);
+
+	/** Destroys every target, none may be in use. */
+	void Reset();
+
+	FRHITexture2D* GetTexture(int32 Target) const { return Provider->GetTexture(Target); }
+	uint64 GetSharedHandle(int32 Target) const { return Provider->GetSharedHandle(Target); }
+	FIntPoint GetSize(int32 Target) const { return Targets[Target].Size; }
+
+	const FPICOXRDPLayerTargetPoolStats& GetStats() const { return Stats; }
+
+private:
+	struct FTarget
+	{
+		FIntPoint Size = FIntPoint::ZeroValue;
+		bool bShared = false;
+		bool bValid = false;
+		bool bInUse = false;
+		uint32 IdleFrames = 0;
+	};
+
+	void Destroy(int32 Target);
+
+	TSharedRef<IPICOXRDPLayerTargetProvider> Provider;
+	// Destroyed targets leave their index free for the next one created.
+	TArray<FTarget> Targets;
+	FIntPoint FailedSize = FIntPoint::ZeroValue;
+	bool bFailedShared = false;
+	FPICOXRDPLayerTargetPoolStats Stats;
+};
+
+/** A visible stereo layer of the frame, as the compositor sees it. */
+struct FPICOXRDPLayerInput
+{
+	// Placement of the layer. Its handle and bTextureUpdated are filled in by the compositor when it is forwarded.
+	FPICOXRDPOverlayLayer Layer;
+	// Kept alive by the caller until the frame is composited.
+	FRHITexture2D* Texture = nullptr;
+	// Bumped whenever the layer's texture is set or marked for update.
+	uint32 TextureRevision = 0;
+	// The texture changes every frame without being marked, IStereoLayers::LAYER_FLAG_TEX_CONTINUOUS_UPDATE.
+	bool bContinuousUpdate = false;
+};
+
+/** What the eyes look through this frame, for the layers to be placed by. */
+struct FPICOXRDPLayerView
+{
+	FIntPoint EyeSize = FIntPoint::ZeroValue;
+	// Hash of what each space's layers are projected into the eyes with. A layer whose hash did not change looks the same.
+	uint32 SpaceHashes[(int32)EPICOXRDPLayerSpace::Count] = { 0, 0, 0 };
+};
+
+/** Draws for the compositor, the one of the HMD on the RHI, a fake that counts the draws without one. */
+class IPICOXRDPLayerRenderer
+{
+public:
+	virtual ~IPICOXRDPLayerRenderer() {}
+
+	/**
+	 * Draws Input as Eye sees it into Target, which is the eye's size. With bClear the rest of Target is cleared to
+	 * transparent and the layer is written with its alpha, otherwise it is blended over what Target holds.
+	 */
+	virtual void RenderLayer(const FPICOXRDPLayerInput& Input, int32 Eye, FRHITexture2D* Target, bool bClear) = 0;
+
+	/** Blends Source, a layer drawn with bClear, over Target. */
+	virtual void BlendLayer(FRHITexture2D* Source, FRHITexture2D* Target) = 0;
+
+	/** Copies the texture of Input into Target, which is its size. */
+	virtual void CopyLayer(const FPICOXRDPLayerInput& Input, FRHITexture2D* Target) = 0;
+};
+
+struct FPICOXRDPLayerCompositorSettings
+{
+	// Hand layers to the terminal to place on the headset, sharp at its resolution, as long as it takes them.
+	bool bForwardLayers = false;
+	// Frames a pooled target is kept without being used.
+	uint32 IdleFrames = 90;
+};
+
+struct FPICOXRDPLayerCompositorStats
+{
+	uint64 Frames = 0;
+	// Layers drawn for an eye into their cached target, and draws skipped because the layer looked the same.
+	uint64 RenderedLayers = 0;
+	uint64 SkippedLayers = 0;
+	// Opaque layers drawn straight into an eye.
+	uint64 DirectLayers = 0;
+	uint64 Blends = 0;
+	// Forwarded layers, and the texture copies they took.
+	uint64 ForwardedLayers = 0;
+	uint64 ForwardCopies = 0;
+};
+
+/**
+ * Composites the stereo layers into the eye textures of DirectPreview.
+ * Every layer is drawn for each eye into a pooled target of its own, which is only drawn again when the layer changes:
+ * its placement, texture or the projection of its space. Each frame then only blends the targets over the eyes.
+ * Layers without alpha have no coverage to blend by and are drawn straight into the eyes every frame.
+ * With Settings.bForwardLayers a layer's texture is copied into a shared target when it changes and handed to the
+ * terminal instead, until the terminal refuses one. Render thread only.
+ */
+class PICOXRDPHMD_API FPICOXRDPLayerCompositor
+{
+public:
+	explicit FPICOXRDPLayerCompositor(TSharedPtr<IPICOXRDPLayerTargetProvider> InProvider = nullptr);
+
+	void SetProvider(TSharedPtr<IPICOXRDPLayerTargetProvider> InProvider);
+	void SetSettings(const FPICOXRDPLayerCompositorSettings& InSettings);
+
+	/**
+	 * Composites Layers, in any order, over EyeTextures or forwards them to Terminal, which may be null.
+	 * Layers missing from the last frame give their targets back to the pool.
+	 */
+	void Composite(IPICOXRDPLayerRenderer& Renderer, const FPICOXRDPLayerView& View, const TArray<FPICOXRDPLayerInput>& Layers, FRHITexture2D* const EyeTextures[2], IPICOXRDPTerminal* Terminal);
+
+	/** Drops every layer and target, the next frame draws everything again. */
+	void Reset();
+
+	/** Whether the terminal refused a forwarded layer, the layers are composited until Reset. */
+	bool IsForwardingRefused() const { return bForwardRefused; }
+	int32 GetNumLayers() const { return States.Num(); }
+
+	const FPICOXRDPLayerCompositorStats& GetStats() const { return Stats; }
+	const FPICOXRDPLayerTargetPoolStats& GetPoolStats() const { return Pool.GetStats(); }
+
+private:
+	struct FLayerState
+	{
+		FPICOXRDPLayerInput Input;
+		uint32 SpaceHash = 0;
+		// Eye targets of a composited layer, or the shared target of a forwarded one in the first.
+		int32 Targets[2] = { INDEX_NONE, INDEX_NONE };
+		bool bForwarded = false;
+		bool bSeen = false;
+	};
+
+	static bool SamePlacement(const FPICOXRDPOverlayLayer& A, const FPICOXRDPOverlayLayer& B);
+	void ReleaseTargets(FLayerState& State);
+	bool Forward(IPICOXRDPLayerRenderer& Renderer, FLayerState& State, const FPICOXRDPLayerInput& Input, bool bNew, IPICOXRDPTerminal& Terminal);
+	void CompositeLayer(IPICOXRDPLayerRenderer& Renderer, FLayerState& State, const FPICOXRDPLayerInput& Input, bool bChanged, const FPICOXRDPLayerView& View, FRHITexture2D* const EyeTextures[2]);
+
+	FPICOXRDPLayerTargetPool Pool;
+	FPICOXRDPLayerCompositorSettings Settings;
+	TArray<FLayerState> States;
+	FIntPoint EyeSize = FIntPoint::ZeroValue;
+	bool bForwardRefused = false;
+	FPICOXRDPLayerCompositorStats Stats;
+};
@@ -0,0 +1,98 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+struct FPICOXRDPEyeLayer;
+
+/** Headset pose as the remote sampled it, in the terminal's axes. */
+struct FPICOXRDPPoseSample
+{
+	FVector Position = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	// Time and index the remote took the sample at, in ticks of its clock. 0 if the terminal did not say.
+	int64 RemoteTimestamp = 0;
+	uint64 RemoteIndex = 0;
+	// Host time the sample was read at, seconds.
+	double HostTime = 0.0;
+};
+
+struct FPICOXRDPPoseTimelineSettings
+{
+	// Frames whose render pose is kept.
+	int32 HistoryFrames = 64;
+	// Ticks per second of the remote's timestamps.
+	double RemoteTicksPerSecond = 1000000000.0;
+	// Pose samples the clock offset is taken from the least delayed of.
+	int32 OffsetWindow = 256;
+	// Seconds from a frame rendered to the remote showing it, until SetPredictedLatency says otherwise.
+	double PredictedLatency = 0.030;
+};
+
+/**
+ * Poses the frames were rendered at and the clocks to stamp them with, so the remote can reproject each frame by its
+ * true age rather than by when it happened to arrive.
+ * The remote's clock is matched to the host's through the pose samples: each one gives the offset plus the delay it
+ * took to arrive, so the least of them over the window is the offset plus the shortest delay.
+ * Thread safe, the game thread adds render poses, the render thread marks frames rendered and any thread stamps layers.
+ */
+class PICOXRDPHMD_API FPICOXRDPPoseTimeline
+{
+public:
+	/** Clock returns seconds, FPlatformTime::Seconds if unset. */
+	explicit FPICOXRDPPoseTimeline(TFunction<double()> InClock = nullptr);
+
+	/** Applies Settings and drops the history and the clock offset. */
+	void Configure(const FPICOXRDPPoseTimelineSettings& InSettings);
+	void Reset();
+
+	/** Records Pose as the one Frame is rendered at, unless Frame has one already. A Pose without HostTime is stamped with now. */
+	void AddRenderPose(uint64 Frame, const FPICOXRDPPoseSample& Pose);
+
+	/** Frame was rendered now. */
+	void MarkRendered(uint64 Frame);
+
+	/** Pose Frame was rendered at. @return false if it was not recorded or is no longer kept. */
+	bool FindByFrame(uint64 Frame, FPICOXRDPPoseSample& OutPose) const;
+
+	/** Pose at RemoteTimestamp, interpolated between the kept poses around it. @return false outside of them. */
+	bool FindByRemoteTime(int64 RemoteTimestamp, FPICOXRDPPoseSample& OutPose) const;
+
+	bool HasClockOffset() const;
+	int64 HostToRemote(double HostTime) const;
+	double RemoteToHost(int64 RemoteTimestamp) const;
+
+	void SetPredictedLatency(double Seconds);
+
+	/**
+	 * Sets the pose of Layer to Pose and its timestamps for Layer.Frame: when it was rendered, now if it was not marked,
+	 * and when it is predicted to be shown. The remote clock ones stay 0 until the clocks are matched.
+	 */
+	void StampLayer(FPICOXRDPEyeLayer& Layer, const FPICOXRDPPoseSample& Pose) const;
+
+private:
+	struct FEntry
+	{
+		uint64 Frame = 0;
+		bool bValid = false;
+		FPICOXRDPPoseSample Pose;
+		// 0 until the frame is marked rendered.
+		double RenderTime = 0.0;
+	};
+
+	double Now() const { return Clock ? Clock() : FPlatformTime::Seconds(); }
+	FEntry& GetEntry(uint64 Frame) { return Entries[Frame % Entries.Num()]; }
+	const FEntry* FindEntry(uint64 Frame) const;
+
+	TFunction<double()> Clock;
+	FPICOXRDPPoseTimelineSettings Settings;
+
+	mutable FCriticalSection Lock;
+	TArray<FEntry> Entries;
+	// Host time less remote time of the last pose samples, and the least of them.
+	TArray<double> Offsets;
+	int32 NextOffset = 0;
+	double Offset = 0.0;
+	int64 LastRemoteTimestamp = 0;
+};
@@ -0,0 +1,101 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "PXR_DPPoseTimeline.h"
+#if PLATFORM_WINDOWS
+#include "connector/terminal_interface.h"
+#endif
+
+struct FPICOXRDPTextureRingFrame;
+class FPICOXRDPAccessorySnapshot;
+
+/** Eye layer of one frame as DP::SendMessage submits it, the shared eye textures and the pose they were rendered at. */
+struct FPICOXRDPEyeLayer
+{
+	uint64 Frame = 0;
+	FVector Position = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	// Shared handles of the left and the right eye texture.
+	uint64 EyeHandles[2] = { 0, 0 };
+	// The pose sample the frame was rendered at, as the remote stamped it.
+	int64 PoseTimestamp = 0;
+	uint64 PoseIndex = 0;
+	// When the frame was rendered and is predicted to be shown, in host seconds and in ticks of the remote's clock.
+	// The remote ones are 0 until the clocks are matched.
+	double RenderTime = 0.0;
+	double DisplayTime = 0.0;
+	int64 RenderTimestamp = 0;
+	int64 DisplayTimestamp = 0;
+};
+
+/** What a stereo layer is placed relative to, in the order of IStereoLayers::ELayerType. */
+enum class EPICOXRDPLayerSpace : uint8
+{
+	World,
+	Tracker,
+	Face,
+	Count,
+};
+
+enum class EPICOXRDPLayerShape : uint8
+{
+	Quad,
+	Cylinder,
+};
+
+/** Stereo layer the runtime places itself, its texture handed over rather than composited into the eyes. */
+struct FPICOXRDPOverlayLayer
+{
+	uint32 Id = 0;
+	int32 Priority = 0;
+	EPICOXRDPLayerSpace Space = EPICOXRDPLayerSpace::World;
+	EPICOXRDPLayerShape Shape = EPICOXRDPLayerShape::Quad;
+	// Placement in the space, in Unreal units and axes.
+	FVector Position = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector Scale = FVector(1.0f, 1.0f, 1.0f);
+	// Size of a quad, the tex ratio already applied.
+	FVector2D QuadSize = FVector2D(100.0f, 100.0f);
+	float CylinderRadius = 100.0f;
+	float CylinderArc = 100.0f;
+	float CylinderHeight = 50.0f;
+	// Part of the texture shown.
+	FVector2D UVMin = FVector2D(0.0f, 0.0f);
+	FVector2D UVMax = FVector2D(1.0f, 1.0f);
+	bool bNoAlpha = false;
+	// Shared handle of the texture, its size, and whether it changed since it was last submitted.
+	uint64 Handle = 0;
+	FIntPoint TextureSize = FIntPoint::ZeroValue;
+	bool bTextureUpdated = false;
+};
+
+/**
+ * What the frame path of DirectPreview needs of the terminal. The connector one wraps the streamer's TerminalInterface,
+ * a fake can stand in for it so the frame path runs without the runtime.
+ */
+class PICOXRDPHMD_API IPICOXRDPTerminal
+{
+public:
+	virtual ~IPICOXRDPTerminal() {}
+
+	/** Headset pose of the remote as of Frame, in the terminal's axes. @return false if there is none, the pose is the identity then. */
+	virtual bool QueryHmdPose(uint64 Frame, FPICOXRDPPoseSample& OutPose) = 0;
+
+	/** Hands Layer to the runtime. */
+	virtual bool SubmitEyeLayer(const FPICOXRDPEyeLayer& Layer) = 0;
+
+	/** Hands Layer to the runtime to show over the eye layer. @return false if the runtime does not take overlay layers. */
+	virtual bool SubmitOverlayLayer(const FPICOXRDPOverlayLayer& Layer) { return false; }
+
+	/**
+	 * Submits Latest, the frame a texture ring wrote last, with the pose Timeline has it rendered at, the current pose if it has none,
+	 * stamped by Timeline. @return false if Latest holds no frame or the submit failed.
+	 */
+	bool SubmitLatest(const FPICOXRDPTextureRingFrame& Latest, const FPICOXRDPPoseTimeline& Timeline);
+
+#if PLATFORM_WINDOWS
+	/** Submits eye layers to RuntimeId on Terminal, with the poses of Accessories, which have to outlive it. */
+	static TSharedRef<IPICOXRDPTerminal, ESPMode::ThreadSafe> CreateConnector(pxr::connector::TerminalInterface* Terminal, uint32 RuntimeId, FPICOXRDPAccessorySnapshot& Accessories);
+#endif
+};
@@ -0,0 +1,191 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+class FRHITexture2D;
+
+/**
+ * Shared eye textures of the ring, two per slot, as the streamer sees them.
+ * The default one creates D3D11 textures, a fake can be set on the ring instead.
+ */
+class IPICOXRDPSharedTextureProvider
+{
+public:
+	virtual ~IPICOXRDPSharedTextureProvider() {}
+
+	/** Creates both eye textures of Slot at EyeSize. @return false if they could not be created. */
+	virtual bool CreateSlot(int32 Slot, FIntPoint EyeSize) = 0;
+	virtual void DestroySlot(int32 Slot) = 0;
+
+	/**
+	 * Takes Slot for writing, whether it is new or was handed to the streamer before.
+	 * Waits up to TimeoutMs while the streamer still reads it. @return false if it did not get it.
+	 */
+	virtual bool AcquireSlot(int32 Slot, uint32 TimeoutMs) = 0;
+
+	/** Gives up Slot after AcquireSlot, to the streamer if bToStreamer, otherwise back to the state it was taken in. */
+	virtual void ReleaseSlot(int32 Slot, bool bToStreamer) = 0;
+
+	/**
+	 * Whether AcquireSlot learns from the streamer that it is done with a slot. Without it every slot is taken right away,
+	 * and a slot is only kept from the streamer by the depth of the ring.
+	 */
+	virtual bool IsSynchronized() const { return false; }
+
+	/** Shared handle of the texture of Eye, 0 for left and 1 for right, sent to the streamer. */
+	virtual uint64 GetSharedHandle(int32 Slot, int32 Eye) const = 0;
+
+	/** Texture of Eye that the render thread copies into. */
+	virtual FRHITexture2D* GetTexture(int32 Slot, int32 Eye) const = 0;
+
+	/** bKeyedMutex synchronises every slot with the streamer through a DXGI keyed mutex, see PXR_DPTextureRing.cpp. */
+	static TSharedRef<IPICOXRDPSharedTextureProvider> CreateDefault(bool bKeyedMutex);
+};
+
+enum class EPICOXRDPTextureSlotState : uint8
+{
+	// Created and never written.
+	Free,
+	// Taken by the render thread for the frame it copies.
+	Writing,
+	// Written and handed to the streamer, which may still read it.
+	Submitted,
+};
+
+struct FPICOXRDPTextureRingSettings
+{
+	// Slots in the ring. One is the single shared surface the streamer and the renderer take turns on.
+	int32 Depth = 3;
+	// How long a frame waits for the streamer when it holds every slot, before the frame is dropped.
+	// Only a synchronized provider waits.
+	uint32 AcquireTimeoutMs = 2;
+};
+
+struct FPICOXRDPTextureRingStats
+{
+	// Frames written into the ring.
+	uint64 Frames = 0;
+	// Frames that had to wait for the streamer, the time they waited and the longest wait. Always 0 unless synchronized.
+	uint64 AcquireWaits = 0;
+	double AcquireWaitSeconds = 0.0;
+	double PeakAcquireWaitSeconds = 0.0;
+	// Frames not written because the streamer held every slot for the whole timeout.
+	uint64 DroppedFrames = 0;
+	// Times the slots were created again for a new size or depth, and times that failed.
+	uint32 Recreations = 0;
+	uint32 CreateFailures = 0;
+};
+
+/** What the streamer is handed of the slot written last, copied out of the ring for the threads that must not read it. */
+struct FPICOXRDPTextureRingFrame
+{
+	// INDEX_NONE until a frame was written.
+	int32 Slot = INDEX_NONE;
+	uint64 Frame = 0;
+	// Shared handles of the left and the right eye texture.
+	uint64 EyeHandles[2] = { 0, 0 };
+	// Generation of the ring's slots the frame was written into, see FPICOXRDPTextureRing::GetGeneration.
+	uint32 Generation = 0;
+};
+
+/**
+ * Ring of shared eye textures the render thread hands frames to the streamer through.
+ * Each frame takes the oldest slot the streamer is done with, so rendering the next frame does not wait for the streamer
+ * to finish the last one. The slot submitted last is only taken when no other is free. Render thread only.
+ */
+class PICOXRDPHMD_API FPICOXRDPTextureRing
+{
+public:
+	/** nullptr uses the default provider without a keyed mutex. */
+	explicit FPICOXRDPTextureRing(TSharedPtr<IPICOXRDPSharedTextureProvider> InProvider = nullptr, const FPICOXRDPTextureRingSettings& InSettings = FPICOXRDPTextureRingSettings());
+	~FPICOXRDPTextureRing();
+
+	/** Replaces the provider and drops the slots of the previous one. nullptr restores the default. */
+	void SetProvider(TSharedPtr<IPICOXRDPSharedTextureProvider> InProvider);
+
+	/**
+	 * Creates Settings.Depth slots at EyeSize, unless they already are. Slots are created again when either changes.
+	 * A size and depth that failed to be created are not tried again until the provider is set.
+	 * @return false while a slot is being written, or if the slots could not be created.
+	 */
+	bool Configure(const FPICOXRDPTextureRingSettings& InSettings, FIntPoint InEyeSize);
+
+	/** Drops every slot. */
+	void Reset();
+
+	/** Takes a slot to write the frame into. @return the slot, or INDEX_NONE to skip the frame. */
+	int32 BeginWrite();
+
+	/** Hands Slot to the streamer holding Frame, it becomes the latest slot. @return false if Slot was not being written. */
+	bool EndWrite(int32 Slot, uint64 Frame = 0);
+
+	/** Gives Slot back without writing it, it keeps what it held before. @return false if Slot was not being written. */
+	bool CancelWrite(int32 Slot);
+
+	/** Slot submitted last, INDEX_NONE until a frame was written. */
+	int32 GetLatestSlot() const { return LatestSlot; }
+	/** Slot submitted last with its frame and handles, the slot is INDEX_NONE until a frame was written. */
+	FPICOXRDPTextureRingFrame GetLatestFrame() const;
+	/** Bumped every time the slots are dropped, the handles of frames of an older generation are gone. */
+	uint32 GetGeneration() const { return Generation; }
+
+	int32 GetDepth() const { return Slots.Num(); }
+	FIntPoint GetEyeSize() const { return EyeSize; }
+	EPICOXRDPTextureSlotState GetSlotState(int32 Slot) const { return Slots[Slot].State; }
+	/** Frame Slot was last written with. */
+	uint64 GetSlotFrame(int32 Slot) const { return Slots[Slot].Frame; }
+
+	/** Whether the streamer tells the ring when it is done with a slot, see IPICOXRDPSharedTextureProvider::IsSynchronized. */
+	bool IsSynchronized() const { return Provider->IsSynchronized(); }
+
+	uint64 GetSharedHandle(int32 Slot, int32 Eye) const { return Provider->GetSharedHandle(Slot, Eye); }
+	FRHITexture2D* GetTexture(int32 Slot, int32 Eye) const { return Provider->GetTexture(Slot, Eye); }
+
+	const FPICOXRDPTextureRingStats& GetStats() const { return Stats; }
+
+private:
+	struct FSlot
+	{
+		EPICOXRDPTextureSlotState State = EPICOXRDPTextureSlotState::Free;
+		// State before the slot was taken, restored by CancelWrite.
+		EPICOXRDPTextureSlotState PreviousState = EPICOXRDPTextureSlotState::Free;
+		uint64 Frame = 0;
+	};
+
+	int32 TakeSlot(int32 Slot);
+
+	TSharedRef<IPICOXRDPSharedTextureProvider> Provider;
+	FPICOXRDPTextureRingSettings Settings;
+	FIntPoint EyeSize = FIntPoint::ZeroValue;
+	FIntPoint FailedEyeSize = FIntPoint::ZeroValue;
+	int32 FailedDepth = 0;
+	TArray<FSlot> Slots;
+	int32 LatestSlot = INDEX_NONE;
+	uint32 Generation = 0;
+	FPICOXRDPTextureRingStats Stats;
+};
+
+/**
+ * Frame of a ring handed from the render thread to the RHI thread, which submits it from Present.
+ * The render thread publishes each frame through a command queued after its copies, so it is only seen once they ran,
+ * and withdraws the frames of slots the ring dropped, including those still queued. Thread safe.
+ */
+class PICOXRDPHMD_API FPICOXRDPPublishedFrame
+{
+public:
+	/** Makes Frame the one Get returns, unless its generation was withdrawn. */
+	void Publish(const FPICOXRDPTextureRingFrame& Frame);
+
+	/** Drops the frame published, and every frame published from now on that is older than Generation. */
+	void Withdraw(uint32 Generation);
+
+	/** Frame published last, the slot is INDEX_NONE if there is none. */
+	FPICOXRDPTextureRingFrame Get() const;
+
+private:
+	mutable FCriticalSection Lock;
+	FPICOXRDPTextureRingFrame Latest;
+	uint32 Generation = 0;
+};
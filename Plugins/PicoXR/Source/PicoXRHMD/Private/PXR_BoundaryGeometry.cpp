@@ -0,0 +1,136 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_BoundaryGeometry.h"
+
+namespace
+{
+	float SegmentDistSquared2D(const FVector& Point, const FVector& SegmentStart, const FVector& SegmentEnd)
+	{
+		const FVector2D Point2D(Point);
+		return FVector2D::DistSquared(Point2D, FMath::ClosestPointOnSegment2D(Point2D, FVector2D(SegmentStart), FVector2D(SegmentEnd)));
+	}
+}
+
+FPICOXRBoundaryGeometry::FPICOXRBoundaryGeometry()
+	: SimplifyTolerance(0.05f)
+	, Revision(0)
+{
+}
+
+bool FPICOXRBoundaryGeometry::Update(TArrayView<const FVector> InPoints, float ChangeTolerance)
+{
+	bool bChanged = InPoints.Num() != Points.Num();
+	const float ChangeToleranceSquared = FMath::Square(FMath::Max(ChangeTolerance, 0.0f));
+	for (int32 Index = 0; Index < InPoints.Num() && !bChanged; Index++)
+	{
+		bChanged = FVector::DistSquared(InPoints[Index], Points[Index]) > ChangeToleranceSquared;
+	}
+	if (!bChanged)
+	{
+		return false;
+	}
+
+	Points.Reset(InPoints.Num());
+	Points.Append(InPoints.GetData(), InPoints.Num());
+	SimplifyPolygon(Points, SimplifyTolerance, SimplifiedPoints);
+	Revision++;
+	return true;
+}
+
+void FPICOXRBoundaryGeometry::SetSimplifyTolerance(float Tolerance)
+{
+	Tolerance = FMath::Max(Tolerance, 0.0f);
+	if (Tolerance != SimplifyTolerance)
+	{
+		SimplifyTolerance = Tolerance;
+		SimplifyPolygon(Points, SimplifyTolerance, SimplifiedPoints);
+	}
+}
+
+void FPICOXRBoundaryGeometry::SimplifyPolygon(TArrayView<const FVector> InPoints, float Tolerance, TArray<FVector>& OutPoints)
+{
+	const int32 NumPoints = InPoints.Num();
+	OutPoints.Reset(NumPoints);
+	if (NumPoints <= 3)
+	{
+		OutPoints.Append(InPoints.GetData(), NumPoints);
+		return;
+	}
+
+	// Split the polygon into two chains at the first point and the point farthest from it.
+	int32 FarPoint = 1;
+	float FarDistSquared = -1.0f;
+	for (int32 Index = 1; Index < NumPoints; Index++)
+	{
+		const float DistSquared = FVector2D::DistSquared(FVector2D(InPoints[Index]), FVector2D(InPoints[0]));
+		if (DistSquared > FarDistSquared)
+		{
+			FarDistSquared = DistSquared;
+			FarPoint = Index;
+		}
+	}
+
+	TArray<bool> Keep;
+	Keep.SetNumZeroed(NumPoints);
+	Keep[0] = true;
+	Keep[FarPoint] = true;
+
+	// Ranges of the chains still to simplify, an end of NumPoints stands for the first point.
+	TArray<TPair<int32, int32>, TInlineAllocator<64>> Ranges;
+	Ranges.Emplace(0, FarPoint);
+	Ranges.Emplace(FarPoint, NumPoints);
+	const float ToleranceSquared = FMath::Square(FMath::Max(Tolerance, 0.0f));
+	while (Ranges.Num() > 0)
+	{
+		const TPair<int32, int32> Range = Ranges.Pop(false);
+		const FVector& SegmentStart = InPoints[Range.Key];
+		const FVector& SegmentEnd = InPoints[Range.Value % NumPoints];
+		int32 Farthest = INDEX_NONE;
+		float FarthestDistSquared = ToleranceSquared;
+		for (int32 Index = Range.Key + 1; Index < Range.Value; Index++)
+		{
+			const float DistSquared = SegmentDistSquared2D(InPoints[Index], SegmentStart, SegmentEnd);
+			if (DistSquared > FarthestDistSquared)
+			{
+				FarthestDistSquared = DistSquared;
+				Farthest = Index;
+			}
+		}
+		if (Farthest != INDEX_NONE)
+		{
+			Keep[Farthest] = true;
+			Ranges.Emplace(Range.Key, Farthest);
+			Ranges.Emplace(Farthest, Range.Value);
+		}
+	}
+
+	int32 NumKept = 0;
+	for (bool bKeep : Keep)
+	{
+		NumKept += bKeep ? 1 : 0;
+	}
+	if (NumKept < 3)
+	{
+		// Everything lies within the tolerance of one line, keep the point farthest from it to stay a polygon.
+		int32 Farthest = INDEX_NONE;
+		float FarthestDistSquared = -1.0f;
+		for (int32 Index = 1; Index < NumPoints; Index++)
+		{
+			const float DistSquared = SegmentDistSquared2D(InPoints[Index], InPoints[0], InPoints[FarPoint]);
+			if (Index != FarPoint && DistSquared > FarthestDistSquared)
+			{
+				FarthestDistSquared = DistSquared;
+				Farthest = Index;
+			}
+		}
+		Keep[Farthest] = true;
+	}
+
+	for (int32 Index = 0; Index < NumPoints; Index++)
+	{
+		if (Keep[Index])
+		{
+			OutPoints.Add(InPoints[Index]);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+
+/**
+ * Boundary polygon with a revision that only changes when the polygon does, plus a simplified copy for gameplay use.
+ * Points are in tracking space on the Unreal axes, the simplification works in the horizontal plane.
+ */
+class FPICOXRBoundaryGeometry
+{
+public:
+	FPICOXRBoundaryGeometry();
+
+	/**
+	 * Takes a freshly fetched polygon. A new revision starts if the number of points changed or a point moved by more than ChangeTolerance.
+	 * @return true if the revision changed.
+	 */
+	bool Update(TArrayView<const FVector> InPoints, float ChangeTolerance);
+
+	/** Maximum distance of the dropped points to the simplified polygon, 0 keeps every point that is not collinear. */
+	void SetSimplifyTolerance(float Tolerance);
+	float GetSimplifyTolerance() const { return SimplifyTolerance; }
+
+	/** 0 until the first non empty polygon. */
+	uint32 GetRevision() const { return Revision; }
+	const TArray<FVector>& GetPoints() const { return Points; }
+	const TArray<FVector>& GetSimplifiedPoints() const { return SimplifiedPoints; }
+
+	/**
+	 * Ramer-Douglas-Peucker on a closed polygon, keeping points in their original order.
+	 * The result keeps at least three points of a polygon that has them.
+	 */
+	static void SimplifyPolygon(TArrayView<const FVector> InPoints, float Tolerance, TArray<FVector>& OutPoints);
+
+private:
+	TArray<FVector> Points;
+	TArray<FVector> SimplifiedPoints;
+	float SimplifyTolerance;
+	uint32 Revision;
+};
@@ -0,0 +1,285 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_BoundaryIndex.h"
+#include <algorithm>
+
+// Segments per BVH leaf.
+#define PXR_BOUNDARY_LEAF_SIZE 4
+// Deep enough for 2^32 segments with a median split.
+#define PXR_BOUNDARY_STACK_SIZE 64
+
+const FBox2D FPICOXRBoundaryIndex::EmptyBounds(ForceInit);
+
+FPICOXRBoundaryQueryResult::FPICOXRBoundaryQueryResult()
+	: ClosestPoint(FVector2D::ZeroVector)
+	, Normal(FVector2D::ZeroVector)
+	, Distance(0.0f)
+	, Segment(INDEX_NONE)
+	, bInside(false)
+{
+}
+
+FPICOXRBoundaryIndex::FPICOXRBoundaryIndex()
+	: Winding(1.0f)
+{
+}
+
+void FPICOXRBoundaryIndex::Reset()
+{
+	Segments.Reset();
+	Nodes.Reset();
+	Winding = 1.0f;
+}
+
+void FPICOXRBoundaryIndex::Build(TArrayView<const FVector2D> Points)
+{
+	Reset();
+	const int32 NumPoints = Points.Num();
+	if (NumPoints < 3)
+	{
+		return;
+	}
+
+	float DoubleArea = 0.0f;
+	Segments.Reserve(NumPoints);
+	for (int32 Index = 0; Index < NumPoints; Index++)
+	{
+		const FVector2D& A = Points[Index];
+		const FVector2D& B = Points[(Index + 1) % NumPoints];
+		DoubleArea += FVector2D::CrossProduct(A, B);
+		if (A != B)
+		{
+			Segments.Add({ A, B, Index });
+		}
+	}
+	Winding = DoubleArea >= 0.0f ? 1.0f : -1.0f;
+	if (Segments.Num() == 0)
+	{
+		return;
+	}
+
+	Nodes.Reserve(2 * FMath::DivideAndRoundUp(Segments.Num(), PXR_BOUNDARY_LEAF_SIZE));
+	BuildNode(0, Segments.Num());
+}
+
+int32 FPICOXRBoundaryIndex::BuildNode(int32 First, int32 Count)
+{
+	const int32 NodeIndex = Nodes.AddUninitialized();
+	FBox2D Bounds(ForceInit);
+	FBox2D Centers(ForceInit);
+	for (int32 Index = First; Index < First + Count; Index++)
+	{
+		Bounds += Segments[Index].A;
+		Bounds += Segments[Index].B;
+		Centers += (Segments[Index].A + Segments[Index].B) * 0.5f;
+	}
+	Nodes[NodeIndex].Bounds = Bounds;
+
+	if (Count <= PXR_BOUNDARY_LEAF_SIZE)
+	{
+		Nodes[NodeIndex].First = First;
+		Nodes[NodeIndex].Count = Count;
+		return NodeIndex;
+	}
+
+	// Median split along the longer axis of the segment centers.
+	const FVector2D Extent = Centers.GetExtent();
+	const bool bSplitX = Extent.X >= Extent.Y;
+	const int32 Half = Count / 2;
+	FSegment* Begin = Segments.GetData() + First;
+	std::nth_element(Begin, Begin + Half, Begin + Count, [bSplitX](const FSegment& Left, const FSegment& Right)
+	{
+		return bSplitX ? (Left.A.X + Left.B.X) < (Right.A.X + Right.B.X) : (Left.A.Y + Left.B.Y) < (Right.A.Y + Right.B.Y);
+	});
+
+	BuildNode(First, Half);
+	const int32 RightChild = BuildNode(First + Half, Count - Half);
+	Nodes[NodeIndex].First = RightChild;
+	Nodes[NodeIndex].Count = 0;
+	return NodeIndex;
+}
+
+float FPICOXRBoundaryIndex::SegmentDistSquared(const FSegment& Segment, const FVector2D& Point, FVector2D& OutClosest)
+{
+	const FVector2D Edge = Segment.B - Segment.A;
+	const float T = FMath::Clamp(FVector2D::DotProduct(Point - Segment.A, Edge) / Edge.SizeSquared(), 0.0f, 1.0f);
+	OutClosest = Segment.A + Edge * T;
+	return FVector2D::DistSquared(Point, OutClosest);
+}
+
+bool FPICOXRBoundaryIndex::CrossesRay(const FSegment& Segment, const FVector2D& Point)
+{
+	// Crossing of the ray from Point towards +X, half open in Y so shared vertices count once.
+	if ((Segment.A.Y > Point.Y) == (Segment.B.Y > Point.Y))
+	{
+		return false;
+	}
+	const float CrossX = Segment.A.X + (Point.Y - Segment.A.Y) * (Segment.B.X - Segment.A.X) / (Segment.B.Y - Segment.A.Y);
+	return Point.X < CrossX;
+}
+
+float FPICOXRBoundaryIndex::BoxDistSquared(const FBox2D& Box, const FVector2D& Point)
+{
+	const float DX = FMath::Max3(Box.Min.X - Point.X, 0.0f, Point.X - Box.Max.X);
+	const float DY = FMath::Max3(Box.Min.Y - Point.Y, 0.0f, Point.Y - Box.Max.Y);
+	return DX * DX + DY * DY;
+}
+
+void FPICOXRBoundaryIndex::FinishResult(int32 SegmentIndex, FPICOXRBoundaryQueryResult& OutResult) const
+{
+	const FSegment& Segment = Segments[SegmentIndex];
+	const FVector2D Direction = (Segment.B - Segment.A).GetSafeNormal();
+	OutResult.Normal = FVector2D(-Direction.Y, Direction.X) * Winding;
+	OutResult.Segment = Segment.Index;
+}
+
+bool FPICOXRBoundaryIndex::QueryPoint(const FVector2D& Point, FPICOXRBoundaryQueryResult& OutResult) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	float BestDistSquared = MAX_flt;
+	int32 BestSegment = INDEX_NONE;
+	FVector2D BestPoint = FVector2D::ZeroVector;
+
+	int32 Stack[PXR_BOUNDARY_STACK_SIZE];
+	int32 StackSize = 0;
+	Stack[StackSize++] = 0;
+	while (StackSize > 0)
+	{
+		const FNode& Node = Nodes[Stack[--StackSize]];
+		if (Node.Count > 0)
+		{
+			for (int32 Index = Node.First; Index < Node.First + Node.Count; Index++)
+			{
+				const FSegment& Segment = Segments[Index];
+				FVector2D Closest;
+				const float DistSquared = SegmentDistSquared(Segment, Point, Closest);
+				if (DistSquared < BestDistSquared || (DistSquared == BestDistSquared && BestSegment != INDEX_NONE && Segment.Index < Segments[BestSegment].Index))
+				{
+					BestDistSquared = DistSquared;
+					BestSegment = Index;
+					BestPoint = Closest;
+				}
+			}
+			continue;
+		}
+
+		const int32 Children[2] = { (int32)(&Node - Nodes.GetData()) + 1, Node.First };
+		const float ChildDist[2] = { BoxDistSquared(Nodes[Children[0]].Bounds, Point), BoxDistSquared(Nodes[Children[1]].Bounds, Point) };
+		// Push the farther child first so the nearer one is visited next and tightens the bound.
+		const int32 Near = ChildDist[0] <= ChildDist[1] ? 0 : 1;
+		const int32 Far = 1 - Near;
+		if (ChildDist[Far] <= BestDistSquared)
+		{
+			check(StackSize < PXR_BOUNDARY_STACK_SIZE);
+			Stack[StackSize++] = Children[Far];
+		}
+		if (ChildDist[Near] <= BestDistSquared)
+		{
+			check(StackSize < PXR_BOUNDARY_STACK_SIZE);
+			Stack[StackSize++] = Children[Near];
+		}
+	}
+
+	// Every distance was NaN or infinite, from a point that is.
+	if (BestSegment == INDEX_NONE)
+	{
+		return false;
+	}
+	OutResult.ClosestPoint = BestPoint;
+	OutResult.Distance = FMath::Sqrt(BestDistSquared);
+	OutResult.bInside = IsInside(Point);
+	FinishResult(BestSegment, OutResult);
+	return true;
+}
+
+void FPICOXRBoundaryIndex::QueryPoints(TArrayView<const FVector2D> Points, TArrayView<FPICOXRBoundaryQueryResult> OutResults) const
+{
+	check(OutResults.Num() >= Points.Num());
+	for (int32 Index = 0; Index < Points.Num(); Index++)
+	{
+		if (!QueryPoint(Points[Index], OutResults[Index]))
+		{
+			OutResults[Index] = FPICOXRBoundaryQueryResult();
+		}
+	}
+}
+
+bool FPICOXRBoundaryIndex::IsInside(const FVector2D& Point) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	bool bInside = false;
+	int32 Stack[PXR_BOUNDARY_STACK_SIZE];
+	int32 StackSize = 0;
+	Stack[StackSize++] = 0;
+	while (StackSize > 0)
+	{
+		const int32 NodeIndex = Stack[--StackSize];
+		const FNode& Node = Nodes[NodeIndex];
+		// Only segments spanning Point.Y can cross the ray. Pruning on X as well could disagree with the crossing test by an ulp.
+		if (Node.Bounds.Min.Y > Point.Y || Node.Bounds.Max.Y < Point.Y)
+		{
+			continue;
+		}
+		if (Node.Count > 0)
+		{
+			for (int32 Index = Node.First; Index < Node.First + Node.Count; Index++)
+			{
+				bInside ^= CrossesRay(Segments[Index], Point);
+			}
+			continue;
+		}
+		check(StackSize + 2 <= PXR_BOUNDARY_STACK_SIZE);
+		Stack[StackSize++] = Node.First;
+		Stack[StackSize++] = NodeIndex + 1;
+	}
+	return bInside;
+}
+
+bool FPICOXRBoundaryIndex::QueryPointBruteForce(const FVector2D& Point, FPICOXRBoundaryQueryResult& OutResult) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+	float BestDistSquared = MAX_flt;
+	int32 BestSegment = INDEX_NONE;
+	FVector2D BestPoint = FVector2D::ZeroVector;
+	for (int32 Index = 0; Index < Segments.Num(); Index++)
+	{
+		FVector2D Closest;
+		const float DistSquared = SegmentDistSquared(Segments[Index], Point, Closest);
+		if (DistSquared < BestDistSquared || (DistSquared == BestDistSquared && BestSegment != INDEX_NONE && Segments[Index].Index < Segments[BestSegment].Index))
+		{
+			BestDistSquared = DistSquared;
+			BestSegment = Index;
+			BestPoint = Closest;
+		}
+	}
+	if (BestSegment == INDEX_NONE)
+	{
+		return false;
+	}
+	OutResult.ClosestPoint = BestPoint;
+	OutResult.Distance = FMath::Sqrt(BestDistSquared);
+	OutResult.bInside = IsInsideBruteForce(Point);
+	FinishResult(BestSegment, OutResult);
+	return true;
+}
+
+bool FPICOXRBoundaryIndex::IsInsideBruteForce(const FVector2D& Point) const
+{
+	bool bInside = false;
+	for (const FSegment& Segment : Segments)
+	{
+		bInside ^= CrossesRay(Segment, Point);
+	}
+	return bInside;
+}
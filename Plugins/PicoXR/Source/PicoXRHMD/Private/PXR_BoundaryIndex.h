@@ -0,0 +1,75 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+
+/** Result of a distance query against a boundary polygon, in the units of the polygon. */
+struct FPICOXRBoundaryQueryResult
+{
+	FPICOXRBoundaryQueryResult();
+
+	FVector2D ClosestPoint;
+	// Unit normal of the closest segment, pointing into the polygon.
+	FVector2D Normal;
+	// Unsigned distance to the closest segment.
+	float Distance;
+	int32 Segment;
+	bool bInside;
+};
+
+/**
+ * Segment BVH over a closed 2D polygon, answering nearest segment and point-in-polygon queries without touching the runtime.
+ * Build once per geometry change, queries are read only and can run from any thread.
+ */
+class FPICOXRBoundaryIndex
+{
+public:
+	FPICOXRBoundaryIndex();
+
+	/** Indexes the closed polygon through Points, the last point connects back to the first. Zero length edges are skipped. */
+	void Build(TArrayView<const FVector2D> Points);
+	void Reset();
+
+	bool IsValid() const { return Segments.Num() > 0; }
+	int32 GetNumSegments() const { return Segments.Num(); }
+	const FBox2D& GetBounds() const { return Nodes.Num() > 0 ? Nodes[0].Bounds : EmptyBounds; }
+
+	/** @return false for an empty index or a point with no finite distance to any segment, OutResult is not written then. */
+	bool QueryPoint(const FVector2D& Point, FPICOXRBoundaryQueryResult& OutResult) const;
+	/** Points that cannot be queried get a default result, whose Segment is INDEX_NONE. */
+	void QueryPoints(TArrayView<const FVector2D> Points, TArrayView<FPICOXRBoundaryQueryResult> OutResults) const;
+	bool IsInside(const FVector2D& Point) const;
+
+	/** Reference versions testing every segment, results are identical to the indexed ones up to ties between segments. */
+	bool QueryPointBruteForce(const FVector2D& Point, FPICOXRBoundaryQueryResult& OutResult) const;
+	bool IsInsideBruteForce(const FVector2D& Point) const;
+
+private:
+	struct FSegment
+	{
+		FVector2D A;
+		FVector2D B;
+		int32 Index;
+	};
+
+	struct FNode
+	{
+		FBox2D Bounds;
+		// Leaves reference Count segments from First, inner nodes have Count 0 and their children at index + 1 and First.
+		int32 First;
+		int32 Count;
+	};
+
+	int32 BuildNode(int32 First, int32 Count);
+	void FinishResult(int32 SegmentIndex, FPICOXRBoundaryQueryResult& OutResult) const;
+
+	static float SegmentDistSquared(const FSegment& Segment, const FVector2D& Point, FVector2D& OutClosest);
+	static bool CrossesRay(const FSegment& Segment, const FVector2D& Point);
+	static float BoxDistSquared(const FBox2D& Box, const FVector2D& Point);
+
+	TArray<FSegment> Segments;
+	TArray<FNode> Nodes;
+	// 1 for counter clockwise polygons, -1 for clockwise ones.
+	float Winding;
+	static const FBox2D EmptyBounds;
+};
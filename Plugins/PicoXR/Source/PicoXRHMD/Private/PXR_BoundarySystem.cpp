@@ -3,6 +3,8 @@
 #include "PXR_BoundarySystem.h"
 #include "IXRTrackingSystem.h"
 #include "PXR_Utils.h"
+#include "PXR_Log.h"
+#include "PXR_EventManager.h"
 #include "XRThreadUtils.h"
 #include "Engine/Engine.h"
 
@@ -15,6 +17,11 @@
 #include "PxrTypes.h"
 #endif
 
+// Boundary points moving less than this, in meters, are runtime noise rather than a redrawn boundary.
+#define PXR_BOUNDARY_CHANGE_TOLERANCE 0.001f
+// Seconds before a failed boundary fetch is retried when nothing invalidated the cache meanwhile.
+#define PXR_BOUNDARY_FETCH_RETRY_SECONDS 1.0
+
 UPICOXRBoundarySystem* UPICOXRBoundarySystem::BoundaryInstance = nullptr;
 UPICOXRBoundarySystem* UPICOXRBoundarySystem::GetInstance()
 {
@@ -27,23 +34,11 @@ UPICOXRBoundarySystem* UPICOXRBoundarySystem::GetInstance()
 }
 
 UPICOXRBoundarySystem::UPICOXRBoundarySystem()
-	:bIsStartCamera(false)
-	,CurrentImageSize(FIntPoint(640,640))
-	,CameraTextureLeft(nullptr)
-	,CameraTextureRight(nullptr)
-	,LeftTextureID(-1)
-	,RightTextureID(-1)
 {
 }
 
 UPICOXRBoundarySystem::~UPICOXRBoundarySystem()
 {
-#if PLATFORM_ANDROID
-	if (bIsStartCamera)
-	{
-		Pxr_StartCameraPreview(0);
-	}
-#endif
 }
 
 bool UPICOXRBoundarySystem::UPxr_GetConfigured()
@@ -137,231 +132,251 @@ bool UPICOXRBoundarySystem::UPxr_TestPoint(FVector Point, bool bIsPlayArea, bool
 
 TArray<FVector> UPICOXRBoundarySystem::UPxr_GetGeometry(bool bIsPlayArea)
 {
-	TArray<FVector> BoundaryGeometry; 
-#if PLATFORM_ANDROID
-	uint32_t pointsCountOutput = -1;
-	PxrVector3f * outPointsFirst = nullptr;
-	if (Pxr_GetBoundaryGeometry(bIsPlayArea,0,&pointsCountOutput,outPointsFirst) == 0)
+	return UPxr_GetGeometryView(bIsPlayArea);
+}
+
+const TArray<FVector>& UPICOXRBoundarySystem::UPxr_GetGeometryView(bool bIsPlayArea)
+{
+	GetBoundaryCache(bIsPlayArea);
+	FPICOXRBoundaryCache& Cache = BoundaryCaches[bIsPlayArea ? 1 : 0];
+	UpdateWorldPoints(Cache);
+	return Cache.WorldPoints;
+}
+
+const TArray<FVector>& UPICOXRBoundarySystem::UPxr_GetSimplifiedGeometryView(bool bIsPlayArea)
+{
+	GetBoundaryCache(bIsPlayArea);
+	FPICOXRBoundaryCache& Cache = BoundaryCaches[bIsPlayArea ? 1 : 0];
+	UpdateWorldPoints(Cache);
+	return Cache.WorldSimplifiedPoints;
+}
+
+uint32 UPICOXRBoundarySystem::UPxr_GetGeometryRevision(bool bIsPlayArea)
+{
+	return GetBoundaryCache(bIsPlayArea).Geometry.GetRevision();
+}
+
+void UPICOXRBoundarySystem::UPxr_SetSimplifyTolerance(float Tolerance)
+{
+	const float ToleranceMeters = FMath::Max(Tolerance, 0.0f) / GetWorldToMetersScale();
+	for (FPICOXRBoundaryCache& Cache : BoundaryCaches)
 	{
-		if (pointsCountOutput <= 0)
-		{
-			return BoundaryGeometry;
-		}
+		Cache.Geometry.SetSimplifyTolerance(ToleranceMeters);
+		Cache.bWorldPointsDirty = true;
+	}
+}
 
-		PxrVector3f * Data = new PxrVector3f[pointsCountOutput];
-		if (Pxr_GetBoundaryGeometry(bIsPlayArea, pointsCountOutput, &pointsCountOutput, Data) == 0)
-		{
-			for (uint32_t i = 0; i < pointsCountOutput; i++)
-			{
-				FVector TempVector = FVector(Data[i].x,Data[i].y,Data[i].z);
-				TempVector = FPICOXRUtils::ConvertXRVectorToUnrealVector(TempVector, GEngine->XRSystem->GetWorldToMetersScale());
-				BoundaryGeometry.Add(TempVector);
-			}
-		}
-		delete[]Data;
-	}	
-#endif
-	return BoundaryGeometry;
+float UPICOXRBoundarySystem::UPxr_GetSimplifyTolerance()
+{
+	return BoundaryCaches[0].Geometry.GetSimplifyTolerance() * GetWorldToMetersScale();
 }
 
-FVector UPICOXRBoundarySystem::UPxr_GetDimensions(bool bIsPlayArea)
+void UPICOXRBoundarySystem::UpdateWorldPoints(FPICOXRBoundaryCache& Cache)
 {
-	FVector Dimensions = FVector::ZeroVector;
-#if PLATFORM_ANDROID
-	PxrVector3f NewDimensions;
-	Pxr_GetBoundaryDimensions(bIsPlayArea, &NewDimensions);
-	Dimensions.X = NewDimensions.x;
-	Dimensions.Y = NewDimensions.y;
-	Dimensions.Z = NewDimensions.z;
-	Dimensions = FPICOXRUtils::ConvertXRVectorToUnrealVector(Dimensions, GEngine->XRSystem->GetWorldToMetersScale());
-#endif
-	return Dimensions;
+	const float WorldToMetersScale = GetWorldToMetersScale();
+	if (!Cache.bWorldPointsDirty && Cache.WorldPointsScale == WorldToMetersScale)
+	{
+		return;
+	}
+	const TArray<FVector>& Points = Cache.Geometry.GetPoints();
+	Cache.WorldPoints.SetNumUninitialized(Points.Num());
+	for (int32 Index = 0; Index < Points.Num(); Index++)
+	{
+		Cache.WorldPoints[Index] = Points[Index] * WorldToMetersScale;
+	}
+	const TArray<FVector>& SimplifiedPoints = Cache.Geometry.GetSimplifiedPoints();
+	Cache.WorldSimplifiedPoints.SetNumUninitialized(SimplifiedPoints.Num());
+	for (int32 Index = 0; Index < SimplifiedPoints.Num(); Index++)
+	{
+		Cache.WorldSimplifiedPoints[Index] = SimplifiedPoints[Index] * WorldToMetersScale;
+	}
+	Cache.WorldPointsScale = WorldToMetersScale;
+	Cache.bWorldPointsDirty = false;
 }
 
-bool UPICOXRBoundarySystem::UPxr_GetSeeThroughData(int CameraType, UTexture2D*& CameraImage)
+float UPICOXRBoundarySystem::GetWorldToMetersScale()
 {
-#if PLATFORM_ANDROID
-	if(bIsStartCamera == false)
+	return GEngine && GEngine->XRSystem.IsValid() ? GEngine->XRSystem->GetWorldToMetersScale() : 100.0f;
+}
+
+void UPICOXRBoundarySystem::InvalidateBoundaryCache()
+{
+	for (FPICOXRBoundaryCache& Cache : BoundaryCaches)
 	{
-		ExecuteOnRenderThread([]()
-        {         
-          ExecuteOnRHIThread([]()
-          {
-          Pxr_StartCameraPreview(1);
-          });
-        });
-		FPlatformProcess::Sleep(0.1);
-		bIsStartCamera = true;
+		Cache.bValid = false;
 	}
-	if (CameraType == 0)
+}
+
+void UPICOXRBoundarySystem::RefreshBoundaryGeometry()
+{
+	InvalidateBoundaryCache();
+	GetBoundaryCache(false);
+	GetBoundaryCache(true);
+}
+
+const FPICOXRBoundaryCache& UPICOXRBoundarySystem::GetBoundaryCache(bool bIsPlayArea)
+{
+	FPICOXRBoundaryCache& Cache = BoundaryCaches[bIsPlayArea ? 1 : 0];
+	if (Cache.bValid && (!Cache.bFetchFailed || FPlatformTime::Seconds() < Cache.RetryTime))
+	{
+		return Cache;
+	}
+
+	TArray<FVector> Points;
+	bool bFetched = true;
+#if PLATFORM_ANDROID
+	uint32_t PointsCount = 0;
+	bFetched = Pxr_GetBoundaryGeometry(bIsPlayArea, 0, &PointsCount, nullptr) == 0;
+	if (bFetched && PointsCount > 0)
 	{
-		if (CameraTextureLeft == nullptr)
+		TArray<PxrVector3f> RawPoints;
+		RawPoints.SetNumUninitialized(PointsCount);
+		bFetched = Pxr_GetBoundaryGeometry(bIsPlayArea, PointsCount, &PointsCount, RawPoints.GetData()) == 0;
+		if (bFetched)
 		{
-			CameraTextureLeft = UTexture2D::CreateTransient(CurrentImageSize.X,CurrentImageSize.Y, EPixelFormat::PF_R8G8B8A8);
-			check(CameraTextureLeft);
-#if ENGINE_MINOR_VERSION > 25
-			FTextureResource* Resource = CameraTextureLeft->CreateResource();
-#else	
-			FTexture2DResource* Resource = static_cast<FTexture2DResource *>(CameraTextureLeft->CreateResource());
-#endif
-			CameraTextureLeft->UpdateResource();
-			ExecuteOnRenderThread([Resource,this]()
-	        {
-	            Resource->InitRHI();
-	            ExecuteOnRHIThread([Resource,this]()
-	            {
-#if ENGINE_MINOR_VERSION > 25
-						LeftTextureID = (*static_cast<int32_t*>(Resource->GetTexture2DRHI()->GetNativeResource())) - 1;
-#else
-						LeftTextureID = *static_cast<int32_t*>(Resource->GetTexture2DRHI()->GetNativeResource());
-#endif
-	            });
-	        });
-			delete Resource;
-			Resource = nullptr;
+			PointsCount = FMath::Min<uint32_t>(PointsCount, RawPoints.Num());
+			Points.SetNumUninitialized(PointsCount);
+			FPICOXRUtils::ConvertXRVectorsToUnrealVectors(RawPoints.GetData(), Points.GetData(), PointsCount, 1.0f);
 		}
-		else
-		{
-			if ((CameraTextureLeft->GetSizeY() != CurrentImageSize.Y)|| (CameraTextureLeft->GetSizeX() != CurrentImageSize.X))
-			{
-				CameraTextureLeft->ReleaseResource();
-				CameraTextureLeft = UTexture2D::CreateTransient(CurrentImageSize.X,CurrentImageSize.Y, EPixelFormat::PF_R8G8B8A8);
-				check(CameraTextureLeft);
-#if ENGINE_MINOR_VERSION > 25
-				FTextureResource* Resource = CameraTextureLeft->CreateResource();
-#else	
-				FTexture2DResource* Resource = static_cast<FTexture2DResource *>(CameraTextureLeft->CreateResource());
-#endif
-				CameraTextureLeft->UpdateResource();
-				ExecuteOnRenderThread([Resource,this]()
-                {
-                    Resource->InitRHI();
-                    ExecuteOnRHIThread([Resource,this]()
-                    {
-#if ENGINE_MINOR_VERSION > 25
-							LeftTextureID = (*static_cast<int32_t*>(Resource->GetTexture2DRHI()->GetNativeResource())) - 1;
-#else
-							LeftTextureID = *static_cast<int32_t*>(Resource->GetTexture2DRHI()->GetNativeResource());
+	}
 #endif
-                    });
-                });
-				delete Resource;
-				Resource = nullptr;
-			}
-		}
-		ExecuteOnRenderThread([this]()
-        {
-            ExecuteOnRHIThread([this]()
-            {
-	           uint32_t exposure = 0;
-	           int64_t start_of_exposure_ts = 0;
-			   bool ret = true;
-	           uint32_t SizeX =	CameraTextureLeft->GetSizeX();
-	           uint32_t SizeY =	CameraTextureLeft->GetSizeY();
-			   PxrSeeThoughData seeThoughData;
-			   seeThoughData.leftEyeTextureId = LeftTextureID;
-			   seeThoughData.rightEyeTextureId = 0;
-			   seeThoughData.width = SizeX;
-			   seeThoughData.height = SizeY;
-			   seeThoughData.exposure = exposure;
-			   seeThoughData.startTimeOfExposure = start_of_exposure_ts;
-			   seeThoughData.valid = ret;
-			   int result = Pxr_GetSeeThroughData(&seeThoughData);
-            });
-        });
-		CameraImage = CameraTextureLeft;
-		return true;
-	}else
+	Cache.bValid = true;
+	if (!bFetched)
 	{
-		if (CameraTextureRight == nullptr)
+		// The last geometry is kept, queries until the retry get it without asking the runtime again.
+		if (!Cache.bFetchFailed)
 		{
-			CameraTextureRight = UTexture2D::CreateTransient(CurrentImageSize.X,CurrentImageSize.Y, EPixelFormat::PF_R8G8B8A8);
-			check(CameraTextureRight);
-#if ENGINE_MINOR_VERSION > 25
-			FTextureResource* Resource = CameraTextureRight->CreateResource();
-#else	
-			FTexture2DResource* Resource = static_cast<FTexture2DResource *>(CameraTextureRight->CreateResource());
-#endif
-			CameraTextureRight->UpdateResource();
-			ExecuteOnRenderThread([Resource,this]()
-	        {
-	            Resource->InitRHI();
-	            ExecuteOnRHIThread([Resource,this]()
-	            {
-#if ENGINE_MINOR_VERSION > 25
-						RightTextureID = (*static_cast<int32_t*>(Resource->GetTexture2DRHI()->GetNativeResource())) - 1;
-#else
-						RightTextureID = *static_cast<int32_t*>(Resource->GetTexture2DRHI()->GetNativeResource());
-#endif
-	            });
-	        });
-			delete Resource;
-			Resource = nullptr;
+			PXR_LOGW(PxrUnreal, "Failed to get boundary geometry, PlayArea:%d", bIsPlayArea);
 		}
-		else
-		{
-			if ((CameraTextureRight->GetSizeY() != CurrentImageSize.Y)|| (CameraTextureRight->GetSizeX() != CurrentImageSize.X))
-			{
-				CameraTextureRight->ReleaseResource();
-				CameraTextureRight = UTexture2D::CreateTransient(CurrentImageSize.X,CurrentImageSize.Y, EPixelFormat::PF_R8G8B8A8);
-				check(CameraTextureRight);
-#if ENGINE_MINOR_VERSION > 25
-				FTextureResource* Resource = CameraTextureRight->CreateResource();
-#else	
-				FTexture2DResource* Resource = static_cast<FTexture2DResource *>(CameraTextureRight->CreateResource());
-#endif
-				CameraTextureRight->UpdateResource();
-				ExecuteOnRenderThread([Resource,this]()
-                {
-                    Resource->InitRHI();
-                    ExecuteOnRHIThread([Resource,this]()
-                    {
-#if ENGINE_MINOR_VERSION > 25
-							RightTextureID = (*static_cast<int32_t*>(Resource->GetTexture2DRHI()->GetNativeResource())) - 1;
-#else
-							RightTextureID = *static_cast<int32_t*>(Resource->GetTexture2DRHI()->GetNativeResource());
+		Cache.bFetchFailed = true;
+		Cache.RetryTime = FPlatformTime::Seconds() + PXR_BOUNDARY_FETCH_RETRY_SECONDS;
+		return Cache;
+	}
+	Cache.bFetchFailed = false;
+
+	if (!Cache.Geometry.Update(Points, PXR_BOUNDARY_CHANGE_TOLERANCE))
+	{
+		return Cache;
+	}
+
+	TArray<FVector2D> Polygon;
+	Polygon.SetNumUninitialized(Points.Num());
+	for (int32 Index = 0; Index < Points.Num(); Index++)
+	{
+		Polygon[Index] = FVector2D(Points[Index]);
+	}
+	Cache.Index.Build(Polygon);
+	Cache.Dimensions = FVector::ZeroVector;
+#if PLATFORM_ANDROID
+	PxrVector3f NewDimensions;
+	if (Pxr_GetBoundaryDimensions(bIsPlayArea, &NewDimensions) == 0)
+	{
+		Cache.Dimensions = FPICOXRUtils::ConvertXRVectorToUnrealVector(FVector(NewDimensions.x, NewDimensions.y, NewDimensions.z), 1.0f);
+	}
 #endif
-                    });
-                });
-				delete Resource;
-				Resource = nullptr;
-			}
-		}
-		ExecuteOnRenderThread([this]()
-        {
-            ExecuteOnRHIThread([this]()
-            {
-			   uint32_t exposure = 0;
-			   int64_t start_of_exposure_ts = 0;
-			   bool ret = true;
-			   uint32_t SizeX = CameraTextureLeft->GetSizeX();
-			   uint32_t SizeY = CameraTextureLeft->GetSizeY();
-			   PxrSeeThoughData seeThoughData;
-			   seeThoughData.leftEyeTextureId = 0;
-			   seeThoughData.rightEyeTextureId = RightTextureID;
-			   seeThoughData.width = SizeX;
-			   seeThoughData.height = SizeY;
-			   seeThoughData.exposure = exposure;
-			   seeThoughData.startTimeOfExposure = start_of_exposure_ts;
-			   seeThoughData.valid = ret;
-			   int result = Pxr_GetSeeThroughData(&seeThoughData);
-            });
-        });
-		CameraImage = CameraTextureRight;
-		return true;
+	Cache.bWorldPointsDirty = true;
+	UpdateWorldPoints(Cache);
+	PXR_LOGI(PxrUnreal, "Boundary geometry changed, PlayArea:%d Revision:%u Points:%d Simplified:%d", bIsPlayArea,
+		Cache.Geometry.GetRevision(), Points.Num(), Cache.Geometry.GetSimplifiedPoints().Num());
+
+	GeometryChangedDelegate.Broadcast(bIsPlayArea, Cache.Geometry.GetRevision(), Cache.WorldPoints);
+	UPICOXREventManager::GetInstance()->BoundaryGeometryChangedDelegate.Broadcast(bIsPlayArea, static_cast<int32>(Cache.Geometry.GetRevision()), Cache.WorldPoints);
+	return Cache;
+}
+
+bool UPICOXRBoundarySystem::UPxr_QueryPoint(FVector Point, bool bIsPlayArea, bool& IsInside, float& ClosestDistance,
+	FVector& ClosestPoint, FVector& ClosestPointNormal)
+{
+	FPICOXRBoundaryPointResult Result;
+	if (!UPxr_QueryPoints(TArrayView<const FVector>(&Point, 1), bIsPlayArea, TArrayView<FPICOXRBoundaryPointResult>(&Result, 1)))
+	{
+		return false;
 	}
+	IsInside = Result.bIsInside;
+	ClosestDistance = Result.ClosestDistance;
+	ClosestPoint = Result.ClosestPoint;
+	ClosestPointNormal = Result.ClosestPointNormal;
+	return true;
+}
 
+bool UPICOXRBoundarySystem::UPxr_QuerySphere(FVector Center, float Radius, bool bIsPlayArea, bool& IsInside, bool& IsIntersecting,
+	float& SurfaceDistance, FVector& ClosestPoint, FVector& ClosestPointNormal)
+{
+	bool bCenterInside = false;
+	float CenterDistance = 0.0f;
+	if (!UPxr_QueryPoint(Center, bIsPlayArea, bCenterInside, CenterDistance, ClosestPoint, ClosestPointNormal))
+	{
+		return false;
+	}
+	Radius = FMath::Max(Radius, 0.0f);
+	SurfaceDistance = (bCenterInside ? CenterDistance : -CenterDistance) - Radius;
+	IsIntersecting = CenterDistance <= Radius;
+	IsInside = bCenterInside && !IsIntersecting;
+	return true;
+}
+
+bool UPICOXRBoundarySystem::UPxr_QueryPoints(TArrayView<const FVector> Points, bool bIsPlayArea, TArrayView<FPICOXRBoundaryPointResult> OutResults)
+{
+	check(OutResults.Num() >= Points.Num());
+	const FPICOXRBoundaryIndex& Index = GetBoundaryCache(bIsPlayArea).Index;
+	if (!Index.IsValid())
+	{
+		return false;
+	}
+
+	const float WorldToMetersScale = GetWorldToMetersScale();
+	const float MetersToWorldScale = 1.0f / WorldToMetersScale;
+	for (int32 PointIndex = 0; PointIndex < Points.Num(); PointIndex++)
+	{
+		const FVector& Point = Points[PointIndex];
+		FPICOXRBoundaryQueryResult Result;
+		Index.QueryPoint(FVector2D(Point) * MetersToWorldScale, Result);
+
+		FPICOXRBoundaryPointResult& OutResult = OutResults[PointIndex];
+		OutResult.ClosestPoint = FVector(Result.ClosestPoint * WorldToMetersScale, Point.Z);
+		OutResult.ClosestPointNormal = FVector(Result.Normal, 0.0f);
+		OutResult.ClosestDistance = Result.Distance * WorldToMetersScale;
+		OutResult.bIsInside = Result.bInside;
+	}
+	return true;
+}
+
+FVector UPICOXRBoundarySystem::UPxr_GetDimensions(bool bIsPlayArea)
+{
+	return GetBoundaryCache(bIsPlayArea).Dimensions * GetWorldToMetersScale();
+}
+
+bool UPICOXRBoundarySystem::UPxr_GetSeeThroughData(int CameraType, UTexture2D*& CameraImage)
+{
+#if PLATFORM_ANDROID
+	int64 FrameNumber = 0;
+	if (!UPxr_GetSeeThroughFrame(CameraType, CameraImage, FrameNumber))
+	{
+		// The camera is still starting, hand out the texture it writes first.
+		CameraImage = CameraStream.GetFallbackTexture(CameraType == 0 ? 0 : 1);
+	}
+	return true;
 #endif
 	return  false;
 }
 
+bool UPICOXRBoundarySystem::UPxr_GetSeeThroughFrame(int CameraType, UTexture2D*& CameraImage, int64& FrameNumber)
+{
+	const int32 Eye = CameraType == 0 ? 0 : 1;
+	CameraStream.Update(Eye, GFrameCounter);
+	uint64 LatestFrameNumber = 0;
+	if (!CameraStream.GetLatestFrame(Eye, CameraImage, LatestFrameNumber))
+	{
+		return false;
+	}
+	FrameNumber = static_cast<int64>(LatestFrameNumber);
+	return true;
+}
+
 bool UPICOXRBoundarySystem::UPxr_SetCameraImageSize(FIntPoint ImageSize)
 {
 #if PLATFORM_ANDROID
-	uint32_t width = (uint32_t)ImageSize.X;
-	uint32_t height = (uint32_t)ImageSize.Y;
-	Pxr_SetSeeThroughImageExtent(width,height);
-	CurrentImageSize = ImageSize;
+	CameraStream.SetImageSize(ImageSize);
 	return true;
 #endif
 	return false;
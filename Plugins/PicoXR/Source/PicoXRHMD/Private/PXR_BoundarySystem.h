@@ -4,8 +4,42 @@
 #include "CoreMinimal.h"
 #include "Engine/Texture2D.h"
 #include "UObject/Object.h"
+#include "PXR_BoundaryIndex.h"
+#include "PXR_BoundaryGeometry.h"
+#include "PXR_CameraStream.h"
 #include "PXR_BoundarySystem.generated.h"
 
+/** Result of a local boundary query, in tracking space and Unreal units. */
+struct FPICOXRBoundaryPointResult
+{
+	FVector ClosestPoint;
+	// Points into the boundary, Z is 0.
+	FVector ClosestPointNormal;
+	float ClosestDistance;
+	bool bIsInside;
+};
+
+/** Boundary geometry fetched from the runtime, kept until the boundary may have changed. */
+struct FPICOXRBoundaryCache
+{
+	// Tracking space, Unreal axes, in meters so the cache survives world to meters changes.
+	FPICOXRBoundaryGeometry Geometry;
+	FPICOXRBoundaryIndex Index;
+	FVector Dimensions = FVector::ZeroVector;
+	// Geometry and simplified geometry in Unreal units, converted again when the revision or the world to meters scale changes.
+	TArray<FVector> WorldPoints;
+	TArray<FVector> WorldSimplifiedPoints;
+	float WorldPointsScale = 0.0f;
+	bool bWorldPointsDirty = true;
+	bool bValid = false;
+	// A failed fetch keeps the last geometry, and is only retried after an invalidation or once RetryTime has passed.
+	bool bFetchFailed = false;
+	double RetryTime = 0.0;
+};
+
+/** Broadcast with the revision and the geometry in Unreal units when a boundary was redrawn. */
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FPICOXROnBoundaryGeometryChanged, bool /*bIsPlayArea*/, uint32 /*Revision*/, const TArray<FVector>& /*Geometry*/);
+
 UCLASS()
 class UPICOXRBoundarySystem : public UObject
 {
@@ -35,17 +69,64 @@ public:
 
 	FVector UPxr_GetDimensions(bool BoundaryType);
 
+	/**
+	 * Local counterparts of UPxr_TestPoint answered from the cached boundary geometry, without a runtime call per query.
+	 * Distances are measured in the horizontal plane, the closest point keeps the height of the query.
+	 * Game thread only, return false while no boundary geometry is available.
+	 */
+	bool UPxr_QueryPoint(FVector Point, bool bIsPlayArea, bool& IsInside, float& ClosestDistance, FVector& ClosestPoint, FVector& ClosestPointNormal);
+
+	/** SurfaceDistance is the clearance between the sphere and the boundary, negative when the sphere crosses it or is outside. */
+	bool UPxr_QuerySphere(FVector Center, float Radius, bool bIsPlayArea, bool& IsInside, bool& IsIntersecting, float& SurfaceDistance, FVector& ClosestPoint, FVector& ClosestPointNormal);
+
+	/** Queries many points at once, OutResults must hold at least Points.Num() entries. */
+	bool UPxr_QueryPoints(TArrayView<const FVector> Points, bool bIsPlayArea, TArrayView<FPICOXRBoundaryPointResult> OutResults);
+
+	/**
+	 * Cached geometry and its simplified copy in Unreal units, valid until the next revision.
+	 * Consumers keep the revision and only read the geometry again when it changed, or bind to OnGeometryChanged.
+	 */
+	const TArray<FVector>& UPxr_GetGeometryView(bool bIsPlayArea);
+	const TArray<FVector>& UPxr_GetSimplifiedGeometryView(bool bIsPlayArea);
+	uint32 UPxr_GetGeometryRevision(bool bIsPlayArea);
+
+	/** Maximum distance between the geometry and its simplified copy, in Unreal units. */
+	void UPxr_SetSimplifyTolerance(float Tolerance);
+	float UPxr_GetSimplifyTolerance();
+
+	FPICOXROnBoundaryGeometryChanged& OnGeometryChanged() { return GeometryChangedDelegate; }
+
+	/** Drops the cached geometry, the next query or UPxr_GetGeometry fetches it again. */
+	void InvalidateBoundaryCache();
+
+	/** Fetches both boundaries again now and broadcasts the ones that changed. Called on runtime events after which the boundary may have been redrawn. */
+	void RefreshBoundaryGeometry();
+
+	/** Cached geometry of a boundary, fetched on first use after an invalidation. */
+	const FPICOXRBoundaryCache& GetBoundaryCache(bool bIsPlayArea);
+
 	bool UPxr_GetSeeThroughData(int CameraType,UTexture2D* &CameraImage);
 
+	/**
+	 * Latest see-through camera frame of an eye and its frame number, which only changes when the camera delivered a new image.
+	 * @return false until the first frame arrived.
+	 */
+	bool UPxr_GetSeeThroughFrame(int CameraType, UTexture2D*& CameraImage, int64& FrameNumber);
+
+	FPICOXRCameraStream& GetCameraStream() { return CameraStream; }
+
 	bool UPxr_SetCameraImageSize(FIntPoint ImageSize);
 
 	int UPxr_SetSeeThroughBackground(bool value);
 
 private:
-	bool bIsStartCamera;
-	FIntPoint CurrentImageSize;
-	UTexture2D* CameraTextureLeft;
-	UTexture2D* CameraTextureRight;
-	int32_t LeftTextureID;
-	int32_t RightTextureID;
+	static float GetWorldToMetersScale();
+	void UpdateWorldPoints(FPICOXRBoundaryCache& Cache);
+
+	FPICOXROnBoundaryGeometryChanged GeometryChangedDelegate;
+
+	// Outer boundary, then play area.
+	FPICOXRBoundaryCache BoundaryCaches[2];
+
+	FPICOXRCameraStream CameraStream;
 };
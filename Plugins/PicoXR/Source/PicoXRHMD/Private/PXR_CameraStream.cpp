@@ -0,0 +1,467 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_CameraStream.h"
+#include "PXR_BoundarySystem.h"
+#include "PXR_Log.h"
+#include "Engine/Texture2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "XRThreadUtils.h"
+#include "HAL/IConsoleManager.h"
+
+#if PLATFORM_ANDROID
+#include "PxrApi.h"
+#include "PxrTypes.h"
+#endif
+
+namespace
+{
+	class FPICOXRRuntimeCameraSource : public IPICOXRCameraSource
+	{
+	public:
+		virtual void Start() override
+		{
+#if PLATFORM_ANDROID
+			Pxr_StartCameraPreview(1);
+#endif
+		}
+
+		virtual void Stop() override
+		{
+#if PLATFORM_ANDROID
+			Pxr_StartCameraPreview(0);
+#endif
+		}
+
+		virtual bool AcquireFrame(const uint64 TextureIds[2], uint32 Width, uint32 Height, FPICOXRCameraFrameInfo& OutInfo) override
+		{
+#if PLATFORM_ANDROID
+			PxrSeeThoughData SeeThoughData;
+			SeeThoughData.leftEyeTextureId = TextureIds[0];
+			SeeThoughData.rightEyeTextureId = TextureIds[1];
+			SeeThoughData.width = Width;
+			SeeThoughData.height = Height;
+			SeeThoughData.exposure = 0;
+			SeeThoughData.startTimeOfExposure = 0;
+			SeeThoughData.valid = true;
+			const int Result = Pxr_GetSeeThroughData(&SeeThoughData);
+			OutInfo.ExposureTimestamp = SeeThoughData.startTimeOfExposure;
+			OutInfo.Exposure = SeeThoughData.exposure;
+			OutInfo.bValid = Result == 0 && SeeThoughData.valid;
+			return OutInfo.bValid;
+#else
+			OutInfo = FPICOXRCameraFrameInfo();
+			return false;
+#endif
+		}
+
+		virtual void SetImageSize(uint32 Width, uint32 Height) override
+		{
+#if PLATFORM_ANDROID
+			Pxr_SetSeeThroughImageExtent(Width, Height);
+#endif
+		}
+	};
+
+	class FPICOXRFakeCameraSource : public IPICOXRCameraSource
+	{
+	public:
+		FPICOXRFakeCameraSource(int32 InFramePeriod, int32 InInvalidPeriod)
+			: FramePeriod(FMath::Max(InFramePeriod, 1))
+			, InvalidPeriod(InInvalidPeriod)
+			, Acquisitions(0)
+		{
+		}
+
+		virtual void Start() override {}
+		virtual void Stop() override {}
+		virtual void SetImageSize(uint32 Width, uint32 Height) override {}
+
+		virtual bool AcquireFrame(const uint64 TextureIds[2], uint32 Width, uint32 Height, FPICOXRCameraFrameInfo& OutInfo) override
+		{
+			const int32 Acquisition = Acquisitions++;
+			OutInfo.bValid = InvalidPeriod <= 0 || (Acquisition + 1) % InvalidPeriod != 0;
+			// 90Hz exposures, starting at 1 so the timestamps are reported.
+			OutInfo.ExposureTimestamp = 1 + static_cast<int64>(Acquisition / FramePeriod) * 11111111;
+			OutInfo.Exposure = 5000;
+			return OutInfo.bValid;
+		}
+
+	private:
+		int32 FramePeriod;
+		int32 InvalidPeriod;
+		int32 Acquisitions;
+	};
+
+	uint64 GetNativeTextureId(FRHITexture* Texture)
+	{
+		void* NativeResource = Texture ? Texture->GetNativeResource() : nullptr;
+		if (!NativeResource)
+		{
+			return 0;
+		}
+#if ENGINE_MINOR_VERSION > 25
+		return (*static_cast<int32_t*>(NativeResource)) - 1;
+#else
+		return *static_cast<int32_t*>(NativeResource);
+#endif
+	}
+}
+
+TSharedRef<IPICOXRCameraSource, ESPMode::ThreadSafe> IPICOXRCameraSource::CreateDefault()
+{
+	return MakeShared<FPICOXRRuntimeCameraSource, ESPMode::ThreadSafe>();
+}
+
+TSharedRef<IPICOXRCameraSource, ESPMode::ThreadSafe> IPICOXRCameraSource::CreateFake(int32 FramePeriod, int32 InvalidPeriod)
+{
+	return MakeShared<FPICOXRFakeCameraSource, ESPMode::ThreadSafe>(FramePeriod, InvalidPeriod);
+}
+
+FPICOXRCameraFrameRing::FPICOXRCameraFrameRing()
+	: TotalAcquireLatency(0.0)
+	, TotalFrameInterval(0)
+	, FrameIntervals(0)
+	, FrameNumber(0)
+	, LastExposureTimestamp(0)
+	, PublishedSlot(INDEX_NONE)
+	, LastWrittenSlot(INDEX_NONE)
+	, Generation(0)
+	, bInFlight(false)
+{
+}
+
+void FPICOXRCameraFrameRing::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	// Frame numbers keep counting, so consumers holding an older number still see the next frame as new.
+	LastExposureTimestamp = 0;
+	PublishedSlot = INDEX_NONE;
+	LastWrittenSlot = INDEX_NONE;
+	Generation++;
+	bInFlight = false;
+}
+
+FPICOXRCameraFrameRing::FTicket FPICOXRCameraFrameRing::BeginAcquire(double Time)
+{
+	FScopeLock ScopeLock(&Lock);
+	FTicket Ticket;
+	if (bInFlight)
+	{
+		Stats.BusyUpdates++;
+		return Ticket;
+	}
+
+	int32 Slot = (LastWrittenSlot + 1) % PXR_CAMERA_RING_SIZE;
+	if (Slot == PublishedSlot)
+	{
+		Slot = (Slot + 1) % PXR_CAMERA_RING_SIZE;
+	}
+	LastWrittenSlot = Slot;
+	bInFlight = true;
+
+	Ticket.Slot = Slot;
+	Ticket.Generation = Generation;
+	Ticket.RequestTime = Time;
+	return Ticket;
+}
+
+bool FPICOXRCameraFrameRing::EndAcquire(const FTicket& Ticket, const FPICOXRCameraFrameInfo& Info, double Time)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (!Ticket.IsValid() || Ticket.Generation != Generation || !bInFlight)
+	{
+		return false;
+	}
+	bInFlight = false;
+
+	Stats.Acquisitions++;
+	const double Latency = FMath::Max(Time - Ticket.RequestTime, 0.0);
+	TotalAcquireLatency += Latency;
+	Stats.AverageAcquireLatencyMs = static_cast<float>(TotalAcquireLatency * 1000.0 / Stats.Acquisitions);
+	Stats.MaxAcquireLatencyMs = FMath::Max(Stats.MaxAcquireLatencyMs, static_cast<float>(Latency * 1000.0));
+
+	if (!Info.bValid)
+	{
+		Stats.InvalidFrames++;
+		return false;
+	}
+
+	// Without timestamps every valid acquisition counts as a new frame.
+	if (Info.ExposureTimestamp != 0 && LastExposureTimestamp != 0)
+	{
+		if (Info.ExposureTimestamp <= LastExposureTimestamp)
+		{
+			Stats.DuplicateFrames++;
+			return false;
+		}
+		TotalFrameInterval += Info.ExposureTimestamp - LastExposureTimestamp;
+		FrameIntervals++;
+		Stats.AverageFrameIntervalMs = static_cast<float>(static_cast<double>(TotalFrameInterval) / FrameIntervals / 1.0e6);
+	}
+	LastExposureTimestamp = Info.ExposureTimestamp;
+	PublishedSlot = Ticket.Slot;
+	FrameNumber++;
+	Stats.FramesPublished++;
+	return true;
+}
+
+bool FPICOXRCameraFrameRing::GetLatest(int32& OutSlot, uint64& OutFrameNumber) const
+{
+	FScopeLock ScopeLock(&Lock);
+	if (PublishedSlot == INDEX_NONE)
+	{
+		return false;
+	}
+	OutSlot = PublishedSlot;
+	OutFrameNumber = FrameNumber;
+	return true;
+}
+
+FPICOXRCameraStreamStats FPICOXRCameraFrameRing::GetStats() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Stats;
+}
+
+void FPICOXRCameraFrameRing::ResetStats()
+{
+	FScopeLock ScopeLock(&Lock);
+	Stats = FPICOXRCameraStreamStats();
+	TotalAcquireLatency = 0.0;
+	TotalFrameInterval = 0;
+	FrameIntervals = 0;
+}
+
+FPICOXRCameraStream::FPICOXRCameraStream()
+	: Source(IPICOXRCameraSource::CreateDefault())
+	, Ring(MakeShared<FPICOXRCameraFrameRing, ESPMode::ThreadSafe>())
+	, ImageSize(640, 640)
+	, LastUpdateFrame(0)
+	, bStarted(false)
+	, bUpdated(false)
+{
+	FMemory::Memzero(Textures);
+	bEyeEnabled[0] = bEyeEnabled[1] = false;
+}
+
+FPICOXRCameraStream::~FPICOXRCameraStream()
+{
+	if (bStarted)
+	{
+		// The source is only called on the RHI thread, wait for the stop so the camera is off when the stream is gone.
+		Stop();
+		FlushRenderingCommands();
+	}
+}
+
+void FPICOXRCameraStream::SetSource(TSharedPtr<IPICOXRCameraSource, ESPMode::ThreadSafe> InSource)
+{
+	Stop();
+	Source = InSource.IsValid() ? InSource : TSharedPtr<IPICOXRCameraSource, ESPMode::ThreadSafe>(IPICOXRCameraSource::CreateDefault());
+	Ring->Reset();
+}
+
+void FPICOXRCameraStream::SetImageSize(FIntPoint InImageSize)
+{
+	Source->SetImageSize(static_cast<uint32>(InImageSize.X), static_cast<uint32>(InImageSize.Y));
+	if (InImageSize != ImageSize)
+	{
+		ImageSize = InImageSize;
+		// Frames in flight were taken at the old size, the textures are recreated on the next update.
+		Ring->Reset();
+		ReleaseTextures();
+	}
+}
+
+void FPICOXRCameraStream::Start()
+{
+	if (bStarted)
+	{
+		return;
+	}
+	bStarted = true;
+	// Acquisitions are queued behind the start, they just return no frame until the camera delivers one.
+	TSharedPtr<IPICOXRCameraSource, ESPMode::ThreadSafe> StartSource = Source;
+	ExecuteOnRenderThread_DoNotWait([StartSource](FRHICommandListImmediate& RHICmdList)
+	{
+		ExecuteOnRHIThread_DoNotWait([StartSource]()
+		{
+			StartSource->Start();
+		});
+	});
+}
+
+void FPICOXRCameraStream::Stop()
+{
+	if (!bStarted)
+	{
+		return;
+	}
+	bStarted = false;
+	Ring->Reset();
+	TSharedPtr<IPICOXRCameraSource, ESPMode::ThreadSafe> StopSource = Source;
+	ExecuteOnRenderThread_DoNotWait([StopSource](FRHICommandListImmediate& RHICmdList)
+	{
+		ExecuteOnRHIThread_DoNotWait([StopSource]()
+		{
+			StopSource->Stop();
+		});
+	});
+}
+
+void FPICOXRCameraStream::Update(int32 Eye, uint64 EngineFrameNumber)
+{
+	Eye = FMath::Clamp(Eye, 0, 1);
+	if (!bEyeEnabled[Eye])
+	{
+		// The acquisition in flight does not write this eye, wait for the next one.
+		bEyeEnabled[Eye] = true;
+		Ring->Reset();
+	}
+	for (int32 EyeIndex = 0; EyeIndex < 2; EyeIndex++)
+	{
+		if (bEyeEnabled[EyeIndex] && Textures[EyeIndex][0] == nullptr)
+		{
+			CreateTextures(EyeIndex);
+		}
+	}
+	Start();
+
+	if (bUpdated && LastUpdateFrame == EngineFrameNumber)
+	{
+		return;
+	}
+	bUpdated = true;
+	LastUpdateFrame = EngineFrameNumber;
+
+	const FPICOXRCameraFrameRing::FTicket Ticket = Ring->BeginAcquire(FPlatformTime::Seconds());
+	if (!Ticket.IsValid())
+	{
+		return;
+	}
+
+	FTextureResource* Resources[2];
+	for (int32 EyeIndex = 0; EyeIndex < 2; EyeIndex++)
+	{
+		UTexture2D* Texture = Textures[EyeIndex][Ticket.Slot];
+		Resources[EyeIndex] = bEyeEnabled[EyeIndex] && Texture ? Texture->Resource : nullptr;
+	}
+	TSharedPtr<IPICOXRCameraSource, ESPMode::ThreadSafe> AcquireSource = Source;
+	TSharedRef<FPICOXRCameraFrameRing, ESPMode::ThreadSafe> AcquireRing = Ring;
+	const uint32 Width = static_cast<uint32>(ImageSize.X);
+	const uint32 Height = static_cast<uint32>(ImageSize.Y);
+	ExecuteOnRenderThread_DoNotWait([AcquireSource, AcquireRing, Ticket, Resources, Width, Height](FRHICommandListImmediate& RHICmdList)
+	{
+		// The resources are released by render commands queued after this one, the RHI references keep them alive from here.
+		FTextureRHIRef TexturesRHI[2];
+		for (int32 EyeIndex = 0; EyeIndex < 2; EyeIndex++)
+		{
+			if (Resources[EyeIndex])
+			{
+				TexturesRHI[EyeIndex] = Resources[EyeIndex]->TextureRHI;
+			}
+		}
+		ExecuteOnRHIThread_DoNotWait([AcquireSource, AcquireRing, Ticket, TexturesRHI, Width, Height]()
+		{
+			const uint64 TextureIds[2] = { GetNativeTextureId(TexturesRHI[0]), GetNativeTextureId(TexturesRHI[1]) };
+			FPICOXRCameraFrameInfo Info;
+			if (!AcquireSource->AcquireFrame(TextureIds, Width, Height, Info))
+			{
+				Info.bValid = false;
+			}
+			AcquireRing->EndAcquire(Ticket, Info, FPlatformTime::Seconds());
+		});
+	});
+}
+
+bool FPICOXRCameraStream::GetLatestFrame(int32 Eye, UTexture2D*& OutTexture, uint64& OutFrameNumber) const
+{
+	Eye = FMath::Clamp(Eye, 0, 1);
+	int32 Slot = INDEX_NONE;
+	uint64 FrameNumber = 0;
+	if (!bEyeEnabled[Eye] || !Ring->GetLatest(Slot, FrameNumber) || Textures[Eye][Slot] == nullptr)
+	{
+		return false;
+	}
+	OutTexture = Textures[Eye][Slot];
+	OutFrameNumber = FrameNumber;
+	return true;
+}
+
+void FPICOXRCameraStream::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (int32 Eye = 0; Eye < 2; Eye++)
+	{
+		for (int32 Slot = 0; Slot < PXR_CAMERA_RING_SIZE; Slot++)
+		{
+			if (Textures[Eye][Slot])
+			{
+				Collector.AddReferencedObject(Textures[Eye][Slot]);
+			}
+		}
+	}
+}
+
+void FPICOXRCameraStream::CreateTextures(int32 Eye)
+{
+	for (int32 Slot = 0; Slot < PXR_CAMERA_RING_SIZE; Slot++)
+	{
+		UTexture2D* Texture = UTexture2D::CreateTransient(ImageSize.X, ImageSize.Y, EPixelFormat::PF_R8G8B8A8);
+		check(Texture);
+		Texture->UpdateResource();
+		Textures[Eye][Slot] = Texture;
+	}
+	PXR_LOGI(PxrUnreal, "Created see-through camera textures, Eye:%d Size:%dx%d", Eye, ImageSize.X, ImageSize.Y);
+}
+
+void FPICOXRCameraStream::ReleaseTextures()
+{
+	for (int32 Eye = 0; Eye < 2; Eye++)
+	{
+		for (int32 Slot = 0; Slot < PXR_CAMERA_RING_SIZE; Slot++)
+		{
+			if (Textures[Eye][Slot])
+			{
+				Textures[Eye][Slot]->ReleaseResource();
+				Textures[Eye][Slot] = nullptr;
+			}
+		}
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+namespace PICOXRCameraStreamCommands
+{
+	static void UseFakeSource(const TArray<FString>& Args)
+	{
+		const bool bFake = Args.Num() == 0 || FCString::Atoi(*Args[0]) != 0;
+		FPICOXRCameraStream& Stream = UPICOXRBoundarySystem::GetInstance()->GetCameraStream();
+		Stream.SetSource(bFake ? IPICOXRCameraSource::CreateFake(1, 0) : TSharedPtr<IPICOXRCameraSource, ESPMode::ThreadSafe>());
+		PXR_LOGI(PxrUnreal, "See-through camera fake source:%d", bFake);
+	}
+
+	static void LogStats(const TArray<FString>& Args)
+	{
+		FPICOXRCameraStream& Stream = UPICOXRBoundarySystem::GetInstance()->GetCameraStream();
+		const FPICOXRCameraStreamStats Stats = Stream.GetStats();
+		PXR_LOGI(PxrUnreal, "See-through camera: published %llu acquisitions %llu duplicate %llu invalid %llu busy %llu, acquire latency avg %.2fms max %.2fms, frame interval %.2fms",
+			Stats.FramesPublished, Stats.Acquisitions, Stats.DuplicateFrames, Stats.InvalidFrames, Stats.BusyUpdates,
+			Stats.AverageAcquireLatencyMs, Stats.MaxAcquireLatencyMs, Stats.AverageFrameIntervalMs);
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			Stream.ResetStats();
+		}
+	}
+
+	static FAutoConsoleCommand UseFakeSourceCommand(
+		TEXT("pxr.SeeThrough.UseFakeSource"),
+		TEXT("Feeds the see-through camera stream from a fake camera delivering a frame per update. Usage: pxr.SeeThrough.UseFakeSource [0/1]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&UseFakeSource));
+
+	static FAutoConsoleCommand LogStatsCommand(
+		TEXT("pxr.SeeThrough.Stats"),
+		TEXT("Logs the see-through camera stream latency and frame statistics. Usage: pxr.SeeThrough.Stats [reset]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&LogStats));
+}
+#endif
@@ -0,0 +1,160 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+
+class UTexture2D;
+
+// Textures per eye the camera writes into in turn, the latest frame stays readable while the next one is acquired.
+#define PXR_CAMERA_RING_SIZE 3
+
+/** What the camera reported for one acquisition. */
+struct FPICOXRCameraFrameInfo
+{
+	// Start of exposure in nanoseconds, 0 when the source does not report it.
+	int64 ExposureTimestamp = 0;
+	uint32 Exposure = 0;
+	bool bValid = false;
+};
+
+/** Source of see-through camera frames. The default one calls the runtime, a fake can be set on the stream instead. */
+class IPICOXRCameraSource
+{
+public:
+	virtual ~IPICOXRCameraSource() {}
+
+	// Called on the RHI thread, in the order they were requested.
+	virtual void Start() = 0;
+	virtual void Stop() = 0;
+	/** Writes the current camera image into the native textures, a texture id of 0 skips that eye. */
+	virtual bool AcquireFrame(const uint64 TextureIds[2], uint32 Width, uint32 Height, FPICOXRCameraFrameInfo& OutInfo) = 0;
+
+	// Game thread.
+	virtual void SetImageSize(uint32 Width, uint32 Height) = 0;
+
+	/** Runtime backed source, delivers no frames on platforms without the runtime. */
+	static TSharedRef<IPICOXRCameraSource, ESPMode::ThreadSafe> CreateDefault();
+
+	/** Delivers a new exposure every FramePeriod acquisitions and no frame every InvalidPeriod acquisitions, writes nothing. */
+	static TSharedRef<IPICOXRCameraSource, ESPMode::ThreadSafe> CreateFake(int32 FramePeriod, int32 InvalidPeriod = 0);
+};
+
+struct FPICOXRCameraStreamStats
+{
+	uint64 FramesPublished = 0;
+	uint64 Acquisitions = 0;
+	// Acquisitions that returned the frame already published, or no frame at all.
+	uint64 DuplicateFrames = 0;
+	uint64 InvalidFrames = 0;
+	// Updates that found the previous acquisition still in flight.
+	uint64 BusyUpdates = 0;
+	// Time from the request on the game thread to the end of the acquisition on the RHI thread.
+	float AverageAcquireLatencyMs = 0.0f;
+	float MaxAcquireLatencyMs = 0.0f;
+	// Exposure time between consecutive published frames, 0 while the source reports no timestamps.
+	float AverageFrameIntervalMs = 0.0f;
+};
+
+/**
+ * Sequencing of the camera texture ring, without any texture or thread of its own.
+ * One acquisition is in flight at a time and never writes the published slot. Frames are numbered from 1
+ * and only published when the camera reports a new exposure. Begin on the game thread, end on any thread.
+ */
+class FPICOXRCameraFrameRing
+{
+public:
+	struct FTicket
+	{
+		int32 Slot = INDEX_NONE;
+		uint32 Generation = 0;
+		double RequestTime = 0.0;
+
+		bool IsValid() const { return Slot != INDEX_NONE; }
+	};
+
+	FPICOXRCameraFrameRing();
+
+	/** Forgets the published frame and any acquisition in flight, whose end is then ignored. Stats are kept. */
+	void Reset();
+
+	/** Reserves the slot to acquire into, the ticket is invalid while the previous acquisition is in flight. */
+	FTicket BeginAcquire(double Time);
+
+	/** @return true if the acquisition published a new frame. */
+	bool EndAcquire(const FTicket& Ticket, const FPICOXRCameraFrameInfo& Info, double Time);
+
+	/** @return false until the first frame is published. */
+	bool GetLatest(int32& OutSlot, uint64& OutFrameNumber) const;
+
+	FPICOXRCameraStreamStats GetStats() const;
+	void ResetStats();
+
+private:
+	mutable FCriticalSection Lock;
+	FPICOXRCameraStreamStats Stats;
+	double TotalAcquireLatency;
+	int64 TotalFrameInterval;
+	uint64 FrameIntervals;
+	uint64 FrameNumber;
+	int64 LastExposureTimestamp;
+	int32 PublishedSlot;
+	int32 LastWrittenSlot;
+	uint32 Generation;
+	bool bInFlight;
+};
+
+/**
+ * See-through camera stream writing into a small ring of persistent textures per eye.
+ * Starting the camera does not block, and the runtime is asked for a frame at most once per engine frame.
+ * Game thread only.
+ */
+class FPICOXRCameraStream : public FGCObject
+{
+public:
+	FPICOXRCameraStream();
+	virtual ~FPICOXRCameraStream();
+
+	/** Replaces the camera source, nullptr restores the default runtime. Stops the camera. */
+	void SetSource(TSharedPtr<IPICOXRCameraSource, ESPMode::ThreadSafe> InSource);
+
+	void SetImageSize(FIntPoint InImageSize);
+	FIntPoint GetImageSize() const { return ImageSize; }
+
+	void Start();
+	void Stop();
+	bool IsStarted() const { return bStarted; }
+
+	/** Starts the camera if needed and requests a frame for Eye, further calls in the same engine frame request nothing. */
+	void Update(int32 Eye, uint64 EngineFrameNumber);
+
+	/**
+	 * Texture of the latest frame of Eye and its frame number, consumers only need to update when the number changes.
+	 * @return false until the first frame is published.
+	 */
+	bool GetLatestFrame(int32 Eye, UTexture2D*& OutTexture, uint64& OutFrameNumber) const;
+
+	/** Texture the camera writes first, shown until the first frame is published. */
+	UTexture2D* GetFallbackTexture(int32 Eye) const { return Textures[Eye][0]; }
+
+	FPICOXRCameraStreamStats GetStats() const { return Ring->GetStats(); }
+	void ResetStats() { Ring->ResetStats(); }
+
+	//~ FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FPICOXRCameraStream"); }
+
+private:
+	void CreateTextures(int32 Eye);
+	void ReleaseTextures();
+
+	TSharedPtr<IPICOXRCameraSource, ESPMode::ThreadSafe> Source;
+	// Shared with the acquisitions in flight, which may end after the stream is gone.
+	TSharedRef<FPICOXRCameraFrameRing, ESPMode::ThreadSafe> Ring;
+	UTexture2D* Textures[2][PXR_CAMERA_RING_SIZE];
+	FIntPoint ImageSize;
+	uint64 LastUpdateFrame;
+	bool bEyeEnabled[2];
+	bool bStarted;
+	bool bUpdated;
+};
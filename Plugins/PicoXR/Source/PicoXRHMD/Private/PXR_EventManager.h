@@ -16,8 +16,12 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPXRResume);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPXRIpdChanged,float,NewIpd);
 //SystemDisplayRateDelegate
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPXRRefreshRateChanged, float, NewRate);
+//BoundaryDelegate
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FPXRBoundaryGeometryChanged, bool, bIsPlayArea, int32, Revision, const TArray<FVector>&, Geometry);
+//DirectPreviewDelegate, State 0 disconnected, 1 connecting, 2 registering, 3 connected, 4 waiting to reconnect
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPXRDirectPreviewConnectionChanged, int32, State);
 UCLASS()
-class UPICOXREventManager : public UObject
+class PICOXRHMD_API UPICOXREventManager : public UObject
 {
 	GENERATED_BODY()
 public:
@@ -44,4 +48,10 @@ public:
 
 	UPROPERTY(BlueprintAssignable)
 	FPXRInputDeviceChangedDelegate InputDeviceChangedDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FPXRBoundaryGeometryChanged BoundaryGeometryChangedDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FPXRDirectPreviewConnectionChanged DirectPreviewConnectionChangedDelegate;
 };
@@ -0,0 +1,229 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_EyeFaceSampler.h"
+#include "PXR_EyeTracker.h"
+
+#if PLATFORM_ANDROID
+#include "PxrApi.h"
+
+static_assert(sizeof(FPICOXRRawEyeTrackingData) == sizeof(PxrEyeTrackingData), "FPICOXRRawEyeTrackingData must match PxrEyeTrackingData");
+static_assert(STRUCT_OFFSET(FPICOXRRawEyeTrackingData, foveatedGazeTrackingState) == STRUCT_OFFSET(PxrEyeTrackingData, foveatedGazeTrackingState), "FPICOXRRawEyeTrackingData must match PxrEyeTrackingData");
+static_assert(sizeof(FPICOXRRawFaceTrackingData) == sizeof(PxrFTInfo), "FPICOXRRawFaceTrackingData must match PxrFTInfo");
+static_assert(PXR_BLEND_SHAPE_NUM == BLEND_SHAPE_NUMS, "PXR_BLEND_SHAPE_NUM must match BLEND_SHAPE_NUMS");
+#endif
+
+namespace
+{
+	class FPICOXREyeFaceRuntime : public IPICOXREyeFaceRuntime
+	{
+	public:
+		virtual bool GetEyeTrackingData(FPICOXRRawEyeTrackingData& OutData) override
+		{
+#if PLATFORM_ANDROID
+			return Pxr_GetEyeTrackingData(reinterpret_cast<PxrEyeTrackingData*>(&OutData)) == 0;
+#else
+			return false;
+#endif
+		}
+
+		virtual bool GetFaceTrackingData(int64 Ts, int32 Flags, FPICOXRRawFaceTrackingData& OutData) override
+		{
+#if PLATFORM_ANDROID
+			return Pxr_GetFaceTrackingData(Ts, Flags, reinterpret_cast<PxrFTInfo*>(&OutData)) == 0;
+#else
+			return false;
+#endif
+		}
+	};
+}
+
+TSharedRef<IPICOXREyeFaceRuntime> IPICOXREyeFaceRuntime::CreateDefault()
+{
+	return MakeShared<FPICOXREyeFaceRuntime>();
+}
+
+FPICOXREyeFaceSample::FPICOXREyeFaceSample()
+	: GazeOrigin(FVector::ZeroVector)
+	, GazeDirection(FVector::ZeroVector)
+	, GazeConfidence(0.0f)
+	, FaceTimestamp(0)
+	, SampleTime(0.0)
+	, FrameNumber(0)
+	, bEyeValid(false)
+	, bFaceValid(false)
+{
+	FMemory::Memzero(Eye);
+	FMemory::Memzero(BlendShapes);
+}
+
+FPICOXREyeFaceSampler::FPICOXREyeFaceSampler()
+	: Runtime(IPICOXREyeFaceRuntime::CreateDefault())
+	, Head(0)
+	, HistoryNum(0)
+	, HistoryLength(1)
+	, FaceDataFlags(0)
+	, LastFrameNumber(0)
+	, bHasSampled(false)
+	, RuntimeQueryCount(0)
+{
+}
+
+void FPICOXREyeFaceSampler::SetRuntime(TSharedPtr<IPICOXREyeFaceRuntime> InRuntime)
+{
+	Runtime = InRuntime.IsValid() ? InRuntime : TSharedPtr<IPICOXREyeFaceRuntime>(IPICOXREyeFaceRuntime::CreateDefault());
+	Reset();
+}
+
+void FPICOXREyeFaceSampler::SetHistoryLength(int32 Length)
+{
+	HistoryLength = FMath::Clamp(Length, 1, PXR_EYE_FACE_HISTORY_MAX);
+	Reset();
+}
+
+void FPICOXREyeFaceSampler::Reset()
+{
+	for (FPICOXREyeFaceSample& Sample : Samples)
+	{
+		Sample = FPICOXREyeFaceSample();
+	}
+	Head = 0;
+	HistoryNum = 0;
+	LastFrameNumber = 0;
+	bHasSampled = false;
+}
+
+bool FPICOXREyeFaceSampler::Sample(uint64 FrameNumber, double Time, bool bSampleEye, bool bSampleFace)
+{
+	if (bHasSampled && FrameNumber == LastFrameNumber)
+	{
+		return false;
+	}
+	bHasSampled = true;
+	LastFrameNumber = FrameNumber;
+
+	Head = (Head + 1) % HistoryLength;
+	HistoryNum = FMath::Min(HistoryNum + 1, HistoryLength);
+	FPICOXREyeFaceSample& Sample = Samples[Head];
+	Sample.FrameNumber = FrameNumber;
+	Sample.SampleTime = Time;
+
+	FPICOXRRawEyeTrackingData RawEye;
+	Sample.bEyeValid = false;
+	if (bSampleEye)
+	{
+		RuntimeQueryCount++;
+		Sample.bEyeValid = Runtime->GetEyeTrackingData(RawEye);
+	}
+	if (Sample.bEyeValid)
+	{
+		ConvertEyeTrackingData(RawEye, Sample.Eye);
+		Sample.GazeOrigin = Sample.Eye.CombinedEyeGazePoint;
+		Sample.GazeDirection = Sample.Eye.CombinedEyeGazeVector;
+		Sample.GazeConfidence = ComputeGazeConfidence(Sample.Eye);
+	}
+	else
+	{
+		FMemory::Memzero(Sample.Eye);
+		Sample.GazeOrigin = FVector::ZeroVector;
+		Sample.GazeDirection = FVector::ZeroVector;
+		Sample.GazeConfidence = 0.0f;
+	}
+
+	FPICOXRRawFaceTrackingData RawFace;
+	Sample.bFaceValid = false;
+	if (bSampleFace)
+	{
+		RuntimeQueryCount++;
+		Sample.bFaceValid = Runtime->GetFaceTrackingData(0, FaceDataFlags, RawFace);
+	}
+	if (Sample.bFaceValid)
+	{
+		FMemory::Memcpy(Sample.BlendShapes, RawFace.blendShapeWeight, sizeof(Sample.BlendShapes));
+		Sample.FaceTimestamp = RawFace.timestamp;
+	}
+	else
+	{
+		FMemory::Memzero(Sample.BlendShapes);
+		Sample.FaceTimestamp = 0;
+	}
+	return true;
+}
+
+bool FPICOXREyeFaceSampler::QueryFaceTrackingData(int64 Ts, int32 Flags, FPICOXREyeFaceSample& OutSample)
+{
+	FPICOXRRawFaceTrackingData RawFace;
+	RuntimeQueryCount++;
+	OutSample.bFaceValid = Runtime->GetFaceTrackingData(Ts, Flags, RawFace);
+	if (OutSample.bFaceValid)
+	{
+		FMemory::Memcpy(OutSample.BlendShapes, RawFace.blendShapeWeight, sizeof(OutSample.BlendShapes));
+		OutSample.FaceTimestamp = RawFace.timestamp;
+	}
+	return OutSample.bFaceValid;
+}
+
+const FPICOXREyeFaceSample& FPICOXREyeFaceSampler::GetHistory(int32 Age) const
+{
+	check(Age >= 0 && Age < HistoryLength);
+	return Samples[(Head - Age + HistoryLength) % HistoryLength];
+}
+
+bool FPICOXREyeFaceSampler::GetFilteredGazeDirection(int32 MaxAge, FVector& OutDirection) const
+{
+	const int32 Count = FMath::Min(MaxAge + 1, HistoryNum);
+	FVector Sum = FVector::ZeroVector;
+	float WeightSum = 0.0f;
+	for (int32 Age = 0; Age < Count; Age++)
+	{
+		const FPICOXREyeFaceSample& Sample = GetHistory(Age);
+		if (Sample.GazeConfidence > 0.0f)
+		{
+			Sum += Sample.GazeDirection * Sample.GazeConfidence;
+			WeightSum += Sample.GazeConfidence;
+		}
+	}
+	if (WeightSum <= 0.0f)
+	{
+		return false;
+	}
+	OutDirection = Sum.GetSafeNormal();
+	return !OutDirection.IsZero();
+}
+
+void FPICOXREyeFaceSampler::ConvertEyeTrackingData(const FPICOXRRawEyeTrackingData& Raw, FPICOXREyeTrackingData& Out)
+{
+	Out.LeftEyePoseStatus = Raw.leftEyePoseStatus;
+	Out.RightEyePoseStatus = Raw.rightEyePoseStatus;
+	Out.CombinedEyePoseStatus = Raw.combinedEyePoseStatus;
+	Out.LeftEyeGazePoint = FVector(Raw.leftEyeGazePoint[0], Raw.leftEyeGazePoint[1], Raw.leftEyeGazePoint[2]);
+	Out.RightEyeGazePoint = FVector(Raw.rightEyeGazePoint[0], Raw.rightEyeGazePoint[1], Raw.rightEyeGazePoint[2]);
+	Out.CombinedEyeGazePoint = FVector(Raw.combinedEyeGazePoint[0], Raw.combinedEyeGazePoint[1], Raw.combinedEyeGazePoint[2]);
+	Out.LeftEyeGazeVector = FVector(Raw.leftEyeGazeVector[0], Raw.leftEyeGazeVector[1], Raw.leftEyeGazeVector[2]);
+	Out.RightEyeGazeVector = FVector(Raw.rightEyeGazeVector[0], Raw.rightEyeGazeVector[1], Raw.rightEyeGazeVector[2]);
+	Out.CombinedEyeGazeVector = FVector(Raw.combinedEyeGazeVector[0], Raw.combinedEyeGazeVector[1], Raw.combinedEyeGazeVector[2]);
+	Out.LeftEyeOpenness = Raw.leftEyeOpenness;
+	Out.RightEyeOpenness = Raw.rightEyeOpenness;
+	Out.LeftEyePupilDilation = Raw.leftEyePupilDilation;
+	Out.RightEyePupilDilation = Raw.rightEyePupilDilation;
+	Out.LeftEyePositionGuide = FVector(Raw.leftEyePositionGuide[0], Raw.leftEyePositionGuide[1], Raw.leftEyePositionGuide[2]);
+	Out.RightEyePositionGuide = FVector(Raw.rightEyePositionGuide[0], Raw.rightEyePositionGuide[1], Raw.rightEyePositionGuide[2]);
+	Out.FoveatedGazeDirection = FVector(Raw.foveatedGazeDirection[0], Raw.foveatedGazeDirection[1], Raw.foveatedGazeDirection[2]);
+	Out.FoveatedGazeTrackingState = Raw.foveatedGazeTrackingState;
+}
+
+float FPICOXREyeFaceSampler::ComputeGazeConfidence(const FPICOXREyeTrackingData& Eye)
+{
+	const int32 GazeValid = kGazePointValid | kGazeVectorValid;
+	if ((Eye.CombinedEyePoseStatus & GazeValid) != GazeValid)
+	{
+		return 0.0f;
+	}
+	const bool bLeftOpenness = (Eye.LeftEyePoseStatus & kEyeOpennessValid) != 0;
+	const bool bRightOpenness = (Eye.RightEyePoseStatus & kEyeOpennessValid) != 0;
+	if (!bLeftOpenness && !bRightOpenness)
+	{
+		return 1.0f;
+	}
+	const float Openness = FMath::Max(bLeftOpenness ? Eye.LeftEyeOpenness : 0.0f, bRightOpenness ? Eye.RightEyeOpenness : 0.0f);
+	return FMath::Clamp(Openness, 0.0f, 1.0f);
+}
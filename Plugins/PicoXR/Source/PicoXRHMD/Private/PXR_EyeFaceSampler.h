@@ -0,0 +1,170 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "PXR_HMDFunctionLibrary.h"
+
+#ifndef PXR_BLEND_SHAPE_NUM
+#define PXR_BLEND_SHAPE_NUM 72
+#endif
+
+// Blend shapes exposed as weights, the rest of PXR_BLEND_SHAPE_NUM is reserved by the runtime.
+#define PXR_BLEND_SHAPE_WEIGHT_NUM 52
+#define PXR_BLEND_SHAPE_RESERVED_NUM (PXR_BLEND_SHAPE_NUM - PXR_BLEND_SHAPE_WEIGHT_NUM)
+
+// Capacity of the sample history, the active length is set with FPICOXREyeFaceSampler::SetHistoryLength.
+#define PXR_EYE_FACE_HISTORY_MAX 32
+
+/** Same layout as PxrEyeTrackingData, so the sampler can be fed off-device. */
+struct FPICOXRRawEyeTrackingData
+{
+	int32 leftEyePoseStatus;
+	int32 rightEyePoseStatus;
+	int32 combinedEyePoseStatus;
+	float leftEyeGazePoint[3];
+	float rightEyeGazePoint[3];
+	float combinedEyeGazePoint[3];
+	float leftEyeGazeVector[3];
+	float rightEyeGazeVector[3];
+	float combinedEyeGazeVector[3];
+	float leftEyeOpenness;
+	float rightEyeOpenness;
+	float leftEyePupilDilation;
+	float rightEyePupilDilation;
+	float leftEyePositionGuide[3];
+	float rightEyePositionGuide[3];
+	float foveatedGazeDirection[3];
+	int32 foveatedGazeTrackingState;
+};
+
+/** Same layout as PxrFTInfo. */
+struct FPICOXRRawFaceTrackingData
+{
+	int64 timestamp;
+	float blendShapeWeight[PXR_BLEND_SHAPE_NUM];
+	float videoInputValid[10];
+	float laughingProb;
+	float emotionProb[10];
+	float reserved[128];
+};
+
+/** Source of eye and face tracking data. The default one calls the runtime, a mock can be set on the sampler instead. */
+class IPICOXREyeFaceRuntime
+{
+public:
+	virtual ~IPICOXREyeFaceRuntime() {}
+
+	virtual bool GetEyeTrackingData(FPICOXRRawEyeTrackingData& OutData) = 0;
+	virtual bool GetFaceTrackingData(int64 Ts, int32 Flags, FPICOXRRawFaceTrackingData& OutData) = 0;
+
+	/** Runtime backed source, returns no data on platforms without the runtime. */
+	static TSharedRef<IPICOXREyeFaceRuntime> CreateDefault();
+};
+
+/** Eye and face tracking data of one frame. */
+struct FPICOXREyeFaceSample
+{
+	FPICOXREyeFaceSample();
+
+	FPICOXREyeTrackingData Eye;
+	float BlendShapes[PXR_BLEND_SHAPE_NUM];
+
+	// Combined gaze in the runtime's head space, see FPICOXREyeTracker::GetEyeTrackingGazeRay for the world space ray.
+	FVector GazeOrigin;
+	FVector GazeDirection;
+	// 0 when the combined gaze is not valid, otherwise the openness of the more open eye (1 if openness is not reported).
+	float GazeConfidence;
+
+	// Timestamp reported by the face tracking runtime.
+	int64 FaceTimestamp;
+	// FPlatformTime::Seconds when the sample was taken.
+	double SampleTime;
+	uint64 FrameNumber;
+	bool bEyeValid;
+	bool bFaceValid;
+
+	FORCEINLINE TArrayView<const float> GetBlendShapeWeights() const
+	{
+		return TArrayView<const float>(BlendShapes, PXR_BLEND_SHAPE_WEIGHT_NUM);
+	}
+
+	FORCEINLINE TArrayView<const float> GetBlendShapeReserved() const
+	{
+		return TArrayView<const float>(BlendShapes + PXR_BLEND_SHAPE_WEIGHT_NUM, PXR_BLEND_SHAPE_RESERVED_NUM);
+	}
+};
+
+/**
+ * Queries the runtime at most once per frame and keeps the results in a fixed size ring.
+ * Consumers read the latest sample or the history by reference, nothing is allocated after construction.
+ * Game thread only.
+ */
+class FPICOXREyeFaceSampler : public FNoncopyable
+{
+public:
+	FPICOXREyeFaceSampler();
+
+	/** Replaces the data source, nullptr restores the default runtime. Clears the history. */
+	void SetRuntime(TSharedPtr<IPICOXREyeFaceRuntime> InRuntime);
+
+	/** Number of samples kept, clamped to [1, PXR_EYE_FACE_HISTORY_MAX]. Clears the history. */
+	void SetHistoryLength(int32 Length);
+	int32 GetHistoryLength() const { return HistoryLength; }
+
+	/** Flags passed to the face tracking query, see GetDataType in PxrTypes.h. */
+	void SetFaceDataFlags(int32 Flags) { FaceDataFlags = Flags; }
+	int32 GetFaceDataFlags() const { return FaceDataFlags; }
+
+	/**
+	 * Takes the sample of FrameNumber. Further calls with the same frame number do not query the runtime again.
+	 * @return true if a new sample was taken.
+	 */
+	bool Sample(uint64 FrameNumber, double Time, bool bSampleEye, bool bSampleFace);
+
+	/**
+	 * Queries face data outside of the per frame sample, for callers asking for another timestamp or other flags.
+	 * Only the face fields of OutSample are written.
+	 */
+	bool QueryFaceTrackingData(int64 Ts, int32 Flags, FPICOXREyeFaceSample& OutSample);
+
+	/** Drops all samples, GetLatest returns an empty sample afterwards. */
+	void Reset();
+
+	/** Latest sample, empty until the first Sample. */
+	FORCEINLINE const FPICOXREyeFaceSample& GetLatest() const
+	{
+		return Samples[Head];
+	}
+
+	/** Number of valid samples in the history. */
+	int32 GetHistoryNum() const { return HistoryNum; }
+
+	/** Sample taken Age samples ago, 0 is the latest. */
+	const FPICOXREyeFaceSample& GetHistory(int32 Age) const;
+
+	/**
+	 * Confidence weighted mean of the gaze direction over the last MaxAge + 1 samples, skipping samples without valid gaze.
+	 * @return false if none of these samples has a valid gaze.
+	 */
+	bool GetFilteredGazeDirection(int32 MaxAge, FVector& OutDirection) const;
+
+	/** Number of runtime queries made so far, eye and face counted separately. */
+	uint32 GetRuntimeQueryCount() const { return RuntimeQueryCount; }
+
+	/** Fills the Blueprint facing eye tracking data from the runtime layout. */
+	static void ConvertEyeTrackingData(const FPICOXRRawEyeTrackingData& Raw, FPICOXREyeTrackingData& Out);
+
+	/** Gaze confidence of an eye tracking sample, see FPICOXREyeFaceSample::GazeConfidence. */
+	static float ComputeGazeConfidence(const FPICOXREyeTrackingData& Eye);
+
+private:
+	TSharedPtr<IPICOXREyeFaceRuntime> Runtime;
+	FPICOXREyeFaceSample Samples[PXR_EYE_FACE_HISTORY_MAX];
+	int32 Head;
+	int32 HistoryNum;
+	int32 HistoryLength;
+	int32 FaceDataFlags;
+	uint64 LastFrameNumber;
+	bool bHasSampled;
+	uint32 RuntimeQueryCount;
+};
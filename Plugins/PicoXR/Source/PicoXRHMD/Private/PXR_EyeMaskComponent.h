@@ -3,6 +3,7 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "ProceduralMeshComponent.h"
+#include "PXR_StencilMeshCache.h"
 #include "PXR_EyeMaskComponent.generated.h"
 
 UCLASS( ClassGroup=(PXRComponent), meta=(BlueprintSpawnableComponent) )
@@ -33,25 +34,8 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Default)
 	bool UseEyeSpecifiedMesh;
 
-public:
-	class EyeMaskData
-	{
-	public:
-		int VertexFloatCount;
-		int IndexIntCount;
-		float * Vertices;
-		int * Indices;
-	};
-
 private:
-	int VertexCountLeft, TriangleCountLeft; // Left
-	float* VertexDataLeft;
-	int* IndexDataLeft;
-
-	int VertexCountRight, TriangleCountRight; // Right
-	float* VertexDataRight;
-	int* IndexDataRight;
-	bool GetStencilMeshData();
+	// Debug meshes in the editor or when asked for, the runtime one otherwise.
+	EPICOXRStencilMeshType GetStencilMeshType() const;
 	void CreateStencilMesh();
-	EyeMaskData GetEyeMaskData(int Eye);
 };
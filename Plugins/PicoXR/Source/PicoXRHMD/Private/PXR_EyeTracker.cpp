@@ -1,6 +1,7 @@
 //Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
 
 #include "PXR_EyeTracker.h"
+#include "PXR_FoveationController.h"
 #include "DrawDebugHelpers.h"
 #include "PXR_Settings.h"
 #include "Engine/Engine.h"
@@ -17,7 +18,6 @@ FPICOXREyeTracker::FPICOXREyeTracker()
     :bEyeTrackingRun(false)
     ,bFaceTrackingRun(false)
 {
-    FMemory::Memzero(TrackerData);
 }
 
 FPICOXREyeTracker::~FPICOXREyeTracker()
@@ -26,17 +26,29 @@ FPICOXREyeTracker::~FPICOXREyeTracker()
 
 bool FPICOXREyeTracker::Tick(float DeltaTime)
 {
-    if (bEyeTrackingRun)
+    SampleFrame();
+    return true;
+}
+
+void FPICOXREyeTracker::SampleFrame()
+{
+    if (bEyeTrackingRun || bFaceTrackingRun)
     {
-        GetEyeTrackingDataFromDevice(TrackerData);
+        Sampler.Sample(GFrameCounter, FPlatformTime::Seconds(), bEyeTrackingRun, bFaceTrackingRun);
     }
-    return true;
 }
 
 
 bool FPICOXREyeTracker::GetEyeTrackerGazeData(FEyeTrackerGazeData& OutGazeData) const
 {
-    //TODO: return  GazeData
+    FPICOXREyeTrackingGazeRay GazeRay;
+    if (bEyeTrackingRun && GetEyeTrackingGazeRay(GazeRay))
+    {
+        OutGazeData.GazeOrigin = GazeRay.Origin;
+        OutGazeData.GazeDirection = GazeRay.Direction;
+        OutGazeData.ConfidenceValue = Sampler.GetLatest().GazeConfidence;
+        return true;
+    }
     return false;
 }
 
@@ -50,6 +62,7 @@ EEyeTrackerStatus FPICOXREyeTracker::GetEyeTrackerStatus() const
 {
     if (bEyeTrackingRun)
     {
+        const FPICOXREyeTrackingData& TrackerData = Sampler.GetLatest().Eye;
         if (TrackerData.LeftEyeOpenness == 1 ||TrackerData.RightEyeOpenness == 1)
         {
             return EEyeTrackerStatus::Tracking;
@@ -88,66 +101,19 @@ bool FPICOXREyeTracker::UPxr_GetEyeTrackingData(FPICOXREyeTrackingData& OutTrack
 {
     if (bEyeTrackingRun)
     {
-        OutTrackingData = TrackerData;
+        OutTrackingData = Sampler.GetLatest().Eye;
         return true;
     }
     return false;
 }
 
-bool FPICOXREyeTracker::GetEyeTrackingDataFromDevice(FPICOXREyeTrackingData& TrackingData)
-{
-    if (bEyeTrackingRun)
-    {
-#if  PLATFORM_ANDROID
-        PxrEyeTrackingData eyeTrackingData;
-        Pxr_GetEyeTrackingData(&eyeTrackingData);
-
-        TrackingData.LeftEyePoseStatus = eyeTrackingData.leftEyePoseStatus;
-        TrackingData.RightEyePoseStatus = eyeTrackingData.rightEyePoseStatus;
-        TrackingData.CombinedEyePoseStatus = eyeTrackingData.combinedEyePoseStatus;
-        TrackingData.LeftEyeGazePoint.X = eyeTrackingData.leftEyeGazePoint[0];
-        TrackingData.LeftEyeGazePoint.Y = eyeTrackingData.leftEyeGazePoint[1];
-        TrackingData.LeftEyeGazePoint.Z = eyeTrackingData.leftEyeGazePoint[2];
-        TrackingData.RightEyeGazePoint.X = eyeTrackingData.rightEyeGazePoint[0];
-        TrackingData.RightEyeGazePoint.Y = eyeTrackingData.rightEyeGazePoint[1];
-        TrackingData.RightEyeGazePoint.Z = eyeTrackingData.rightEyeGazePoint[2];
-        TrackingData.CombinedEyeGazePoint.X = eyeTrackingData.combinedEyeGazePoint[0];
-        TrackingData.CombinedEyeGazePoint.Y = eyeTrackingData.combinedEyeGazePoint[1];
-        TrackingData.CombinedEyeGazePoint.Z = eyeTrackingData.combinedEyeGazePoint[2];
-        TrackingData.LeftEyeGazeVector.X = eyeTrackingData.leftEyeGazeVector[0];
-        TrackingData.LeftEyeGazeVector.Y = eyeTrackingData.leftEyeGazeVector[1];
-        TrackingData.LeftEyeGazeVector.Z = eyeTrackingData.leftEyeGazeVector[2];
-        TrackingData.RightEyeGazeVector.X = eyeTrackingData.rightEyeGazeVector[0];
-        TrackingData.RightEyeGazeVector.Y = eyeTrackingData.rightEyeGazeVector[1];
-        TrackingData.RightEyeGazeVector.Z = eyeTrackingData.rightEyeGazeVector[2];
-        TrackingData.CombinedEyeGazeVector.X = eyeTrackingData.combinedEyeGazeVector[0];
-        TrackingData.CombinedEyeGazeVector.Y = eyeTrackingData.combinedEyeGazeVector[1];
-        TrackingData.CombinedEyeGazeVector.Z = eyeTrackingData.combinedEyeGazeVector[2];
-        TrackingData.LeftEyeOpenness = eyeTrackingData.leftEyeOpenness;
-        TrackingData.RightEyeOpenness = eyeTrackingData.rightEyeOpenness;
-        TrackingData.LeftEyePupilDilation = eyeTrackingData.leftEyePupilDilation;
-        TrackingData.RightEyePupilDilation = eyeTrackingData.rightEyePupilDilation;
-        TrackingData.LeftEyePositionGuide.X = eyeTrackingData.leftEyePositionGuide[0];
-        TrackingData.LeftEyePositionGuide.Y = eyeTrackingData.leftEyePositionGuide[1];
-        TrackingData.LeftEyePositionGuide.Z = eyeTrackingData.leftEyePositionGuide[2];
-        TrackingData.RightEyePositionGuide.X = eyeTrackingData.rightEyePositionGuide[0];
-        TrackingData.RightEyePositionGuide.Y = eyeTrackingData.rightEyePositionGuide[1];
-        TrackingData.RightEyePositionGuide.Z = eyeTrackingData.rightEyePositionGuide[2];
-        TrackingData.FoveatedGazeDirection.X = eyeTrackingData.foveatedGazeDirection[0];
-        TrackingData.FoveatedGazeDirection.Y = eyeTrackingData.foveatedGazeDirection[1];
-        TrackingData.FoveatedGazeDirection.Z = eyeTrackingData.foveatedGazeDirection[2];
-        TrackingData.FoveatedGazeTrackingState = eyeTrackingData.foveatedGazeTrackingState;
-#endif
-    }
-	return true;
-}
-
 bool FPICOXREyeTracker::GetEyeTrackingGazeRay(FPICOXREyeTrackingGazeRay& EyeTrackingGazeRay) const
 {
-    EyeTrackingGazeRay.Direction = TrackerData.CombinedEyeGazeVector;
-	EyeTrackingGazeRay.Origin = TrackerData.CombinedEyeGazePoint;
+    const FPICOXREyeFaceSample& Sample = Sampler.GetLatest();
+    EyeTrackingGazeRay.Direction = Sample.GazeDirection;
+	EyeTrackingGazeRay.Origin = Sample.GazeOrigin;
 
-	EyeTrackingGazeRay.IsValid = (TrackerData.CombinedEyePoseStatus & kGazePointValid) != 0 && (TrackerData.CombinedEyePoseStatus & kGazeVectorValid) != 0;
+	EyeTrackingGazeRay.IsValid = (Sample.Eye.CombinedEyePoseStatus & kGazePointValid) != 0 && (Sample.Eye.CombinedEyePoseStatus & kGazeVectorValid) != 0;
 	if (EyeTrackingGazeRay.IsValid)
 	{
 		FVector HeadLocation = FVector::ZeroVector;
@@ -172,47 +138,10 @@ bool FPICOXREyeTracker::GetEyeDirectionToFoveationRendering(FVector& OutDirectio
 {
     if (bEyeTrackingRun)
 	{
-		FPICOXREyeTrackingData TempTrackingData;
-		TempTrackingData = TrackerData;
-		FVector FocusPoints[2] = { FVector::ZeroVector,FVector::ZeroVector };
-		if (bEyeTrackingRun)
-		{
-			FVector EyeDirections[3] = 
-			{
-			FVector(TempTrackingData.FoveatedGazeDirection.X,TempTrackingData.FoveatedGazeDirection.Y,-TempTrackingData.FoveatedGazeDirection.Z),
-			FVector(TempTrackingData.FoveatedGazeDirection.X,TempTrackingData.FoveatedGazeDirection.Y,-TempTrackingData.FoveatedGazeDirection.Z),
-			FVector(TempTrackingData.FoveatedGazeDirection.X,TempTrackingData.FoveatedGazeDirection.Y,-TempTrackingData.FoveatedGazeDirection.Z)
-			};
-			
-			float NearPlanesDistances[2] = { 0.0508f, 0.0508f };
-
-			FVector4 NearPlaneExtents[2] =
-			{
-				FVector4(-0.0428f, 0.0428f, -0.0428f, 0.0428f),
-				FVector4(-0.0428f, 0.0428f, -0.0428f, 0.0428f)
-			};
-
-			for (uint32 EyeIndex = 0; EyeIndex < 2; EyeIndex++)
-			{
-				if (!FMath::IsNearlyZero(EyeDirections[EyeIndex].Z))
-				{
-					FVector2D Intersection;
-					Intersection.X = (NearPlanesDistances[EyeIndex] * EyeDirections[EyeIndex].X) / EyeDirections[EyeIndex].Z;
-					Intersection.Y = (NearPlanesDistances[EyeIndex] * EyeDirections[EyeIndex].Y) / EyeDirections[EyeIndex].Z;
-
-					// X in [L,R] -> x in [-1,1] => x == -1 + (X-L)*(1-(-1))/(R-L)
-					check(NearPlaneExtents[EyeIndex].X != NearPlaneExtents[EyeIndex].Y);
-					FocusPoints[EyeIndex].X = -1.f + 2.f*(Intersection.X - NearPlaneExtents[EyeIndex].X) / (NearPlaneExtents[EyeIndex].Y - NearPlaneExtents[EyeIndex].X);
-
-					// Y in [B,T] -> y in [-1,1] => y == -1 + (Y-B)*(1-(-1))/(T-B)
-					check(NearPlaneExtents[EyeIndex].Z != NearPlaneExtents[EyeIndex].W);
-					FocusPoints[EyeIndex].Y = -1.f + 2.f*(Intersection.Y - NearPlaneExtents[EyeIndex].Z) / (NearPlaneExtents[EyeIndex].W - NearPlaneExtents[EyeIndex].Z);
-				}
-			}
-		}
-
-		OutDirection.X = FocusPoints[0].X;
-		OutDirection.Y = FocusPoints[0].Y;
+		FVector2D FocusPoint = FVector2D::ZeroVector;
+		FPICOXRFoveationPolicy::ProjectGazeDirection(Sampler.GetLatest().Eye.FoveatedGazeDirection, FocusPoint);
+		OutDirection.X = FocusPoint.X;
+		OutDirection.Y = FocusPoint.Y;
 		return true;
 	}
 	return false;
@@ -220,22 +149,36 @@ bool FPICOXREyeTracker::GetEyeDirectionToFoveationRendering(FVector& OutDirectio
 
 bool FPICOXREyeTracker::GetFaceTrackingData(int64 ts, int flags, int64& timestamp, TArray<float>& blendShapeWeight, TArray<float>& reserved)
 {
-//     if (bFaceTrackingRun)
-//     {
-//         blendShapeWeight.SetNum(52);
-//         reserved.SetNum(16);
-//         int64_t pxrTs = ts;
-// 		int pxrFlags = flags;
-// 		uint64_t* pTimeStamp = (uint64_t*)(&timestamp);
-//         float* pBlendShapeWeight =nullptr;
-//         float* pReserved =nullptr;
-// #if PLATFORM_ANDROID
-// 		Pxr_GetFaceTrackingData(pxrTs, pxrFlags, pTimeStamp, &pBlendShapeWeight, &pReserved);
-// #endif
-//         FMemory::Memcpy(blendShapeWeight.GetData(), pBlendShapeWeight, sizeof(float) * 52);
-//         FMemory::Memcpy(reserved.GetData(), pReserved, sizeof(float) * 16);
-//         return true;
-//     }
+    if (bFaceTrackingRun)
+    {
+        TArrayView<const float> Weights;
+        TArrayView<const float> Reserved;
+        FPICOXREyeFaceSample Queried;
+        const FPICOXREyeFaceSample& Latest = Sampler.GetLatest();
+        if (ts == 0 && flags == Sampler.GetFaceDataFlags() && Latest.bFaceValid)
+        {
+            // The latest data was already fetched this frame.
+            timestamp = Latest.FaceTimestamp;
+            Weights = Latest.GetBlendShapeWeights();
+            Reserved = Latest.GetBlendShapeReserved();
+        }
+        else if (Sampler.QueryFaceTrackingData(ts, flags, Queried))
+        {
+            timestamp = Queried.FaceTimestamp;
+            Weights = Queried.GetBlendShapeWeights();
+            Reserved = Queried.GetBlendShapeReserved();
+        }
+        else
+        {
+            return false;
+        }
+        // Reuses the caller's arrays when they already have the capacity.
+        blendShapeWeight.SetNumUninitialized(Weights.Num(), false);
+        reserved.SetNumUninitialized(Reserved.Num(), false);
+        FMemory::Memcpy(blendShapeWeight.GetData(), Weights.GetData(), sizeof(float) * Weights.Num());
+        FMemory::Memcpy(reserved.GetData(), Reserved.GetData(), sizeof(float) * Reserved.Num());
+        return true;
+    }
     return false;
 }
 
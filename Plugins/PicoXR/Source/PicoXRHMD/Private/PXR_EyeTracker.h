@@ -3,6 +3,7 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "PXR_HMDFunctionLibrary.h"
+#include "PXR_EyeFaceSampler.h"
 #include "Containers/Ticker.h"
 #include "EyeTracker/Public/IEyeTracker.h"
 
@@ -50,16 +51,22 @@ public:
 
 	void DrawDebug(AHUD* HUD, UCanvas* Canvas, const FDebugDisplayInfo& DisplayInfo, float& YL, float& YPos);
 	bool UPxr_GetEyeTrackingData(FPICOXREyeTrackingData &TrackingData);
-	bool GetEyeTrackingDataFromDevice(FPICOXREyeTrackingData &TrackingData);
 	bool GetEyeTrackingGazeRay(FPICOXREyeTrackingGazeRay &EyeTrackingGazeRay)const;
 	bool GetEyeDirectionToFoveationRendering(FVector &OutDirection)const;
 	bool GetFaceTrackingData(int64 ts, int flags, int64& timestamp, TArray<float>& blendShapeWeight, TArray<float>& reserved);
 	bool EnableEyeTracking(bool enable);
 	bool EnableFaceTracking(bool enable);
 
+	/** Samples the current frame if Tick has not done so yet. */
+	void SampleFrame();
+
+	/** Eye and face data of the current frame, sampled once per frame in Tick. */
+	const FPICOXREyeFaceSample& GetEyeFaceSample() const { return Sampler.GetLatest(); }
+	FPICOXREyeFaceSampler& GetEyeFaceSampler() { return Sampler; }
+
 private:
 	TWeakObjectPtr<APlayerController> ActivePlayerController;
-	FPICOXREyeTrackingData TrackerData;
+	FPICOXREyeFaceSampler Sampler;
 	bool bEyeTrackingRun;
 	bool bFaceTrackingRun;
 	static TSharedPtr<FPICOXREyeTracker> EyeTrackerPtr;
@@ -0,0 +1,371 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_FoveationController.h"
+#include "PXR_EyeFaceSampler.h"
+#include "PXR_HMD.h"
+#include "PXR_HMDFunctionLibrary.h"
+#include "PXR_Log.h"
+#include "HAL/IConsoleManager.h"
+#include "RHI.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if PLATFORM_ANDROID
+#include "PxrApi.h"
+#endif
+
+FPICOXRFoveationInput::FPICOXRFoveationInput()
+	: Time(0.0)
+	, GazeDirection(FVector::ZeroVector)
+	, GazeConfidence(0.0f)
+	, bGazeValid(false)
+	, GPUTimeMs(0.0f)
+	, FrameBudgetMs(0.0f)
+{
+}
+
+FPICOXRFoveationOutput::FPICOXRFoveationOutput()
+	: Level(0)
+	, Center(FVector2D::ZeroVector)
+	, Utilization(0.0f)
+	, bGazeDriven(false)
+	, bSaccade(false)
+{
+}
+
+FPICOXRFoveationPolicy::FPICOXRFoveationPolicy()
+{
+	Reset();
+}
+
+void FPICOXRFoveationPolicy::SetSettings(const FPICOXRFoveationSettings& InSettings)
+{
+	Settings = InSettings;
+	Settings.MaxLevel = FMath::Max(Settings.MinLevel, Settings.MaxLevel);
+	if (!Output.bGazeDriven)
+	{
+		Output.Level = Settings.FixedLevel;
+	}
+}
+
+void FPICOXRFoveationPolicy::Reset()
+{
+	Output = FPICOXRFoveationOutput();
+	Output.Level = Settings.FixedLevel;
+	LastGazeDirection = FVector::ZeroVector;
+	LastConfidence = 0.0f;
+	LastTime = 0.0;
+	LastGazeTime = 0.0;
+	HoldUntil = 0.0;
+	LastLevelChangeTime = 0.0;
+	bHasTime = false;
+	bHasGaze = false;
+	bHasUtilization = false;
+}
+
+const FPICOXRFoveationOutput& FPICOXRFoveationPolicy::Update(const FPICOXRFoveationInput& Input)
+{
+	const float DeltaTime = bHasTime ? FMath::Max(0.0f, (float)(Input.Time - LastTime)) : 0.0f;
+	bHasTime = true;
+	LastTime = Input.Time;
+
+	if (Input.GPUTimeMs > 0.0f && Input.FrameBudgetMs > 0.0f)
+	{
+		const float Utilization = Input.GPUTimeMs / Input.FrameBudgetMs;
+		const float Alpha = bHasUtilization && Settings.UtilizationSmoothingTime > 0.0f ? 1.0f - FMath::Exp(-DeltaTime / Settings.UtilizationSmoothingTime) : 1.0f;
+		Output.Utilization = FMath::Lerp(Output.Utilization, Utilization, Alpha);
+		bHasUtilization = true;
+	}
+
+	FVector2D TargetCenter = FVector2D::ZeroVector;
+	const FVector GazeDirection = Input.GazeDirection.GetSafeNormal();
+	const bool bGazeUsable = Input.bGazeValid && Input.GazeConfidence >= Settings.MinConfidence
+		&& !GazeDirection.IsZero() && ProjectGazeDirection(Input.GazeDirection, TargetCenter);
+
+	if (bGazeUsable)
+	{
+		const bool bWasSaccade = Output.bSaccade;
+		if (bHasGaze && DeltaTime > 0.0f)
+		{
+			const float Angle = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(FVector::DotProduct(GazeDirection, LastGazeDirection), -1.0f, 1.0f)));
+			if (Angle / DeltaTime > Settings.SaccadeVelocity)
+			{
+				HoldUntil = Input.Time + Settings.SaccadeHoldTime;
+			}
+		}
+		Output.bSaccade = Input.Time < HoldUntil;
+
+		if (Output.bSaccade)
+		{
+			// The eye is blind during the saccade, chasing it only adds visible center motion when it lands.
+		}
+		else if (!Output.bGazeDriven || bWasSaccade || Settings.CenterSmoothingTime <= 0.0f)
+		{
+			Output.Center = TargetCenter;
+		}
+		else
+		{
+			const float Alpha = 1.0f - FMath::Exp(-DeltaTime / Settings.CenterSmoothingTime);
+			Output.Center = FMath::Lerp(Output.Center, TargetCenter, Alpha);
+		}
+
+		Output.bGazeDriven = true;
+		LastGazeDirection = GazeDirection;
+		LastConfidence = Input.GazeConfidence;
+		LastGazeTime = Input.Time;
+		bHasGaze = true;
+	}
+	else
+	{
+		Output.bSaccade = false;
+		if (!bHasGaze || Input.Time - LastGazeTime > Settings.TrackingLostTimeout)
+		{
+			Output.bGazeDriven = false;
+			Output.Center = FVector2D::ZeroVector;
+			bHasGaze = false;
+		}
+	}
+
+	UpdateLevel(Input);
+	return Output;
+}
+
+void FPICOXRFoveationPolicy::UpdateLevel(const FPICOXRFoveationInput& Input)
+{
+	if (!Output.bGazeDriven)
+	{
+		Output.Level = Settings.FixedLevel;
+		return;
+	}
+	if (Output.bSaccade)
+	{
+		return;
+	}
+
+	const int32 MaxLevel = LastConfidence >= Settings.HighConfidence ? Settings.MaxLevel : FMath::Min(Settings.MaxLevel, Settings.FixedLevel);
+	int32 Level = Output.Level;
+	if (!bHasUtilization)
+	{
+		Level = Settings.FixedLevel;
+	}
+	else if (Input.Time - LastLevelChangeTime >= Settings.LevelChangeInterval)
+	{
+		if (Output.Utilization > Settings.RaiseUtilization)
+		{
+			Level++;
+		}
+		else if (Output.Utilization < Settings.LowerUtilization)
+		{
+			Level--;
+		}
+	}
+	Level = FMath::Clamp(Level, Settings.MinLevel, FMath::Max(Settings.MinLevel, MaxLevel));
+	if (Level != Output.Level)
+	{
+		Output.Level = Level;
+		LastLevelChangeTime = Input.Time;
+	}
+}
+
+bool FPICOXRFoveationPolicy::ProjectGazeDirection(const FVector& Direction, FVector2D& OutCenter)
+{
+	const float NearPlaneDistance = 0.0508f;
+	const FVector4 NearPlaneExtents(-0.0428f, 0.0428f, -0.0428f, 0.0428f);
+
+	const FVector EyeDirection(Direction.X, Direction.Y, -Direction.Z);
+	if (FMath::IsNearlyZero(EyeDirection.Z))
+	{
+		return false;
+	}
+	FVector2D Intersection;
+	Intersection.X = (NearPlaneDistance * EyeDirection.X) / EyeDirection.Z;
+	Intersection.Y = (NearPlaneDistance * EyeDirection.Y) / EyeDirection.Z;
+
+	// X in [L,R] -> x in [-1,1] => x == -1 + (X-L)*(1-(-1))/(R-L)
+	OutCenter.X = -1.f + 2.f*(Intersection.X - NearPlaneExtents.X) / (NearPlaneExtents.Y - NearPlaneExtents.X);
+	// Y in [B,T] -> y in [-1,1] => y == -1 + (Y-B)*(1-(-1))/(T-B)
+	OutCenter.Y = -1.f + 2.f*(Intersection.Y - NearPlaneExtents.Z) / (NearPlaneExtents.W - NearPlaneExtents.Z);
+	return true;
+}
+
+FPICOXRFoveationController::FPICOXRFoveationController()
+	: RecordFramesLeft(0)
+	, AppliedLevel(-1)
+	, bEnabled(false)
+{
+}
+
+void FPICOXRFoveationController::SetEnabled(bool bInEnabled, int32 FixedLevel)
+{
+	if (bEnabled == bInEnabled)
+	{
+		return;
+	}
+	bEnabled = bInEnabled;
+	FPICOXRFoveationSettings Settings = Policy.GetSettings();
+	Settings.FixedLevel = FixedLevel;
+	Policy.SetSettings(Settings);
+	Policy.Reset();
+	if (!bEnabled && AppliedLevel >= 0)
+	{
+		ApplyLevel(FixedLevel);
+	}
+	AppliedLevel = -1;
+	PXR_LOGI(PxrUnreal, "Dynamic foveation enabled:%d fixed level:%d", bEnabled, FixedLevel);
+}
+
+void FPICOXRFoveationController::Update(const FPICOXREyeFaceSample* Sample, float FrameBudgetMs, int32 FixedLevel)
+{
+	if (!bEnabled)
+	{
+		return;
+	}
+	if (Policy.GetSettings().FixedLevel != FixedLevel)
+	{
+		FPICOXRFoveationSettings Settings = Policy.GetSettings();
+		Settings.FixedLevel = FixedLevel;
+		Policy.SetSettings(Settings);
+	}
+
+	FPICOXRFoveationInput Input;
+	Input.Time = FPlatformTime::Seconds();
+	if (Sample && Sample->bEyeValid)
+	{
+		Input.bGazeValid = Sample->GazeConfidence > 0.0f;
+		Input.GazeConfidence = Sample->GazeConfidence;
+		Input.GazeDirection = Sample->Eye.FoveatedGazeDirection;
+	}
+	Input.GPUTimeMs = FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles());
+	Input.FrameBudgetMs = FrameBudgetMs;
+
+	const FPICOXRFoveationOutput& Output = Policy.Update(Input);
+	if (Output.Level != AppliedLevel)
+	{
+		ApplyLevel(Output.Level);
+	}
+
+	if (RecordFramesLeft > 0)
+	{
+		Recording.Add(Input);
+		if (--RecordFramesLeft == 0)
+		{
+			TArray<FString> Lines;
+			Lines.Reserve(Recording.Num());
+			for (const FPICOXRFoveationInput& Recorded : Recording)
+			{
+				Lines.Add(FormatTraceLine(Recorded));
+			}
+			const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("GazeTrace.csv"));
+			const bool bSaved = FFileHelper::SaveStringArrayToFile(Lines, *Path);
+			PXR_LOGI(PxrUnreal, "Gaze trace saved:%d path:%s", bSaved, PLATFORM_CHAR(*Path));
+			Recording.Empty();
+		}
+	}
+}
+
+void FPICOXRFoveationController::ApplyLevel(int32 Level)
+{
+#if PLATFORM_ANDROID
+	if (Pxr_SetFoveationLevel(static_cast<PxrFoveationLevel>(Level)) != 0)
+	{
+		// Not retried every frame, the next level change tries again.
+		PXR_LOGW(PxrUnreal, "Pxr_SetFoveationLevel %d failed", Level);
+	}
+#endif
+	PXR_LOGV(PxrUnreal, "Dynamic foveation level:%d", Level);
+	AppliedLevel = Level;
+}
+
+void FPICOXRFoveationController::StartRecording(int32 Frames)
+{
+	Recording.Reset();
+	RecordFramesLeft = FMath::Max(Frames, 0);
+	Recording.Reserve(RecordFramesLeft);
+	PXR_LOGI(PxrUnreal, "Recording %d gaze trace frames", RecordFramesLeft);
+}
+
+FString FPICOXRFoveationController::FormatTraceLine(const FPICOXRFoveationInput& Input)
+{
+	return FString::Printf(TEXT("%.6f,%d,%.4f,%.6f,%.6f,%.6f,%.3f,%.3f"), Input.Time, Input.bGazeValid ? 1 : 0, Input.GazeConfidence,
+		Input.GazeDirection.X, Input.GazeDirection.Y, Input.GazeDirection.Z, Input.GPUTimeMs, Input.FrameBudgetMs);
+}
+
+bool FPICOXRFoveationController::ParseTraceLine(const FString& Line, FPICOXRFoveationInput& OutInput)
+{
+	TArray<FString> Fields;
+	if (Line.ParseIntoArray(Fields, TEXT(","), false) != 8)
+	{
+		return false;
+	}
+	OutInput.Time = FCString::Atod(*Fields[0]);
+	OutInput.bGazeValid = FCString::Atoi(*Fields[1]) != 0;
+	OutInput.GazeConfidence = FCString::Atof(*Fields[2]);
+	OutInput.GazeDirection = FVector(FCString::Atof(*Fields[3]), FCString::Atof(*Fields[4]), FCString::Atof(*Fields[5]));
+	OutInput.GPUTimeMs = FCString::Atof(*Fields[6]);
+	OutInput.FrameBudgetMs = FCString::Atof(*Fields[7]);
+	return true;
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand GazeTraceRecordCommand(
+	TEXT("pxr.Foveation.RecordGazeTrace"),
+	TEXT("Records the dynamic foveation input of the next N frames for pxr.Foveation.ReplayGazeTrace."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FPICOXRHMD* HMD = UPICOXRHMDFunctionLibrary::GetPICOXRHMD();
+		if (HMD)
+		{
+			HMD->GetFoveationController().StartRecording(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 600);
+		}
+	}));
+
+namespace PICOXRFoveationReplay
+{
+	static void Run(const TArray<FString>& Args)
+	{
+		TArray<FPICOXRFoveationInput> Trace;
+		const FString Path = Args.Num() > 0 ? Args[0] : FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("GazeTrace.csv"));
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *Path) || Lines.Num() == 0)
+		{
+			PXR_LOGW(PxrUnreal, "No gaze trace at %s, record one with pxr.Foveation.RecordGazeTrace", PLATFORM_CHAR(*Path));
+			return;
+		}
+		for (const FString& Line : Lines)
+		{
+			FPICOXRFoveationInput Input;
+			if (FPICOXRFoveationController::ParseTraceLine(Line, Input))
+			{
+				Trace.Add(Input);
+			}
+		}
+
+		FPICOXRFoveationSettings Settings;
+		Settings.FixedLevel = 1;
+		FPICOXRFoveationPolicy Policy;
+		Policy.SetSettings(Settings);
+
+		int32 GazeDrivenFrames = 0;
+		int32 SaccadeFrames = 0;
+		int32 LevelChanges = 0;
+		int32 LevelFrames[4] = { 0, 0, 0, 0 };
+		int32 PreviousLevel = Settings.FixedLevel;
+		for (const FPICOXRFoveationInput& Input : Trace)
+		{
+			const FPICOXRFoveationOutput& Output = Policy.Update(Input);
+			GazeDrivenFrames += Output.bGazeDriven ? 1 : 0;
+			SaccadeFrames += Output.bSaccade ? 1 : 0;
+			LevelChanges += Output.Level != PreviousLevel ? 1 : 0;
+			LevelFrames[FMath::Clamp(Output.Level, 0, 3)]++;
+			PreviousLevel = Output.Level;
+		}
+		PXR_LOGI(PxrUnreal, "Gaze trace replayed %d frames: gaze driven:%d saccade:%d level changes:%d levels:%d/%d/%d/%d",
+			Trace.Num(), GazeDrivenFrames, SaccadeFrames, LevelChanges, LevelFrames[0], LevelFrames[1], LevelFrames[2], LevelFrames[3]);
+	}
+
+	static FAutoConsoleCommand ReplayCommand(
+		TEXT("pxr.Foveation.ReplayGazeTrace"),
+		TEXT("Runs the dynamic foveation policy over a recorded gaze trace and reports its decisions. Optional argument: trace path."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
+#endif
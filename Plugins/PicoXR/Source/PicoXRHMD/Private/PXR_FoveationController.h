@@ -0,0 +1,138 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+
+struct FPICOXREyeFaceSample;
+
+/** What the foveation policy looks at in one frame. */
+struct FPICOXRFoveationInput
+{
+	FPICOXRFoveationInput();
+
+	double Time;
+	// Gaze direction in the runtime's head space (-Z forward), only read when bGazeValid is set.
+	FVector GazeDirection;
+	float GazeConfidence;
+	bool bGazeValid;
+	// GPU time of the last frame and the frame budget in milliseconds, GPUTimeMs <= 0 when unknown.
+	float GPUTimeMs;
+	float FrameBudgetMs;
+};
+
+/** Tuning of FPICOXRFoveationPolicy. Levels are EFoveationLevel values. */
+struct FPICOXRFoveationSettings
+{
+	// Level used while the gaze is not tracked.
+	int32 FixedLevel = 0;
+	int32 MinLevel = 0;
+	int32 MaxLevel = 3;
+	// Gaze below this confidence is ignored.
+	float MinConfidence = 0.5f;
+	// Levels above FixedLevel are only used with at least this confidence.
+	float HighConfidence = 0.9f;
+	// Time constant of the foveation center smoothing, in seconds.
+	float CenterSmoothingTime = 0.05f;
+	// Gaze angular velocity that starts a saccade, in degrees per second.
+	float SaccadeVelocity = 180.0f;
+	// The center and level are held this long after the last saccadic sample, then the center jumps to the landing point.
+	float SaccadeHoldTime = 0.05f;
+	// Gaze dropouts shorter than this (blinks) keep the last center.
+	float TrackingLostTimeout = 0.2f;
+	// GPU utilization of the frame budget above which the level goes up, and below which it goes down.
+	float RaiseUtilization = 0.9f;
+	float LowerUtilization = 0.7f;
+	// Time constant of the GPU utilization smoothing, in seconds.
+	float UtilizationSmoothingTime = 0.25f;
+	// Minimum time between two headroom driven level changes, in seconds.
+	float LevelChangeInterval = 0.5f;
+};
+
+struct FPICOXRFoveationOutput
+{
+	FPICOXRFoveationOutput();
+
+	int32 Level;
+	// Foveation center in normalized eye coordinates, [-1,1] on both axes, (0,0) is the middle of the eye buffer.
+	FVector2D Center;
+	// Smoothed GPU time over frame budget, 0 when unknown.
+	float Utilization;
+	bool bGazeDriven;
+	bool bSaccade;
+};
+
+/**
+ * Chooses the foveation level and center of a frame from gaze and GPU headroom.
+ * Holds no engine or runtime state, so recorded gaze traces replay the same way off-device.
+ */
+class FPICOXRFoveationPolicy
+{
+public:
+	FPICOXRFoveationPolicy();
+
+	void SetSettings(const FPICOXRFoveationSettings& InSettings);
+	const FPICOXRFoveationSettings& GetSettings() const { return Settings; }
+
+	/** Forgets the gaze and timing history and returns to fixed foveation. */
+	void Reset();
+
+	const FPICOXRFoveationOutput& Update(const FPICOXRFoveationInput& Input);
+	const FPICOXRFoveationOutput& GetOutput() const { return Output; }
+
+	/**
+	 * Projects a head space gaze direction onto the eye near plane.
+	 * @return false if the direction is parallel to the near plane, OutCenter is not written then.
+	 */
+	static bool ProjectGazeDirection(const FVector& Direction, FVector2D& OutCenter);
+
+private:
+	void UpdateLevel(const FPICOXRFoveationInput& Input);
+
+	FPICOXRFoveationSettings Settings;
+	FPICOXRFoveationOutput Output;
+	FVector LastGazeDirection;
+	float LastConfidence;
+	double LastTime;
+	double LastGazeTime;
+	double HoldUntil;
+	double LastLevelChangeTime;
+	bool bHasTime;
+	bool bHasGaze;
+	bool bHasUtilization;
+};
+
+/**
+ * Drives the runtime foveation level from FPICOXRFoveationPolicy every frame.
+ * The runtime has no foveation center parameter, the center is exposed for eye tracked content and markers.
+ */
+class FPICOXRFoveationController
+{
+public:
+	FPICOXRFoveationController();
+
+	/** When disabled the fixed level is restored and Update does nothing. */
+	void SetEnabled(bool bInEnabled, int32 FixedLevel);
+	bool IsEnabled() const { return bEnabled; }
+
+	/** Runs the policy for this frame and applies a changed level. Sample may be null without eye tracking. */
+	void Update(const FPICOXREyeFaceSample* Sample, float FrameBudgetMs, int32 FixedLevel);
+
+	const FPICOXRFoveationOutput& GetOutput() const { return Policy.GetOutput(); }
+	FPICOXRFoveationPolicy& GetPolicy() { return Policy; }
+
+	/** Records the policy input of the next N updates to Saved/PICOXR/GazeTrace.csv for pxr.Foveation.ReplayGazeTrace. */
+	void StartRecording(int32 Frames);
+
+	/** One line of a gaze trace: time, valid, confidence, direction xyz, GPU ms, budget ms. */
+	static FString FormatTraceLine(const FPICOXRFoveationInput& Input);
+	static bool ParseTraceLine(const FString& Line, FPICOXRFoveationInput& OutInput);
+
+private:
+	void ApplyLevel(int32 Level);
+
+	FPICOXRFoveationPolicy Policy;
+	TArray<FPICOXRFoveationInput> Recording;
+	int32 RecordFramesLeft;
+	int32 AppliedLevel;
+	bool bEnabled;
+};
@@ -13,6 +13,9 @@
 #include "GameFramework/WorldSettings.h"
 #include "Misc/EngineVersion.h"
 #include "PXR_Utils.h"
+#include "PXR_BoundarySystem.h"
+#include "PXR_HMDModule.h"
+#include "PXR_Trace.h"
 
 #if PLATFORM_ANDROID
 #include "HardwareInfo.h"
@@ -203,7 +206,7 @@ bool FPICOXRHMD::GetCurrentPose(int32 DeviceId, FQuat& CurrentOrientation, FVect
 	{
 		CurrentOrientation = CurrentFrame->Orientation;
 		CurrentPosition = CurrentFrame->Position;
-		PXR_LOGV(PxrUnreal, "GetCurrentPose Frame:%u Rotation:%s,Position:%s", CurrentFrame->FrameNumber, PLATFORM_CHAR(*CurrentOrientation.Rotator().ToString()), PLATFORM_CHAR(*CurrentPosition.ToString()));
+		PXR_TRACE(GetCurrentPose, CurrentFrame->FrameNumber, 0);
 		return true;
 	}
 #endif
@@ -467,6 +470,7 @@ bool FPICOXRHMD::OnStartGameFrame(FWorldContext& WorldContext)
 	}
 	CachedWorldToMetersScale = WorldContext.World()->GetWorldSettings()->WorldToMeters;
 	OnGameFrameBegin_GameThread();
+	UpdateDynamicFoveation();
   	return true;
 }
 
@@ -513,6 +517,55 @@ void FPICOXRHMD::AdjustViewRect(EStereoscopicPass StereoPass, int32& X, int32& Y
 	PXR_LOGV(PxrUnreal,"AdjustViewRect StereoPass:%d ,X: %d,Y: %d ,SizeX: %d,SizeY: %d)", (int)StereoPass, X, Y, SizeX, SizeY);
 }
 
+static void DrawOcclusionMesh_RenderThread(FRHICommandList& RHICmdList, const FHMDViewMesh& Mesh)
+{
+	check(IsInRenderingThread());
+	check(Mesh.IsValid());
+	RHICmdList.SetStreamSource(0, Mesh.VertexBufferRHI, 0);
+	RHICmdList.DrawIndexedPrimitive(Mesh.IndexBufferRHI, 0, 0, Mesh.NumVertices, 0, Mesh.NumTriangles, 1);
+}
+
+void FPICOXRHMD::DrawHiddenAreaMesh_RenderThread(FRHICommandList& RHICmdList, EStereoscopicPass StereoPass) const
+{
+	DrawOcclusionMesh_RenderThread(RHICmdList, HiddenAreaMeshes[StereoPass == eSSP_RIGHT_EYE ? 1 : 0]);
+}
+
+void FPICOXRHMD::DrawVisibleAreaMesh_RenderThread(FRHICommandList& RHICmdList, EStereoscopicPass StereoPass) const
+{
+	DrawOcclusionMesh_RenderThread(RHICmdList, VisibleAreaMeshes[StereoPass == eSSP_RIGHT_EYE ? 1 : 0]);
+}
+
+void FPICOXRHMD::SetupOcclusionMeshes()
+{
+	if (bOcclusionMeshesSetup)
+	{
+		return;
+	}
+
+	// Only the runtime meshes match the lenses, the debug ones would hide pixels that are seen.
+	float HFOVInDegrees, VFOVInDegrees;
+	GetFieldOfView(HFOVInDegrees, VFOVInDegrees);
+	FPICOXRStencilMeshCache& StencilMeshCache = FPICOXRHMDModule::Get().GetStencilMeshCache();
+	const FPICOXRStencilMeshPtr LeftMesh = StencilMeshCache.Find(FPICOXRStencilMeshKey(0, HFOVInDegrees, EPICOXRStencilMeshType::Runtime));
+	const FPICOXRStencilMeshPtr RightMesh = StencilMeshCache.Find(FPICOXRStencilMeshKey(1, HFOVInDegrees, EPICOXRStencilMeshType::Runtime));
+	if (!LeftMesh.IsValid() || !RightMesh.IsValid())
+	{
+		return;
+	}
+	bOcclusionMeshesSetup = true;
+	PXR_LOGI(PxrUnreal, "Occlusion meshes: %d and %d hidden area vertices", LeftMesh->HiddenArea.Num(), RightMesh->HiddenArea.Num());
+
+	ExecuteOnRenderThread_DoNotWait([this, LeftMesh, RightMesh](FRHICommandListImmediate& RHICmdList)
+	{
+		const FPICOXRStencilMeshPtr Meshes[2] = { LeftMesh, RightMesh };
+		for (int32 Eye = 0; Eye < 2; Eye++)
+		{
+			HiddenAreaMeshes[Eye].BuildMesh(Meshes[Eye]->HiddenArea.GetData(), Meshes[Eye]->HiddenArea.Num(), FHMDViewMesh::MT_HiddenArea);
+			VisibleAreaMeshes[Eye].BuildMesh(Meshes[Eye]->VisibleArea.GetData(), Meshes[Eye]->VisibleArea.Num(), FHMDViewMesh::MT_VisibleArea);
+		}
+	});
+}
+
 FMatrix FPICOXRHMD::GetStereoProjectionMatrix(const enum EStereoscopicPass StereoPassType) const
 {
 	FPICOXRFrustum Frustum = (StereoPassType == eSSP_LEFT_EYE) ? LeftFrustum : RightFrustum;
@@ -571,6 +624,7 @@ FPICOXRHMD::FPICOXRHMD(const FAutoRegister&AutoRegister)
 	, RenderBridge(nullptr)
 	, PICOXRSetting(nullptr)
 	, bIsBindDelegate(false)
+	, bOcclusionMeshesSetup(false)
 	, bIsEndGameFrame(false)
 	, TrackingOrigin(EHMDTrackingOrigin::Eye)
 	, PlayerController(nullptr)
@@ -1014,6 +1068,8 @@ void FPICOXRHMD::ProcessEvent(int32 EventCount, PxrEventDataBuffer** EventData)
 		{
 			const PxrEventDataSeethroughStateChanged SeeThroughData = *reinterpret_cast<const PxrEventDataSeethroughStateChanged*>(Event);
 			OnSeeThroughStateChange(SeeThroughData.state);
+			// Redrawing the boundary happens in see-through.
+			UPICOXRBoundarySystem::GetInstance()->RefreshBoundaryGeometry();
 			break;
 		}
 		case PXR_TYPE_EVENT_FOVEATION_LEVEL_CHANGED:
@@ -1081,6 +1137,8 @@ void FPICOXRHMD::ProcessEvent(int32 EventCount, PxrEventDataBuffer** EventData)
 		{
 			const PxrEventDataSessionStateChanged sessionStateChanged = *reinterpret_cast<const PxrEventDataSessionStateChanged*>(Event);
 			inputFocusState = sessionStateChanged.state == PXR_SESSION_STATE_FOCUSED;
+			// The runtime has no boundary change event, the boundary may have been redrawn while the session was not focused.
+			UPICOXRBoundarySystem::GetInstance()->RefreshBoundaryGeometry();
 			break;
 		}
 		default:
@@ -1139,6 +1197,27 @@ void FPICOXRHMD::OnFoveationLevelChange(int32 NewFoveationLevel)
 #endif
 }
 
+void FPICOXRHMD::UpdateDynamicFoveation()
+{
+	const bool bDynamicFoveation = PICOXRSetting->bEnableFoveation && PICOXRSetting->bEnableDynamicFoveation;
+	FoveationController.SetEnabled(bDynamicFoveation, (int32)PICOXRSetting->FoveationLevel);
+	if (!bDynamicFoveation)
+	{
+		return;
+	}
+	const FPICOXREyeFaceSample* Sample = nullptr;
+	if (EyeTracker.IsValid())
+	{
+		EyeTracker->SampleFrame();
+		// A sample of an earlier frame means eye tracking is not running.
+		if (EyeTracker->GetEyeFaceSample().FrameNumber == GFrameCounter)
+		{
+			Sample = &EyeTracker->GetEyeFaceSample();
+		}
+	}
+	FoveationController.Update(Sample, DisplayRefreshRate > 0 ? 1000.0f / DisplayRefreshRate : 0.0f, (int32)PICOXRSetting->FoveationLevel);
+}
+
 void FPICOXRHMD::OnFrustumStateChange()
 {
 #if PLATFORM_ANDROID
@@ -1202,6 +1281,7 @@ void FPICOXRHMD::ApplicationPauseDelegate()
 void FPICOXRHMD::ApplicationResumeDelegate()
 {
 	PXR_LOGI(PxrUnreal,"FPICOXRHMD::ApplicationResumeDelegate");
+	UPICOXRBoundarySystem::GetInstance()->RefreshBoundaryGeometry();
 	if (EventManager)
 	{
 		EventManager->ResumeDelegate.Broadcast();
@@ -1314,7 +1394,7 @@ void FPICOXRHMD::UpdateSensorValue(FPXRGameFrame* InFrame)
 	}
 	// Orientation
 	InFrame->Orientation = Orientation;
-	PXR_LOGV(PxrUnreal, "UpdateSensorValue:%u,PredtTime:%f,ViewNumber:%d,Rotation:%s,Position:%s", InFrame->FrameNumber, InFrame->predictedDisplayTimeMs, ViewNumber, PLATFORM_CHAR(*InFrame->Orientation.Rotator().ToString()), PLATFORM_CHAR(*InFrame->Position.ToString()));
+	PXR_TRACE(UpdateSensor, InFrame->FrameNumber, (uint64)ViewNumber);
 	//velocity
 	InFrame->Acceleration = LinearAcceleration;
 	InFrame->AngularAcceleration = AngularAcceleration;
@@ -1453,7 +1533,7 @@ void FPICOXRHMD::PreLateLatchingViewFamily_RenderThread(FRHICommandListImmediate
 	FPXRGameFrame* CurrentFrame = GameFrame_RenderThread.Get();
 	if (CurrentFrame)
 	{
-		PXR_LOGV(PxrUnreal, "PreLateLatchingViewFamily_RenderThread:%u", CurrentFrame->FrameNumber);
+		PXR_TRACE(LateLatch, CurrentFrame->FrameNumber, 0);
 		UpdateSensorValue(CurrentFrame);
 		FQuat SubmitOrientation = CurrentFrame->Orientation;
 		FVector SubmitPosition = CurrentFrame->Position;
@@ -1685,6 +1765,7 @@ void FPICOXRHMD::OnBeginPlay(FWorldContext& InWorldContext)
  		EyeTracker->SetEyeTrackedPlayer(PlayerController);
 		EyeTracker->EnableFaceTracking(PICOXRSetting->bEnableFaceTracking);
  	}
+	SetupOcclusionMeshes();
 }
 
 void FPICOXRHMD::OnEndPlay(FWorldContext& InWorldContext)
@@ -1862,7 +1943,7 @@ void FPICOXRHMD::WaitFrame()
 	check(IsInGameThread());
 	if (GameFrame_GameThread.IsValid())
 	{
-		PXR_LOGV(PxrUnreal, "WaitFrame %u", GameFrame_GameThread->FrameNumber);
+		PXR_TRACE(WaitFrame, GameFrame_GameThread->FrameNumber, 0);
 		if (!PICOSplash->IsShown() && WaitedFrameNumber < GameFrame_GameThread->FrameNumber)
 		{
 			if (bWaitFrameVersion)
@@ -1873,18 +1954,17 @@ void FPICOXRHMD::WaitFrame()
 #endif
 				GameFrame_GameThread->bHasWaited = true;
 				GameFrame_GameThread->predictedDisplayTimeMs = CurrentFramePredictedTime;
-				PXR_LOGV(PxrUnreal, "Pxr_GetPredictedDisplayTime after Pxr_WaitFrame %u,Time:%f", GameFrame_GameThread->FrameNumber, CurrentFramePredictedTime);
 			}
 			else
 			{
 				GameFrame_GameThread->bHasWaited = true;
 			}
 			WaitedFrameNumber = GameFrame_GameThread->FrameNumber;
-			PXR_LOGV(PxrUnreal, "WaitFrame Wake Up %u", GameFrame_GameThread->FrameNumber);
+			PXR_TRACE(WaitFrameWakeUp, GameFrame_GameThread->FrameNumber, (uint64)(GameFrame_GameThread->predictedDisplayTimeMs * 1000.0));
 		}
 		else
 		{
-			PXR_LOGV(PxrUnreal, "WaitFrame not wait! %u,bSplashIsShowing:%d,WaitedFrameNumber:%u", GameFrame_GameThread->FrameNumber, PICOSplash->IsShown(), WaitedFrameNumber);
+			PXR_TRACE(WaitFrameSkipped, GameFrame_GameThread->FrameNumber, WaitedFrameNumber);
 		}
 	}
  }
@@ -1913,7 +1993,7 @@ void FPICOXRHMD::WaitFrame()
 	 WaitFrame();
 	 if (GameFrame_GameThread.IsValid())
 	 {
-		 PXR_LOGV(PxrUnreal, "OnGameFrameEnd %u", GameFrame_GameThread->FrameNumber);
+		 PXR_TRACE(GameFrameEnd, GameFrame_GameThread->FrameNumber, 0);
 	 }
 	 GameFrame_GameThread.Reset();
  }
@@ -1932,7 +2012,7 @@ void FPICOXRHMD::WaitFrame()
 			 NextGameFrameNumber++;
 		 }
 		 FPXRGameFramePtr PXRFrame = NextGameFrameToRender_GameThread->CloneMyself();
-		 PXR_LOGV(PxrUnreal, "OnRenderFrameBegin_GameThread %u has been eaten by render-thread!", NextGameFrameToRender_GameThread->FrameNumber);
+		 PXR_TRACE(RenderFrameBegin, NextGameFrameToRender_GameThread->FrameNumber, 0);
 		 TArray<FPICOLayerPtr> PXRLayers;
 
 		 PXRLayers.Empty(PXRLayerMap.Num());
@@ -2050,7 +2130,7 @@ void FPICOXRHMD::WaitFrame()
 				 {
 					 GameFrame_RHIThread = PXRFrame;
 					 PXRLayers_RHIThread = PXRLayers;
-					 PXR_LOGV(PxrUnreal, "BeginFrame %u", GameFrame_RHIThread->FrameNumber);
+					 PXR_TRACE(RHIBeginFrame, GameFrame_RHIThread->FrameNumber, 0);
 					 if (GameFrame_RHIThread->ShowFlags.Rendering && !GameFrame_RHIThread->Flags.bSplashIsShown) 
 					 {
 #if PLATFORM_ANDROID
@@ -2083,8 +2163,7 @@ void FPICOXRHMD::WaitFrame()
 	 check(IsInRHIThread() || IsInRenderingThread());
 	 if (GameFrame_RHIThread.IsValid())
 	 {
-		 PXR_LOGV(PxrUnreal, "EndFrame %u,SubmitViewNum:%d,Rotation:%s,Position:%s", GameFrame_RHIThread->FrameNumber, GameFrame_RHIThread->ViewNumber,
-			 PLATFORM_CHAR(*(GameFrame_RHIThread->Orientation.Rotator().ToString())), PLATFORM_CHAR(*(GameFrame_RHIThread->Position.ToString())));
+		 PXR_TRACE(RHIEndFrame, GameFrame_RHIThread->FrameNumber, (uint64)GameFrame_RHIThread->ViewNumber);
 		 if (GameFrame_RHIThread->ShowFlags.Rendering && !GameFrame_RHIThread->Flags.bSplashIsShown)
 		 {
 			 TArray<FPICOLayerPtr> Layers = PXRLayers_RHIThread;
@@ -6,12 +6,14 @@
 #include "IStereoLayers.h"
 #include "XRRenderBridge.h"
 #include "PXR_EyeTracker.h"
+#include "PXR_FoveationController.h"
 #include "PXR_StereoLayer.h"
 #include "SceneViewExtension.h"
 #include "PXR_EventManager.h"
 #include "XRTrackingSystemBase.h"
 #include "XRRenderTargetManager.h"
 #include "HeadMountedDisplayBase.h"
+#include "HeadMountedDisplayTypes.h"
 #include "Engine/Public/SceneUtils.h"
 #include "PXR_GameFrame.h"
 #include "PXR_DelayDeleteLayer.h"
@@ -143,6 +145,10 @@ public:
 	virtual EHMDWornState::Type GetHMDWornState() override;
 	virtual float GetPixelDenity() const override;
 	virtual void SetPixelDensity(const float NewPixelDensity) override;
+	virtual bool HasHiddenAreaMesh() const override { return HiddenAreaMeshes[0].IsValid() && HiddenAreaMeshes[1].IsValid(); }
+	virtual void DrawHiddenAreaMesh_RenderThread(class FRHICommandList& RHICmdList, EStereoscopicPass StereoPass) const override;
+	virtual bool HasVisibleAreaMesh() const override { return VisibleAreaMeshes[0].IsValid() && VisibleAreaMeshes[1].IsValid(); }
+	virtual void DrawVisibleAreaMesh_RenderThread(class FRHICommandList& RHICmdList, EStereoscopicPass StereoPass) const override;
 
 	/** FXRTrackingSystemBase interface */
 	virtual bool GetRelativeEyePose(int32 InDeviceId, EStereoscopicPass InEye, FQuat& OutOrientation, FVector& OutPosition) override;
@@ -236,6 +242,7 @@ public:
 	void UPxr_GetAngularVelocity(FVector& AngularVelocity);
 	FString UPxr_GetDeviceModel();
 	TSharedPtr<FPICOXREyeTracker> UPxr_GetEyeTracker();
+	FPICOXRFoveationController& GetFoveationController() { return FoveationController; }
 	void ClearTexture_RHIThread(FRHITexture2D* SrcTexture);
 	void UPxr_SetColorScaleAndOffset(FLinearColor ColorScale, FLinearColor ColorOffset, bool bApplyToAllLayers = false);
 	uint32 CreateMRCStereoLayer(FTextureRHIRef BackgroundRTTexture, FTextureRHIRef ForegroundRTTexture);
@@ -304,6 +311,7 @@ private:
 #endif
 	void OnSeeThroughStateChange(int32 SeeThroughState);
 	void OnFoveationLevelChange(int32 FoveationLevel);
+	void UpdateDynamicFoveation();
 	void OnFrustumStateChange();
 	void OnRenderTextureChange(int32 Width,int32 Height);
 	void OnTargetFrameRateChange(int32 NewFrameRate);
@@ -312,6 +320,8 @@ private:
 	void UpdateNeckOffset();
 	void EnableContentProtect(bool bEnable );
 	void SetRefreshRate();
+	// Builds the occlusion meshes from the runtime stencil meshes once they are available.
+	void SetupOcclusionMeshes();
 
 	bool bIsMobileMultiViewEnabled;
 	float PixelDensity;
@@ -320,6 +330,10 @@ private:
 	FVector NeckOffset;
 	FPICOXRFrustum LeftFrustum;
 	FPICOXRFrustum RightFrustum;
+	// Render thread
+	FHMDViewMesh HiddenAreaMeshes[2];
+	FHMDViewMesh VisibleAreaMeshes[2];
+	bool bOcclusionMeshesSetup;
 	TRefCountPtr<FPICOXRRenderBridge> RenderBridge;
 	class UPICOXRSettings* PICOXRSetting;
 	bool bIsBindDelegate;
@@ -328,6 +342,7 @@ private:
 	EHMDTrackingOrigin::Type TrackingOrigin;
 	static float IpdValue;
 	TSharedPtr<FPICOXREyeTracker> EyeTracker;
+	FPICOXRFoveationController FoveationController;
 	APlayerController* PlayerController;
 	FPICOXRSplashPtr PICOSplash;
 	FString DeviceModel;
@@ -216,11 +216,38 @@ bool UPICOXRHMDFunctionLibrary::PXR_BoundaryTestPoint(FVector Point, EPICOXRBoun
     return GetBoundarySystemInterface()->UPxr_TestPoint(Point,BoundaryType == EPICOXRBoundaryType::PlayArea,IsTriggering,ClosestDistance,ClosestPoint,ClosestPointNormal);
 }
 
+bool UPICOXRHMDFunctionLibrary::PXR_BoundaryQueryPoint(FVector Point, EPICOXRBoundaryType BoundaryType,
+    bool& IsInside, float& ClosestDistance, FVector& ClosestPoint, FVector& ClosestPointNormal)
+{
+    return GetBoundarySystemInterface()->UPxr_QueryPoint(Point,BoundaryType == EPICOXRBoundaryType::PlayArea,IsInside,ClosestDistance,ClosestPoint,ClosestPointNormal);
+}
+
+bool UPICOXRHMDFunctionLibrary::PXR_BoundaryQuerySphere(FVector Center, float Radius, EPICOXRBoundaryType BoundaryType,
+    bool& IsInside, bool& IsIntersecting, float& SurfaceDistance, FVector& ClosestPoint, FVector& ClosestPointNormal)
+{
+    return GetBoundarySystemInterface()->UPxr_QuerySphere(Center,Radius,BoundaryType == EPICOXRBoundaryType::PlayArea,IsInside,IsIntersecting,SurfaceDistance,ClosestPoint,ClosestPointNormal);
+}
+
 TArray<FVector> UPICOXRHMDFunctionLibrary::PXR_GetBoundaryGeometry(EPICOXRBoundaryType BoundaryType)
 {
    return GetBoundarySystemInterface()->UPxr_GetGeometry(BoundaryType == EPICOXRBoundaryType::PlayArea);
 }
 
+TArray<FVector> UPICOXRHMDFunctionLibrary::PXR_GetBoundarySimplifiedGeometry(EPICOXRBoundaryType BoundaryType)
+{
+    return GetBoundarySystemInterface()->UPxr_GetSimplifiedGeometryView(BoundaryType == EPICOXRBoundaryType::PlayArea);
+}
+
+int32 UPICOXRHMDFunctionLibrary::PXR_GetBoundaryGeometryRevision(EPICOXRBoundaryType BoundaryType)
+{
+    return static_cast<int32>(GetBoundarySystemInterface()->UPxr_GetGeometryRevision(BoundaryType == EPICOXRBoundaryType::PlayArea));
+}
+
+void UPICOXRHMDFunctionLibrary::PXR_SetBoundarySimplifyTolerance(float Tolerance)
+{
+    GetBoundarySystemInterface()->UPxr_SetSimplifyTolerance(Tolerance);
+}
+
 FVector UPICOXRHMDFunctionLibrary::PXR_GetBoundaryDimensions(EPICOXRBoundaryType BoundaryType)
 {
     return GetBoundarySystemInterface()->UPxr_GetDimensions(BoundaryType == EPICOXRBoundaryType::PlayArea);
@@ -231,6 +258,11 @@ bool UPICOXRHMDFunctionLibrary::PXR_GetBoundarySeeThroughData(EPICOXRCameraType
     return GetBoundarySystemInterface()->UPxr_GetSeeThroughData(static_cast<int32>(CameraType),CameraImage);
 }
 
+bool UPICOXRHMDFunctionLibrary::PXR_GetBoundarySeeThroughFrame(EPICOXRCameraType CameraType, UTexture2D*& CameraImage, int64& FrameNumber)
+{
+    return GetBoundarySystemInterface()->UPxr_GetSeeThroughFrame(static_cast<int32>(CameraType),CameraImage,FrameNumber);
+}
+
 bool UPICOXRHMDFunctionLibrary::PXR_SetBoundaryCameraImageSize(FIntPoint ImageSize)
 {
     return GetBoundarySystemInterface()->UPxr_SetCameraImageSize(ImageSize);
@@ -304,8 +336,16 @@ bool UPICOXRHMDFunctionLibrary::PXR_GetFoveationLevel(EPICOXRFoveationLevel &Fov
 
 bool UPICOXRHMDFunctionLibrary::PXR_SetFoveationLevel(EPICOXRFoveationLevel InLevel)
 { 
-    if (GetMutableDefault<UPICOXRSettings>()->bEnableFoveation)
+	UPICOXRSettings* PICOSettings = GetMutableDefault<UPICOXRSettings>();
+    if (PICOSettings->bEnableFoveation)
     {
+		// The dynamic controller would replace the level on the next frame, and falls back to the fixed level when disabled.
+		if (PICOSettings->bEnableDynamicFoveation)
+		{
+			PICOSettings->bEnableDynamicFoveation = false;
+			PXR_LOGI(PxrUnreal, "Dynamic foveation disabled by PXR_SetFoveationLevel");
+		}
+		PICOSettings->FoveationLevel = static_cast<EFoveationLevel::Type>(InLevel);
 #if PLATFORM_ANDROID
 		PxrFoveationLevel Level = static_cast<PxrFoveationLevel>(InLevel);
 		if (Pxr_SetFoveationLevel(Level) == 0)
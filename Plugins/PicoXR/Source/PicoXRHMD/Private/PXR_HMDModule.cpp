@@ -55,6 +55,7 @@ void FPICOXRHMDModule::StartupModule()
 {
 	IHeadMountedDisplayModule::StartupModule();
 	FCoreDelegates::OnFEngineLoopInitComplete.AddRaw(this,&FPICOXRHMDModule::RegisterSettings);
+	FCoreDelegates::OnPreExit.AddRaw(this, &FPICOXRHMDModule::ReleaseRenderTargetPool);
 	FString PluginShaderDir = FPaths::Combine(FPaths::ProjectPluginsDir(), TEXT("PICOXR/Shaders"));
 	AddShaderSourceDirectoryMapping(TEXT("/Plugin/PICOXR"), PluginShaderDir);
 }
@@ -63,6 +64,13 @@ void FPICOXRHMDModule::ShutdownModule()
 {
 	IHeadMountedDisplayModule::ShutdownModule();
 	UnregisterSettings();
+	ReleaseRenderTargetPool();
+}
+
+void FPICOXRHMDModule::ReleaseRenderTargetPool()
+{
+	// The targets are UObjects with GPU resources, they have to go while both are still around.
+	RenderTargetPool.Reset();
 }
 
 FString FPICOXRHMDModule::GetModuleKeyName() const
@@ -7,6 +7,8 @@
 #include "Modules/ModuleInterface.h"
 #include "Modules/ModuleManager.h"
 #include "PXR_HMDRenderBridge.h"
+#include "PXR_RenderTargetPool.h"
+#include "PXR_StencilMeshCache.h"
 #include "PXR_Log.h"
 
 //-------------------------------------------------------------------------------------------------
@@ -28,6 +30,20 @@ public:
 	void RegisterSettings();
 	void UnregisterSettings();
 
+	/** Render targets shared by the capture features, created on first use and freed before the engine exits. */
+	FPICOXRRenderTargetPool& GetRenderTargetPool()
+	{
+		if (!RenderTargetPool.IsValid())
+		{
+			RenderTargetPool = MakeUnique<FPICOXRRenderTargetPool>();
+		}
+		return *RenderTargetPool;
+	}
+	void ReleaseRenderTargetPool();
+
+	/** Stencil meshes shared by the eye masks and the renderer, game thread only. */
+	FPICOXRStencilMeshCache& GetStencilMeshCache() { return StencilMeshCache; }
+
 	// IHeadMountedDisplayModule
 	virtual FString GetModuleKeyName() const override;
 	virtual void GetModuleAliases(TArray<FString>& AliasesOut) const override;
@@ -39,6 +55,8 @@ public:
 #endif
 private:
     TSharedPtr< IHeadMountedDisplayVulkanExtensions, ESPMode::ThreadSafe > VulkanExtensions;
+	TUniquePtr<FPICOXRRenderTargetPool> RenderTargetPool;
+	FPICOXRStencilMeshCache StencilMeshCache;
 };
 
 class FVulkanExtensions : public IHeadMountedDisplayVulkanExtensions
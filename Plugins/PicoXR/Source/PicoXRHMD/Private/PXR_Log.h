@@ -3,15 +3,47 @@
 DEFINE_LOG_CATEGORY_STATIC(PxrUnreal, Log, All);
 DEFINE_LOG_CATEGORY_STATIC(PxrUnrealFunctionLibrary, Log, All);
 DEFINE_LOG_CATEGORY_STATIC(LogMRC, Log, All);
+
+// Levels in ELogVerbosity order. PXR_LOGD prints at Display.
+#define PXR_LOG_LEVEL_F 1
+#define PXR_LOG_LEVEL_E 2
+#define PXR_LOG_LEVEL_W 3
+#define PXR_LOG_LEVEL_D 4
+#define PXR_LOG_LEVEL_I 5
+#define PXR_LOG_LEVEL_V 6
+
+// Most verbose level compiled in per category. Lines past it are removed with their arguments, so they cost nothing
+// in a frame. Everything is compiled in outside shipping, where the category verbosity still filters at runtime.
+// Override one from a Build.cs, e.g. PublicDefinitions.Add("PXR_LOG_FLOOR_PxrUnreal=3") for warnings and errors only.
+#ifndef PXR_LOG_FLOOR_DEFAULT
+	#if UE_BUILD_SHIPPING
+		#define PXR_LOG_FLOOR_DEFAULT PXR_LOG_LEVEL_I
+	#else
+		#define PXR_LOG_FLOOR_DEFAULT PXR_LOG_LEVEL_V
+	#endif
+#endif
+#ifndef PXR_LOG_FLOOR_PxrUnreal
+	#define PXR_LOG_FLOOR_PxrUnreal PXR_LOG_FLOOR_DEFAULT
+#endif
+#ifndef PXR_LOG_FLOOR_PxrUnrealFunctionLibrary
+	#define PXR_LOG_FLOOR_PxrUnrealFunctionLibrary PXR_LOG_FLOOR_DEFAULT
+#endif
+#ifndef PXR_LOG_FLOOR_LogMRC
+	#define PXR_LOG_FLOOR_LogMRC PXR_LOG_FLOOR_DEFAULT
+#endif
+
+// Arguments are only evaluated when the line is compiled in, and for UE_LOG only when the category lets it through.
+#define PXR_LOG_IF_COMPILED(Category, Level, Statement) do { if (PXR_LOG_LEVEL_##Level <= PXR_LOG_FLOOR_##Category) { Statement; } } while (0)
+
 #if !UE_BUILD_SHIPPING
 	#define PLATFORM_CHAR(str) str
 
-	#define PXR_LOGV(CategoryName, Format, ...) UE_LOG(CategoryName, Verbose, TEXT(Format), ##__VA_ARGS__)
-	#define PXR_LOGD(CategoryName, Format, ...) UE_LOG(CategoryName, Display, TEXT(Format), ##__VA_ARGS__)
-	#define PXR_LOGI(CategoryName, Format, ...) UE_LOG(CategoryName, Log, TEXT(Format), ##__VA_ARGS__)
-	#define PXR_LOGW(CategoryName, Format, ...) UE_LOG(CategoryName, Warning, TEXT(Format), ##__VA_ARGS__)
-	#define PXR_LOGE(CategoryName, Format, ...) UE_LOG(CategoryName, Error, TEXT(Format), ##__VA_ARGS__)
-	#define PXR_LOGF(CategoryName, Format, ...) UE_LOG(CategoryName, Fatal, TEXT(Format), ##__VA_ARGS__)
+	#define PXR_LOGV(CategoryName, Format, ...) PXR_LOG_IF_COMPILED(CategoryName, V, UE_LOG(CategoryName, Verbose, TEXT(Format), ##__VA_ARGS__))
+	#define PXR_LOGD(CategoryName, Format, ...) PXR_LOG_IF_COMPILED(CategoryName, D, UE_LOG(CategoryName, Display, TEXT(Format), ##__VA_ARGS__))
+	#define PXR_LOGI(CategoryName, Format, ...) PXR_LOG_IF_COMPILED(CategoryName, I, UE_LOG(CategoryName, Log, TEXT(Format), ##__VA_ARGS__))
+	#define PXR_LOGW(CategoryName, Format, ...) PXR_LOG_IF_COMPILED(CategoryName, W, UE_LOG(CategoryName, Warning, TEXT(Format), ##__VA_ARGS__))
+	#define PXR_LOGE(CategoryName, Format, ...) PXR_LOG_IF_COMPILED(CategoryName, E, UE_LOG(CategoryName, Error, TEXT(Format), ##__VA_ARGS__))
+	#define PXR_LOGF(CategoryName, Format, ...) PXR_LOG_IF_COMPILED(CategoryName, F, UE_LOG(CategoryName, Fatal, TEXT(Format), ##__VA_ARGS__))
 
 #elif PLATFORM_ANDROID
 	#define PLATFORM_CHAR(str) TCHAR_TO_UTF8(str)
@@ -19,12 +51,12 @@ DEFINE_LOG_CATEGORY_STATIC(LogMRC, Log, All);
 	#include "Android/AndroidJNI.h"
 	#include "PxrApi.h"
 	#include <android/Log.h>
-	#define PXR_LOGV(TAG, fmt, ...) Pxr_LogPrint(PxrLogPriority::PXR_LOG_VERBOSE, #TAG, fmt, ##__VA_ARGS__)
-	#define PXR_LOGD(TAG, fmt, ...) Pxr_LogPrint(PxrLogPriority::PXR_LOG_DEBUG, #TAG, fmt, ##__VA_ARGS__)
-	#define PXR_LOGI(TAG, fmt, ...) Pxr_LogPrint(PxrLogPriority::PXR_LOG_INFO, #TAG, fmt, ##__VA_ARGS__)
-	#define PXR_LOGW(TAG, fmt, ...) Pxr_LogPrint(PxrLogPriority::PXR_LOG_WARN, #TAG, fmt, ##__VA_ARGS__)
-	#define PXR_LOGE(TAG, fmt, ...) Pxr_LogPrint(PxrLogPriority::PXR_LOG_ERROR, #TAG, fmt, ##__VA_ARGS__)
-	#define PXR_LOGF(TAG, fmt, ...) Pxr_LogPrint(PxrLogPriority::PXR_LOG_FATAL, #TAG, fmt, ##__VA_ARGS__)
+	#define PXR_LOGV(TAG, fmt, ...) PXR_LOG_IF_COMPILED(TAG, V, Pxr_LogPrint(PxrLogPriority::PXR_LOG_VERBOSE, #TAG, fmt, ##__VA_ARGS__))
+	#define PXR_LOGD(TAG, fmt, ...) PXR_LOG_IF_COMPILED(TAG, D, Pxr_LogPrint(PxrLogPriority::PXR_LOG_DEBUG, #TAG, fmt, ##__VA_ARGS__))
+	#define PXR_LOGI(TAG, fmt, ...) PXR_LOG_IF_COMPILED(TAG, I, Pxr_LogPrint(PxrLogPriority::PXR_LOG_INFO, #TAG, fmt, ##__VA_ARGS__))
+	#define PXR_LOGW(TAG, fmt, ...) PXR_LOG_IF_COMPILED(TAG, W, Pxr_LogPrint(PxrLogPriority::PXR_LOG_WARN, #TAG, fmt, ##__VA_ARGS__))
+	#define PXR_LOGE(TAG, fmt, ...) PXR_LOG_IF_COMPILED(TAG, E, Pxr_LogPrint(PxrLogPriority::PXR_LOG_ERROR, #TAG, fmt, ##__VA_ARGS__))
+	#define PXR_LOGF(TAG, fmt, ...) PXR_LOG_IF_COMPILED(TAG, F, Pxr_LogPrint(PxrLogPriority::PXR_LOG_FATAL, #TAG, fmt, ##__VA_ARGS__))
 
 #else
 	#define PLATFORM_CHAR(str) str
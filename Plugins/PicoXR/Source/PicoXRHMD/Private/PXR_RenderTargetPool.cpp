@@ -0,0 +1,227 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_RenderTargetPool.h"
+#include "PXR_HMDModule.h"
+#include "PXR_Log.h"
+#include "RenderUtils.h"
+#include "UObject/Package.h"
+#include "HAL/IConsoleManager.h"
+
+// Enough for the background and foreground of a 4K mixed reality capture.
+#define PXR_RENDER_TARGET_POOL_DEFAULT_BUDGET (96ll * 1024 * 1024)
+
+namespace
+{
+	class FPICOXRDefaultRenderTargetAllocator : public IPICOXRRenderTargetAllocator
+	{
+	public:
+		virtual UTextureRenderTarget2D* CreateTarget(const FPICOXRRenderTargetKey& Key) override
+		{
+			UTextureRenderTarget2D* Target = NewObject<UTextureRenderTarget2D>(GetTransientPackage(), NAME_None, RF_Transient);
+			Target->RenderTargetFormat = Key.Format;
+			Target->ClearColor = Key.ClearColor;
+			Target->AddressX = Key.AddressX;
+			Target->AddressY = Key.AddressY;
+			Target->InitAutoFormat(Key.Size.X, Key.Size.Y);
+			Target->UpdateResourceImmediate(true);
+			PXR_LOGD(PxrUnreal, "Render target pool created %dx%d format:%d", Key.Size.X, Key.Size.Y, static_cast<int32>(Key.Format));
+			return Target;
+		}
+
+		virtual void ReleaseTarget(UTextureRenderTarget2D* Target) override
+		{
+			Target->ReleaseResource();
+		}
+	};
+}
+
+int64 FPICOXRRenderTargetKey::GetSizeBytes() const
+{
+	if (Size.X <= 0 || Size.Y <= 0)
+	{
+		return 0;
+	}
+	return static_cast<int64>(CalcTextureSize(Size.X, Size.Y, GetPixelFormatFromRenderTargetFormat(Format), 1));
+}
+
+TSharedRef<IPICOXRRenderTargetAllocator> IPICOXRRenderTargetAllocator::CreateDefault()
+{
+	return MakeShared<FPICOXRDefaultRenderTargetAllocator>();
+}
+
+FPICOXRRenderTargetPool::FPICOXRRenderTargetPool(TSharedPtr<IPICOXRRenderTargetAllocator> InAllocator)
+	: Allocator(InAllocator.IsValid() ? InAllocator.ToSharedRef() : IPICOXRRenderTargetAllocator::CreateDefault())
+	, BudgetBytes(PXR_RENDER_TARGET_POOL_DEFAULT_BUDGET)
+	, UseCounter(0)
+{
+}
+
+FPICOXRRenderTargetPool::~FPICOXRRenderTargetPool()
+{
+	for (const FEntry& Entry : Entries)
+	{
+		Allocator->ReleaseTarget(Entry.Target);
+	}
+	Entries.Empty();
+}
+
+void FPICOXRRenderTargetPool::SetBudget(int64 InBudgetBytes)
+{
+	BudgetBytes = FMath::Max<int64>(InBudgetBytes, 0);
+	TrimToBudget(0);
+}
+
+UTextureRenderTarget2D* FPICOXRRenderTargetPool::Acquire(const FPICOXRRenderTargetKey& Key)
+{
+	check(IsInGameThread());
+	if (Key.Size.X <= 0 || Key.Size.Y <= 0)
+	{
+		return nullptr;
+	}
+
+	// The most recently used idle target is the most likely to still be resident.
+	int32 Found = INDEX_NONE;
+	for (int32 Index = 0; Index < Entries.Num(); Index++)
+	{
+		const FEntry& Entry = Entries[Index];
+		if (!Entry.bInUse && Entry.Key == Key && (Found == INDEX_NONE || Entry.LastUsed > Entries[Found].LastUsed))
+		{
+			Found = Index;
+		}
+	}
+	if (Found != INDEX_NONE)
+	{
+		FEntry& Entry = Entries[Found];
+		Entry.bInUse = true;
+		Entry.LastUsed = ++UseCounter;
+		Stats.Reuses++;
+		Stats.IdleTargets--;
+		Stats.IdleBytes -= Entry.SizeBytes;
+		Stats.ActiveTargets++;
+		Stats.ActiveBytes += Entry.SizeBytes;
+		return Entry.Target;
+	}
+
+	const int64 SizeBytes = Key.GetSizeBytes();
+	TrimToBudget(SizeBytes);
+	UTextureRenderTarget2D* Target = Allocator->CreateTarget(Key);
+	if (!Target)
+	{
+		return nullptr;
+	}
+
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Target = Target;
+	Entry.Key = Key;
+	Entry.SizeBytes = SizeBytes;
+	Entry.LastUsed = ++UseCounter;
+	Entry.bInUse = true;
+	Stats.Allocations++;
+	Stats.ActiveTargets++;
+	Stats.ActiveBytes += SizeBytes;
+	if (Stats.ActiveBytes + Stats.IdleBytes > BudgetBytes)
+	{
+		Stats.OverBudgetAllocations++;
+		PXR_LOGW(PxrUnreal, "Render target pool over budget: %lld of %lld bytes in use", Stats.ActiveBytes, BudgetBytes);
+	}
+	Stats.PeakBytes = FMath::Max(Stats.PeakBytes, Stats.ActiveBytes + Stats.IdleBytes);
+	return Target;
+}
+
+bool FPICOXRRenderTargetPool::Release(UTextureRenderTarget2D* Target)
+{
+	check(IsInGameThread());
+	FEntry* Entry = Entries.FindByPredicate([Target](const FEntry& Candidate) { return Candidate.Target == Target; });
+	if (!Target || !Entry || !Entry->bInUse)
+	{
+		return false;
+	}
+
+	Entry->bInUse = false;
+	Entry->LastUsed = ++UseCounter;
+	Stats.ActiveTargets--;
+	Stats.ActiveBytes -= Entry->SizeBytes;
+	Stats.IdleTargets++;
+	Stats.IdleBytes += Entry->SizeBytes;
+	TrimToBudget(0);
+	return true;
+}
+
+void FPICOXRRenderTargetPool::Trim(int64 MaxIdleBytes)
+{
+	while (Stats.IdleBytes > MaxIdleBytes)
+	{
+		int32 Oldest = INDEX_NONE;
+		for (int32 Index = 0; Index < Entries.Num(); Index++)
+		{
+			if (!Entries[Index].bInUse && (Oldest == INDEX_NONE || Entries[Index].LastUsed < Entries[Oldest].LastUsed))
+			{
+				Oldest = Index;
+			}
+		}
+		if (Oldest == INDEX_NONE)
+		{
+			break;
+		}
+		Evict(Oldest);
+	}
+}
+
+void FPICOXRRenderTargetPool::ResetStats()
+{
+	const FPICOXRRenderTargetPoolStats Current = Stats;
+	Stats = FPICOXRRenderTargetPoolStats();
+	Stats.ActiveTargets = Current.ActiveTargets;
+	Stats.IdleTargets = Current.IdleTargets;
+	Stats.ActiveBytes = Current.ActiveBytes;
+	Stats.IdleBytes = Current.IdleBytes;
+	Stats.PeakBytes = Current.ActiveBytes + Current.IdleBytes;
+}
+
+void FPICOXRRenderTargetPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (FEntry& Entry : Entries)
+	{
+		Collector.AddReferencedObject(Entry.Target);
+	}
+}
+
+void FPICOXRRenderTargetPool::Evict(int32 EntryIndex)
+{
+	const FEntry Entry = Entries[EntryIndex];
+	Entries.RemoveAtSwap(EntryIndex);
+	Allocator->ReleaseTarget(Entry.Target);
+	Stats.Evictions++;
+	Stats.IdleTargets--;
+	Stats.IdleBytes -= Entry.SizeBytes;
+	PXR_LOGD(PxrUnreal, "Render target pool evicted %dx%d format:%d", Entry.Key.Size.X, Entry.Key.Size.Y, static_cast<int32>(Entry.Key.Format));
+}
+
+void FPICOXRRenderTargetPool::TrimToBudget(int64 ExtraBytes)
+{
+	// Only idle targets can make room, active ones stay until they are released.
+	Trim(FMath::Max<int64>(BudgetBytes - Stats.ActiveBytes - ExtraBytes, 0));
+}
+
+#if !UE_BUILD_SHIPPING
+namespace PICOXRRenderTargetPoolCommands
+{
+	static void LogStats(const TArray<FString>& Args)
+	{
+		FPICOXRRenderTargetPool& Pool = FPICOXRHMDModule::Get().GetRenderTargetPool();
+		if (Args.Num() > 0 && Args[0] == TEXT("flush"))
+		{
+			Pool.Flush();
+		}
+		const FPICOXRRenderTargetPoolStats& Stats = Pool.GetStats();
+		PXR_LOGI(PxrUnreal, "Render target pool: active:%d (%lld bytes) idle:%d (%lld bytes) budget:%lld peak:%lld allocations:%llu reuses:%llu evictions:%llu over budget:%llu",
+			Stats.ActiveTargets, Stats.ActiveBytes, Stats.IdleTargets, Stats.IdleBytes, Pool.GetBudget(), Stats.PeakBytes,
+			Stats.Allocations, Stats.Reuses, Stats.Evictions, Stats.OverBudgetAllocations);
+	}
+
+	static FAutoConsoleCommand LogStatsCommand(
+		TEXT("pxr.RenderTargetPool.Stats"),
+		TEXT("Logs the shared render target pool statistics, 'flush' frees the idle targets first."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&LogStats));
+}
+#endif
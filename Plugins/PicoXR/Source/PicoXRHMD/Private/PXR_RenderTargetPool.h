@@ -0,0 +1,138 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+/** Size, format and sampling a pooled render target is shared by. */
+struct FPICOXRRenderTargetKey
+{
+	FPICOXRRenderTargetKey()
+		: Size(FIntPoint::ZeroValue)
+		, Format(RTF_RGBA8)
+		, ClearColor(FLinearColor::Green)
+		, AddressX(TA_Wrap)
+		, AddressY(TA_Wrap)
+	{}
+
+	/** The clear color and address modes are the defaults of a new UTextureRenderTarget2D. */
+	FPICOXRRenderTargetKey(FIntPoint InSize, ETextureRenderTargetFormat InFormat)
+		: Size(InSize)
+		, Format(InFormat)
+		, ClearColor(FLinearColor::Green)
+		, AddressX(TA_Wrap)
+		, AddressY(TA_Wrap)
+	{}
+
+	/** Takes the clear color and address modes of Template, an authored render target asset. */
+	FPICOXRRenderTargetKey(FIntPoint InSize, ETextureRenderTargetFormat InFormat, const UTextureRenderTarget2D& Template)
+		: Size(InSize)
+		, Format(InFormat)
+		, ClearColor(Template.ClearColor)
+		, AddressX(Template.AddressX)
+		, AddressY(Template.AddressY)
+	{}
+
+	/** GPU memory of one target with this key, without mips. */
+	int64 GetSizeBytes() const;
+
+	bool operator==(const FPICOXRRenderTargetKey& Other) const
+	{
+		return Size == Other.Size && Format == Other.Format && ClearColor == Other.ClearColor && AddressX == Other.AddressX && AddressY == Other.AddressY;
+	}
+	bool operator!=(const FPICOXRRenderTargetKey& Other) const { return !(*this == Other); }
+
+	friend uint32 GetTypeHash(const FPICOXRRenderTargetKey& Key)
+	{
+		const uint32 SamplingHash = HashCombine(GetTypeHash(static_cast<uint8>(Key.AddressX)), GetTypeHash(static_cast<uint8>(Key.AddressY)));
+		return HashCombine(HashCombine(GetTypeHash(Key.Size), GetTypeHash(static_cast<uint8>(Key.Format))), HashCombine(GetTypeHash(Key.ClearColor), SamplingHash));
+	}
+
+	FIntPoint Size;
+	ETextureRenderTargetFormat Format;
+	FLinearColor ClearColor;
+	TextureAddress AddressX;
+	TextureAddress AddressY;
+};
+
+/** Creates and frees the targets of a pool. The default one allocates GPU resources, a fake can be set instead. */
+class IPICOXRRenderTargetAllocator
+{
+public:
+	virtual ~IPICOXRRenderTargetAllocator() {}
+
+	virtual UTextureRenderTarget2D* CreateTarget(const FPICOXRRenderTargetKey& Key) = 0;
+	/** The pool drops its reference afterwards, the object itself is left to the garbage collector. */
+	virtual void ReleaseTarget(UTextureRenderTarget2D* Target) = 0;
+
+	static TSharedRef<IPICOXRRenderTargetAllocator> CreateDefault();
+};
+
+struct FPICOXRRenderTargetPoolStats
+{
+	uint64 Allocations = 0;
+	uint64 Reuses = 0;
+	// Idle targets freed to stay within the budget, or by Trim.
+	uint64 Evictions = 0;
+	// Allocations that went over the budget because every target was in use.
+	uint64 OverBudgetAllocations = 0;
+	int32 ActiveTargets = 0;
+	int32 IdleTargets = 0;
+	int64 ActiveBytes = 0;
+	int64 IdleBytes = 0;
+	int64 PeakBytes = 0;
+};
+
+/**
+ * Render targets kept alive between uses, so features that toggle their captures reuse the same GPU memory.
+ * Released targets stay idle until their key is asked for again or the budget needs the room, oldest first.
+ * Game thread only.
+ */
+class PICOXRHMD_API FPICOXRRenderTargetPool : public FGCObject
+{
+public:
+	/** nullptr uses the default allocator. */
+	explicit FPICOXRRenderTargetPool(TSharedPtr<IPICOXRRenderTargetAllocator> InAllocator = nullptr);
+	virtual ~FPICOXRRenderTargetPool();
+
+	/** Bytes the active and idle targets may take together, idle targets are evicted beyond it. */
+	void SetBudget(int64 InBudgetBytes);
+	int64 GetBudget() const { return BudgetBytes; }
+
+	/** Returns an idle target with the key if there is one, or a new one. The caller owns it until Release. */
+	UTextureRenderTarget2D* Acquire(const FPICOXRRenderTargetKey& Key);
+
+	/** Hands the target back to the pool, still allocated. @return false if the target is not an active one of this pool. */
+	bool Release(UTextureRenderTarget2D* Target);
+
+	/** Evicts idle targets, oldest first, until they take at most MaxIdleBytes. */
+	void Trim(int64 MaxIdleBytes);
+	void Flush() { Trim(0); }
+
+	const FPICOXRRenderTargetPoolStats& GetStats() const { return Stats; }
+	void ResetStats();
+
+	//~ FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FPICOXRRenderTargetPool"); }
+
+private:
+	struct FEntry
+	{
+		UTextureRenderTarget2D* Target;
+		FPICOXRRenderTargetKey Key;
+		int64 SizeBytes;
+		uint64 LastUsed;
+		bool bInUse;
+	};
+
+	void Evict(int32 EntryIndex);
+	void TrimToBudget(int64 ExtraBytes);
+
+	TSharedRef<IPICOXRRenderTargetAllocator> Allocator;
+	TArray<FEntry> Entries;
+	FPICOXRRenderTargetPoolStats Stats;
+	int64 BudgetBytes;
+	uint64 UseCounter;
+};
@@ -15,12 +15,17 @@ UPICOXRSettings::UPICOXRSettings(const FObjectInitializer& ObjectInitializer)
 	NeckOffset(FVector::ZeroVector),
 	bEnableHomeKey(false),
 	bIsController3Dof(false),
+	bEnableButtonRepeat(false),
+	ButtonRepeatDelay(0.2f),
+	ButtonRepeatInterval(0.1f),
+	AnalogDeadband(0.002f),
 	HandTrackingSupport(EPICOXRHandTrackingSupport::ControllersOnly),
 	bEnableLateLatching(false),
 	bUseHWsRGBEncoding(true),
 	bUseRecommendedMSAA(false),
 	bEnableFoveation(false),
 	FoveationLevel(EFoveationLevel::Low),
+	bEnableDynamicFoveation(false),
 	bEnableEyeTracking(false),
 	bEnableFaceTracking(false),
 	bEnableEyeTrackingMarker(false),
@@ -63,6 +63,18 @@ public:
 
 	UPROPERTY(Config, EditAnywhere, Category = Controller, Meta = (DisplayName = "Controller Only Tracking Rotation"))
 		bool bIsController3Dof;
+
+	UPROPERTY(Config, EditAnywhere, Category = Controller, Meta = (DisplayName = "Repeat Held Buttons", ToolTip = "Send repeated press events while a controller button is held."))
+		bool bEnableButtonRepeat;
+
+	UPROPERTY(Config, EditAnywhere, Category = Controller, Meta = (EditCondition = "bEnableButtonRepeat", DisplayName = "Button Repeat Delay", ClampMin = "0.0", ToolTip = "Seconds from the press to the first repeat."))
+		float ButtonRepeatDelay;
+
+	UPROPERTY(Config, EditAnywhere, Category = Controller, Meta = (EditCondition = "bEnableButtonRepeat", DisplayName = "Button Repeat Interval", ClampMin = "0.01", ToolTip = "Seconds between repeats."))
+		float ButtonRepeatInterval;
+
+	UPROPERTY(Config, EditAnywhere, Category = Controller, Meta = (DisplayName = "Analog Deadband", ClampMin = "0.0", ClampMax = "0.5", ToolTip = "Thumbstick, trigger and grip changes smaller than this are not sent. Reaching rest or full scale is always sent."))
+		float AnalogDeadband;
 	/** Whether controllers and/or hands can be used with the app */
 	UPROPERTY(Config, EditAnywhere, Category = Controller, Meta = (DisplayName = "HandTracking Support"))
 	EPICOXRHandTrackingSupport HandTrackingSupport;
@@ -82,6 +94,9 @@ public:
 	UPROPERTY(Config, EditAnywhere, Category = Feature, Meta = (EditCondition = "bEnableFoveation", DisplayName = "Foveation Level"))
 		TEnumAsByte<EFoveationLevel::Type> FoveationLevel;
 
+	UPROPERTY(Config, EditAnywhere, Category = Feature, Meta = (EditCondition = "bEnableFoveation", DisplayName = "Enable Dynamic Foveation", ToolTip = "Choose the foveation level every frame from eye tracking and GPU headroom. Foveation Level is used while the gaze is not tracked."))
+		bool bEnableDynamicFoveation;
+
 	UPROPERTY(Config, EditAnywhere, Category = Feature, Meta = (DisplayName = "Enable Eye Tracking", ToolTip = "Enable Eye Tracking"))
 		bool bEnableEyeTracking;
 
@@ -0,0 +1,223 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_StencilMeshCache.h"
+#include "PXR_Log.h"
+
+#if PLATFORM_ANDROID
+#include "PxrApi.h"
+#endif
+
+#define RM_R  1.04f
+#define RM_P0 0.52f
+#define RM_P1 0.90666f
+
+namespace
+{
+	class FPICOXRRuntimeStencilMeshSource : public IPICOXRStencilMeshSource
+	{
+	public:
+		virtual bool GetStencilMesh(int32 Eye, FPICOXRStencilMeshData& OutData) override
+		{
+			// The runtime of this SDK does not report stencil meshes yet, Pxr_GetStencilmesh will fill OutData once it does.
+			OutData = FPICOXRStencilMeshData();
+			return false;
+		}
+	};
+
+	// Viewport position of a point in clipping space, points outside the viewport are moved onto its border.
+	FVector2D ClipToViewport(const FVector2D& Clip)
+	{
+		return FVector2D((FMath::Clamp(Clip.X, -1.0f, 1.0f) + 1.0f) * 0.5f, (1.0f - FMath::Clamp(Clip.Y, -1.0f, 1.0f)) * 0.5f);
+	}
+}
+
+TSharedRef<IPICOXRStencilMeshSource> IPICOXRStencilMeshSource::CreateDefault()
+{
+	return MakeShared<FPICOXRRuntimeStencilMeshSource>();
+}
+
+FPICOXRStencilMeshCache::FPICOXRStencilMeshCache(TSharedPtr<IPICOXRStencilMeshSource> InSource)
+	: Source(InSource.IsValid() ? InSource.ToSharedRef() : IPICOXRStencilMeshSource::CreateDefault())
+{
+}
+
+void FPICOXRStencilMeshCache::SetSource(TSharedPtr<IPICOXRStencilMeshSource> InSource)
+{
+	Source = InSource.IsValid() ? InSource.ToSharedRef() : IPICOXRStencilMeshSource::CreateDefault();
+	Meshes.Empty();
+}
+
+FPICOXRStencilMeshPtr FPICOXRStencilMeshCache::Find(const FPICOXRStencilMeshKey& Key)
+{
+	if (const FPICOXRStencilMeshPtr* Found = Meshes.Find(Key))
+	{
+		Stats.Hits++;
+		return *Found;
+	}
+
+	FPICOXRStencilMeshData Data;
+	if (Key.Type == EPICOXRStencilMeshType::Runtime)
+	{
+		Source->GetStencilMesh(Key.Eye, Data);
+	}
+	else
+	{
+		GetDebugMeshData(Key.Eye, Key.Type == EPICOXRStencilMeshType::DebugEyeSpecified, Data);
+	}
+
+	TSharedRef<FPICOXRStencilMesh, ESPMode::ThreadSafe> Mesh = MakeShared<FPICOXRStencilMesh, ESPMode::ThreadSafe>();
+	if (!BuildMesh(Data, Key.FOV, *Mesh))
+	{
+		Stats.Failures++;
+		PXR_LOGD(PxrUnreal, "No stencil mesh for eye %d, type %d: %d vertices, %d indices", Key.Eye, (int32)Key.Type, Data.Vertices.Num(), Data.Indices.Num());
+		return nullptr;
+	}
+
+	Stats.Builds++;
+	Meshes.Add(Key, Mesh);
+	return Mesh;
+}
+
+bool FPICOXRStencilMeshCache::BuildMesh(const FPICOXRStencilMeshData& Data, float FOV, FPICOXRStencilMesh& OutMesh)
+{
+	OutMesh = FPICOXRStencilMesh();
+	const int32 NumVertices = Data.Vertices.Num();
+	if (NumVertices < 3 || Data.Indices.Num() < 3 || Data.Indices.Num() % 3 != 0)
+	{
+		return false;
+	}
+	TArray<bool> Used;
+	Used.SetNumZeroed(NumVertices);
+	for (int32 Index : Data.Indices)
+	{
+		if (Index < 0 || Index >= NumVertices)
+		{
+			return false;
+		}
+		Used[Index] = true;
+	}
+
+	// On the near plane of a symmetric frustum, clipping space scales with the tangent of half the field of view.
+	const float Tangent = FMath::Tan(FMath::DegreesToRadians(FMath::Clamp(FOV, 1.0f, 179.0f) * 0.5f));
+	OutMesh.Vertices.Reserve(NumVertices);
+	OutMesh.Normals.Reserve(NumVertices);
+	OutMesh.UVs.Reserve(NumVertices);
+	OutMesh.Colors.Reserve(NumVertices);
+	OutMesh.Tangents.Reserve(NumVertices);
+	for (const FVector2D& Vertex : Data.Vertices)
+	{
+		OutMesh.Vertices.Add(FVector(0.0f, Vertex.X * Tangent, Vertex.Y * Tangent));
+		OutMesh.Normals.Add(FVector(-1.0f, 0.0f, 0.0f));
+		OutMesh.UVs.Add(FVector2D(0.0f, 0.0f));
+		OutMesh.Colors.Add(FLinearColor::Black);
+		OutMesh.Tangents.Add(FProcMeshTangent(0.0f, 1.0f, 0.0f));
+	}
+	OutMesh.Triangles = Data.Indices;
+
+	OutMesh.HiddenArea.Reserve(Data.Indices.Num());
+	for (int32 Index : Data.Indices)
+	{
+		OutMesh.HiddenArea.Add(ClipToViewport(Data.Vertices[Index]));
+	}
+
+	// Used vertices by angle around the eye centre, without the viewport corners and the centre itself.
+	TArray<TPair<float, FVector2D>> Outline;
+	for (int32 Index = 0; Index < NumVertices; Index++)
+	{
+		const FVector2D Clip(FMath::Clamp(Data.Vertices[Index].X, -1.0f, 1.0f), FMath::Clamp(Data.Vertices[Index].Y, -1.0f, 1.0f));
+		const bool bCorner = FMath::Abs(Clip.X) >= 1.0f && FMath::Abs(Clip.Y) >= 1.0f;
+		if (Used[Index] && !bCorner && Clip.SizeSquared() > KINDA_SMALL_NUMBER)
+		{
+			Outline.Emplace(FMath::Atan2(Clip.Y, Clip.X), Clip);
+		}
+	}
+	Outline.Sort([](const TPair<float, FVector2D>& A, const TPair<float, FVector2D>& B) { return A.Key < B.Key; });
+
+	// A gap of half a turn or more means the mask does not surround the centre, the fan would miss part of the visible area.
+	bool bSurrounded = Outline.Num() >= 3;
+	for (int32 Index = 0; Index < Outline.Num() && bSurrounded; Index++)
+	{
+		const float Gap = Index + 1 < Outline.Num() ? Outline[Index + 1].Key - Outline[Index].Key : Outline[0].Key + 2.0f * PI - Outline[Index].Key;
+		bSurrounded = Gap < PI;
+	}
+
+	if (bSurrounded)
+	{
+		OutMesh.VisibleArea.Reserve(Outline.Num() * 3);
+		for (int32 Index = 0; Index < Outline.Num(); Index++)
+		{
+			OutMesh.VisibleArea.Add(FVector2D(0.5f, 0.5f));
+			OutMesh.VisibleArea.Add(ClipToViewport(Outline[Index].Value));
+			OutMesh.VisibleArea.Add(ClipToViewport(Outline[(Index + 1) % Outline.Num()].Value));
+		}
+	}
+	else
+	{
+		const FVector2D Corners[] = { FVector2D(0.0f, 0.0f), FVector2D(1.0f, 0.0f), FVector2D(1.0f, 1.0f), FVector2D(0.0f, 1.0f) };
+		OutMesh.VisibleArea = { Corners[0], Corners[1], Corners[2], Corners[0], Corners[2], Corners[3] };
+	}
+	return true;
+}
+
+void FPICOXRStencilMeshCache::GetDebugMeshData(int32 Eye, bool bEyeSpecified, FPICOXRStencilMeshData& OutData)
+{
+	/**
+	*   15    11   0    1     12
+	*   +----------+----------+
+	*   |    _+    |    +_    |
+	*   |  -   -   |   -   -  |
+	* 10| + _   -  |  -   _ + |2
+	*   |-    -  - | -  -     |
+	*  9+----------*----------+3
+	*   |-   _ - - | - - _   -|
+	*  8| +     -  |  -     + |4
+	*   |  -_  -   |   -  _-  |
+	*   |    -+_   |   _+-    |
+	*   +----------+----------+
+	*   14    7    6    5     13
+	*
+	**/
+	OutData.Vertices = {
+		// Circle start from Top
+		FVector2D(0.0f, RM_R),     // 0
+		FVector2D(RM_P0, RM_P1),   // 1
+		FVector2D(RM_P1, RM_P0),   // 2
+		FVector2D(RM_R, 0.0f),     // 3
+		FVector2D(RM_P1, -RM_P0),  // 4
+		FVector2D(RM_P0, -RM_P1),  // 5
+		FVector2D(0.0f, -RM_R),    // 6
+		FVector2D(-RM_P0, -RM_P1), // 7
+		FVector2D(-RM_P1, -RM_P0), // 8
+		FVector2D(-RM_R, 0.0f),    // 9
+		FVector2D(-RM_P1, RM_P0),  // 10
+		FVector2D(-RM_P0, RM_P1),  // 11
+
+		// Corner
+		FVector2D(RM_R, RM_R),     // 12
+		FVector2D(RM_R, -RM_R),    // 13
+		FVector2D(-RM_R, -RM_R),   // 14
+		FVector2D(-RM_R, RM_R),    // 15
+	};
+
+	OutData.Indices = {
+		0, 1, 12,
+		1, 2, 12,
+		2, 3, 12,
+		3, 4, 13,
+		4, 5, 13,
+		5, 6, 13,
+		6, 7, 14,
+		7, 8, 14,
+		8, 9, 14,
+		9, 10, 15,
+		10, 11, 15,
+		11, 0, 15,
+	};
+
+	if (bEyeSpecified)
+	{
+		// Centre, and a triangle towards the nose.
+		OutData.Vertices.Add(FVector2D(0.0f, 0.0f));
+		OutData.Indices.Append(Eye == 0 ? TArray<int32>{ 16, 5, 4 } : TArray<int32>{ 16, 8, 7 });
+	}
+}
@@ -0,0 +1,125 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+
+/** Which stencil mesh to build for an eye. */
+enum class EPICOXRStencilMeshType : uint8
+{
+	// Mesh the runtime reports for the lens.
+	Runtime,
+	// Ring shown in the editor and on devices without a render mask.
+	Debug,
+	// Debug ring plus a triangle that tells the eyes apart.
+	DebugEyeSpecified,
+};
+
+/**
+ * Stencil mesh as the runtime reports it: triangles covering the area hidden by the lens.
+ * Vertices are on the near plane in right hand rule clipping space, so only X and Y are kept.
+ */
+struct FPICOXRStencilMeshData
+{
+	TArray<FVector2D> Vertices;
+	TArray<int32> Indices;
+};
+
+/** Source of the runtime stencil meshes. The default one calls the runtime, a fake can be set on the cache instead. */
+class IPICOXRStencilMeshSource
+{
+public:
+	virtual ~IPICOXRStencilMeshSource() {}
+
+	/** @return false if the runtime has no mesh for Eye. */
+	virtual bool GetStencilMesh(int32 Eye, FPICOXRStencilMeshData& OutData) = 0;
+
+	static TSharedRef<IPICOXRStencilMeshSource> CreateDefault();
+};
+
+struct FPICOXRStencilMeshKey
+{
+	int32 Eye = 0;
+	// Horizontal and vertical field of view in degrees.
+	float FOV = 90.0f;
+	EPICOXRStencilMeshType Type = EPICOXRStencilMeshType::Runtime;
+
+	FPICOXRStencilMeshKey() {}
+	FPICOXRStencilMeshKey(int32 InEye, float InFOV, EPICOXRStencilMeshType InType)
+		: Eye(InEye), FOV(InFOV), Type(InType) {}
+
+	bool operator==(const FPICOXRStencilMeshKey& Other) const
+	{
+		return Eye == Other.Eye && FOV == Other.FOV && Type == Other.Type;
+	}
+
+	friend uint32 GetTypeHash(const FPICOXRStencilMeshKey& Key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Key.Eye), GetTypeHash(Key.FOV)), GetTypeHash((uint8)Key.Type));
+	}
+};
+
+/** Stencil mesh of one eye, built once and shared read only by everyone drawing it. */
+struct FPICOXRStencilMesh
+{
+	// Procedural mesh section on the plane one unit in front of the eye, X forward, Y right and Z up.
+	// Scale Y and Z by the distance of the plane to place it elsewhere.
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<FLinearColor> Colors;
+	TArray<FProcMeshTangent> Tangents;
+
+	// Triangle lists in viewport space, 0 to 1 with Y down, as FHMDViewMesh takes them.
+	TArray<FVector2D> HiddenArea;
+	// Fan around the eye centre through the vertices of the hidden area. It covers every visible pixel of
+	// a mask that is star shaped around the centre, and may cover some hidden ones too.
+	TArray<FVector2D> VisibleArea;
+};
+
+typedef TSharedPtr<const FPICOXRStencilMesh, ESPMode::ThreadSafe> FPICOXRStencilMeshPtr;
+
+struct FPICOXRStencilMeshCacheStats
+{
+	uint32 Builds = 0;
+	uint32 Hits = 0;
+	// Lookups the source had no valid mesh for.
+	uint32 Failures = 0;
+};
+
+/**
+ * Stencil meshes keyed by eye, field of view and type, built on first use and kept until the cache is emptied.
+ * Game thread only, the meshes themselves can be handed to other threads.
+ */
+class FPICOXRStencilMeshCache
+{
+public:
+	explicit FPICOXRStencilMeshCache(TSharedPtr<IPICOXRStencilMeshSource> InSource = nullptr);
+
+	/** Replaces the runtime mesh source, nullptr restores the default. Drops the cached meshes. */
+	void SetSource(TSharedPtr<IPICOXRStencilMeshSource> InSource);
+
+	/** @return the mesh for Key, or nullptr if there is no valid data for it. Failed lookups are retried next time. */
+	FPICOXRStencilMeshPtr Find(const FPICOXRStencilMeshKey& Key);
+
+	void Empty() { Meshes.Empty(); }
+	int32 Num() const { return Meshes.Num(); }
+
+	const FPICOXRStencilMeshCacheStats& GetStats() const { return Stats; }
+	void ResetStats() { Stats = FPICOXRStencilMeshCacheStats(); }
+
+	/**
+	 * Builds the mesh of one eye from raw stencil data seen through a symmetric frustum of FOV degrees.
+	 * @return false if the data has no triangle or an index out of range.
+	 */
+	static bool BuildMesh(const FPICOXRStencilMeshData& Data, float FOV, FPICOXRStencilMesh& OutMesh);
+
+	/** Raw data of the debug ring, the eye specified one adds a triangle towards the nose. */
+	static void GetDebugMeshData(int32 Eye, bool bEyeSpecified, FPICOXRStencilMeshData& OutData);
+
+private:
+	TSharedRef<IPICOXRStencilMeshSource> Source;
+	TMap<FPICOXRStencilMeshKey, FPICOXRStencilMeshPtr> Meshes;
+	FPICOXRStencilMeshCacheStats Stats;
+};
@@ -7,6 +7,7 @@
 #include "PXR_Utils.h"
 #include "GameFramework/PlayerController.h"
 #include "PXR_Log.h"
+#include "PXR_Trace.h"
 #include "Materials/Material.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "XRThreadUtils.h"
@@ -627,7 +628,7 @@ void FPICOXRStereoLayer::IncrementSwapChainIndex_RHIThread(FPICOXRRenderBridge*
 
 void FPICOXRStereoLayer::SubmitLayer_RHIThread(FPXRGameFrame* Frame)
 {
-	PXR_LOGV(PxrUnreal, "Submit Layer:%u", ID);
+	PXR_TRACE(SubmitLayer, Frame->FrameNumber, ID);
 #if PLATFORM_ANDROID
 	if (ID == 0)
 	{
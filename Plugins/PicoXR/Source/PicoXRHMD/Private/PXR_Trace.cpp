@@ -0,0 +1,275 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_Trace.h"
+#include "PXR_Log.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#define PXR_TRACE_FILE_MAGIC 0x54525850
+#define PXR_TRACE_FILE_VERSION 1
+
+namespace
+{
+	EPICOXRTraceThread GetCurrentTraceThread()
+	{
+		if (IsInGameThread())
+		{
+			return EPICOXRTraceThread::Game;
+		}
+		if (IsInRHIThread())
+		{
+			return EPICOXRTraceThread::RHI;
+		}
+		return IsInRenderingThread() ? EPICOXRTraceThread::Render : EPICOXRTraceThread::Other;
+	}
+
+	void SerializeRecord(FArchive& Ar, FPICOXRTraceRecord& Record)
+	{
+		Ar << Record.Cycles;
+		Ar << Record.Payload;
+		Ar << Record.FrameNumber;
+		Ar << Record.Event;
+		Ar << Record.Thread;
+		Ar << Record.Reserved;
+	}
+}
+
+FPICOXRTraceRing::FPICOXRTraceRing(uint32 Capacity)
+	: Mask(FMath::RoundUpToPowerOfTwo(FMath::Max(Capacity, 2u)) - 1)
+	, Head(0)
+	, Dropped(0)
+{
+	Slots = MakeUnique<FSlot[]>(Mask + 1);
+	for (uint32 Index = 0; Index <= Mask; Index++)
+	{
+		Slots[Index].Sequence.Store(0);
+	}
+}
+
+void FPICOXRTraceRing::Record(EPICOXRTraceEvent Event, uint32 FrameNumber, uint64 Payload)
+{
+	FPICOXRTraceRecord NewRecord;
+	NewRecord.Cycles = FPlatformTime::Cycles64();
+	NewRecord.Payload = Payload;
+	NewRecord.FrameNumber = FrameNumber;
+	NewRecord.Event = (uint16)Event;
+	NewRecord.Thread = (uint8)GetCurrentTraceThread();
+	Record(NewRecord);
+}
+
+void FPICOXRTraceRing::Record(const FPICOXRTraceRecord& InRecord)
+{
+	const uint64 Index = Head.IncrementExchange();
+	FSlot& Slot = Slots[Index & Mask];
+	// The slot is ours only while it holds an older record written in full, not one being written or a newer one.
+	const uint64 Claimed = Index * 2 + 1;
+	uint64 Current = Slot.Sequence.Load();
+	do
+	{
+		if ((Current & 1) != 0 || Current > Claimed)
+		{
+			Dropped.IncrementExchange();
+			return;
+		}
+	}
+	while (!Slot.Sequence.CompareExchange(Current, Claimed));
+	FPlatformMisc::MemoryBarrier();
+	Slot.Record = InRecord;
+	FPlatformMisc::MemoryBarrier();
+	Slot.Sequence.Store(Index * 2 + 2);
+}
+
+void FPICOXRTraceRing::Snapshot(TArray<FPICOXRTraceRecord>& OutRecords) const
+{
+	const uint64 End = Head.Load();
+	const uint64 Begin = End > GetCapacity() ? End - GetCapacity() : 0;
+	OutRecords.Reset((int32)(End - Begin));
+	for (uint64 Index = Begin; Index < End; Index++)
+	{
+		const FSlot& Slot = Slots[Index & Mask];
+		const uint64 Written = Index * 2 + 2;
+		if (Slot.Sequence.Load() != Written)
+		{
+			continue;
+		}
+		const FPICOXRTraceRecord Copy = Slot.Record;
+		FPlatformMisc::MemoryBarrier();
+		if (Slot.Sequence.Load() == Written)
+		{
+			OutRecords.Add(Copy);
+		}
+	}
+}
+
+FPICOXRTraceRing& FPICOXRTraceRing::Get()
+{
+	static FPICOXRTraceRing Ring;
+	return Ring;
+}
+
+void FPICOXRTraceFile::Write(const TArray<FPICOXRTraceRecord>& Records, double SecondsPerCycle, TArray<uint8>& OutData)
+{
+	OutData.Reset();
+	FMemoryWriter Writer(OutData);
+	uint32 Magic = PXR_TRACE_FILE_MAGIC;
+	int32 Version = PXR_TRACE_FILE_VERSION;
+	int32 NumRecords = Records.Num();
+	Writer << Magic;
+	Writer << Version;
+	Writer << SecondsPerCycle;
+	Writer << NumRecords;
+	for (FPICOXRTraceRecord Record : Records)
+	{
+		SerializeRecord(Writer, Record);
+	}
+}
+
+bool FPICOXRTraceFile::Read(const TArray<uint8>& Data, TArray<FPICOXRTraceRecord>& OutRecords, double& OutSecondsPerCycle, FString* OutError)
+{
+	// Records have a fixed size, anything else is from another version or truncated.
+	static const int32 RecordSize = []()
+	{
+		TArray<uint8> Single;
+		Write(TArray<FPICOXRTraceRecord>({ FPICOXRTraceRecord() }), 1.0, Single);
+		TArray<uint8> Empty;
+		Write(TArray<FPICOXRTraceRecord>(), 1.0, Empty);
+		return Single.Num() - Empty.Num();
+	}();
+
+	FMemoryReader Reader(Data);
+	uint32 Magic = 0;
+	int32 Version = 0;
+	double SecondsPerCycle = 0.0;
+	int32 NumRecords = 0;
+	Reader << Magic;
+	Reader << Version;
+	if (Reader.IsError() || Magic != PXR_TRACE_FILE_MAGIC || Version != PXR_TRACE_FILE_VERSION)
+	{
+		if (OutError)
+		{
+			*OutError = FString::Printf(TEXT("not a trace of version %d"), PXR_TRACE_FILE_VERSION);
+		}
+		return false;
+	}
+	Reader << SecondsPerCycle;
+	Reader << NumRecords;
+	if (Reader.IsError() || NumRecords < 0 || Reader.TotalSize() - Reader.Tell() != (int64)NumRecords * RecordSize || SecondsPerCycle <= 0.0)
+	{
+		if (OutError)
+		{
+			*OutError = FString::Printf(TEXT("%d bytes do not hold %d records"), Data.Num(), NumRecords);
+		}
+		return false;
+	}
+
+	OutRecords.Reset(NumRecords);
+	for (int32 Index = 0; Index < NumRecords; Index++)
+	{
+		FPICOXRTraceRecord Record;
+		SerializeRecord(Reader, Record);
+		OutRecords.Add(Record);
+	}
+	OutSecondsPerCycle = SecondsPerCycle;
+	return true;
+}
+
+void FPICOXRTraceFile::Decode(const TArray<FPICOXRTraceRecord>& Records, double SecondsPerCycle, TArray<FString>& OutLines)
+{
+	OutLines.Reset(Records.Num());
+	const uint64 FirstCycles = Records.Num() > 0 ? Records[0].Cycles : 0;
+	for (const FPICOXRTraceRecord& Record : Records)
+	{
+		// Records from different threads can be slightly out of order.
+		const double Milliseconds = ((double)Record.Cycles - (double)FirstCycles) * SecondsPerCycle * 1000.0;
+		OutLines.Add(FString::Printf(TEXT("%12.3f ms  frame %8u  %-6s  %-16s  %llu"), Milliseconds, Record.FrameNumber, GetThreadName(Record.Thread), GetEventName(Record.Event), Record.Payload));
+	}
+}
+
+const TCHAR* FPICOXRTraceFile::GetEventName(uint16 Event)
+{
+	static const TCHAR* Names[] =
+	{
+		TEXT("None"),
+		TEXT("WaitFrame"),
+		TEXT("WaitFrameWakeUp"),
+		TEXT("WaitFrameSkipped"),
+		TEXT("GameFrameEnd"),
+		TEXT("RenderFrameBegin"),
+		TEXT("UpdateSensor"),
+		TEXT("LateLatch"),
+		TEXT("GetCurrentPose"),
+		TEXT("ControllerPose"),
+		TEXT("RHIBeginFrame"),
+		TEXT("SubmitLayer"),
+		TEXT("RHIEndFrame"),
+		TEXT("EncodeSubmit"),
+		TEXT("EncodeOutput"),
+		TEXT("EncodeDropped"),
+		TEXT("EncodeBufferGrow"),
+	};
+	static_assert(UE_ARRAY_COUNT(Names) == (int32)EPICOXRTraceEvent::Count, "Every trace event needs a name");
+	return Event < UE_ARRAY_COUNT(Names) ? Names[Event] : TEXT("Unknown");
+}
+
+const TCHAR* FPICOXRTraceFile::GetThreadName(uint8 Thread)
+{
+	static const TCHAR* Names[] = { TEXT("Game"), TEXT("Render"), TEXT("RHI"), TEXT("Other") };
+	return Thread < UE_ARRAY_COUNT(Names) ? Names[Thread] : TEXT("Unknown");
+}
+
+#if !UE_BUILD_SHIPPING
+namespace PICOXRTraceCommands
+{
+	static FString GetDefaultPath()
+	{
+		return FPaths::ProjectSavedDir() / TEXT("PICOXR") / TEXT("pxr_trace.bin");
+	}
+
+	static void Dump(const TArray<FString>& Args)
+	{
+		const FString Path = Args.Num() > 0 ? Args[0] : GetDefaultPath();
+		TArray<FPICOXRTraceRecord> Records;
+		FPICOXRTraceRing::Get().Snapshot(Records);
+		TArray<uint8> Data;
+		FPICOXRTraceFile::Write(Records, FPlatformTime::GetSecondsPerCycle64(), Data);
+		if (!FFileHelper::SaveArrayToFile(Data, *Path))
+		{
+			PXR_LOGE(PxrUnreal, "Could not write the trace to %s", PLATFORM_CHAR(*Path));
+			return;
+		}
+		PXR_LOGI(PxrUnreal, "Wrote %d trace records of %llu to %s", Records.Num(), FPICOXRTraceRing::Get().GetNumRecorded(), PLATFORM_CHAR(*Path));
+	}
+
+	static void Decode(const TArray<FString>& Args)
+	{
+		const FString Path = Args.Num() > 0 ? Args[0] : GetDefaultPath();
+		TArray<uint8> Data;
+		TArray<FPICOXRTraceRecord> Records;
+		double SecondsPerCycle = 0.0;
+		FString Error;
+		if (!FFileHelper::LoadFileToArray(Data, *Path) || !FPICOXRTraceFile::Read(Data, Records, SecondsPerCycle, &Error))
+		{
+			PXR_LOGE(PxrUnreal, "Could not read the trace %s: %s", PLATFORM_CHAR(*Path), PLATFORM_CHAR(*Error));
+			return;
+		}
+		TArray<FString> Lines;
+		FPICOXRTraceFile::Decode(Records, SecondsPerCycle, Lines);
+		const FString TextPath = FPaths::ChangeExtension(Path, TEXT("txt"));
+		FFileHelper::SaveStringArrayToFile(Lines, *TextPath);
+		PXR_LOGI(PxrUnreal, "Decoded %d trace records to %s", Records.Num(), PLATFORM_CHAR(*TextPath));
+	}
+
+	static FAutoConsoleCommand DumpCommand(
+		TEXT("pxr.Trace.Dump"),
+		TEXT("Writes the frame pipeline trace ring to a file, Saved/PICOXR/pxr_trace.bin unless a path is given."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Dump));
+
+	static FAutoConsoleCommand DecodeCommand(
+		TEXT("pxr.Trace.Decode"),
+		TEXT("Decodes a trace file, Saved/PICOXR/pxr_trace.bin unless a path is given, into a text file next to it."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Decode));
+}
+#endif
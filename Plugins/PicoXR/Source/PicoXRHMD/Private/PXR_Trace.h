@@ -0,0 +1,121 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+
+// Define as 0 from a Build.cs to compile every PXR_TRACE out, arguments included.
+#ifndef PXR_TRACE_ENABLED
+#define PXR_TRACE_ENABLED !UE_BUILD_SHIPPING
+#endif
+
+/** Frame pipeline events. Only ever append, traces store the values and are decoded later. */
+enum class EPICOXRTraceEvent : uint16
+{
+	None,
+	WaitFrame,
+	// Payload: predicted display time in microseconds.
+	WaitFrameWakeUp,
+	WaitFrameSkipped,
+	GameFrameEnd,
+	RenderFrameBegin,
+	// Payload: sensor view number.
+	UpdateSensor,
+	LateLatch,
+	GetCurrentPose,
+	ControllerPose,
+	RHIBeginFrame,
+	// Payload: layer id.
+	SubmitLayer,
+	// Payload: sensor view number.
+	RHIEndFrame,
+	// Direct preview encoder. Payload: 1 for a key frame.
+	EncodeSubmit,
+	// Payload: submit to output in microseconds.
+	EncodeOutput,
+	// Payload: 0 with too many frames in flight, 1 when rejected or lost by the encoder.
+	EncodeDropped,
+	// Payload: bytes an output buffer grew by.
+	EncodeBufferGrow,
+	Count
+};
+
+enum class EPICOXRTraceThread : uint8
+{
+	Game,
+	Render,
+	RHI,
+	Other,
+};
+
+/** One event, as kept in the ring and in trace files. */
+struct FPICOXRTraceRecord
+{
+	uint64 Cycles = 0;
+	uint64 Payload = 0;
+	uint32 FrameNumber = 0;
+	uint16 Event = 0;
+	uint8 Thread = 0;
+	uint8 Reserved = 0;
+};
+
+/**
+ * Fixed size ring of trace records, written without locks from any thread and overwriting the oldest.
+ * Every slot carries the sequence number of its record, readers skip slots that are written or overwritten while they read.
+ * Recording costs an atomic increment, a compare-exchange claiming the slot and a 24 byte copy, nothing is formatted.
+ * A writer finding its slot still being written by a writer a lap behind, or already holding a newer record, drops its record.
+ */
+class PICOXRHMD_API FPICOXRTraceRing : public FNoncopyable
+{
+public:
+	/** Capacity is rounded up to a power of two. */
+	explicit FPICOXRTraceRing(uint32 Capacity = 8192);
+
+	/** Records Event now, on the calling thread. */
+	void Record(EPICOXRTraceEvent Event, uint32 FrameNumber, uint64 Payload = 0);
+	void Record(const FPICOXRTraceRecord& InRecord);
+
+	/** Copies the complete records still in the ring, oldest first. */
+	void Snapshot(TArray<FPICOXRTraceRecord>& OutRecords) const;
+
+	uint32 GetCapacity() const { return Mask + 1; }
+	uint64 GetNumRecorded() const { return Head.Load(); }
+	uint64 GetNumDropped() const { return Dropped.Load(); }
+
+	/** Ring the PXR_TRACE macro records into. */
+	static FPICOXRTraceRing& Get();
+
+private:
+	struct FSlot
+	{
+		// Twice the record index plus one while writing, plus two once written, 0 for never written.
+		TAtomic<uint64> Sequence;
+		FPICOXRTraceRecord Record;
+	};
+
+	TUniquePtr<FSlot[]> Slots;
+	uint32 Mask;
+	TAtomic<uint64> Head;
+	TAtomic<uint64> Dropped;
+};
+
+/** Trace file layout, decoding works on files pulled from a device on any platform. */
+struct PICOXRHMD_API FPICOXRTraceFile
+{
+	static void Write(const TArray<FPICOXRTraceRecord>& Records, double SecondsPerCycle, TArray<uint8>& OutData);
+
+	/** @return false if Data is not a complete trace of a known version. */
+	static bool Read(const TArray<uint8>& Data, TArray<FPICOXRTraceRecord>& OutRecords, double& OutSecondsPerCycle, FString* OutError = nullptr);
+
+	/** One line per record, with the time in milliseconds since the first one. */
+	static void Decode(const TArray<FPICOXRTraceRecord>& Records, double SecondsPerCycle, TArray<FString>& OutLines);
+
+	static const TCHAR* GetEventName(uint16 Event);
+	static const TCHAR* GetThreadName(uint8 Thread);
+};
+
+#if PXR_TRACE_ENABLED
+	#define PXR_TRACE(Event, FrameNumber, Payload) FPICOXRTraceRing::Get().Record(EPICOXRTraceEvent::Event, FrameNumber, Payload)
+#else
+	#define PXR_TRACE(Event, FrameNumber, Payload)
+#endif
@@ -27,6 +27,34 @@ public:
 
 	static FVector ConvertUnrealVectorToXRVector(FVector InVector, float Scale);
 
+	/**
+	 * Batch conversions from runtime space to Unreal space, bit-exact with the scalar versions above.
+	 * XRVectorType/XRQuatType/XRPoseType are PxrVector3f/PxrQuaternionf/PxrPosef or any struct with the same layout.
+	 */
+	template<typename XRVectorType>
+	static void ConvertXRVectorsToUnrealVectors(const XRVectorType* InVectors, FVector* OutVectors, int32 Count, float Scale);
+
+	template<typename XRQuatType>
+	static void ConvertXRQuatsToUnrealQuats(const XRQuatType* InQuats, FQuat* OutQuats, int32 Count);
+
+	template<typename XRPoseType>
+	static void ConvertXRPosesToUnrealPoses(const XRPoseType* InPoses, FQuat* OutOrientations, FVector* OutPositions, int32 Count, float Scale);
+
+	template<typename XRPoseType>
+	static void ConvertXRPosesToUnrealTransforms(const XRPoseType* InPoses, FTransform* OutTransforms, int32 Count, float Scale);
+
+private:
+	// (x,y,z,w) -> (-z*S, x*S, y*S, 0)
+	static FORCEINLINE VectorRegister ConvertXRVectorRegister(const float* InVector, const VectorRegister& ScaleMask)
+	{
+		return VectorMultiply(VectorSwizzle(VectorLoadFloat3(InVector), 2, 0, 1, 3), ScaleMask);
+	}
+
+	// (x,y,z,w) -> (-z, x, y, -w)
+	static FORCEINLINE VectorRegister ConvertXRQuatRegister(const float* InQuat, const VectorRegister& SignMask)
+	{
+		return VectorMultiply(VectorSwizzle(VectorLoad(InQuat), 2, 0, 1, 3), SignMask);
+	}
 };
 
 inline FQuat FPICOXRUtils::ConvertXRQuatToUnrealQuat(FQuat InQuat)
@@ -51,3 +79,54 @@ inline FVector FPICOXRUtils::ConvertUnrealVectorToXRVector(FVector InVector, flo
 
 	return FVector{ InVector.Y / Scale, InVector.Z / Scale, -InVector.X / Scale };
 }
+
+template<typename XRVectorType>
+inline void FPICOXRUtils::ConvertXRVectorsToUnrealVectors(const XRVectorType* InVectors, FVector* OutVectors, int32 Count, float Scale)
+{
+	static_assert(sizeof(XRVectorType) == sizeof(float) * 3, "XR vector type must be three packed floats");
+	const VectorRegister ScaleMask = MakeVectorRegister(-Scale, Scale, Scale, 0.0f);
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		VectorStoreFloat3(ConvertXRVectorRegister(&InVectors[Index].x, ScaleMask), &OutVectors[Index]);
+	}
+}
+
+template<typename XRQuatType>
+inline void FPICOXRUtils::ConvertXRQuatsToUnrealQuats(const XRQuatType* InQuats, FQuat* OutQuats, int32 Count)
+{
+	static_assert(sizeof(XRQuatType) == sizeof(float) * 4, "XR quaternion type must be four packed floats");
+	const VectorRegister SignMask = MakeVectorRegister(-1.0f, 1.0f, 1.0f, -1.0f);
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		VectorStore(ConvertXRQuatRegister(&InQuats[Index].x, SignMask), &OutQuats[Index]);
+	}
+}
+
+template<typename XRPoseType>
+inline void FPICOXRUtils::ConvertXRPosesToUnrealPoses(const XRPoseType* InPoses, FQuat* OutOrientations, FVector* OutPositions, int32 Count, float Scale)
+{
+	static_assert(sizeof(XRPoseType) == sizeof(float) * 7, "XR pose type must be a packed quaternion followed by a vector");
+	const VectorRegister SignMask = MakeVectorRegister(-1.0f, 1.0f, 1.0f, -1.0f);
+	const VectorRegister ScaleMask = MakeVectorRegister(-Scale, Scale, Scale, 0.0f);
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		VectorStore(ConvertXRQuatRegister(&InPoses[Index].orientation.x, SignMask), &OutOrientations[Index]);
+		VectorStoreFloat3(ConvertXRVectorRegister(&InPoses[Index].position.x, ScaleMask), &OutPositions[Index]);
+	}
+}
+
+template<typename XRPoseType>
+inline void FPICOXRUtils::ConvertXRPosesToUnrealTransforms(const XRPoseType* InPoses, FTransform* OutTransforms, int32 Count, float Scale)
+{
+	static_assert(sizeof(XRPoseType) == sizeof(float) * 7, "XR pose type must be a packed quaternion followed by a vector");
+	const VectorRegister SignMask = MakeVectorRegister(-1.0f, 1.0f, 1.0f, -1.0f);
+	const VectorRegister ScaleMask = MakeVectorRegister(-Scale, Scale, Scale, 0.0f);
+	FQuat Orientation;
+	FVector Position;
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		VectorStoreAligned(ConvertXRQuatRegister(&InPoses[Index].orientation.x, SignMask), &Orientation);
+		VectorStoreFloat3(ConvertXRVectorRegister(&InPoses[Index].position.x, ScaleMask), &Position);
+		OutTransforms[Index] = FTransform(Orientation, Position);
+	}
+}
@@ -0,0 +1,154 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_BoundaryGeometry.h"
+#include "PXR_BoundaryIndex.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRBoundaryGeometryTests
+{
+	static void TestSimplification(FAutomationTestBase& Test, const TCHAR* What, const TArray<FVector>& Polygon, float Tolerance, TArray<FVector>& Simplified)
+	{
+		FPICOXRBoundaryGeometry::SimplifyPolygon(Polygon, Tolerance, Simplified);
+		Test.TestTrue(*FString::Printf(TEXT("%s keeps a polygon"), What), Simplified.Num() >= FMath::Min(Polygon.Num(), 3));
+
+		// The simplified points are original points in their original order.
+		int32 Next = 0;
+		bool bInOrder = true;
+		for (const FVector& Point : Simplified)
+		{
+			while (Next < Polygon.Num() && Polygon[Next] != Point)
+			{
+				Next++;
+			}
+			if (Next == Polygon.Num())
+			{
+				bInOrder = false;
+				break;
+			}
+			Next++;
+		}
+		Test.TestTrue(*FString::Printf(TEXT("%s keeps original points in order"), What), bInOrder);
+
+		// Every original point lies within the tolerance of the simplified polygon.
+		TArray<FVector2D> Simplified2D;
+		for (const FVector& Point : Simplified)
+		{
+			Simplified2D.Add(FVector2D(Point));
+		}
+		FPICOXRBoundaryIndex Index;
+		Index.Build(Simplified2D);
+		int32 FarPoints = 0;
+		for (const FVector& Point : Polygon)
+		{
+			FPICOXRBoundaryQueryResult Result;
+			if (!Index.QueryPoint(FVector2D(Point), Result) || Result.Distance > Tolerance + 1.0e-4f)
+			{
+				FarPoints++;
+			}
+		}
+		Test.TestEqual(*FString::Printf(TEXT("%s points farther than the tolerance"), What), FarPoints, 0);
+	}
+
+	/** Square of 2m drawn with 25 points per edge, all but the corners a little off the edges. */
+	static void MakeNoisySquare(FRandomStream& Random, TArray<FVector>& OutSquare)
+	{
+		const FVector2D Corners[] = { FVector2D(-1.0f, -1.0f), FVector2D(1.0f, -1.0f), FVector2D(1.0f, 1.0f), FVector2D(-1.0f, 1.0f) };
+		for (int32 Edge = 0; Edge < 4; Edge++)
+		{
+			for (int32 Step = 0; Step < 25; Step++)
+			{
+				const FVector2D Point = FMath::Lerp(Corners[Edge], Corners[(Edge + 1) % 4], Step / 25.0f);
+				const float Noise = Step == 0 ? 0.0f : Random.FRandRange(-0.01f, 0.01f);
+				OutSquare.Add(FVector(Point.X + Noise, Point.Y - Noise, 0.0f));
+			}
+		}
+	}
+
+	static void TestSimplify(FAutomationTestBase& Test)
+	{
+		FRandomStream Random(0x5079);
+		TArray<FVector> Simplified;
+
+		// A noisy square drawn with many points comes back as its corners.
+		TArray<FVector> Square;
+		MakeNoisySquare(Random, Square);
+		TestSimplification(Test, TEXT("Noisy square"), Square, 0.05f, Simplified);
+		Test.TestEqual(TEXT("Noisy square simplified to its corners"), Simplified.Num(), 4);
+
+		// Random star polygons keep fewer points as the tolerance grows.
+		for (int32 PolygonSize : { 4, 16, 100, 1000 })
+		{
+			TArray<FVector> Polygon;
+			for (int32 Index = 0; Index < PolygonSize; Index++)
+			{
+				const float Angle = 2.0f * PI * Index / PolygonSize;
+				const float Radius = 2.0f + 0.3f * FMath::Sin(Angle * 5.0f) + Random.FRandRange(-0.02f, 0.02f);
+				Polygon.Add(FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, Random.FRandRange(-0.01f, 0.01f)));
+			}
+			int32 LastNum = MAX_int32;
+			for (float Tolerance : { 0.0f, 0.01f, 0.05f, 0.2f, 1.0f })
+			{
+				const FString What = FString::Printf(TEXT("%d point star at %.2fm"), PolygonSize, Tolerance);
+				TestSimplification(Test, *What, Polygon, Tolerance, Simplified);
+				Test.TestTrue(*FString::Printf(TEXT("%s keeps no more points than at a lower tolerance"), *What), Simplified.Num() <= LastNum);
+				LastNum = Simplified.Num();
+			}
+		}
+
+		// Points on one line still make a polygon.
+		TArray<FVector> Line;
+		for (int32 Index = 0; Index < 10; Index++)
+		{
+			Line.Add(FVector(Index * 0.1f, Index % 2 * 0.001f, 0.0f));
+		}
+		FPICOXRBoundaryGeometry::SimplifyPolygon(Line, 0.05f, Simplified);
+		Test.TestEqual(TEXT("Points on a line simplified to a triangle"), Simplified.Num(), 3);
+	}
+
+	static void TestRevisions(FAutomationTestBase& Test)
+	{
+		// Revisions only change with the geometry.
+		FRandomStream Random(0x5079);
+		TArray<FVector> Square;
+		MakeNoisySquare(Random, Square);
+
+		FPICOXRBoundaryGeometry Geometry;
+		const float ChangeTolerance = 0.001f;
+		Test.TestFalse(TEXT("An empty boundary at first is no change"), Geometry.Update(TArray<FVector>(), ChangeTolerance));
+		Test.TestTrue(TEXT("Revision of an empty boundary"), Geometry.GetRevision() == 0);
+		Test.TestTrue(TEXT("A new boundary is a change"), Geometry.Update(Square, ChangeTolerance));
+		Test.TestTrue(TEXT("Revision after a new boundary"), Geometry.GetRevision() == 1);
+		Test.TestEqual(TEXT("Simplified square"), Geometry.GetSimplifiedPoints().Num(), 4);
+		Test.TestFalse(TEXT("The same boundary is no change"), Geometry.Update(Square, ChangeTolerance));
+		TArray<FVector> Moved = Square;
+		Moved[7].X += 0.5f * ChangeTolerance;
+		Test.TestFalse(TEXT("A point moved within the tolerance is no change"), Geometry.Update(Moved, ChangeTolerance));
+		Test.TestTrue(TEXT("Revision after a move within the tolerance"), Geometry.GetRevision() == 1);
+		Moved[7].X += 10.0f * ChangeTolerance;
+		Test.TestTrue(TEXT("A point moved beyond the tolerance is a change"), Geometry.Update(Moved, ChangeTolerance));
+		Test.TestTrue(TEXT("Revision after a move beyond the tolerance"), Geometry.GetRevision() == 2);
+		Moved.Pop();
+		Test.TestTrue(TEXT("A point removed is a change"), Geometry.Update(Moved, ChangeTolerance));
+		Test.TestTrue(TEXT("Revision after a point removed"), Geometry.GetRevision() == 3);
+		Geometry.SetSimplifyTolerance(0.0f);
+		Test.TestTrue(TEXT("A new simplify tolerance keeps the revision"), Geometry.GetRevision() == 3);
+		Test.TestTrue(TEXT("No simplify tolerance keeps the points on the edges"), Geometry.GetSimplifiedPoints().Num() > 4);
+		Test.TestTrue(TEXT("A cleared boundary is a change"), Geometry.Update(TArray<FVector>(), ChangeTolerance));
+		Test.TestTrue(TEXT("Revision after a cleared boundary"), Geometry.GetRevision() == 4);
+		Test.TestEqual(TEXT("Simplified points of a cleared boundary"), Geometry.GetSimplifiedPoints().Num(), 0);
+		Test.TestFalse(TEXT("A boundary cleared again is no change"), Geometry.Update(TArray<FVector>(), ChangeTolerance));
+	}
+}
+
+/** Checks boundary polygon simplification and revision tracking on synthetic polygons. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRBoundaryGeometryTest, "PICOXR.HMD.BoundaryGeometry", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRBoundaryGeometryTest::RunTest(const FString& Parameters)
+{
+	PICOXRBoundaryGeometryTests::TestSimplify(*this);
+	PICOXRBoundaryGeometryTests::TestRevisions(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,117 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_BoundaryIndex.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include <limits>
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRBoundaryIndexTests
+{
+	/** Star shaped polygon around the origin with a random radius per vertex, like a hand drawn guardian. */
+	static void MakePolygon(FRandomStream& Random, int32 NumPoints, bool bClockwise, TArray<FVector2D>& OutPoints)
+	{
+		OutPoints.Reset(NumPoints);
+		for (int32 Index = 0; Index < NumPoints; Index++)
+		{
+			const float Angle = (bClockwise ? -1.0f : 1.0f) * 2.0f * PI * Index / NumPoints;
+			const float Radius = Random.FRandRange(1.0f, 3.0f);
+			OutPoints.Add(FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * Radius);
+		}
+	}
+
+	static void TestIndex(FAutomationTestBase& Test)
+	{
+		const int32 NumQueries = 10000;
+		FRandomStream Random(0x5078);
+		TArray<FVector2D> Polygon;
+		TArray<FVector2D> Queries;
+		TArray<FPICOXRBoundaryQueryResult> Results;
+		Queries.SetNumUninitialized(NumQueries);
+		Results.SetNum(NumQueries);
+
+		const int32 PolygonSizes[] = { 4, 17, 64, 256, 1024 };
+		for (int32 PolygonSize : PolygonSizes)
+		{
+			for (int32 Clockwise = 0; Clockwise < 2; Clockwise++)
+			{
+				MakePolygon(Random, PolygonSize, Clockwise != 0, Polygon);
+				FPICOXRBoundaryIndex Index;
+				Index.Build(Polygon);
+				for (int32 Query = 0; Query < NumQueries; Query++)
+				{
+					// Mostly around the polygon, some on its vertices to hit the tie breaking.
+					Queries[Query] = Query % 16 == 0 ? Polygon[Query % PolygonSize] : FVector2D(Random.FRandRange(-4.0f, 4.0f), Random.FRandRange(-4.0f, 4.0f));
+				}
+
+				for (int32 Query = 0; Query < NumQueries; Query++)
+				{
+					Index.QueryPointBruteForce(Queries[Query], Results[Query]);
+				}
+				TArray<FPICOXRBoundaryQueryResult> Indexed;
+				Indexed.SetNum(NumQueries);
+				Index.QueryPoints(Queries, Indexed);
+
+				int32 Mismatches = 0;
+				int32 OutwardNormals = 0;
+				for (int32 Query = 0; Query < NumQueries; Query++)
+				{
+					const FPICOXRBoundaryQueryResult& A = Results[Query];
+					const FPICOXRBoundaryQueryResult& B = Indexed[Query];
+					Mismatches += A.Distance != B.Distance || A.bInside != B.bInside || A.Segment != B.Segment || A.ClosestPoint != B.ClosestPoint || A.Normal != B.Normal ? 1 : 0;
+					// Normals point into the polygon: the middle of the closest segment moved a little along the normal is inside.
+					// The offset is fixed, the random radii make spikes narrower than a fraction of their edge length.
+					const FVector2D& SegmentStart = Polygon[A.Segment];
+					const FVector2D& SegmentEnd = Polygon[(A.Segment + 1) % PolygonSize];
+					const FVector2D Probe = (SegmentStart + SegmentEnd) * 0.5f + A.Normal * 1.0e-3f;
+					OutwardNormals += Index.IsInsideBruteForce(Probe) ? 0 : 1;
+				}
+				const FString Shape = FString::Printf(TEXT("%d point %s polygon"), PolygonSize, Clockwise ? TEXT("clockwise") : TEXT("counterclockwise"));
+				Test.TestEqual(*FString::Printf(TEXT("Indexed queries that differ from brute force on a %s"), *Shape), Mismatches, 0);
+				Test.TestEqual(*FString::Printf(TEXT("Normals not pointing into a %s"), *Shape), OutwardNormals, 0);
+			}
+		}
+	}
+
+	static void TestNonFinitePoints(FAutomationTestBase& Test)
+	{
+		FRandomStream Random(0x5078);
+		TArray<FVector2D> Polygon;
+		MakePolygon(Random, 64, false, Polygon);
+		FPICOXRBoundaryIndex Index;
+		Index.Build(Polygon);
+
+		const float NaN = std::numeric_limits<float>::quiet_NaN();
+		const float Infinity = std::numeric_limits<float>::infinity();
+		const TArray<FVector2D> Points = { FVector2D(NaN, 0.0f), FVector2D(0.0f, NaN), FVector2D(NaN, NaN), FVector2D(Infinity, 0.0f), FVector2D(1.0f, -Infinity) };
+		TArray<FPICOXRBoundaryQueryResult> Results;
+		Results.SetNum(Points.Num());
+		Index.QueryPoints(Points, Results);
+
+		// No segment is at a finite distance, so there is no closest one.
+		int32 IndexedResults = 0;
+		int32 BruteForceResults = 0;
+		int32 SegmentResults = 0;
+		for (int32 Point = 0; Point < Points.Num(); Point++)
+		{
+			FPICOXRBoundaryQueryResult Result;
+			IndexedResults += Index.QueryPoint(Points[Point], Result) ? 1 : 0;
+			BruteForceResults += Index.QueryPointBruteForce(Points[Point], Result) ? 1 : 0;
+			SegmentResults += Results[Point].Segment != INDEX_NONE ? 1 : 0;
+		}
+		Test.TestEqual(TEXT("Indexed queries answered for non-finite points"), IndexedResults, 0);
+		Test.TestEqual(TEXT("Brute force queries answered for non-finite points"), BruteForceResults, 0);
+		Test.TestEqual(TEXT("Batch results with a segment for non-finite points"), SegmentResults, 0);
+	}
+}
+
+/** Compares the boundary segment BVH with brute force queries on random polygons, and checks non-finite points are rejected. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRBoundaryIndexTest, "PICOXR.HMD.BoundaryIndex", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRBoundaryIndexTest::RunTest(const FString& Parameters)
+{
+	PICOXRBoundaryIndexTests::TestIndex(*this);
+	PICOXRBoundaryIndexTests::TestNonFinitePoints(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,106 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_CameraStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRCameraStreamTests
+{
+	static void TestRing(FAutomationTestBase& Test)
+	{
+		const int32 NumAcquisitions = 1000;
+		const int32 FramePeriod = 2;
+		const int32 InvalidPeriod = 7;
+		const TSharedRef<IPICOXRCameraSource, ESPMode::ThreadSafe> Source = IPICOXRCameraSource::CreateFake(FramePeriod, InvalidPeriod);
+		FPICOXRCameraFrameRing Ring;
+		uint64 LastFrameNumber = 0;
+		int64 LastPublishedExposure = 0;
+		uint64 ExpectedFrames = 0;
+		uint64 ExpectedInvalid = 0;
+		const uint64 NoTextures[2] = { 0, 0 };
+		double Time = 0.0;
+		int32 InvalidTickets = 0;
+		int32 PublishedSlotsWritten = 0;
+		int32 ConcurrentAcquisitions = 0;
+		int32 WrongPublishes = 0;
+		int32 WrongFrameNumbers = 0;
+		int32 WrongSlots = 0;
+
+		for (int32 Acquisition = 0; Acquisition < NumAcquisitions; Acquisition++)
+		{
+			const FPICOXRCameraFrameRing::FTicket Ticket = Ring.BeginAcquire(Time);
+			int32 PublishedSlot = INDEX_NONE;
+			uint64 PublishedFrame = 0;
+			const bool bHasPublished = Ring.GetLatest(PublishedSlot, PublishedFrame);
+			InvalidTickets += Ticket.IsValid() ? 0 : 1;
+			PublishedSlotsWritten += bHasPublished && Ticket.Slot == PublishedSlot ? 1 : 0;
+			// Only one acquisition in flight.
+			ConcurrentAcquisitions += Ring.BeginAcquire(Time).IsValid() ? 1 : 0;
+
+			FPICOXRCameraFrameInfo Info;
+			Source->AcquireFrame(NoTextures, 640, 640, Info);
+			Time += 0.004;
+			const bool bPublished = Ring.EndAcquire(Ticket, Info, Time);
+			const bool bExpectPublished = Info.bValid && Info.ExposureTimestamp != LastPublishedExposure;
+			ExpectedInvalid += Info.bValid ? 0 : 1;
+			WrongPublishes += bPublished != bExpectPublished ? 1 : 0;
+			if (bPublished)
+			{
+				ExpectedFrames++;
+				LastPublishedExposure = Info.ExposureTimestamp;
+			}
+
+			uint64 FrameNumber = 0;
+			int32 Slot = INDEX_NONE;
+			if (Ring.GetLatest(Slot, FrameNumber))
+			{
+				WrongFrameNumbers += FrameNumber != LastFrameNumber + (bPublished ? 1 : 0) ? 1 : 0;
+				WrongSlots += bPublished && Slot != Ticket.Slot ? 1 : 0;
+				LastFrameNumber = FrameNumber;
+			}
+			Time += 0.007;
+		}
+		Test.TestEqual(TEXT("Acquisitions without a slot"), InvalidTickets, 0);
+		Test.TestEqual(TEXT("Acquisitions writing the published slot"), PublishedSlotsWritten, 0);
+		Test.TestEqual(TEXT("Acquisitions begun while one was in flight"), ConcurrentAcquisitions, 0);
+		Test.TestEqual(TEXT("Acquisitions published when they should not or not when they should"), WrongPublishes, 0);
+		Test.TestEqual(TEXT("Latest frame numbers out of sequence"), WrongFrameNumbers, 0);
+		Test.TestEqual(TEXT("Latest slots other than the one just written"), WrongSlots, 0);
+
+		// An acquisition ending after a reset must not publish, and numbering continues.
+		const FPICOXRCameraFrameRing::FTicket StaleTicket = Ring.BeginAcquire(Time);
+		Ring.Reset();
+		FPICOXRCameraFrameInfo NewFrame;
+		NewFrame.bValid = true;
+		NewFrame.ExposureTimestamp = LastPublishedExposure + 11111111;
+		int32 Slot = INDEX_NONE;
+		uint64 FrameNumber = 0;
+		Test.TestFalse(TEXT("An acquisition begun before a reset publishes"), Ring.EndAcquire(StaleTicket, NewFrame, Time));
+		Test.TestFalse(TEXT("A reset ring has a latest frame"), Ring.GetLatest(Slot, FrameNumber));
+		const FPICOXRCameraFrameRing::FTicket FreshTicket = Ring.BeginAcquire(Time);
+		Test.TestTrue(TEXT("An acquisition begun after a reset publishes"), Ring.EndAcquire(FreshTicket, NewFrame, Time));
+		if (Test.TestTrue(TEXT("The ring has a latest frame after a reset"), Ring.GetLatest(Slot, FrameNumber)))
+		{
+			Test.TestEqual(TEXT("Frame number after a reset"), FrameNumber, LastFrameNumber + 1);
+		}
+		ExpectedFrames++;
+
+		const FPICOXRCameraStreamStats Stats = Ring.GetStats();
+		Test.TestEqual(TEXT("Frames published"), Stats.FramesPublished, ExpectedFrames);
+		Test.TestEqual(TEXT("Invalid frames"), Stats.InvalidFrames, ExpectedInvalid);
+		Test.TestEqual(TEXT("Acquisitions"), Stats.Acquisitions, Stats.FramesPublished + Stats.InvalidFrames + Stats.DuplicateFrames);
+		Test.TestEqual(TEXT("Updates while an acquisition was in flight"), Stats.BusyUpdates, (uint64)NumAcquisitions);
+		Test.TestEqual(TEXT("Average frame interval"), Stats.AverageFrameIntervalMs, 11.111111f, 0.01f);
+		Test.TestEqual(TEXT("Average acquire latency"), Stats.AverageAcquireLatencyMs, 4.0f * NumAcquisitions / (NumAcquisitions + 1), 0.01f);
+	}
+}
+
+/** Runs the see-through camera frame ring against a fake camera and checks frame sequencing and stats. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRCameraFrameRingTest, "PICOXR.HMD.CameraFrameRing", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRCameraFrameRingTest::RunTest(const FString& Parameters)
+{
+	PICOXRCameraStreamTests::TestRing(*this);
+	return true;
+}
+#endif
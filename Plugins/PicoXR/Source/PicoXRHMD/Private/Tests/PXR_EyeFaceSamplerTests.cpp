@@ -0,0 +1,101 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_EyeFaceSampler.h"
+#include "PXR_EyeTracker.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXREyeFaceSamplerTests
+{
+	/** Scripted source: frame N reports a gaze turning around the up axis and blend shape values derived from N. */
+	class FMockRuntime : public IPICOXREyeFaceRuntime
+	{
+	public:
+		int32 Frame = 0;
+		int32 EyeQueries = 0;
+		int32 FaceQueries = 0;
+
+		virtual bool GetEyeTrackingData(FPICOXRRawEyeTrackingData& OutData) override
+		{
+			EyeQueries++;
+			FMemory::Memzero(OutData);
+			// Every fourth frame the gaze is lost.
+			OutData.combinedEyePoseStatus = (Frame % 4 == 3) ? 0 : (kGazePointValid | kGazeVectorValid);
+			OutData.leftEyePoseStatus = kEyeOpennessValid;
+			OutData.leftEyeOpenness = 1.0f;
+			const float Angle = Frame * 0.01f;
+			OutData.combinedEyeGazeVector[0] = FMath::Sin(Angle);
+			OutData.combinedEyeGazeVector[2] = -FMath::Cos(Angle);
+			return true;
+		}
+
+		virtual bool GetFaceTrackingData(int64 Ts, int32 Flags, FPICOXRRawFaceTrackingData& OutData) override
+		{
+			FaceQueries++;
+			FMemory::Memzero(OutData);
+			OutData.timestamp = 1000 + Frame;
+			for (int32 Index = 0; Index < PXR_BLEND_SHAPE_NUM; Index++)
+			{
+				OutData.blendShapeWeight[Index] = Frame + Index * 0.001f;
+			}
+			return true;
+		}
+	};
+
+	static void TestSampler(FAutomationTestBase& Test)
+	{
+		const int32 FrameCount = 100;
+		const int32 ReadsPerFrame = 8;
+
+		TSharedRef<FMockRuntime> Mock = MakeShared<FMockRuntime>();
+		FPICOXREyeFaceSampler Sampler;
+		Sampler.SetRuntime(Mock);
+		Sampler.SetHistoryLength(8);
+
+		int32 WrongFrames = 0;
+		int32 WrongWeights = 0;
+		int32 WrongConfidences = 0;
+		int32 WrongHistory = 0;
+		for (int32 Frame = 0; Frame < FrameCount; Frame++)
+		{
+			Mock->Frame = Frame;
+			// Several components sampling in the same frame only reach the runtime once.
+			for (int32 Read = 0; Read < ReadsPerFrame; Read++)
+			{
+				Sampler.Sample(Frame, Frame / 72.0, true, true);
+				const FPICOXREyeFaceSample& Latest = Sampler.GetLatest();
+				const TArrayView<const float> Weights = Latest.GetBlendShapeWeights();
+				WrongFrames += Latest.FrameNumber != (uint64)Frame || Latest.FaceTimestamp != 1000 + Frame ? 1 : 0;
+				WrongWeights += Weights.GetData() != Latest.BlendShapes || Weights[1] != Frame + 0.001f
+					|| Latest.GetBlendShapeReserved()[0] != Frame + PXR_BLEND_SHAPE_WEIGHT_NUM * 0.001f ? 1 : 0;
+				WrongConfidences += (Latest.GazeConfidence > 0.0f) != (Frame % 4 != 3) ? 1 : 0;
+			}
+			for (int32 Age = 0; Age < Sampler.GetHistoryNum(); Age++)
+			{
+				WrongHistory += Sampler.GetHistory(Age).FrameNumber != (uint64)(Frame - Age) ? 1 : 0;
+			}
+		}
+		Test.TestEqual(TEXT("Reads returning another frame or face timestamp"), WrongFrames, 0);
+		Test.TestEqual(TEXT("Reads returning wrong blend shapes"), WrongWeights, 0);
+		Test.TestEqual(TEXT("Reads with a gaze confidence not matching the gaze status"), WrongConfidences, 0);
+		Test.TestEqual(TEXT("History entries out of order"), WrongHistory, 0);
+		Test.TestEqual(TEXT("Eye tracking queries"), Mock->EyeQueries, FrameCount);
+		Test.TestEqual(TEXT("Face tracking queries"), Mock->FaceQueries, FrameCount);
+
+		FVector Filtered = FVector::ZeroVector;
+		if (Test.TestTrue(TEXT("Filtered gaze over the history"), Sampler.GetFilteredGazeDirection(Sampler.GetHistoryLength() - 1, Filtered)))
+		{
+			Test.TestEqual(TEXT("Length of the filtered gaze"), Filtered.Size(), 1.0f, 1.0e-3f);
+		}
+	}
+}
+
+/** Drives the eye/face sampler with a mock runtime and checks it queries once per frame and keeps its history in order. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXREyeFaceSamplerTest, "PICOXR.HMD.EyeFaceSampler", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXREyeFaceSamplerTest::RunTest(const FString& Parameters)
+{
+	PICOXREyeFaceSamplerTests::TestSampler(*this);
+	return true;
+}
+#endif
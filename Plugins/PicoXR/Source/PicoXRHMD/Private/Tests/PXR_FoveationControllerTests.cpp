@@ -0,0 +1,151 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_FoveationController.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRFoveationControllerTests
+{
+	static FVector DirectionFromCenter(float X, float Y)
+	{
+		// Inverse of ProjectGazeDirection for a unit Z.
+		return FVector(X * 0.0428f / 0.0508f, Y * 0.0428f / 0.0508f, -1.0f).GetSafeNormal();
+	}
+
+	/** 72Hz trace: fixation, saccade at frame 100, smooth drift, a blink, tracking loss and a GPU overload. */
+	static void MakeSyntheticTrace(TArray<FPICOXRFoveationInput>& Trace)
+	{
+		const double FrameTime = 1.0 / 72.0;
+		for (int32 Frame = 0; Frame < 720; Frame++)
+		{
+			FPICOXRFoveationInput Input;
+			Input.Time = Frame * FrameTime;
+			Input.bGazeValid = true;
+			Input.GazeConfidence = 1.0f;
+			Input.FrameBudgetMs = 1000.0f / 72.0f;
+			Input.GPUTimeMs = Frame >= 360 && Frame < 540 ? 14.5f : 9.0f;
+
+			if (Frame < 100)
+			{
+				Input.GazeDirection = DirectionFromCenter(0.0f, 0.0f);
+			}
+			else if (Frame < 200)
+			{
+				Input.GazeDirection = DirectionFromCenter(0.6f, 0.3f);
+			}
+			else
+			{
+				Input.GazeDirection = DirectionFromCenter(0.6f - (Frame - 200) * 0.002f, 0.3f);
+			}
+			// A 4 frame blink and a 30 frame loss.
+			if ((Frame >= 250 && Frame < 254) || (Frame >= 300 && Frame < 330))
+			{
+				Input.bGazeValid = false;
+				Input.GazeConfidence = 0.0f;
+			}
+			Trace.Add(Input);
+		}
+	}
+
+	static void TestSyntheticTrace(FAutomationTestBase& Test)
+	{
+		TArray<FPICOXRFoveationInput> Trace;
+		MakeSyntheticTrace(Trace);
+
+		FPICOXRFoveationSettings Settings;
+		Settings.FixedLevel = 1;
+		FPICOXRFoveationPolicy Policy;
+		Policy.SetSettings(Settings);
+
+		int32 FallbackMismatches = 0;
+		int32 HeldCenterMoves = 0;
+		int32 BlinkFallbacks = 0;
+		int32 LossGazeFrames = 0;
+		FVector2D HeldCenter = FVector2D::ZeroVector;
+		for (int32 Frame = 0; Frame < Trace.Num(); Frame++)
+		{
+			const bool bWasSaccade = Policy.GetOutput().bSaccade;
+			const FPICOXRFoveationOutput& Output = Policy.Update(Trace[Frame]);
+			if (!Output.bGazeDriven && (Output.Level != Settings.FixedLevel || !Output.Center.IsZero()))
+			{
+				FallbackMismatches++;
+			}
+			if (Output.bSaccade && bWasSaccade && Output.Center != HeldCenter)
+			{
+				HeldCenterMoves++;
+			}
+			HeldCenter = Output.Center;
+
+			if (Frame >= 250 && Frame < 254)
+			{
+				BlinkFallbacks += Output.bGazeDriven ? 0 : 1;
+			}
+			// Past the tracking lost timeout of the loss.
+			if (Frame >= 300 + 15 && Frame < 330)
+			{
+				LossGazeFrames += Output.bGazeDriven ? 1 : 0;
+			}
+			if (Frame == 99)
+			{
+				Test.TestTrue(TEXT("Fixation is gaze driven"), Output.bGazeDriven);
+				Test.TestTrue(TEXT("Fixation centers the foveation"), Output.Center.IsNearlyZero(0.01f));
+			}
+			else if (Frame == 100)
+			{
+				Test.TestTrue(TEXT("The jump at frame 100 is a saccade"), Output.bSaccade);
+			}
+			else if (Frame == 150)
+			{
+				Test.TestFalse(TEXT("The saccade has ended by frame 150"), Output.bSaccade);
+				Test.TestTrue(TEXT("The center lands on the new fixation"), Output.Center.Equals(FVector2D(0.6f, 0.3f), 0.01f));
+			}
+			else if (Frame == 539)
+			{
+				Test.TestTrue(TEXT("The GPU overload raises the level above the fixed level"), Output.Level > Settings.FixedLevel);
+			}
+		}
+		Test.TestEqual(TEXT("Frames without gaze off the fixed level or center"), FallbackMismatches, 0);
+		Test.TestEqual(TEXT("Center moves during a saccade"), HeldCenterMoves, 0);
+		Test.TestEqual(TEXT("Blink frames that fell back to fixed foveation"), BlinkFallbacks, 0);
+		Test.TestEqual(TEXT("Gaze driven frames after tracking was lost"), LossGazeFrames, 0);
+
+		// Reset returns to the fixed level.
+		Policy.Reset();
+		Test.TestFalse(TEXT("A reset policy is gaze driven"), Policy.GetOutput().bGazeDriven);
+		Test.TestEqual(TEXT("Level of a reset policy"), Policy.GetOutput().Level, Settings.FixedLevel);
+	}
+
+	static void TestTraceLines(FAutomationTestBase& Test)
+	{
+		FPICOXRFoveationInput Input;
+		Input.Time = 12.5;
+		Input.bGazeValid = true;
+		Input.GazeConfidence = 0.75f;
+		Input.GazeDirection = DirectionFromCenter(0.2f, -0.4f);
+		Input.GPUTimeMs = 10.25f;
+		Input.FrameBudgetMs = 11.111f;
+
+		FPICOXRFoveationInput Parsed;
+		if (Test.TestTrue(TEXT("A formatted trace line parses"), FPICOXRFoveationController::ParseTraceLine(FPICOXRFoveationController::FormatTraceLine(Input), Parsed)))
+		{
+			Test.TestEqual(TEXT("Time of a parsed trace line"), Parsed.Time, Input.Time, 1.0e-6);
+			Test.TestTrue(TEXT("Gaze valid of a parsed trace line"), Parsed.bGazeValid);
+			Test.TestEqual(TEXT("Confidence of a parsed trace line"), Parsed.GazeConfidence, Input.GazeConfidence, 1.0e-4f);
+			Test.TestTrue(TEXT("Gaze direction of a parsed trace line"), Parsed.GazeDirection.Equals(Input.GazeDirection, 1.0e-5f));
+			Test.TestEqual(TEXT("GPU time of a parsed trace line"), Parsed.GPUTimeMs, Input.GPUTimeMs, 1.0e-3f);
+			Test.TestEqual(TEXT("Frame budget of a parsed trace line"), Parsed.FrameBudgetMs, Input.FrameBudgetMs, 1.0e-3f);
+		}
+		Test.TestFalse(TEXT("A line with missing fields parses"), FPICOXRFoveationController::ParseTraceLine(TEXT("1.0,1,0.5"), Parsed));
+	}
+}
+
+/** Runs the dynamic foveation policy over a synthetic gaze trace and checks its decisions. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRFoveationControllerTest, "PICOXR.HMD.FoveationController", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRFoveationControllerTest::RunTest(const FString& Parameters)
+{
+	PICOXRFoveationControllerTests::TestSyntheticTrace(*this);
+	PICOXRFoveationControllerTests::TestTraceLines(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,170 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_RenderTargetPool.h"
+#include "UObject/Package.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRRenderTargetPoolTests
+{
+	/** Creates bare render target objects without any GPU resource, so the pool can be checked under a null RHI. */
+	class FFakeAllocator : public IPICOXRRenderTargetAllocator
+	{
+	public:
+		virtual UTextureRenderTarget2D* CreateTarget(const FPICOXRRenderTargetKey& Key) override
+		{
+			Created++;
+			Live++;
+			UTextureRenderTarget2D* Target = NewObject<UTextureRenderTarget2D>(GetTransientPackage(), NAME_None, RF_Transient);
+			Target->RenderTargetFormat = Key.Format;
+			Target->ClearColor = Key.ClearColor;
+			Target->AddressX = Key.AddressX;
+			Target->AddressY = Key.AddressY;
+			Target->SizeX = Key.Size.X;
+			Target->SizeY = Key.Size.Y;
+			return Target;
+		}
+
+		virtual void ReleaseTarget(UTextureRenderTarget2D* Target) override
+		{
+			Live--;
+		}
+
+		int32 Created = 0;
+		int32 Live = 0;
+	};
+
+	static void TestStats(FAutomationTestBase& Test, const TCHAR* What, const FPICOXRRenderTargetPool& Pool, const FFakeAllocator& Allocator, int32 Active, int32 Idle)
+	{
+		const FPICOXRRenderTargetPoolStats& Stats = Pool.GetStats();
+		Test.TestEqual(*FString::Printf(TEXT("Active targets %s"), What), Stats.ActiveTargets, Active);
+		Test.TestEqual(*FString::Printf(TEXT("Idle targets %s"), What), Stats.IdleTargets, Idle);
+		Test.TestEqual(*FString::Printf(TEXT("Live targets %s"), What), Allocator.Live, Active + Idle);
+		Test.TestTrue(*FString::Printf(TEXT("Active bytes %s"), What), Active > 0 ? Stats.ActiveBytes > 0 : Stats.ActiveBytes == 0);
+		Test.TestTrue(*FString::Printf(TEXT("Idle bytes %s"), What), Idle > 0 ? Stats.IdleBytes > 0 : Stats.IdleBytes == 0);
+	}
+
+	static void TestPool(FAutomationTestBase& Test)
+	{
+		TSharedRef<FFakeAllocator> Allocator = MakeShared<FFakeAllocator>();
+		{
+			FPICOXRRenderTargetPool Pool(Allocator);
+			const int64 DefaultBudget = Pool.GetBudget();
+			const FPICOXRRenderTargetKey Capture(FIntPoint(1920, 1080), RTF_RGBA8_SRGB);
+			const FPICOXRRenderTargetKey Small(FIntPoint(512, 512), RTF_RGBA8);
+			const FPICOXRRenderTargetKey SmallHDR(FIntPoint(512, 512), RTF_RGBA16f);
+			Test.TestEqual(TEXT("Bytes of an RGBA8 target"), Capture.GetSizeBytes(), (int64)1920 * 1080 * 4);
+			Test.TestEqual(TEXT("Bytes of an RGBA16f target"), SmallHDR.GetSizeBytes(), 2 * Small.GetSizeBytes());
+
+			// Toggling a capture on and off reuses its targets, released in reverse they come back in the same order.
+			UTextureRenderTarget2D* Background = Pool.Acquire(Capture);
+			UTextureRenderTarget2D* Foreground = Pool.Acquire(Capture);
+			Test.TestNotNull(TEXT("Background target"), Background);
+			Test.TestNotNull(TEXT("Foreground target"), Foreground);
+			Test.TestTrue(TEXT("Two targets of the same key are distinct"), Background != Foreground);
+			TestStats(Test, TEXT("after the first acquisitions"), Pool, *Allocator, 2, 0);
+			int32 FailedReleases = 0;
+			int32 WrongReuses = 0;
+			for (int32 Toggle = 0; Toggle < 10; Toggle++)
+			{
+				FailedReleases += Pool.Release(Foreground) ? 0 : 1;
+				FailedReleases += Pool.Release(Background) ? 0 : 1;
+				TestStats(Test, TEXT("with the capture off"), Pool, *Allocator, 0, 2);
+				WrongReuses += Pool.Acquire(Capture) == Background ? 0 : 1;
+				WrongReuses += Pool.Acquire(Capture) == Foreground ? 0 : 1;
+			}
+			Test.TestEqual(TEXT("Releases refused while toggling"), FailedReleases, 0);
+			Test.TestEqual(TEXT("Targets reused out of order while toggling"), WrongReuses, 0);
+			Test.TestEqual(TEXT("Targets created while toggling"), Allocator->Created, 2);
+			Test.TestEqual(TEXT("Reuses while toggling"), Pool.GetStats().Reuses, (uint64)20);
+
+			// Keys differ by format as well as size.
+			UTextureRenderTarget2D* SmallTarget = Pool.Acquire(Small);
+			UTextureRenderTarget2D* SmallHDRTarget = Pool.Acquire(SmallHDR);
+			Test.TestTrue(TEXT("Targets of different formats are distinct"), SmallTarget != SmallHDRTarget);
+			Test.TestEqual(TEXT("Targets created for two formats"), Allocator->Created, 4);
+			if (Test.TestNotNull(TEXT("RGBA16f target"), SmallHDRTarget))
+			{
+				Test.TestTrue(TEXT("Format of the RGBA16f target"), SmallHDRTarget->RenderTargetFormat == RTF_RGBA16f);
+			}
+
+			// Targets not taken from the pool or released twice are refused.
+			Test.TestFalse(TEXT("Releasing no target"), Pool.Release(nullptr));
+			Test.TestFalse(TEXT("Releasing a target from elsewhere"), Pool.Release(NewObject<UTextureRenderTarget2D>()));
+			Test.TestTrue(TEXT("Releasing a pooled target"), Pool.Release(SmallTarget));
+			Test.TestFalse(TEXT("Releasing a target twice"), Pool.Release(SmallTarget));
+			TestStats(Test, TEXT("after a double release"), Pool, *Allocator, 3, 1);
+
+			// A budget below what is in use evicts the idle targets, oldest first, and counts the allocations past it.
+			Test.TestTrue(TEXT("Releasing the RGBA16f target"), Pool.Release(SmallHDRTarget));
+			Pool.SetBudget(2 * Capture.GetSizeBytes() + SmallHDR.GetSizeBytes());
+			TestStats(Test, TEXT("after lowering the budget"), Pool, *Allocator, 2, 1);
+			Test.TestEqual(TEXT("Evictions after lowering the budget"), Pool.GetStats().Evictions, (uint64)1);
+			Test.TestTrue(TEXT("The newest idle target survives a lower budget"), Pool.Acquire(SmallHDR) == SmallHDRTarget);
+			Test.TestTrue(TEXT("Releasing the RGBA16f target again"), Pool.Release(SmallHDRTarget));
+			UTextureRenderTarget2D* Extra = Pool.Acquire(Capture);
+			TestStats(Test, TEXT("after an allocation past the budget"), Pool, *Allocator, 3, 0);
+			Test.TestEqual(TEXT("Evictions after an allocation past the budget"), Pool.GetStats().Evictions, (uint64)2);
+			Test.TestEqual(TEXT("Allocations past the budget"), Pool.GetStats().OverBudgetAllocations, (uint64)1);
+
+			// Releasing past the budget frees the target straight away.
+			Test.TestTrue(TEXT("Releasing past the budget"), Pool.Release(Extra));
+			TestStats(Test, TEXT("after releasing past the budget"), Pool, *Allocator, 2, 0);
+
+			// Flushing frees every idle target and leaves the active ones alone.
+			Pool.SetBudget(DefaultBudget);
+			Test.TestTrue(TEXT("Releasing the background target"), Pool.Release(Background));
+			Pool.Flush();
+			TestStats(Test, TEXT("after a flush"), Pool, *Allocator, 1, 0);
+			Test.TestNull(TEXT("Target of an empty size"), Pool.Acquire(FPICOXRRenderTargetKey(FIntPoint(0, 720), RTF_RGBA8)));
+		}
+		// The pool frees what is left when it goes away.
+		Test.TestEqual(TEXT("Live targets after the pool went away"), Allocator->Live, 0);
+	}
+
+	static void TestSampling(FAutomationTestBase& Test)
+	{
+		TSharedRef<FFakeAllocator> Allocator = MakeShared<FFakeAllocator>();
+		FPICOXRRenderTargetPool Pool(Allocator);
+
+		// Keys taken from an authored target carry its clear color and address modes onto the pooled one.
+		UTextureRenderTarget2D* Template = NewObject<UTextureRenderTarget2D>();
+		Template->ClearColor = FLinearColor::Black;
+		Template->AddressX = TA_Clamp;
+		Template->AddressY = TA_Mirror;
+		const FPICOXRRenderTargetKey Default(FIntPoint(512, 512), RTF_RGBA8_SRGB);
+		const FPICOXRRenderTargetKey Authored(FIntPoint(512, 512), RTF_RGBA8_SRGB, *Template);
+		Test.TestTrue(TEXT("Keys of an authored and a default target differ"), Default != Authored);
+		Test.TestTrue(TEXT("Keys of the same authored target match"), Authored == FPICOXRRenderTargetKey(FIntPoint(512, 512), RTF_RGBA8_SRGB, *Template));
+		UTextureRenderTarget2D* AuthoredTarget = Pool.Acquire(Authored);
+		if (Test.TestNotNull(TEXT("Authored target"), AuthoredTarget))
+		{
+			Test.TestTrue(TEXT("Clear color of the authored target"), AuthoredTarget->ClearColor == FLinearColor::Black);
+			Test.TestTrue(TEXT("Horizontal address mode of the authored target"), AuthoredTarget->AddressX == TA_Clamp);
+			Test.TestTrue(TEXT("Vertical address mode of the authored target"), AuthoredTarget->AddressY == TA_Mirror);
+		}
+
+		// An idle target is not handed out for a key that only differs in sampling.
+		Test.TestTrue(TEXT("Releasing the authored target"), Pool.Release(AuthoredTarget));
+		UTextureRenderTarget2D* DefaultTarget = Pool.Acquire(Default);
+		Test.TestTrue(TEXT("A default key gets a target of its own"), DefaultTarget != AuthoredTarget);
+		if (Test.TestNotNull(TEXT("Default target"), DefaultTarget))
+		{
+			Test.TestTrue(TEXT("Clear color of the default target"), DefaultTarget->ClearColor == FLinearColor::Green);
+			Test.TestTrue(TEXT("Address mode of the default target"), DefaultTarget->AddressX == TA_Wrap && DefaultTarget->AddressY == TA_Wrap);
+		}
+		Test.TestTrue(TEXT("The authored key gets its idle target back"), Pool.Acquire(Authored) == AuthoredTarget);
+		Test.TestEqual(TEXT("Targets created for two samplings"), Allocator->Created, 2);
+	}
+}
+
+/** Checks render target pool reuse, budget, eviction and sampling keys with targets that own no GPU resource. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRRenderTargetPoolTest, "PICOXR.HMD.RenderTargetPool", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRRenderTargetPoolTest::RunTest(const FString& Parameters)
+{
+	PICOXRRenderTargetPoolTests::TestPool(*this);
+	PICOXRRenderTargetPoolTests::TestSampling(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,216 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_StencilMeshCache.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRStencilMeshCacheTests
+{
+	// Layout of the debug ring at a 90 degree field of view.
+	static const float DebugRadius = 1.04f;
+	static const float DebugP0 = 0.52f;
+	static const float DebugP1 = 0.90666f;
+
+	// Ring of Segments vertices at Radius around the centre, joined to the viewport corners.
+	class FSyntheticSource : public IPICOXRStencilMeshSource
+	{
+	public:
+		int32 Segments = 16;
+		float Radius = 0.95f;
+		bool bAvailable = true;
+		int32 Requests = 0;
+
+		virtual bool GetStencilMesh(int32 Eye, FPICOXRStencilMeshData& OutData) override
+		{
+			Requests++;
+			OutData = FPICOXRStencilMeshData();
+			if (!bAvailable)
+			{
+				return false;
+			}
+			for (int32 Index = 0; Index < Segments; Index++)
+			{
+				const float Angle = 2.0f * PI * Index / Segments;
+				OutData.Vertices.Add(FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * Radius);
+			}
+			const int32 FirstCorner = OutData.Vertices.Num();
+			OutData.Vertices.Append({ FVector2D(1.0f, 1.0f), FVector2D(-1.0f, 1.0f), FVector2D(-1.0f, -1.0f), FVector2D(1.0f, -1.0f) });
+
+			// Segments is a multiple of 4, so every ring edge lies in one quadrant and every quadrant starts on an axis.
+			const int32 PerQuadrant = Segments / 4;
+			for (int32 Index = 0; Index < Segments; Index++)
+			{
+				const int32 Quadrant = Index / PerQuadrant;
+				OutData.Indices.Append({ Index, (Index + 1) % Segments, FirstCorner + Quadrant });
+				if (Index % PerQuadrant == 0)
+				{
+					OutData.Indices.Append({ Index, FirstCorner + Quadrant, FirstCorner + (Quadrant + 3) % 4 });
+				}
+			}
+			return true;
+		}
+	};
+
+	static bool IsInTriangles(const TArray<FVector2D>& Triangles, const FVector2D& Point, float Tolerance)
+	{
+		for (int32 Index = 0; Index + 2 < Triangles.Num(); Index += 3)
+		{
+			const FVector2D& A = Triangles[Index];
+			const FVector2D& B = Triangles[Index + 1];
+			const FVector2D& C = Triangles[Index + 2];
+			const float Area = FVector2D::CrossProduct(B - A, C - A);
+			if (FMath::Abs(Area) < SMALL_NUMBER)
+			{
+				continue;
+			}
+			const float Sign = Area > 0.0f ? 1.0f : -1.0f;
+			if (FVector2D::CrossProduct(B - A, Point - A) * Sign >= -Tolerance
+				&& FVector2D::CrossProduct(C - B, Point - B) * Sign >= -Tolerance
+				&& FVector2D::CrossProduct(A - C, Point - C) * Sign >= -Tolerance)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void TestAreas(FAutomationTestBase& Test, const TCHAR* What, const FPICOXRStencilMesh& Mesh, float InnerRadius, float OuterRadius)
+	{
+		const int32 Samples = 40;
+		int32 Uncovered = 0;
+		int32 HiddenInside = 0;
+		int32 VisibleOutside = 0;
+		for (int32 Y = 0; Y < Samples; Y++)
+		{
+			for (int32 X = 0; X < Samples; X++)
+			{
+				const FVector2D Viewport((X + 0.5f) / Samples, (Y + 0.5f) / Samples);
+				const float ClipRadius = FVector2D(Viewport.X * 2.0f - 1.0f, 1.0f - Viewport.Y * 2.0f).Size();
+				const bool bHidden = IsInTriangles(Mesh.HiddenArea, Viewport, 1.0e-5f);
+				const bool bVisible = IsInTriangles(Mesh.VisibleArea, Viewport, 1.0e-5f);
+				// The two areas cover the viewport, nothing well inside the ring is hidden and nothing well outside it is visible.
+				Uncovered += bHidden || bVisible ? 0 : 1;
+				HiddenInside += bHidden && ClipRadius < InnerRadius - 0.02f ? 1 : 0;
+				VisibleOutside += bVisible && ClipRadius > OuterRadius + 0.02f ? 1 : 0;
+			}
+		}
+		Test.TestEqual(*FString::Printf(TEXT("Samples of %s in neither area"), What), Uncovered, 0);
+		Test.TestEqual(*FString::Printf(TEXT("Samples of %s hidden inside the ring"), What), HiddenInside, 0);
+		Test.TestEqual(*FString::Printf(TEXT("Samples of %s visible outside the ring"), What), VisibleOutside, 0);
+	}
+
+	static void TestBuild(FAutomationTestBase& Test)
+	{
+		// The debug ring keeps its layout, scaled by the tangent of half the field of view.
+		FPICOXRStencilMeshData Data;
+		FPICOXRStencilMesh Mesh;
+		FPICOXRStencilMeshCache::GetDebugMeshData(0, false, Data);
+		Test.TestTrue(TEXT("Debug mesh builds"), FPICOXRStencilMeshCache::BuildMesh(Data, 90.0f, Mesh));
+		Test.TestEqual(TEXT("Debug mesh triangle indices"), Mesh.Triangles.Num(), 36);
+		Test.TestEqual(TEXT("Debug mesh normals"), Mesh.Normals.Num(), 16);
+		Test.TestEqual(TEXT("Debug mesh tangents"), Mesh.Tangents.Num(), 16);
+		Test.TestEqual(TEXT("Debug mesh hidden area"), Mesh.HiddenArea.Num(), 36);
+		if (Test.TestEqual(TEXT("Debug mesh vertices"), Mesh.Vertices.Num(), 16))
+		{
+			Test.TestTrue(TEXT("Debug mesh vertex at 90 degrees"), Mesh.Vertices[1].Equals(FVector(0.0f, DebugP0, DebugP1), 1.0e-4f));
+		}
+		FPICOXRStencilMeshCache::BuildMesh(Data, 60.0f, Mesh);
+		if (Test.TestEqual(TEXT("Debug mesh vertices at 60 degrees"), Mesh.Vertices.Num(), 16))
+		{
+			Test.TestTrue(TEXT("Debug mesh vertex at 60 degrees"), Mesh.Vertices[3].Equals(FVector(0.0f, DebugRadius * FMath::Tan(PI / 6.0f), 0.0f), 1.0e-4f));
+		}
+
+		FPICOXRStencilMeshData Left;
+		FPICOXRStencilMeshData Right;
+		FPICOXRStencilMeshCache::GetDebugMeshData(0, true, Left);
+		FPICOXRStencilMeshCache::GetDebugMeshData(1, true, Right);
+		Test.TestEqual(TEXT("Vertices of the debug mesh with a nose cut"), Left.Vertices.Num(), 17);
+		const bool bLeftIndices = Test.TestEqual(TEXT("Indices of the left debug mesh with a nose cut"), Left.Indices.Num(), 39);
+		const bool bRightIndices = Test.TestEqual(TEXT("Indices of the right debug mesh with a nose cut"), Right.Indices.Num(), 39);
+		if (bLeftIndices && bRightIndices)
+		{
+			Test.TestTrue(TEXT("The nose cut is mirrored between the eyes"), Left.Indices[37] != Right.Indices[37]);
+		}
+		Test.TestTrue(TEXT("Debug mesh with a nose cut builds"), FPICOXRStencilMeshCache::BuildMesh(Left, 90.0f, Mesh));
+
+		// Broken runtime data builds nothing.
+		FPICOXRStencilMeshData Broken = Data;
+		Broken.Indices[4] = Broken.Vertices.Num();
+		Test.TestFalse(TEXT("A mesh with an index out of range builds"), FPICOXRStencilMeshCache::BuildMesh(Broken, 90.0f, Mesh));
+		Test.TestEqual(TEXT("Vertices of a mesh that failed to build"), Mesh.Vertices.Num(), 0);
+		Broken = Data;
+		Broken.Indices.Pop();
+		Test.TestFalse(TEXT("A mesh with a partial triangle builds"), FPICOXRStencilMeshCache::BuildMesh(Broken, 90.0f, Mesh));
+		Test.TestFalse(TEXT("An empty mesh builds"), FPICOXRStencilMeshCache::BuildMesh(FPICOXRStencilMeshData(), 90.0f, Mesh));
+
+		// Hidden and visible areas of synthetic rings.
+		FSyntheticSource Source;
+		for (int32 Segments : { 4, 16, 64 })
+		{
+			Source.Segments = Segments;
+			FPICOXRStencilMeshData Ring;
+			Source.GetStencilMesh(0, Ring);
+			const FString What = FString::Printf(TEXT("a ring of %d segments"), Segments);
+			if (Test.TestTrue(*FString::Printf(TEXT("Mesh of %s builds"), *What), FPICOXRStencilMeshCache::BuildMesh(Ring, 90.0f, Mesh)))
+			{
+				TestAreas(Test, *What, Mesh, Source.Radius * FMath::Cos(PI / Segments), Source.Radius);
+			}
+		}
+
+		// A mask on one side only leaves the whole viewport visible.
+		FPICOXRStencilMeshData Side;
+		Side.Vertices = { FVector2D(0.8f, -1.0f), FVector2D(1.0f, -1.0f), FVector2D(1.0f, 1.0f), FVector2D(0.8f, 1.0f) };
+		Side.Indices = { 0, 1, 2, 0, 2, 3 };
+		Test.TestTrue(TEXT("Mesh masking one side builds"), FPICOXRStencilMeshCache::BuildMesh(Side, 90.0f, Mesh));
+		Test.TestEqual(TEXT("Visible area of a mesh masking one side"), Mesh.VisibleArea.Num(), 6);
+	}
+
+	static void TestCache(FAutomationTestBase& Test)
+	{
+		// Meshes are built once per key and shared.
+		TSharedRef<FSyntheticSource> Source = MakeShared<FSyntheticSource>();
+		FPICOXRStencilMeshCache Cache(Source);
+		const FPICOXRStencilMeshKey LeftKey(0, 90.0f, EPICOXRStencilMeshType::Runtime);
+		FPICOXRStencilMeshPtr First = Cache.Find(LeftKey);
+		FPICOXRStencilMeshPtr Second = Cache.Find(LeftKey);
+		Test.TestTrue(TEXT("Runtime mesh found"), First.IsValid());
+		Test.TestTrue(TEXT("The same key shares the mesh"), First == Second);
+		Test.TestEqual(TEXT("Requests for one key"), Source->Requests, 1);
+		Test.TestTrue(TEXT("The other eye has a mesh of its own"), Cache.Find(FPICOXRStencilMeshKey(1, 90.0f, EPICOXRStencilMeshType::Runtime)) != First);
+		Test.TestEqual(TEXT("Requests after the other eye"), Source->Requests, 2);
+		Test.TestTrue(TEXT("Another field of view has a mesh of its own"), Cache.Find(FPICOXRStencilMeshKey(0, 100.0f, EPICOXRStencilMeshType::Runtime)) != First);
+		Test.TestEqual(TEXT("Requests after another field of view"), Source->Requests, 3);
+		Test.TestTrue(TEXT("Debug mesh found"), Cache.Find(FPICOXRStencilMeshKey(0, 90.0f, EPICOXRStencilMeshType::Debug)).IsValid());
+		Test.TestEqual(TEXT("Requests after the debug mesh"), Source->Requests, 3);
+		Test.TestEqual(TEXT("Cached meshes"), Cache.Num(), 4);
+		Test.TestTrue(TEXT("Builds"), Cache.GetStats().Builds == 4);
+		Test.TestTrue(TEXT("Hits"), Cache.GetStats().Hits == 1);
+
+		// Missing runtime meshes are asked for again.
+		Source->bAvailable = false;
+		const FPICOXRStencilMeshKey MissingKey(0, 80.0f, EPICOXRStencilMeshType::Runtime);
+		Test.TestFalse(TEXT("Missing runtime mesh found"), Cache.Find(MissingKey).IsValid());
+		Test.TestFalse(TEXT("Missing runtime mesh found on the second try"), Cache.Find(MissingKey).IsValid());
+		Test.TestEqual(TEXT("Requests after a missing mesh"), Source->Requests, 5);
+		Test.TestTrue(TEXT("Failures"), Cache.GetStats().Failures == 2);
+		Source->bAvailable = true;
+		Test.TestTrue(TEXT("Runtime mesh found once available"), Cache.Find(MissingKey).IsValid());
+		Test.TestEqual(TEXT("Requests once available"), Source->Requests, 6);
+
+		// A new source drops what the old one built.
+		Cache.SetSource(nullptr);
+		Test.TestEqual(TEXT("Cached meshes after a new source"), Cache.Num(), 0);
+		Test.TestFalse(TEXT("Mesh found after a new source"), Cache.Find(LeftKey).IsValid());
+	}
+}
+
+/** Checks stencil mesh building and caching on synthetic runtime data. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRStencilMeshCacheTest, "PICOXR.HMD.StencilMeshCache", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRStencilMeshCacheTest::RunTest(const FString& Parameters)
+{
+	PICOXRStencilMeshCacheTests::TestBuild(*this);
+	PICOXRStencilMeshCacheTests::TestCache(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,163 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_Trace.h"
+#include "Async/ParallelFor.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRTraceTests
+{
+	static void TestRing(FAutomationTestBase& Test)
+	{
+		// Capacity is a power of two and the oldest records are overwritten in order.
+		FPICOXRTraceRing Ring(100);
+		Test.TestTrue(TEXT("Capacity rounded up to a power of two"), Ring.GetCapacity() == 128);
+		TArray<FPICOXRTraceRecord> Records;
+		Ring.Snapshot(Records);
+		Test.TestEqual(TEXT("Records of an empty ring"), Records.Num(), 0);
+		for (uint32 Index = 0; Index < 300; Index++)
+		{
+			FPICOXRTraceRecord Record;
+			Record.Cycles = 1000 + Index;
+			Record.Payload = Index;
+			Record.FrameNumber = Index / 3;
+			Record.Event = (uint16)(Index % (uint32)EPICOXRTraceEvent::Count);
+			Ring.Record(Record);
+		}
+		Ring.Snapshot(Records);
+		Test.TestEqual(TEXT("Records of a full ring"), Records.Num(), 128);
+		Test.TestEqual(TEXT("Records written"), Ring.GetNumRecorded(), (uint64)300);
+		int32 OutOfOrder = 0;
+		for (int32 Index = 0; Index < Records.Num(); Index++)
+		{
+			OutOfOrder += Records[Index].Payload == 172 + Index ? 0 : 1;
+		}
+		Test.TestEqual(TEXT("Records not the newest in order"), OutOfOrder, 0);
+	}
+
+	static void TestWriters(FAutomationTestBase& Test)
+	{
+		// Writers on several threads lose nothing that still fits in the ring.
+		const int32 Writers = 4;
+		const int32 PerWriter = 4000;
+		FPICOXRTraceRing SharedRing(Writers * PerWriter);
+		ParallelFor(Writers, [&SharedRing](int32 Writer)
+		{
+			for (int32 Index = 0; Index < PerWriter; Index++)
+			{
+				SharedRing.Record(EPICOXRTraceEvent::SubmitLayer, Writer, (uint64)Writer * PerWriter + Index);
+			}
+		});
+		TArray<FPICOXRTraceRecord> Records;
+		SharedRing.Snapshot(Records);
+		TArray<bool> Seen;
+		Seen.SetNumZeroed(Writers * PerWriter);
+		int32 BadRecords = 0;
+		for (const FPICOXRTraceRecord& Record : Records)
+		{
+			if (Record.Payload < (uint64)Seen.Num() && !Seen[Record.Payload] && Record.FrameNumber == Record.Payload / PerWriter)
+			{
+				Seen[Record.Payload] = true;
+			}
+			else
+			{
+				BadRecords++;
+			}
+		}
+		Test.TestEqual(TEXT("Records of concurrent writers"), Records.Num(), Writers * PerWriter);
+		Test.TestEqual(TEXT("Records of concurrent writers duplicated or mixed"), BadRecords, 0);
+
+		// Writers lapping a small ring never leave a record mixed from two of them, what could not claim its slot is dropped.
+		FPICOXRTraceRing SmallRing(64);
+		ParallelFor(Writers, [&SmallRing](int32 Writer)
+		{
+			for (int32 Index = 0; Index < PerWriter; Index++)
+			{
+				FPICOXRTraceRecord Record;
+				Record.Cycles = (uint64)Writer * PerWriter + Index;
+				Record.Payload = Record.Cycles;
+				Record.FrameNumber = Writer;
+				SmallRing.Record(Record);
+			}
+		});
+		SmallRing.Snapshot(Records);
+		Test.TestTrue(TEXT("Records of a lapped ring fit in it"), Records.Num() <= 64);
+		Test.TestTrue(TEXT("Some records of a lapped ring are kept"), SmallRing.GetNumDropped() < SmallRing.GetNumRecorded());
+		int32 MixedRecords = 0;
+		for (const FPICOXRTraceRecord& Record : Records)
+		{
+			MixedRecords += Record.Cycles == Record.Payload && Record.FrameNumber == Record.Payload / PerWriter ? 0 : 1;
+		}
+		Test.TestEqual(TEXT("Records of a lapped ring mixed from two writers"), MixedRecords, 0);
+	}
+
+	static void TestFile(FAutomationTestBase& Test)
+	{
+		TArray<FPICOXRTraceRecord> Records;
+		for (uint32 Index = 0; Index < 64; Index++)
+		{
+			FPICOXRTraceRecord Record;
+			Record.Cycles = 1000 + Index * 7;
+			Record.Payload = (uint64)Index << 40;
+			Record.FrameNumber = Index / 2;
+			Record.Event = (uint16)(Index % (uint32)EPICOXRTraceEvent::Count);
+			Record.Thread = (uint8)(Index % 3);
+			Records.Add(Record);
+		}
+
+		// Files round trip, and anything else is refused.
+		TArray<uint8> Data;
+		FPICOXRTraceFile::Write(Records, 1.0e-6, Data);
+		TArray<FPICOXRTraceRecord> Read;
+		double SecondsPerCycle = 0.0;
+		Test.TestTrue(TEXT("A written file reads back"), FPICOXRTraceFile::Read(Data, Read, SecondsPerCycle));
+		Test.TestTrue(TEXT("Seconds per cycle read back"), SecondsPerCycle == 1.0e-6);
+		if (Test.TestEqual(TEXT("Records read back"), Read.Num(), Records.Num()))
+		{
+			int32 Differences = 0;
+			for (int32 Index = 0; Index < Read.Num(); Index++)
+			{
+				Differences += FMemory::Memcmp(&Read[Index], &Records[Index], sizeof(FPICOXRTraceRecord)) == 0 ? 0 : 1;
+			}
+			Test.TestEqual(TEXT("Records that differ once read back"), Differences, 0);
+		}
+		TArray<uint8> Corrupt = Data;
+		Corrupt[0] ^= 0xff;
+		Test.TestFalse(TEXT("A file with a wrong header reads"), FPICOXRTraceFile::Read(Corrupt, Read, SecondsPerCycle));
+		Corrupt = Data;
+		Corrupt.Pop();
+		Test.TestFalse(TEXT("A truncated file reads"), FPICOXRTraceFile::Read(Corrupt, Read, SecondsPerCycle));
+		Test.TestFalse(TEXT("An empty file reads"), FPICOXRTraceFile::Read(TArray<uint8>(), Read, SecondsPerCycle));
+
+		// Decoded lines carry the time since the first record and the names.
+		TArray<FPICOXRTraceRecord> Pair;
+		Pair.AddDefaulted(2);
+		Pair[0].Cycles = 5000;
+		Pair[0].Event = (uint16)EPICOXRTraceEvent::WaitFrame;
+		Pair[1].Cycles = 7500;
+		Pair[1].Event = (uint16)EPICOXRTraceEvent::Count;
+		Pair[1].Thread = (uint8)EPICOXRTraceThread::RHI;
+		TArray<FString> Lines;
+		FPICOXRTraceFile::Decode(Pair, 1.0e-6, Lines);
+		if (Test.TestEqual(TEXT("Decoded lines"), Lines.Num(), 2))
+		{
+			Test.TestTrue(TEXT("First line starts the clock"), Lines[0].Contains(TEXT("0.000 ms")));
+			Test.TestTrue(TEXT("First line names the event"), Lines[0].Contains(TEXT("WaitFrame")));
+			Test.TestTrue(TEXT("Second line carries the time since the first"), Lines[1].Contains(TEXT("2.500 ms")));
+			Test.TestTrue(TEXT("Second line names an unknown event"), Lines[1].Contains(TEXT("Unknown")));
+			Test.TestTrue(TEXT("Second line names the thread"), Lines[1].Contains(TEXT("RHI")));
+		}
+	}
+}
+
+/** Checks the trace ring, also with concurrent writers, and the trace file round trip. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRTraceTest, "PICOXR.HMD.Trace", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRTraceTest::RunTest(const FString& Parameters)
+{
+	PICOXRTraceTests::TestRing(*this);
+	PICOXRTraceTests::TestWriters(*this);
+	PICOXRTraceTests::TestFile(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,91 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_Utils.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRUtilsTests
+{
+	// Same layout as PxrPosef, so the test runs on every platform.
+	struct FXRQuat { float x, y, z, w; };
+	struct FXRVector { float x, y, z; };
+	struct FXRPose { FXRQuat orientation; FXRVector position; };
+
+	// Two hands worth of joints, the largest batch converted every frame.
+	static const int32 PoseCount = 52;
+
+	static void FillPoses(TArray<FXRPose>& Poses)
+	{
+		FRandomStream Stream(0x5049434F);
+		Poses.SetNumUninitialized(PoseCount);
+		for (FXRPose& Pose : Poses)
+		{
+			const FQuat Quat = FQuat(Stream.VRand(), Stream.FRandRange(-PI, PI));
+			Pose.orientation = { Quat.X, Quat.Y, Quat.Z, Quat.W };
+			Pose.position = { Stream.FRandRange(-2.0f, 2.0f), Stream.FRandRange(-2.0f, 2.0f), Stream.FRandRange(-2.0f, 2.0f) };
+		}
+		// Signed zeros, denormals and large values must round the same way as the scalar path.
+		Poses[0].orientation = { 0.0f, -0.0f, 0.0f, -1.0f };
+		Poses[0].position = { -0.0f, 0.0f, -0.0f };
+		Poses[1].position = { FLT_MIN * 0.5f, -FLT_MIN * 0.25f, 1.0e30f };
+	}
+
+	static void TestBitExact(FAutomationTestBase& Test, const TArray<FXRPose>& Poses, float Scale)
+	{
+		TArray<FQuat> ScalarOrientations, BatchOrientations, QuatOnly;
+		TArray<FVector> ScalarPositions, BatchPositions, VectorOnly;
+		TArray<FTransform> Transforms;
+		ScalarOrientations.SetNumZeroed(PoseCount); BatchOrientations.SetNumZeroed(PoseCount); QuatOnly.SetNumZeroed(PoseCount);
+		ScalarPositions.SetNumZeroed(PoseCount); BatchPositions.SetNumZeroed(PoseCount); VectorOnly.SetNumZeroed(PoseCount);
+		Transforms.SetNum(PoseCount);
+
+		TArray<FXRQuat> Quats;
+		TArray<FXRVector> Vectors;
+		for (int32 Index = 0; Index < PoseCount; Index++)
+		{
+			const FXRPose& Pose = Poses[Index];
+			Quats.Add(Pose.orientation);
+			Vectors.Add(Pose.position);
+			ScalarOrientations[Index] = FPICOXRUtils::ConvertXRQuatToUnrealQuat(FQuat(Pose.orientation.x, Pose.orientation.y, Pose.orientation.z, Pose.orientation.w));
+			ScalarPositions[Index] = FPICOXRUtils::ConvertXRVectorToUnrealVector(FVector(Pose.position.x, Pose.position.y, Pose.position.z), Scale);
+		}
+
+		FPICOXRUtils::ConvertXRPosesToUnrealPoses(Poses.GetData(), BatchOrientations.GetData(), BatchPositions.GetData(), PoseCount, Scale);
+		FPICOXRUtils::ConvertXRQuatsToUnrealQuats(Quats.GetData(), QuatOnly.GetData(), PoseCount);
+		FPICOXRUtils::ConvertXRVectorsToUnrealVectors(Vectors.GetData(), VectorOnly.GetData(), PoseCount, Scale);
+		FPICOXRUtils::ConvertXRPosesToUnrealTransforms(Poses.GetData(), Transforms.GetData(), PoseCount, Scale);
+
+		int32 PoseMismatches = 0, QuatMismatches = 0, VectorMismatches = 0, TransformMismatches = 0;
+		for (int32 Index = 0; Index < PoseCount; Index++)
+		{
+			const FQuat TransformRotation = Transforms[Index].GetRotation();
+			const FVector TransformTranslation = Transforms[Index].GetTranslation();
+			PoseMismatches += FMemory::Memcmp(&ScalarOrientations[Index], &BatchOrientations[Index], sizeof(float) * 4) != 0
+				|| FMemory::Memcmp(&ScalarPositions[Index], &BatchPositions[Index], sizeof(FVector)) != 0;
+			QuatMismatches += FMemory::Memcmp(&ScalarOrientations[Index], &QuatOnly[Index], sizeof(float) * 4) != 0;
+			VectorMismatches += FMemory::Memcmp(&ScalarPositions[Index], &VectorOnly[Index], sizeof(FVector)) != 0;
+			TransformMismatches += FMemory::Memcmp(&ScalarOrientations[Index], &TransformRotation, sizeof(float) * 4) != 0
+				|| FMemory::Memcmp(&ScalarPositions[Index], &TransformTranslation, sizeof(FVector)) != 0;
+		}
+		Test.TestEqual(*FString::Printf(TEXT("Batch poses that differ from the scalar conversion at scale %.1f"), Scale), PoseMismatches, 0);
+		Test.TestEqual(*FString::Printf(TEXT("Batch quaternions that differ from the scalar conversion at scale %.1f"), Scale), QuatMismatches, 0);
+		Test.TestEqual(*FString::Printf(TEXT("Batch vectors that differ from the scalar conversion at scale %.1f"), Scale), VectorMismatches, 0);
+		Test.TestEqual(*FString::Printf(TEXT("Batch transforms that differ from the scalar conversion at scale %.1f"), Scale), TransformMismatches, 0);
+	}
+}
+
+/** Checks the batch pose conversions are bit-exact with the scalar ones. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRUtilsTest, "PICOXR.HMD.Utils", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRUtilsTest::RunTest(const FString& Parameters)
+{
+	TArray<PICOXRUtilsTests::FXRPose> Poses;
+	PICOXRUtilsTests::FillPoses(Poses);
+	for (float Scale : { 100.0f, 1.0f, 37.5f })
+	{
+		PICOXRUtilsTests::TestBitExact(*this, Poses, Scale);
+	}
+	return true;
+}
+#endif
@@ -400,6 +400,34 @@ public:
 	*/
 	UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
 		static bool PXR_BoundaryTestPoint(FVector Point, EPICOXRBoundaryType BoundaryType, bool &IsTriggering, float &ClosestDistance, FVector &ClosestPoint, FVector &ClosestPointNormal);
+
+	/**
+	* Tests a UE4 coordinate against the cached Boundary geometry locally, cheap enough to call for many actors every frame
+	* @param Point					(in) Point in UE tracking space to test against Boundary boundaries
+	* @param BoundaryType			(in) An enum representing the boundary type requested, either Outer Boundary (exact Boundary bounds) or PlayArea (rectangle inside the Outer Boundary)
+	* @param IsInside               (out) Whether the point is inside the Boundary, seen from above
+	* @param ClosestDistance        (out) The horizontal distance between the point and the Boundary
+	* @param ClosestPoint           (out) The closest point on the Boundary, at the height of Point
+	* @param ClosestPointNormal     (out) Normal of closest point, pointing into the Boundary
+	* @return false if no Boundary geometry is available
+	*/
+	UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
+		static bool PXR_BoundaryQueryPoint(FVector Point, EPICOXRBoundaryType BoundaryType, bool &IsInside, float &ClosestDistance, FVector &ClosestPoint, FVector &ClosestPointNormal);
+
+	/**
+	* Tests a sphere in UE4 coordinates against the cached Boundary geometry locally
+	* @param Center					(in) Center of the sphere in UE tracking space
+	* @param Radius					(in) Radius of the sphere
+	* @param BoundaryType			(in) An enum representing the boundary type requested, either Outer Boundary (exact Boundary bounds) or PlayArea (rectangle inside the Outer Boundary)
+	* @param IsInside               (out) Whether the whole sphere is inside the Boundary
+	* @param IsIntersecting         (out) Whether the sphere touches the Boundary
+	* @param SurfaceDistance        (out) Distance between the sphere and the Boundary, negative when the sphere crosses the Boundary or is outside
+	* @param ClosestPoint           (out) The closest point on the Boundary, at the height of Center
+	* @param ClosestPointNormal     (out) Normal of closest point, pointing into the Boundary
+	* @return false if no Boundary geometry is available
+	*/
+	UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
+		static bool PXR_BoundaryQuerySphere(FVector Center, float Radius, EPICOXRBoundaryType BoundaryType, bool &IsInside, bool &IsIntersecting, float &SurfaceDistance, FVector &ClosestPoint, FVector &ClosestPointNormal);
 	
 	/**
 	* Returns the list of points in UE world space of the requested Boundary Type 
@@ -409,6 +437,29 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
 		static TArray<FVector> PXR_GetBoundaryGeometry(EPICOXRBoundaryType BoundaryType);
 
+	/**
+	* Returns the simplified outline of the requested Boundary Type, for gameplay that does not need every point
+	* @param BoundaryType			(in) An enum representing the boundary type requested, either Outer Boundary (exact Boundary bounds) or PlayArea (rectangle inside the Outer Boundary)
+	* @return The array of points in UE world space, within the simplify tolerance of the Boundary.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
+		static TArray<FVector> PXR_GetBoundarySimplifiedGeometry(EPICOXRBoundaryType BoundaryType);
+
+	/**
+	* Returns the revision of the geometry of the requested Boundary Type, which changes whenever the Boundary is redrawn
+	* @param BoundaryType			(in) An enum representing the boundary type requested, either Outer Boundary (exact Boundary bounds) or PlayArea (rectangle inside the Outer Boundary)
+	* @return The revision, 0 while no Boundary geometry is available.
+	*/
+	UFUNCTION(BlueprintPure, Category = "PXR|PXRHMD")
+		static int32 PXR_GetBoundaryGeometryRevision(EPICOXRBoundaryType BoundaryType);
+
+	/**
+	* Sets how far the simplified Boundary geometry may deviate from the Boundary
+	* @param Tolerance				(in) Maximum distance in UE units, 0 only drops collinear points.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
+		static void PXR_SetBoundarySimplifyTolerance(float Tolerance);
+
 	/**
 	* Returns the dimensions in UE world space of the requested Boundary Type
 	* @param BoundaryType			(in) An enum representing the boundary type requested, either Outer Boundary (exact Boundary bounds) or PlayArea (rectangle inside the Outer Boundary)
@@ -424,6 +475,16 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
 		static bool PXR_GetBoundarySeeThroughData(EPICOXRCameraType CameraType,UTexture2D* &CameraImage);
 
+	/**
+	* Get the latest image of the device's camera and its frame number, the image only needs updating when the number changes.
+	* @param CameraType			(in) Left or right camera.
+	* @param CameraImage        (out) The image of the device's camera.
+	* @param FrameNumber        (out) Number of the camera frame, increases with every new image.
+	* @return false until the camera delivered its first image.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
+		static bool PXR_GetBoundarySeeThroughFrame(EPICOXRCameraType CameraType, UTexture2D* &CameraImage, int64 &FrameNumber);
+
 	/**
 	* Set the size of the image of the device's camera.
 	* @param ImageSize			(in) Target image size.
@@ -461,6 +522,7 @@ public:
 
 	/**
 	* Set  Foveation rendering level.
+	* Disables dynamic foveation, the level stays until dynamic foveation is enabled again.
 	* @param Level   rendering level.
 	*/
 	 UFUNCTION(BlueprintCallable, Category = "PXR|PXRHMD")
@@ -0,0 +1,90 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_HandBoneMap.h"
+#include "PXR_InputFunctionLibrary.h"
+#include "ReferenceSkeleton.h"
+
+FPICOXRHandBoneMap::FPICOXRHandBoneMap()
+	:WristBoneIndex(INDEX_NONE)
+	, WristRestCorrection(FQuat::Identity)
+	, bBuilt(false)
+{
+}
+
+void FPICOXRHandBoneMap::Build(const FReferenceSkeleton& RefSkeleton, const TMap<EPICOXRHandJoint, FName>& BoneNames, const TMap<EPICOXRHandJoint, FRotator>& RestCorrections, const UObject* Owner)
+{
+	Reset();
+	for (const auto& BoneElem : BoneNames)
+	{
+		if (BoneElem.Value.IsNone())
+		{
+			continue;
+		}
+		const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneElem.Value);
+		if (BoneIndex == INDEX_NONE)
+		{
+			continue;
+		}
+		const FRotator* Correction = RestCorrections.Find(BoneElem.Key);
+		const FQuat RestCorrection = Correction ? Correction->Quaternion() : FQuat::Identity;
+		if (BoneElem.Key == EPICOXRHandJoint::Wrist)
+		{
+			WristBoneIndex = BoneIndex;
+			for (int32 ParentIndex = RefSkeleton.GetParentIndex(BoneIndex); ParentIndex != INDEX_NONE; ParentIndex = RefSkeleton.GetParentIndex(ParentIndex))
+			{
+				WristParentIndices.Add(ParentIndex);
+			}
+			WristRestCorrection = RestCorrection;
+		}
+		else
+		{
+			Bindings.Add({ static_cast<int32>(BoneElem.Key), BoneIndex, RestCorrection });
+		}
+	}
+	// Walk the bone space transforms front to back
+	Bindings.Sort([](const FPICOXRHandBoneBinding& A, const FPICOXRHandBoneBinding& B) { return A.BoneIndex < B.BoneIndex; });
+
+	BuiltFor = Owner;
+	bBuilt = true;
+}
+
+void FPICOXRHandBoneMap::Reset()
+{
+	Bindings.Reset();
+	WristBoneIndex = INDEX_NONE;
+	WristParentIndices.Reset();
+	WristRestCorrection = FQuat::Identity;
+	BuiltFor.Reset();
+	bBuilt = false;
+}
+
+void FPICOXRHandBoneMap::ApplyJointRotations(const FPICOXRHandJointFrame& Frame, TArray<FTransform>& BoneSpaceTransforms) const
+{
+	for (const FPICOXRHandBoneBinding& Binding : Bindings)
+	{
+		if (!BoneSpaceTransforms.IsValidIndex(Binding.BoneIndex))
+		{
+			continue;
+		}
+		const FQuat& BoneRotation = Frame.Rotations[Binding.Joint];
+		if (!BoneRotation.IsIdentity())
+		{
+			BoneSpaceTransforms[Binding.BoneIndex].SetRotation(BoneRotation * Binding.RestCorrection);
+		}
+	}
+}
+
+void FPICOXRHandBoneMap::ApplyWristRotation(const FQuat& ComponentRotation, TArray<FTransform>& BoneSpaceTransforms) const
+{
+	// Parents come before their children, so a valid wrist index covers them too.
+	if (!BoneSpaceTransforms.IsValidIndex(WristBoneIndex))
+	{
+		return;
+	}
+	FQuat ParentRotation = FQuat::Identity;
+	for (int32 Index = WristParentIndices.Num() - 1; Index >= 0; Index--)
+	{
+		ParentRotation = ParentRotation * BoneSpaceTransforms[WristParentIndices[Index]].GetRotation();
+	}
+	BoneSpaceTransforms[WristBoneIndex].SetRotation(ParentRotation.Inverse() * ComponentRotation);
+}
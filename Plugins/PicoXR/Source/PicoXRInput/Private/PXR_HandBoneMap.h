@@ -0,0 +1,58 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+#include "PXR_HandJointBuffer.h"
+
+struct FReferenceSkeleton;
+enum class EPICOXRHandJoint : uint8;
+
+/** One runtime joint driving one bone of a hand skeletal mesh. */
+struct FPICOXRHandBoneBinding
+{
+	int32 Joint;
+	int32 BoneIndex;
+	// Applied after the runtime rotation, for meshes whose rest pose differs from the runtime basis.
+	FQuat RestCorrection;
+};
+
+/**
+ * Joint to bone retargeting for a hand skeletal mesh.
+ * Bone names are resolved once per skeleton and mapping, so per-frame updates only index arrays.
+ */
+class FPICOXRHandBoneMap
+{
+public:
+	FPICOXRHandBoneMap();
+
+	/** Resolves BoneNames against RefSkeleton. Joints without a name or a matching bone are skipped. */
+	void Build(const FReferenceSkeleton& RefSkeleton, const TMap<EPICOXRHandJoint, FName>& BoneNames, const TMap<EPICOXRHandJoint, FRotator>& RestCorrections, const UObject* Owner);
+
+	/** True when the map was built for this mesh. Edits to the mappings are signalled by the owner through Reset. */
+	bool IsBuiltFor(const UObject* Owner) const
+	{
+		return bBuilt && BuiltFor.Get() == Owner;
+	}
+
+	void Reset();
+
+	/** Writes the rotations of all bound finger joints into bone space transforms in one pass. The wrist is not included. */
+	void ApplyJointRotations(const FPICOXRHandJointFrame& Frame, TArray<FTransform>& BoneSpaceTransforms) const;
+
+	/** Writes a component space rotation to the wrist bone, converted to bone space through its parents. */
+	void ApplyWristRotation(const FQuat& ComponentRotation, TArray<FTransform>& BoneSpaceTransforms) const;
+
+	const TArray<FPICOXRHandBoneBinding>& GetBindings() const { return Bindings; }
+	int32 GetWristBoneIndex() const { return WristBoneIndex; }
+	const FQuat& GetWristRestCorrection() const { return WristRestCorrection; }
+
+private:
+	TArray<FPICOXRHandBoneBinding> Bindings;
+	int32 WristBoneIndex;
+	// Parents of the wrist bone, the wrist's own parent first.
+	TArray<int32> WristParentIndices;
+	FQuat WristRestCorrection;
+	TWeakObjectPtr<const UObject> BuiltFor;
+	bool bBuilt;
+};
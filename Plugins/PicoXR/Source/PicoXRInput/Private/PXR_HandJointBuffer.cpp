@@ -0,0 +1,202 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_HandJointBuffer.h"
+#include "PXR_Log.h"
+
+// EPICOXRHandJoint::Wrist, the root joint uses a different basis than the finger bones.
+static const int32 WristJointIndex = 1;
+
+FPICOXRHandJointFrame::FPICOXRHandJointFrame()
+	:Radii{}
+	, SpaceLocationFlags{}
+	, ValidJointMask(0)
+	, FrameCounter(0)
+	, HandScale(0)
+	, bActive(false)
+{
+	for (int32 Joint = 0; Joint < XR_HAND_JOINT_COUNT_MAX; Joint++)
+	{
+		Rotations[Joint] = FQuat::Identity;
+		Locations[Joint] = FVector::ZeroVector;
+	}
+}
+
+FPICOXRHandJointBuffer::FPICOXRHandJointBuffer()
+	:ReadIndex(0)
+{
+}
+
+void FPICOXRHandJointBuffer::Write(const FPICOXRRawHandJoint* Joints, int32 Hand, bool bActive, float HandScale, float WorldToMetersScale)
+{
+	const int32 PublishedIndex = ReadIndex.Load(EMemoryOrder::Relaxed);
+	const FPICOXRHandJointFrame& Previous = Frames[PublishedIndex];
+	if (!bActive && !Previous.bActive)
+	{
+		return;
+	}
+
+	FPICOXRHandJointFrame& Back = Frames[1 - PublishedIndex];
+	if (bActive)
+	{
+		ConvertJoints(Joints, Hand, WorldToMetersScale, Previous, Back);
+		Back.HandScale = HandScale;
+	}
+	else
+	{
+		// Lost tracking keeps the last joint poses, only the active state changes.
+		Back = Previous;
+	}
+	Back.bActive = bActive;
+	Back.FrameCounter = Previous.FrameCounter + 1;
+	ReadIndex.Store(1 - PublishedIndex, EMemoryOrder::SequentiallyConsistent);
+}
+
+// x - x is zero for finite values and NaN for NaN or infinity.
+static FORCEINLINE VectorRegister VectorIsFinite(const VectorRegister& Vec)
+{
+	return VectorCompareEQ(VectorSubtract(Vec, Vec), VectorZero());
+}
+
+void FPICOXRHandJointBuffer::ConvertJoints(const FPICOXRRawHandJoint* Joints, int32 Hand, float WorldToMetersScale, const FPICOXRHandJointFrame& Previous, FPICOXRHandJointFrame& Out)
+{
+	check(Hand == 0 || Hand == 1);
+	check(&Previous != &Out);
+
+	// Runtime (x,y,z) -> (-z,x,y) * WorldToMeters
+	const VectorRegister ScaleMask = MakeVectorRegister(-WorldToMetersScale, WorldToMetersScale, WorldToMetersScale, 0.0f);
+	// Left bones (y,-z,x,-w), right bones (-y,z,x,-w)
+	const VectorRegister BoneSignMask = Hand == 0 ? MakeVectorRegister(1.0f, -1.0f, 1.0f, -1.0f) : MakeVectorRegister(-1.0f, 1.0f, 1.0f, -1.0f);
+	// Wrist (z,-x,-y,w)
+	const VectorRegister RootSignMask = MakeVectorRegister(1.0f, -1.0f, -1.0f, 1.0f);
+
+	FQuat NewRotations[XR_HAND_JOINT_COUNT_PADDED];
+	FVector NewLocations[XR_HAND_JOINT_COUNT_PADDED];
+	for (int32 Joint = 0; Joint < XR_HAND_JOINT_COUNT_MAX; Joint++)
+	{
+		const VectorRegister Orientation = VectorLoad(&Joints[Joint].pose.orientation.x);
+		const VectorRegister Rotation = Joint == WristJointIndex
+			? VectorMultiply(VectorSwizzle(Orientation, 2, 0, 1, 3), RootSignMask)
+			: VectorMultiply(VectorSwizzle(Orientation, 1, 2, 0, 3), BoneSignMask);
+		VectorStoreAligned(Rotation, &NewRotations[Joint]);
+		VectorStoreFloat3(VectorMultiply(VectorSwizzle(VectorLoadFloat3(&Joints[Joint].pose.position.x), 2, 0, 1, 3), ScaleMask), &NewLocations[Joint]);
+	}
+	for (int32 Joint = XR_HAND_JOINT_COUNT_MAX; Joint < XR_HAND_JOINT_COUNT_PADDED; Joint++)
+	{
+		NewRotations[Joint] = FQuat::Identity;
+		NewLocations[Joint] = FVector::ZeroVector;
+	}
+
+	// Same rule as !Location.ContainsNaN() && !Rotation.ContainsNaN() && Rotation.IsNormalized(), four joints at a time.
+	const VectorRegister One = VectorOne();
+	const VectorRegister NormalizedThreshold = VectorSetFloat1(THRESH_QUAT_NORMALIZED);
+	uint32 ValidMask = 0;
+	for (int32 Group = 0; Group < XR_HAND_JOINT_COUNT_PADDED; Group += 4)
+	{
+		const VectorRegister Q0 = VectorLoadAligned(&NewRotations[Group + 0]);
+		const VectorRegister Q1 = VectorLoadAligned(&NewRotations[Group + 1]);
+		const VectorRegister Q2 = VectorLoadAligned(&NewRotations[Group + 2]);
+		const VectorRegister Q3 = VectorLoadAligned(&NewRotations[Group + 3]);
+		const VectorRegister XY01 = VectorShuffle(Q0, Q1, 0, 1, 0, 1);
+		const VectorRegister XY23 = VectorShuffle(Q2, Q3, 0, 1, 0, 1);
+		const VectorRegister ZW01 = VectorShuffle(Q0, Q1, 2, 3, 2, 3);
+		const VectorRegister ZW23 = VectorShuffle(Q2, Q3, 2, 3, 2, 3);
+		const VectorRegister X = VectorShuffle(XY01, XY23, 0, 2, 0, 2);
+		const VectorRegister Y = VectorShuffle(XY01, XY23, 1, 3, 1, 3);
+		const VectorRegister Z = VectorShuffle(ZW01, ZW23, 0, 2, 0, 2);
+		const VectorRegister W = VectorShuffle(ZW01, ZW23, 1, 3, 1, 3);
+
+		// Summed in the order of FQuat::SizeSquared
+		const VectorRegister SizeSquared = VectorAdd(VectorAdd(VectorAdd(VectorMultiply(X, X), VectorMultiply(Y, Y)), VectorMultiply(Z, Z)), VectorMultiply(W, W));
+		const VectorRegister Normalized = VectorCompareLT(VectorAbs(VectorSubtract(One, SizeSquared)), NormalizedThreshold);
+		const VectorRegister RotationFinite = VectorBitwiseAnd(VectorBitwiseAnd(VectorIsFinite(X), VectorIsFinite(Y)), VectorBitwiseAnd(VectorIsFinite(Z), VectorIsFinite(W)));
+		const uint32 RotationBits = VectorMaskBits(VectorBitwiseAnd(Normalized, RotationFinite));
+
+		// Four packed FVectors are exactly three registers, three mask bits per joint.
+		const float* LocationFloats = &NewLocations[Group].X;
+		const uint32 LocationBits = VectorMaskBits(VectorIsFinite(VectorLoad(LocationFloats)))
+			| (VectorMaskBits(VectorIsFinite(VectorLoad(LocationFloats + 4))) << 4)
+			| (VectorMaskBits(VectorIsFinite(VectorLoad(LocationFloats + 8))) << 8);
+
+		for (int32 Lane = 0; Lane < 4; Lane++)
+		{
+			if ((RotationBits & (1u << Lane)) != 0 && ((LocationBits >> (Lane * 3)) & 7u) == 7u)
+			{
+				ValidMask |= 1u << (Group + Lane);
+			}
+		}
+	}
+	ValidMask &= (1u << XR_HAND_JOINT_COUNT_MAX) - 1;
+
+	for (int32 Joint = 0; Joint < XR_HAND_JOINT_COUNT_MAX; Joint++)
+	{
+		const bool bValid = (ValidMask & (1u << Joint)) != 0;
+		Out.Rotations[Joint] = bValid ? NewRotations[Joint] : Previous.Rotations[Joint];
+		Out.Locations[Joint] = bValid ? NewLocations[Joint] : Previous.Locations[Joint];
+		Out.Radii[Joint] = Joints[Joint].radius * WorldToMetersScale;
+		Out.SpaceLocationFlags[Joint] = Joints[Joint].locationFlags;
+	}
+	Out.ValidJointMask = ValidMask;
+}
+
+void FPICOXRHandJointBuffer::ConvertJointsScalar(const FPICOXRRawHandJoint* Joints, int32 Hand, float WorldToMetersScale, const FPICOXRHandJointFrame& Previous, FPICOXRHandJointFrame& Out)
+{
+	check(Hand == 0 || Hand == 1);
+	uint32 ValidMask = 0;
+	for (int32 Joint = 0; Joint < XR_HAND_JOINT_COUNT_MAX; Joint++)
+	{
+		const FPICOXRRawHandJoint& Raw = Joints[Joint];
+		const FVector Location = FVector(-Raw.pose.position.z, Raw.pose.position.x, Raw.pose.position.y) * WorldToMetersScale;
+		FQuat Rotation;
+		if (Joint == WristJointIndex)
+		{
+			Rotation = FQuat(Raw.pose.orientation.z, -Raw.pose.orientation.x, -Raw.pose.orientation.y, Raw.pose.orientation.w);
+		}
+		else if (Hand == 0)
+		{
+			Rotation = FQuat(Raw.pose.orientation.y, -Raw.pose.orientation.z, Raw.pose.orientation.x, -Raw.pose.orientation.w);
+		}
+		else
+		{
+			Rotation = FQuat(-Raw.pose.orientation.y, Raw.pose.orientation.z, Raw.pose.orientation.x, -Raw.pose.orientation.w);
+		}
+
+		if (!Location.ContainsNaN() && !Rotation.ContainsNaN() && Rotation.IsNormalized())
+		{
+			Out.Rotations[Joint] = Rotation;
+			Out.Locations[Joint] = Location;
+			ValidMask |= 1u << Joint;
+		}
+		else
+		{
+			Out.Rotations[Joint] = Previous.Rotations[Joint];
+			Out.Locations[Joint] = Previous.Locations[Joint];
+		}
+		Out.Radii[Joint] = Raw.radius * WorldToMetersScale;
+		Out.SpaceLocationFlags[Joint] = Raw.locationFlags;
+	}
+	Out.ValidJointMask = ValidMask;
+}
+
+int32 FPICOXRHandJointBuffer::CompareConversions(const FPICOXRRawHandJoint* Joints, int32 Hand, float WorldToMetersScale, const FPICOXRHandJointFrame& Previous)
+{
+	FPICOXRHandJointFrame Vectorised;
+	FPICOXRHandJointFrame Scalar;
+	ConvertJoints(Joints, Hand, WorldToMetersScale, Previous, Vectorised);
+	ConvertJointsScalar(Joints, Hand, WorldToMetersScale, Previous, Scalar);
+
+	int32 Mismatches = 0;
+	for (int32 Joint = 0; Joint < XR_HAND_JOINT_COUNT_MAX; Joint++)
+	{
+		const uint32 JointBit = 1u << Joint;
+		if ((Vectorised.ValidJointMask & JointBit) != (Scalar.ValidJointMask & JointBit)
+			|| FMemory::Memcmp(&Vectorised.Rotations[Joint], &Scalar.Rotations[Joint], sizeof(float) * 4) != 0
+			|| FMemory::Memcmp(&Vectorised.Locations[Joint], &Scalar.Locations[Joint], sizeof(FVector)) != 0
+			|| FMemory::Memcmp(&Vectorised.Radii[Joint], &Scalar.Radii[Joint], sizeof(float)) != 0
+			|| Vectorised.SpaceLocationFlags[Joint] != Scalar.SpaceLocationFlags[Joint])
+		{
+			PXR_LOGW(PxrUnreal, "Hand %d joint %d differs between vectorised and scalar conversion", Hand, Joint);
+			Mismatches++;
+		}
+	}
+	return Mismatches;
+}
@@ -0,0 +1,99 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+
+#ifndef XR_HAND_JOINT_COUNT_MAX
+#define XR_HAND_JOINT_COUNT_MAX 26
+#endif
+
+// Joint groups of four for the vectorised validity pass.
+#define XR_HAND_JOINT_COUNT_PADDED ((XR_HAND_JOINT_COUNT_MAX + 3) & ~3)
+
+/**
+ * One joint as delivered by the runtime.
+ * Same layout as PxrHandJointsLocation, so recorded runtime data can be replayed off-device.
+ */
+struct FPICOXRRawHandJoint
+{
+	uint64 locationFlags;
+	struct
+	{
+		struct { float x, y, z, w; } orientation;
+		struct { float x, y, z; } position;
+	} pose;
+	float radius;
+};
+
+/** Header of one frame in a hand joint recording, followed by XR_HAND_JOINT_COUNT_MAX raw joints. */
+struct FPICOXRHandJointRecordHeader
+{
+	int32 Hand;
+	int32 bActive;
+	float HandScale;
+	float WorldToMetersScale;
+};
+
+/**
+ * Joint data of one hand for one frame, in Unreal tracking space.
+ * Rotations and locations are kept in separate arrays so animation code can read them without copying.
+ */
+struct FPICOXRHandJointFrame
+{
+	FPICOXRHandJointFrame();
+
+	FQuat Rotations[XR_HAND_JOINT_COUNT_MAX];
+	FVector Locations[XR_HAND_JOINT_COUNT_MAX];
+	float Radii[XR_HAND_JOINT_COUNT_MAX];
+	uint64 SpaceLocationFlags[XR_HAND_JOINT_COUNT_MAX];
+
+	// Bit N is set when joint N passed the finite/normalized check this frame, otherwise its previous pose was kept.
+	uint32 ValidJointMask;
+	// Incremented every time a frame is published for this hand.
+	uint32 FrameCounter;
+	float HandScale;
+	bool bActive;
+
+	FORCEINLINE FTransform GetTransform(int32 Joint) const
+	{
+		check(Joint >= 0 && Joint < XR_HAND_JOINT_COUNT_MAX);
+		return FTransform(Rotations[Joint], Locations[Joint]);
+	}
+};
+
+/**
+ * Double-buffered joint frames of one hand.
+ * Write converts into the back buffer and then publishes it, so readers of GetFrame never see a partially written frame.
+ * A published frame stays intact until the next-but-one Write, which covers the rest of the game frame.
+ */
+class FPICOXRHandJointBuffer : public FNoncopyable
+{
+public:
+	FPICOXRHandJointBuffer();
+
+	/** Converts the runtime joints of Hand (0 left, 1 right) and publishes them. */
+	void Write(const FPICOXRRawHandJoint* Joints, int32 Hand, bool bActive, float HandScale, float WorldToMetersScale);
+
+	/** Latest published frame. */
+	FORCEINLINE const FPICOXRHandJointFrame& GetFrame() const
+	{
+		return Frames[ReadIndex.Load(EMemoryOrder::SequentiallyConsistent)];
+	}
+
+	/**
+	 * Vectorised conversion of one frame. Joints that are not finite or not normalized keep the pose from Previous.
+	 * Out may not alias Previous.
+	 */
+	static void ConvertJoints(const FPICOXRRawHandJoint* Joints, int32 Hand, float WorldToMetersScale, const FPICOXRHandJointFrame& Previous, FPICOXRHandJointFrame& Out);
+
+	/** Scalar reference of ConvertJoints, one joint at a time. Results are bit-exact with ConvertJoints. */
+	static void ConvertJointsScalar(const FPICOXRRawHandJoint* Joints, int32 Hand, float WorldToMetersScale, const FPICOXRHandJointFrame& Previous, FPICOXRHandJointFrame& Out);
+
+	/** Compares the result of both conversion paths, returns the number of joints that differ. */
+	static int32 CompareConversions(const FPICOXRRawHandJoint* Joints, int32 Hand, float WorldToMetersScale, const FPICOXRHandJointFrame& Previous);
+
+private:
+	FPICOXRHandJointFrame Frames[2];
+	TAtomic<int32> ReadIndex;
+};
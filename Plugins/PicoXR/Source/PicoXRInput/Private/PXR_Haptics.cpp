@@ -0,0 +1,248 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_Haptics.h"
+#include "PXR_Log.h"
+
+#if PLATFORM_ANDROID
+#include "PxrApi.h"
+#include "PxrInput.h"
+#endif
+
+namespace
+{
+	class FPICOXRHapticsRuntime : public IPICOXRHapticsRuntime
+	{
+	public:
+		FPICOXRHapticsRuntime()
+			: ApiVersion(0)
+		{
+#if PLATFORM_ANDROID
+			Pxr_GetConfigInt(PXR_API_VERSION, &ApiVersion);
+#endif
+		}
+
+		virtual void SetVibration(int32 Hand, float Amplitude, int32 Frequency, int32 DurationMs) override
+		{
+#if PLATFORM_ANDROID
+			if (Frequency > 0 && ApiVersion >= 0x2000305)
+			{
+				Pxr_SetControllerVibrationEvent((uint32)Hand, Frequency, Amplitude, DurationMs);
+			}
+			else
+			{
+				Pxr_SetControllerVibration((uint32)Hand, Amplitude, DurationMs);
+			}
+#endif
+		}
+
+		virtual bool SupportsBufferedPlayback() const override
+		{
+			return ApiVersion >= 0x2000308;
+		}
+
+		virtual bool PlayBuffer(int32 Hand, const FPICOXRHapticsWaveform& Waveform) override
+		{
+#if PLATFORM_ANDROID
+			PxrVibrate_config Config;
+			// Same slots as EPICOXRVibrateController, 1 for the left controller and 2 for the right one.
+			Config.slot = Hand + 1;
+			Config.buffersize = (uint64_t)Waveform.Samples.Num();
+			Config.sampleRate = FMath::RoundToInt(Waveform.SampleRate);
+			Config.channelCounts = 1;
+			Config.bitrate = 32;
+			Config.reversal = 0;
+			Config.isCache = 0;
+			int32_t SourceId = 0;
+			return Pxr_StartVibrateBySharemF(const_cast<float*>(Waveform.Samples.GetData()), &Config, &SourceId) == 0;
+#else
+			return false;
+#endif
+		}
+
+	private:
+		int ApiVersion;
+	};
+}
+
+TSharedRef<IPICOXRHapticsRuntime> IPICOXRHapticsRuntime::CreateDefault()
+{
+	return MakeShared<FPICOXRHapticsRuntime>();
+}
+
+FPICOXRHapticsScheduler::FPICOXRHapticsScheduler(TSharedPtr<IPICOXRHapticsRuntime> InRuntime, const FPICOXRHapticsSettings& InSettings)
+	: Runtime(InRuntime.IsValid() ? InRuntime.ToSharedRef() : IPICOXRHapticsRuntime::CreateDefault())
+	, Settings(InSettings)
+{
+}
+
+void FPICOXRHapticsScheduler::SetRuntime(TSharedPtr<IPICOXRHapticsRuntime> InRuntime)
+{
+	Runtime = InRuntime.IsValid() ? InRuntime.ToSharedRef() : IPICOXRHapticsRuntime::CreateDefault();
+}
+
+void FPICOXRHapticsScheduler::SetForceFeedback(int32 Hand, int32 Channel, float Amplitude)
+{
+	check(Hand >= 0 && Hand < HandCount && Channel >= 0 && Channel < 2);
+	Hands[Hand].ForceFeedback[Channel] = FMath::Clamp(Amplitude, 0.0f, 1.0f);
+	Stats.Requests++;
+}
+
+void FPICOXRHapticsScheduler::SetHapticFeedback(int32 Hand, float Amplitude)
+{
+	check(Hand >= 0 && Hand < HandCount);
+	Hands[Hand].HapticFeedback = FMath::Clamp(Amplitude, 0.0f, 1.0f);
+	Stats.Requests++;
+}
+
+void FPICOXRHapticsScheduler::QueueWaveform(int32 Hand, const FPICOXRHapticsWaveform& Waveform)
+{
+	check(Hand >= 0 && Hand < HandCount);
+	Stats.Requests++;
+	if (Waveform.Samples.Num() == 0 || Waveform.SampleRate <= 0.0f)
+	{
+		PXR_LOGW(PxrUnreal, "Haptic waveform on hand %d dropped, %d samples at %f Hz", Hand, Waveform.Samples.Num(), Waveform.SampleRate);
+		return;
+	}
+	Hands[Hand].Waveforms.Add(Waveform);
+}
+
+void FPICOXRHapticsScheduler::ClearWaveforms(int32 Hand)
+{
+	check(Hand >= 0 && Hand < HandCount);
+	FHandState& State = Hands[Hand];
+	if (State.bWaveformBuffered)
+	{
+		// Send a stop even if nothing else plays.
+		State.SentLevel = -1;
+	}
+	State.Waveforms.Reset();
+	State.WaveformStart = -1.0;
+	State.bWaveformBuffered = false;
+	Stats.Requests++;
+}
+
+void FPICOXRHapticsScheduler::Tick(double Time)
+{
+	for (int32 Hand = 0; Hand < HandCount; Hand++)
+	{
+		TickHand(Hand, Time);
+	}
+}
+
+float FPICOXRHapticsScheduler::SampleWaveform(const FPICOXRHapticsWaveform& Waveform, double Elapsed)
+{
+	const int32 NumSamples = Waveform.Samples.Num();
+	const int32 First = FMath::Clamp((int32)(Elapsed * Waveform.SampleRate), 0, NumSamples - 1);
+	if (Waveform.Type == EPICOXRHapticsWaveformType::Envelope)
+	{
+		return Waveform.Samples[First];
+	}
+	// A drive signal has no amplitude sample by sample, take the peak of the next 10 ms.
+	const int32 Last = FMath::Min(NumSamples, First + FMath::Max(1, (int32)(Waveform.SampleRate * 0.01f)));
+	float Peak = 0.0f;
+	for (int32 Index = First; Index < Last; Index++)
+	{
+		Peak = FMath::Max(Peak, FMath::Abs(Waveform.Samples[Index]));
+	}
+	return Peak;
+}
+
+void FPICOXRHapticsScheduler::TickHand(int32 Hand, double Time)
+{
+	FHandState& State = Hands[Hand];
+
+	// Retire finished waveforms, the next one starts where the previous one ended.
+	while (State.Waveforms.Num() > 0)
+	{
+		if (State.WaveformStart < 0.0)
+		{
+			State.WaveformStart = Time;
+			State.bWaveformBuffered = false;
+			State.bWaveformStepped = false;
+		}
+		const double End = State.WaveformStart + State.Waveforms[0].GetDuration();
+		if (Time < End)
+		{
+			break;
+		}
+		if (State.bWaveformBuffered)
+		{
+			// The runtime stopped at the end of the buffer.
+			State.SentLevel = 0;
+		}
+		State.Waveforms.RemoveAt(0, 1, false);
+		State.WaveformStart = State.Waveforms.Num() > 0 ? End : -1.0;
+		State.bWaveformBuffered = false;
+		State.bWaveformStepped = false;
+	}
+
+	int32 Priority = -1;
+	float Amplitude = 0.0f;
+	int32 Frequency = 0;
+	auto Offer = [&Priority, &Amplitude, &Frequency](int32 SourcePriority, float SourceAmplitude, int32 SourceFrequency)
+	{
+		if (SourceAmplitude > 0.0f && (SourcePriority > Priority || (SourcePriority == Priority && SourceAmplitude > Amplitude)))
+		{
+			Priority = SourcePriority;
+			Amplitude = SourceAmplitude;
+			Frequency = SourceFrequency;
+		}
+	};
+	Offer(ForceFeedbackPriority, FMath::Max(State.ForceFeedback[0], State.ForceFeedback[1]), 0);
+	Offer(HapticFeedbackPriority, State.HapticFeedback, 0);
+
+	if (State.Waveforms.Num() > 0)
+	{
+		const FPICOXRHapticsWaveform& Waveform = State.Waveforms[0];
+		if (State.bWaveformBuffered && Waveform.Priority < Priority)
+		{
+			// A source of a higher priority took over the motor, the rest of the buffer is lost.
+			State.Waveforms.RemoveAt(0, 1, false);
+			State.WaveformStart = State.Waveforms.Num() > 0 ? Time : -1.0;
+			State.bWaveformBuffered = false;
+			State.bWaveformStepped = false;
+		}
+		else
+		{
+			// Buffered or stepped is decided on the first tick, a muted PCM waveform is not restarted later.
+			if (!State.bWaveformBuffered && !State.bWaveformStepped)
+			{
+				if (Waveform.Type == EPICOXRHapticsWaveformType::PCM && Waveform.Priority >= Priority && Runtime->SupportsBufferedPlayback())
+				{
+					Stats.RuntimeCalls++;
+					State.bWaveformBuffered = Runtime->PlayBuffer(Hand, Waveform);
+					Stats.BufferedWaveforms += State.bWaveformBuffered ? 1 : 0;
+				}
+				State.bWaveformStepped = !State.bWaveformBuffered;
+			}
+			if (State.bWaveformBuffered)
+			{
+				State.SentLevel = -1;
+				return;
+			}
+			Offer(Waveform.Priority, SampleWaveform(Waveform, Time - State.WaveformStart), Waveform.Frequency);
+		}
+	}
+
+	const int32 Level = FMath::Clamp(FMath::RoundToInt(Amplitude * Settings.AmplitudeSteps), 0, Settings.AmplitudeSteps);
+	if (Level == 0)
+	{
+		if (State.SentLevel != 0)
+		{
+			Runtime->SetVibration(Hand, 0.0f, 0, 0);
+			Stats.RuntimeCalls++;
+			State.SentLevel = 0;
+			State.SentFrequency = 0;
+			State.SentTime = Time;
+		}
+		return;
+	}
+	if (Level != State.SentLevel || Frequency != State.SentFrequency || Time - State.SentTime >= Settings.LeaseSeconds * 0.5)
+	{
+		Runtime->SetVibration(Hand, Level / (float)Settings.AmplitudeSteps, Frequency, FMath::CeilToInt(Settings.LeaseSeconds * 1000.0));
+		Stats.RuntimeCalls++;
+		State.SentLevel = Level;
+		State.SentFrequency = Frequency;
+		State.SentTime = Time;
+	}
+}
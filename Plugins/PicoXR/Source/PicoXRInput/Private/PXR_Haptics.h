@@ -0,0 +1,126 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+
+enum class EPICOXRHapticsWaveformType : uint8
+{
+	// Amplitudes from 0 to 1, stepped through by the scheduler and mixed with the other sources.
+	Envelope,
+	// Motor drive signal from -1 to 1 at an audio rate. Handed to the runtime in one go where it supports that,
+	// otherwise played as the envelope of its peaks.
+	PCM,
+};
+
+/** Waveform queued on one hand. */
+struct FPICOXRHapticsWaveform
+{
+	EPICOXRHapticsWaveformType Type = EPICOXRHapticsWaveformType::Envelope;
+	TArray<float> Samples;
+	float SampleRate = 100.0f;
+	// Motor frequency in Hz for envelopes, 0 for the motor default.
+	int32 Frequency = 0;
+	// Sources of a lower priority are muted while the waveform plays.
+	int32 Priority = 2;
+
+	double GetDuration() const
+	{
+		return SampleRate > 0.0f ? Samples.Num() / (double)SampleRate : 0.0;
+	}
+};
+
+/** Vibration calls of the runtime. The default one calls the runtime, a fake can be set on the scheduler instead. */
+class IPICOXRHapticsRuntime
+{
+public:
+	virtual ~IPICOXRHapticsRuntime() {}
+
+	/** Vibrates Hand at Amplitude for DurationMs, replacing whatever it played. Amplitude 0 stops it. */
+	virtual void SetVibration(int32 Hand, float Amplitude, int32 Frequency, int32 DurationMs) = 0;
+
+	/** Whether PlayBuffer can hand PCM waveforms to the runtime. */
+	virtual bool SupportsBufferedPlayback() const = 0;
+
+	/** Starts a PCM waveform on Hand, the runtime plays it on its own. @return false if it was not started. */
+	virtual bool PlayBuffer(int32 Hand, const FPICOXRHapticsWaveform& Waveform) = 0;
+
+	static TSharedRef<IPICOXRHapticsRuntime> CreateDefault();
+};
+
+struct FPICOXRHapticsSettings
+{
+	// Amplitudes are sent in this many steps, changes within a step are dropped.
+	int32 AmplitudeSteps = 255;
+	// Duration of every vibration sent. A steady amplitude is sent again halfway through,
+	// so the motors stop on their own if updates stop coming.
+	double LeaseSeconds = 0.2;
+};
+
+struct FPICOXRHapticsStats
+{
+	// Values set by the engine and the game, whether they changed anything or not.
+	uint32 Requests = 0;
+	uint32 RuntimeCalls = 0;
+	uint32 BufferedWaveforms = 0;
+};
+
+/**
+ * Vibration of both hands, mixed from force feedback, haptic feedback and queued waveforms.
+ * Setters only store values. Tick picks the source of the highest priority that is active on each hand,
+ * the strongest one if several share it, and calls the runtime only when the result changes or its lease runs out.
+ * Game thread only.
+ */
+class FPICOXRHapticsScheduler
+{
+public:
+	static const int32 HandCount = 2;
+	static const int32 ForceFeedbackPriority = 0;
+	static const int32 HapticFeedbackPriority = 1;
+
+	explicit FPICOXRHapticsScheduler(TSharedPtr<IPICOXRHapticsRuntime> InRuntime = nullptr, const FPICOXRHapticsSettings& InSettings = FPICOXRHapticsSettings());
+
+	/** Replaces the runtime, nullptr restores the default. */
+	void SetRuntime(TSharedPtr<IPICOXRHapticsRuntime> InRuntime);
+
+	/** Force feedback channel of Hand, 0 for the large motor and 1 for the small one. Kept until changed. */
+	void SetForceFeedback(int32 Hand, int32 Channel, float Amplitude);
+
+	/** Haptic feedback effect value of Hand. Kept until changed, 0 ends it. */
+	void SetHapticFeedback(int32 Hand, float Amplitude);
+
+	/** Plays Waveform on Hand once the waveforms queued before it are done. */
+	void QueueWaveform(int32 Hand, const FPICOXRHapticsWaveform& Waveform);
+
+	/** Drops the waveforms of Hand, including the one playing. */
+	void ClearWaveforms(int32 Hand);
+
+	/** Mixes the sources of both hands at Time, in seconds, and sends what changed. */
+	void Tick(double Time);
+
+	const FPICOXRHapticsStats& GetStats() const { return Stats; }
+
+private:
+	struct FHandState
+	{
+		float ForceFeedback[2] = {};
+		float HapticFeedback = 0.0f;
+		TArray<FPICOXRHapticsWaveform> Waveforms;
+		// Start of Waveforms[0], negative until its first tick.
+		double WaveformStart = -1.0;
+		bool bWaveformBuffered = false;
+		// Waveforms[0] is stepped through by the scheduler, either by type or because the runtime did not take it.
+		bool bWaveformStepped = false;
+		// Last vibration sent, SentLevel is -1 while the runtime plays a buffer.
+		int32 SentLevel = 0;
+		int32 SentFrequency = 0;
+		double SentTime = 0.0;
+	};
+
+	void TickHand(int32 Hand, double Time);
+	static float SampleWaveform(const FPICOXRHapticsWaveform& Waveform, double Elapsed);
+
+	TSharedRef<IPICOXRHapticsRuntime> Runtime;
+	FPICOXRHapticsSettings Settings;
+	FHandState Hands[HandCount];
+	FPICOXRHapticsStats Stats;
+};
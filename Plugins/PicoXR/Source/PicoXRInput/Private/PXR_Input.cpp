@@ -5,12 +5,16 @@
 #include "PXR_HMD.h"
 #include "CoreMinimal.h"
 #include "PXR_Log.h"
+#include "PXR_Trace.h"
 #include "IXRTrackingSystem.h"
 #include "MotionControllerComponent.h"
 #include "PXR_HandComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "PXR_InputFunctionLibrary.h"
 #include "Features/IModularFeatures.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 
 #if PLATFORM_ANDROID
 #include "Misc/CoreDelegates.h"
@@ -18,26 +22,30 @@
 #include "Android/AndroidJNI.h"
 #include "PxrApi.h"
 #include "PxrInput.h"
+
+static_assert(sizeof(FPICOXRRawHandJoint) == sizeof(PxrHandJointsLocation), "FPICOXRRawHandJoint must match PxrHandJointsLocation");
+static_assert(STRUCT_OFFSET(FPICOXRRawHandJoint, pose) == STRUCT_OFFSET(PxrHandJointsLocation, pose), "FPICOXRRawHandJoint must match PxrHandJointsLocation");
+static_assert(STRUCT_OFFSET(FPICOXRRawHandJoint, radius) == STRUCT_OFFSET(PxrHandJointsLocation, radius), "FPICOXRRawHandJoint must match PxrHandJointsLocation");
 #endif
 #define LOCTEXT_NAMESPACE "PICOXRInput"
 
+static_assert(EPICOButton::ButtonCount <= FPICOXRInputFrame::TouchBit, "Controller buttons overlap the touch bits");
+static_assert(FPICOXRInputFrame::TouchBit + EPICOTouchButton::ButtonCount <= FPICOXRInputFrame::HandBit, "Touch buttons overlap the hand bits");
+static_assert(FPICOXRInputFrame::HandBit + EPICOHandButton::ButtonCount <= FPICOXRInputFrame::ButtonBitCount, "Hand buttons do not fit the input frame");
+
 FVector FPICOXRInput::OriginOffsetL = FVector::ZeroVector;
 FVector FPICOXRInput::OriginOffsetR = FVector::ZeroVector;
 
 FPICOXRInput::FPICOXRInput()
-	:bHandTrackingAvailable(false)
+	:HandJointRecordFramesLeft(0)
+	,bHandTrackingAvailable(false)
     ,PICOXRHMD(nullptr)
 	,MessageHandler(new FGenericApplicationMessageHandler())
 	,LeftConnectState(false)
 	,RightConnectState(false)
+	,InputStateRecordFramesLeft(0)
 	,LeftControllerPower(0)
 	,RightControllerPower(0)
-	,LeftControllerTouchPoint(FVector2D::ZeroVector)
-	,RightControllerTouchPoint(FVector2D::ZeroVector)
-	,LeftControllerTriggerValue(0.0f)
-	,RightControllerTriggerValue(0.0f)
-	,LeftControllerGripValue(0.0f)
-	,RightControllerGripValue(0.0f)
 	,MainControllerHandle(-1)
 	,ControllerType(EPICOInputType::Unknown)
 	,CurrentVersion(0)
@@ -52,6 +60,15 @@ FPICOXRInput::FPICOXRInput()
 		Pxr_SetControllerEnableKey(Settings->bEnableHomeKey, PxrControllerKeyMap::PXR_CONTROLLER_KEY_HOME);
 	}
 	Pxr_GetConfigInt(PxrConfigType::PXR_API_VERSION, &CurrentVersion);
+	if (Settings)
+	{
+		FPICOXRInputDiffSettings DiffSettings;
+		DiffSettings.RepeatMask = Settings->bEnableButtonRepeat ? FPICOXRInputFrame::ControllerButtonMask : 0;
+		DiffSettings.InitialRepeatDelay = FMath::Max(Settings->ButtonRepeatDelay, 0.0f);
+		DiffSettings.RepeatInterval = FMath::Max(Settings->ButtonRepeatInterval, 0.01f);
+		DiffSettings.AxisDeadband = FMath::RoundToInt(FMath::Clamp(Settings->AnalogDeadband, 0.0f, 1.0f) * FPICOXRInputFrame::AxisScale);
+		InputDiff.SetSettings(DiffSettings);
+	}
 #endif
 	RegisterKeys();
 	SetKeyMapping();
@@ -73,6 +90,7 @@ FPICOXRInput::~FPICOXRInput()
 
 void FPICOXRInput::Tick(float DeltaTime)
 {
+	Haptics.Tick(FPlatformTime::Seconds());
 }
 
 void FPICOXRInput::SendControllerEvents()
@@ -84,7 +102,6 @@ void FPICOXRInput::SendControllerEvents()
 		PICOXRHMD->OnGameFrameBegin_GameThread();
 	}
 	ProcessButtonEvent();
-	ProcessButtonAxis();
 #endif
 	UpdateHandState();
 }
@@ -101,39 +118,39 @@ bool FPICOXRInput::Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar)
 
 void FPICOXRInput::SetChannelValue(int32 ControllerId, FForceFeedbackChannelType ChannelType, float Value)
 {
-#if PLATFORM_ANDROID
 	switch (ChannelType)
 	{
 		case FForceFeedbackChannelType::LEFT_LARGE:
+		{
+			Haptics.SetForceFeedback(0, 0, Value);
+			break;
+		}
 		case FForceFeedbackChannelType::LEFT_SMALL:
 		{
-			Pxr_SetControllerVibration(0, Value, 10);
+			Haptics.SetForceFeedback(0, 1, Value);
 			break;
 		}
 		case FForceFeedbackChannelType::RIGHT_LARGE:
+		{
+			Haptics.SetForceFeedback(1, 0, Value);
+			break;
+		}
 		case FForceFeedbackChannelType::RIGHT_SMALL:
 		{
-			Pxr_SetControllerVibration(1, Value, 10);
+			Haptics.SetForceFeedback(1, 1, Value);
 			break;
 		}
 		default:
 			break;
 	}
-#endif
 }
 
 void FPICOXRInput::SetChannelValues(int32 ControllerId, const FForceFeedbackValues& values)
 {
-#if PLATFORM_ANDROID
-	if (values.LeftLarge > 0)
-	{
-		Pxr_SetControllerVibration(0, values.LeftLarge, 10);
-	}
-	if (values.RightLarge >0)
-	{
-		Pxr_SetControllerVibration(1, values.RightLarge, 10);
-	}
-#endif
+	Haptics.SetForceFeedback(0, 0, values.LeftLarge);
+	Haptics.SetForceFeedback(0, 1, values.LeftSmall);
+	Haptics.SetForceFeedback(1, 0, values.RightLarge);
+	Haptics.SetForceFeedback(1, 1, values.RightSmall);
 }
 
 FQuat FPICOXRInput::GetBoneRotation(const EPICOXRHandType DeviceHand, const EPICOXRHandJoint BoneId)
@@ -184,7 +201,7 @@ bool FPICOXRInput::IsBoneOrientationValid(const EPICOXRHandType DeviceHand, cons
 	if (DeviceHand != EPICOXRHandType::None)
 	{
 		const FPICOXRHandState& HandState = (DeviceHand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
-		return ((HandState.SpaceLocationFlags[static_cast<uint8>(BoneId)] & StaticCast<uint64>(XrSpaceLocationFlags::XR_SPACE_LOCATION_ORIENTATION_VALID_BIT)) != 0);
+		return ((HandState.GetJointFrame().SpaceLocationFlags[static_cast<uint8>(BoneId)] & StaticCast<uint64>(XrSpaceLocationFlags::XR_SPACE_LOCATION_ORIENTATION_VALID_BIT)) != 0);
 	}
 	return false;
 }
@@ -194,7 +211,7 @@ bool FPICOXRInput::IsBonePositionValid(const EPICOXRHandType DeviceHand, const E
 	if (DeviceHand != EPICOXRHandType::None)
 	{
 		const FPICOXRHandState& HandState = (DeviceHand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
-		return ((HandState.SpaceLocationFlags[static_cast<uint8>(BoneId)] & StaticCast<uint64>(XrSpaceLocationFlags::XR_SPACE_LOCATION_POSITION_VALID_BIT)) != 0);
+		return ((HandState.GetJointFrame().SpaceLocationFlags[static_cast<uint8>(BoneId)] & StaticCast<uint64>(XrSpaceLocationFlags::XR_SPACE_LOCATION_POSITION_VALID_BIT)) != 0);
 	}
 	return false;
 }
@@ -204,7 +221,7 @@ bool FPICOXRInput::IsBoneOrientationTracked(const EPICOXRHandType DeviceHand, co
 	if (DeviceHand != EPICOXRHandType::None)
 	{
 		const FPICOXRHandState& HandState = (DeviceHand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
-		return ((HandState.SpaceLocationFlags[static_cast<uint8>(BoneId)] & StaticCast<uint64>(XrSpaceLocationFlags::XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT)) != 0);
+		return ((HandState.GetJointFrame().SpaceLocationFlags[static_cast<uint8>(BoneId)] & StaticCast<uint64>(XrSpaceLocationFlags::XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT)) != 0);
 	}
 	return false;
 }
@@ -214,7 +231,7 @@ bool FPICOXRInput::IsBonePositionTracked(const EPICOXRHandType DeviceHand, const
 	if (DeviceHand != EPICOXRHandType::None)
 	{
 		const FPICOXRHandState& HandState = (DeviceHand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
-		return ((HandState.SpaceLocationFlags[static_cast<uint8>(BoneId)] & StaticCast<uint64>(XrSpaceLocationFlags::XR_SPACE_LOCATION_POSITION_TRACKED_BIT)) != 0);
+		return ((HandState.GetJointFrame().SpaceLocationFlags[static_cast<uint8>(BoneId)] & StaticCast<uint64>(XrSpaceLocationFlags::XR_SPACE_LOCATION_POSITION_TRACKED_BIT)) != 0);
 	}
 	return false;
 }
@@ -249,7 +266,7 @@ float FPICOXRInput::GetHandScale(const EPICOXRHandType DeviceHand)
 	if (DeviceHand != EPICOXRHandType::None)
 	{
 		const FPICOXRHandState& HandState = (DeviceHand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
-		return HandState.HandScale;
+		return HandState.GetJointFrame().HandScale;
 	}
 
 	return 1.0f;
@@ -260,7 +277,7 @@ EPICOXRHandTrackingConfidence FPICOXRInput::GetTrackingConfidence(const EPICOXRH
 	if (DeviceHand != EPICOXRHandType::None)
 	{
 		const FPICOXRHandState& HandState = (DeviceHand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
-		return HandState.ReceivedJointPoses ? EPICOXRHandTrackingConfidence::High : EPICOXRHandTrackingConfidence::Low;
+		return HandState.GetJointFrame().bActive ? EPICOXRHandTrackingConfidence::High : EPICOXRHandTrackingConfidence::Low;
 	}
 	return EPICOXRHandTrackingConfidence::Low;
 }
@@ -270,7 +287,7 @@ FTransform FPICOXRInput::GetPointerPose(const EPICOXRHandType DeviceHand)
 	if (DeviceHand != EPICOXRHandType::None)
 	{
 		const FPICOXRHandState& HandState = (DeviceHand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
-		if (HandState.ReceivedJointPoses)
+		if (HandState.GetJointFrame().bActive)
 		{
 			FQuat CalibratedOrientation;
 			FTransform OutTransform;
@@ -445,6 +462,16 @@ EPICOXRActiveInputDevice FPICOXRInput::GetActiveInputDevice()
 	return EPICOXRActiveInputDevice::NoneActive;
 }
 
+const FPICOXRHandJointFrame* FPICOXRInput::GetHandJointFrame(const EPICOXRHandType DeviceHand) const
+{
+	if (!bHandTrackingAvailable || DeviceHand == EPICOXRHandType::None)
+	{
+		return nullptr;
+	}
+	const FPICOXRHandState& HandState = (DeviceHand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
+	return &HandState.GetJointFrame();
+}
+
 bool FPICOXRInput::IsHandTrackingStateValid() const
 {
 	bool State = false;
@@ -468,7 +495,7 @@ bool FPICOXRInput::GetKeypointState(EPICOXRHandType Hand, EPICOXRHandJoint Keypo
 	{
 		const FPICOXRHandState& HandState = (Hand == EPICOXRHandType::HandLeft) ? GetLeftHandState() : GetRightHandState();
 		gotTransform = HandState.GetTransform(Keypoint, OutTransform);
-		OutRadius = HandState.Radii[static_cast<uint8>(Keypoint)];
+		OutRadius = HandState.GetJointFrame().Radii[static_cast<uint8>(Keypoint)];
 	}
 
 	return gotTransform;
@@ -503,7 +530,7 @@ bool FPICOXRInput::GetControllerOrientationAndPosition(const int32 ControllerInd
 		predictedDisplayTimeMs = CurrentFrame->predictedDisplayTimeMs;
 		SourcePosition = CurrentFrame->Position;
 		SourceOrientation = CurrentFrame->Orientation;
-		PXR_LOGV(PxrUnreal, "GetControllerOrientationAndPosition FrameNumber:%d,predictedDisplayTimeMs:%f", CurrentFrame->FrameNumber, predictedDisplayTimeMs);
+		PXR_TRACE(ControllerPose, CurrentFrame->FrameNumber, (uint64)(predictedDisplayTimeMs * 1000.0));
 	}
 	else
 	{
@@ -600,23 +627,10 @@ ETrackingStatus FPICOXRInput::GetControllerTrackingStatus(const int32 Controller
 
 void FPICOXRInput::SetHapticFeedbackValues(int32 ControllerId, int32 Hand, const FHapticFeedbackValues& Values)
 {
-#if PLATFORM_ANDROID
-	switch (Hand)
+	if (Hand == (int32)EControllerHand::Left || Hand == (int32)EControllerHand::Right)
 	{
-		case 0:
-		{
-			Pxr_SetControllerVibration(0, Values.Amplitude * GetHapticAmplitudeScale(), 2000);
-			break;
-		}
-		case 1:
-		{
-			Pxr_SetControllerVibration(1, Values.Amplitude * GetHapticAmplitudeScale(), 2000);
-			break;
-		}
-		default:
-		break;
+		Haptics.SetHapticFeedback(Hand, Values.Amplitude * GetHapticAmplitudeScale());
 	}
-#endif
 }
 
 void FPICOXRInput::GetHapticFrequencyRange(float& MinFrequency, float& MaxFrequency) const
@@ -690,475 +704,195 @@ bool FPICOXRInput::UPxr_SetControllerMainInputHandle(int32 InHandness)
 
 void FPICOXRInput::SetKeyMapping()
 {
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::RockerX] = FPICOKeyNames::PICOTouch_Left_Thumbstick_X;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::RockerY] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Y;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::Home] = FPICOKeyNames::PICOTouch_Left_Home_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::App] = FPICOKeyNames::PICOTouch_Left_Menu_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::Rocker] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::VolumeUp] = FPICOKeyNames::PICOTouch_Left_VolumeUp_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::VolumeDown] = FPICOKeyNames::PICOTouch_Left_VolumeDown_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::Trigger] = FPICOKeyNames::PICOTouch_Left_Trigger_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::AorX] = FPICOKeyNames::PICOTouch_Left_X_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::BorY] = FPICOKeyNames::PICOTouch_Left_Y_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::Grip] = FPICOKeyNames::PICOTouch_Left_Grip_Click;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::RockerUp] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Up;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::RockerDown] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Down;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::RockerLeft] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Left;
-	Buttons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOButton::RockerRight] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Right;
-
-
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::RockerX] = FPICOKeyNames::PICOTouch_Right_Thumbstick_X;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::RockerY] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Y;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::Home] = FPICOKeyNames::PICOTouch_Right_Home_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::App] = FPICOKeyNames::PICOTouch_Right_System_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::Rocker] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::VolumeUp] = FPICOKeyNames::PICOTouch_Right_VolumeUp_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::VolumeDown] = FPICOKeyNames::PICOTouch_Right_VolumeDown_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::Trigger] = FPICOKeyNames::PICOTouch_Right_Trigger_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::AorX] = FPICOKeyNames::PICOTouch_Right_A_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::BorY] = FPICOKeyNames::PICOTouch_Right_B_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::Grip] = FPICOKeyNames::PICOTouch_Right_Grip_Click;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::RockerUp] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Up;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::RockerDown] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Down;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::RockerLeft] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Left;
-	Buttons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOButton::RockerRight] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Right;
-	
-	HandButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOHandButton::Index] = FPICOKeyNames::PICOHand_Left_IndexPinch;
-	HandButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOHandButton::Middle] = FPICOKeyNames::PICOHand_Left_MiddlePinch;
-	HandButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOHandButton::Pinky] = FPICOKeyNames::PICOHand_Left_PinkyPinch;
-	HandButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOHandButton::Ring] = FPICOKeyNames::PICOHand_Left_RingPinch;
-	HandButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOHandButton::ThumbClick] = FPICOKeyNames::PICOHand_Left_ThumbClick;
-	
-	HandButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOHandButton::Index] = FPICOKeyNames::PICOHand_Right_IndexPinch;
-	HandButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOHandButton::Middle] = FPICOKeyNames::PICOHand_Right_MiddlePinch;
-	HandButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOHandButton::Pinky] = FPICOKeyNames::PICOHand_Right_PinkyPinch;
-	HandButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOHandButton::Ring] = FPICOKeyNames::PICOHand_Right_RingPinch;
-	HandButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOHandButton::ThumbClick] = FPICOKeyNames::PICOHand_Right_ThumbClick;
-	
-	TouchButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOTouchButton::AorX] = FPICOKeyNames::PICOTouch_Left_X_Touch;
-	TouchButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOTouchButton::BorY] = FPICOKeyNames::PICOTouch_Left_Y_Touch;
-	TouchButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOTouchButton::Rocker] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Touch;
-	TouchButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOTouchButton::Trigger] = FPICOKeyNames::PICOTouch_Left_Trigger_Touch;
-	TouchButtons[(int32)EPICOXRControllerHandness::LeftController][(int32)EPICOTouchButton::Thumbrest] = FPICOKeyNames::PICOTouch_Left_Thumbrest_Touch;
-
-	TouchButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOTouchButton::AorX] = FPICOKeyNames::PICOTouch_Right_A_Touch;
-	TouchButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOTouchButton::BorY] = FPICOKeyNames::PICOTouch_Right_B_Touch;
-	TouchButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOTouchButton::Rocker] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Touch;
-	TouchButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOTouchButton::Trigger] = FPICOKeyNames::PICOTouch_Right_Trigger_Touch;
-	TouchButtons[(int32)EPICOXRControllerHandness::RightController][(int32)EPICOTouchButton::Thumbrest] = FPICOKeyNames::PICOTouch_Right_Thumbrest_Touch;
+	const int32 Left = EPICOXRControllerHandness::LeftController;
+	const int32 Right = EPICOXRControllerHandness::RightController;
+	const int32 Touch = FPICOXRInputFrame::TouchBit;
+	const int32 Hand = FPICOXRInputFrame::HandBit;
+
+	ButtonKeys[Left][EPICOButton::Home] = FPICOKeyNames::PICOTouch_Left_Home_Click;
+	ButtonKeys[Left][EPICOButton::App] = FPICOKeyNames::PICOTouch_Left_Menu_Click;
+	ButtonKeys[Left][EPICOButton::Rocker] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Click;
+	ButtonKeys[Left][EPICOButton::VolumeUp] = FPICOKeyNames::PICOTouch_Left_VolumeUp_Click;
+	ButtonKeys[Left][EPICOButton::VolumeDown] = FPICOKeyNames::PICOTouch_Left_VolumeDown_Click;
+	ButtonKeys[Left][EPICOButton::Trigger] = FPICOKeyNames::PICOTouch_Left_Trigger_Click;
+	ButtonKeys[Left][EPICOButton::AorX] = FPICOKeyNames::PICOTouch_Left_X_Click;
+	ButtonKeys[Left][EPICOButton::BorY] = FPICOKeyNames::PICOTouch_Left_Y_Click;
+	ButtonKeys[Left][EPICOButton::Grip] = FPICOKeyNames::PICOTouch_Left_Grip_Click;
+	ButtonKeys[Left][EPICOButton::RockerUp] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Up;
+	ButtonKeys[Left][EPICOButton::RockerDown] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Down;
+	ButtonKeys[Left][EPICOButton::RockerLeft] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Left;
+	ButtonKeys[Left][EPICOButton::RockerRight] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Right;
+
+	ButtonKeys[Right][EPICOButton::Home] = FPICOKeyNames::PICOTouch_Right_Home_Click;
+	ButtonKeys[Right][EPICOButton::App] = FPICOKeyNames::PICOTouch_Right_System_Click;
+	ButtonKeys[Right][EPICOButton::Rocker] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Click;
+	ButtonKeys[Right][EPICOButton::VolumeUp] = FPICOKeyNames::PICOTouch_Right_VolumeUp_Click;
+	ButtonKeys[Right][EPICOButton::VolumeDown] = FPICOKeyNames::PICOTouch_Right_VolumeDown_Click;
+	ButtonKeys[Right][EPICOButton::Trigger] = FPICOKeyNames::PICOTouch_Right_Trigger_Click;
+	ButtonKeys[Right][EPICOButton::AorX] = FPICOKeyNames::PICOTouch_Right_A_Click;
+	ButtonKeys[Right][EPICOButton::BorY] = FPICOKeyNames::PICOTouch_Right_B_Click;
+	ButtonKeys[Right][EPICOButton::Grip] = FPICOKeyNames::PICOTouch_Right_Grip_Click;
+	ButtonKeys[Right][EPICOButton::RockerUp] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Up;
+	ButtonKeys[Right][EPICOButton::RockerDown] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Down;
+	ButtonKeys[Right][EPICOButton::RockerLeft] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Left;
+	ButtonKeys[Right][EPICOButton::RockerRight] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Right;
+
+	ButtonKeys[Left][Touch + EPICOTouchButton::AorX] = FPICOKeyNames::PICOTouch_Left_X_Touch;
+	ButtonKeys[Left][Touch + EPICOTouchButton::BorY] = FPICOKeyNames::PICOTouch_Left_Y_Touch;
+	ButtonKeys[Left][Touch + EPICOTouchButton::Rocker] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Touch;
+	ButtonKeys[Left][Touch + EPICOTouchButton::Trigger] = FPICOKeyNames::PICOTouch_Left_Trigger_Touch;
+	ButtonKeys[Left][Touch + EPICOTouchButton::Thumbrest] = FPICOKeyNames::PICOTouch_Left_Thumbrest_Touch;
+
+	ButtonKeys[Right][Touch + EPICOTouchButton::AorX] = FPICOKeyNames::PICOTouch_Right_A_Touch;
+	ButtonKeys[Right][Touch + EPICOTouchButton::BorY] = FPICOKeyNames::PICOTouch_Right_B_Touch;
+	ButtonKeys[Right][Touch + EPICOTouchButton::Rocker] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Touch;
+	ButtonKeys[Right][Touch + EPICOTouchButton::Trigger] = FPICOKeyNames::PICOTouch_Right_Trigger_Touch;
+	ButtonKeys[Right][Touch + EPICOTouchButton::Thumbrest] = FPICOKeyNames::PICOTouch_Right_Thumbrest_Touch;
+
+	ButtonKeys[Left][Hand + EPICOHandButton::Index] = FPICOKeyNames::PICOHand_Left_IndexPinch;
+	ButtonKeys[Left][Hand + EPICOHandButton::Middle] = FPICOKeyNames::PICOHand_Left_MiddlePinch;
+	ButtonKeys[Left][Hand + EPICOHandButton::Ring] = FPICOKeyNames::PICOHand_Left_RingPinch;
+	ButtonKeys[Left][Hand + EPICOHandButton::Pinky] = FPICOKeyNames::PICOHand_Left_PinkyPinch;
+	ButtonKeys[Left][Hand + EPICOHandButton::ThumbClick] = FPICOKeyNames::PICOHand_Left_ThumbClick;
+
+	ButtonKeys[Right][Hand + EPICOHandButton::Index] = FPICOKeyNames::PICOHand_Right_IndexPinch;
+	ButtonKeys[Right][Hand + EPICOHandButton::Middle] = FPICOKeyNames::PICOHand_Right_MiddlePinch;
+	ButtonKeys[Right][Hand + EPICOHandButton::Ring] = FPICOKeyNames::PICOHand_Right_RingPinch;
+	ButtonKeys[Right][Hand + EPICOHandButton::Pinky] = FPICOKeyNames::PICOHand_Right_PinkyPinch;
+	ButtonKeys[Right][Hand + EPICOHandButton::ThumbClick] = FPICOKeyNames::PICOHand_Right_ThumbClick;
+
+	AxisKeys[Left][EPICOXRInputAxis::ThumbstickX] = FPICOKeyNames::PICOTouch_Left_Thumbstick_X;
+	AxisKeys[Left][EPICOXRInputAxis::ThumbstickY] = FPICOKeyNames::PICOTouch_Left_Thumbstick_Y;
+	AxisKeys[Left][EPICOXRInputAxis::Trigger] = FPICOKeyNames::PICOTouch_Left_Trigger_Axis;
+	AxisKeys[Left][EPICOXRInputAxis::Grip] = FPICOKeyNames::PICOTouch_Left_Grip_Axis;
+	AxisKeys[Left][EPICOXRInputAxis::IndexPinch] = FPICOKeyNames::PICOHand_Left_IndexPinchStrength;
+	AxisKeys[Left][EPICOXRInputAxis::MiddlePinch] = FPICOKeyNames::PICOHand_Left_MiddlePinchStrength;
+	AxisKeys[Left][EPICOXRInputAxis::RingPinch] = FPICOKeyNames::PICOHand_Left_RingPinchStrength;
+	AxisKeys[Left][EPICOXRInputAxis::PinkyPinch] = FPICOKeyNames::PICOHand_Left_PinkyPinchStrength;
+	AxisKeys[Left][EPICOXRInputAxis::ThumbClick] = FPICOKeyNames::PICOHand_Left_ThumbClickStrength;
+
+	AxisKeys[Right][EPICOXRInputAxis::ThumbstickX] = FPICOKeyNames::PICOTouch_Right_Thumbstick_X;
+	AxisKeys[Right][EPICOXRInputAxis::ThumbstickY] = FPICOKeyNames::PICOTouch_Right_Thumbstick_Y;
+	AxisKeys[Right][EPICOXRInputAxis::Trigger] = FPICOKeyNames::PICOTouch_Right_Trigger_Axis;
+	AxisKeys[Right][EPICOXRInputAxis::Grip] = FPICOKeyNames::PICOTouch_Right_Grip_Axis;
+	AxisKeys[Right][EPICOXRInputAxis::IndexPinch] = FPICOKeyNames::PICOHand_Right_IndexPinchStrength;
+	AxisKeys[Right][EPICOXRInputAxis::MiddlePinch] = FPICOKeyNames::PICOHand_Right_MiddlePinchStrength;
+	AxisKeys[Right][EPICOXRInputAxis::RingPinch] = FPICOKeyNames::PICOHand_Right_RingPinchStrength;
+	AxisKeys[Right][EPICOXRInputAxis::PinkyPinch] = FPICOKeyNames::PICOHand_Right_PinkyPinchStrength;
+	AxisKeys[Right][EPICOXRInputAxis::ThumbClick] = FPICOKeyNames::PICOHand_Right_ThumbClickStrength;
 }
 
-void FPICOXRInput::ProcessButtonEvent()
+void FPICOXRInput::UpdateControllerFrame(int32 Hand, FPICOXRInputFrame& Frame)
 {
 #if PLATFORM_ANDROID
-	if (LeftConnectState)
-	{
-		PxrControllerInputState state;
-		Pxr_GetControllerInputState(EPICOXRControllerHandness::LeftController, &state);
-        int LeftControllerEvent[12] = {0};
-        LeftControllerEvent[2] = state.homeValue;
-        LeftControllerEvent[3] = state.backValue;
-        LeftControllerEvent[4] = state.touchpadValue;
-        LeftControllerEvent[5] = state.volumeUp;
-        LeftControllerEvent[6] = state.volumeDown;
-        LeftControllerEvent[8] = state.batteryValue;
-        LeftControllerEvent[9] = state.AXValue;
-        LeftControllerEvent[10] = state.BYValue;
-
-		for (int32 i = 2; i < EPICOButton::ButtonCount; i++)
-		{
-			if (LeftControllerEvent[i]!= LastLeftControllerButtonState[i] && i != 7 && i != 8 && i < 11)
-			{
-				LastLeftControllerButtonState[i] = LeftControllerEvent[i];
-				if (LeftControllerEvent[i] > 0 )
-				{
-					MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][i], 0, false);
-				}
-				else if (LeftControllerEvent[i] == 0 )
-				{
-					MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][i], 0, false);
-				}
-			}	
-		}
-
-		//AxisValue
-		LeftControllerTouchPoint.X = state.Joystick.x;
-		LeftControllerTouchPoint.Y = state.Joystick.y;
-		LeftControllerTriggerValue = state.triggerValue;
-		LeftControllerGripValue = state.gripValue;
-
-		//Trigger Grip Button
-		if (CurrentVersion >= 0x2000304)
-		{
-			if (state.triggerclickValue == 1 && LastLeftControllerButtonState[7] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][7], 0, false);
-			}
-			else if (LastLeftControllerButtonState[7] > 0 && state.triggerclickValue == 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][7], 0, false);
-			}
-			LastLeftControllerButtonState[7] = state.triggerclickValue;
-
-			if (state.sideValue == 1 && LastLeftControllerButtonState[11] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][11], 0, false);
-			}
-			else if (LastLeftControllerButtonState[11] > 0 && state.sideValue == 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][11], 0, false);
-			}
-			LastLeftControllerButtonState[11] = state.sideValue;
-		}
-		else
-		{
-			if (LeftControllerTriggerValue > 0.67f && LastLeftControllerButtonState[7] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][7], 0, false);
-			}
-			else if (LastLeftControllerButtonState[7] > 0 && LeftControllerTriggerValue <= 0.67f)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][7], 0, false);
-			}
-			LastLeftControllerButtonState[7] = LeftControllerTriggerValue > 0.67f ? 1 : 0;
-
-			if (LeftControllerGripValue > 0.67f && LastLeftControllerButtonState[11] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][11], 0, false);
-			}
-			else if (LastLeftControllerButtonState[11] > 0 && LeftControllerGripValue <= 0.67f)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][11], 0, false);
-			}
-			LastLeftControllerButtonState[11] = LeftControllerGripValue > 0.67f ? 1 : 0;
-		}
-
-		LeftControllerPower = (LeftControllerEvent[8] < 6 ? LeftControllerEvent[8] : LeftControllerPower);
-
-		//Rocker Up/Down/Left/Right
-		if(ControllerType != G2)
-		{
-			if(LeftControllerTouchPoint.Y > 0.7f && LastLeftControllerButtonState[12] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][12], 0, false);
-			}
-			else if(LeftControllerTouchPoint.Y <= 0.7f && LastLeftControllerButtonState[12] > 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][12], 0, false);
-			}
-			LastLeftControllerButtonState[12] = LeftControllerTouchPoint.Y > 0.7f ? 1 : 0;
-
-			if (LeftControllerTouchPoint.Y < -0.7f && LastLeftControllerButtonState[13] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][13], 0, false);
-			}
-			else if (LeftControllerTouchPoint.Y >= -0.7f && LastLeftControllerButtonState[13] > 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][13], 0, false);
-			}
-			LastLeftControllerButtonState[13] = LeftControllerTouchPoint.Y < -0.7f ? 1 : 0;
-
-			if (LeftControllerTouchPoint.X < -0.7f && LastLeftControllerButtonState[14] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][14], 0, false);
-			}
-			else if (LeftControllerTouchPoint.X >= -0.7f && LastLeftControllerButtonState[14] > 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][14], 0, false);
-			}
-			LastLeftControllerButtonState[14] = LeftControllerTouchPoint.X < -0.7f ? 1 : 0;
-
-			if (LeftControllerTouchPoint.X > 0.7f && LastLeftControllerButtonState[15] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::LeftController][15], 0, false);
-			}
-			else if (LeftControllerTouchPoint.X <= 0.7f && LastLeftControllerButtonState[15] > 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::LeftController][15], 0, false);
-			}
-			LastLeftControllerButtonState[15] = LeftControllerTouchPoint.X > 0.7f ? 1 : 0;
-		}
-
-		if (ControllerType == Neo3)
-		{
-			int32 TouchArray[5] = {0};
-			TouchArray[0] = state.AXTouchValue;
-			TouchArray[1] = state.BYTouchValue;
-			TouchArray[2] = state.rockerTouchValue;
-			TouchArray[3] = state.triggerTouchValue;
-			TouchArray[4] = state.thumbrestTouchValue;
-			for (int32 i = 0;i<EPICOTouchButton::ButtonCount;i++)
-			{
-				if (TouchArray[i] == 1&&TouchArray[i]!=LastLeftTouchButtonState[i])
-				{
-					MessageHandler->OnControllerButtonPressed(TouchButtons[EPICOXRControllerHandness::LeftController][i], 0, false);
-				}
-				else if (TouchArray[i] == 0&&TouchArray[i]!=LastLeftTouchButtonState[i])
-				{
-					MessageHandler->OnControllerButtonReleased(TouchButtons[EPICOXRControllerHandness::LeftController][i], 0, false);
-				}
-				LastLeftTouchButtonState[i]=TouchArray[i];
-			}
-			
-		}
-		if (ControllerType != Neo3 && ControllerType != Neo2 && ControllerType != G2)
-		{
-			int32 TouchArray[5] = {0};
-			TouchArray[0] = state.AXTouchValue;
-			TouchArray[1] = state.BYTouchValue;
-			TouchArray[2] = state.rockerTouchValue;
-			TouchArray[3] = state.triggerTouchValue;
-			TouchArray[4] = state.thumbrestTouchValue;
-			for (int32 i = 0;i<EPICOTouchButton::ButtonCount;i++)
-			{
-				if (TouchArray[i] == 1&&TouchArray[i]!=LastLeftTouchButtonState[i])
-				{
-					MessageHandler->OnControllerButtonPressed(TouchButtons[EPICOXRControllerHandness::LeftController][i], 0, false);
-				}
-				else if (TouchArray[i] == 0&&TouchArray[i]!=LastLeftTouchButtonState[i])
-				{
-					MessageHandler->OnControllerButtonReleased(TouchButtons[EPICOXRControllerHandness::LeftController][i], 0, false);
-				}
-				LastLeftTouchButtonState[i]=TouchArray[i];
-			}
-		}
+	PxrControllerInputState state;
+	Pxr_GetControllerInputState(Hand, &state);
+	Frame.SetButton(EPICOButton::Home, state.homeValue > 0);
+	Frame.SetButton(EPICOButton::App, state.backValue > 0);
+	Frame.SetButton(EPICOButton::Rocker, state.touchpadValue > 0);
+	Frame.SetButton(EPICOButton::VolumeUp, state.volumeUp > 0);
+	Frame.SetButton(EPICOButton::VolumeDown, state.volumeDown > 0);
+	Frame.SetButton(EPICOButton::AorX, state.AXValue > 0);
+	Frame.SetButton(EPICOButton::BorY, state.BYValue > 0);
+
+	//Trigger Grip Button
+	if (CurrentVersion >= 0x2000304)
+	{
+		Frame.SetButton(EPICOButton::Trigger, state.triggerclickValue > 0);
+		Frame.SetButton(EPICOButton::Grip, state.sideValue > 0);
+	}
+	else
+	{
+		Frame.SetButton(EPICOButton::Trigger, state.triggerValue > 0.67f);
+		Frame.SetButton(EPICOButton::Grip, state.gripValue > 0.67f);
 	}
-	if (RightConnectState)
-	{
-		PxrControllerInputState state;
-		Pxr_GetControllerInputState(EPICOXRControllerHandness::RightController, &state);
-        int RightControllerEvent[12] = {0};
-        RightControllerEvent[2] = state.homeValue;
-        RightControllerEvent[3] = state.backValue;
-        RightControllerEvent[4] = state.touchpadValue;
-        RightControllerEvent[5] = state.volumeUp;
-        RightControllerEvent[6] = state.volumeDown;
-        RightControllerEvent[8] = state.batteryValue;
-        RightControllerEvent[9] = state.AXValue;
-        RightControllerEvent[10] = state.BYValue;
-
-		for (int32 i = 2; i < EPICOButton::ButtonCount; i++)
-		{
-			if (RightControllerEvent[i] != LastRightControllerButtonState[i] && i != 7 && i != 8 && i < 11)
-			{
-				LastRightControllerButtonState[i] = RightControllerEvent[i];
-				if (RightControllerEvent[i] > 0 )
-				{
-					MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][i], 0, false);
-				}
-				else if (RightControllerEvent[i] == 0 )
-				{
-					MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][i], 0, false);
-				}
-			}	
-		}
 
-		RightControllerTouchPoint.X = state.Joystick.x;
-		RightControllerTouchPoint.Y = state.Joystick.y;
-		RightControllerTriggerValue = state.triggerValue;
-		RightControllerGripValue = state.gripValue;
+	//Rocker Up/Down/Left/Right
+	if (ControllerType != G2)
+	{
+		Frame.SetButton(EPICOButton::RockerUp, state.Joystick.y > 0.7f);
+		Frame.SetButton(EPICOButton::RockerDown, state.Joystick.y < -0.7f);
+		Frame.SetButton(EPICOButton::RockerLeft, state.Joystick.x < -0.7f);
+		Frame.SetButton(EPICOButton::RockerRight, state.Joystick.x > 0.7f);
+	}
 
-		//Trigger Grip Button
-		if (CurrentVersion >= 0x2000304)
-		{
-			if (state.triggerclickValue == 1 && LastRightControllerButtonState[7] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][7], 0, false);
-			}
-			else if (LastRightControllerButtonState[7] > 0 && state.triggerclickValue == 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][7], 0, false);
-			}
-			LastRightControllerButtonState[7] = state.triggerclickValue;
+	if (ControllerType != Neo2 && ControllerType != G2)
+	{
+		Frame.SetButton(FPICOXRInputFrame::TouchBit + EPICOTouchButton::AorX, state.AXTouchValue > 0);
+		Frame.SetButton(FPICOXRInputFrame::TouchBit + EPICOTouchButton::BorY, state.BYTouchValue > 0);
+		Frame.SetButton(FPICOXRInputFrame::TouchBit + EPICOTouchButton::Rocker, state.rockerTouchValue > 0);
+		Frame.SetButton(FPICOXRInputFrame::TouchBit + EPICOTouchButton::Trigger, state.triggerTouchValue > 0);
+		Frame.SetButton(FPICOXRInputFrame::TouchBit + EPICOTouchButton::Thumbrest, state.thumbrestTouchValue > 0);
+	}
 
-			if (state.sideValue == 1 && LastRightControllerButtonState[11] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][11], 0, false);
-			}
-			else if (LastRightControllerButtonState[11] > 0 && state.sideValue == 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][11], 0, false);
-			}
-			LastRightControllerButtonState[11] = state.sideValue;
-		}
-		else
-		{
-			if (RightControllerTriggerValue > 0.67f && LastRightControllerButtonState[7] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][7], 0, false);
-			}
-			else if (LastRightControllerButtonState[7] > 0 && RightControllerTriggerValue <= 0.67f)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][7], 0, false);
-			}
-			LastRightControllerButtonState[7] = RightControllerTriggerValue > 0.67f ? 1 : 0;
+	Frame.SetAxis(EPICOXRInputAxis::ThumbstickX, state.Joystick.x);
+	Frame.SetAxis(EPICOXRInputAxis::ThumbstickY, state.Joystick.y);
+	Frame.SetAxis(EPICOXRInputAxis::Trigger, state.triggerValue);
+	Frame.SetAxis(EPICOXRInputAxis::Grip, state.gripValue);
 
-			if (RightControllerGripValue > 0.67f && LastRightControllerButtonState[11] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][11], 0, false);
-			}
-			else if (LastRightControllerButtonState[11] > 0 && RightControllerGripValue <= 0.67f)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][11], 0, false);
-			}
-			LastRightControllerButtonState[11] = RightControllerGripValue > 0.67f ? 1 : 0;
-		}
+	int32& Power = Hand == EPICOXRControllerHandness::LeftController ? LeftControllerPower : RightControllerPower;
+	Power = state.batteryValue < 6 ? state.batteryValue : Power;
+#endif
+}
 
-		RightControllerPower = (RightControllerEvent[8] < 6 ? RightControllerEvent[8] : RightControllerPower);
+void FPICOXRInput::UpdateHandFrame(int32 Hand, FPICOXRInputFrame& Frame)
+{
+	const EPICOXRHandType DeviceHand = static_cast<EPICOXRHandType>(Hand + 1);
+	for (int32 Key = EPICOHandButton::Index; Key <= EPICOHandButton::Pinky; Key++)
+	{
+		const EPICOXRHandFinger Finger = static_cast<EPICOXRHandFinger>(Key + 1);
+		Frame.SetButton(FPICOXRInputFrame::HandBit + Key, GetFingerIsPinching(DeviceHand, Finger));
+		Frame.SetAxis(EPICOXRInputAxis::IndexPinch + Key, GetFingerPinchStrength(DeviceHand, Finger));
+	}
+	const float ClickStrength = GetClickStrength(DeviceHand);
+	Frame.SetButton(FPICOXRInputFrame::HandBit + EPICOHandButton::ThumbClick, ClickStrength >= 1.0f);
+	Frame.SetAxis(EPICOXRInputAxis::ThumbClick, ClickStrength);
+}
 
-		//Rocker Up/Down/Left/Right
-		if (ControllerType != G2)
+void FPICOXRInput::ProcessButtonEvent()
+{
+	const double Time = FPlatformTime::Seconds();
+	const bool bConnected[] = { LeftConnectState, RightConnectState };
+	InputEvents.Reset();
+	for (int32 Hand = 0; Hand < EPICOXRControllerHandness::ControllerCount; Hand++)
+	{
+		if (!bConnected[Hand] && !bHandTrackingAvailable)
 		{
-			if (RightControllerTouchPoint.Y > 0.7f && LastRightControllerButtonState[12] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][12], 0, false);
-			}
-			else if (RightControllerTouchPoint.Y <= 0.7f && LastRightControllerButtonState[12] > 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][12], 0, false);
-			}
-			LastRightControllerButtonState[12] = RightControllerTouchPoint.Y > 0.7f ? 1 : 0;
-
-			if (RightControllerTouchPoint.Y < -0.7f && LastRightControllerButtonState[13] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][13], 0, false);
-			}
-			else if (RightControllerTouchPoint.Y >= -0.7f && LastRightControllerButtonState[13] > 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][13], 0, false);
-			}
-			LastRightControllerButtonState[13] = RightControllerTouchPoint.Y < -0.7f ? 1 : 0;
-
-			if (RightControllerTouchPoint.X < -0.7f && LastRightControllerButtonState[14] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][14], 0, false);
-			}
-			else if (RightControllerTouchPoint.X >= -0.7f && LastRightControllerButtonState[14] > 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][14], 0, false);
-			}
-			LastRightControllerButtonState[14] = RightControllerTouchPoint.X < -0.7f ? 1 : 0;
-
-			if (RightControllerTouchPoint.X > 0.7f && LastRightControllerButtonState[15] == 0)
-			{
-				MessageHandler->OnControllerButtonPressed(Buttons[EPICOXRControllerHandness::RightController][15], 0, false);
-			}
-			else if (RightControllerTouchPoint.X <= 0.7f && LastRightControllerButtonState[15] > 0)
-			{
-				MessageHandler->OnControllerButtonReleased(Buttons[EPICOXRControllerHandness::RightController][15], 0, false);
-			}
-			LastRightControllerButtonState[15] = RightControllerTouchPoint.X > 0.7f ? 1 : 0;
+			continue;
 		}
-
-		if (ControllerType == Neo3)
+		FPICOXRInputFrame Frame;
+		if (bConnected[Hand])
 		{
-			int32 TouchArray[5] = { 0 };
-			TouchArray[0] = state.AXTouchValue;
-			TouchArray[1] = state.BYTouchValue;
-			TouchArray[2] = state.rockerTouchValue;
-			TouchArray[3] = state.triggerTouchValue;
-			TouchArray[4] = state.thumbrestTouchValue;
-			for (int32 i = 0; i < EPICOTouchButton::ButtonCount; i++)
-			{
-				if (TouchArray[i] == 1&&TouchArray[i]!=LastRightTouchButtonState[i])
-				{
-					MessageHandler->OnControllerButtonPressed(TouchButtons[EPICOXRControllerHandness::RightController][i], 0, false);
-				}
-				else if (TouchArray[i] == 0&&TouchArray[i]!=LastRightTouchButtonState[i])
-				{
-					MessageHandler->OnControllerButtonReleased(TouchButtons[EPICOXRControllerHandness::RightController][i], 0, false);
-				}
-				LastRightTouchButtonState[i]=TouchArray[i];
-			}
+			UpdateControllerFrame(Hand, Frame);
 		}
-		if (ControllerType != Neo3 && ControllerType != Neo2 && ControllerType != G2)
+		if (bHandTrackingAvailable)
 		{
-			int32 TouchArray[5] = {0};
-			TouchArray[0] = state.AXTouchValue;
-			TouchArray[1] = state.BYTouchValue;
-			TouchArray[2] = state.rockerTouchValue;
-			TouchArray[3] = state.triggerTouchValue;
-			TouchArray[4] = state.thumbrestTouchValue;
-			for (int32 i = 0;i<EPICOTouchButton::ButtonCount;i++)
-			{
-				if (TouchArray[i] == 1&&TouchArray[i]!=LastRightTouchButtonState[i])
-				{
-					MessageHandler->OnControllerButtonPressed(TouchButtons[EPICOXRControllerHandness::RightController][i], 0, false);
-				}
-				else if (TouchArray[i] == 0&&TouchArray[i]!=LastRightTouchButtonState[i])
-				{
-					MessageHandler->OnControllerButtonReleased(TouchButtons[EPICOXRControllerHandness::RightController][i], 0, false);
-				}
-				LastRightTouchButtonState[i]=TouchArray[i];
-			}
+			UpdateHandFrame(Hand, Frame);
 		}
+		InputDiff.Update(Hand, Frame, Time, InputEvents);
+		RecordInputState(Hand, Frame, Time);
 	}
-#endif
-	if (bHandTrackingAvailable)
+
+	for (const FPICOXRInputEvent& Event : InputEvents)
 	{
-		int32 HandButtonState[(int32)EPICOXRControllerHandness::ControllerCount][(int32)EPICOHandButton::ButtonCount];
-		for (int Hand =0;Hand<2;Hand++)
+		switch (Event.Type)
 		{
-			const EPICOXRHandType DeviceHand = static_cast<EPICOXRHandType>(Hand+1);
-			for (int Key=0;Key<4;Key++)
-			{
-				const EPICOXRHandFinger Finger =static_cast<EPICOXRHandFinger>(Key+1);
-				HandButtonState[Hand][Key]=GetFingerIsPinching(DeviceHand,Finger)?1:0;
-				if(HandButtonState[Hand][Key]==1&&HandButtonState[Hand][Key]!=LastHandButtonState[Hand][Key])
-				{
-					MessageHandler->OnControllerButtonPressed(HandButtons[Hand][Key], 0, false);
-				}
-				else if (HandButtonState[Hand][Key]==0&&HandButtonState[Hand][Key]!=LastHandButtonState[Hand][Key])
-				{
-					MessageHandler->OnControllerButtonReleased(HandButtons[Hand][Key], 0, false);
-				}
-				LastHandButtonState[Hand][Key]=HandButtonState[Hand][Key];
-			}
-			HandButtonState[Hand][4]=GetClickStrength(DeviceHand)>=1.0f?1:0;
-			if (HandButtonState[Hand][4]==1&&HandButtonState[Hand][4]!=LastHandButtonState[Hand][4])
-			{
-				MessageHandler->OnControllerButtonPressed(HandButtons[Hand][4], 0, false);
-			}
-			else if (HandButtonState[Hand][4]==0&&HandButtonState[Hand][4]!=LastHandButtonState[Hand][4])
-			{
-				MessageHandler->OnControllerButtonReleased(HandButtons[Hand][4], 0, false);
-			}
-			LastHandButtonState[Hand][4]=HandButtonState[Hand][4];
+		case EPICOXRInputEventType::Pressed:
+			MessageHandler->OnControllerButtonPressed(ButtonKeys[Event.Hand][Event.Index], 0, false);
+			break;
+		case EPICOXRInputEventType::Released:
+			MessageHandler->OnControllerButtonReleased(ButtonKeys[Event.Hand][Event.Index], 0, false);
+			break;
+		case EPICOXRInputEventType::Repeat:
+			MessageHandler->OnControllerButtonPressed(ButtonKeys[Event.Hand][Event.Index], 0, true);
+			break;
+		case EPICOXRInputEventType::Axis:
+			MessageHandler->OnControllerAnalog(AxisKeys[Event.Hand][Event.Index], 0, Event.Value);
+			break;
 		}
 	}
 }
 
-void FPICOXRInput::ProcessButtonAxis()
-{
-	if (LeftConnectState)
-	{
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOTouch_Left_Thumbstick_X, 0, LeftControllerTouchPoint.X);
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOTouch_Left_Thumbstick_Y, 0, LeftControllerTouchPoint.Y);
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOTouch_Left_Trigger_Axis, 0, LeftControllerTriggerValue);
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOTouch_Left_Grip_Axis, 0, LeftControllerGripValue);
-	}
-	if (RightConnectState)
-	{
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOTouch_Right_Thumbstick_X, 0, RightControllerTouchPoint.X);
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOTouch_Right_Thumbstick_Y, 0, RightControllerTouchPoint.Y);
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOTouch_Right_Trigger_Axis, 0, RightControllerTriggerValue);
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOTouch_Right_Grip_Axis, 0, RightControllerGripValue);
-	}
-	if (bHandTrackingAvailable)
-	{
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Left_IndexPinchStrength, 0, GetFingerPinchStrength(EPICOXRHandType::HandLeft,EPICOXRHandFinger::Index));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Left_MiddlePinchStrength, 0,GetFingerPinchStrength(EPICOXRHandType::HandLeft,EPICOXRHandFinger::Middle));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Left_PinkyPinchStrength, 0, GetFingerPinchStrength(EPICOXRHandType::HandLeft,EPICOXRHandFinger::Pinky));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Left_RingPinchStrength, 0, GetFingerPinchStrength(EPICOXRHandType::HandLeft,EPICOXRHandFinger::Ring));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Left_ThumbClickStrength, 0, GetClickStrength(EPICOXRHandType::HandLeft));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Right_IndexPinchStrength, 0, GetFingerPinchStrength(EPICOXRHandType::HandRight,EPICOXRHandFinger::Index));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Right_MiddlePinchStrength, 0,GetFingerPinchStrength(EPICOXRHandType::HandRight,EPICOXRHandFinger::Middle));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Right_PinkyPinchStrength, 0, GetFingerPinchStrength(EPICOXRHandType::HandRight,EPICOXRHandFinger::Pinky));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Right_RingPinchStrength, 0, GetFingerPinchStrength(EPICOXRHandType::HandRight,EPICOXRHandFinger::Ring));
-		MessageHandler->OnControllerAnalog(FPICOKeyNames::PICOHand_Right_ThumbClickStrength, 0, GetClickStrength(EPICOXRHandType::HandRight));
-	}
-}
-
 void FPICOXRInput::UpdateConnectState()
 {
 #if PLATFORM_ANDROID
@@ -1290,8 +1024,8 @@ void FPICOXRInput::UpdateHandState()
 		FPICOXRHandState& HandState = HandStates[hand];
 		if (Pxr_GetHandTrackerAimState(hand,&HandState.AimState)!=0){return;}
 		if (Pxr_GetHandTrackerJointLocations(hand,&HandState.HandJointLocations)!=0){return;}
-		HandState.ReceivedJointPoses = HandState.HandJointLocations.isActive;
-		if (HandState.ReceivedJointPoses)
+		const bool bActive = HandState.HandJointLocations.isActive != 0;
+		if (bActive)
 		{
 			HandState.Status = HandState.AimState.Status;
 			HandState.PinchStrengthIndex = HandState.AimState.pinchStrengthIndex;
@@ -1304,35 +1038,107 @@ void FPICOXRInput::UpdateHandState()
 			const FQuat AimRotation=PxrRootQuatToFQuat(HandState.AimState.aimPose.orientation);
 			HandState.AimPose.SetLocation(AimLocation);
 			HandState.AimPose.SetRotation(AimRotation);
-			
-			HandState.ReceivedJointPoses=HandState.HandJointLocations.isActive;
-			HandState.HandScale=HandState.HandJointLocations.HandScale;
-			for (int keyIndex = 0; keyIndex < XR_HAND_JOINT_COUNT_MAX; ++keyIndex)
-			{
-				const PxrHandJointsLocation& JoinLocation = HandState.HandJointLocations.jointLocations[keyIndex];
-				const FVector Location = PxrBoneVectorToFVector(JoinLocation.pose.position, WorldToMetersScale);
-				FQuat Rotation;
-				if (keyIndex == static_cast<int32>(EPICOXRHandJoint::Wrist))
-				{
-					Rotation=PxrRootQuatToFQuat(JoinLocation.pose.orientation);
-				}
-				else
-				{
-					Rotation=PxrBoneQuatToFQuat(hand,JoinLocation.pose.orientation);
-				}
-				if (!Location.ContainsNaN()&&!Rotation.ContainsNaN()&&Rotation.IsNormalized())
-				{
-					HandState.KeypointTransforms[keyIndex].SetLocation(Location);
-					HandState.KeypointTransforms[keyIndex].SetRotation(Rotation);
-				}
-				HandState.Radii[keyIndex] = JoinLocation.radius * WorldToMetersScale;
-				HandState.SpaceLocationFlags[keyIndex]=JoinLocation.locationFlags;
-			}
 		}
+		const FPICOXRRawHandJoint* RawJoints = reinterpret_cast<const FPICOXRRawHandJoint*>(HandState.HandJointLocations.jointLocations);
+		HandState.Joints.Write(RawJoints, hand, bActive, HandState.HandJointLocations.HandScale, WorldToMetersScale);
+		RecordHandJoints(hand, bActive, HandState.HandJointLocations.HandScale, WorldToMetersScale, RawJoints);
 	}
 #endif
 }
 
+void FPICOXRInput::StartHandJointRecording(int32 Frames)
+{
+	HandJointRecording.Reset();
+	HandJointRecordFramesLeft = FMath::Max(Frames, 0);
+	PXR_LOGI(PxrUnreal, "Recording %d hand joint frames", HandJointRecordFramesLeft);
+}
+
+void FPICOXRInput::RecordHandJoints(int32 Hand, bool bActive, float HandScale, float WorldToMetersScale, const FPICOXRRawHandJoint* Joints)
+{
+	if (HandJointRecordFramesLeft <= 0)
+	{
+		return;
+	}
+	FPICOXRHandJointRecordHeader Header;
+	Header.Hand = Hand;
+	Header.bActive = bActive ? 1 : 0;
+	Header.HandScale = HandScale;
+	Header.WorldToMetersScale = WorldToMetersScale;
+	HandJointRecording.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	HandJointRecording.Append(reinterpret_cast<const uint8*>(Joints), sizeof(FPICOXRRawHandJoint) * XR_HAND_JOINT_COUNT_MAX);
+
+	if (--HandJointRecordFramesLeft == 0)
+	{
+		const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("HandJoints.bin"));
+		const bool bSaved = FFileHelper::SaveArrayToFile(HandJointRecording, *Path);
+		PXR_LOGI(PxrUnreal, "Hand joint recording saved:%d path:%s", bSaved, PLATFORM_CHAR(*Path));
+		HandJointRecording.Empty();
+	}
+}
+
+void FPICOXRInput::StartInputStateRecording(int32 Frames)
+{
+	InputStateRecording.Reset();
+	InputStateRecordFramesLeft = FMath::Max(Frames, 0);
+	PXR_LOGI(PxrUnreal, "Recording %d input state frames", InputStateRecordFramesLeft);
+}
+
+void FPICOXRInput::RecordInputState(int32 Hand, const FPICOXRInputFrame& Frame, double Time)
+{
+	if (InputStateRecordFramesLeft <= 0)
+	{
+		return;
+	}
+	FPICOXRInputRecord Record;
+	FMemory::Memzero(Record);
+	Record.Time = Time;
+	Record.Hand = Hand;
+	Record.Frame = Frame;
+	InputStateRecording.Append(reinterpret_cast<const uint8*>(&Record), sizeof(Record));
+
+	if (--InputStateRecordFramesLeft == 0)
+	{
+		const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("InputState.bin"));
+		const bool bSaved = FFileHelper::SaveArrayToFile(InputStateRecording, *Path);
+		PXR_LOGI(PxrUnreal, "Input state recording saved:%d path:%s", bSaved, PLATFORM_CHAR(*Path));
+		InputStateRecording.Empty();
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand InputStateRecordCommand(
+	TEXT("pxr.Input.RecordState"),
+	TEXT("Records the input frames of the next N hand updates for the PICOXR.Input.ButtonDiff automation test."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		TArray<IPXR_HandTracker*> HandTrackers = IModularFeatures::Get().GetModularFeatureImplementations<IPXR_HandTracker>(IPXR_HandTracker::GetModularFeatureName());
+		for (IPXR_HandTracker* HandTracker : HandTrackers)
+		{
+			if (HandTracker != nullptr && HandTracker->GetHandTrackerDeviceTypeName() == FName(TEXT("PICOHandTracking")))
+			{
+				static_cast<FPICOXRInput*>(HandTracker)->StartInputStateRecording(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 600);
+			}
+		}
+	}));
+#endif
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand HandJointRecordCommand(
+	TEXT("pxr.HandTracking.RecordJoints"),
+	TEXT("Records the raw runtime hand joints of the next N hand updates for the PICOXR.Input.HandJointConversion automation test."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		TArray<IPXR_HandTracker*> HandTrackers = IModularFeatures::Get().GetModularFeatureImplementations<IPXR_HandTracker>(IPXR_HandTracker::GetModularFeatureName());
+		for (IPXR_HandTracker* HandTracker : HandTrackers)
+		{
+			if (HandTracker != nullptr && HandTracker->GetHandTrackerDeviceTypeName() == FName(TEXT("PICOHandTracking")))
+			{
+				static_cast<FPICOXRInput*>(HandTracker)->StartHandJointRecording(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 300);
+			}
+		}
+	}));
+#endif
+
 void FPICOXRInput::SetAppHandTrackingEnabled(bool Enabled)
 {
 #if PLATFORM_ANDROID
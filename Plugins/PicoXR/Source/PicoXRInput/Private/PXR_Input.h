@@ -8,6 +8,8 @@
 #include "IPXR_HandTracker.h"
 #include "PXR_Settings.h"
 #include "PXR_HMD.h"
+#include "PXR_InputDiff.h"
+#include "PXR_Haptics.h"
 
 #define ButtonEventNum 12
 
@@ -129,6 +131,7 @@ public:
 	virtual bool GetFingerIsPinching(const EPICOXRHandType DeviceHand,const EPICOXRHandFinger Finger) override;
 	virtual float GetFingerPinchStrength(const EPICOXRHandType DeviceHand, const EPICOXRHandFinger Finger) override;
 	virtual EPICOXRActiveInputDevice GetActiveInputDevice() override;
+	virtual const FPICOXRHandJointFrame* GetHandJointFrame(const EPICOXRHandType DeviceHand) const override;
 	
 	virtual bool IsHandTrackingStateValid() const override;
 	virtual bool GetKeypointState(EPICOXRHandType Hand, EPICOXRHandJoint Keypoint, FTransform& OutTransform, float& OutRadius) const override;
@@ -163,9 +166,20 @@ public:
 	static FVector OriginOffsetR;
 	const FPICOXRHandState& GetLeftHandState() const;
 	const FPICOXRHandState& GetRightHandState() const;
+
+	/** Dumps the raw runtime joints of the next Frames hand updates to Saved/PICOXR/HandJoints.bin */
+	void StartHandJointRecording(int32 Frames);
+
+	/** Dumps the input frames of the next Frames hand updates to Saved/PICOXR/InputState.bin */
+	void StartInputStateRecording(int32 Frames);
+
+	FPICOXRHapticsScheduler& GetHaptics() { return Haptics; }
 private:
 	//HandTracking
 	void SetAppHandTrackingEnabled(bool Enabled);
+	void RecordHandJoints(int32 Hand, bool bActive, float HandScale, float WorldToMetersScale, const FPICOXRRawHandJoint* Joints);
+	int32 HandJointRecordFramesLeft;
+	TArray<uint8> HandJointRecording;
 	
 	FPICOXRHandState HandStates[2];
 	EPICOXRHandType SkeletonType;
@@ -174,7 +188,9 @@ private:
 	void RegisterKeys();
 	void SetKeyMapping();
 	void ProcessButtonEvent();
-	void ProcessButtonAxis();
+	void UpdateControllerFrame(int32 Hand, FPICOXRInputFrame& Frame);
+	void UpdateHandFrame(int32 Hand, FPICOXRInputFrame& Frame);
+	void RecordInputState(int32 Hand, const FPICOXRInputFrame& Frame, double Time);
 	void UpdateConnectState();
 	void GetControllerSensorData(EControllerHand DeviceHand, float WorldToMetersScale, double inPredictedTime, FVector SourcePosition, FQuat SourceOrientation, FRotator& OutOrientation, FVector& OutPosition) const;
 
@@ -182,22 +198,16 @@ private:
 	TSharedRef<FGenericApplicationMessageHandler> MessageHandler;
 	bool LeftConnectState;
 	bool RightConnectState;
-	FName Buttons[(int32)EPICOXRControllerHandness::ControllerCount][(int32)EPICOButton::ButtonCount];
-	FName TouchButtons[(int32)EPICOXRControllerHandness::ControllerCount][(int32)EPICOTouchButton::ButtonCount];
-	FName HandButtons[(int32)EPICOXRControllerHandness::ControllerCount][(int32)EPICOHandButton::ButtonCount];
-	int32 LastHandButtonState[(int32)EPICOXRControllerHandness::ControllerCount][(int32)EPICOHandButton::ButtonCount];
-	int32 LastLeftControllerButtonState[EPICOButton::ButtonCount] = {0};
-	int32 LastRightControllerButtonState[EPICOButton::ButtonCount] = {0};
-	int32 LastLeftTouchButtonState[EPICOTouchButton::ButtonCount] = {0};
-	int32 LastRightTouchButtonState[EPICOTouchButton::ButtonCount] = {0};
+	// Keys of the FPICOXRInputFrame button bits and axes.
+	FName ButtonKeys[(int32)EPICOXRControllerHandness::ControllerCount][FPICOXRInputFrame::ButtonBitCount];
+	FName AxisKeys[(int32)EPICOXRControllerHandness::ControllerCount][EPICOXRInputAxis::AxisCount];
+	FPICOXRInputDiff InputDiff;
+	FPICOXRHapticsScheduler Haptics;
+	TArray<FPICOXRInputEvent> InputEvents;
+	int32 InputStateRecordFramesLeft;
+	TArray<uint8> InputStateRecording;
 	int32 LeftControllerPower;
 	int32 RightControllerPower;
-	FVector2D LeftControllerTouchPoint;
-	FVector2D RightControllerTouchPoint;
-	float LeftControllerTriggerValue;
-	float RightControllerTriggerValue;
-	float LeftControllerGripValue;
-	float RightControllerGripValue;
 	uint32_t MainControllerHandle;
 	EPICOInputType ControllerType;
 	UPICOXRSettings* Settings;
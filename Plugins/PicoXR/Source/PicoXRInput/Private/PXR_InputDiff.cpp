@@ -0,0 +1,152 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_InputDiff.h"
+#include "PXR_Log.h"
+
+FPICOXRInputDiff::FPICOXRInputDiff(const FPICOXRInputDiffSettings& InSettings)
+	: Settings(InSettings)
+{
+}
+
+bool FPICOXRInputDiff::ShouldSendAxis(int16 Value, int16 Sent) const
+{
+	if (Value == Sent)
+	{
+		return false;
+	}
+	// Rest and full scale always get through, so a released stick never stays a deadband off centre.
+	if (Value == 0 || Value == FPICOXRInputFrame::AxisScale || Value == -FPICOXRInputFrame::AxisScale)
+	{
+		return true;
+	}
+	return FMath::Abs((int32)Value - (int32)Sent) > Settings.AxisDeadband;
+}
+
+void FPICOXRInputDiff::Update(int32 Hand, const FPICOXRInputFrame& Frame, double Time, TArray<FPICOXRInputEvent>& OutEvents)
+{
+	check(Hand >= 0 && Hand < HandCount);
+	FHandState& State = Hands[Hand];
+	const uint32 Previous = State.Frame.Buttons;
+
+	uint32 Changed = Previous ^ Frame.Buttons;
+	while (Changed != 0)
+	{
+		const uint32 Bit = FMath::CountTrailingZeros(Changed);
+		Changed &= Changed - 1;
+		const bool bDown = ((Frame.Buttons >> Bit) & 1) != 0;
+		if (bDown)
+		{
+			State.NextRepeatTime[Bit] = Time + Settings.InitialRepeatDelay;
+		}
+		OutEvents.Add({ bDown ? EPICOXRInputEventType::Pressed : EPICOXRInputEventType::Released, (uint8)Hand, (uint8)Bit, 0.0f });
+	}
+
+	uint32 Held = Previous & Frame.Buttons & Settings.RepeatMask;
+	while (Held != 0)
+	{
+		const uint32 Bit = FMath::CountTrailingZeros(Held);
+		Held &= Held - 1;
+		double& NextRepeatTime = State.NextRepeatTime[Bit];
+		if (Time >= NextRepeatTime)
+		{
+			// At most one repeat per frame, a hitch does not turn into a burst.
+			NextRepeatTime = NextRepeatTime + Settings.RepeatInterval > Time ? NextRepeatTime + Settings.RepeatInterval : Time + Settings.RepeatInterval;
+			OutEvents.Add({ EPICOXRInputEventType::Repeat, (uint8)Hand, (uint8)Bit, 0.0f });
+		}
+	}
+
+	// Whether an axis is sent only depends on its value and the value last sent, so identical axes send nothing.
+	if (FMemory::Memcmp(State.Frame.Axes, Frame.Axes, sizeof(Frame.Axes)) != 0)
+	{
+		for (int32 Axis = 0; Axis < EPICOXRInputAxis::AxisCount; Axis++)
+		{
+			if (ShouldSendAxis(Frame.Axes[Axis], State.SentAxes[Axis]))
+			{
+				State.SentAxes[Axis] = Frame.Axes[Axis];
+				OutEvents.Add({ EPICOXRInputEventType::Axis, (uint8)Hand, (uint8)Axis, FPICOXRInputFrame::DequantizeAxis(Frame.Axes[Axis]) });
+			}
+		}
+	}
+
+	State.Frame = Frame;
+}
+
+void FPICOXRInputDiff::UpdateScalar(int32 Hand, const FPICOXRInputFrame& Frame, double Time, TArray<FPICOXRInputEvent>& OutEvents)
+{
+	check(Hand >= 0 && Hand < HandCount);
+	FHandState& State = Hands[Hand];
+	const uint32 Previous = State.Frame.Buttons;
+
+	for (uint32 Bit = 0; Bit < 32; Bit++)
+	{
+		const bool bWasDown = ((Previous >> Bit) & 1) != 0;
+		const bool bDown = ((Frame.Buttons >> Bit) & 1) != 0;
+		if (bDown && !bWasDown)
+		{
+			State.NextRepeatTime[Bit] = Time + Settings.InitialRepeatDelay;
+			OutEvents.Add({ EPICOXRInputEventType::Pressed, (uint8)Hand, (uint8)Bit, 0.0f });
+		}
+		else if (!bDown && bWasDown)
+		{
+			OutEvents.Add({ EPICOXRInputEventType::Released, (uint8)Hand, (uint8)Bit, 0.0f });
+		}
+	}
+
+	for (uint32 Bit = 0; Bit < 32; Bit++)
+	{
+		const bool bRepeats = ((Previous & Frame.Buttons & Settings.RepeatMask) >> Bit & 1) != 0;
+		if (bRepeats && Time >= State.NextRepeatTime[Bit])
+		{
+			State.NextRepeatTime[Bit] += Settings.RepeatInterval;
+			if (State.NextRepeatTime[Bit] <= Time)
+			{
+				State.NextRepeatTime[Bit] = Time + Settings.RepeatInterval;
+			}
+			OutEvents.Add({ EPICOXRInputEventType::Repeat, (uint8)Hand, (uint8)Bit, 0.0f });
+		}
+	}
+
+	for (int32 Axis = 0; Axis < EPICOXRInputAxis::AxisCount; Axis++)
+	{
+		if (ShouldSendAxis(Frame.Axes[Axis], State.SentAxes[Axis]))
+		{
+			State.SentAxes[Axis] = Frame.Axes[Axis];
+			OutEvents.Add({ EPICOXRInputEventType::Axis, (uint8)Hand, (uint8)Axis, FPICOXRInputFrame::DequantizeAxis(Frame.Axes[Axis]) });
+		}
+	}
+
+	State.Frame = Frame;
+}
+
+int32 FPICOXRInputDiff::CompareUpdates(const TArray<FPICOXRInputRecord>& Records, const FPICOXRInputDiffSettings& InSettings, int32* OutNumEvents)
+{
+	FPICOXRInputDiff Diff(InSettings);
+	FPICOXRInputDiff Reference(InSettings);
+	TArray<FPICOXRInputEvent> Events;
+	TArray<FPICOXRInputEvent> ReferenceEvents;
+	int32 Mismatches = 0;
+	int32 NumEvents = 0;
+	for (int32 Index = 0; Index < Records.Num(); Index++)
+	{
+		const FPICOXRInputRecord& Record = Records[Index];
+		if (Record.Hand < 0 || Record.Hand >= HandCount)
+		{
+			continue;
+		}
+		Events.Reset();
+		ReferenceEvents.Reset();
+		Diff.Update(Record.Hand, Record.Frame, Record.Time, Events);
+		Reference.UpdateScalar(Record.Hand, Record.Frame, Record.Time, ReferenceEvents);
+		if (Events != ReferenceEvents)
+		{
+			PXR_LOGW(PxrUnreal, "Input record %d: %d events from the bitmask diff, %d from the reference", Index, Events.Num(), ReferenceEvents.Num());
+			Mismatches++;
+		}
+		NumEvents += ReferenceEvents.Num();
+	}
+	if (OutNumEvents)
+	{
+		*OutNumEvents = NumEvents;
+	}
+	return Mismatches;
+}
@@ -0,0 +1,145 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+
+/** Analog inputs of one hand, in the order they are kept in FPICOXRInputFrame. */
+struct EPICOXRInputAxis
+{
+	enum Type
+	{
+		ThumbstickX,
+		ThumbstickY,
+		Trigger,
+		Grip,
+		IndexPinch,
+		MiddlePinch,
+		RingPinch,
+		PinkyPinch,
+		ThumbClick,
+		AxisCount
+	};
+};
+
+/**
+ * Input state of one hand for one frame: every button as one bit and every axis quantised to 16 bits.
+ * Buttons holds EPICOButton from bit 0, EPICOTouchButton from TouchBit and EPICOHandButton from HandBit.
+ */
+struct FPICOXRInputFrame
+{
+	static const int32 TouchBit = 16;
+	static const int32 HandBit = 21;
+	static const int32 ButtonBitCount = 26;
+	static const uint32 ControllerButtonMask = (1u << TouchBit) - 1;
+	static const int16 AxisScale = 32767;
+
+	uint32 Buttons = 0;
+	int16 Axes[EPICOXRInputAxis::AxisCount] = {};
+
+	FORCEINLINE void SetButton(int32 Bit, bool bDown)
+	{
+		Buttons = (Buttons & ~(1u << Bit)) | ((bDown ? 1u : 0u) << Bit);
+	}
+
+	FORCEINLINE void SetAxis(int32 Axis, float Value)
+	{
+		Axes[Axis] = QuantizeAxis(Value);
+	}
+
+	/** Maps -1 to 1 onto -AxisScale to AxisScale, clamping anything outside. */
+	static int16 QuantizeAxis(float Value)
+	{
+		return (int16)FMath::RoundToInt(FMath::Clamp(Value, -1.0f, 1.0f) * AxisScale);
+	}
+
+	static float DequantizeAxis(int16 Value)
+	{
+		return Value / (float)AxisScale;
+	}
+};
+
+/** Frame of a recorded input state sequence, as written by pxr.Input.RecordState. */
+struct FPICOXRInputRecord
+{
+	double Time;
+	int32 Hand;
+	FPICOXRInputFrame Frame;
+};
+
+struct FPICOXRInputDiffSettings
+{
+	// Buttons that send repeated presses while held, as FPICOXRInputFrame bits.
+	uint32 RepeatMask = 0;
+	// Seconds from the press to the first repeat, and between repeats after that.
+	double InitialRepeatDelay = 0.2;
+	double RepeatInterval = 0.1;
+	// Axis changes of this many quantised steps or less are not sent, unless the axis reaches rest or full scale.
+	int32 AxisDeadband = 0;
+};
+
+enum class EPICOXRInputEventType : uint8
+{
+	Pressed,
+	Released,
+	Repeat,
+	Axis,
+};
+
+struct FPICOXRInputEvent
+{
+	EPICOXRInputEventType Type;
+	uint8 Hand;
+	// Button bit or EPICOXRInputAxis.
+	uint8 Index;
+	// Axis value, 0 for buttons.
+	float Value;
+
+	bool operator==(const FPICOXRInputEvent& Other) const
+	{
+		return Type == Other.Type && Hand == Other.Hand && Index == Other.Index && Value == Other.Value;
+	}
+};
+
+/**
+ * Turns input frames into press, release, repeat and axis events.
+ * Buttons are diffed as bitmasks and axes are compared as a block, so an unchanged frame costs a few compares
+ * and a changed one costs one step per changed input. Like the engine's gamepad devices, axes are only sent when they move.
+ */
+class FPICOXRInputDiff
+{
+public:
+	static const int32 HandCount = 2;
+
+	explicit FPICOXRInputDiff(const FPICOXRInputDiffSettings& InSettings = FPICOXRInputDiffSettings());
+
+	void SetSettings(const FPICOXRInputDiffSettings& InSettings) { Settings = InSettings; }
+	const FPICOXRInputDiffSettings& GetSettings() const { return Settings; }
+
+	/**
+	 * Diffs Frame against the previous frame of Hand and appends the events, releases and presses first, then repeats, then axes.
+	 * Time is in seconds and may not go backwards.
+	 */
+	void Update(int32 Hand, const FPICOXRInputFrame& Frame, double Time, TArray<FPICOXRInputEvent>& OutEvents);
+
+	/** Reference of Update that checks every button and axis one by one. Events are identical to Update. */
+	void UpdateScalar(int32 Hand, const FPICOXRInputFrame& Frame, double Time, TArray<FPICOXRInputEvent>& OutEvents);
+
+	/**
+	 * Replays Records through Update and UpdateScalar with Settings.
+	 * @return the number of records whose events differ between both.
+	 */
+	static int32 CompareUpdates(const TArray<FPICOXRInputRecord>& Records, const FPICOXRInputDiffSettings& InSettings, int32* OutNumEvents = nullptr);
+
+private:
+	struct FHandState
+	{
+		FPICOXRInputFrame Frame;
+		int16 SentAxes[EPICOXRInputAxis::AxisCount] = {};
+		double NextRepeatTime[32] = {};
+	};
+
+	bool ShouldSendAxis(int16 Value, int16 Sent) const;
+
+	FPICOXRInputDiffSettings Settings;
+	FHandState Hands[HandCount];
+};
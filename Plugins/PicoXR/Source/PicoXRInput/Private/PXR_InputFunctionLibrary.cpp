@@ -228,6 +228,34 @@ bool UPICOXRInputFunctionLibrary::PXR_VibrateController(EPICOXRControllerType Co
     return false;
 }
 
+bool UPICOXRInputFunctionLibrary::PXR_QueueHapticWaveform(EPICOXRControllerType ControllerType, const TArray<float>& Samples, float SampleRate, int32 Frequency, int32 Priority, bool bPCM)
+{
+    FPICOXRInput* PICOXRInputInstence = GetPICOXRInput();
+    if (PICOXRInputInstence)
+    {
+        FPICOXRHapticsWaveform Waveform;
+        Waveform.Type = bPCM ? EPICOXRHapticsWaveformType::PCM : EPICOXRHapticsWaveformType::Envelope;
+        Waveform.Samples = Samples;
+        Waveform.SampleRate = SampleRate;
+        Waveform.Frequency = Frequency;
+        Waveform.Priority = Priority;
+        PICOXRInputInstence->GetHaptics().QueueWaveform(ControllerType == EPICOXRControllerType::RightHand ? 1 : 0, Waveform);
+        return true;
+    }
+    return false;
+}
+
+bool UPICOXRInputFunctionLibrary::PXR_ClearHapticWaveforms(EPICOXRControllerType ControllerType)
+{
+    FPICOXRInput* PICOXRInputInstence = GetPICOXRInput();
+    if (PICOXRInputInstence)
+    {
+        PICOXRInputInstence->GetHaptics().ClearWaveforms(ControllerType == EPICOXRControllerType::RightHand ? 1 : 0);
+        return true;
+    }
+    return false;
+}
+
 void UPICOXRInputFunctionLibrary::PXR_GetControllerDeviceType(EPICOXRControllerDeviceType& OutControllerType)
 {
 	int32 ControllerType = 0;
@@ -0,0 +1,107 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_HandBoneMap.h"
+#include "PXR_InputFunctionLibrary.h"
+#include "ReferenceSkeleton.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRHandBoneMapTests
+{
+	static FName BoneName(const TCHAR* Name)
+	{
+		return FName(Name);
+	}
+
+	/** Root, wrist, then an index finger chain and a thumb bone, in that order. */
+	static void MakeSkeleton(FReferenceSkeleton& OutSkeleton)
+	{
+		FReferenceSkeletonModifier Modifier(OutSkeleton, nullptr);
+		Modifier.Add(FMeshBoneInfo(BoneName(TEXT("root")), TEXT("root"), INDEX_NONE), FTransform::Identity);
+		Modifier.Add(FMeshBoneInfo(BoneName(TEXT("wrist")), TEXT("wrist"), 0), FTransform::Identity);
+		Modifier.Add(FMeshBoneInfo(BoneName(TEXT("index_01")), TEXT("index_01"), 1), FTransform::Identity);
+		Modifier.Add(FMeshBoneInfo(BoneName(TEXT("index_02")), TEXT("index_02"), 2), FTransform::Identity);
+		Modifier.Add(FMeshBoneInfo(BoneName(TEXT("thumb_01")), TEXT("thumb_01"), 1), FTransform::Identity);
+	}
+
+	static void TestBoneMap(FAutomationTestBase& Test)
+	{
+		FReferenceSkeleton Skeleton;
+		MakeSkeleton(Skeleton);
+
+		TMap<EPICOXRHandJoint, FName> BoneNames;
+		BoneNames.Add(EPICOXRHandJoint::Palm, NAME_None);
+		BoneNames.Add(EPICOXRHandJoint::Wrist, BoneName(TEXT("wrist")));
+		BoneNames.Add(EPICOXRHandJoint::ThumbMetacarpal, BoneName(TEXT("thumb_01")));
+		BoneNames.Add(EPICOXRHandJoint::IndexProximal, BoneName(TEXT("index_02")));
+		BoneNames.Add(EPICOXRHandJoint::IndexMetacarpal, BoneName(TEXT("index_01")));
+		BoneNames.Add(EPICOXRHandJoint::LittleTip, BoneName(TEXT("little_05")));
+		TMap<EPICOXRHandJoint, FRotator> RestCorrections;
+		RestCorrections.Add(EPICOXRHandJoint::Wrist, FRotator(0.0f, 90.0f, 0.0f));
+		RestCorrections.Add(EPICOXRHandJoint::IndexProximal, FRotator(0.0f, 0.0f, 180.0f));
+
+		FPICOXRHandBoneMap BoneMap;
+		const UObject* Owner = nullptr;
+		BoneMap.Build(Skeleton, BoneNames, RestCorrections, Owner);
+
+		// Unnamed and missing bones are skipped, the wrist is bound apart from the fingers, which go in bone order.
+		const TArray<FPICOXRHandBoneBinding>& Bindings = BoneMap.GetBindings();
+		if (Test.TestEqual(TEXT("Finger bindings"), Bindings.Num(), 3))
+		{
+			Test.TestEqual(TEXT("Bone of the first binding"), Bindings[0].BoneIndex, 2);
+			Test.TestEqual(TEXT("Joint of the first binding"), Bindings[0].Joint, static_cast<int32>(EPICOXRHandJoint::IndexMetacarpal));
+			Test.TestEqual(TEXT("Bone of the second binding"), Bindings[1].BoneIndex, 3);
+			Test.TestEqual(TEXT("Joint of the second binding"), Bindings[1].Joint, static_cast<int32>(EPICOXRHandJoint::IndexProximal));
+			Test.TestEqual(TEXT("Bone of the third binding"), Bindings[2].BoneIndex, 4);
+			Test.TestEqual(TEXT("Joint of the third binding"), Bindings[2].Joint, static_cast<int32>(EPICOXRHandJoint::ThumbMetacarpal));
+			Test.TestTrue(TEXT("A joint without a rest correction binds at identity"), Bindings[0].RestCorrection.Equals(FQuat::Identity));
+			Test.TestTrue(TEXT("Rest correction of a finger joint"), Bindings[1].RestCorrection.Equals(FRotator(0.0f, 0.0f, 180.0f).Quaternion()));
+		}
+		Test.TestEqual(TEXT("Wrist bone index"), BoneMap.GetWristBoneIndex(), 1);
+		Test.TestTrue(TEXT("Rest correction of the wrist"), BoneMap.GetWristRestCorrection().Equals(FRotator(0.0f, 90.0f, 0.0f).Quaternion()));
+		Test.TestTrue(TEXT("Bone map built for its owner"), BoneMap.IsBuiltFor(Owner));
+
+		// Rotations land on the bound bones with their corrections, joints left at identity keep the bone as it was.
+		FPICOXRHandJointFrame Frame;
+		const FQuat IndexRotation(FVector(0.0f, 0.0f, 1.0f), 0.5f);
+		Frame.Rotations[static_cast<int32>(EPICOXRHandJoint::IndexProximal)] = IndexRotation;
+		Frame.Rotations[static_cast<int32>(EPICOXRHandJoint::ThumbMetacarpal)] = IndexRotation;
+		const FQuat Untouched(FVector(1.0f, 0.0f, 0.0f), 0.25f);
+		TArray<FTransform> BoneSpaceTransforms;
+		BoneSpaceTransforms.Init(FTransform(Untouched), Skeleton.GetNum());
+		BoneMap.ApplyJointRotations(Frame, BoneSpaceTransforms);
+		Test.TestTrue(TEXT("A bone whose joint is at identity keeps its rotation"), BoneSpaceTransforms[2].GetRotation().Equals(Untouched));
+		Test.TestTrue(TEXT("A bone with a rest correction"), BoneSpaceTransforms[3].GetRotation().Equals(IndexRotation * FRotator(0.0f, 0.0f, 180.0f).Quaternion()));
+		Test.TestTrue(TEXT("A bone without a rest correction"), BoneSpaceTransforms[4].GetRotation().Equals(IndexRotation));
+		Test.TestTrue(TEXT("The wrist is left to the component"), BoneSpaceTransforms[1].GetRotation().Equals(Untouched));
+
+		// The wrist takes a component space rotation through the rotation of the root.
+		const FQuat WristRotation(FVector(0.0f, 1.0f, 0.0f), 1.0f);
+		BoneMap.ApplyWristRotation(WristRotation, BoneSpaceTransforms);
+		Test.TestTrue(TEXT("Component space rotation of the wrist"), (BoneSpaceTransforms[0].GetRotation() * BoneSpaceTransforms[1].GetRotation()).Equals(WristRotation));
+		Test.TestTrue(TEXT("The root is left alone by the wrist"), BoneSpaceTransforms[0].GetRotation().Equals(Untouched));
+
+		// Fewer bone space transforms than bones, as before the pose is allocated, are left alone.
+		BoneSpaceTransforms.SetNum(3);
+		BoneMap.ApplyJointRotations(Frame, BoneSpaceTransforms);
+		Test.TestEqual(TEXT("Bone space transforms of a pose not allocated yet"), BoneSpaceTransforms.Num(), 3);
+		BoneSpaceTransforms.Reset();
+		BoneMap.ApplyWristRotation(WristRotation, BoneSpaceTransforms);
+		Test.TestEqual(TEXT("Bone space transforms of a pose without a wrist"), BoneSpaceTransforms.Num(), 0);
+
+		BoneMap.Reset();
+		Test.TestFalse(TEXT("A reset bone map is built for its owner"), BoneMap.IsBuiltFor(Owner));
+		Test.TestEqual(TEXT("Bindings of a reset bone map"), BoneMap.GetBindings().Num(), 0);
+		Test.TestEqual(TEXT("Wrist bone index of a reset bone map"), BoneMap.GetWristBoneIndex(), (int32)INDEX_NONE);
+	}
+}
+
+/** Checks the hand joint to bone bindings, missing bones and rest corrections against a synthetic skeleton. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRHandBoneMapTest, "PICOXR.Input.HandBoneMap", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRHandBoneMapTest::RunTest(const FString& Parameters)
+{
+	PICOXRHandBoneMapTests::TestBoneMap(*this);
+	return true;
+}
+#endif
@@ -0,0 +1,87 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_HandJointBuffer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRHandJointTests
+{
+	typedef FPICOXRHandJointRecordHeader FRecordHeader;
+	static const int32 RecordSize = sizeof(FRecordHeader) + sizeof(FPICOXRRawHandJoint) * XR_HAND_JOINT_COUNT_MAX;
+
+	// Finite, non-normalized, NaN and overflowing joints, used when no recording is available.
+	static void MakeSyntheticFrame(int32 Hand, TArray<uint8>& OutRecord)
+	{
+		OutRecord.SetNumZeroed(RecordSize);
+		FRecordHeader* Header = reinterpret_cast<FRecordHeader*>(OutRecord.GetData());
+		Header->Hand = Hand;
+		Header->bActive = 1;
+		Header->HandScale = 1.0f;
+		Header->WorldToMetersScale = 100.0f;
+		FPICOXRRawHandJoint* Joints = reinterpret_cast<FPICOXRRawHandJoint*>(Header + 1);
+		for (int32 Joint = 0; Joint < XR_HAND_JOINT_COUNT_MAX; Joint++)
+		{
+			const FQuat Quat(FVector(Joint, 1.0f, -0.5f * Joint).GetSafeNormal(), 0.1f * Joint);
+			Joints[Joint].locationFlags = 0xF;
+			Joints[Joint].pose.orientation = { Quat.X, Quat.Y, Quat.Z, Quat.W };
+			Joints[Joint].pose.position = { 0.01f * Joint, -0.02f * Joint, 0.3f };
+			Joints[Joint].radius = 0.005f;
+		}
+		Joints[3].pose.orientation.w = 2.0f;
+		Joints[7].pose.orientation.x = NAN;
+		Joints[11].pose.position.y = INFINITY;
+		Joints[13].pose.position.z = 3.0e38f;
+		Joints[17].pose.orientation = { 0.0f, -0.0f, 0.0f, -1.0f };
+		Joints[25].pose.position = { -0.0f, FLT_MIN * 0.5f, 0.0f };
+	}
+
+	// Replays the recording saved by pxr.HandTracking.RecordJoints, synthetic frames without one.
+	static void TestConversion(FAutomationTestBase& Test)
+	{
+		const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("HandJoints.bin"));
+		TArray<uint8> Data;
+		if (!FFileHelper::LoadFileToArray(Data, *Path, FILEREAD_Silent) || Data.Num() < RecordSize)
+		{
+			Test.AddInfo(TEXT("No hand joint recording found, comparing synthetic frames"));
+			TArray<uint8> Record;
+			Data.Reset();
+			for (int32 Hand = 0; Hand < 2; Hand++)
+			{
+				MakeSyntheticFrame(Hand, Record);
+				Data.Append(Record);
+			}
+		}
+
+		FPICOXRHandJointFrame Previous[2];
+		int32 FrameCount = 0;
+		int32 Mismatches = 0;
+		for (int32 Offset = 0; Offset + RecordSize <= Data.Num(); Offset += RecordSize)
+		{
+			const FRecordHeader* Header = reinterpret_cast<const FRecordHeader*>(Data.GetData() + Offset);
+			const FPICOXRRawHandJoint* Joints = reinterpret_cast<const FPICOXRRawHandJoint*>(Header + 1);
+			if ((Header->Hand != 0 && Header->Hand != 1) || !Header->bActive)
+			{
+				continue;
+			}
+			Mismatches += FPICOXRHandJointBuffer::CompareConversions(Joints, Header->Hand, Header->WorldToMetersScale, Previous[Header->Hand]);
+			FPICOXRHandJointFrame Next;
+			FPICOXRHandJointBuffer::ConvertJointsScalar(Joints, Header->Hand, Header->WorldToMetersScale, Previous[Header->Hand], Next);
+			Previous[Header->Hand] = Next;
+			FrameCount++;
+		}
+		Test.TestTrue(TEXT("Frames compared"), FrameCount > 0);
+		Test.TestEqual(TEXT("Joints converted differently by the vectorised and scalar paths"), Mismatches, 0);
+	}
+}
+
+/** Replays recorded hand joints through the vectorised and scalar conversion and checks they agree. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRHandJointConversionTest, "PICOXR.Input.HandJointConversion", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRHandJointConversionTest::RunTest(const FString& Parameters)
+{
+	PICOXRHandJointTests::TestConversion(*this);
+	return true;
+}
+#endif
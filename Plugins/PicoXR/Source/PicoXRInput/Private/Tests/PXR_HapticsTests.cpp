@@ -0,0 +1,165 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_Haptics.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRHapticsTests
+{
+	struct FCall
+	{
+		double Time;
+		int32 Hand;
+		float Amplitude;
+		int32 Frequency;
+		bool bBuffer;
+	};
+
+	class FRecordingRuntime : public IPICOXRHapticsRuntime
+	{
+	public:
+		explicit FRecordingRuntime(bool bInBuffered) : bBuffered(bInBuffered) {}
+
+		virtual void SetVibration(int32 Hand, float Amplitude, int32 Frequency, int32 DurationMs) override
+		{
+			Calls.Add({ Time, Hand, Amplitude, Frequency, false });
+		}
+
+		virtual bool SupportsBufferedPlayback() const override
+		{
+			return bBuffered;
+		}
+
+		virtual bool PlayBuffer(int32 Hand, const FPICOXRHapticsWaveform& Waveform) override
+		{
+			Calls.Add({ Time, Hand, 1.0f, 0, true });
+			return bBuffered;
+		}
+
+		TArray<FCall> Calls;
+		double Time = 0.0;
+		bool bBuffered;
+	};
+
+	// Ticks are a binary fraction of a second so lease and waveform times land exactly on them.
+	static const double TickSeconds = 1.0 / 64.0;
+
+	static void ExpectAmplitudes(FAutomationTestBase& Test, const TCHAR* What, const TArray<FCall>& Calls, const TArray<float>& Expected)
+	{
+		if (Test.TestEqual(*FString::Printf(TEXT("Runtime calls, %s"), What), Calls.Num(), Expected.Num()))
+		{
+			for (int32 Index = 0; Index < Calls.Num(); Index++)
+			{
+				Test.TestEqual(*FString::Printf(TEXT("Amplitude of call %d, %s"), Index, What), Calls[Index].Amplitude, Expected[Index], 1.0f / 255.0f);
+			}
+		}
+	}
+
+	// The engine sets all four force feedback channels every frame, jittering within an amplitude step.
+	static void TestCoalescing(FAutomationTestBase& Test)
+	{
+		TSharedRef<FRecordingRuntime> Runtime = MakeShared<FRecordingRuntime>(false);
+		FPICOXRHapticsSettings Settings;
+		Settings.LeaseSeconds = 0.25;
+		FPICOXRHapticsScheduler Scheduler(Runtime, Settings);
+		for (int32 Step = 0; Step < 128; Step++)
+		{
+			const float Value = 0.4f + ((Step & 1) ? 0.0004f : -0.0004f);
+			for (int32 Channel = 0; Channel < 2; Channel++)
+			{
+				Scheduler.SetForceFeedback(0, Channel, Value);
+				Scheduler.SetForceFeedback(1, Channel, 0.0f);
+			}
+			Runtime->Time = Step * TickSeconds;
+			Scheduler.Tick(Runtime->Time);
+		}
+		Scheduler.SetForceFeedback(0, 0, 0.0f);
+		Scheduler.SetForceFeedback(0, 1, 0.0f);
+		Scheduler.Tick(128 * TickSeconds);
+		Scheduler.Tick(129 * TickSeconds);
+
+		// Two seconds with a refresh every 0.125 s, then one stop.
+		Test.TestEqual(TEXT("Runtime calls of jittering force feedback"), Runtime->Calls.Num(), 17);
+		Test.TestTrue(TEXT("Requests of jittering force feedback"), Scheduler.GetStats().Requests == 512 + 2);
+	}
+
+	// Force feedback, then haptic feedback over it, then a waveform over both, each falling back when it ends.
+	static void TestPriorities(FAutomationTestBase& Test)
+	{
+		TSharedRef<FRecordingRuntime> Runtime = MakeShared<FRecordingRuntime>(false);
+		FPICOXRHapticsSettings Settings;
+		Settings.LeaseSeconds = 10.0;
+		FPICOXRHapticsScheduler Scheduler(Runtime, Settings);
+		FPICOXRHapticsWaveform Waveform;
+		Waveform.Samples = { 1.0f, 0.5f };
+		Waveform.SampleRate = 4.0f;
+		Waveform.Priority = 2;
+		for (int32 Step = 0; Step < 128; Step++)
+		{
+			const double Time = Step * TickSeconds;
+			Scheduler.SetForceFeedback(0, 0, Time < 1.5 ? 0.3f : 0.0f);
+			Scheduler.SetHapticFeedback(0, Time >= 0.25 && Time < 1.25 ? 0.2f : 0.0f);
+			if (Step == 32)
+			{
+				Scheduler.QueueWaveform(0, Waveform);
+			}
+			Runtime->Time = Time;
+			Scheduler.Tick(Time);
+		}
+		ExpectAmplitudes(Test, TEXT("layered feedback"), Runtime->Calls, { 0.3f, 0.2f, 1.0f, 0.5f, 0.2f, 0.3f, 0.0f });
+	}
+
+	// A PCM waveform goes to the runtime in one call and mutes force feedback until it ends.
+	// Without buffered playback it is stepped through as the envelope of its peaks.
+	static void TestBuffered(FAutomationTestBase& Test, bool bBuffered)
+	{
+		TSharedRef<FRecordingRuntime> Runtime = MakeShared<FRecordingRuntime>(bBuffered);
+		FPICOXRHapticsSettings Settings;
+		Settings.LeaseSeconds = 10.0;
+		FPICOXRHapticsScheduler Scheduler(Runtime, Settings);
+		FPICOXRHapticsWaveform Waveform;
+		Waveform.Type = EPICOXRHapticsWaveformType::PCM;
+		Waveform.SampleRate = 1024.0f;
+		for (int32 Index = 0; Index < 256; Index++)
+		{
+			Waveform.Samples.Add(0.8f * FMath::Sin(2.0f * PI * Index / 8.0f));
+		}
+		Scheduler.SetForceFeedback(1, 0, 0.3f);
+		for (int32 Step = 0; Step < 64; Step++)
+		{
+			if (Step == 16)
+			{
+				Scheduler.QueueWaveform(1, Waveform);
+			}
+			Runtime->Time = Step * TickSeconds;
+			Scheduler.Tick(Runtime->Time);
+		}
+		if (bBuffered)
+		{
+			if (Test.TestEqual(TEXT("Runtime calls around a buffered waveform"), Runtime->Calls.Num(), 3))
+			{
+				Test.TestTrue(TEXT("The waveform is handed over as a buffer"), Runtime->Calls[1].bBuffer);
+				Test.TestEqual(TEXT("Time the buffer is handed over"), Runtime->Calls[1].Time, 0.25, 0.0);
+				Test.TestEqual(TEXT("Time force feedback resumes after the buffer"), Runtime->Calls[2].Time, 0.5, 0.0);
+			}
+			Test.TestTrue(TEXT("Buffered waveforms"), Scheduler.GetStats().BufferedWaveforms == 1);
+		}
+		else
+		{
+			ExpectAmplitudes(Test, TEXT("stepped PCM waveform"), Runtime->Calls, { 0.3f, 0.8f, 0.3f });
+		}
+	}
+}
+
+/** Runs the haptics mixer and coalescing against a runtime that records its calls. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRHapticsSchedulerTest, "PICOXR.Input.HapticsScheduler", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRHapticsSchedulerTest::RunTest(const FString& Parameters)
+{
+	PICOXRHapticsTests::TestCoalescing(*this);
+	PICOXRHapticsTests::TestPriorities(*this);
+	PICOXRHapticsTests::TestBuffered(*this, true);
+	PICOXRHapticsTests::TestBuffered(*this, false);
+	return true;
+}
+#endif
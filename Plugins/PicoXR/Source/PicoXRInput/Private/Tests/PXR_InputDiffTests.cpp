@@ -0,0 +1,140 @@
+//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_InputDiff.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRInputDiffTests
+{
+	static int32 CountEvents(const TArray<FPICOXRInputEvent>& Events, EPICOXRInputEventType Type)
+	{
+		int32 Count = 0;
+		for (const FPICOXRInputEvent& Event : Events)
+		{
+			Count += Event.Type == Type ? 1 : 0;
+		}
+		return Count;
+	}
+
+	// Scripted sequences with known results. Times are binary fractions so repeats land exactly on frames.
+	static void TestScripted(FAutomationTestBase& Test)
+	{
+		FPICOXRInputDiffSettings Settings;
+		Settings.RepeatMask = 1u << 2;
+		Settings.InitialRepeatDelay = 0.25;
+		Settings.RepeatInterval = 0.125;
+		Settings.AxisDeadband = 16;
+		FPICOXRInputDiff Diff(Settings);
+		TArray<FPICOXRInputEvent> Events;
+
+		// Bit 2 held for a second repeats at 0.25, 0.375 ... 1.0, bit 3 held alongside never repeats.
+		FPICOXRInputFrame Frame;
+		Frame.SetButton(2, true);
+		Frame.SetButton(3, true);
+		for (double Time = 0.0; Time <= 1.0; Time += 0.0625)
+		{
+			Diff.Update(0, Frame, Time, Events);
+		}
+		Frame.Buttons = 0;
+		Diff.Update(0, Frame, 1.0625, Events);
+		Test.TestEqual(TEXT("Presses of two held buttons"), CountEvents(Events, EPICOXRInputEventType::Pressed), 2);
+		Test.TestEqual(TEXT("Repeats of the repeating button"), CountEvents(Events, EPICOXRInputEventType::Repeat), 7);
+		Test.TestEqual(TEXT("Releases of two held buttons"), CountEvents(Events, EPICOXRInputEventType::Released), 2);
+
+		// Noise inside the deadband sends nothing, a real move and the return to rest send one event each.
+		Events.Reset();
+		for (int32 Step = 0; Step < 32; Step++)
+		{
+			Frame.Axes[EPICOXRInputAxis::ThumbstickX] = (int16)((Step % 3) * 8 - 8);
+			Diff.Update(1, Frame, Step * 0.0625, Events);
+		}
+		Test.TestEqual(TEXT("Events of noise inside the deadband"), Events.Num(), 0);
+		Events.Reset();
+		Frame.SetAxis(EPICOXRInputAxis::ThumbstickX, 0.5f);
+		Diff.Update(1, Frame, 2.0, Events);
+		Diff.Update(1, Frame, 2.0625, Events);
+		Frame.SetAxis(EPICOXRInputAxis::ThumbstickX, 0.0f);
+		Diff.Update(1, Frame, 2.125, Events);
+		Test.TestEqual(TEXT("Events of an axis move and its return to rest"), CountEvents(Events, EPICOXRInputEventType::Axis), 2);
+		if (Test.TestEqual(TEXT("Events of an axis"), Events.Num(), 2))
+		{
+			Test.TestEqual(TEXT("Value of the return to rest"), Events[1].Value, 0.0f, 0.0f);
+		}
+	}
+
+	// Button mashing, held buttons, stick noise and trigger sweeps on both hands, used when no recording is available.
+	static void MakeSyntheticRecords(TArray<FPICOXRInputRecord>& OutRecords)
+	{
+		FRandomStream Random(0x50584952);
+		OutRecords.Reset();
+		for (int32 Step = 0; Step < 1800; Step++)
+		{
+			for (int32 Hand = 0; Hand < FPICOXRInputDiff::HandCount; Hand++)
+			{
+				FPICOXRInputRecord Record;
+				FMemory::Memzero(Record);
+				Record.Time = Step / 90.0 + (Random.FRand() < 0.02f ? 0.05 : 0.0);
+				Record.Hand = Hand;
+				const uint32 Previous = OutRecords.Num() >= 2 ? OutRecords.Last(1).Frame.Buttons : 0;
+				Record.Frame.Buttons = Random.FRand() < 0.1f ? Previous ^ (1u << Random.RandRange(0, FPICOXRInputFrame::ButtonBitCount - 1)) : Previous;
+				for (int32 Axis = 0; Axis < EPICOXRInputAxis::AxisCount; Axis++)
+				{
+					const float Sweep = FMath::Sin(Step * 0.01f * (Axis + 1));
+					Record.Frame.SetAxis(Axis, Random.FRand() < 0.2f ? 0.0f : Sweep + Random.FRandRange(-0.002f, 0.002f));
+				}
+				OutRecords.Add(Record);
+			}
+		}
+		// Keep time monotonic, the jitter above only delays frames.
+		for (int32 Index = 1; Index < OutRecords.Num(); Index++)
+		{
+			OutRecords[Index].Time = FMath::Max(OutRecords[Index].Time, OutRecords[Index - 1].Time);
+		}
+	}
+
+	// Replays the recording saved by pxr.Input.RecordState, synthetic records without one.
+	static void TestReplay(FAutomationTestBase& Test)
+	{
+		TArray<FPICOXRInputRecord> Records;
+		const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("InputState.bin"));
+		TArray<uint8> Data;
+		if (FFileHelper::LoadFileToArray(Data, *Path, FILEREAD_Silent) && Data.Num() >= (int32)sizeof(FPICOXRInputRecord))
+		{
+			Records.SetNumUninitialized(Data.Num() / sizeof(FPICOXRInputRecord));
+			FMemory::Memcpy(Records.GetData(), Data.GetData(), Records.Num() * sizeof(FPICOXRInputRecord));
+		}
+		else
+		{
+			Test.AddInfo(TEXT("No input state recording found, replaying synthetic records"));
+			MakeSyntheticRecords(Records);
+		}
+
+		FPICOXRInputDiffSettings Settings[3];
+		Settings[1].RepeatMask = FPICOXRInputFrame::ControllerButtonMask;
+		Settings[1].AxisDeadband = 64;
+		Settings[2].RepeatMask = ~0u;
+		Settings[2].InitialRepeatDelay = 0.0;
+		Settings[2].RepeatInterval = 0.005;
+		Settings[2].AxisDeadband = 2048;
+		for (int32 Index = 0; Index < (int32)UE_ARRAY_COUNT(Settings); Index++)
+		{
+			int32 NumEvents = 0;
+			const int32 Mismatches = FPICOXRInputDiff::CompareUpdates(Records, Settings[Index], &NumEvents);
+			Test.TestEqual(*FString::Printf(TEXT("Updates where the bitmask and reference diff disagree, settings %d"), Index), Mismatches, 0);
+			Test.TestTrue(*FString::Printf(TEXT("Events sent, settings %d"), Index), NumEvents > 0);
+		}
+	}
+}
+
+/** Checks the input diff against scripted sequences and replays recorded input states through the bitmask and reference diff. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRInputDiffTest, "PICOXR.Input.ButtonDiff", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRInputDiffTest::RunTest(const FString& Parameters)
+{
+	PICOXRInputDiffTests::TestScripted(*this);
+	PICOXRInputDiffTests::TestReplay(*this);
+	return true;
+}
+#endif
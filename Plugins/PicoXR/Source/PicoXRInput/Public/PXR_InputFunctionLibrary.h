@@ -275,6 +275,26 @@ public:
 	UFUNCTION(BlueprintCallable, Category="PXR|PXRInput")
 	static bool PXR_VibrateController(EPICOXRControllerType ControllerType, float Strength, int Time);
 
+	/**
+	* Queue a vibration waveform on the controller, played after the waveforms queued before it.
+	* Force feedback has priority 0 and haptic feedback effects 1, sources of a lower priority are muted while it plays.
+	* @param ControllerType    (In) The controller type(G2 controller/Neo LeftController/Neo RightController).
+	* @param Samples           (In) Amplitudes from 0 to 1, or a motor drive signal from -1 to 1 if bPCM.
+	* @param SampleRate        (In) Samples per second.
+	* @param Frequency         (In) Motor frequency in Hz, 0 for the default. Not used for PCM.
+	* @param Priority          (In) Priority of the waveform.
+	* @param bPCM              (In) Whether Samples is a drive signal, handed to the runtime in one go where it supports that.
+	*/
+	UFUNCTION(BlueprintCallable, Category="PXR|PXRInput", meta = (SampleRate = "100.0", Frequency = "0", Priority = "2"))
+	static bool PXR_QueueHapticWaveform(EPICOXRControllerType ControllerType, const TArray<float>& Samples, float SampleRate, int32 Frequency, int32 Priority, bool bPCM);
+
+	/**
+	* Stop the waveform playing on the controller and drop the queued ones.
+	* @param ControllerType    (In) The controller type(G2 controller/Neo LeftController/Neo RightController).
+	*/
+	UFUNCTION(BlueprintCallable, Category="PXR|PXRInput")
+	static bool PXR_ClearHapticWaveforms(EPICOXRControllerType ControllerType);
+
 	/**
 	* Get the controller type.
 	* @param ControllerType    (Out) The controller type(G2 /Neo).
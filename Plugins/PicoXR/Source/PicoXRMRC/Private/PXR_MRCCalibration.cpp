@@ -0,0 +1,332 @@
+﻿//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_MRCCalibration.h"
+#include "PXR_Log.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#if PLATFORM_ANDROID
+#include "Android/AndroidApplication.h"
+#include "Android/AndroidJNI.h"
+#endif
+
+// Ranges a calibration has to be in to be used.
+#define PXR_MRC_MIN_IMAGE_SIZE 16
+#define PXR_MRC_MAX_IMAGE_SIZE 8192
+#define PXR_MRC_MIN_FOV 1.0f
+#define PXR_MRC_MAX_FOV 170.0f
+// Meters from the tracking origin.
+#define PXR_MRC_MAX_CAMERA_DISTANCE 50.0f
+// Deviation of the orientation from a unit quaternion that is still normalized rather than rejected.
+#define PXR_MRC_ORIENTATION_TOLERANCE 0.05f
+
+#define PXR_MRC_CALIBRATION_CACHE_MAGIC 0x434d5850
+#define PXR_MRC_CALIBRATION_CACHE_VERSION 1
+
+namespace
+{
+	class FPICOXRJavaCalibrationReader : public IPICOXRMRCCalibrationReader
+	{
+	public:
+		virtual bool Read(const FString& Path, FPICOXRMRCCalibration& OutCalibration) override
+		{
+#if PLATFORM_ANDROID
+			if (JNIEnv* Env = FAndroidApplication::GetJavaEnv())
+			{
+				jstring j_str = Env->NewStringUTF(TCHAR_TO_UTF8(*Path));
+				static jmethodID Method = FJavaWrapper::FindMethod(Env, FJavaWrapper::GameActivityClassID, "MRCGetCalibrationData", "(Ljava/lang/String;)[F", false);
+				auto FloatValuesArray = NewScopedJavaObject(Env, (jfloatArray)FJavaWrapper::CallObjectMethod(Env, FJavaWrapper::GameActivityThis, Method, j_str));
+				Env->DeleteLocalRef(j_str);
+				if (!*FloatValuesArray || Env->GetArrayLength(*FloatValuesArray) < 10)
+				{
+					PXR_LOGE(LogMRC, "MRCGetCalibrationData returned no calibration!");
+					return false;
+				}
+				jfloat* FloatValues = Env->GetFloatArrayElements(*FloatValuesArray, 0);
+				for (int i = 0; i < 10; i++)
+				{
+					PXR_LOGI(LogMRC, "Result[%d]:%f", i, FloatValues[i]);
+				}
+				OutCalibration = FPICOXRMRCCalibration::FromRawValues(FloatValues);
+				Env->ReleaseFloatArrayElements(*FloatValuesArray, FloatValues, JNI_ABORT);
+				return true;
+			}
+#endif
+			return false;
+		}
+	};
+}
+
+FPICOXRMRCCalibration::FPICOXRMRCCalibration()
+	: Width(0)
+	, Height(0)
+	, FOV(0.0f)
+	, Position(FVector::ZeroVector)
+	, Orientation(FQuat::Identity)
+{
+}
+
+FPICOXRMRCCalibration FPICOXRMRCCalibration::FromRawValues(const float Values[10])
+{
+	FPICOXRMRCCalibration Calibration;
+	Calibration.Width = FMath::RoundToInt(Values[0]);
+	Calibration.Height = FMath::RoundToInt(Values[1]);
+	Calibration.FOV = Values[2];
+	Calibration.Position = FVector(Values[3], Values[4], Values[5]);
+	Calibration.Orientation = FQuat(Values[6], Values[7], Values[8], Values[9]);
+	return Calibration;
+}
+
+bool FPICOXRMRCCalibration::Validate(FString* OutReason)
+{
+	const TCHAR* Reason = nullptr;
+	if (Width < PXR_MRC_MIN_IMAGE_SIZE || Width > PXR_MRC_MAX_IMAGE_SIZE || Height < PXR_MRC_MIN_IMAGE_SIZE || Height > PXR_MRC_MAX_IMAGE_SIZE)
+	{
+		Reason = TEXT("image size out of range");
+	}
+	else if (!FMath::IsFinite(FOV) || FOV < PXR_MRC_MIN_FOV || FOV > PXR_MRC_MAX_FOV)
+	{
+		Reason = TEXT("fov out of range");
+	}
+	else if (Position.ContainsNaN() || Position.Size() > PXR_MRC_MAX_CAMERA_DISTANCE)
+	{
+		Reason = TEXT("position out of range");
+	}
+	else if (Orientation.ContainsNaN() || FMath::Abs(Orientation.Size() - 1.0f) > PXR_MRC_ORIENTATION_TOLERANCE)
+	{
+		Reason = TEXT("orientation is not a rotation");
+	}
+
+	if (Reason)
+	{
+		if (OutReason)
+		{
+			*OutReason = FString::Printf(TEXT("%s, size:%dx%d fov:%f position:%s orientation:%s"), Reason, Width, Height, FOV, *Position.ToString(), *Orientation.ToString());
+		}
+		return false;
+	}
+	Orientation.Normalize();
+	return true;
+}
+
+FPICOXRMRCCalibration FPICOXRMRCCalibration::Blend(const FPICOXRMRCCalibration& A, const FPICOXRMRCCalibration& B, float Alpha)
+{
+	if (Alpha <= 0.0f)
+	{
+		return A;
+	}
+	if (Alpha >= 1.0f)
+	{
+		return B;
+	}
+	FPICOXRMRCCalibration Calibration = B;
+	Calibration.FOV = FMath::Lerp(A.FOV, B.FOV, Alpha);
+	Calibration.Position = FMath::Lerp(A.Position, B.Position, Alpha);
+	Calibration.Orientation = FQuat::Slerp(A.Orientation, B.Orientation, Alpha);
+	return Calibration;
+}
+
+bool FPICOXRMRCCalibration::Equals(const FPICOXRMRCCalibration& Other, float Tolerance) const
+{
+	return Width == Other.Width && Height == Other.Height && FMath::Abs(FOV - Other.FOV) <= Tolerance
+		&& Position.Equals(Other.Position, Tolerance) && Orientation.Equals(Other.Orientation, Tolerance);
+}
+
+FArchive& operator<<(FArchive& Ar, FPICOXRMRCCalibration& Calibration)
+{
+	Ar << Calibration.Width;
+	Ar << Calibration.Height;
+	Ar << Calibration.FOV;
+	Ar << Calibration.Position;
+	Ar << Calibration.Orientation;
+	return Ar;
+}
+
+TSharedRef<IPICOXRMRCCalibrationReader> IPICOXRMRCCalibrationReader::CreateDefault()
+{
+	return MakeShared<FPICOXRJavaCalibrationReader>();
+}
+
+FPICOXRMRCCalibrationStore::FPICOXRMRCCalibrationStore(TSharedPtr<IPICOXRMRCCalibrationReader> InReader)
+	: Reader(InReader.IsValid() ? InReader.ToSharedRef() : IPICOXRMRCCalibrationReader::CreateDefault())
+	, FileSize(-1)
+	, BlendStartTime(0.0)
+	, NextPollTime(0.0)
+	, BlendTime(0.5f)
+	, PollInterval(2.0f)
+	, Revision(0)
+	, bValid(false)
+	, bBlending(false)
+{
+}
+
+bool FPICOXRMRCCalibrationStore::Load(const FString& InPath, const FString& InCachePath, double Time)
+{
+	Path = InPath;
+	CachePath = InCachePath;
+	NextPollTime = Time + PollInterval;
+	return Reload(Time);
+}
+
+bool FPICOXRMRCCalibrationStore::Tick(double Time)
+{
+	bool bChanged = false;
+	if (!Path.IsEmpty() && Time >= NextPollTime)
+	{
+		NextPollTime = Time + PollInterval;
+		// Only a file that looks different is hashed again.
+		IFileManager& FileManager = IFileManager::Get();
+		if (FileManager.FileExists(*Path) && (FileManager.GetTimeStamp(*Path) != FileTimeStamp || FileManager.FileSize(*Path) != FileSize))
+		{
+			const uint32 LastRevision = Revision;
+			Reload(Time);
+			if (Revision != LastRevision)
+			{
+				PXR_LOGI(LogMRC, "MRC calibration file changed, revision:%u", Revision);
+				Stats.Reloads++;
+				bChanged = true;
+			}
+		}
+	}
+
+	if (bBlending)
+	{
+		const float Alpha = BlendTime > 0.0f ? static_cast<float>((Time - BlendStartTime) / BlendTime) : 1.0f;
+		bBlending = Alpha < 1.0f;
+		Current = FPICOXRMRCCalibration::Blend(Previous, Target, FMath::SmoothStep(0.0f, 1.0f, Alpha));
+		bChanged = true;
+	}
+	return bChanged;
+}
+
+void FPICOXRMRCCalibrationStore::WriteCache(const FMD5Hash& Hash, const FPICOXRMRCCalibration& Calibration, TArray<uint8>& OutData)
+{
+	OutData.Reset();
+	FMemoryWriter Writer(OutData);
+	uint32 Magic = PXR_MRC_CALIBRATION_CACHE_MAGIC;
+	int32 Version = PXR_MRC_CALIBRATION_CACHE_VERSION;
+	FMD5Hash CacheHash = Hash;
+	FPICOXRMRCCalibration CacheCalibration = Calibration;
+	Writer << Magic;
+	Writer << Version;
+	Writer << CacheHash;
+	Writer << CacheCalibration;
+}
+
+bool FPICOXRMRCCalibrationStore::ReadCache(const TArray<uint8>& Data, const FMD5Hash& Hash, FPICOXRMRCCalibration& OutCalibration)
+{
+	// Everything in the cache has a fixed size, anything else is from another version or truncated.
+	static const int32 CacheSize = []()
+	{
+		TArray<uint8> Empty;
+		FMD5 MD5;
+		FMD5Hash ValidHash;
+		ValidHash.Set(MD5);
+		WriteCache(ValidHash, FPICOXRMRCCalibration(), Empty);
+		return Empty.Num();
+	}();
+	if (Data.Num() != CacheSize || !Hash.IsValid())
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	uint32 Magic = 0;
+	int32 Version = 0;
+	FMD5Hash CacheHash;
+	Reader << Magic;
+	Reader << Version;
+	if (Magic != PXR_MRC_CALIBRATION_CACHE_MAGIC || Version != PXR_MRC_CALIBRATION_CACHE_VERSION)
+	{
+		return false;
+	}
+	Reader << CacheHash;
+	if (!(CacheHash == Hash))
+	{
+		return false;
+	}
+	FPICOXRMRCCalibration Calibration;
+	Reader << Calibration;
+	if (Reader.IsError() || !Calibration.Validate())
+	{
+		return false;
+	}
+	OutCalibration = Calibration;
+	return true;
+}
+
+bool FPICOXRMRCCalibrationStore::Reload(double Time)
+{
+	IFileManager& FileManager = IFileManager::Get();
+	if (!FileManager.FileExists(*Path))
+	{
+		PXR_LOGI(LogMRC, "Calibration file not found:%s", PLATFORM_CHAR(*Path));
+		return bValid;
+	}
+	FileTimeStamp = FileManager.GetTimeStamp(*Path);
+	FileSize = FileManager.FileSize(*Path);
+	const FMD5Hash Hash = FMD5Hash::HashFile(*Path);
+	if (bValid && Hash == FileHash)
+	{
+		return true;
+	}
+
+	FPICOXRMRCCalibration Calibration;
+	TArray<uint8> CacheData;
+	if (FFileHelper::LoadFileToArray(CacheData, *CachePath, FILEREAD_Silent) && ReadCache(CacheData, Hash, Calibration))
+	{
+		PXR_LOGI(LogMRC, "MRC calibration loaded from cache:%s", PLATFORM_CHAR(*CachePath));
+		Stats.CacheHits++;
+	}
+	else
+	{
+		Stats.Parses++;
+		FString Reason;
+		if (!Reader->Read(Path, Calibration))
+		{
+			PXR_LOGE(LogMRC, "Failed to read MRC calibration:%s", PLATFORM_CHAR(*Path));
+			Stats.Rejected++;
+			return bValid;
+		}
+		if (!Calibration.Validate(&Reason))
+		{
+			PXR_LOGE(LogMRC, "Rejected MRC calibration:%s", PLATFORM_CHAR(*Reason));
+			Stats.Rejected++;
+			return bValid;
+		}
+		WriteCache(Hash, Calibration, CacheData);
+		if (!FFileHelper::SaveArrayToFile(CacheData, *CachePath))
+		{
+			PXR_LOGW(LogMRC, "Failed to write MRC calibration cache:%s", PLATFORM_CHAR(*CachePath));
+		}
+	}
+
+	FileHash = Hash;
+	SetTarget(Calibration, Time);
+	return true;
+}
+
+void FPICOXRMRCCalibrationStore::SetTarget(const FPICOXRMRCCalibration& NewTarget, double Time)
+{
+	if (bValid && NewTarget.Equals(Target))
+	{
+		return;
+	}
+	Revision++;
+	if (!bValid || BlendTime <= 0.0f)
+	{
+		Current = Previous = Target = NewTarget;
+		bBlending = false;
+	}
+	else
+	{
+		// A change in the middle of a blend starts from where the blend got to.
+		Previous = Current;
+		Target = NewTarget;
+		BlendStartTime = Time;
+		bBlending = true;
+	}
+	bValid = true;
+}
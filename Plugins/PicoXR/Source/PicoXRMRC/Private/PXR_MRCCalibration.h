@@ -0,0 +1,123 @@
+﻿//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+
+/** External camera calibration as the calibration tool writes it. */
+struct FPICOXRMRCCalibration
+{
+	FPICOXRMRCCalibration();
+
+	int32 Width;
+	int32 Height;
+	float FOV;
+	// Camera pose in the runtime's tracking space, in meters on the runtime's right handed axes, as Pxr_SetMrcPose takes it.
+	FVector Position;
+	FQuat Orientation;
+
+	/** Takes the values in the order the calibration reader returns them: width, height, fov, px, py, pz, x, y, z, w. */
+	static FPICOXRMRCCalibration FromRawValues(const float Values[10]);
+
+	/**
+	 * Checks the intrinsics and extrinsics are in a usable range and normalizes the orientation.
+	 * @return false with the reason if they are not.
+	 */
+	bool Validate(FString* OutReason = nullptr);
+
+	/** Blends the pose and FOV, the image size is taken from B as soon as Alpha is above 0. */
+	static FPICOXRMRCCalibration Blend(const FPICOXRMRCCalibration& A, const FPICOXRMRCCalibration& B, float Alpha);
+
+	bool Equals(const FPICOXRMRCCalibration& Other, float Tolerance = KINDA_SMALL_NUMBER) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FPICOXRMRCCalibration& Calibration);
+};
+
+/** Reads the calibration file. The default one asks the Java side, which owns the XML parser. */
+class IPICOXRMRCCalibrationReader
+{
+public:
+	virtual ~IPICOXRMRCCalibrationReader() {}
+
+	virtual bool Read(const FString& Path, FPICOXRMRCCalibration& OutCalibration) = 0;
+
+	static TSharedRef<IPICOXRMRCCalibrationReader> CreateDefault();
+};
+
+struct FPICOXRMRCCalibrationStats
+{
+	uint32 Parses = 0;
+	uint32 CacheHits = 0;
+	// Calibrations that failed to read or validate, the previous one stays in use.
+	uint32 Rejected = 0;
+	// Changes of the file picked up while running.
+	uint32 Reloads = 0;
+};
+
+/**
+ * Calibration of the external MRC camera, read once and kept in a binary cache keyed by the hash of the file.
+ * The file is polled for changes, a new calibration replaces the old one over a short blend instead of jumping.
+ */
+class FPICOXRMRCCalibrationStore
+{
+public:
+	/** nullptr uses the default reader. */
+	explicit FPICOXRMRCCalibrationStore(TSharedPtr<IPICOXRMRCCalibrationReader> InReader = nullptr);
+
+	/**
+	 * Takes the calibration from the cache when it was made from the same file, parses the file otherwise.
+	 * @param Path		(in) Calibration file.
+	 * @param CachePath	(in) Binary cache, written after every successful parse.
+	 * @param Time		(in) Current time in seconds.
+	 * @return true if a valid calibration is available.
+	 */
+	bool Load(const FString& Path, const FString& CachePath, double Time);
+
+	/**
+	 * Polls the file for changes and advances the blend to a new calibration.
+	 * @return true if GetCalibration changed.
+	 */
+	bool Tick(double Time);
+
+	bool IsValid() const { return bValid; }
+	bool IsBlending() const { return bBlending; }
+
+	/** The calibration to use now, part way between the old and the new one while blending. */
+	const FPICOXRMRCCalibration& GetCalibration() const { return Current; }
+	/** The calibration the store blends to, or holds. */
+	const FPICOXRMRCCalibration& GetTarget() const { return Target; }
+	/** Bumped every time a different calibration is taken, 0 until the first one. */
+	uint32 GetRevision() const { return Revision; }
+
+	void SetBlendTime(float InBlendTime) { BlendTime = FMath::Max(InBlendTime, 0.0f); }
+	void SetPollInterval(float InPollInterval) { PollInterval = FMath::Max(InPollInterval, 0.0f); }
+
+	const FPICOXRMRCCalibrationStats& GetStats() const { return Stats; }
+
+	static void WriteCache(const FMD5Hash& Hash, const FPICOXRMRCCalibration& Calibration, TArray<uint8>& OutData);
+	/** @return false if the data is not a cache of this version made from a file with Hash. */
+	static bool ReadCache(const TArray<uint8>& Data, const FMD5Hash& Hash, FPICOXRMRCCalibration& OutCalibration);
+
+private:
+	bool Reload(double Time);
+	void SetTarget(const FPICOXRMRCCalibration& NewTarget, double Time);
+
+	TSharedRef<IPICOXRMRCCalibrationReader> Reader;
+	FPICOXRMRCCalibrationStats Stats;
+	FPICOXRMRCCalibration Current;
+	FPICOXRMRCCalibration Previous;
+	FPICOXRMRCCalibration Target;
+	FString Path;
+	FString CachePath;
+	FMD5Hash FileHash;
+	FDateTime FileTimeStamp;
+	int64 FileSize;
+	double BlendStartTime;
+	double NextPollTime;
+	float BlendTime;
+	float PollInterval;
+	uint32 Revision;
+	bool bValid;
+	bool bBlending;
+};
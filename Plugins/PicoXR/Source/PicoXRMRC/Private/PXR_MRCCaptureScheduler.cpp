@@ -0,0 +1,98 @@
+﻿//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_MRCCaptureScheduler.h"
+
+// Weight of the newest frame in the smoothed frame interval.
+#define PXR_MRC_FRAME_INTERVAL_SMOOTHING 0.1
+
+FPICOXRMRCCaptureScheduler::FPICOXRMRCCaptureScheduler()
+	: NextCaptureTime(0.0)
+	, LastFrameTime(0.0)
+	, FrameInterval(0.0)
+	, TargetRate(30.0f)
+	, PendingCaptures(PXR_MRC_CAPTURE_NONE)
+	, bStarted(false)
+{
+}
+
+void FPICOXRMRCCaptureScheduler::SetTargetRate(float InTargetRate)
+{
+	TargetRate = FMath::Max(InTargetRate, 0.0f);
+	Reset();
+}
+
+void FPICOXRMRCCaptureScheduler::Reset()
+{
+	NextCaptureTime = 0.0;
+	LastFrameTime = 0.0;
+	FrameInterval = 0.0;
+	PendingCaptures = PXR_MRC_CAPTURE_NONE;
+	bStarted = false;
+}
+
+uint8 FPICOXRMRCCaptureScheduler::Update(double Time, bool bHasConsumer, bool bForeground)
+{
+	Stats.Frames++;
+	if (!bHasConsumer)
+	{
+		Stats.SkippedFrames++;
+		Reset();
+		return PXR_MRC_CAPTURE_NONE;
+	}
+
+	if (bStarted)
+	{
+		// Hitches are left out, they say nothing about how many frames the next period holds.
+		const double Delta = FMath::Max(Time - LastFrameTime, 0.0);
+		if (FrameInterval <= 0.0)
+		{
+			FrameInterval = Delta;
+		}
+		else if (Delta < 3.0 * FrameInterval)
+		{
+			FrameInterval = FMath::Lerp(FrameInterval, Delta, PXR_MRC_FRAME_INTERVAL_SMOOTHING);
+		}
+	}
+	LastFrameTime = Time;
+
+	const uint8 PeriodCaptures = PXR_MRC_CAPTURE_BACKGROUND | (bForeground ? PXR_MRC_CAPTURE_FOREGROUND : PXR_MRC_CAPTURE_NONE);
+	const double Period = TargetRate > 0.0f ? 1.0 / TargetRate : 0.0;
+
+	// A period starts on the frame closest to its start time, which keeps the phase steady when the rates divide evenly.
+	if (!bStarted || Time + 0.5 * FrameInterval >= NextCaptureTime)
+	{
+		if (bStarted && Time >= NextCaptureTime + Period && Period > 0.0)
+		{
+			// Catching up on missed periods would only burst captures, start over from this frame.
+			Stats.LatePeriods++;
+			NextCaptureTime = Time + Period;
+		}
+		else
+		{
+			NextCaptureTime = bStarted ? NextCaptureTime + Period : Time + Period;
+		}
+		PendingCaptures = PeriodCaptures;
+		bStarted = true;
+	}
+	PendingCaptures &= PeriodCaptures;
+
+	uint8 Captures = PendingCaptures;
+	if (Captures == (PXR_MRC_CAPTURE_BACKGROUND | PXR_MRC_CAPTURE_FOREGROUND))
+	{
+		// Spread the pair over two frames when the second one still falls inside the period.
+		if (FrameInterval > 0.0 && 2.0 * FrameInterval <= Period)
+		{
+			Captures = PXR_MRC_CAPTURE_BACKGROUND;
+			Stats.SplitPeriods++;
+		}
+		else
+		{
+			Stats.PairedPeriods++;
+		}
+	}
+	PendingCaptures &= ~Captures;
+
+	Stats.BackgroundCaptures += (Captures & PXR_MRC_CAPTURE_BACKGROUND) ? 1 : 0;
+	Stats.ForegroundCaptures += (Captures & PXR_MRC_CAPTURE_FOREGROUND) ? 1 : 0;
+	return Captures;
+}
@@ -0,0 +1,70 @@
+﻿//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Scene captures of the mixed reality camera, combined as bit flags. */
+enum EPICOXRMRCCapture : uint8
+{
+	PXR_MRC_CAPTURE_NONE = 0,
+	PXR_MRC_CAPTURE_BACKGROUND = 1 << 0,
+	PXR_MRC_CAPTURE_FOREGROUND = 1 << 1,
+};
+
+struct FPICOXRMRCCaptureStats
+{
+	uint64 Frames = 0;
+	uint64 BackgroundCaptures = 0;
+	uint64 ForegroundCaptures = 0;
+	// Frames that skipped capturing because nothing consumed the captures.
+	uint64 SkippedFrames = 0;
+	// Capture periods whose captures were spread over two frames, or all rendered in one.
+	uint64 SplitPeriods = 0;
+	uint64 PairedPeriods = 0;
+	// Capture periods that started late by a whole period, after a hitch.
+	uint64 LatePeriods = 0;
+};
+
+/**
+ * Decides which mixed reality captures a frame renders, at a target rate of its own rather than the headset's.
+ * Each capture period renders the background and, when enabled, the foreground once. They go on consecutive
+ * frames while at least two frames fit in a period, and on the same frame otherwise.
+ * Holds no engine state and reads no clock, the caller passes the frame time.
+ */
+class FPICOXRMRCCaptureScheduler
+{
+public:
+	FPICOXRMRCCaptureScheduler();
+
+	/** Captures per second, 0 captures every frame. */
+	void SetTargetRate(float InTargetRate);
+	float GetTargetRate() const { return TargetRate; }
+
+	/** Forgets the timing history, the next frame with a consumer captures. Stats are kept. */
+	void Reset();
+
+	/**
+	 * Called once per frame.
+	 * @param Time			(in) Frame time in seconds.
+	 * @param bHasConsumer	(in) Whether anything reads the captures, no capture runs without one.
+	 * @param bForeground	(in) Whether the foreground capture is enabled.
+	 * @return EPICOXRMRCCapture flags of the captures to render this frame.
+	 */
+	uint8 Update(double Time, bool bHasConsumer, bool bForeground);
+
+	/** Smoothed time between frames in seconds, 0 until two frames were seen. */
+	double GetFrameInterval() const { return FrameInterval; }
+
+	const FPICOXRMRCCaptureStats& GetStats() const { return Stats; }
+	void ResetStats() { Stats = FPICOXRMRCCaptureStats(); }
+
+private:
+	FPICOXRMRCCaptureStats Stats;
+	double NextCaptureTime;
+	double LastFrameTime;
+	double FrameInterval;
+	float TargetRate;
+	uint8 PendingCaptures;
+	bool bStarted;
+};
@@ -14,6 +14,7 @@
 #include "TimerManager.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "PXR_HMD.h"
+#include "PXR_HMDModule.h"
 #include "Runtime/Engine/Classes/Camera/CameraComponent.h"
 #include "XRThreadUtils.h"
 #include "UObject/ConstructorHelpers.h"
@@ -28,6 +29,8 @@ APICOXRMRC_CastingCameraActor::APICOXRMRC_CastingCameraActor(const FObjectInitia
 	:Super(ObjectInitializer)
 	,BackgroundRenderTarget(nullptr)
 	,ForegroundRenderTarget(nullptr)
+	,BackgroundTemplate(nullptr)
+	,ForegroundTemplate(nullptr)
 	,bEnableForeground(true)
 	,ForegroundMaxDistance(300.f)
 	,bHasInitializedInGameCamOnce(false)
@@ -41,15 +44,18 @@ APICOXRMRC_CastingCameraActor::APICOXRMRC_CastingCameraActor(const FObjectInitia
 	
 	ForegroundCaptureActor = NULL;
 
+	// The pooled targets take their clear color and address modes from these, the assets themselves are not rendered to
 	static ConstructorHelpers::FObjectFinder<UTextureRenderTarget2D> BGRef(TEXT("TextureRenderTarget2D'/PICOXR/Textures/MRCRT_BG.MRCRT_BG'"));
-	BackgroundRenderTarget = BGRef.Object;
-	check(BackgroundRenderTarget != nullptr);
-	BackgroundRenderTarget->RenderTargetFormat = RTF_RGBA8_SRGB;
+	BackgroundTemplate = BGRef.Object;
+	check(BackgroundTemplate != nullptr);
 
 	static ConstructorHelpers::FObjectFinder<UTextureRenderTarget2D> FGRef(TEXT("TextureRenderTarget2D'/PICOXR/Textures/MRCRT_FG.MRCRT_FG'"));
-	ForegroundRenderTarget = FGRef.Object;
-	check(ForegroundRenderTarget != nullptr);
-	ForegroundRenderTarget->RenderTargetFormat = RTF_RGBA8_SRGB;
+	ForegroundTemplate = FGRef.Object;
+	check(ForegroundTemplate != nullptr);
+
+	// Captures are rendered when the capture scheduler asks for them, not every frame
+	GetCaptureComponent2D()->bCaptureEveryFrame = false;
+	GetCaptureComponent2D()->bCaptureOnMovement = false;
 }
 
 void APICOXRMRC_CastingCameraActor::InitializeStates(UPXRInGameThirdCamState* MRStateIn)
@@ -67,6 +73,7 @@ void APICOXRMRC_CastingCameraActor::BeginPlay()
 void APICOXRMRC_CastingCameraActor::EndPlay(EEndPlayReason::Type Reason)
 {
 	DestroyForeroundCaptureActor();
+	ReleaseRenderTargets();
 	Super::EndPlay(Reason);
 }
 
@@ -87,30 +94,19 @@ void APICOXRMRC_CastingCameraActor::Tick(float DeltaTime)
 		else if(!bEnableForeground&&ForegroundCaptureActor)
 		{
 			DestroyForeroundCaptureActor();
-			if (!GetCaptureComponent2D()->IsVisible())
-			{
-				GetCaptureComponent2D()->SetVisibility(true);
-			}
-		}
-		
-		if (ForegroundCaptureActor && GetCaptureComponent2D()->IsVisible())
-		{
-			ForegroundCaptureActor->GetCaptureComponent2D()->TextureTarget = ForegroundRenderTarget;
-			GetCaptureComponent2D()->SetVisibility(false);
-			ForegroundCaptureActor->GetCaptureComponent2D()->SetVisibility(true);
-			
 		}
-		else if (ForegroundCaptureActor && ForegroundCaptureActor->GetCaptureComponent2D()->IsVisible())
+
+		// The scheduler runs the captures at their own rate and spreads background and foreground over frames
+		FPICOXRMRCModule& MRCModule = FPICOXRMRCModule::Get();
+		const uint8 Captures = MRCModule.GetCaptureScheduler().Update(FPlatformTime::Seconds(), MRCModule.HasCaptureConsumer(), ForegroundCaptureActor != nullptr);
+		if (Captures & PXR_MRC_CAPTURE_BACKGROUND)
 		{
-			GetCaptureComponent2D()->TextureTarget = BackgroundRenderTarget;
-			ForegroundCaptureActor->GetCaptureComponent2D()->SetVisibility(false);
-			GetCaptureComponent2D()->SetVisibility(true);
+			GetCaptureComponent2D()->CaptureSceneDeferred();
 		}
-		else if (!ForegroundCaptureActor && !GetCaptureComponent2D()->IsVisible())
+		if ((Captures & PXR_MRC_CAPTURE_FOREGROUND) && ForegroundCaptureActor)
 		{
-			GetCaptureComponent2D()->SetVisibility(true);
+			ForegroundCaptureActor->GetCaptureComponent2D()->CaptureSceneDeferred();
 		}
-
 	}
 }
 
@@ -133,7 +129,9 @@ void APICOXRMRC_CastingCameraActor::SpawnForegroundCaptureActor()
 		ForegroundCaptureActor->GetCaptureComponent2D()->bDisableFlipCopyGLES = true;
 #endif
 #endif
-		ForegroundCaptureActor->GetCaptureComponent2D()->SetVisibility(false);
+		ForegroundCaptureActor->GetCaptureComponent2D()->bCaptureEveryFrame = false;
+		ForegroundCaptureActor->GetCaptureComponent2D()->bCaptureOnMovement = false;
+		ForegroundCaptureActor->GetCaptureComponent2D()->TextureTarget = ForegroundRenderTarget;
 		ForegroundCaptureActor->GetCaptureComponent2D()->MaxViewDistanceOverride = ForegroundMaxDistance;
 		float x = MRState->TrackedCamera.Width;
 		float y = MRState->TrackedCamera.Height;
@@ -301,10 +299,33 @@ void APICOXRMRC_CastingCameraActor::InitializeRTSize()
 
 	FIntPoint CameraTargetSize = FIntPoint(ViewWidth, ViewHeight);
 
-	BackgroundRenderTarget->ResizeTarget(ViewWidth, ViewHeight);
-	
-	ForegroundRenderTarget->ResizeTarget(ViewWidth, ViewHeight);	
+	// Pooled targets outlive the actor, toggling MRC with the same camera gets the same targets back without allocating
+	const FPICOXRRenderTargetKey BackgroundKey(CameraTargetSize, RTF_RGBA8_SRGB, *BackgroundTemplate);
+	const FPICOXRRenderTargetKey ForegroundKey(CameraTargetSize, RTF_RGBA8_SRGB, *ForegroundTemplate);
+	FPICOXRMRCModule::Get().AcquireRenderTargets(BackgroundKey, ForegroundKey, BackgroundRenderTarget, ForegroundRenderTarget);
+	check(BackgroundRenderTarget != nullptr && ForegroundRenderTarget != nullptr);
+	FPICOXRRenderTargetPool& RenderTargetPool = FPICOXRHMDModule::Get().GetRenderTargetPool();
+	PXR_LOGI(LogMRC, "MRC render targets %dx%d, pool allocations:%llu reuses:%llu", ViewWidth, ViewHeight,
+		RenderTargetPool.GetStats().Allocations, RenderTargetPool.GetStats().Reuses);
+
+	// A reused target may hold an old capture, the foreground stays clear until it is captured again
+	UKismetRenderingLibrary::ClearRenderTarget2D(this, ForegroundRenderTarget, FLinearColor::Green);
+}
 
+void APICOXRMRC_CastingCameraActor::ReleaseRenderTargets()
+{
+	if (!BackgroundRenderTarget && !ForegroundRenderTarget)
+	{
+		return;
+	}
+	// The MRC layer of the HMD may outlive the actor across a level change, the module keeps the targets until it is gone.
+	if (FPICOXRMRCModule::IsAvailable())
+	{
+		FPICOXRMRCModule::Get().ReleaseRenderTargets();
+	}
+	GetCaptureComponent2D()->TextureTarget = nullptr;
+	BackgroundRenderTarget = nullptr;
+	ForegroundRenderTarget = nullptr;
 }
 
 void APICOXRMRC_CastingCameraActor::InitializeInGameCam()
@@ -331,6 +352,7 @@ void APICOXRMRC_CastingCameraActor::InitializeInGameCam()
 		float x = MRState->TrackedCamera.Width;
 		float y = MRState->TrackedCamera.Height;
 		GetCaptureComponent2D()->FOVAngle = MRState->TrackedCamera.FOV * (x / y);
+		GetCaptureComponent2D()->TextureTarget = BackgroundRenderTarget;
 		PXR_LOGI(LogMRC, "Final FOV:%f", GetCaptureComponent2D()->FOVAngle);
 	
 		SpawnForegroundCaptureActor();
@@ -39,11 +39,19 @@ public:
 	UPROPERTY()
 	UTextureRenderTarget2D* ForegroundRenderTarget;
 
+	/** Authored MRCRT_BG and MRCRT_FG assets, whose clear color and address modes the pooled targets are created with */
+	UPROPERTY()
+	UTextureRenderTarget2D* BackgroundTemplate;
+
+	UPROPERTY()
+	UTextureRenderTarget2D* ForegroundTemplate;
+
 	bool bEnableForeground;
 private:
 	
 	void InitializeInGameCam();
 	void InitializeRTSize();
+	void ReleaseRenderTargets();
 	void SetMRCTrackingReference();
 	void UpdateInGameCamPose();
 	void UpdateCamMatrixAndDepth();
@@ -38,6 +38,14 @@ void UPICOXRMRCFunctionLibrary::EnableForegroundMRC(bool enable)
 	}
 }
 
+void UPICOXRMRCFunctionLibrary::SetMRCCaptureRate(float Rate)
+{
+	if (FPICOXRMRCModule::IsAvailable())
+	{
+		FPICOXRMRCModule::Get().SetCaptureRate(Rate);
+	}
+}
+
 void UPICOXRMRCFunctionLibrary::SetMRCTrackingReference(USceneComponent* TrackingReference)
 {
 	if (FPICOXRMRCModule::IsAvailable())
@@ -11,6 +11,8 @@
 #include "Kismet/GameplayStatics.h"
 #include "PXR_MRCCastingCameraActor.h"
 #include "PXR_HMD.h"
+#include "PXR_HMDModule.h"
+#include "HAL/IConsoleManager.h"
 
 #if PICO_MRC_SUPPORTED_PLATFORMS
 #include "Android/AndroidApplication.h"
@@ -25,6 +27,9 @@ FPICOXRHMD* FPICOXRMRCModule::PICOXRHMD = nullptr;
 FPICOXRMRCModule::FPICOXRMRCModule()
 	:bSimulateEnableMRC(false)
 	, InGameThirdCamState(nullptr)
+	, AppliedCalibrationRevision(0)
+	, BackgroundRenderTarget(nullptr)
+	, ForegroundRenderTarget(nullptr)
 	, WorldAddedDelegate()
 	, WorldDestroyedDelegate()
 	, WorldLoadDelegate()
@@ -99,16 +104,17 @@ bool FPICOXRMRCModule::IsMrcActivated()
 
 bool FPICOXRMRCModule::GetMRCCalibrationData(FPXRTrackedCamera& CameraState)
 {
-	if (RawCameraDateFromXML.refreshed)
+	if (CalibrationStore.IsValid())
 	{
 #if PLATFORM_ANDROID
 		Pxr_GetMrcPose(&MRCPose);
 		PXR_LOGV(LogMRC, "Pxr_GetMrcPose x:%f y:%f z:%f w:%f px:%f py:%f pz:%f",
 			MRCPose.orientation.x, MRCPose.orientation.y, MRCPose.orientation.z, MRCPose.orientation.w, MRCPose.position.x, MRCPose.position.y, MRCPose.position.z);
 
-			CameraState.Width = RawCameraDateFromXML.width;
-			CameraState.Height = RawCameraDateFromXML.height;
-			CameraState.FOV = RawCameraDateFromXML.fov;
+			const FPICOXRMRCCalibration& Calibration = CalibrationStore.GetCalibration();
+			CameraState.Width = Calibration.Width;
+			CameraState.Height = Calibration.Height;
+			CameraState.FOV = Calibration.FOV;
 			//Right hand to left hand
 			CameraState.CalibratedOffset = FVector(-MRCPose.position.z * 100, MRCPose.position.x * 100, MRCPose.position.y * 100);
 			CameraState.CalibratedRotation = FQuat(-MRCPose.orientation.z, MRCPose.orientation.x, MRCPose.orientation.y, -MRCPose.orientation.w).Rotator();
@@ -118,7 +124,7 @@ bool FPICOXRMRCModule::GetMRCCalibrationData(FPXRTrackedCamera& CameraState)
 	}
 	else
 	{
-		PXR_LOGV(LogMRC, "RawCameraDateFromXML is not refreshed,use default data!");
+		PXR_LOGV(LogMRC, "No valid calibration,use default data!");
 		CameraState.FOV = 90;
 		CameraState.Width = 1920;
 		CameraState.Height = 1080;
@@ -151,6 +157,58 @@ bool FPICOXRMRCModule::GetMRCRT(UTextureRenderTarget2D*& Background_RT, UTexture
 	return false;
 }
 
+void FPICOXRMRCModule::AcquireRenderTargets(const FPICOXRRenderTargetKey& BackgroundKey, const FPICOXRRenderTargetKey& ForegroundKey, UTextureRenderTarget2D*& OutBackground, UTextureRenderTarget2D*& OutForeground)
+{
+	if (BackgroundRenderTarget && (BackgroundRenderTargetKey != BackgroundKey || ForegroundRenderTargetKey != ForegroundKey))
+	{
+		// The layer would keep reading the old targets, it is created again with the new ones.
+		DestroyMRCLayer();
+	}
+	if (!BackgroundRenderTarget)
+	{
+		FPICOXRRenderTargetPool& RenderTargetPool = FPICOXRHMDModule::Get().GetRenderTargetPool();
+		BackgroundRenderTarget = RenderTargetPool.Acquire(BackgroundKey);
+		ForegroundRenderTarget = RenderTargetPool.Acquire(ForegroundKey);
+		BackgroundRenderTargetKey = BackgroundKey;
+		ForegroundRenderTargetKey = ForegroundKey;
+	}
+	OutBackground = BackgroundRenderTarget;
+	OutForeground = ForegroundRenderTarget;
+}
+
+void FPICOXRMRCModule::ReleaseRenderTargets()
+{
+	if (!BackgroundRenderTarget || HasMRCLayer())
+	{
+		return;
+	}
+	FPICOXRRenderTargetPool& RenderTargetPool = FPICOXRHMDModule::Get().GetRenderTargetPool();
+	// In reverse, the pool hands the most recent target out first, so the next camera gets them back in the same roles.
+	RenderTargetPool.Release(ForegroundRenderTarget);
+	RenderTargetPool.Release(BackgroundRenderTarget);
+	BackgroundRenderTarget = nullptr;
+	ForegroundRenderTarget = nullptr;
+}
+
+bool FPICOXRMRCModule::HasMRCLayer()
+{
+#if PLATFORM_ANDROID
+	return PICOXRHMD && PICOXRHMD->CurrentMRCLayer;
+#else
+	return false;
+#endif
+}
+
+void FPICOXRMRCModule::DestroyMRCLayer()
+{
+	if (HasMRCLayer())
+	{
+		PXR_LOGI(LogMRC, "Destroy All MRCLayers One Time!");
+		PICOXRHMD->DestroyMRCLayer();
+	}
+	ReleaseRenderTargets();
+}
+
 void FPICOXRMRCModule::EnableForeground(bool enable)
 {
 	if (IsMrcActivated() && InGameThirdCam)
@@ -159,6 +217,23 @@ void FPICOXRMRCModule::EnableForeground(bool enable)
 	}
 }
 
+bool FPICOXRMRCModule::HasCaptureConsumer()
+{
+#if PLATFORM_ANDROID
+	if (PICOXRHMD && PICOXRHMD->CurrentMRCLayer)
+	{
+		return true;
+	}
+#endif
+	return bSimulateEnableMRC;
+}
+
+void FPICOXRMRCModule::SetCaptureRate(float Rate)
+{
+	PXR_LOGI(LogMRC, "SetCaptureRate:%f", Rate);
+	CaptureScheduler.SetTargetRate(Rate);
+}
+
 UPXRInGameThirdCamState* FPICOXRMRCModule::GetMRCState()
 {
 	return InGameThirdCamState;
@@ -170,7 +245,7 @@ void FPICOXRMRCModule::InitMRC()
 	InGameThirdCamState = NewObject<UPXRInGameThirdCamState>((UObject*)GetTransientPackage(), FName("PICOXRMRC_State"), RF_MarkAsRootSet);
 
 	ResetInGameThirdCamState();
-	ReadCameraRawDataFromXML();
+	LoadCalibration();
 	
 	WorldAddedDelegate = GEngine->OnWorldAdded().AddRaw(this, &FPICOXRMRCModule::OnWorldCreated);
 	WorldDestroyedDelegate = GEngine->OnWorldDestroyed().AddRaw(this, &FPICOXRMRCModule::OnWorldDestroyed);
@@ -223,6 +298,8 @@ void FPICOXRMRCModule::ResetInGameThirdCamState()
 		InGameThirdCamState->CurrentTrackingReference = nullptr;
 		InGameThirdCamState->bUseCustomTrans = false;
 		InGameThirdCamState->CustomTrans = FTransform();
+		InGameThirdCamState->Calibration = CalibrationStore.GetCalibration();
+		InGameThirdCamState->CalibrationRevision = CalibrationStore.GetRevision();
 	}
 }
 
@@ -253,61 +330,56 @@ void FPICOXRMRCModule::OnWorldDestroyed(UWorld* NewWorld)
 #endif
 }
 
-bool FPICOXRMRCModule::ReadCameraRawDataFromXML()
+bool FPICOXRMRCModule::LoadCalibration()
 {
 	FString XmlConfigPath = FPaths::Combine(FPaths::ProjectPersistentDownloadDir(), TEXT("mrc.xml"));
-	PXR_LOGI(LogMRC, "ReadCameraRawDataFromXML:%s", PLATFORM_CHAR(*XmlConfigPath));
-	if (FPaths::FileExists(XmlConfigPath))
+	FString CachePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("mrc_calibration.bin"));
+	PXR_LOGI(LogMRC, "LoadCalibration:%s", PLATFORM_CHAR(*XmlConfigPath));
+	if (!CalibrationStore.Load(XmlConfigPath, CachePath, FPlatformTime::Seconds()))
 	{
+		return false;
+	}
+	ApplyCalibration();
+	return true;
+}
+
+void FPICOXRMRCModule::ApplyCalibration()
+{
+	const FPICOXRMRCCalibration& Calibration = CalibrationStore.GetCalibration();
+	const bool bNewRevision = CalibrationStore.GetRevision() != AppliedCalibrationRevision;
+	AppliedCalibrationRevision = CalibrationStore.GetRevision();
 #if PLATFORM_ANDROID
-		if (JNIEnv* Env = FAndroidApplication::GetJavaEnv())
+	PxrPosef Newpose;
+	Newpose.position.x = Calibration.Position.X;
+	Newpose.position.y = Calibration.Position.Y;
+	Newpose.position.z = Calibration.Position.Z;
+	Newpose.orientation.x = Calibration.Orientation.X;
+	Newpose.orientation.y = Calibration.Orientation.Y;
+	Newpose.orientation.z = Calibration.Orientation.Z;
+	Newpose.orientation.w = Calibration.Orientation.W;
+	if (bNewRevision)
+	{
+		int CurrentVersion = 0;
+		Pxr_GetConfigInt(PxrConfigType::PXR_API_VERSION, &CurrentVersion);
+		if (CurrentVersion >= 0x2000306)
 		{
-			jstring j_str = Env->NewStringUTF(TCHAR_TO_UTF8(*XmlConfigPath));
-			static jmethodID Method = FJavaWrapper::FindMethod(Env, FJavaWrapper::GameActivityClassID, "MRCGetCalibrationData", "(Ljava/lang/String;)[F", false);
-			auto FloatValuesArray = NewScopedJavaObject(Env, (jfloatArray)FJavaWrapper::CallObjectMethod(Env, FJavaWrapper::GameActivityThis, Method, j_str));
-			jfloat* FloatValues = Env->GetFloatArrayElements(*FloatValuesArray, 0);
-			for (int i = 0; i < 10; i++)
-			{
-				PXR_LOGI(LogMRC, "Result[%d]:%f", i, FloatValues[i]);
-			}
-			RawCameraDateFromXML.width = FloatValues[0]; RawCameraDateFromXML.height = FloatValues[1]; RawCameraDateFromXML.fov = FloatValues[2];
-			RawCameraDateFromXML.px = FloatValues[3]; RawCameraDateFromXML.py = FloatValues[4]; RawCameraDateFromXML.pz = FloatValues[5];
-			RawCameraDateFromXML.x = FloatValues[6]; RawCameraDateFromXML.y = FloatValues[7]; RawCameraDateFromXML.z = FloatValues[8]; RawCameraDateFromXML.w = FloatValues[9];
-			Env->ReleaseFloatArrayElements(*FloatValuesArray, FloatValues, 0);
-
-			PxrPosef Newpose;
-			Newpose.position.x = RawCameraDateFromXML.px;
-			Newpose.position.y = RawCameraDateFromXML.py;
-			Newpose.position.z = RawCameraDateFromXML.pz;
-			Newpose.orientation.x = RawCameraDateFromXML.x;
-			Newpose.orientation.y = RawCameraDateFromXML.y;
-			Newpose.orientation.z = RawCameraDateFromXML.z;
-			Newpose.orientation.w = RawCameraDateFromXML.w;
-			int CurrentVersion = 0;
-			Pxr_GetConfigInt(PxrConfigType::PXR_API_VERSION, &CurrentVersion);
-			if (CurrentVersion >= 0x2000306)
-			{
-				PXR_LOGI(LogMRC, "CurrentVersion:%d SetIsSupportMovingMrc to true!", CurrentVersion);
-				Pxr_SetIsSupportMovingMrc(true);
-	}
-			Pxr_SetMrcPose(&Newpose);
-			Pxr_SetConfigUint64(PxrConfigType::PXR_MRC_TEXTURE_WIDTH, RawCameraDateFromXML.width);
-			Pxr_SetConfigUint64(PxrConfigType::PXR_MRC_TEXTURE_HEIGHT, RawCameraDateFromXML.height);
-			RawCameraDateFromXML.refreshed = true;
-			return true;
+			PXR_LOGI(LogMRC, "CurrentVersion:%d SetIsSupportMovingMrc to true!", CurrentVersion);
+			Pxr_SetIsSupportMovingMrc(true);
 		}
-#endif
-		RawCameraDateFromXML.refreshed = false;
-		return false;
 	}
-	else
+	// Blends between calibrations move the pose every frame, the texture size only changes with a new calibration
+	Pxr_SetMrcPose(&Newpose);
+	if (bNewRevision)
 	{
-		PXR_LOGI(LogMRC, "Xml config file not found!");
-		RawCameraDateFromXML.refreshed = false;
-		return false;
+		Pxr_SetConfigUint64(PxrConfigType::PXR_MRC_TEXTURE_WIDTH, Calibration.Width);
+		Pxr_SetConfigUint64(PxrConfigType::PXR_MRC_TEXTURE_HEIGHT, Calibration.Height);
+	}
+#endif
+	if (InGameThirdCamState)
+	{
+		InGameThirdCamState->Calibration = Calibration;
+		InGameThirdCamState->CalibrationRevision = AppliedCalibrationRevision;
 	}
-	RawCameraDateFromXML.refreshed = false;
-	return false;
 }
 
 #if PLATFORM_ANDROID
@@ -318,6 +390,7 @@ void FPICOXRMRCModule::SwitchCaptureActive()
 		if (!bCpture2DActorActivated)
 		{
 			PXR_LOGI(LogMRC, "Activating MRC Capture");
+			CaptureScheduler.Reset();
 			OpenInGameCam();
 			bCpture2DActorActivated = true;
 		}
@@ -328,11 +401,7 @@ void FPICOXRMRCModule::SwitchCaptureActive()
 		{
 			PXR_LOGI(LogMRC, "Deactivating MRC Capture");
 			CloseInGameCam();
-			if (PICOXRHMD && PICOXRHMD->CurrentMRCLayer)
-			{
-				PXR_LOGI(LogMRC, "Destroy All MRCLayers One Time!");
-				PICOXRHMD->DestroyMRCLayer();
-			}
+			DestroyMRCLayer();
 			bCpture2DActorActivated = false;
 		}
 
@@ -346,6 +415,11 @@ void FPICOXRMRCModule::OnWorldTick(UWorld* World, ELevelTick Tick, float Delta)
 	if (CurrentWorld && World == CurrentWorld)
 	{
 		SwitchCaptureActive();
+		// Picks up calibration file changes and moves the camera over to them
+		if (CalibrationStore.Tick(FPlatformTime::Seconds()))
+		{
+			ApplyCalibration();
+		}
 	}
 }
 
@@ -380,6 +454,46 @@ void FPICOXRMRCModule::OnInitialWorldCreated(UWorld* NewWorld)
 }
 #endif
 
+#if !UE_BUILD_SHIPPING
+namespace PICOXRMRCModuleCommands
+{
+	static void SetCaptureRate(const TArray<FString>& Args)
+	{
+		if (Args.Num() > 0 && FPICOXRMRCModule::IsAvailable())
+		{
+			FPICOXRMRCModule::Get().SetCaptureRate(FCString::Atof(*Args[0]));
+		}
+	}
+
+	static void LogCaptureStats(const TArray<FString>& Args)
+	{
+		if (!FPICOXRMRCModule::IsAvailable())
+		{
+			return;
+		}
+		FPICOXRMRCCaptureScheduler& Scheduler = FPICOXRMRCModule::Get().GetCaptureScheduler();
+		const FPICOXRMRCCaptureStats& Stats = Scheduler.GetStats();
+		PXR_LOGI(LogMRC, "MRC capture at %.1fHz, frame interval:%.2fms frames:%llu background:%llu foreground:%llu skipped:%llu split:%llu paired:%llu late:%llu",
+			Scheduler.GetTargetRate(), Scheduler.GetFrameInterval() * 1000.0, Stats.Frames, Stats.BackgroundCaptures, Stats.ForegroundCaptures,
+			Stats.SkippedFrames, Stats.SplitPeriods, Stats.PairedPeriods, Stats.LatePeriods);
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			Scheduler.ResetStats();
+		}
+	}
+
+	static FAutoConsoleCommand SetCaptureRateCommand(
+		TEXT("pxr.MRC.CaptureRate"),
+		TEXT("Sets the mixed reality capture rate in Hz, 0 captures every frame."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&SetCaptureRate));
+
+	static FAutoConsoleCommand LogCaptureStatsCommand(
+		TEXT("pxr.MRC.CaptureStats"),
+		TEXT("Logs the mixed reality capture scheduler statistics, 'reset' clears them afterwards."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&LogCaptureStats));
+}
+#endif
+
 #undef LOCTEXT_NAMESPACE
 	
 IMPLEMENT_MODULE(FPICOXRMRCModule, PICOXRMRC)
\ No newline at end of file
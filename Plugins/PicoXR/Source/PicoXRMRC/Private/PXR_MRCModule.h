@@ -5,6 +5,9 @@
 #include "Engine/EngineBaseTypes.h"
 #include "IPXR_MRCModule.h"
 #include "PXR_Log.h"
+#include "PXR_MRCCaptureScheduler.h"
+#include "PXR_MRCCalibration.h"
+#include "PXR_RenderTargetPool.h"
 
 #if PLATFORM_ANDROID
 #include "PxrTypes.h"
@@ -18,17 +21,6 @@ class UPXRInGameThirdCamState;
 class APICOXRMRC_CastingCameraActor;
 struct FPXRTrackedCamera;
 
-struct FRawCameraDataFromXML
-{
-	float x,y,z,w,px,py,pz,fov,width,height;
-	bool refreshed;
-	FRawCameraDataFromXML()
-	{
-		x = y = z = w = px = py = pz =fov= width = height = 0;
-		refreshed = false;
-	}
-};
-
 class FPICOXRMRCModule : public IPICOXRMRCModule
 {
 public:
@@ -59,8 +51,28 @@ public:
 
 	bool GetMRCRT(UTextureRenderTarget2D* &Background_RT,UTextureRenderTarget2D* &Forground_RT);
 
+	/**
+	 * Pooled targets of the in-game camera. The module holds them rather than the camera, as the MRC layer of the HMD reads
+	 * them for as long as it exists, which may be after the camera ended with its level. A camera asking for the same key
+	 * while the layer is alive gets the targets the layer reads.
+	 */
+	void AcquireRenderTargets(const FPICOXRRenderTargetKey& BackgroundKey, const FPICOXRRenderTargetKey& ForegroundKey, UTextureRenderTarget2D*& OutBackground, UTextureRenderTarget2D*& OutForeground);
+
+	/** Hands the targets back to the pool, or once the MRC layer is destroyed if it still reads them. */
+	void ReleaseRenderTargets();
+
 	void EnableForeground(bool enable);
 
+	/** Whether anything reads the captures, the MRC layer of the HMD or a simulated MRC session */
+	bool HasCaptureConsumer();
+
+	/** Captures per second of the in-game camera, 0 captures every frame */
+	void SetCaptureRate(float Rate);
+
+	FPICOXRMRCCaptureScheduler& GetCaptureScheduler() { return CaptureScheduler; }
+
+	const FPICOXRMRCCalibrationStore& GetCalibrationStore() const { return CalibrationStore; }
+
 	bool bSimulateEnableMRC;
 
 	UPXRInGameThirdCamState* GetMRCState();
@@ -72,7 +84,13 @@ private:
 	FDelegateHandle WorldAddedDelegate;
 	FDelegateHandle WorldDestroyedDelegate;
 	FDelegateHandle WorldLoadDelegate;
-	FRawCameraDataFromXML RawCameraDateFromXML;
+	FPICOXRMRCCalibrationStore CalibrationStore;
+	uint32 AppliedCalibrationRevision;
+	FPICOXRMRCCaptureScheduler CaptureScheduler;
+	FPICOXRRenderTargetKey BackgroundRenderTargetKey;
+	FPICOXRRenderTargetKey ForegroundRenderTargetKey;
+	UTextureRenderTarget2D* BackgroundRenderTarget;
+	UTextureRenderTarget2D* ForegroundRenderTarget;
 #if PLATFORM_ANDROID
     PxrPosef MRCPose;
 #endif
@@ -83,7 +101,12 @@ private:
 	void ResetInGameThirdCamState();
 	void OnWorldCreated(UWorld* NewWorld);
 	void OnWorldDestroyed(UWorld* NewWorld);
-	bool ReadCameraRawDataFromXML();
+	bool LoadCalibration();
+	/** Hands the current calibration to the runtime and the in-game camera state */
+	void ApplyCalibration();
+	bool HasMRCLayer();
+	/** Destroys the MRC layer of the HMD, then releases the targets it read */
+	void DestroyMRCLayer();
 
 	bool bCpture2DActorActivated;
 #if PLATFORM_ANDROID
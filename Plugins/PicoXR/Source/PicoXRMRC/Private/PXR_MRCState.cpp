@@ -9,6 +9,7 @@ UPXRInGameThirdCamState::UPXRInGameThirdCamState(const FObjectInitializer& Objec
 	,ZOffset(0)
 	,CurrentTrackingReference(nullptr)
 	,bUseCustomTrans(false)
+	,CalibrationRevision(0)
 {
 	CustomTrans = FTransform::Identity;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+#include "PXR_MRCCalibration.h"
 #include "PXR_MRCState.generated.h"
 
 struct FPXRTrackedCamera
@@ -43,4 +44,9 @@ public:
 	bool bUseCustomTrans;
 
 	FTransform CustomTrans;
+
+	// Calibration of the external camera, kept up to date by the MRC module without parsing the file again
+	FPICOXRMRCCalibration Calibration;
+
+	uint32 CalibrationRevision;
 };
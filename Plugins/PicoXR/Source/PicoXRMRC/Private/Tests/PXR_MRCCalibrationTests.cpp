@@ -0,0 +1,187 @@
+﻿//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_MRCCalibration.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRMRCCalibrationTests
+{
+	class FFakeReader : public IPICOXRMRCCalibrationReader
+	{
+	public:
+		virtual bool Read(const FString& Path, FPICOXRMRCCalibration& OutCalibration) override
+		{
+			Reads++;
+			OutCalibration = Calibration;
+			return bSucceed;
+		}
+
+		FPICOXRMRCCalibration Calibration;
+		int32 Reads = 0;
+		bool bSucceed = true;
+	};
+
+	static FPICOXRMRCCalibration MakeCalibration(float FOV, const FVector& Position, const FRotator& Rotation)
+	{
+		const float Values[10] = { 1920.0f, 1080.0f, FOV, Position.X, Position.Y, Position.Z, 0.0f, 0.0f, 0.0f, 1.0f };
+		FPICOXRMRCCalibration Calibration = FPICOXRMRCCalibration::FromRawValues(Values);
+		Calibration.Orientation = Rotation.Quaternion();
+		return Calibration;
+	}
+
+	static void TestValidation(FAutomationTestBase& Test)
+	{
+		// Intrinsics and extrinsics out of range are rejected, small quaternion drift is normalized.
+		const FPICOXRMRCCalibration A = MakeCalibration(60.0f, FVector(1.5f, 1.2f, -2.0f), FRotator(10.0f, 170.0f, 0.0f));
+		FPICOXRMRCCalibration Copy = A;
+		Test.TestTrue(TEXT("A calibration in range is valid"), Copy.Validate());
+		Copy = A;
+		Copy.Width = 0;
+		Test.TestFalse(TEXT("A calibration without a width is valid"), Copy.Validate());
+		Copy = A;
+		Copy.Height = 100000;
+		Test.TestFalse(TEXT("A calibration with a huge height is valid"), Copy.Validate());
+		Copy = A;
+		Copy.FOV = 0.0f;
+		Test.TestFalse(TEXT("A calibration without a field of view is valid"), Copy.Validate());
+		Copy.FOV = NAN;
+		Test.TestFalse(TEXT("A calibration with a NaN field of view is valid"), Copy.Validate());
+		Copy = A;
+		Copy.Position = FVector(0.0f, 0.0f, 500.0f);
+		Test.TestFalse(TEXT("A calibration with a far position is valid"), Copy.Validate());
+		Copy = A;
+		Copy.Orientation = FQuat(0.0f, 0.0f, 0.0f, 0.0f);
+		Test.TestFalse(TEXT("A calibration with a zero orientation is valid"), Copy.Validate());
+		FPICOXRMRCCalibration Drifted = A;
+		Drifted.Orientation *= 1.02f;
+		Test.TestTrue(TEXT("A calibration with a drifted orientation is valid"), Drifted.Validate());
+		Test.TestEqual(TEXT("Size of a drifted orientation once validated"), Drifted.Orientation.Size(), 1.0f, 1.0e-4f);
+	}
+
+	static void TestCache(FAutomationTestBase& Test)
+	{
+		// The binary cache round trips and refuses data from another file, version or length.
+		const FPICOXRMRCCalibration A = MakeCalibration(60.0f, FVector(1.5f, 1.2f, -2.0f), FRotator(10.0f, 170.0f, 0.0f));
+		FMD5 HashA;
+		HashA.Update(reinterpret_cast<const uint8*>("A"), 1);
+		FMD5Hash FileHashA;
+		FileHashA.Set(HashA);
+		FMD5 HashB;
+		HashB.Update(reinterpret_cast<const uint8*>("B"), 1);
+		FMD5Hash FileHashB;
+		FileHashB.Set(HashB);
+		TArray<uint8> Cache;
+		FPICOXRMRCCalibrationStore::WriteCache(FileHashA, A, Cache);
+		FPICOXRMRCCalibration FromCache;
+		Test.TestTrue(TEXT("The cache reads back"), FPICOXRMRCCalibrationStore::ReadCache(Cache, FileHashA, FromCache));
+		Test.TestTrue(TEXT("The cache round trips"), FromCache.Equals(A));
+		Test.TestFalse(TEXT("The cache of another file reads"), FPICOXRMRCCalibrationStore::ReadCache(Cache, FileHashB, FromCache));
+		TArray<uint8> Corrupt = Cache;
+		Corrupt[4] ^= 0xff;
+		Test.TestFalse(TEXT("A cache of another version reads"), FPICOXRMRCCalibrationStore::ReadCache(Corrupt, FileHashA, FromCache));
+		Corrupt = Cache;
+		Corrupt.Pop();
+		Test.TestFalse(TEXT("A truncated cache reads"), FPICOXRMRCCalibrationStore::ReadCache(Corrupt, FileHashA, FromCache));
+		Test.TestFalse(TEXT("An empty cache reads"), FPICOXRMRCCalibrationStore::ReadCache(TArray<uint8>(), FileHashA, FromCache));
+		FPICOXRMRCCalibration Invalid = A;
+		Invalid.Orientation = FQuat(0.0f, 0.0f, 0.0f, 0.0f);
+		FPICOXRMRCCalibrationStore::WriteCache(FileHashA, Invalid, Cache);
+		Test.TestFalse(TEXT("A cached invalid calibration reads"), FPICOXRMRCCalibrationStore::ReadCache(Cache, FileHashA, FromCache));
+	}
+
+	static void TestBlend(FAutomationTestBase& Test)
+	{
+		// Blends start at the first calibration and end at the second.
+		const FPICOXRMRCCalibration A = MakeCalibration(60.0f, FVector(1.5f, 1.2f, -2.0f), FRotator(10.0f, 170.0f, 0.0f));
+		const FPICOXRMRCCalibration B = MakeCalibration(75.0f, FVector(-1.0f, 1.6f, 2.5f), FRotator(-5.0f, 20.0f, 3.0f));
+		Test.TestTrue(TEXT("A blend starts at the first calibration"), FPICOXRMRCCalibration::Blend(A, B, 0.0f).Equals(A));
+		Test.TestTrue(TEXT("A blend ends at the second calibration"), FPICOXRMRCCalibration::Blend(A, B, 1.0f).Equals(B));
+		const FPICOXRMRCCalibration Half = FPICOXRMRCCalibration::Blend(A, B, 0.5f);
+		Test.TestEqual(TEXT("Field of view half way"), Half.FOV, 67.5f, KINDA_SMALL_NUMBER);
+		Test.TestTrue(TEXT("Position half way"), Half.Position.Equals((A.Position + B.Position) * 0.5f, 1.0e-4f));
+	}
+
+	static void TestStore(FAutomationTestBase& Test)
+	{
+		const FPICOXRMRCCalibration A = MakeCalibration(60.0f, FVector(1.5f, 1.2f, -2.0f), FRotator(10.0f, 170.0f, 0.0f));
+		const FPICOXRMRCCalibration B = MakeCalibration(75.0f, FVector(-1.0f, 1.6f, 2.5f), FRotator(-5.0f, 20.0f, 3.0f));
+		FPICOXRMRCCalibration Invalid = A;
+		Invalid.Orientation = FQuat(0.0f, 0.0f, 0.0f, 0.0f);
+
+		// The store parses a file once, then serves it from the cache until the file changes.
+		const FString Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PICOXR"), TEXT("MRCCalibrationTest"));
+		const FString FilePath = FPaths::Combine(Directory, TEXT("mrc.xml"));
+		const FString CachePath = FPaths::Combine(Directory, TEXT("mrc.cache"));
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+		Test.TestTrue(TEXT("Calibration file written"), FFileHelper::SaveStringToFile(TEXT("<calibration a/>"), *FilePath));
+
+		TSharedRef<FFakeReader> FakeReader = MakeShared<FFakeReader>();
+		FakeReader->Calibration = A;
+		{
+			FPICOXRMRCCalibrationStore Store(FakeReader);
+			Test.TestTrue(TEXT("A new file loads"), Store.Load(FilePath, CachePath, 0.0));
+			Test.TestTrue(TEXT("Revision of a new file"), Store.GetRevision() == 1);
+			Test.TestTrue(TEXT("Calibration of a new file"), Store.GetCalibration().Equals(A));
+			Test.TestEqual(TEXT("Reads of a new file"), FakeReader->Reads, 1);
+			Test.TestTrue(TEXT("Parses of a new file"), Store.GetStats().Parses == 1);
+			Test.TestFalse(TEXT("A first load blends"), Store.IsBlending());
+		}
+		{
+			FPICOXRMRCCalibrationStore Store(FakeReader);
+			Store.SetPollInterval(1.0f);
+			Store.SetBlendTime(0.5f);
+			Test.TestTrue(TEXT("A cached file loads"), Store.Load(FilePath, CachePath, 0.0));
+			Test.TestTrue(TEXT("Calibration of a cached file"), Store.GetCalibration().Equals(A));
+			Test.TestEqual(TEXT("Reads of a cached file"), FakeReader->Reads, 1);
+			Test.TestTrue(TEXT("Cache hits of a cached file"), Store.GetStats().CacheHits == 1);
+			Test.TestFalse(TEXT("An unchanged file changes the calibration"), Store.Tick(2.0));
+
+			// A new calibration blends in over the blend time.
+			FakeReader->Calibration = B;
+			Test.TestTrue(TEXT("Changed calibration file written"), FFileHelper::SaveStringToFile(TEXT("<calibration b with more text/>"), *FilePath));
+			Test.TestTrue(TEXT("A changed file changes the calibration"), Store.Tick(3.0));
+			Test.TestTrue(TEXT("Revision of a changed file"), Store.GetRevision() == 2);
+			Test.TestTrue(TEXT("A changed file blends"), Store.IsBlending());
+			Test.TestTrue(TEXT("Reloads of a changed file"), Store.GetStats().Reloads == 1);
+			Test.TestTrue(TEXT("The calibration changes while blending"), Store.Tick(3.25));
+			Test.TestTrue(TEXT("Field of view half way through the blend"), Store.GetCalibration().FOV > A.FOV && Store.GetCalibration().FOV < B.FOV);
+			Test.TestTrue(TEXT("The calibration changes at the end of the blend"), Store.Tick(3.5));
+			Test.TestFalse(TEXT("A blend over blends"), Store.IsBlending());
+			Test.TestTrue(TEXT("Calibration at the end of the blend"), Store.GetCalibration().Equals(B));
+			Test.TestTrue(TEXT("Target at the end of the blend"), Store.GetTarget().Equals(B));
+			Test.TestFalse(TEXT("The calibration changes after the blend"), Store.Tick(3.6));
+
+			// A broken calibration is rejected and the last good one stays.
+			FakeReader->Calibration = Invalid;
+			Test.TestTrue(TEXT("Broken calibration file written"), FFileHelper::SaveStringToFile(TEXT("<calibration broken/>"), *FilePath));
+			Test.TestFalse(TEXT("A broken file changes the calibration"), Store.Tick(5.0));
+			Test.TestTrue(TEXT("Rejected calibrations"), Store.GetStats().Rejected == 1);
+			Test.TestTrue(TEXT("The last good calibration stays"), Store.GetCalibration().Equals(B));
+
+			// Going back to the calibration in use needs no parse and starts no blend.
+			const int32 Reads = FakeReader->Reads;
+			FakeReader->Calibration = B;
+			Test.TestTrue(TEXT("Calibration file in use written back"), FFileHelper::SaveStringToFile(TEXT("<calibration b with more text/>"), *FilePath));
+			Test.TestFalse(TEXT("Going back to the calibration in use changes it"), Store.Tick(7.0));
+			Test.TestEqual(TEXT("Reads going back to the calibration in use"), FakeReader->Reads, Reads);
+			Test.TestTrue(TEXT("Revision going back to the calibration in use"), Store.GetRevision() == 2);
+		}
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	}
+}
+
+/** Checks MRC calibration validation, the binary cache round trip and reloading on file changes with a fake reader. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRMRCCalibrationTest, "PICOXR.MRC.Calibration", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRMRCCalibrationTest::RunTest(const FString& Parameters)
+{
+	PICOXRMRCCalibrationTests::TestValidation(*this);
+	PICOXRMRCCalibrationTests::TestCache(*this);
+	PICOXRMRCCalibrationTests::TestBlend(*this);
+	PICOXRMRCCalibrationTests::TestStore(*this);
+	return true;
+}
+#endif
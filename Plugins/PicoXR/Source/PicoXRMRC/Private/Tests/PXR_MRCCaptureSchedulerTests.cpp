@@ -0,0 +1,164 @@
+﻿//Unreal® Engine, Copyright 1998 – 2022, Epic Games, Inc. All rights reserved.
+
+#include "PXR_MRCCaptureScheduler.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+namespace PICOXRMRCCaptureSchedulerTests
+{
+	struct FRunResult
+	{
+		int32 Background = 0;
+		int32 Foreground = 0;
+		// Foreground captures while there was no foreground to capture.
+		int32 UnwantedForeground = 0;
+		// Captures out of order or twice in a period.
+		int32 OutOfOrder = 0;
+	};
+
+	/** Runs Frames frames of FrameInterval seconds plus up to Jitter seconds, counting the frames that break the invariants. */
+	static FRunResult RunClock(FPICOXRMRCCaptureScheduler& Scheduler, double& Time, int32 Frames, double FrameInterval, double Jitter, bool bForeground, FRandomStream& Random)
+	{
+		FRunResult Result;
+		uint8 PeriodCaptures = PXR_MRC_CAPTURE_NONE;
+		for (int32 Frame = 0; Frame < Frames; Frame++)
+		{
+			const uint8 Captures = Scheduler.Update(Time, true, bForeground);
+			Result.Background += (Captures & PXR_MRC_CAPTURE_BACKGROUND) ? 1 : 0;
+			Result.Foreground += (Captures & PXR_MRC_CAPTURE_FOREGROUND) ? 1 : 0;
+			if (!bForeground && (Captures & PXR_MRC_CAPTURE_FOREGROUND))
+			{
+				Result.UnwantedForeground++;
+			}
+			// A period captures the background first and each capture once.
+			if (Captures & PXR_MRC_CAPTURE_BACKGROUND)
+			{
+				PeriodCaptures = PXR_MRC_CAPTURE_NONE;
+			}
+			else if (Captures != PXR_MRC_CAPTURE_NONE && PeriodCaptures != PXR_MRC_CAPTURE_BACKGROUND)
+			{
+				Result.OutOfOrder++;
+			}
+			PeriodCaptures |= Captures;
+			Time += FrameInterval + Random.FRandRange(0.0f, Jitter);
+		}
+		return Result;
+	}
+
+	static void TestRun(FAutomationTestBase& Test, const TCHAR* What, const FRunResult& Result)
+	{
+		Test.TestEqual(*FString::Printf(TEXT("%s, foreground captures without a foreground"), What), Result.UnwantedForeground, 0);
+		Test.TestEqual(*FString::Printf(TEXT("%s, captures out of order"), What), Result.OutOfOrder, 0);
+	}
+
+	static void TestRate(FAutomationTestBase& Test, const TCHAR* What, int32 Captures, double Expected)
+	{
+		Test.TestEqual(What, (double)Captures, Expected, FMath::Max(2.0, Expected * 0.03));
+	}
+
+	static void TestClocks(FAutomationTestBase& Test)
+	{
+		FRandomStream Random(0x4d5243);
+
+		// 90Hz headset, 30Hz capture: three frames per period, background and foreground on consecutive ones.
+		{
+			FPICOXRMRCCaptureScheduler Scheduler;
+			double Time = 100.0;
+			const FRunResult Result = RunClock(Scheduler, Time, 90 * 10, 1.0 / 90.0, 0.0, true, Random);
+			TestRun(Test, TEXT("90Hz"), Result);
+			TestRate(Test, TEXT("90Hz background captures"), Result.Background, 300.0);
+			TestRate(Test, TEXT("90Hz foreground captures"), Result.Foreground, 300.0);
+			// Only the first period, before any frame interval is known, renders the pair on one frame.
+			Test.TestEqual(TEXT("90Hz periods capturing both on one frame"), Scheduler.GetStats().PairedPeriods, (uint64)1);
+		}
+
+		// 45Hz headset cannot fit two frames in a period, both captures go on one frame.
+		{
+			FPICOXRMRCCaptureScheduler Scheduler;
+			double Time = 0.0;
+			const FRunResult Result = RunClock(Scheduler, Time, 45 * 10, 1.0 / 45.0, 0.0, true, Random);
+			TestRun(Test, TEXT("45Hz"), Result);
+			TestRate(Test, TEXT("45Hz background captures"), Result.Background, 300.0);
+			Test.TestEqual(TEXT("45Hz foreground captures"), Result.Foreground, Result.Background);
+			Test.TestEqual(TEXT("45Hz periods split over two frames"), Scheduler.GetStats().SplitPeriods, (uint64)0);
+		}
+
+		// Jittery 72-120Hz frames keep the capture rate.
+		{
+			FPICOXRMRCCaptureScheduler Scheduler;
+			double Time = 0.0;
+			const double Start = Time;
+			const FRunResult Result = RunClock(Scheduler, Time, 1000, 1.0 / 120.0, 1.0 / 72.0 - 1.0 / 120.0, true, Random);
+			TestRun(Test, TEXT("Jittery frames"), Result);
+			TestRate(Test, TEXT("Jittery background captures"), Result.Background, (Time - Start) * 30.0);
+			TestRate(Test, TEXT("Jittery foreground captures"), Result.Foreground, (Time - Start) * 30.0);
+		}
+
+		// Background only, at 24Hz.
+		{
+			FPICOXRMRCCaptureScheduler Scheduler;
+			Scheduler.SetTargetRate(24.0f);
+			double Time = 0.0;
+			const FRunResult Result = RunClock(Scheduler, Time, 72 * 10, 1.0 / 72.0, 0.0, false, Random);
+			TestRun(Test, TEXT("24Hz background only"), Result);
+			Test.TestEqual(TEXT("24Hz foreground captures"), Result.Foreground, 0);
+			TestRate(Test, TEXT("24Hz background captures"), Result.Background, 240.0);
+		}
+
+		// A rate of 0 captures everything every frame.
+		{
+			FPICOXRMRCCaptureScheduler Scheduler;
+			Scheduler.SetTargetRate(0.0f);
+			double Time = 0.0;
+			const FRunResult Result = RunClock(Scheduler, Time, 100, 1.0 / 90.0, 0.0, true, Random);
+			TestRun(Test, TEXT("Unlimited rate"), Result);
+			Test.TestEqual(TEXT("Background captures at an unlimited rate"), Result.Background, 100);
+			Test.TestEqual(TEXT("Foreground captures at an unlimited rate"), Result.Foreground, 100);
+		}
+	}
+
+	static void TestConsumers(FAutomationTestBase& Test)
+	{
+		FRandomStream Random(0x4d5244);
+
+		// Nothing is captured without a consumer, and the first frame with one captures straight away.
+		{
+			FPICOXRMRCCaptureScheduler Scheduler;
+			double Time = 0.0;
+			RunClock(Scheduler, Time, 10, 1.0 / 90.0, 0.0, true, Random);
+			int32 Captures = 0;
+			for (int32 Frame = 0; Frame < 90; Frame++, Time += 1.0 / 90.0)
+			{
+				Captures += Scheduler.Update(Time, false, true) == PXR_MRC_CAPTURE_NONE ? 0 : 1;
+			}
+			Test.TestEqual(TEXT("Frames captured without a consumer"), Captures, 0);
+			Test.TestEqual(TEXT("Frames skipped without a consumer"), Scheduler.GetStats().SkippedFrames, (uint64)90);
+			Test.TestTrue(TEXT("The first frame with a consumer captures the background"), (Scheduler.Update(Time, true, true) & PXR_MRC_CAPTURE_BACKGROUND) != 0);
+		}
+
+		// A hitch of several periods does not burst the missed captures.
+		{
+			FPICOXRMRCCaptureScheduler Scheduler;
+			double Time = 0.0;
+			RunClock(Scheduler, Time, 90, 1.0 / 90.0, 0.0, true, Random);
+			Time += 0.25;
+			const FRunResult Result = RunClock(Scheduler, Time, 3, 1.0 / 90.0, 0.0, true, Random);
+			TestRun(Test, TEXT("After a hitch"), Result);
+			Test.TestEqual(TEXT("Background captures after a hitch"), Result.Background, 1);
+			Test.TestEqual(TEXT("Foreground captures after a hitch"), Result.Foreground, 1);
+			Test.TestEqual(TEXT("Late periods"), Scheduler.GetStats().LatePeriods, (uint64)1);
+		}
+	}
+}
+
+/** Checks the mixed reality capture scheduler against simulated headset clocks. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPICOXRMRCCaptureSchedulerTest, "PICOXR.MRC.CaptureScheduler", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPICOXRMRCCaptureSchedulerTest::RunTest(const FString& Parameters)
+{
+	PICOXRMRCCaptureSchedulerTests::TestClocks(*this);
+	PICOXRMRCCaptureSchedulerTests::TestConsumers(*this);
+	return true;
+}
+#endif
@@ -29,6 +29,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "PXR|PXRMRC")
 	static void EnableForegroundMRC(bool enable);
 
+	/** Captures per second of the in-game camera, independent of the headset frame rate. 0 captures every frame. */
+	UFUNCTION(BlueprintCallable, Category = "PXR|PXRMRC")
+	static void SetMRCCaptureRate(float Rate);
+
 	UFUNCTION(BlueprintCallable, Category = "PXR|PXRMRC")
 	static void SetMRCTrackingReference(USceneComponent* TrackingReference);
 